@@ -0,0 +1,139 @@
+#!/usr/bin/python3
+#
+# Copyright (C) 2017 Richard Hughes <richard@hughsie.com>
+#
+# Licensed under the GNU General Public License Version 2
+#
+# Runs each self-test scenario under valgrind, records peak heap, total
+# allocations and total bytes into a baseline file, and fails when a
+# scenario regresses past a threshold -- so allocation behaviour is a
+# tested property like correctness, not something discovered weeks
+# later on production RSS graphs.
+#
+# Typical usage, from the build directory:
+#   ../contrib/alloc-regression.py --update src/fu-self-test libdfu/dfu-self-test
+#   ../contrib/alloc-regression.py src/fu-self-test libdfu/dfu-self-test
+
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+
+def list_scenarios(binary):
+    # GTest binaries print one test path per line with -l
+    out = subprocess.check_output([binary, '-l'], universal_newlines=True)
+    return [ln.strip() for ln in out.split('\n') if ln.strip().startswith('/')]
+
+
+def run_memcheck(binary, scenario, env):
+    # the heap summary gives total allocation count and bytes
+    proc = subprocess.run(['valgrind', '--tool=memcheck',
+                           binary, '-p', scenario],
+                          stdout=subprocess.DEVNULL,
+                          stderr=subprocess.PIPE,
+                          universal_newlines=True,
+                          env=env)
+    m = re.search(r'total heap usage: ([0-9,]+) allocs, [0-9,]+ frees, '
+                  r'([0-9,]+) bytes allocated', proc.stderr)
+    if not m:
+        raise RuntimeError('no heap summary for %s %s' % (binary, scenario))
+    return (int(m.group(1).replace(',', '')),
+            int(m.group(2).replace(',', '')))
+
+
+def run_massif(binary, scenario, env):
+    # the largest mem_heap_B snapshot is the peak live heap
+    with tempfile.NamedTemporaryFile(prefix='massif-') as tmpf:
+        subprocess.run(['valgrind', '--tool=massif',
+                        '--massif-out-file=' + tmpf.name,
+                        binary, '-p', scenario],
+                       stdout=subprocess.DEVNULL,
+                       stderr=subprocess.DEVNULL,
+                       env=env)
+        peaks = [int(v) for v in
+                 re.findall(r'^mem_heap_B=(\d+)$',
+                            tmpf.read().decode('utf-8'), re.M)]
+    if not peaks:
+        raise RuntimeError('no massif snapshots for %s %s' % (binary, scenario))
+    return max(peaks)
+
+
+def profile_binary(binary):
+    env = dict(os.environ)
+    # make g_malloc failures and leaks deterministic under the profiler
+    env['G_SLICE'] = 'always-malloc'
+    env['G_DEBUG'] = 'gc-friendly'
+    results = {}
+    for scenario in list_scenarios(binary):
+        n_allocs, n_bytes = run_memcheck(binary, scenario, env)
+        results[scenario] = {
+            'allocs': n_allocs,
+            'bytes': n_bytes,
+            'peak-heap': run_massif(binary, scenario, env),
+        }
+        print('%s %s: %u allocs, %u bytes, %u peak' %
+              (os.path.basename(binary), scenario,
+               n_allocs, n_bytes, results[scenario]['peak-heap']))
+    return results
+
+
+def compare(baseline, results, threshold):
+    failures = []
+    for binary, scenarios in results.items():
+        base_scenarios = baseline.get(binary, {})
+        for scenario, metrics in scenarios.items():
+            base = base_scenarios.get(scenario)
+            if base is None:
+                print('new scenario %s %s, no baseline' % (binary, scenario))
+                continue
+            for key, value in metrics.items():
+                limit = base[key] * (1.0 + threshold / 100.0)
+                if value > limit:
+                    failures.append('%s %s: %s grew %u -> %u (limit %u)' %
+                                    (binary, scenario, key,
+                                     base[key], value, int(limit)))
+    return failures
+
+
+def main():
+    parser = argparse.ArgumentParser(description='allocation regression gate')
+    parser.add_argument('binaries', nargs='+',
+                        help='self-test binaries to profile')
+    parser.add_argument('--baseline', default='alloc-baseline.json',
+                        help='baseline file to compare against')
+    parser.add_argument('--update', action='store_true',
+                        help='write the baseline instead of comparing')
+    parser.add_argument('--threshold', type=float, default=10.0,
+                        help='allowed growth in percent (default 10)')
+    args = parser.parse_args()
+
+    results = {}
+    for binary in args.binaries:
+        results[os.path.basename(binary)] = profile_binary(binary)
+
+    if args.update:
+        with open(args.baseline, 'w') as f:
+            json.dump(results, f, indent=2, sort_keys=True)
+        print('wrote %s' % args.baseline)
+        return 0
+
+    if not os.path.exists(args.baseline):
+        print('no baseline %s, run with --update first' % args.baseline)
+        return 1
+    with open(args.baseline) as f:
+        baseline = json.load(f)
+    failures = compare(baseline, results, args.threshold)
+    for failure in failures:
+        print('REGRESSION: %s' % failure)
+    if failures:
+        return 1
+    print('all scenarios within %.0f%% of baseline' % args.threshold)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
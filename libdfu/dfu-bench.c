@@ -0,0 +1,140 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2017 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <glib-object.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+#include "dfu-firmware.h"
+
+/* how long we spend parsing each sample; long enough to dominate the
+ * timer granularity, short enough to keep the whole run under a minute */
+#define DFU_BENCH_TARGET_US	(1 * G_USEC_PER_SEC)
+
+static glong
+dfu_bench_get_peak_rss_kb (void)
+{
+	struct rusage usage;
+	if (getrusage (RUSAGE_SELF, &usage) != 0)
+		return 0;
+	return usage.ru_maxrss;
+}
+
+static gboolean
+dfu_bench_one (const gchar *filename, gboolean first, GError **error)
+{
+	const gchar *format;
+	gdouble elapsed_sec;
+	gdouble mb_per_sec;
+	gint64 ts;
+	gsize length;
+	guint iterations = 0;
+	g_autofree gchar *data = NULL;
+	g_autoptr(GBytes) bytes = NULL;
+
+	/* load the sample once; we are timing the parser, not the VFS */
+	if (!g_file_get_contents (filename, &data, &length, error))
+		return FALSE;
+	bytes = g_bytes_new_static (data, length);
+
+	/* parse in a loop until enough wall-clock time has passed */
+	ts = g_get_monotonic_time ();
+	do {
+		g_autoptr(DfuFirmware) firmware = dfu_firmware_new ();
+		if (!dfu_firmware_parse_data (firmware, bytes,
+					      DFU_FIRMWARE_PARSE_FLAG_NONE,
+					      error))
+			return FALSE;
+		format = dfu_firmware_format_to_string (dfu_firmware_get_format (firmware));
+		iterations++;
+	} while (g_get_monotonic_time () - ts < DFU_BENCH_TARGET_US);
+	elapsed_sec = (gdouble) (g_get_monotonic_time () - ts) / G_USEC_PER_SEC;
+	mb_per_sec = ((gdouble) length * iterations) / (1024.0 * 1024.0 * elapsed_sec);
+
+	/* one JSON record per sample; peak RSS is for the whole process so
+	 * far, which is still useful for catching allocation regressions */
+	g_print ("%s\n    {\n"
+		 "      \"filename\" : \"%s\",\n"
+		 "      \"format\" : \"%s\",\n"
+		 "      \"size\" : %" G_GSIZE_FORMAT ",\n"
+		 "      \"iterations\" : %u,\n"
+		 "      \"mb-per-sec\" : %.3f,\n"
+		 "      \"peak-rss-kb\" : %ld\n"
+		 "    }",
+		 first ? "" : ",",
+		 filename, format, length, iterations,
+		 mb_per_sec, dfu_bench_get_peak_rss_kb ());
+	return TRUE;
+}
+
+static gboolean
+dfu_bench_add_dir (GPtrArray *filenames, const gchar *path, GError **error)
+{
+	const gchar *tmp;
+	g_autoptr(GDir) dir = NULL;
+
+	dir = g_dir_open (path, 0, error);
+	if (dir == NULL)
+		return FALSE;
+	while ((tmp = g_dir_read_name (dir)) != NULL)
+		g_ptr_array_add (filenames, g_build_filename (path, tmp, NULL));
+	g_ptr_array_sort (filenames, (GCompareFunc) g_strcmp0);
+	return TRUE;
+}
+
+int
+main (int argc, char *argv[])
+{
+	gboolean first = TRUE;
+	guint i;
+	g_autoptr(GPtrArray) filenames = NULL;
+	g_autoptr(GError) error = NULL;
+
+	/* either the files listed on the command line, or the fuzzing corpus
+	 * and test data shipped in the source tree */
+	filenames = g_ptr_array_new_with_free_func (g_free);
+	if (argc > 1) {
+		for (i = 1; i < (guint) argc; i++)
+			g_ptr_array_add (filenames, g_strdup (argv[i]));
+	} else {
+		if (!dfu_bench_add_dir (filenames, FUZZINGDIR, &error) ||
+		    !dfu_bench_add_dir (filenames, TESTDATADIR, &error)) {
+			g_printerr ("failed to find corpus: %s\n", error->message);
+			return EXIT_FAILURE;
+		}
+	}
+
+	g_print ("{\n  \"samples\" : [");
+	for (i = 0; i < filenames->len; i++) {
+		const gchar *filename = g_ptr_array_index (filenames, i);
+		g_autoptr(GError) error_local = NULL;
+		if (!dfu_bench_one (filename, first, &error_local)) {
+			/* not all test data is parsable firmware */
+			g_debug ("skipping %s: %s", filename, error_local->message);
+			continue;
+		}
+		first = FALSE;
+	}
+	g_print ("\n  ]\n}\n");
+	return EXIT_SUCCESS;
+}
@@ -51,6 +51,31 @@ dfu_tool_parse_devo_key (const gchar *key, guint8 *offset, GError **error)
 	return TRUE;
 }
 
+/* the cipher only depends on the byte value, so precompute the mapping
+ * once and apply it with a single load per byte rather than re-testing
+ * the ranges for every byte of a multi-megabyte image */
+static void
+dfu_cipher_devo_build_table (guint8 *table, guint8 offset, gboolean encrypt)
+{
+	guint i;
+
+	for (i = 0; i < 0x100; i++) {
+		guint8 val = (guint8) i;
+		if (encrypt) {
+			if (val >= 0x80 && val <= 0xcf - offset)
+				val += offset;
+			else if (val >= 0xd0 - offset && val < 0xd0)
+				val -= (0x50 - offset);
+		} else {
+			if (val >= 0x80 + offset && val <= 0xcf)
+				val -= offset;
+			else if (val >= 0x80 && val < 0x80 + offset)
+				val += (0x50 - offset);
+		}
+		table[i] = val;
+	}
+}
+
 /**
  * dfu_cipher_decrypt_devo: (skip)
  * @key: a XTEA key
@@ -69,19 +94,16 @@ dfu_cipher_decrypt_devo (const gchar *key,
 			 GError **error)
 {
 	guint8 offset;
+	guint8 table[0x100];
 	guint32 i;
 
 	if (!dfu_tool_parse_devo_key (key, &offset, error))
 		return FALSE;
 
 	/* no words for how stupid this cipher is */
-	for (i = 0; i < length; i++) {
-		guint8 val = data[i];
-		if (val >= 0x80 + offset && val <= 0xcf)
-			data[i] -= offset;
-		else if (val >= 0x80 && val < 0x80 + offset)
-			data[i] += (0x50 - offset);
-	}
+	dfu_cipher_devo_build_table (table, offset, FALSE);
+	for (i = 0; i < length; i++)
+		data[i] = table[data[i]];
 
 	return TRUE;
 }
@@ -104,19 +126,16 @@ dfu_cipher_encrypt_devo (const gchar *key,
 			 GError **error)
 {
 	guint8 offset;
+	guint8 table[0x100];
 	guint32 i;
 
 	if (!dfu_tool_parse_devo_key (key, &offset, error))
 		return FALSE;
 
 	/* no words for how stupid this cipher is */
-	for (i = 0; i < length; i++) {
-		guint8 val = data[i];
-		if (val >= 0x80 && val <= 0xcf - offset)
-			data[i] += offset;
-		else if (val >= 0xd0 - offset && val < 0xd0)
-			data[i] -= (0x50 - offset);
-	}
+	dfu_cipher_devo_build_table (table, offset, TRUE);
+	for (i = 0; i < length; i++)
+		data[i] = table[data[i]];
 
 	return TRUE;
 }
@@ -44,9 +44,15 @@
 
 static void dfu_context_finalize			 (GObject *object);
 
+/* how long we accumulate hotplug events before processing them in one pass;
+ * a hub insertion delivers one event per port in quick succession */
+#define DFU_CONTEXT_HOTPLUG_DELAY	5	/* ms */
+
 typedef struct {
 	GUsbContext		*usb_ctx;
 	GPtrArray		*devices;		/* of DfuContextItem */
+	GPtrArray		*hotplug_events;	/* of DfuContextHotplugEvent */
+	guint			 hotplug_id;
 	guint			 timeout;		/* in ms */
 } DfuContextPrivate;
 
@@ -57,6 +63,11 @@ typedef struct {
 	gulong			 state_change_id;
 } DfuContextItem;
 
+typedef struct {
+	GUsbDevice		*usb_device;
+	gboolean		 added;
+} DfuContextHotplugEvent;
+
 enum {
 	SIGNAL_DEVICE_ADDED,
 	SIGNAL_DEVICE_REMOVED,
@@ -82,6 +93,13 @@ dfu_context_device_free (DfuContextItem *item)
 	g_free (item);
 }
 
+static void
+dfu_context_hotplug_event_free (DfuContextHotplugEvent *event)
+{
+	g_object_unref (event->usb_device);
+	g_free (event);
+}
+
 static void
 dfu_context_class_init (DfuContextClass *klass)
 {
@@ -205,9 +223,7 @@ dfu_context_device_state_cb (DfuDevice *device, DfuState state, DfuContext *cont
 }
 
 static void
-dfu_context_device_added_cb (GUsbContext *usb_context,
-			     GUsbDevice *usb_device,
-			     DfuContext *context)
+dfu_context_process_added (DfuContext *context, GUsbDevice *usb_device)
 {
 	DfuContextPrivate *priv = GET_PRIVATE (context);
 	DfuDevice *device;
@@ -260,9 +276,7 @@ dfu_context_device_added_cb (GUsbContext *usb_context,
 }
 
 static void
-dfu_context_device_removed_cb (GUsbContext *usb_context,
-			       GUsbDevice  *usb_device,
-			       DfuContext *context)
+dfu_context_process_removed (DfuContext *context, GUsbDevice *usb_device)
 {
 	DfuContextPrivate *priv = GET_PRIVATE (context);
 	DfuContextItem *item;
@@ -284,6 +298,90 @@ dfu_context_device_removed_cb (GUsbContext *usb_context,
 		g_timeout_add (priv->timeout, dfu_context_device_timeout_cb, item);
 }
 
+static void
+dfu_context_hotplug_flush (DfuContext *context)
+{
+	DfuContextPrivate *priv = GET_PRIVATE (context);
+	DfuContextHotplugEvent *event;
+	guint i;
+
+	if (priv->hotplug_id > 0) {
+		g_source_remove (priv->hotplug_id);
+		priv->hotplug_id = 0;
+	}
+	for (i = 0; i < priv->hotplug_events->len; i++) {
+		event = g_ptr_array_index (priv->hotplug_events, i);
+		if (event->added)
+			dfu_context_process_added (context, event->usb_device);
+		else
+			dfu_context_process_removed (context, event->usb_device);
+	}
+	g_ptr_array_set_size (priv->hotplug_events, 0);
+}
+
+static gboolean
+dfu_context_hotplug_flush_cb (gpointer user_data)
+{
+	DfuContext *context = DFU_CONTEXT (user_data);
+	DfuContextPrivate *priv = GET_PRIVATE (context);
+
+	priv->hotplug_id = 0;
+	dfu_context_hotplug_flush (context);
+	return FALSE;
+}
+
+static void
+dfu_context_hotplug_queue (DfuContext *context,
+			   GUsbDevice *usb_device,
+			   gboolean added)
+{
+	DfuContextPrivate *priv = GET_PRIVATE (context);
+	DfuContextHotplugEvent *event;
+	const gchar *platform_id;
+	guint i;
+
+	/* only the newest event for each device matters; coalescing them
+	 * means we read the descriptors just once per device when the storm
+	 * from a hub insertion settles, and transient devices that go away
+	 * again inside the window are never probed at all */
+	platform_id = g_usb_device_get_platform_id (usb_device);
+	for (i = 0; i < priv->hotplug_events->len; i++) {
+		event = g_ptr_array_index (priv->hotplug_events, i);
+		if (g_strcmp0 (g_usb_device_get_platform_id (event->usb_device),
+			       platform_id) == 0) {
+			g_ptr_array_remove_index (priv->hotplug_events, i);
+			break;
+		}
+	}
+
+	/* process the batch in one pass after a few milliseconds of quiet */
+	event = g_new0 (DfuContextHotplugEvent, 1);
+	event->usb_device = g_object_ref (usb_device);
+	event->added = added;
+	g_ptr_array_add (priv->hotplug_events, event);
+	if (priv->hotplug_id == 0) {
+		priv->hotplug_id = g_timeout_add (DFU_CONTEXT_HOTPLUG_DELAY,
+						  dfu_context_hotplug_flush_cb,
+						  context);
+	}
+}
+
+static void
+dfu_context_device_added_cb (GUsbContext *usb_context,
+			     GUsbDevice *usb_device,
+			     DfuContext *context)
+{
+	dfu_context_hotplug_queue (context, usb_device, TRUE);
+}
+
+static void
+dfu_context_device_removed_cb (GUsbContext *usb_context,
+			       GUsbDevice  *usb_device,
+			       DfuContext *context)
+{
+	dfu_context_hotplug_queue (context, usb_device, FALSE);
+}
+
 static void
 dfu_context_set_usb_context (DfuContext *context, GUsbContext *usb_ctx)
 {
@@ -301,6 +399,7 @@ dfu_context_init (DfuContext *context)
 	DfuContextPrivate *priv = GET_PRIVATE (context);
 	priv->timeout = 5000;
 	priv->devices = g_ptr_array_new_with_free_func ((GDestroyNotify) dfu_context_device_free);
+	priv->hotplug_events = g_ptr_array_new_with_free_func ((GDestroyNotify) dfu_context_hotplug_event_free);
 }
 
 static void
@@ -309,6 +408,9 @@ dfu_context_finalize (GObject *object)
 	DfuContext *context = DFU_CONTEXT (object);
 	DfuContextPrivate *priv = GET_PRIVATE (context);
 
+	if (priv->hotplug_id > 0)
+		g_source_remove (priv->hotplug_id);
+	g_ptr_array_unref (priv->hotplug_events);
 	g_ptr_array_unref (priv->devices);
 	g_object_unref (priv->usb_ctx);
 
@@ -413,6 +515,10 @@ dfu_context_enumerate (DfuContext *context, GError **error)
 	g_return_val_if_fail (DFU_IS_CONTEXT (context), FALSE);
 	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 	g_usb_context_enumerate (priv->usb_ctx);
+
+	/* process the whole coldplug batch now so the devices are visible
+	 * to the caller without waiting for the mainloop */
+	dfu_context_hotplug_flush (context);
 	return TRUE;
 }
 
@@ -0,0 +1,90 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2017 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "dfu-crc.h"
+
+/* slice-by-8 lookup tables for the reflected IEEE polynomial; built once
+ * on first use rather than carrying 8 KB of constants in the binary */
+static guint32 dfu_crc32_tables[8][256];
+
+static gpointer
+dfu_crc32_tables_init (gpointer user_data)
+{
+	for (guint i = 0; i < 256; i++) {
+		guint32 crc = i;
+		for (guint j = 0; j < 8; j++)
+			crc = (crc >> 1) ^ ((crc & 1) ? 0xedb88320 : 0);
+		dfu_crc32_tables[0][i] = crc;
+	}
+	for (guint i = 0; i < 256; i++) {
+		guint32 crc = dfu_crc32_tables[0][i];
+		for (guint j = 1; j < 8; j++) {
+			crc = dfu_crc32_tables[0][crc & 0xff] ^ (crc >> 8);
+			dfu_crc32_tables[j][i] = crc;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * dfu_crc32: (skip)
+ * @data: data to checksum
+ * @length: length of @data
+ *
+ * Computes the CRC32 used by the DFU suffix, eight input bytes per table
+ * round rather than one. Note that this matches the historical behaviour
+ * of starting from 0xffffffff and not inverting the result.
+ *
+ * Return value: the checksum
+ **/
+guint32
+dfu_crc32 (const guint8 *data, gsize length)
+{
+	static GOnce once = G_ONCE_INIT;
+	guint32 crc = 0xffffffff;
+
+	g_once (&once, dfu_crc32_tables_init, NULL);
+	while (length >= 8) {
+		guint32 hi;
+		guint32 lo;
+		memcpy (&lo, data, 4);
+		memcpy (&hi, data + 4, 4);
+		lo = GUINT32_FROM_LE (lo) ^ crc;
+		hi = GUINT32_FROM_LE (hi);
+		crc = dfu_crc32_tables[7][lo & 0xff] ^
+		      dfu_crc32_tables[6][(lo >> 8) & 0xff] ^
+		      dfu_crc32_tables[5][(lo >> 16) & 0xff] ^
+		      dfu_crc32_tables[4][lo >> 24] ^
+		      dfu_crc32_tables[3][hi & 0xff] ^
+		      dfu_crc32_tables[2][(hi >> 8) & 0xff] ^
+		      dfu_crc32_tables[1][(hi >> 16) & 0xff] ^
+		      dfu_crc32_tables[0][hi >> 24];
+		data += 8;
+		length -= 8;
+	}
+	while (length-- > 0)
+		crc = dfu_crc32_tables[0][(crc ^ *data++) & 0xff] ^ (crc >> 8);
+	return crc;
+}
@@ -37,6 +37,7 @@
 
 #include "config.h"
 
+#include <stdlib.h>
 #include <string.h>
 
 #include "dfu-common.h"
@@ -70,6 +71,11 @@ typedef struct {
 	guint8			 iface_number;
 	guint			 dnload_timeout;
 	guint			 timeout_ms;
+	GMainLoop		*replug_loop;		/* non-NULL when waiting */
+	gint64			 busy_start;		/* when dfuDNBUSY was entered */
+	guint32			 latency_samples[16];	/* of ready-latency in ms */
+	guint			 latency_idx;
+	guint			 latency_cnt;
 } DfuDevicePrivate;
 
 enum {
@@ -236,6 +242,43 @@ dfu_device_get_download_timeout (DfuDevice *device)
 	return priv->dnload_timeout;
 }
 
+static gint
+dfu_device_latency_sort_cb (gconstpointer a, gconstpointer b)
+{
+	return (gint) (*(const guint32 *) a - *(const guint32 *) b);
+}
+
+/**
+ * dfu_device_get_poll_interval: (skip)
+ * @device: a #DfuDevice
+ *
+ * Gets the time in ms to wait before polling GETSTATUS again, using the
+ * median of the recently observed ready-latency rather than the
+ * worst-case bwPollTimeout the device reports.
+ *
+ * Return value: delay in ms
+ **/
+guint
+dfu_device_get_poll_interval (DfuDevice *device)
+{
+	DfuDevicePrivate *priv = GET_PRIVATE (device);
+	guint32 samples[G_N_ELEMENTS (priv->latency_samples)];
+
+	g_return_val_if_fail (DFU_IS_DEVICE (device), 0);
+
+	/* not enough history, trust the device */
+	if (priv->latency_cnt < 4)
+		return priv->dnload_timeout;
+
+	/* p50 of the recent samples, never above the reported value */
+	memcpy (samples, priv->latency_samples,
+		priv->latency_cnt * sizeof (guint32));
+	qsort (samples, priv->latency_cnt, sizeof (guint32),
+	       dfu_device_latency_sort_cb);
+	return CLAMP (samples[priv->latency_cnt / 2],
+		      1, priv->dnload_timeout);
+}
+
 /**
  * dfu_device_set_transfer_size:
  * @device: a #GUsbDevice
@@ -253,6 +296,247 @@ dfu_device_set_transfer_size (DfuDevice *device, guint16 transfer_size)
 	priv->transfer_size = transfer_size;
 }
 
+static gchar *
+dfu_device_get_cache_fn (void)
+{
+	return g_build_filename (g_get_user_cache_dir (),
+				 "dfu",
+				 "devices.conf",
+				 NULL);
+}
+
+/* a new firmware version may change the descriptor, so the cache is
+ * keyed by the firmware release as well as the model */
+static gchar *
+dfu_device_get_cache_group (DfuDevice *device)
+{
+	DfuDevicePrivate *priv = GET_PRIVATE (device);
+	return g_strdup_printf ("%04x:%04x:%04x",
+				g_usb_device_get_vid (priv->dev),
+				g_usb_device_get_pid (priv->dev),
+				g_usb_device_get_release (priv->dev));
+}
+
+/* applies the resolved functional descriptor values from a previous
+ * attach of the same device model, returning FALSE on first sight */
+static gboolean
+dfu_device_cache_load (DfuDevice *device)
+{
+	DfuDevicePrivate *priv = GET_PRIVATE (device);
+	g_autofree gchar *fn = NULL;
+	g_autofree gchar *group = NULL;
+	g_autoptr(GKeyFile) kf = NULL;
+
+	fn = dfu_device_get_cache_fn ();
+	kf = g_key_file_new ();
+	if (!g_key_file_load_from_file (kf, fn, G_KEY_FILE_NONE, NULL))
+		return FALSE;
+	group = dfu_device_get_cache_group (device);
+	if (!g_key_file_has_group (kf, group))
+		return FALSE;
+	priv->attributes = (DfuDeviceAttributes) g_key_file_get_uint64 (kf, group,
+									"Attributes", NULL);
+	priv->transfer_size = (guint16) g_key_file_get_uint64 (kf, group,
+							       "TransferSize", NULL);
+	priv->version = (guint16) g_key_file_get_uint64 (kf, group,
+							 "Version", NULL);
+	priv->dfuse_supported = priv->version == DFU_VERSION_DFUSE;
+	g_debug ("using cached descriptor values for %s: "
+		 "attributes 0x%02x, transfer size 0x%04x, version 0x%04x",
+		 group, priv->attributes, priv->transfer_size, priv->version);
+	return TRUE;
+}
+
+/* failing to save is never fatal; the next attach just re-resolves */
+static void
+dfu_device_cache_save (DfuDevice *device)
+{
+	DfuDevicePrivate *priv = GET_PRIVATE (device);
+	g_autofree gchar *dirname = NULL;
+	g_autofree gchar *fn = NULL;
+	g_autofree gchar *group = NULL;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GKeyFile) kf = NULL;
+
+	fn = dfu_device_get_cache_fn ();
+	kf = g_key_file_new ();
+	g_key_file_load_from_file (kf, fn, G_KEY_FILE_NONE, NULL);
+	group = dfu_device_get_cache_group (device);
+	g_key_file_set_uint64 (kf, group, "Attributes", priv->attributes);
+	g_key_file_set_uint64 (kf, group, "TransferSize", priv->transfer_size);
+	g_key_file_set_uint64 (kf, group, "Version", priv->version);
+	dirname = g_path_get_dirname (fn);
+	if (g_mkdir_with_parents (dirname, 0755) != 0 ||
+	    !g_key_file_save_to_file (kf, fn, &error_local)) {
+		g_debug ("failed to save device cache for %s: %s",
+			 group,
+			 error_local != NULL ? error_local->message : "cannot create directory");
+	}
+}
+
+static gboolean
+dfu_device_test_transfer_size (DfuDevice *device,
+			       guint16 transfer_size,
+			       GCancellable *cancellable)
+{
+	DfuDevicePrivate *priv = GET_PRIVATE (device);
+	gsize actual_length = 0;
+	g_autofree guint8 *buf = g_malloc0 (transfer_size);
+
+	/* read a block of the candidate size from the start of the image */
+	if (!g_usb_device_control_transfer (priv->dev,
+					    G_USB_DEVICE_DIRECTION_DEVICE_TO_HOST,
+					    G_USB_DEVICE_REQUEST_TYPE_CLASS,
+					    G_USB_DEVICE_RECIPIENT_INTERFACE,
+					    DFU_REQUEST_UPLOAD,
+					    0,
+					    priv->iface_number,
+					    buf, transfer_size, &actual_length,
+					    priv->timeout_ms,
+					    cancellable,
+					    NULL)) {
+		/* a stall leaves the device in dfuERROR */
+		g_usb_device_control_transfer (priv->dev,
+					       G_USB_DEVICE_DIRECTION_HOST_TO_DEVICE,
+					       G_USB_DEVICE_REQUEST_TYPE_CLASS,
+					       G_USB_DEVICE_RECIPIENT_INTERFACE,
+					       DFU_REQUEST_CLRSTATUS,
+					       0,
+					       priv->iface_number,
+					       NULL, 0, NULL,
+					       priv->timeout_ms,
+					       cancellable,
+					       NULL);
+		return FALSE;
+	}
+
+	/* reset the block pointer for the next attempt */
+	if (!g_usb_device_control_transfer (priv->dev,
+					    G_USB_DEVICE_DIRECTION_HOST_TO_DEVICE,
+					    G_USB_DEVICE_REQUEST_TYPE_CLASS,
+					    G_USB_DEVICE_RECIPIENT_INTERFACE,
+					    DFU_REQUEST_ABORT,
+					    0,
+					    priv->iface_number,
+					    NULL, 0, NULL,
+					    priv->timeout_ms,
+					    cancellable,
+					    NULL))
+		return FALSE;
+
+	/* a short read means the device capped the size */
+	return actual_length == transfer_size;
+}
+
+/**
+ * dfu_device_probe_transfer_size:
+ * @device: a #DfuDevice
+ * @cancellable: a #GCancellable, or %NULL
+ * @error: a #GError, or %NULL
+ *
+ * Empirically finds the largest transfer size the device actually
+ * accepts, which is often much larger than the conservative value
+ * advertised in the functional descriptor, and uses it for subsequent
+ * uploads and downloads. The result is cached per VID:PID:REV so the
+ * probe only has to run once per device model.
+ *
+ * The probe uses upload requests and so only works on devices in DFU
+ * mode that can upload.
+ *
+ * Return value: %TRUE for success
+ *
+ * Since: 0.9.5
+ **/
+gboolean
+dfu_device_probe_transfer_size (DfuDevice *device,
+				GCancellable *cancellable,
+				GError **error)
+{
+	DfuDevicePrivate *priv = GET_PRIVATE (device);
+	guint16 lo;
+	guint16 hi = 0x1000;
+	g_autofree gchar *dirname = NULL;
+	g_autofree gchar *fn = NULL;
+	g_autofree gchar *key = NULL;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GKeyFile) kf = NULL;
+
+	g_return_val_if_fail (DFU_IS_DEVICE (device), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* no backing USB device */
+	if (priv->dev == NULL) {
+		g_set_error (error,
+			     DFU_ERROR,
+			     DFU_ERROR_INTERNAL,
+			     "failed to probe: no GUsbDevice for %s",
+			     priv->platform_id);
+		return FALSE;
+	}
+	if (priv->mode != DFU_MODE_DFU) {
+		g_set_error_literal (error,
+				     DFU_ERROR,
+				     DFU_ERROR_NOT_SUPPORTED,
+				     "not in DFU mode");
+		return FALSE;
+	}
+	if ((priv->attributes & DFU_DEVICE_ATTRIBUTE_CAN_UPLOAD) == 0) {
+		g_set_error_literal (error,
+				     DFU_ERROR,
+				     DFU_ERROR_NOT_SUPPORTED,
+				     "cannot probe as device cannot upload");
+		return FALSE;
+	}
+
+	/* use any previously probed value for this device model */
+	key = dfu_device_get_cache_group (device);
+	fn = dfu_device_get_cache_fn ();
+	kf = g_key_file_new ();
+	if (g_key_file_load_from_file (kf, fn, G_KEY_FILE_NONE, NULL)) {
+		guint64 tmp = g_key_file_get_uint64 (kf, key, "ProbedTransferSize", NULL);
+		if (tmp >= priv->transfer_size && tmp <= hi) {
+			g_debug ("using cached transfer size 0x%04x for %s",
+				 (guint) tmp, key);
+			priv->transfer_size = (guint16) tmp;
+			return TRUE;
+		}
+	}
+
+	/* ensure interface is claimed */
+	if (!dfu_device_ensure_interface (device, cancellable, error))
+		return FALSE;
+
+	/* bisect between the advertised size and the 4KiB ceiling */
+	lo = priv->transfer_size;
+	if (lo < hi) {
+		if (dfu_device_test_transfer_size (device, hi, cancellable)) {
+			lo = hi;
+		} else {
+			while (hi - lo > 64) {
+				guint16 mid = (guint16) ((lo + hi) / 2);
+				if (dfu_device_test_transfer_size (device, mid, cancellable))
+					lo = mid;
+				else
+					hi = mid;
+			}
+		}
+	}
+	g_debug ("probed transfer size 0x%04x (advertised 0x%04x)",
+		 lo, priv->transfer_size);
+	priv->transfer_size = lo;
+
+	/* save for next time; failing to do so is not fatal */
+	g_key_file_set_uint64 (kf, key, "ProbedTransferSize", lo);
+	dirname = g_path_get_dirname (fn);
+	if (g_mkdir_with_parents (dirname, 0755) != 0 ||
+	    !g_key_file_save_to_file (kf, fn, &error_local)) {
+		g_debug ("failed to save transfer size for %s: %s",
+			 key,
+			 error_local != NULL ? error_local->message : "cannot create directory");
+	}
+	return TRUE;
+}
+
 static void
 dfu_device_finalize (GObject *object)
 {
@@ -287,6 +571,11 @@ dfu_device_parse_iface_data (DfuDevice *device, GBytes *iface_data)
 	const DfuFuncDescriptor *desc;
 	gsize iface_data_length;
 
+	/* a model seen before already has the fixed-up values resolved, so
+	 * skip the parse and the noisy sanity checks entirely */
+	if (dfu_device_cache_load (device))
+		return;
+
 	/* parse the functional descriptor */
 	desc = g_bytes_get_data (iface_data, &iface_data_length);
 	if (iface_data_length != 0x09) {
@@ -333,6 +622,9 @@ dfu_device_parse_iface_data (DfuDevice *device, GBytes *iface_data)
 
 	/* get attributes about the DFU operation */
 	priv->attributes = desc->bmAttributes;
+
+	/* remember the resolved values for the next attach */
+	dfu_device_cache_save (device);
 }
 
 static gboolean
@@ -1069,6 +1361,23 @@ dfu_device_refresh (DfuDevice *device, GCancellable *cancellable, GError **error
 			     (guint) actual_length);
 	}
 
+	/* learn how long the device actually stays busy, as many devices
+	 * report a worst-case bwPollTimeout far above the typical value */
+	if (buf[4] == DFU_STATE_DFU_DNBUSY &&
+	    priv->state != DFU_STATE_DFU_DNBUSY) {
+		priv->busy_start = g_get_monotonic_time ();
+	} else if (buf[4] != DFU_STATE_DFU_DNBUSY &&
+		   priv->state == DFU_STATE_DFU_DNBUSY &&
+		   priv->busy_start > 0) {
+		gint64 latency = (g_get_monotonic_time () - priv->busy_start) / 1000;
+		priv->latency_samples[priv->latency_idx] = (guint32) latency;
+		priv->latency_idx = (priv->latency_idx + 1) %
+					G_N_ELEMENTS (priv->latency_samples);
+		if (priv->latency_cnt < G_N_ELEMENTS (priv->latency_samples))
+			priv->latency_cnt++;
+		priv->busy_start = 0;
+	}
+
 	/* status or state changed */
 	dfu_device_set_status (device, buf[0]);
 	dfu_device_set_state (device, buf[4]);
@@ -1518,6 +1827,10 @@ dfu_device_set_new_usb_dev (DfuDevice *device, GUsbDevice *dev,
 	/* set the new USB device */
 	g_set_object (&priv->dev, dev);
 
+	/* wake up any waiter as soon as the device has re-enumerated */
+	if (priv->replug_loop != NULL)
+		g_main_loop_quit (priv->replug_loop);
+
 	/* should be the same */
 	if (g_strcmp0 (priv->platform_id,
 		       g_usb_device_get_platform_id (dev)) != 0) {
@@ -1557,65 +1870,17 @@ dfu_device_set_new_usb_dev (DfuDevice *device, GUsbDevice *dev,
 }
 
 typedef struct {
-	DfuDevice	*device;
-	GError		**error;
 	GMainLoop	*loop;
-	GUsbDevice	*dev;
-	guint		 cnt;
-	guint		 timeout;
+	gboolean	 timed_out;
 } DfuDeviceReplugHelper;
 
-static void
-dfu_device_replug_helper_free (DfuDeviceReplugHelper *helper)
-{
-	if (helper->dev != NULL)
-		g_object_unref (helper->dev);
-	g_object_unref (helper->device);
-	g_main_loop_unref (helper->loop);
-	g_free (helper);
-}
-
 static gboolean
-dfu_device_replug_helper_cb (gpointer user_data)
+dfu_device_replug_timeout_cb (gpointer user_data)
 {
 	DfuDeviceReplugHelper *helper = (DfuDeviceReplugHelper *) user_data;
-	DfuDevicePrivate *priv = GET_PRIVATE (helper->device);
-
-	/* did the backing GUsbDevice change */
-	if (helper->dev != priv->dev) {
-		g_debug ("device changed GUsbDevice %p->%p",
-			 helper->dev, priv->dev);
-		g_set_object (&helper->dev, priv->dev);
-
-		/* success */
-		if (helper->dev != NULL) {
-			g_main_loop_quit (helper->loop);
-			return FALSE;
-		}
-	}
-
-	/* set a limit */
-	if (helper->cnt++ * 100 > helper->timeout) {
-		g_debug ("gave up waiting for device replug");
-		if (helper->dev == NULL) {
-			g_set_error_literal (helper->error,
-					     DFU_ERROR,
-					     DFU_ERROR_INVALID_DEVICE,
-					     "target went away but did not come back");
-		} else {
-			g_set_error_literal (helper->error,
-					     DFU_ERROR,
-					     DFU_ERROR_INVALID_DEVICE,
-					     "target did not disconnect");
-		}
-		g_main_loop_quit (helper->loop);
-		return FALSE;
-	}
-
-	/* continue waiting */
-	g_debug ("waiting for device replug for %ums -- state is %s",
-		 helper->cnt * 100, dfu_state_to_string (priv->state));
-	return TRUE;
+	helper->timed_out = TRUE;
+	g_main_loop_quit (helper->loop);
+	return G_SOURCE_REMOVE;
 }
 
 /**
@@ -1637,23 +1902,40 @@ dfu_device_wait_for_replug (DfuDevice *device, guint timeout,
 			    GCancellable *cancellable, GError **error)
 {
 	DfuDevicePrivate *priv = GET_PRIVATE (device);
-	DfuDeviceReplugHelper *helper;
-	GError *error_tmp = NULL;
-	const guint replug_poll = 100; /* ms */
-
-	/* wait for replug */
-	helper = g_new0 (DfuDeviceReplugHelper, 1);
-	helper->loop = g_main_loop_new (NULL, FALSE);
-	helper->device = g_object_ref (device);
-	helper->dev = g_object_ref (priv->dev);
-	helper->error = &error_tmp;
-	helper->timeout = timeout;
-	g_timeout_add_full (G_PRIORITY_DEFAULT, replug_poll,
-			    dfu_device_replug_helper_cb, helper,
-			    (GDestroyNotify) dfu_device_replug_helper_free);
-	g_main_loop_run (helper->loop);
-	if (error_tmp != NULL) {
-		g_propagate_error (error, error_tmp);
+	DfuDeviceReplugHelper helper = { NULL, FALSE };
+	guint timeout_id;
+	g_autoptr(GMainLoop) loop = NULL;
+	g_autoptr(GUsbDevice) dev_old = NULL;
+
+	/* the hotplug handler in DfuContext wakes this up as soon as the
+	 * device re-enumerates; the timeout is only a failsafe */
+	if (priv->dev != NULL)
+		dev_old = g_object_ref (priv->dev);
+	loop = g_main_loop_new (NULL, FALSE);
+	helper.loop = loop;
+	priv->replug_loop = loop;
+	timeout_id = g_timeout_add (timeout,
+				    dfu_device_replug_timeout_cb, &helper);
+	g_main_loop_run (loop);
+	priv->replug_loop = NULL;
+	if (!helper.timed_out)
+		g_source_remove (timeout_id);
+
+	/* gave up waiting */
+	if (helper.timed_out && priv->dev == NULL) {
+		g_debug ("gave up waiting for device replug");
+		g_set_error_literal (error,
+				     DFU_ERROR,
+				     DFU_ERROR_INVALID_DEVICE,
+				     "target went away but did not come back");
+		return FALSE;
+	}
+	if (helper.timed_out && priv->dev == dev_old) {
+		g_debug ("gave up waiting for device replug");
+		g_set_error_literal (error,
+				     DFU_ERROR,
+				     DFU_ERROR_INVALID_DEVICE,
+				     "target did not disconnect");
 		return FALSE;
 	}
 
@@ -1971,6 +2253,7 @@ dfu_device_download (DfuDevice *device,
 		     GError **error)
 {
 	DfuDevicePrivate *priv = GET_PRIVATE (device);
+	DfuTargetTransferFlags flags_local = DFU_TARGET_TRANSFER_FLAG_NONE;
 	GPtrArray *images;
 	gboolean ret;
 	guint i;
@@ -2070,14 +2353,14 @@ dfu_device_download (DfuDevice *device,
 				     "no images in firmware file");
 		return FALSE;
 	}
+	/* resolve the target for each image and check compatibility before
+	 * any data is sent */
+	targets = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	for (i = 0; i < images->len; i++) {
 		DfuCipherKind cipher_fw;
 		DfuCipherKind cipher_target;
 		DfuImage *image;
-		DfuTargetTransferFlags flags_local = DFU_TARGET_TRANSFER_FLAG_NONE;
 		const gchar *alt_name;
-		gulong id1;
-		gulong id2;
 		g_autoptr(DfuTarget) target_tmp = NULL;
 
 		image = g_ptr_array_index (images, i);
@@ -2119,25 +2402,81 @@ dfu_device_download (DfuDevice *device,
 				return FALSE;
 			}
 		}
-
-		/* download onto target */
-		if (flags & DFU_TARGET_TRANSFER_FLAG_VERIFY)
-			flags_local = DFU_TARGET_TRANSFER_FLAG_VERIFY;
-		if (dfu_firmware_get_format (firmware) == DFU_FIRMWARE_FORMAT_RAW)
-			flags_local |= DFU_TARGET_TRANSFER_FLAG_ADDR_HEURISTIC;
-		id1 = g_signal_connect (target_tmp, "percentage-changed",
-					G_CALLBACK (dfu_device_percentage_cb), device);
-		id2 = g_signal_connect (target_tmp, "action-changed",
-					G_CALLBACK (dfu_device_action_cb), device);
-		ret = dfu_target_download (target_tmp,
-					   image,
-					   flags_local,
-					   cancellable,
-					   error);
-		g_signal_handler_disconnect (target_tmp, id1);
-		g_signal_handler_disconnect (target_tmp, id2);
-		if (!ret)
-			return FALSE;
+		g_ptr_array_add (targets, g_object_ref (target_tmp));
+	}
+
+	/* per-image transfer flags */
+	if (flags & DFU_TARGET_TRANSFER_FLAG_VERIFY)
+		flags_local = DFU_TARGET_TRANSFER_FLAG_VERIFY;
+	if (dfu_firmware_get_format (firmware) == DFU_FIRMWARE_FORMAT_RAW)
+		flags_local |= DFU_TARGET_TRANSFER_FLAG_ADDR_HEURISTIC;
+
+	/* devices quirked as having independently programmable targets get
+	 * the element downloads interleaved round-robin, so one bank erases
+	 * or manifests while another is accepting data; everything shares
+	 * the one USB interface so this is still a single event loop */
+	if ((priv->quirks & DFU_DEVICE_QUIRK_PARALLEL_TARGETS) > 0 &&
+	    images->len > 1) {
+		gboolean more_elements = TRUE;
+		guint element_idx;
+
+		/* all targets have to be ready before the first chunk */
+		for (i = 0; i < images->len; i++) {
+			DfuImage *image = g_ptr_array_index (images, i);
+			DfuTarget *target = g_ptr_array_index (targets, i);
+			if (!dfu_target_download_prepare (target, image, error))
+				return FALSE;
+		}
+		for (element_idx = 0; more_elements; element_idx++) {
+			more_elements = FALSE;
+			for (i = 0; i < images->len; i++) {
+				DfuImage *image = g_ptr_array_index (images, i);
+				DfuTarget *target = g_ptr_array_index (targets, i);
+				GPtrArray *elements = dfu_image_get_elements (image);
+				gulong id1;
+				gulong id2;
+
+				if (element_idx >= elements->len)
+					continue;
+				id1 = g_signal_connect (target, "percentage-changed",
+							G_CALLBACK (dfu_device_percentage_cb), device);
+				id2 = g_signal_connect (target, "action-changed",
+							G_CALLBACK (dfu_device_action_cb), device);
+				ret = dfu_target_download_image_element (target,
+									 image,
+									 element_idx,
+									 flags_local,
+									 cancellable,
+									 error);
+				g_signal_handler_disconnect (target, id1);
+				g_signal_handler_disconnect (target, id2);
+				if (!ret)
+					return FALSE;
+				if (element_idx + 1 < elements->len)
+					more_elements = TRUE;
+			}
+		}
+	} else {
+		for (i = 0; i < images->len; i++) {
+			DfuImage *image = g_ptr_array_index (images, i);
+			DfuTarget *target = g_ptr_array_index (targets, i);
+			gulong id1;
+			gulong id2;
+
+			id1 = g_signal_connect (target, "percentage-changed",
+						G_CALLBACK (dfu_device_percentage_cb), device);
+			id2 = g_signal_connect (target, "action-changed",
+						G_CALLBACK (dfu_device_action_cb), device);
+			ret = dfu_target_download (target,
+						   image,
+						   flags_local,
+						   cancellable,
+						   error);
+			g_signal_handler_disconnect (target, id1);
+			g_signal_handler_disconnect (target, id2);
+			if (!ret)
+				return FALSE;
+		}
 	}
 
 	/* do not do the dummy upload for quirked devices */
@@ -2165,6 +2504,173 @@ dfu_device_download (DfuDevice *device,
 	return TRUE;
 }
 
+typedef struct {
+	DfuFirmware		*firmware;
+	DfuTargetTransferFlags	 flags;
+} DfuDeviceDownloadHelper;
+
+static void
+dfu_device_download_helper_free (DfuDeviceDownloadHelper *helper)
+{
+	g_object_unref (helper->firmware);
+	g_free (helper);
+}
+
+static void
+dfu_device_download_thread_cb (GTask *task,
+			       gpointer source_object,
+			       gpointer task_data,
+			       GCancellable *cancellable)
+{
+	DfuDevice *device = DFU_DEVICE (source_object);
+	DfuDeviceDownloadHelper *helper = (DfuDeviceDownloadHelper *) task_data;
+	GError *error = NULL;
+
+	if (!dfu_device_download (device, helper->firmware, helper->flags,
+				  cancellable, &error)) {
+		g_task_return_error (task, error);
+		return;
+	}
+	g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * dfu_device_download_async:
+ * @device: a #DfuDevice
+ * @firmware: a #DfuFirmware
+ * @flags: flags to use, e.g. %DFU_TARGET_TRANSFER_FLAG_VERIFY
+ * @cancellable: a #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @user_data: the data to pass to @callback
+ *
+ * Downloads firmware from the host to the target without blocking the
+ * calling context, which allows several devices to be flashed at the
+ * same time. @cancellable is checked between each chunk transferred.
+ *
+ * The ::percentage-changed and ::action-changed signals are emitted
+ * while the transfer is in progress.
+ *
+ * Since: 0.9.5
+ **/
+void
+dfu_device_download_async (DfuDevice *device,
+			   DfuFirmware *firmware,
+			   DfuTargetTransferFlags flags,
+			   GCancellable *cancellable,
+			   GAsyncReadyCallback callback,
+			   gpointer user_data)
+{
+	DfuDeviceDownloadHelper *helper;
+	g_autoptr(GTask) task = NULL;
+
+	g_return_if_fail (DFU_IS_DEVICE (device));
+	g_return_if_fail (DFU_IS_FIRMWARE (firmware));
+
+	helper = g_new0 (DfuDeviceDownloadHelper, 1);
+	helper->firmware = g_object_ref (firmware);
+	helper->flags = flags;
+	task = g_task_new (device, cancellable, callback, user_data);
+	g_task_set_task_data (task, helper,
+			      (GDestroyNotify) dfu_device_download_helper_free);
+	g_task_run_in_thread (task, dfu_device_download_thread_cb);
+}
+
+/**
+ * dfu_device_download_finish:
+ * @device: a #DfuDevice
+ * @res: the #GAsyncResult
+ * @error: a #GError, or %NULL
+ *
+ * Gets the result of dfu_device_download_async().
+ *
+ * Return value: %TRUE for success
+ *
+ * Since: 0.9.5
+ **/
+gboolean
+dfu_device_download_finish (DfuDevice *device,
+			    GAsyncResult *res,
+			    GError **error)
+{
+	g_return_val_if_fail (DFU_IS_DEVICE (device), FALSE);
+	g_return_val_if_fail (g_task_is_valid (res, device), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+	return g_task_propagate_boolean (G_TASK (res), error);
+}
+
+static void
+dfu_device_upload_thread_cb (GTask *task,
+			     gpointer source_object,
+			     gpointer task_data,
+			     GCancellable *cancellable)
+{
+	DfuDevice *device = DFU_DEVICE (source_object);
+	DfuTargetTransferFlags flags = GPOINTER_TO_UINT (task_data);
+	DfuFirmware *firmware;
+	GError *error = NULL;
+
+	firmware = dfu_device_upload (device, flags, cancellable, &error);
+	if (firmware == NULL) {
+		g_task_return_error (task, error);
+		return;
+	}
+	g_task_return_pointer (task, firmware,
+			       (GDestroyNotify) g_object_unref);
+}
+
+/**
+ * dfu_device_upload_async:
+ * @device: a #DfuDevice
+ * @flags: flags to use, e.g. %DFU_TARGET_TRANSFER_FLAG_VERIFY
+ * @cancellable: a #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @user_data: the data to pass to @callback
+ *
+ * Uploads firmware from the target to the host without blocking the
+ * calling context. @cancellable is checked between each chunk
+ * transferred.
+ *
+ * Since: 0.9.5
+ **/
+void
+dfu_device_upload_async (DfuDevice *device,
+			 DfuTargetTransferFlags flags,
+			 GCancellable *cancellable,
+			 GAsyncReadyCallback callback,
+			 gpointer user_data)
+{
+	g_autoptr(GTask) task = NULL;
+
+	g_return_if_fail (DFU_IS_DEVICE (device));
+
+	task = g_task_new (device, cancellable, callback, user_data);
+	g_task_set_task_data (task, GUINT_TO_POINTER (flags), NULL);
+	g_task_run_in_thread (task, dfu_device_upload_thread_cb);
+}
+
+/**
+ * dfu_device_upload_finish:
+ * @device: a #DfuDevice
+ * @res: the #GAsyncResult
+ * @error: a #GError, or %NULL
+ *
+ * Gets the result of dfu_device_upload_async().
+ *
+ * Return value: (transfer full): the uploaded firmware, or %NULL for error
+ *
+ * Since: 0.9.5
+ **/
+DfuFirmware *
+dfu_device_upload_finish (DfuDevice *device,
+			  GAsyncResult *res,
+			  GError **error)
+{
+	g_return_val_if_fail (DFU_IS_DEVICE (device), NULL);
+	g_return_val_if_fail (g_task_is_valid (res, device), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+	return g_task_propagate_pointer (G_TASK (res), error);
+}
+
 void
 dfu_device_error_fixup (DfuDevice *device,
 			GCancellable *cancellable,
@@ -2242,6 +2748,10 @@ dfu_device_get_quirks_as_string (DfuDevice *device)
 		g_string_append_printf (str, "attach-upload-download|");
 	if (priv->quirks & DFU_DEVICE_QUIRK_IGNORE_RUNTIME)
 		g_string_append_printf (str, "ignore-runtime|");
+	if (priv->quirks & DFU_DEVICE_QUIRK_NO_PIPELINED_DNLOAD)
+		g_string_append_printf (str, "no-pipelined-dnload|");
+	if (priv->quirks & DFU_DEVICE_QUIRK_PARALLEL_TARGETS)
+		g_string_append_printf (str, "parallel-targets|");
 
 	/* a well behaved device */
 	if (str->len == 0) {
@@ -61,6 +61,8 @@ typedef enum {
  * @DFU_DEVICE_QUIRK_NO_DFU_RUNTIME:		No DFU runtime interface is provided
  * @DFU_DEVICE_QUIRK_ATTACH_UPLOAD_DOWNLOAD:	An upload or download is required for attach
  * @DFU_DEVICE_QUIRK_IGNORE_RUNTIME:		Device has broken DFU runtime support
+ * @DFU_DEVICE_QUIRK_NO_PIPELINED_DNLOAD:	Device stalls when download chunks are queued
+ * @DFU_DEVICE_QUIRK_PARALLEL_TARGETS:		Targets are independent and can be interleaved
  *
  * The workarounds for different devices.
  **/
@@ -75,6 +77,8 @@ typedef enum {
 	DFU_DEVICE_QUIRK_NO_DFU_RUNTIME		= (1 << 6),
 	DFU_DEVICE_QUIRK_ATTACH_UPLOAD_DOWNLOAD	= (1 << 7),
 	DFU_DEVICE_QUIRK_IGNORE_RUNTIME		= (1 << 8),
+	DFU_DEVICE_QUIRK_NO_PIPELINED_DNLOAD	= (1 << 9),
+	DFU_DEVICE_QUIRK_PARALLEL_TARGETS	= (1 << 10),
 	/*< private >*/
 	DFU_DEVICE_QUIRK_LAST
 } DfuDeviceQuirks;
@@ -161,6 +165,23 @@ gboolean	 dfu_device_download			(DfuDevice	*device,
 							 DfuTargetTransferFlags flags,
 							 GCancellable	*cancellable,
 							 GError		**error);
+void		 dfu_device_upload_async		(DfuDevice	*device,
+							 DfuTargetTransferFlags flags,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 user_data);
+DfuFirmware	*dfu_device_upload_finish		(DfuDevice	*device,
+							 GAsyncResult	*res,
+							 GError		**error);
+void		 dfu_device_download_async		(DfuDevice	*device,
+							 DfuFirmware	*firmware,
+							 DfuTargetTransferFlags flags,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 user_data);
+gboolean	 dfu_device_download_finish		(DfuDevice	*device,
+							 GAsyncResult	*res,
+							 GError		**error);
 gboolean	 dfu_device_refresh			(DfuDevice	*device,
 							 GCancellable	*cancellable,
 							 GError		**error);
@@ -191,6 +212,9 @@ gboolean	 dfu_device_has_quirk			(DfuDevice	*device,
 
 void		 dfu_device_set_transfer_size		(DfuDevice	*device,
 							 guint16	 transfer_size);
+gboolean	 dfu_device_probe_transfer_size		(DfuDevice	*device,
+							 GCancellable	*cancellable,
+							 GError		**error);
 void		 dfu_device_set_timeout			(DfuDevice	*device,
 							 guint		 timeout_ms);
 
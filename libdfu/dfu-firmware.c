@@ -53,6 +53,8 @@ typedef struct {
 	GHashTable		*metadata;
 	GHashTable		*symtab;
 	GPtrArray		*images;
+	GHashTable		*images_by_alt;	/* of alt_setting : DfuImage */
+	GHashTable		*images_by_name;/* of name : DfuImage */
 	guint16			 vid;
 	guint16			 pid;
 	guint16			 release;
@@ -78,6 +80,8 @@ dfu_firmware_init (DfuFirmware *firmware)
 	priv->pid = 0xffff;
 	priv->release = 0xffff;
 	priv->images = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	priv->images_by_alt = g_hash_table_new (g_direct_hash, g_direct_equal);
+	priv->images_by_name = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 	priv->metadata = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 	priv->symtab = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 }
@@ -89,6 +93,8 @@ dfu_firmware_finalize (GObject *object)
 	DfuFirmwarePrivate *priv = GET_PRIVATE (firmware);
 
 	g_ptr_array_unref (priv->images);
+	g_hash_table_destroy (priv->images_by_alt);
+	g_hash_table_destroy (priv->images_by_name);
 	g_hash_table_destroy (priv->metadata);
 	g_hash_table_destroy (priv->symtab);
 
@@ -132,7 +138,14 @@ dfu_firmware_get_image (DfuFirmware *firmware, guint8 alt_setting)
 
 	g_return_val_if_fail (DFU_IS_FIRMWARE (firmware), NULL);
 
-	/* find correct image */
+	/* the index is kept in sync by dfu_firmware_add_image */
+	im = g_hash_table_lookup (priv->images_by_alt,
+				  GUINT_TO_POINTER ((guint) alt_setting));
+	if (im != NULL)
+		return im;
+
+	/* fall back to scanning in case the alt setting changed after the
+	 * image was added */
 	for (i = 0; i < priv->images->len; i++) {
 		im = g_ptr_array_index (priv->images, i);
 		if (dfu_image_get_alt_setting (im) == alt_setting)
@@ -161,7 +174,15 @@ dfu_firmware_get_image_by_name (DfuFirmware *firmware, const gchar *name)
 
 	g_return_val_if_fail (DFU_IS_FIRMWARE (firmware), NULL);
 
-	/* find correct image */
+	/* the index is kept in sync by dfu_firmware_add_image */
+	if (name != NULL) {
+		im = g_hash_table_lookup (priv->images_by_name, name);
+		if (im != NULL)
+			return im;
+	}
+
+	/* fall back to scanning in case the name changed after the image
+	 * was added */
 	for (i = 0; i < priv->images->len; i++) {
 		im = g_ptr_array_index (priv->images, i);
 		if (g_strcmp0 (dfu_image_get_name (im), name) == 0)
@@ -248,9 +269,20 @@ void
 dfu_firmware_add_image (DfuFirmware *firmware, DfuImage *image)
 {
 	DfuFirmwarePrivate *priv = GET_PRIVATE (firmware);
+	const gchar *name;
 	g_return_if_fail (DFU_IS_FIRMWARE (firmware));
 	g_return_if_fail (DFU_IS_IMAGE (image));
 	g_ptr_array_add (priv->images, g_object_ref (image));
+
+	/* index the borrowed reference for the target-matching lookups */
+	g_hash_table_insert (priv->images_by_alt,
+			     GUINT_TO_POINTER ((guint) dfu_image_get_alt_setting (image)),
+			     image);
+	name = dfu_image_get_name (image);
+	if (name != NULL && name[0] != '\0') {
+		g_hash_table_insert (priv->images_by_name,
+				     g_strdup (name), image);
+	}
 }
 
 /**
@@ -531,6 +563,7 @@ dfu_firmware_parse_file (DfuFirmware *firmware, GFile *file,
 	gchar *contents = NULL;
 	gsize length = 0;
 	g_autofree gchar *basename = NULL;
+	g_autofree gchar *fn = NULL;
 	g_autoptr(GBytes) bytes = NULL;
 
 	g_return_val_if_fail (DFU_IS_FIRMWARE (firmware), FALSE);
@@ -542,6 +575,24 @@ dfu_firmware_parse_file (DfuFirmware *firmware, GFile *file,
 	if (g_str_has_suffix (basename, ".xdfu"))
 		priv->cipher_kind = DFU_CIPHER_KIND_XTEA;
 
+	/* map the file rather than copying it onto the heap; the format
+	 * parsers only take zero-copy slices of the data, so a large raw
+	 * image is never duplicated in RAM */
+	fn = g_file_get_path (file);
+	if (fn != NULL) {
+		g_autoptr(GError) error_local = NULL;
+		GMappedFile *mmap = g_mapped_file_new (fn, FALSE, &error_local);
+		if (mmap != NULL) {
+			bytes = g_mapped_file_get_bytes (mmap);
+			g_mapped_file_unref (mmap);
+			return dfu_firmware_parse_data (firmware, bytes,
+							flags, error);
+		}
+		g_debug ("failed to map %s, falling back to read: %s",
+			 fn, error_local->message);
+	}
+
+	/* non-native file, or mapping failed */
 	if (!g_file_load_contents (file, cancellable, &contents,
 				   &length, NULL, error))
 		return FALSE;
@@ -602,6 +653,22 @@ dfu_firmware_set_metadata (DfuFirmware *firmware, const gchar *key, const gchar
 	g_hash_table_insert (priv->metadata, g_strdup (key), g_strdup (value));
 }
 
+/**
+ * dfu_firmware_set_metadata_take: (skip)
+ * @firmware: a #DfuFirmware
+ * @key: (transfer full): metadata string key
+ * @value: (transfer full): metadata string value
+ *
+ * Sets a metadata value, taking ownership of both strings so the parse
+ * path does not have to duplicate them again.
+ **/
+void
+dfu_firmware_set_metadata_take (DfuFirmware *firmware, gchar *key, gchar *value)
+{
+	DfuFirmwarePrivate *priv = GET_PRIVATE (firmware);
+	g_hash_table_insert (priv->metadata, key, value);
+}
+
 /**
  * dfu_firmware_remove_metadata:
  * @firmware: a #DfuFirmware
@@ -705,6 +772,61 @@ dfu_firmware_write_data (DfuFirmware *firmware, GError **error)
 	return NULL;
 }
 
+/**
+ * dfu_firmware_write_stream:
+ * @firmware: a #DfuFirmware
+ * @stream: a #GOutputStream
+ * @cancellable: a #GCancellable, or %NULL
+ * @error: a #GError, or %NULL
+ *
+ * Writes DFU data to an output stream. Intel HEX records are emitted
+ * through a fixed-size buffer so the whole ASCII image is never resident
+ * in memory; other formats are packed in memory first.
+ *
+ * Return value: %TRUE for success
+ *
+ * Since: 0.9.5
+ **/
+gboolean
+dfu_firmware_write_stream (DfuFirmware *firmware, GOutputStream *stream,
+			   GCancellable *cancellable, GError **error)
+{
+	DfuFirmwarePrivate *priv = GET_PRIVATE (firmware);
+	const guint8 *data;
+	gsize length = 0;
+	g_autoptr(GBytes) bytes = NULL;
+
+	g_return_val_if_fail (DFU_IS_FIRMWARE (firmware), FALSE);
+	g_return_val_if_fail (G_IS_OUTPUT_STREAM (stream), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* at least one image */
+	if (priv->images == 0) {
+		g_set_error_literal (error,
+				     DFU_ERROR,
+				     DFU_ERROR_INTERNAL,
+				     "no image data to write");
+		return FALSE;
+	}
+
+	/* does the format support this many images */
+	if (!dfu_firmware_check_acceptable_for_format (firmware, error))
+		return FALSE;
+
+	/* Intel HEX can stream with bounded memory */
+	if (priv->format == DFU_FIRMWARE_FORMAT_INTEL_HEX)
+		return dfu_firmware_to_ihex_stream (firmware, stream,
+						    cancellable, error);
+
+	/* pack in memory and write out */
+	bytes = dfu_firmware_write_data (firmware, error);
+	if (bytes == NULL)
+		return FALSE;
+	data = g_bytes_get_data (bytes, &length);
+	return g_output_stream_write_all (stream, data, length,
+					  NULL, cancellable, error);
+}
+
 /**
  * dfu_firmware_write_file:
  * @firmware: a #DfuFirmware
@@ -722,30 +844,25 @@ gboolean
 dfu_firmware_write_file (DfuFirmware *firmware, GFile *file,
 			 GCancellable *cancellable, GError **error)
 {
-	const guint8 *data;
-	gsize length = 0;
-	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GFileOutputStream) ostream = NULL;
 
 	g_return_val_if_fail (DFU_IS_FIRMWARE (firmware), FALSE);
 	g_return_val_if_fail (G_IS_FILE (file), FALSE);
 	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
-	/* get blob */
-	bytes = dfu_firmware_write_data (firmware, error);
-	if (bytes == NULL)
+	/* stream to the file, which writes to a temporary file and renames
+	 * over the target on close just like g_file_replace_contents() */
+	ostream = g_file_replace (file, NULL, FALSE,
+				  G_FILE_CREATE_NONE,
+				  cancellable, error);
+	if (ostream == NULL)
 		return FALSE;
-
-	/* save to firmware */
-	data = g_bytes_get_data (bytes, &length);
-	return g_file_replace_contents (file,
-					(const gchar *) data,
-					length,
-					NULL,
-					FALSE,
-					G_FILE_CREATE_NONE,
-					NULL,
-					cancellable,
-					error);
+	if (!dfu_firmware_write_stream (firmware,
+					G_OUTPUT_STREAM (ostream),
+					cancellable, error))
+		return FALSE;
+	return g_output_stream_close (G_OUTPUT_STREAM (ostream),
+				      cancellable, error);
 }
 
 /**
@@ -55,6 +55,7 @@ struct _DfuFirmwareClass
  * @DFU_FIRMWARE_PARSE_FLAG_NO_CRC_TEST:		Do not verify the CRC
  * @DFU_FIRMWARE_PARSE_FLAG_NO_VERSION_TEST:		Do not verify the DFU version
  * @DFU_FIRMWARE_PARSE_FLAG_NO_METADATA:		Do not read the metadata table
+ * @DFU_FIRMWARE_PARSE_FLAG_SPARSE_HOLES:		Skip runs of the erase value in raw images
  *
  * The optional flags used for parsing.
  **/
@@ -63,6 +64,7 @@ typedef enum {
 	DFU_FIRMWARE_PARSE_FLAG_NO_CRC_TEST		= (1 << 0),
 	DFU_FIRMWARE_PARSE_FLAG_NO_VERSION_TEST		= (1 << 1),
 	DFU_FIRMWARE_PARSE_FLAG_NO_METADATA		= (1 << 2),
+	DFU_FIRMWARE_PARSE_FLAG_SPARSE_HOLES		= (1 << 3),
 	/*< private >*/
 	DFU_FIRMWARE_PARSE_FLAG_LAST
 } DfuFirmwareParseFlags;
@@ -132,6 +134,10 @@ gboolean	 dfu_firmware_parse_file	(DfuFirmware	*firmware,
 
 GBytes		*dfu_firmware_write_data	(DfuFirmware	*firmware,
 						 GError		**error);
+gboolean	 dfu_firmware_write_stream	(DfuFirmware	*firmware,
+						 GOutputStream	*stream,
+						 GCancellable	*cancellable,
+						 GError		**error);
 gboolean	 dfu_firmware_write_file	(DfuFirmware	*firmware,
 						 GFile		*file,
 						 GCancellable	*cancellable,
@@ -144,6 +150,9 @@ const gchar	*dfu_firmware_get_metadata	(DfuFirmware	*firmware,
 void		 dfu_firmware_set_metadata	(DfuFirmware	*firmware,
 						 const gchar	*key,
 						 const gchar	*value);
+void		 dfu_firmware_set_metadata_take	(DfuFirmware	*firmware,
+						 gchar		*key,
+						 gchar		*value);
 void		 dfu_firmware_remove_metadata	(DfuFirmware	*firmware,
 						 const gchar	*key);
 
@@ -36,8 +36,9 @@ typedef struct __attribute__((packed)) {
 
 /**
  * dfu_element_from_dfuse: (skip)
- * @data: data buffer
- * @length: length of @data we can access
+ * @bytes: the whole DfuSe blob
+ * @offset: offset into @bytes where the element starts
+ * @length: length of @bytes we can access
  * @consumed: (out): the number of bytes we consued
  * @error: a #GError, or %NULL
  *
@@ -46,13 +47,15 @@ typedef struct __attribute__((packed)) {
  * Returns: a #DfuElement, or %NULL for error
  **/
 static DfuElement *
-dfu_element_from_dfuse (const guint8 *data,
+dfu_element_from_dfuse (GBytes *bytes,
+			guint32 offset,
 			guint32 length,
 			guint32 *consumed,
 			GError **error)
 {
 	DfuElement *element = NULL;
-	DfuSeElementPrefix *el = (DfuSeElementPrefix *) data;
+	DfuSeElementPrefix *el;
+	const guint8 *data;
 	guint32 size;
 	g_autoptr(GBytes) contents = NULL;
 
@@ -69,6 +72,8 @@ dfu_element_from_dfuse (const guint8 *data,
 	}
 
 	/* check size */
+	data = (const guint8 *) g_bytes_get_data (bytes, NULL) + offset;
+	el = (DfuSeElementPrefix *) data;
 	size = GUINT32_FROM_LE (el->size);
 	if (size + sizeof(DfuSeElementPrefix) > length) {
 		g_set_error (error,
@@ -80,10 +85,13 @@ dfu_element_from_dfuse (const guint8 *data,
 		return NULL;
 	}
 
-	/* create new element */
+	/* create new element, slicing the parent blob rather than copying
+	 * so parsing stays O(elements) in allocations */
 	element = dfu_element_new ();
 	dfu_element_set_address (element, GUINT32_FROM_LE (el->address));
-	contents = g_bytes_new (data + sizeof(DfuSeElementPrefix), size);
+	contents = g_bytes_new_from_bytes (bytes,
+					   offset + sizeof(DfuSeElementPrefix),
+					   size);
 	dfu_element_set_contents (element, contents);
 
 	/* return size */
@@ -131,8 +139,9 @@ typedef struct __attribute__((packed)) {
 
 /**
  * dfu_image_from_dfuse: (skip)
- * @data: data buffer
- * @length: length of @data we can access
+ * @bytes: the whole DfuSe blob
+ * @offset_start: offset into @bytes where the image starts
+ * @length: length of @bytes we can access
  * @consumed: (out): the number of bytes we consued
  * @error: a #GError, or %NULL
  *
@@ -141,12 +150,14 @@ typedef struct __attribute__((packed)) {
  * Returns: a #DfuImage, or %NULL for error
  **/
 static DfuImage *
-dfu_image_from_dfuse (const guint8 *data,
+dfu_image_from_dfuse (GBytes *bytes,
+		      guint32 offset_start,
 		      guint32 length,
 		      guint32 *consumed,
 		      GError **error)
 {
 	DfuSeImagePrefix *im;
+	const guint8 *data;
 	guint32 elements;
 	guint32 offset = sizeof(DfuSeImagePrefix);
 	guint j;
@@ -165,6 +176,7 @@ dfu_image_from_dfuse (const guint8 *data,
 	}
 
 	/* verify image signature */
+	data = (const guint8 *) g_bytes_get_data (bytes, NULL) + offset_start;
 	im = (DfuSeImagePrefix *) data;
 	if (memcmp (im->sig, "Target", 6) != 0) {
 		g_set_error_literal (error,
@@ -186,7 +198,9 @@ dfu_image_from_dfuse (const guint8 *data,
 	for (j = 0; j < elements; j++) {
 		guint32 consumed_local;
 		g_autoptr(DfuElement) element = NULL;
-		element = dfu_element_from_dfuse (data + offset, length,
+		element = dfu_element_from_dfuse (bytes,
+						  offset_start + offset,
+						  length,
 						  &consumed_local, error);
 		if (element == NULL)
 			return NULL;
@@ -390,7 +404,7 @@ dfu_firmware_from_dfuse (DfuFirmware *firmware,
 	for (i = 0; i < prefix->targets; i++) {
 		guint consumed;
 		g_autoptr(DfuImage) image = NULL;
-		image = dfu_image_from_dfuse (data + offset, (guint32) len,
+		image = dfu_image_from_dfuse (bytes, offset, (guint32) len,
 					      &consumed, error);
 		if (image == NULL)
 			return FALSE;
@@ -66,87 +66,57 @@ dfu_firmware_detect_elf (GBytes *bytes)
 
 #ifdef HAVE_LIBELF
 static DfuElement *
-_get_element_from_section_name (Elf *e, const gchar *desired_name)
+dfu_format_elf_element_from_scn (Elf_Scn *scn, GElf_Shdr *shdr, GBytes *blob)
 {
-	DfuElement *element = NULL;
-	Elf_Scn *scn = NULL;
-	GElf_Shdr shdr;
-	const gchar *name;
-	size_t shstrndx;
+	DfuElement *element;
+	Elf_Data *data;
+	const guint8 *buf;
+	gsize bufsz = 0;
+	g_autoptr(GBytes) bytes = NULL;
 
-	if (elf_getshdrstrndx (e, &shstrndx) != 0) {
-		g_warning ("failed elf_getshdrstrndx");
+	data = elf_getdata (scn, NULL);
+	if (data == NULL || data->d_buf == NULL)
 		return NULL;
-	}
-	while ((scn = elf_nextscn (e, scn)) != NULL ) {
-		if (gelf_getshdr (scn, &shdr ) != & shdr) {
-			g_warning ("failed gelf_getshdr");
-			continue;
-		}
 
-		/* not program data */
-		if (shdr.sh_type != SHT_PROGBITS)
-			continue;
-
-		/* not the same section name */
-		if ((name = elf_strptr (e, shstrndx, shdr.sh_name)) == NULL) {
-			g_warning ("failed elf_strptr");
-			continue;
-		}
-		if (g_strcmp0 (name, desired_name) == 0) {
-			Elf_Data *data = elf_getdata (scn, NULL);
-			if (data != NULL && data->d_buf != NULL) {
-				g_autoptr(GBytes) bytes = NULL;
-				bytes = g_bytes_new (data->d_buf, data->d_size);
-				element = dfu_element_new ();
-				dfu_element_set_contents (element, bytes);
-				dfu_element_set_address (element, shdr.sh_addr);
-			}
-			break;
-		}
+	/* where libelf points straight into the input image, slice the
+	 * (possibly mapped) file rather than copying the section data */
+	buf = g_bytes_get_data (blob, &bufsz);
+	if ((const guint8 *) data->d_buf >= buf &&
+	    (const guint8 *) data->d_buf + data->d_size <= buf + bufsz) {
+		bytes = g_bytes_new_from_bytes (blob,
+						(gsize) ((const guint8 *) data->d_buf - buf),
+						data->d_size);
+	} else {
+		bytes = g_bytes_new (data->d_buf, data->d_size);
 	}
+	element = dfu_element_new ();
+	dfu_element_set_contents (element, bytes);
+	dfu_element_set_address (element, shdr->sh_addr);
 	return element;
 }
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(Elf, elf_end);
 
 static void
-dfu_format_elf_symbols_from_symtab (DfuFirmware *firmware, Elf *e)
+dfu_format_elf_symbols_from_scn (DfuFirmware *firmware, Elf *e,
+				 Elf_Scn *scn, GElf_Shdr *shdr)
 {
-	Elf_Scn *scn = NULL;
-	gsize shstrndx;
-
-	if (elf_getshdrstrndx (e, &shstrndx) != 0) {
-		g_warning ("failed elf_getshdrstrndx");
-		return;
-	}
-	while ((scn = elf_nextscn (e, scn)) != NULL ) {
-		Elf_Data *data;
-		GElf_Shdr shdr;
-		const gchar *name;
-		gssize ns;
-		if (gelf_getshdr (scn, &shdr) != &shdr) {
-			g_warning ("failed gelf_getshdr");
+	Elf_Data *data;
+	const gchar *name;
+	gssize ns;
+
+	/* get symbols */
+	data = elf_getdata (scn, NULL);
+	ns = shdr->sh_size / shdr->sh_entsize;
+	for (gint i = 0; i < ns; i++) {
+		GElf_Sym sym;
+		gelf_getsym (data, i, &sym);
+		if (sym.st_value == 0)
 			continue;
-		}
-
-		/* not program data */
-		if (shdr.sh_type != SHT_SYMTAB)
+		name = elf_strptr (e, shdr->sh_link, sym.st_name);
+		if (name == NULL)
 			continue;
-
-		/* get symbols */
-		data = elf_getdata (scn, NULL);
-		ns = shdr.sh_size / shdr.sh_entsize;
-		for (gint i = 0; i < ns; i++) {
-			GElf_Sym sym;
-                        gelf_getsym (data, i, &sym);
-			if (sym.st_value == 0)
-				continue;
-			name = elf_strptr (e, shdr.sh_link, sym.st_name);
-			if (name == NULL)
-				continue;
-			dfu_firmware_add_symbol (firmware, name, sym.st_value);
-		}
+		dfu_firmware_add_symbol (firmware, name, sym.st_value);
 	}
 }
 #endif
@@ -169,8 +139,9 @@ dfu_firmware_from_elf (DfuFirmware *firmware,
 		       GError **error)
 {
 #ifdef HAVE_LIBELF
-	guint i;
+	Elf_Scn *scn = NULL;
 	guint sections_cnt = 0;
+	size_t shstrndx;
 	g_autoptr(Elf) e = NULL;
 	const gchar *section_names[] = {
 		".interrupt",
@@ -209,23 +180,54 @@ dfu_firmware_from_elf (DfuFirmware *firmware,
 	g_debug ("loading %ib ELF object" ,
 		 gelf_getclass (e) == ELFCLASS32 ? 32 : 64);
 
-	/* add interesting sections as the image */
-	for (i = 0; section_names[i] != NULL; i++) {
+	/* walk the section index just once, skipping anything that is not
+	 * resident on the device before even looking up the name -- debug
+	 * info can be several times the size of the flashable payload */
+	if (elf_getshdrstrndx (e, &shstrndx) != 0) {
+		g_set_error (error,
+			     DFU_ERROR,
+			     DFU_ERROR_INTERNAL,
+			     "failed elf_getshdrstrndx: %s",
+			     elf_errmsg (-1));
+		return FALSE;
+	}
+	while ((scn = elf_nextscn (e, scn)) != NULL) {
+		GElf_Shdr shdr;
+		const gchar *name;
 		g_autoptr(DfuElement) element = NULL;
 		g_autoptr(DfuImage) image = NULL;
-		element = _get_element_from_section_name (e, section_names[i]);
+		if (gelf_getshdr (scn, &shdr) != &shdr) {
+			g_warning ("failed gelf_getshdr");
+			continue;
+		}
+
+		/* load the symbol table */
+		if (shdr.sh_type == SHT_SYMTAB) {
+			dfu_format_elf_symbols_from_scn (firmware, e, scn, &shdr);
+			continue;
+		}
+
+		/* only program data that is actually loaded is interesting */
+		if (shdr.sh_type != SHT_PROGBITS)
+			continue;
+		if ((shdr.sh_flags & SHF_ALLOC) == 0)
+			continue;
+		if ((name = elf_strptr (e, shstrndx, shdr.sh_name)) == NULL) {
+			g_warning ("failed elf_strptr");
+			continue;
+		}
+		if (!g_strv_contains ((const gchar * const *) section_names, name))
+			continue;
+		element = dfu_format_elf_element_from_scn (scn, &shdr, bytes);
 		if (element == NULL)
 			continue;
 		image = dfu_image_new ();
 		dfu_image_add_element (image, element);
-		dfu_image_set_name (image, section_names[i]);
+		dfu_image_set_name (image, name);
 		dfu_firmware_add_image (firmware, image);
 		sections_cnt++;
 	}
 
-	/* load symbol table */
-	dfu_format_elf_symbols_from_symtab (firmware, e);
-
 	/* nothing found */
 	if (sections_cnt == 0) {
 		g_set_error_literal (error,
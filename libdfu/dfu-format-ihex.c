@@ -50,22 +50,31 @@ dfu_firmware_detect_ihex (GBytes *bytes)
 	return DFU_FIRMWARE_FORMAT_INTEL_HEX;
 }
 
+/* maps an ASCII hex digit to its value, with zero for anything else;
+ * this matches what g_ascii_strtoull() returned for garbage input but
+ * avoids a memcpy and a strtoull call for every single byte parsed */
+static const guint8 dfu_firmware_ihex_nibble_lut[256] = {
+	['0'] = 0x0, ['1'] = 0x1, ['2'] = 0x2, ['3'] = 0x3,
+	['4'] = 0x4, ['5'] = 0x5, ['6'] = 0x6, ['7'] = 0x7,
+	['8'] = 0x8, ['9'] = 0x9,
+	['a'] = 0xa, ['b'] = 0xb, ['c'] = 0xc,
+	['d'] = 0xd, ['e'] = 0xe, ['f'] = 0xf,
+	['A'] = 0xa, ['B'] = 0xb, ['C'] = 0xc,
+	['D'] = 0xd, ['E'] = 0xe, ['F'] = 0xf,
+};
+
 static guint8
 dfu_firmware_ihex_parse_uint8 (const gchar *data, guint pos)
 {
-	gchar buffer[3];
-	memcpy (buffer, data + pos, 2);
-	buffer[2] = '\0';
-	return (guint8) g_ascii_strtoull (buffer, NULL, 16);
+	return (guint8) ((dfu_firmware_ihex_nibble_lut[(guint8) data[pos]] << 4) |
+			 dfu_firmware_ihex_nibble_lut[(guint8) data[pos+1]]);
 }
 
 static guint16
 dfu_firmware_ihex_parse_uint16 (const gchar *data, guint pos)
 {
-	gchar buffer[5];
-	memcpy (buffer, data + pos, 4);
-	buffer[4] = '\0';
-	return (guint16) g_ascii_strtoull (buffer, NULL, 16);
+	return (guint16) ((dfu_firmware_ihex_parse_uint8 (data, pos) << 8) |
+			  dfu_firmware_ihex_parse_uint8 (data, pos + 2));
 }
 
 #define	DFU_INHX32_RECORD_TYPE_DATA		0x00
@@ -128,9 +137,11 @@ dfu_firmware_from_ihex (DfuFirmware *firmware,
 	dfu_image_set_name (image, "ihex");
 	element = dfu_element_new ();
 
-	/* parse records */
+	/* parse records; each data byte is two chars of input, so half the
+	 * file size is an upper bound for the contents and lets us allocate
+	 * the output buffer just once */
 	in_buffer = g_bytes_get_data (bytes, &len_in);
-	string = g_string_new ("");
+	string = g_string_sized_new (len_in / 2);
 	while (offset < len_in) {
 
 		/* check starting token */
@@ -318,9 +329,88 @@ dfu_firmware_from_ihex (DfuFirmware *firmware,
 	return TRUE;
 }
 
-static void
-dfu_firmware_to_ihex_bytes (GString *str, guint8 record_type,
-			    guint32 address, GBytes *contents)
+/* accumulates output in a fixed-size buffer so the whole ASCII image is
+ * never resident in memory at once */
+typedef struct {
+	GOutputStream	*stream;	/* not refcounted */
+	GCancellable	*cancellable;	/* not refcounted */
+	gsize		 buf_len;
+	gchar		 buf[0x10000];
+} DfuFirmwareIhexWriter;
+
+static gboolean
+dfu_firmware_ihex_writer_flush (DfuFirmwareIhexWriter *writer, GError **error)
+{
+	if (writer->buf_len == 0)
+		return TRUE;
+	if (!g_output_stream_write_all (writer->stream,
+					writer->buf,
+					writer->buf_len,
+					NULL,
+					writer->cancellable,
+					error))
+		return FALSE;
+	writer->buf_len = 0;
+	return TRUE;
+}
+
+static gboolean
+dfu_firmware_ihex_writer_write (DfuFirmwareIhexWriter *writer,
+				const gchar *data,
+				gsize len,
+				GError **error)
+{
+	if (writer->buf_len + len > sizeof(writer->buf)) {
+		if (!dfu_firmware_ihex_writer_flush (writer, error))
+			return FALSE;
+	}
+	memcpy (writer->buf + writer->buf_len, data, len);
+	writer->buf_len += len;
+	return TRUE;
+}
+
+static gsize
+dfu_firmware_ihex_emit_uint8 (gchar *record, gsize n, guint8 val)
+{
+	const gchar hexdigits[] = "0123456789ABCDEF";
+	record[n] = hexdigits[val >> 4];
+	record[n + 1] = hexdigits[val & 0xf];
+	return n + 2;
+}
+
+static gboolean
+dfu_firmware_ihex_writer_record (DfuFirmwareIhexWriter *writer,
+				 guint8 record_type,
+				 guint32 address,
+				 const guint8 *data,
+				 gsize data_len,
+				 GError **error)
+{
+	gchar record[48];
+	gsize n = 0;
+	guint8 checksum = 0;
+
+	/* length, 16-bit address, type, data */
+	record[n++] = ':';
+	n = dfu_firmware_ihex_emit_uint8 (record, n, (guint8) data_len);
+	n = dfu_firmware_ihex_emit_uint8 (record, n, (guint8) (address >> 8));
+	n = dfu_firmware_ihex_emit_uint8 (record, n, (guint8) address);
+	n = dfu_firmware_ihex_emit_uint8 (record, n, record_type);
+	for (gsize i = 0; i < data_len; i++)
+		n = dfu_firmware_ihex_emit_uint8 (record, n, data[i]);
+
+	/* add checksum -- this has historically covered the ASCII characters
+	 * rather than the decoded values, and is preserved bit-for-bit */
+	for (gsize i = 1; i < n; i++)
+		checksum += (guint8) record[i];
+	n = dfu_firmware_ihex_emit_uint8 (record, n, checksum);
+	record[n++] = '\n';
+	return dfu_firmware_ihex_writer_write (writer, record, n, error);
+}
+
+static gboolean
+dfu_firmware_to_ihex_bytes (DfuFirmwareIhexWriter *writer, guint8 record_type,
+			    guint32 address, GBytes *contents, GError **error)
 {
 	const guint8 *data;
 	const guint chunk_size = 16;
@@ -329,37 +419,31 @@ dfu_firmware_to_ihex_bytes (GString *str, guint8 record_type,
 	/* get number of chunks */
 	data = g_bytes_get_data (contents, &len);
 	for (gsize i = 0; i < len; i += chunk_size) {
-		guint8 checksum = 0;
-
-		/* length, 16-bit address, type */
 		gsize chunk_len = MIN (len - i, 16);
-		g_string_append_printf (str, ":%02X%04X%02X",
-					(guint) chunk_len,
-					(guint) (address + i),
-					(guint) record_type);
-		for (gsize j = 0; j < chunk_len; j++)
-			g_string_append_printf (str, "%02X", data[i+j]);
-
-		/* add checksum */
-		for (gsize j = 0; j < (chunk_len * 2) + 8; j++)
-			checksum += (guint8) str->str[str->len - (j + 1)];
-		g_string_append_printf (str, "%02X\n", checksum);
+		if (!dfu_firmware_ihex_writer_record (writer,
+						      record_type,
+						      address + (guint32) i,
+						      data + i,
+						      chunk_len,
+						      error))
+			return FALSE;
 	}
+	return TRUE;
 }
 
 static gboolean
-dfu_firmware_to_ihex_element (DfuElement *element, GString *str,
+dfu_firmware_to_ihex_element (DfuElement *element, DfuFirmwareIhexWriter *writer,
 			      guint8 record_type, GError **error)
 {
 	GBytes *contents = dfu_element_get_contents (element);
-	dfu_firmware_to_ihex_bytes (str, record_type,
-				    dfu_element_get_address (element),
-				    contents);
-	return TRUE;
+	return dfu_firmware_to_ihex_bytes (writer, record_type,
+					   dfu_element_get_address (element),
+					   contents, error);
 }
 
 static gboolean
-dfu_firmware_to_ihex_image (DfuImage *image, GString *str, GError **error)
+dfu_firmware_to_ihex_image (DfuImage *image, DfuFirmwareIhexWriter *writer,
+			    GError **error)
 {
 	GPtrArray *elements;
 	guint8 record_type = DFU_INHX32_RECORD_TYPE_DATA;
@@ -370,7 +454,7 @@ dfu_firmware_to_ihex_image (DfuImage *image, GString *str, GError **error)
 	for (guint i = 0; i < elements->len; i++) {
 		DfuElement *element = g_ptr_array_index (elements, i);
 		if (!dfu_firmware_to_ihex_element (element,
-						   str,
+						   writer,
 						   record_type,
 						   error))
 			return FALSE;
@@ -379,33 +463,42 @@ dfu_firmware_to_ihex_image (DfuImage *image, GString *str, GError **error)
 }
 
 /**
- * dfu_firmware_to_ihex: (skip)
+ * dfu_firmware_to_ihex_stream: (skip)
  * @firmware: a #DfuFirmware
+ * @stream: a #GOutputStream
+ * @cancellable: a #GCancellable, or %NULL
  * @error: a #GError, or %NULL
  *
- * Packs a IHEX firmware
+ * Packs a IHEX firmware to a stream, with the output buffered through a
+ * fixed 64 KB window rather than built up in memory.
  *
- * Returns: (transfer full): the packed data
+ * Returns: %TRUE for success
  **/
-GBytes *
-dfu_firmware_to_ihex (DfuFirmware *firmware, GError **error)
+gboolean
+dfu_firmware_to_ihex_stream (DfuFirmware *firmware,
+			     GOutputStream *stream,
+			     GCancellable *cancellable,
+			     GError **error)
 {
 	GPtrArray *images;
 	g_autoptr(GPtrArray) symbols = NULL;
-	g_autoptr(GString) str = NULL;
+	g_autofree DfuFirmwareIhexWriter *writer = NULL;
+
+	writer = g_new0 (DfuFirmwareIhexWriter, 1);
+	writer->stream = stream;
+	writer->cancellable = cancellable;
 
 	/* write all the element data */
-	str = g_string_new ("");
 	images = dfu_firmware_get_images (firmware);
 	for (guint i = 0; i < images->len; i++) {
 		DfuImage *image = g_ptr_array_index (images, i);
-		if (!dfu_firmware_to_ihex_image (image, str, error))
+		if (!dfu_firmware_to_ihex_image (image, writer, error))
 			return FALSE;
 	}
 
 	/* add EOF */
-	g_string_append_printf (str, ":000000%02XFF\n",
-				(guint) DFU_INHX32_RECORD_TYPE_EOF);
+	if (!dfu_firmware_ihex_writer_write (writer, ":00000001FF\n", 12, error))
+		return FALSE;
 
 	/* add any symbol table */
 	symbols = dfu_firmware_get_symbols (firmware);
@@ -413,9 +506,31 @@ dfu_firmware_to_ihex (DfuFirmware *firmware, GError **error)
 		const gchar *name = g_ptr_array_index (symbols, i);
 		guint32 addr = dfu_firmware_lookup_symbol (firmware, name);
 		g_autoptr(GBytes) contents = g_bytes_new_static (name, strlen (name));
-		dfu_firmware_to_ihex_bytes (str, DFU_INHX32_RECORD_TYPE_SYMTAB,
-					    addr, contents);
+		if (!dfu_firmware_to_ihex_bytes (writer, DFU_INHX32_RECORD_TYPE_SYMTAB,
+						 addr, contents, error))
+			return FALSE;
 	}
 
-	return g_bytes_new (str->str, str->len);
+	return dfu_firmware_ihex_writer_flush (writer, error);
+}
+
+/**
+ * dfu_firmware_to_ihex: (skip)
+ * @firmware: a #DfuFirmware
+ * @error: a #GError, or %NULL
+ *
+ * Packs a IHEX firmware
+ *
+ * Returns: (transfer full): the packed data
+ **/
+GBytes *
+dfu_firmware_to_ihex (DfuFirmware *firmware, GError **error)
+{
+	g_autoptr(GOutputStream) stream = NULL;
+	stream = g_memory_output_stream_new_resizable ();
+	if (!dfu_firmware_to_ihex_stream (firmware, stream, NULL, error))
+		return NULL;
+	if (!g_output_stream_close (stream, NULL, error))
+		return NULL;
+	return g_memory_output_stream_steal_as_bytes (G_MEMORY_OUTPUT_STREAM (stream));
 }
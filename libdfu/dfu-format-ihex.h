@@ -32,6 +32,10 @@ G_BEGIN_DECLS
 DfuFirmwareFormat	 dfu_firmware_detect_ihex	(GBytes		*bytes);
 GBytes			*dfu_firmware_to_ihex		(DfuFirmware	*firmware,
 							GError		**error);
+gboolean		 dfu_firmware_to_ihex_stream	(DfuFirmware	*firmware,
+							GOutputStream	*stream,
+							GCancellable	*cancellable,
+							GError		**error);
 gboolean		 dfu_firmware_from_ihex		(DfuFirmware	*firmware,
 							GBytes		*bytes,
 							DfuFirmwareParseFlags flags,
@@ -119,7 +119,11 @@ dfu_firmware_from_metadata (DfuFirmware *firmware,
 		}
 		value = g_strndup ((const gchar *) data + idx, kvlen);
 		idx += kvlen;
-		dfu_firmware_set_metadata (firmware, key, value);
+
+		/* the table owns the strings, no second copy is needed */
+		dfu_firmware_set_metadata_take (firmware,
+						g_steal_pointer (&key),
+						g_steal_pointer (&value));
 	}
 	return TRUE;
 }
@@ -42,6 +42,49 @@ dfu_firmware_detect_raw (GBytes *bytes)
 	return DFU_FIRMWARE_FORMAT_RAW;
 }
 
+/* NOR flash reads as 0xff when erased, which is also what vendors pad
+ * factory images with */
+#define DFU_RAW_ERASE_VALUE		0xff
+
+/* runs shorter than this are kept inline; skipping them saves less than
+ * the extra address-setup sequence costs */
+#define DFU_RAW_HOLE_MIN_SIZE		0x1000
+
+/**
+ * dfu_firmware_raw_hole_length:
+ * @data: image data
+ * @offset: where to start scanning
+ * @len: total size of @data
+ *
+ * Returns the length of the run of erase-value bytes starting at @offset,
+ * comparing a word at a time once aligned so a multi-megabyte pad costs
+ * one load per 8 bytes rather than per byte.
+ **/
+static gsize
+dfu_firmware_raw_hole_length (const guint8 *data, gsize offset, gsize len)
+{
+	guint64 pattern;
+	gsize i = offset;
+
+	/* bytewise until word aligned */
+	memset (&pattern, DFU_RAW_ERASE_VALUE, sizeof (pattern));
+	while (i < len && i % sizeof (pattern) != 0) {
+		if (data[i] != DFU_RAW_ERASE_VALUE)
+			return i - offset;
+		i++;
+	}
+
+	/* word-wide through the body of the run */
+	while (i + sizeof (pattern) <= len &&
+	       memcmp (data + i, &pattern, sizeof (pattern)) == 0)
+		i += sizeof (pattern);
+
+	/* bytewise tail */
+	while (i < len && data[i] == DFU_RAW_ERASE_VALUE)
+		i++;
+	return i - offset;
+}
+
 /**
  * dfu_firmware_from_raw: (skip)
  * @firmware: a #DfuFirmware
@@ -51,6 +94,12 @@ dfu_firmware_detect_raw (GBytes *bytes)
  *
  * Unpacks into a firmware object from raw data.
  *
+ * With %DFU_FIRMWARE_PARSE_FLAG_SPARSE_HOLES any large run of the erase
+ * value is treated as a hole: the image gets one element per data span,
+ * addressed by file offset, and the padding is never transferred. Small
+ * holes stay inline, and dfu_image_merge_elements() re-joins anything
+ * not worth a separate transfer sequence at download time.
+ *
  * Returns: %TRUE for success
  **/
 gboolean
@@ -62,6 +111,70 @@ dfu_firmware_from_raw (DfuFirmware *firmware,
 	g_autoptr(DfuElement) element = NULL;
 	g_autoptr(DfuImage) image = NULL;
 	image = dfu_image_new ();
+
+	/* carve the image into the spans between erase-value runs */
+	if (flags & DFU_FIRMWARE_PARSE_FLAG_SPARSE_HOLES) {
+		gsize len = 0;
+		gsize pos = 0;
+		gsize skipped = 0;
+		const guint8 *data = g_bytes_get_data (bytes, &len);
+		while (pos < len) {
+			gsize span_start = pos;
+			gsize span_end;
+
+			/* find the next hole big enough to be worth
+			 * splitting on */
+			for (;;) {
+				const guint8 *hit;
+				gsize hole;
+				hit = memchr (data + pos, DFU_RAW_ERASE_VALUE,
+					      len - pos);
+				if (hit == NULL) {
+					pos = len;
+					break;
+				}
+				pos = (gsize) (hit - data);
+				hole = dfu_firmware_raw_hole_length (data, pos, len);
+				if (hole >= DFU_RAW_HOLE_MIN_SIZE ||
+				    pos + hole == len) {
+					skipped += hole;
+					break;
+				}
+				pos += hole;
+			}
+			span_end = pos;
+			if (span_end > span_start) {
+				g_autoptr(DfuElement) element_tmp = NULL;
+				g_autoptr(GBytes) contents = NULL;
+				contents = g_bytes_new_from_bytes (bytes,
+								   span_start,
+								   span_end - span_start);
+				element_tmp = dfu_element_new ();
+				dfu_element_set_contents (element_tmp, contents);
+				dfu_element_set_address (element_tmp, (guint32) span_start);
+				dfu_image_add_element (image, element_tmp);
+			}
+
+			/* jump over the hole itself */
+			if (pos < len)
+				pos += dfu_firmware_raw_hole_length (data, pos, len);
+		}
+		if (dfu_image_get_elements (image)->len > 0) {
+			g_debug ("sparse raw image: %u elements, "
+				 "%" G_GSIZE_FORMAT " of %" G_GSIZE_FORMAT
+				 " bytes skipped as holes",
+				 dfu_image_get_elements (image)->len,
+				 skipped, len);
+			dfu_firmware_add_image (firmware, image);
+			return TRUE;
+		}
+
+		/* entirely the erase value; fall back to the dense element
+		 * so the caller still has something to flash */
+		g_debug ("raw image is all 0x%02x, not treating as sparse",
+			 (guint) DFU_RAW_ERASE_VALUE);
+	}
+
 	element = dfu_element_new ();
 	dfu_element_set_contents (element, bytes);
 	dfu_image_add_element (image, element);
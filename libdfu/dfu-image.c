@@ -233,6 +233,87 @@ dfu_image_add_element (DfuImage *image, DfuElement *element)
 	g_ptr_array_add (priv->elements, g_object_ref (element));
 }
 
+static gint
+dfu_image_element_sort_cb (gconstpointer a, gconstpointer b)
+{
+	DfuElement *element_a = *((DfuElement **) a);
+	DfuElement *element_b = *((DfuElement **) b);
+	if (dfu_element_get_address (element_a) <
+	    dfu_element_get_address (element_b))
+		return -1;
+	if (dfu_element_get_address (element_a) >
+	    dfu_element_get_address (element_b))
+		return 1;
+	return 0;
+}
+
+/**
+ * dfu_image_merge_elements:
+ * @image: a #DfuImage
+ * @max_gap: the maximum hole size in bytes that gets filled
+ * @fill: the value used to pad any holes, e.g. 0xff for NOR flash
+ *
+ * Sorts the elements by address and merges any that are separated by a
+ * hole of up to @max_gap bytes, padding the hole with @fill. Firmware
+ * imported from ihex or ELF often has many tiny regions, and each
+ * element costs a separate address-setup and transfer sequence when
+ * downloading.
+ *
+ * Since: 0.9.5
+ **/
+void
+dfu_image_merge_elements (DfuImage *image, guint32 max_gap, guint8 fill)
+{
+	DfuImagePrivate *priv = GET_PRIVATE (image);
+	DfuElement *element_last = NULL;
+	g_autoptr(GPtrArray) merged = NULL;
+
+	g_return_if_fail (DFU_IS_IMAGE (image));
+
+	/* nothing to merge */
+	if (priv->elements->len < 2)
+		return;
+
+	g_ptr_array_sort (priv->elements, dfu_image_element_sort_cb);
+	merged = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (guint i = 0; i < priv->elements->len; i++) {
+		DfuElement *element = g_ptr_array_index (priv->elements, i);
+		GBytes *contents = dfu_element_get_contents (element);
+		guint32 addr = dfu_element_get_address (element);
+
+		/* close enough to the previous element to join on */
+		if (element_last != NULL) {
+			GBytes *contents_last = dfu_element_get_contents (element_last);
+			guint32 end_last = dfu_element_get_address (element_last) +
+					   (guint32) g_bytes_get_size (contents_last);
+			if (addr >= end_last && addr - end_last <= max_gap) {
+				guint32 gap = addr - end_last;
+				g_autoptr(GByteArray) buf = g_byte_array_new ();
+				g_autoptr(GBytes) contents_new = NULL;
+				g_byte_array_append (buf,
+						     g_bytes_get_data (contents_last, NULL),
+						     g_bytes_get_size (contents_last));
+				for (guint32 j = 0; j < gap; j++)
+					g_byte_array_append (buf, &fill, 1);
+				g_byte_array_append (buf,
+						     g_bytes_get_data (contents, NULL),
+						     g_bytes_get_size (contents));
+				contents_new = g_byte_array_free_to_bytes (g_steal_pointer (&buf));
+				dfu_element_set_contents (element_last, contents_new);
+				g_debug ("merged element 0x%04x across 0x%x byte hole",
+					 (guint) addr, (guint) gap);
+				continue;
+			}
+		}
+		g_ptr_array_add (merged, g_object_ref (element));
+		element_last = element;
+	}
+	g_debug ("merged %u elements into %u",
+		 priv->elements->len, merged->len);
+	g_ptr_array_unref (priv->elements);
+	priv->elements = g_steal_pointer (&merged);
+}
+
 /**
  * dfu_image_set_alt_setting:
  * @image: a #DfuImage
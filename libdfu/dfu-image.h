@@ -58,6 +58,9 @@ guint8		 dfu_image_get_alt_setting	(DfuImage	*image);
 const gchar	*dfu_image_get_name		(DfuImage	*image);
 guint32		 dfu_image_get_size		(DfuImage	*image);
 
+void		 dfu_image_merge_elements	(DfuImage	*image,
+						 guint32	 max_gap,
+						 guint8		 fill);
 void		 dfu_image_add_element		(DfuImage	*image,
 						 DfuElement	*element);
 
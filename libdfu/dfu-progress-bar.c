@@ -40,10 +40,14 @@ struct _DfuProgressBar {
 	DfuProgressBarPulseState pulse_state;
 	gint			 tty_fd;
 	gchar			*old_start_text;
+	gchar			*old_draw_str;
+	guint			 refresh_rate;		/* Hz, 0 for unlimited */
+	gint64			 last_draw_time;
 };
 
 #define DFU_PROGRESS_BAR_PERCENTAGE_INVALID	101
 #define DFU_PROGRESS_BAR_PULSE_TIMEOUT		40 /* ms */
+#define DFU_PROGRESS_BAR_REFRESH_RATE_DEFAULT	20 /* Hz */
 
 G_DEFINE_TYPE (DfuProgressBar, dfu_progress_bar, G_TYPE_OBJECT)
 
@@ -61,6 +65,35 @@ dfu_progress_bar_console (DfuProgressBar *self, const gchar *tmp)
 	}
 }
 
+static void
+dfu_progress_bar_render (DfuProgressBar *self, const gchar *body)
+{
+	GString *str;
+	guint idx = 0;
+
+	/* pipelined downloads can deliver thousands of callbacks per second;
+	 * only send the cells that actually changed since the last render */
+	if (self->old_draw_str != NULL) {
+		while (self->old_draw_str[idx] != '\0' &&
+		       body[idx] != '\0' &&
+		       self->old_draw_str[idx] == body[idx])
+			idx++;
+		if (self->old_draw_str[idx] == '\0' && body[idx] == '\0')
+			return;
+	}
+
+	/* restore cursor, skip over the unchanged prefix, redraw the rest */
+	str = g_string_new ("");
+	g_string_append_printf (str, "%c8", 0x1B);
+	if (idx > 0)
+		g_string_append_printf (str, "%c[%uC", 0x1B, idx);
+	g_string_append (str, body + idx);
+	dfu_progress_bar_console (self, str->str);
+	g_string_free (str, TRUE);
+	g_free (self->old_draw_str);
+	self->old_draw_str = g_strdup (body);
+}
+
 void
 dfu_progress_bar_set_padding (DfuProgressBar *self, guint padding)
 {
@@ -88,11 +121,8 @@ dfu_progress_bar_draw (DfuProgressBar *self, gint percentage)
 	if (percentage == G_MININT)
 		return FALSE;
 
-	/* restore cursor */
-	str = g_string_new ("");
-	g_string_append_printf (str, "%c8", 0x1B);
-
 	section = (guint) ((gfloat) self->size / (gfloat) 100.0 * (gfloat) percentage);
+	str = g_string_new ("");
 	g_string_append (str, "[");
 	for (i = 0; i < section; i++)
 		g_string_append (str, "=");
@@ -103,7 +133,7 @@ dfu_progress_bar_draw (DfuProgressBar *self, gint percentage)
 		g_string_append_printf (str, "(%i%%)  ", percentage);
 	else
 		g_string_append (str, "        ");
-	dfu_progress_bar_console (self, str->str);
+	dfu_progress_bar_render (self, str->str);
 	g_string_free (str, TRUE);
 	return TRUE;
 }
@@ -114,10 +144,7 @@ dfu_progress_bar_pulse_bar (DfuProgressBar *self)
 	gint i;
 	g_autoptr(GString) str = NULL;
 
-	/* restore cursor */
 	str = g_string_new ("");
-	g_string_append_printf (str, "%c8", 0x1B);
-
 	if (self->pulse_state.move_forward) {
 		if (self->pulse_state.position == self->size - 1)
 			self->pulse_state.move_forward = FALSE;
@@ -141,7 +168,7 @@ dfu_progress_bar_pulse_bar (DfuProgressBar *self)
 		g_string_append_printf (str, "(%i%%)  ", self->percentage);
 	else
 		g_string_append (str, "        ");
-	dfu_progress_bar_console (self, str->str);
+	dfu_progress_bar_render (self, str->str);
 
 	return TRUE;
 }
@@ -189,10 +216,37 @@ dfu_progress_bar_set_percentage (DfuProgressBar *self, gint percentage)
 			g_source_remove (self->timer_id);
 			self->timer_id = 0;
 		}
+
+		/* coalesce; a later callback (or the action completing at
+		 * 100%) redraws soon enough, and writing escape sequences to
+		 * a slow console for every callback burns real CPU time */
+		if (self->refresh_rate > 0 && percentage < 100) {
+			gint64 now = g_get_monotonic_time ();
+			if (now - self->last_draw_time <
+			    G_USEC_PER_SEC / (gint64) self->refresh_rate)
+				return;
+			self->last_draw_time = now;
+		}
 		dfu_progress_bar_draw (self, percentage);
 	}
 }
 
+/**
+ * dfu_progress_bar_set_refresh_rate:
+ * @self: a #DfuProgressBar
+ * @refresh_rate: maximum redraws per second, or 0 for unlimited
+ *
+ * Limits how often percentage updates are rendered to the console.
+ * Updates arriving faster than this are coalesced; the final 100% update
+ * is always drawn.
+ **/
+void
+dfu_progress_bar_set_refresh_rate (DfuProgressBar *self, guint refresh_rate)
+{
+	g_return_if_fail (DFU_IS_PROGRESS_BAR (self));
+	self->refresh_rate = refresh_rate;
+}
+
 /**
  * pk_strpad:
  * @data: the input string
@@ -253,9 +307,11 @@ dfu_progress_bar_start (DfuProgressBar *self, const gchar *text)
 	text_pad = pk_strpad (text, self->padding);
 	g_string_append (str, text_pad);
 
-	/* save cursor in new position */
+	/* save cursor in new position; everything rendered so far is stale */
 	g_string_append_printf (str, "%c7", 0x1B);
 	dfu_progress_bar_console (self, str->str);
+	g_clear_pointer (&self->old_draw_str, g_free);
+	self->last_draw_time = 0;
 
 	/* reset */
 	if (self->percentage == G_MININT)
@@ -290,6 +346,7 @@ dfu_progress_bar_finalize (GObject *object)
 	self = DFU_PROGRESS_BAR (object);
 
 	g_free (self->old_start_text);
+	g_free (self->old_draw_str);
 	if (self->timer_id != 0)
 		g_source_remove (self->timer_id);
 	if (self->tty_fd > 0)
@@ -311,6 +368,7 @@ dfu_progress_bar_init (DfuProgressBar *self)
 	self->percentage = G_MININT;
 	self->padding = 0;
 	self->timer_id = 0;
+	self->refresh_rate = DFU_PROGRESS_BAR_REFRESH_RATE_DEFAULT;
 	self->tty_fd = open ("/dev/tty", O_RDWR, 0);
 	if (self->tty_fd < 0)
 		self->tty_fd = open ("/dev/console", O_RDWR, 0);
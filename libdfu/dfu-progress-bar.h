@@ -37,6 +37,8 @@ void		 dfu_progress_bar_set_padding		(DfuProgressBar	*progress_bar,
 							 guint		 padding);
 void		 dfu_progress_bar_set_percentage	(DfuProgressBar	*progress_bar,
 							 gint		 percentage);
+void		 dfu_progress_bar_set_refresh_rate	(DfuProgressBar	*progress_bar,
+							 guint		 refresh_rate);
 void		 dfu_progress_bar_start			(DfuProgressBar	*progress_bar,
 							 const gchar	*text);
 void		 dfu_progress_bar_end			(DfuProgressBar	*progress_bar);
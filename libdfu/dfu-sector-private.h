@@ -32,6 +32,13 @@ DfuSector	*dfu_sector_new		(guint32	 address,
 					 guint16	 zone,
 					 guint16	 number,
 					 DfuSectorCap	 cap);
+void		 dfu_sector_set_details	(DfuSector	*sector,
+					 guint32	 address,
+					 guint32	 size,
+					 guint32	 size_left,
+					 guint16	 zone,
+					 guint16	 number,
+					 DfuSectorCap	 cap);
 
 G_END_DECLS
 
@@ -65,6 +65,35 @@ dfu_sector_init (DfuSector *sector)
 {
 }
 
+/**
+ * dfu_sector_set_details: (skip)
+ * @sector: a #DfuSector
+ * address: the address for the sector
+ * size: the size of this sector
+ * size_left: the size of the rest of the sector
+ * zone: the zone of memory the setor belongs
+ * number: the sector number in the zone
+ * cap: the #DfuSectorCap
+ *
+ * Sets all the sector properties, typically when reusing a pooled object.
+ *
+ * Since: 0.9.5
+ **/
+void
+dfu_sector_set_details (DfuSector *sector,
+			guint32 address, guint32 size, guint32 size_left,
+			guint16 zone, guint16 number, DfuSectorCap cap)
+{
+	DfuSectorPrivate *priv = GET_PRIVATE (sector);
+	g_return_if_fail (DFU_IS_SECTOR (sector));
+	priv->address = address;
+	priv->size = size;
+	priv->size_left = size_left;
+	priv->zone = zone;
+	priv->number = number;
+	priv->cap = cap;
+}
+
 /**
  * dfu_sector_new: (skip)
  * address: the address for the sector
@@ -84,16 +113,10 @@ DfuSector *
 dfu_sector_new (guint32 address, guint32 size, guint32 size_left,
 		guint16 zone, guint16 number, DfuSectorCap cap)
 {
-	DfuSectorPrivate *priv;
 	DfuSector *sector;
 	sector = g_object_new (DFU_TYPE_SECTOR, NULL);
-	priv = GET_PRIVATE (sector);
-	priv->address = address;
-	priv->size = size;
-	priv->size_left = size_left;
-	priv->zone = zone;
-	priv->number = number;
-	priv->cap = cap;
+	dfu_sector_set_details (sector, address, size, size_left,
+				zone, number, cap);
 	return sector;
 }
 
@@ -144,6 +144,55 @@ dfu_self_test_get_bytes_for_file (GFile *file, GError **error)
 	return g_bytes_new_take (contents, length);
 }
 
+static void
+dfu_image_merge_func (void)
+{
+	DfuElement *element;
+	const guint8 *data;
+	gsize len = 0;
+	g_autoptr(DfuImage) image = NULL;
+	g_autoptr(DfuElement) element1 = NULL;
+	g_autoptr(DfuElement) element2 = NULL;
+	g_autoptr(DfuElement) element3 = NULL;
+	g_autoptr(GBytes) blob1 = NULL;
+	g_autoptr(GBytes) blob2 = NULL;
+	g_autoptr(GBytes) blob3 = NULL;
+
+	/* three elements, the first two separated by a 4 byte hole */
+	image = dfu_image_new ();
+	blob1 = g_bytes_new_static ("\x01\x02\x03\x04", 4);
+	element1 = dfu_element_new ();
+	dfu_element_set_address (element1, 0x0);
+	dfu_element_set_contents (element1, blob1);
+	dfu_image_add_element (image, element1);
+	blob2 = g_bytes_new_static ("\x05\x06\x07\x08", 4);
+	element2 = dfu_element_new ();
+	dfu_element_set_address (element2, 0x8);
+	dfu_element_set_contents (element2, blob2);
+	dfu_image_add_element (image, element2);
+	blob3 = g_bytes_new_static ("\x09", 1);
+	element3 = dfu_element_new ();
+	dfu_element_set_address (element3, 0x1000);
+	dfu_element_set_contents (element3, blob3);
+	dfu_image_add_element (image, element3);
+
+	/* the hole is padded, the distant element is left alone */
+	dfu_image_merge_elements (image, 16, 0xff);
+	g_assert_cmpint (dfu_image_get_elements (image)->len, ==, 2);
+	element = dfu_image_get_element (image, 0);
+	g_assert (element != NULL);
+	g_assert_cmpint (dfu_element_get_address (element), ==, 0x0);
+	data = g_bytes_get_data (dfu_element_get_contents (element), &len);
+	g_assert_cmpint (len, ==, 12);
+	g_assert_cmpint (data[3], ==, 0x04);
+	g_assert_cmpint (data[4], ==, 0xff);
+	g_assert_cmpint (data[7], ==, 0xff);
+	g_assert_cmpint (data[8], ==, 0x05);
+	element = dfu_image_get_element (image, 1);
+	g_assert (element != NULL);
+	g_assert_cmpint (dfu_element_get_address (element), ==, 0x1000);
+}
+
 static void
 dfu_firmware_raw_func (void)
 {
@@ -192,6 +241,67 @@ dfu_firmware_raw_func (void)
 	g_assert_cmpstr (_g_bytes_compare_verbose (roundtrip, fw), ==, NULL);
 }
 
+static void
+dfu_firmware_raw_sparse_func (void)
+{
+	DfuElement *element;
+	DfuImage *image_tmp;
+	const guint8 *data;
+	gsize len = 0;
+	gboolean ret;
+	guint8 buf[0x3000];
+	g_autoptr(DfuFirmware) firmware = NULL;
+	g_autoptr(DfuFirmware) firmware_blank = NULL;
+	g_autoptr(GBytes) fw = NULL;
+	g_autoptr(GBytes) fw_blank = NULL;
+	g_autoptr(GError) error = NULL;
+
+	/* 256 bytes of data, a 0x1000+ hole of 0xff, more data, then a
+	 * trailing pad smaller than the minimum hole size */
+	memset (buf, 0xff, sizeof (buf));
+	for (guint i = 0; i < 0x100; i++)
+		buf[i] = (guint8) (i & 0x7f);
+	for (guint i = 0; i < 0x100; i++)
+		buf[0x2000 + i] = (guint8) (i & 0x7f);
+	fw = g_bytes_new_static (buf, sizeof (buf));
+
+	/* the hole becomes an element boundary, the offsets become
+	 * element addresses */
+	firmware = dfu_firmware_new ();
+	ret = dfu_firmware_parse_data (firmware, fw,
+				       DFU_FIRMWARE_PARSE_FLAG_SPARSE_HOLES,
+				       &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	image_tmp = dfu_firmware_get_image (firmware, 0);
+	g_assert (image_tmp != NULL);
+	g_assert_cmpint (dfu_image_get_elements (image_tmp)->len, ==, 2);
+	element = dfu_image_get_element (image_tmp, 0);
+	g_assert_cmpint (dfu_element_get_address (element), ==, 0x0);
+	data = g_bytes_get_data (dfu_element_get_contents (element), &len);
+	g_assert_cmpint (len, ==, 0x100);
+	g_assert_cmpint (data[0xff], ==, 0x7f);
+	element = dfu_image_get_element (image_tmp, 1);
+	g_assert_cmpint (dfu_element_get_address (element), ==, 0x2000);
+	data = g_bytes_get_data (dfu_element_get_contents (element), &len);
+	g_assert_cmpint (len, ==, 0x100);
+	g_assert_cmpint (data[0x00], ==, 0x00);
+
+	/* an image that is nothing but the erase value stays dense */
+	memset (buf, 0xff, sizeof (buf));
+	fw_blank = g_bytes_new_static (buf, sizeof (buf));
+	firmware_blank = dfu_firmware_new ();
+	ret = dfu_firmware_parse_data (firmware_blank, fw_blank,
+				       DFU_FIRMWARE_PARSE_FLAG_SPARSE_HOLES,
+				       &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	image_tmp = dfu_firmware_get_image (firmware_blank, 0);
+	g_assert (image_tmp != NULL);
+	g_assert_cmpint (dfu_image_get_elements (image_tmp)->len, ==, 1);
+	g_assert_cmpint (dfu_image_get_size (image_tmp), ==, 0x3000);
+}
+
 static void
 dfu_firmware_dfu_func (void)
 {
@@ -821,7 +931,9 @@ main (int argc, char **argv)
 	/* tests go here */
 	g_test_add_func ("/libdfu/enums", dfu_enums_func);
 	g_test_add_func ("/libdfu/target(DfuSe}", dfu_target_dfuse_func);
+	g_test_add_func ("/libdfu/image{merge}", dfu_image_merge_func);
 	g_test_add_func ("/libdfu/firmware{raw}", dfu_firmware_raw_func);
+	g_test_add_func ("/libdfu/firmware{raw-sparse}", dfu_firmware_raw_sparse_func);
 	g_test_add_func ("/libdfu/firmware{dfu}", dfu_firmware_dfu_func);
 	g_test_add_func ("/libdfu/firmware{dfuse}", dfu_firmware_dfuse_func);
 	g_test_add_func ("/libdfu/firmware{xdfu}", dfu_firmware_xdfu_func);
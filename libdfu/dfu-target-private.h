@@ -25,6 +25,7 @@
 #include <gusb.h>
 
 #include "dfu-device.h"
+#include "dfu-image.h"
 #include "dfu-target.h"
 
 G_BEGIN_DECLS
@@ -32,6 +33,19 @@ G_BEGIN_DECLS
 DfuTarget	*dfu_target_new				(DfuDevice	*device,
 							 GUsbInterface	*iface);
 
+gboolean	 dfu_target_setup_with_alt_name		(DfuTarget	*target,
+							 const gchar	*alt_name,
+							 GError		**error);
+gboolean	 dfu_target_download_prepare		(DfuTarget	*target,
+							 DfuImage	*image,
+							 GError		**error);
+gboolean	 dfu_target_download_image_element	(DfuTarget	*target,
+							 DfuImage	*image,
+							 guint		 element_idx,
+							 DfuTargetTransferFlags flags,
+							 GCancellable	*cancellable,
+							 GError		**error);
+
 GBytes		*dfu_target_upload_chunk		(DfuTarget	*target,
 							 guint8		 index,
 							 GCancellable	*cancellable,
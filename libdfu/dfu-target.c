@@ -40,6 +40,7 @@
 
 #include "dfu-common.h"
 #include "dfu-device-private.h"
+#include "dfu-crc.h"
 #include "dfu-error.h"
 #include "dfu-sector-private.h"
 #include "dfu-target-private.h"
@@ -63,6 +64,8 @@ typedef struct {
 	gchar			*alt_name;
 	gchar			*alt_name_for_display;
 	GPtrArray		*sectors;		/* of DfuSector */
+	GPtrArray		*sectors_recycled;	/* of DfuSector */
+	GHashTable		*sectors_erased;	/* of DfuSector */
 	guint			 old_percentage;
 	DfuAction		 old_action;
 } DfuTargetPrivate;
@@ -123,6 +126,8 @@ dfu_target_init (DfuTarget *target)
 {
 	DfuTargetPrivate *priv = GET_PRIVATE (target);
 	priv->sectors = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	priv->sectors_recycled = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	priv->sectors_erased = g_hash_table_new (g_direct_hash, g_direct_equal);
 	priv->old_percentage = G_MAXUINT;
 	priv->old_action = DFU_ACTION_IDLE;
 }
@@ -136,6 +141,8 @@ dfu_target_finalize (GObject *object)
 	g_free (priv->alt_name);
 	g_free (priv->alt_name_for_display);
 	g_ptr_array_unref (priv->sectors);
+	g_ptr_array_unref (priv->sectors_recycled);
+	g_hash_table_unref (priv->sectors_erased);
 
 	/* we no longer care */
 	if (priv->device != NULL) {
@@ -185,6 +192,43 @@ dfu_target_get_sector_for_addr (DfuTarget *target, guint32 addr)
 	return NULL;
 }
 
+static DfuSector *
+dfu_target_sector_acquire (DfuTarget *target,
+			   guint32 address,
+			   guint32 size,
+			   guint32 size_left,
+			   guint16 zone,
+			   guint16 number,
+			   DfuSectorCap cap)
+{
+	DfuTargetPrivate *priv = GET_PRIVATE (target);
+
+	/* hotplug-heavy setups re-parse the memory layout on every attach,
+	 * so reuse the objects from the last parse rather than churning
+	 * the allocator with hundreds of tiny blocks */
+	if (priv->sectors_recycled->len > 0) {
+		DfuSector *sector;
+		guint idx = priv->sectors_recycled->len - 1;
+		sector = g_object_ref (g_ptr_array_index (priv->sectors_recycled, idx));
+		g_ptr_array_remove_index (priv->sectors_recycled, idx);
+		dfu_sector_set_details (sector, address, size, size_left,
+					zone, number, cap);
+		return sector;
+	}
+	return dfu_sector_new (address, size, size_left, zone, number, cap);
+}
+
+static void
+dfu_target_recycle_sectors (DfuTarget *target)
+{
+	DfuTargetPrivate *priv = GET_PRIVATE (target);
+	for (guint i = 0; i < priv->sectors->len; i++) {
+		DfuSector *sector = g_ptr_array_index (priv->sectors, i);
+		g_ptr_array_add (priv->sectors_recycled, g_object_ref (sector));
+	}
+	g_ptr_array_set_size (priv->sectors, 0);
+}
+
 static gboolean
 dfu_target_parse_sector (DfuTarget *target,
 			 const gchar *dfuse_sector_id,
@@ -293,12 +337,13 @@ dfu_target_parse_sector (DfuTarget *target,
 	/* add all the sectors */
 	for (i = 0; i < nr_sectors; i++) {
 		DfuSector *sector;
-		sector = dfu_sector_new (*addr + addr_offset,
-					 (guint32) sector_size,
-					 (guint32) ((nr_sectors * sector_size) - addr_offset),
-					 zone,
-					 number,
-					 cap);
+		sector = dfu_target_sector_acquire (target,
+						    *addr + addr_offset,
+						    (guint32) sector_size,
+						    (guint32) ((nr_sectors * sector_size) - addr_offset),
+						    zone,
+						    number,
+						    cap);
 		g_ptr_array_add (priv->sectors, sector);
 		addr_offset += dfu_sector_get_size (sector);
 	}
@@ -331,13 +376,14 @@ dfu_target_parse_sectors (DfuTarget *target, const gchar *alt_name, GError **err
 		if (addr_tmp == 0 || addr_tmp > G_MAXUINT32)
 			return FALSE;
 		g_debug ("RAM description, so parsing");
-		sector = dfu_sector_new ((guint32) addr_tmp,
-					 0x0, /* size */
-					 0x0, /* size_left */
-					 0x0, /* zone */
-					 0x0, /* number */
-					 DFU_SECTOR_CAP_READABLE |
-					 DFU_SECTOR_CAP_WRITEABLE);
+		sector = dfu_target_sector_acquire (target,
+						    (guint32) addr_tmp,
+						    0x0, /* size */
+						    0x0, /* size_left */
+						    0x0, /* zone */
+						    0x0, /* number */
+						    DFU_SECTOR_CAP_READABLE |
+						    DFU_SECTOR_CAP_WRITEABLE);
 		g_ptr_array_add (priv->sectors, sector);
 	}
 
@@ -345,8 +391,8 @@ dfu_target_parse_sectors (DfuTarget *target, const gchar *alt_name, GError **err
 	if (alt_name[0] != '@')
 		return TRUE;
 
-	/* clear any existing zones */
-	g_ptr_array_set_size (priv->sectors, 0);
+	/* clear any existing zones, keeping the objects for reuse */
+	dfu_target_recycle_sectors (target);
 
 	/* parse zones */
 	zones = g_strsplit (alt_name, "/", -1);
@@ -518,7 +564,7 @@ dfu_target_check_status (DfuTarget *target,
 	if (dfu_device_has_dfuse_support (priv->device)) {
 		while (dfu_device_get_state (priv->device) == DFU_STATE_DFU_DNBUSY) {
 			g_debug ("waiting for DFU_STATE_DFU_DNBUSY to clear");
-			g_usleep (dfu_device_get_download_timeout (priv->device) * 1000);
+			g_usleep (dfu_device_get_poll_interval (priv->device) * 1000);
 			if (!dfu_device_refresh (priv->device, cancellable, error))
 				return FALSE;
 		}
@@ -612,11 +658,40 @@ dfu_target_use_alt_setting (DfuTarget *target, GError **error)
  *
  * Since: 0.5.4
  **/
+static gboolean
+dfu_target_setup_sectors (DfuTarget *target, GError **error)
+{
+	DfuTargetPrivate *priv = GET_PRIVATE (target);
+
+	/* parse the DfuSe format according to UM0424 */
+	if (!dfu_target_parse_sectors (target,
+				       priv->alt_name,
+				       error))
+		return FALSE;
+
+	/* add a dummy entry */
+	if (priv->sectors->len == 0) {
+		DfuSector *sector;
+		sector = dfu_target_sector_acquire (target,
+						    0x0, /* addr */
+						    0x0, /* size */
+						    0x0, /* size_left */
+						    0x0, /* zone */
+						    0x0, /* number */
+						    DFU_SECTOR_CAP_READABLE |
+						    DFU_SECTOR_CAP_WRITEABLE);
+		g_debug ("no UM0424 sector description in %s", priv->alt_name);
+		g_ptr_array_add (priv->sectors, sector);
+	}
+
+	priv->done_setup = TRUE;
+	return TRUE;
+}
+
 static gboolean
 dfu_target_setup (DfuTarget *target, GError **error)
 {
 	DfuTargetPrivate *priv = GET_PRIVATE (target);
-	g_autoptr(GError) error_local = NULL;
 
 	g_return_val_if_fail (DFU_IS_TARGET (target), FALSE);
 	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
@@ -635,28 +710,37 @@ dfu_target_setup (DfuTarget *target, GError **error)
 							    NULL);
 	}
 
-	/* parse the DfuSe format according to UM0424 */
-	if (!dfu_target_parse_sectors (target,
-				       priv->alt_name,
-				       error))
-		return FALSE;
+	return dfu_target_setup_sectors (target, error);
+}
 
-	/* add a dummy entry */
-	if (priv->sectors->len == 0) {
-		DfuSector *sector;
-		sector = dfu_sector_new (0x0, /* addr */
-					 0x0, /* size */
-					 0x0, /* size_left */
-					 0x0, /* zone */
-					 0x0, /* number */
-					 DFU_SECTOR_CAP_READABLE |
-					 DFU_SECTOR_CAP_WRITEABLE);
-		g_debug ("no UM0424 sector description in %s", priv->alt_name);
-		g_ptr_array_add (priv->sectors, sector);
-	}
+/**
+ * dfu_target_setup_with_alt_name: (skip)
+ * @target: a #DfuTarget
+ * @alt_name: an alternate setting name, e.g. `@Flash/0x08000000/2*001Ka`
+ * @error: a #GError, or %NULL
+ *
+ * Completes target setup using a previously cached alternate setting
+ * name, avoiding the string descriptor read from the device.
+ *
+ * Return value: %TRUE for success
+ **/
+gboolean
+dfu_target_setup_with_alt_name (DfuTarget *target,
+				const gchar *alt_name,
+				GError **error)
+{
+	DfuTargetPrivate *priv = GET_PRIVATE (target);
 
-	priv->done_setup = TRUE;
-	return TRUE;
+	g_return_val_if_fail (DFU_IS_TARGET (target), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* already done */
+	if (priv->done_setup)
+		return TRUE;
+
+	g_free (priv->alt_name);
+	priv->alt_name = g_strdup (alt_name);
+	return dfu_target_setup_sectors (target, error);
 }
 
 gboolean
@@ -695,7 +779,7 @@ dfu_target_download_chunk (DfuTarget *target, guint8 index, GBytes *bytes,
 		return FALSE;
 
 	/* give the target a chance to update */
-	g_usleep (dfu_device_get_download_timeout (priv->device) * 1000);
+	g_usleep (dfu_device_get_poll_interval (priv->device) * 1000);
 
 	g_assert (actual_length == g_bytes_get_size (bytes));
 	return TRUE;
@@ -893,17 +977,15 @@ dfu_target_read_unprotect (DfuTarget *target,
 
 #endif
 
-GBytes *
-dfu_target_upload_chunk (DfuTarget *target, guint8 index,
-			 GCancellable *cancellable, GError **error)
+static gboolean
+dfu_target_upload_chunk_to_buf (DfuTarget *target, guint8 index,
+				guint8 *buf, gsize buf_sz,
+				gsize *actual_length,
+				GCancellable *cancellable, GError **error)
 {
 	DfuTargetPrivate *priv = GET_PRIVATE (target);
 	g_autoptr(GError) error_local = NULL;
-	guint8 *buf;
-	gsize actual_length;
-	guint16 transfer_size = dfu_device_get_transfer_size (priv->device);
 
-	buf = g_new0 (guint8, transfer_size);
 	if (!g_usb_device_control_transfer (dfu_device_get_usb_dev (priv->device),
 					    G_USB_DEVICE_DIRECTION_DEVICE_TO_HOST,
 					    G_USB_DEVICE_REQUEST_TYPE_CLASS,
@@ -911,8 +993,8 @@ dfu_target_upload_chunk (DfuTarget *target, guint8 index,
 					    DFU_REQUEST_UPLOAD,
 					    index,
 					    dfu_device_get_interface (priv->device),
-					    buf, (gsize) transfer_size,
-					    &actual_length,
+					    buf, buf_sz,
+					    actual_length,
 					    dfu_device_get_timeout (priv->device),
 					    cancellable,
 					    &error_local)) {
@@ -923,9 +1005,28 @@ dfu_target_upload_chunk (DfuTarget *target, guint8 index,
 			     DFU_ERROR_NOT_SUPPORTED,
 			     "cannot upload data: %s",
 			     error_local->message);
-		return NULL;
+		return FALSE;
 	}
+	return TRUE;
+}
 
+GBytes *
+dfu_target_upload_chunk (DfuTarget *target, guint8 index,
+			 GCancellable *cancellable, GError **error)
+{
+	DfuTargetPrivate *priv = GET_PRIVATE (target);
+	guint8 *buf;
+	gsize actual_length = 0;
+	guint16 transfer_size = dfu_device_get_transfer_size (priv->device);
+
+	buf = g_new0 (guint8, transfer_size);
+	if (!dfu_target_upload_chunk_to_buf (target, index,
+					     buf, (gsize) transfer_size,
+					     &actual_length,
+					     cancellable, error)) {
+		g_free (buf);
+		return NULL;
+	}
 	return g_bytes_new_take (buf, actual_length);
 }
 
@@ -976,35 +1077,6 @@ dfu_target_set_percentage (DfuTarget *target, guint value, guint total)
 	dfu_target_set_percentage_raw (target, percentage);
 }
 
-static GBytes *
-_g_bytes_array_join (GPtrArray *chunks)
-{
-	gsize total_size = 0;
-	guint32 offset = 0;
-	guint8 *buffer;
-	guint i;
-
-	/* get the size of all the chunks */
-	for (i = 0; i < chunks->len; i++) {
-		GBytes *chunk_tmp = g_ptr_array_index (chunks, i);
-		total_size += g_bytes_get_size (chunk_tmp);
-	}
-
-	/* copy them into a buffer */
-	buffer = g_malloc0 (total_size);
-	for (i = 0; i < chunks->len; i++) {
-		const guint8 *chunk_data;
-		gsize chunk_size = 0;
-		GBytes *chunk_tmp = g_ptr_array_index (chunks, i);
-		chunk_data = g_bytes_get_data (chunk_tmp, &chunk_size);
-		if (chunk_size == 0)
-			continue;
-		memcpy (buffer + offset, chunk_data, chunk_size);
-		offset += chunk_size;
-	}
-	return g_bytes_new_take (buffer, total_size);
-}
-
 static DfuElement *
 dfu_target_upload_element_dfuse (DfuTarget *target,
 				 guint32 address,
@@ -1016,7 +1088,6 @@ dfu_target_upload_element_dfuse (DfuTarget *target,
 	DfuTargetPrivate *priv = GET_PRIVATE (target);
 	DfuSector *sector;
 	DfuElement *element = NULL;
-	GBytes *chunk_tmp;
 	guint32 offset = address;
 	guint percentage_size = expected_size > 0 ? expected_size : maximum_size;
 	gsize total_size = 0;
@@ -1024,7 +1095,7 @@ dfu_target_upload_element_dfuse (DfuTarget *target,
 	guint idx;
 	g_autoptr(GBytes) contents = NULL;
 	g_autoptr(GBytes) contents_truncated = NULL;
-	g_autoptr(GPtrArray) chunks = NULL;
+	g_autoptr(GByteArray) buf = NULL;
 
 	/* for DfuSe devices we need to handle the address manually */
 	sector = dfu_target_get_sector_for_addr (target, offset);
@@ -1063,25 +1134,29 @@ dfu_target_upload_element_dfuse (DfuTarget *target,
 	if (!dfu_device_abort (priv->device, cancellable, error))
 		return NULL;
 
-	/* get all the chunks from the hardware */
-	chunks = g_ptr_array_new_with_free_func ((GDestroyNotify) g_bytes_unref);
+	/* the size is known from the sector map, so preallocate the whole
+	 * buffer and read each chunk straight into the right offset */
+	buf = g_byte_array_sized_new (percentage_size > 0 ?
+				      percentage_size : transfer_size);
 	for (idx = 0; idx < G_MAXUINT16; idx++) {
-		guint32 chunk_size;
+		gsize chunk_size = 0;
 
 		/* read chunk of data -- ST uses wBlockNum=0 for DfuSe commands
 		 * and wBlockNum=1 is reserved */
-		chunk_tmp = dfu_target_upload_chunk (target,
+		g_byte_array_set_size (buf, total_size + transfer_size);
+		if (!dfu_target_upload_chunk_to_buf (target,
 						     (guint8) (idx + 2),
+						     buf->data + total_size,
+						     (gsize) transfer_size,
+						     &chunk_size,
 						     cancellable,
-						     error);
-		if (chunk_tmp == NULL)
+						     error))
 			return NULL;
+		g_byte_array_set_size (buf, total_size + chunk_size);
 
-		/* add to array */
-		chunk_size = (guint32) g_bytes_get_size (chunk_tmp);
-		g_debug ("got #%04x chunk @0x%x of size %" G_GUINT32_FORMAT,
+		/* keep a sum of all the chunks */
+		g_debug ("got #%04x chunk @0x%x of size %" G_GSIZE_FORMAT,
 			 idx, offset, chunk_size);
-		g_ptr_array_add (chunks, chunk_tmp);
 		total_size += chunk_size;
 		offset += chunk_size;
 
@@ -1122,7 +1197,7 @@ dfu_target_upload_element_dfuse (DfuTarget *target,
 	dfu_target_set_action (target, DFU_ACTION_IDLE);
 
 	/* create new image */
-	contents = _g_bytes_array_join (chunks);
+	contents = g_byte_array_free_to_bytes (g_steal_pointer (&buf));
 	if (expected_size > 0)
 		contents_truncated = g_bytes_new_from_bytes (contents, 0, expected_size);
 	else
@@ -1143,40 +1218,39 @@ dfu_target_upload_element_dfu (DfuTarget *target,
 {
 	DfuTargetPrivate *priv = GET_PRIVATE (target);
 	DfuElement *element = NULL;
-	GBytes *chunk_tmp;
-	guint32 offset = 0;
 	guint percentage_size = expected_size > 0 ? expected_size : maximum_size;
 	gsize total_size = 0;
 	guint16 transfer_size = dfu_device_get_transfer_size (priv->device);
 	guint idx;
 	g_autoptr(GBytes) contents = NULL;
-	g_autoptr(GPtrArray) chunks = NULL;
+	g_autoptr(GByteArray) buf = NULL;
 
 	/* update UI */
 	dfu_target_set_action (target, DFU_ACTION_READ);
 
-	/* get all the chunks from the hardware */
-	chunks = g_ptr_array_new_with_free_func ((GDestroyNotify) g_bytes_unref);
+	/* preallocate the whole buffer and read each chunk straight into
+	 * the right offset rather than joining chunks afterwards */
+	buf = g_byte_array_sized_new (percentage_size > 0 ?
+				      percentage_size : transfer_size);
 	for (idx = 0; idx < G_MAXUINT16; idx++) {
-		guint32 chunk_size;
+		gsize chunk_size = 0;
 
 		/* read chunk of data */
-		chunk_tmp = dfu_target_upload_chunk (target,
+		g_byte_array_set_size (buf, total_size + transfer_size);
+		if (!dfu_target_upload_chunk_to_buf (target,
 						     (guint8) idx,
+						     buf->data + total_size,
+						     (gsize) transfer_size,
+						     &chunk_size,
 						     cancellable,
-						     error);
-		if (chunk_tmp == NULL)
+						     error))
 			return NULL;
+		g_byte_array_set_size (buf, total_size + chunk_size);
 
 		/* keep a sum of all the chunks */
-		chunk_size = (guint32) g_bytes_get_size (chunk_tmp);
 		total_size += chunk_size;
-		offset += chunk_size;
-
-		/* add to array */
-		g_debug ("got #%04x chunk of size %" G_GUINT32_FORMAT,
+		g_debug ("got #%04x chunk of size %" G_GSIZE_FORMAT,
 			 idx, chunk_size);
-		g_ptr_array_add (chunks, chunk_tmp);
 
 		/* update UI */
 		if (chunk_size > 0)
@@ -1205,7 +1279,7 @@ dfu_target_upload_element_dfu (DfuTarget *target,
 	dfu_target_set_action (target, DFU_ACTION_IDLE);
 
 	/* create new image */
-	contents = _g_bytes_array_join (chunks);
+	contents = g_byte_array_free_to_bytes (g_steal_pointer (&buf));
 	element = dfu_element_new ();
 	dfu_element_set_contents (element, contents);
 	return element;
@@ -1393,6 +1467,227 @@ _g_bytes_compare_verbose (GBytes *bytes1, GBytes *bytes2)
 	return NULL;
 }
 
+typedef struct {
+	DfuTarget	*target;
+	GBytes		*bytes;
+	GCancellable	*cancellable;
+	GMainLoop	*loop;
+	GError		*error;
+	GPtrArray	*chunks_queued;		/* keeps transfer buffers alive */
+	gsize		 transfer_size;
+	guint		 nr_chunks;
+	guint		 chunks_submitted;
+	guint		 chunks_confirmed;
+	guint		 transfers_in_flight;
+	guint8		 buf_status[6];
+} DfuTargetPipeline;
+
+static void
+dfu_target_pipeline_fail (DfuTargetPipeline *helper, GError *error)
+{
+	/* only the first failure is interesting; cancel everything else */
+	if (helper->error == NULL) {
+		helper->error = error;
+		g_cancellable_cancel (helper->cancellable);
+	} else {
+		g_error_free (error);
+	}
+}
+
+static void
+dfu_target_pipeline_maybe_quit (DfuTargetPipeline *helper)
+{
+	/* never quit with transfers still referencing our buffers */
+	if (helper->transfers_in_flight > 0)
+		return;
+	if (helper->error != NULL ||
+	    helper->chunks_confirmed == helper->nr_chunks + 1)
+		g_main_loop_quit (helper->loop);
+}
+
+static void dfu_target_pipeline_submit_dnload (DfuTargetPipeline *helper);
+
+static void
+dfu_target_pipeline_status_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	DfuTargetPipeline *helper = (DfuTargetPipeline *) user_data;
+	GError *error = NULL;
+
+	helper->transfers_in_flight--;
+	if (g_usb_device_control_transfer_finish (G_USB_DEVICE (source),
+						  res, &error) < 0) {
+		g_prefix_error (&error, "cannot get device state: ");
+		dfu_target_pipeline_fail (helper, error);
+		dfu_target_pipeline_maybe_quit (helper);
+		return;
+	}
+
+	/* check the device did not enter an error state */
+	if (helper->error == NULL &&
+	    helper->buf_status[4] == DFU_STATE_DFU_ERROR) {
+		DfuStatus status = helper->buf_status[0];
+		dfu_target_pipeline_fail (helper,
+					  g_error_new_literal (DFU_ERROR,
+							       DFU_ERROR_NOT_SUPPORTED,
+							       dfu_target_status_to_error_msg (status)));
+		dfu_target_pipeline_maybe_quit (helper);
+		return;
+	}
+
+	/* update UI */
+	helper->chunks_confirmed++;
+	dfu_target_set_percentage (helper->target,
+				   helper->chunks_confirmed * helper->transfer_size,
+				   g_bytes_get_size (helper->bytes));
+	dfu_target_pipeline_maybe_quit (helper);
+}
+
+static void
+dfu_target_pipeline_dnload_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	DfuTargetPipeline *helper = (DfuTargetPipeline *) user_data;
+	DfuTargetPrivate *priv = GET_PRIVATE (helper->target);
+	GError *error = NULL;
+
+	helper->transfers_in_flight--;
+	if (g_usb_device_control_transfer_finish (G_USB_DEVICE (source),
+						  res, &error) < 0) {
+		g_prefix_error (&error, "cannot download data: ");
+		dfu_target_pipeline_fail (helper, error);
+		dfu_target_pipeline_maybe_quit (helper);
+		return;
+	}
+	if (helper->error != NULL) {
+		dfu_target_pipeline_maybe_quit (helper);
+		return;
+	}
+
+	/* queue the status poll, and the next chunk behind it so the bus
+	 * does not idle while the device is programming */
+	helper->transfers_in_flight++;
+	g_usb_device_control_transfer_async (dfu_device_get_usb_dev (priv->device),
+					     G_USB_DEVICE_DIRECTION_DEVICE_TO_HOST,
+					     G_USB_DEVICE_REQUEST_TYPE_CLASS,
+					     G_USB_DEVICE_RECIPIENT_INTERFACE,
+					     DFU_REQUEST_GETSTATUS,
+					     0,
+					     dfu_device_get_interface (priv->device),
+					     helper->buf_status,
+					     sizeof(helper->buf_status),
+					     dfu_device_get_timeout (priv->device),
+					     helper->cancellable,
+					     dfu_target_pipeline_status_cb,
+					     helper);
+	if (helper->chunks_submitted <= helper->nr_chunks)
+		dfu_target_pipeline_submit_dnload (helper);
+}
+
+static void
+dfu_target_pipeline_submit_dnload (DfuTargetPipeline *helper)
+{
+	DfuTargetPrivate *priv = GET_PRIVATE (helper->target);
+	GBytes *bytes_tmp;
+	guint idx = helper->chunks_submitted++;
+
+	/* we have to write one final zero-sized chunk for EOF */
+	if (idx < helper->nr_chunks) {
+		gsize length;
+		gsize offset = idx * helper->transfer_size;
+		length = g_bytes_get_size (helper->bytes) - offset;
+		if (length > helper->transfer_size)
+			length = helper->transfer_size;
+		bytes_tmp = g_bytes_new_from_bytes (helper->bytes, offset, length);
+	} else {
+		bytes_tmp = g_bytes_new (NULL, 0);
+	}
+	g_ptr_array_add (helper->chunks_queued, bytes_tmp);
+	g_debug ("writing #%04x chunk of size %" G_GSIZE_FORMAT,
+		 idx, g_bytes_get_size (bytes_tmp));
+	helper->transfers_in_flight++;
+	g_usb_device_control_transfer_async (dfu_device_get_usb_dev (priv->device),
+					     G_USB_DEVICE_DIRECTION_HOST_TO_DEVICE,
+					     G_USB_DEVICE_REQUEST_TYPE_CLASS,
+					     G_USB_DEVICE_RECIPIENT_INTERFACE,
+					     DFU_REQUEST_DNLOAD,
+					     idx,
+					     dfu_device_get_interface (priv->device),
+					     (guint8 *) g_bytes_get_data (bytes_tmp, NULL),
+					     g_bytes_get_size (bytes_tmp),
+					     dfu_device_get_timeout (priv->device),
+					     helper->cancellable,
+					     dfu_target_pipeline_dnload_cb,
+					     helper);
+}
+
+static void
+dfu_target_pipeline_cancelled_cb (GCancellable *cancellable, gpointer user_data)
+{
+	g_cancellable_cancel (G_CANCELLABLE (user_data));
+}
+
+static gboolean
+dfu_target_download_element_dfu_pipelined (DfuTarget *target,
+					   DfuElement *element,
+					   DfuTargetTransferFlags flags,
+					   GCancellable *cancellable,
+					   GError **error)
+{
+	DfuTargetPrivate *priv = GET_PRIVATE (target);
+	DfuTargetPipeline helper;
+	gulong cancellable_id = 0;
+	g_autoptr(GMainContext) context = NULL;
+
+	memset (&helper, 0, sizeof(helper));
+	helper.target = target;
+	helper.bytes = dfu_element_get_contents (element);
+	helper.transfer_size = dfu_device_get_transfer_size (priv->device);
+	helper.nr_chunks = (guint) ceil ((gdouble) g_bytes_get_size (helper.bytes) /
+					 (gdouble) helper.transfer_size);
+	if (helper.nr_chunks == 0) {
+		g_set_error_literal (error,
+				     DFU_ERROR,
+				     DFU_ERROR_INVALID_FILE,
+				     "zero-length firmware");
+		return FALSE;
+	}
+	helper.chunks_queued = g_ptr_array_new_with_free_func ((GDestroyNotify) g_bytes_unref);
+
+	/* use a private cancellable so a failure can abort the whole queue,
+	 * chained to the one the caller gave us */
+	helper.cancellable = g_cancellable_new ();
+	if (cancellable != NULL) {
+		cancellable_id = g_cancellable_connect (cancellable,
+							G_CALLBACK (dfu_target_pipeline_cancelled_cb),
+							helper.cancellable, NULL);
+	}
+
+	/* run all the transfers in a private context so the callbacks cannot
+	 * re-enter whatever main loop the caller is iterating */
+	context = g_main_context_new ();
+	g_main_context_push_thread_default (context);
+	helper.loop = g_main_loop_new (context, FALSE);
+	dfu_target_set_action (target, DFU_ACTION_WRITE);
+	dfu_target_pipeline_submit_dnload (&helper);
+	g_main_loop_run (helper.loop);
+	g_main_context_pop_thread_default (context);
+	g_main_loop_unref (helper.loop);
+	g_ptr_array_unref (helper.chunks_queued);
+	if (cancellable != NULL)
+		g_cancellable_disconnect (cancellable, cancellable_id);
+	g_object_unref (helper.cancellable);
+	if (helper.error != NULL) {
+		g_propagate_error (error, helper.error);
+		return FALSE;
+	}
+
+	/* done */
+	dfu_target_set_percentage_raw (target, 100);
+	dfu_target_set_action (target, DFU_ACTION_IDLE);
+
+	/* success */
+	return TRUE;
+}
+
 static gboolean
 dfu_target_download_element_dfu (DfuTarget *target,
 				 DfuElement *element,
@@ -1474,6 +1769,7 @@ dfu_target_download_element_dfuse (DfuTarget *target,
 	g_autoptr(GError) error_local = NULL;
 	g_autoptr(GPtrArray) sectors_array = NULL;
 	g_autoptr(GHashTable) sectors_hash = NULL;
+	g_autofree guint8 *chunks_dirty = NULL;
 
 	/* round up as we have to transfer incomplete blocks */
 	bytes = dfu_element_get_contents (element);
@@ -1487,6 +1783,48 @@ dfu_target_download_element_dfuse (DfuTarget *target,
 		return FALSE;
 	}
 
+	/* differential mode: read back the current content first so that
+	 * only the sectors that actually changed get erased and written;
+	 * point releases typically differ in a small region of the image */
+	if ((flags & DFU_TARGET_TRANSFER_FLAG_SKIP_UNCHANGED) > 0 &&
+	    dfu_device_can_upload (priv->device)) {
+		g_autoptr(DfuElement) element_old = NULL;
+		g_autoptr(GError) error_upload = NULL;
+		element_old = dfu_target_upload_element (target,
+							 dfu_element_get_address (element),
+							 0, /* no minimum */
+							 g_bytes_get_size (bytes),
+							 cancellable,
+							 &error_upload);
+		if (element_old == NULL) {
+			g_debug ("cannot read current content, "
+				 "writing everything: %s",
+				 error_upload->message);
+		} else {
+			const guint8 *data = g_bytes_get_data (bytes, NULL);
+			const guint8 *data_old;
+			gsize len = g_bytes_get_size (bytes);
+			gsize len_old = 0;
+			guint nr_clean = 0;
+			data_old = g_bytes_get_data (dfu_element_get_contents (element_old),
+						     &len_old);
+			chunks_dirty = g_new0 (guint8, nr_chunks);
+			for (i = 0; i < nr_chunks; i++) {
+				gsize offset = (gsize) i * transfer_size;
+				gsize length = MIN (len - offset, transfer_size);
+				if (offset + length > len_old ||
+				    memcmp (data + offset,
+					    data_old + offset, length) != 0) {
+					chunks_dirty[i] = TRUE;
+					continue;
+				}
+				nr_clean++;
+			}
+			g_debug ("differential download: %u of %u chunks unchanged",
+				 nr_clean, nr_chunks);
+		}
+	}
+
 	/* 1st pass: work out which sectors need erasing */
 	sectors_array = g_ptr_array_new ();
 	sectors_hash = g_hash_table_new (g_direct_hash, g_direct_equal);
@@ -1514,6 +1852,17 @@ dfu_target_download_element_dfuse (DfuTarget *target,
 			return FALSE;
 		}
 
+		/* in differential mode an unchanged chunk does not force
+		 * its sector to be erased */
+		if (chunks_dirty != NULL && !chunks_dirty[i])
+			continue;
+
+		/* a sparse image can have several elements landing in the
+		 * same sector; erasing it again for a later element would
+		 * wipe the data an earlier element already wrote there */
+		if (g_hash_table_lookup (priv->sectors_erased, sector) != NULL)
+			continue;
+
 		/* if it's erasable and not yet blanked */
 		if (dfu_sector_has_cap (sector, DFU_SECTOR_CAP_ERASEABLE) &&
 		    g_hash_table_lookup (sectors_hash, sector) == NULL) {
@@ -1538,6 +1887,8 @@ dfu_target_download_element_dfuse (DfuTarget *target,
 					       cancellable,
 					       error))
 			return FALSE;
+		g_hash_table_insert (priv->sectors_erased, sector,
+				     GINT_TO_POINTER (1));
 		dfu_target_set_percentage (target, i + 1, sectors_array->len);
 	}
 	dfu_target_set_percentage_raw (target, 100);
@@ -1559,6 +1910,15 @@ dfu_target_download_element_dfuse (DfuTarget *target,
 		sector = dfu_target_get_sector_for_addr (target, offset_dev);
 		g_assert (sector != NULL);
 
+		/* in differential mode skip the chunks in untouched sectors,
+		 * although every chunk of an erased sector has to be written
+		 * back; force the address to be set again after a gap */
+		if (chunks_dirty != NULL && !chunks_dirty[i] &&
+		    g_hash_table_lookup (sectors_hash, sector) == NULL) {
+			zone_last = G_MAXUINT;
+			continue;
+		}
+
 		/* manually set the sector address */
 		if (dfu_sector_get_zone (sector) != zone_last) {
 			g_debug ("setting address to 0x%04x",
@@ -1603,6 +1963,108 @@ dfu_target_download_element_dfuse (DfuTarget *target,
 	return TRUE;
 }
 
+static gboolean
+dfu_target_verify_element_fast (DfuTarget *target,
+				DfuElement *element,
+				GCancellable *cancellable,
+				GError **error)
+{
+	DfuTargetPrivate *priv = GET_PRIVATE (target);
+	GBytes *bytes;
+	const guint8 *data;
+	gsize data_sz = 0;
+	guint idx;
+	guint nr_chunks;
+	guint nr_sampled = 0;
+	guint16 transfer_size = dfu_device_get_transfer_size (priv->device);
+	g_autofree guint8 *buf = NULL;
+
+	/* round up as we have to transfer incomplete blocks */
+	bytes = dfu_element_get_contents (element);
+	data = g_bytes_get_data (bytes, &data_sz);
+	nr_chunks = (guint) ceil ((gdouble) data_sz /
+				  (gdouble) transfer_size);
+	if (nr_chunks == 0) {
+		g_set_error_literal (error,
+				     DFU_ERROR,
+				     DFU_ERROR_INVALID_FILE,
+				     "zero-length firmware");
+		return FALSE;
+	}
+
+	/* read back the first, the last, and every 8th chunk in between,
+	 * comparing the CRC32 of each against the data we just sent */
+	buf = g_new0 (guint8, transfer_size);
+	for (idx = 0; idx < nr_chunks; idx++) {
+		gsize chunk_size = 0;
+		gsize length;
+		guint32 crc_device;
+		guint32 crc_host;
+		guint32 offset = idx * transfer_size;
+		guint32 offset_dev = dfu_element_get_address (element) + offset;
+
+		if (idx != 0 && idx != nr_chunks - 1 && idx % 8 != 0)
+			continue;
+
+		/* manually set the read pointer, then go back to IDLE so the
+		 * next upload chunk starts from the new address */
+		if (!dfu_target_set_address (target,
+					     offset_dev,
+					     cancellable,
+					     error))
+			return FALSE;
+		if (!dfu_device_abort (priv->device, cancellable, error))
+			return FALSE;
+
+		/* read a single chunk of data -- ST uses wBlockNum=0 for
+		 * DfuSe commands and wBlockNum=1 is reserved */
+		if (!dfu_target_upload_chunk_to_buf (target,
+						     0x02,
+						     buf,
+						     (gsize) transfer_size,
+						     &chunk_size,
+						     cancellable,
+						     error))
+			return FALSE;
+
+		/* the last chunk of the element may be incomplete */
+		length = data_sz - offset;
+		if (length > transfer_size)
+			length = transfer_size;
+		if (chunk_size < length) {
+			g_set_error (error,
+				     DFU_ERROR,
+				     DFU_ERROR_VERIFY_FAILED,
+				     "fast verify failed: short read of "
+				     "0x%" G_GSIZE_FORMAT "x at 0x%04x",
+				     chunk_size, offset_dev);
+			return FALSE;
+		}
+		crc_host = dfu_crc32 (data + offset, length);
+		crc_device = dfu_crc32 (buf, length);
+		if (crc_host != crc_device) {
+			g_set_error (error,
+				     DFU_ERROR,
+				     DFU_ERROR_VERIFY_FAILED,
+				     "fast verify failed at 0x%04x: "
+				     "got CRC 0x%08x, expected 0x%08x",
+				     offset_dev, crc_device, crc_host);
+			return FALSE;
+		}
+
+		/* update UI */
+		nr_sampled++;
+		dfu_target_set_percentage (target, offset + length, data_sz);
+	}
+	g_debug ("fast verify sampled %u of %u chunks", nr_sampled, nr_chunks);
+
+	/* abort back to IDLE */
+	if (!dfu_device_abort (priv->device, cancellable, error))
+		return FALSE;
+	dfu_target_set_percentage_raw (target, 100);
+	return TRUE;
+}
+
 static gboolean
 dfu_target_download_element (DfuTarget *target,
 			     DfuElement *element,
@@ -1621,12 +2083,40 @@ dfu_target_download_element (DfuTarget *target,
 							error))
 			return FALSE;
 	} else {
-		if (!dfu_target_download_element_dfu (target,
-						      element,
-						      flags,
-						      cancellable,
-						      error))
-			return FALSE;
+		gboolean ret = FALSE;
+
+		/* try to keep the bus busy by queueing the next chunk behind
+		 * the status poll, unless the device is known to stall */
+		if (!dfu_device_has_quirk (priv->device,
+					   DFU_DEVICE_QUIRK_NO_PIPELINED_DNLOAD)) {
+			g_autoptr(GError) error_local = NULL;
+			ret = dfu_target_download_element_dfu_pipelined (target,
+									 element,
+									 flags,
+									 cancellable,
+									 &error_local);
+			if (!ret) {
+				dfu_device_error_fixup (priv->device,
+							cancellable,
+							&error_local);
+				g_debug ("pipelined download failed, "
+					 "retrying serially: %s",
+					 error_local->message);
+				/* take the device out of dfuERROR */
+				if (!dfu_device_clear_status (priv->device,
+							      cancellable,
+							      NULL))
+					g_debug ("failed to clear status");
+			}
+		}
+		if (!ret) {
+			if (!dfu_target_download_element_dfu (target,
+							      element,
+							      flags,
+							      cancellable,
+							      error))
+				return FALSE;
+		}
 	}
 
 	/* verify */
@@ -1635,6 +2125,23 @@ dfu_target_download_element (DfuTarget *target,
 		GBytes *bytes_tmp;
 		g_autoptr(DfuElement) element_tmp = NULL;
 		dfu_target_set_action (target, DFU_ACTION_VERIFY);
+
+		/* sample the written data rather than reading all of it back;
+		 * DFU 1.1 reports no device-side checksum and a plain upload
+		 * can only stream from the start, so this needs DfuSe */
+		if (flags & DFU_TARGET_TRANSFER_FLAG_VERIFY_FAST) {
+			if (dfu_device_has_dfuse_support (priv->device)) {
+				if (!dfu_target_verify_element_fast (target,
+								     element,
+								     cancellable,
+								     error))
+					return FALSE;
+				dfu_target_set_action (target, DFU_ACTION_IDLE);
+				return TRUE;
+			}
+			g_debug ("fast verify needs DfuSe to seek, "
+				 "falling back to full readback");
+		}
 		bytes = dfu_element_get_contents (element);
 		element_tmp = dfu_target_upload_element (target,
 							 dfu_element_get_address (element),
@@ -1662,31 +2169,20 @@ dfu_target_download_element (DfuTarget *target,
 }
 
 /**
- * dfu_target_download:
+ * dfu_target_download_prepare: (skip)
  * @target: a #DfuTarget
  * @image: a #DfuImage
- * @flags: flags to use, e.g. %DFU_TARGET_TRANSFER_FLAG_VERIFY
- * @cancellable: a #GCancellable, or %NULL
  * @error: a #GError, or %NULL
  *
- * Downloads firmware from the host to the target, optionally verifying
- * the transfer.
+ * Checks the target is able to accept the image before any data is sent,
+ * so that a multi-target download fails early rather than half-way.
  *
  * Return value: %TRUE for success
- *
- * Since: 0.5.4
  **/
 gboolean
-dfu_target_download (DfuTarget *target, DfuImage *image,
-		     DfuTargetTransferFlags flags,
-		     GCancellable *cancellable,
-		     GError **error)
+dfu_target_download_prepare (DfuTarget *target, DfuImage *image, GError **error)
 {
 	DfuTargetPrivate *priv = GET_PRIVATE (target);
-	DfuElement *element;
-	GPtrArray *elements;
-	gboolean ret;
-	guint i;
 
 	g_return_val_if_fail (DFU_IS_TARGET (target), FALSE);
 	g_return_val_if_fail (DFU_IS_IMAGE (image), FALSE);
@@ -1705,44 +2201,146 @@ dfu_target_download (DfuTarget *target, DfuImage *image,
 		return FALSE;
 	}
 
-	/* use correct alt */
-	if (!dfu_target_use_alt_setting (target, error))
-		return FALSE;
-
-	/* download all elements in the image to the device */
-	elements = dfu_image_get_elements (image);
-	if (elements->len == 0) {
+	/* anything to send? */
+	if (dfu_image_get_elements (image)->len == 0) {
 		g_set_error_literal (error,
 				     DFU_ERROR,
 				     DFU_ERROR_INVALID_FILE,
 				     "no image elements");
 		return FALSE;
 	}
-	for (i = 0; i < elements->len; i++) {
-		element = dfu_image_get_element (image, (guint8) i);
-		g_debug ("downloading element at 0x%04x",
-			 dfu_element_get_address (element));
-
-		/* auto-detect missing firmware address -- this assumes
-		 * that the first target is the main program memory and that
-		 * there is only one element in the firmware file */
-		if (flags & DFU_TARGET_TRANSFER_FLAG_ADDR_HEURISTIC &&
-		    dfu_element_get_address (element) == 0x0 &&
-		    elements->len == 1 &&
-		    priv->sectors->len > 0) {
-			DfuSector *sector = g_ptr_array_index (priv->sectors, 0);
-			g_debug ("fixing up firmware address from 0x0 to 0x%x",
-				 dfu_sector_get_address (sector));
-			dfu_element_set_address (element, dfu_sector_get_address (sector));
+
+	/* the erased-sector record only holds within one download */
+	g_hash_table_remove_all (priv->sectors_erased);
+	return TRUE;
+}
+
+/**
+ * dfu_target_download_image_element: (skip)
+ * @target: a #DfuTarget
+ * @image: a #DfuImage
+ * @element_idx: an element index in @image
+ * @flags: flags to use, e.g. %DFU_TARGET_TRANSFER_FLAG_VERIFY
+ * @cancellable: a #GCancellable, or %NULL
+ * @error: a #GError, or %NULL
+ *
+ * Downloads a single image element, selecting the alternate setting first
+ * so downloads to different targets can be interleaved.
+ *
+ * Return value: %TRUE for success
+ **/
+gboolean
+dfu_target_download_image_element (DfuTarget *target,
+				   DfuImage *image,
+				   guint element_idx,
+				   DfuTargetTransferFlags flags,
+				   GCancellable *cancellable,
+				   GError **error)
+{
+	DfuTargetPrivate *priv = GET_PRIVATE (target);
+	DfuElement *element;
+	GPtrArray *elements;
+
+	/* use correct alt */
+	if (!dfu_target_use_alt_setting (target, error))
+		return FALSE;
+
+	elements = dfu_image_get_elements (image);
+	element = dfu_image_get_element (image, (guint8) element_idx);
+	g_debug ("downloading element at 0x%04x",
+		 dfu_element_get_address (element));
+
+	/* auto-detect missing firmware address -- this assumes
+	 * that the first target is the main program memory and that
+	 * there is only one element in the firmware file */
+	if (flags & DFU_TARGET_TRANSFER_FLAG_ADDR_HEURISTIC &&
+	    dfu_element_get_address (element) == 0x0 &&
+	    elements->len == 1 &&
+	    priv->sectors->len > 0) {
+		DfuSector *sector = g_ptr_array_index (priv->sectors, 0);
+		g_debug ("fixing up firmware address from 0x0 to 0x%x",
+			 dfu_sector_get_address (sector));
+		dfu_element_set_address (element, dfu_sector_get_address (sector));
+	}
+
+	/* download to device */
+	return dfu_target_download_element (target,
+					    element,
+					    flags,
+					    cancellable,
+					    error);
+}
+
+/**
+ * dfu_target_download:
+ * @target: a #DfuTarget
+ * @image: a #DfuImage
+ * @flags: flags to use, e.g. %DFU_TARGET_TRANSFER_FLAG_VERIFY
+ * @cancellable: a #GCancellable, or %NULL
+ * @error: a #GError, or %NULL
+ *
+ * Downloads firmware from the host to the target, optionally verifying
+ * the transfer.
+ *
+ * Return value: %TRUE for success
+ *
+ * Since: 0.5.4
+ **/
+gboolean
+dfu_target_download (DfuTarget *target, DfuImage *image,
+		     DfuTargetTransferFlags flags,
+		     GCancellable *cancellable,
+		     GError **error)
+{
+	DfuTargetPrivate *priv = GET_PRIVATE (target);
+	GPtrArray *elements;
+	guint i;
+
+	g_return_val_if_fail (DFU_IS_TARGET (target), FALSE);
+	g_return_val_if_fail (DFU_IS_IMAGE (image), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* ensure populated and able to download */
+	if (!dfu_target_download_prepare (target, image, error))
+		return FALSE;
+
+	/* a sparse raw image addresses its elements by file offset from
+	 * zero, so rebase the whole set onto the first sector; the
+	 * single-element case is handled by the per-element heuristic */
+	elements = dfu_image_get_elements (image);
+	if (flags & DFU_TARGET_TRANSFER_FLAG_ADDR_HEURISTIC &&
+	    elements->len > 1 &&
+	    priv->sectors->len > 0) {
+		DfuElement *element_first = g_ptr_array_index (elements, 0);
+		DfuSector *sector = g_ptr_array_index (priv->sectors, 0);
+		guint32 base = dfu_sector_get_address (sector);
+
+		/* file offsets all sit below the flash base address */
+		if (dfu_element_get_address (element_first) < base) {
+			g_debug ("rebasing %u elements from 0x%x to 0x%x",
+				 elements->len,
+				 dfu_element_get_address (element_first),
+				 base);
+			for (i = 0; i < elements->len; i++) {
+				DfuElement *element = g_ptr_array_index (elements, i);
+				dfu_element_set_address (element,
+							 dfu_element_get_address (element) + base);
+			}
 		}
+	}
+
+	/* join elements separated by a hole smaller than one transfer so
+	 * that fewer address-setup and transfer sequences are needed */
+	dfu_image_merge_elements (image,
+				  dfu_device_get_transfer_size (priv->device),
+				  0xff);
 
-		/* download to device */
-		ret = dfu_target_download_element (target,
-						   element,
-						   flags,
-						   cancellable,
-						   error);
-		if (!ret)
+	/* download all elements in the image to the device */
+	elements = dfu_image_get_elements (image);
+	for (i = 0; i < elements->len; i++) {
+		if (!dfu_target_download_image_element (target, image, i,
+							flags, cancellable,
+							error))
 			return FALSE;
 	}
 
@@ -1767,6 +2365,96 @@ dfu_target_download (DfuTarget *target, DfuImage *image,
 	return TRUE;
 }
 
+typedef struct {
+	DfuImage		*image;
+	DfuTargetTransferFlags	 flags;
+} DfuTargetDownloadHelper;
+
+static void
+dfu_target_download_helper_free (DfuTargetDownloadHelper *helper)
+{
+	g_object_unref (helper->image);
+	g_free (helper);
+}
+
+static void
+dfu_target_download_thread_cb (GTask *task,
+			       gpointer source_object,
+			       gpointer task_data,
+			       GCancellable *cancellable)
+{
+	DfuTarget *target = DFU_TARGET (source_object);
+	DfuTargetDownloadHelper *helper = (DfuTargetDownloadHelper *) task_data;
+	GError *error = NULL;
+
+	if (!dfu_target_download (target, helper->image, helper->flags,
+				  cancellable, &error)) {
+		g_task_return_error (task, error);
+		return;
+	}
+	g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * dfu_target_download_async:
+ * @target: a #DfuTarget
+ * @image: a #DfuImage
+ * @flags: flags to use, e.g. %DFU_TARGET_TRANSFER_FLAG_VERIFY
+ * @cancellable: a #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @user_data: the data to pass to @callback
+ *
+ * Downloads firmware from the host to the target without blocking the
+ * calling context. The bulk data phase is pipelined over asynchronous
+ * USB transfers and @cancellable is checked between each chunk.
+ *
+ * Since: 0.9.5
+ **/
+void
+dfu_target_download_async (DfuTarget *target, DfuImage *image,
+			   DfuTargetTransferFlags flags,
+			   GCancellable *cancellable,
+			   GAsyncReadyCallback callback,
+			   gpointer user_data)
+{
+	DfuTargetDownloadHelper *helper;
+	g_autoptr(GTask) task = NULL;
+
+	g_return_if_fail (DFU_IS_TARGET (target));
+	g_return_if_fail (DFU_IS_IMAGE (image));
+
+	helper = g_new0 (DfuTargetDownloadHelper, 1);
+	helper->image = g_object_ref (image);
+	helper->flags = flags;
+	task = g_task_new (target, cancellable, callback, user_data);
+	g_task_set_task_data (task, helper,
+			      (GDestroyNotify) dfu_target_download_helper_free);
+	g_task_run_in_thread (task, dfu_target_download_thread_cb);
+}
+
+/**
+ * dfu_target_download_finish:
+ * @target: a #DfuTarget
+ * @res: the #GAsyncResult
+ * @error: a #GError, or %NULL
+ *
+ * Gets the result of dfu_target_download_async().
+ *
+ * Return value: %TRUE for success
+ *
+ * Since: 0.9.5
+ **/
+gboolean
+dfu_target_download_finish (DfuTarget *target,
+			    GAsyncResult *res,
+			    GError **error)
+{
+	g_return_val_if_fail (DFU_IS_TARGET (target), FALSE);
+	g_return_val_if_fail (g_task_is_valid (res, target), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+	return g_task_propagate_boolean (G_TASK (res), error);
+}
+
 #if 0
 static gboolean
 dfu_target_get_commands (DfuTarget *target,
@@ -64,6 +64,8 @@ struct _DfuTargetClass
  * @DFU_TARGET_TRANSFER_FLAG_WILDCARD_PID:	Allow downloading images with wildcard PIDs
  * @DFU_TARGET_TRANSFER_FLAG_ANY_CIPHER:	Allow any cipher kinds to be downloaded
  * @DFU_TARGET_TRANSFER_FLAG_ADDR_HEURISTIC:	Automatically detect the address to use
+ * @DFU_TARGET_TRANSFER_FLAG_VERIFY_FAST:	Verify only a sample of the download
+ * @DFU_TARGET_TRANSFER_FLAG_SKIP_UNCHANGED:	Only erase and write sectors that differ
  *
  * The optional flags used for transfering firmware.
  **/
@@ -77,6 +79,8 @@ typedef enum {
 	DFU_TARGET_TRANSFER_FLAG_WILDCARD_PID	= (1 << 5),
 	DFU_TARGET_TRANSFER_FLAG_ANY_CIPHER	= (1 << 6),
 	DFU_TARGET_TRANSFER_FLAG_ADDR_HEURISTIC	= (1 << 7),
+	DFU_TARGET_TRANSFER_FLAG_VERIFY_FAST	= (1 << 8),
+	DFU_TARGET_TRANSFER_FLAG_SKIP_UNCHANGED	= (1 << 9),
 	/*< private >*/
 	DFU_TARGET_TRANSFER_FLAG_LAST
 } DfuTargetTransferFlags;
@@ -96,6 +100,15 @@ gboolean	 dfu_target_download			(DfuTarget	*target,
 							 DfuTargetTransferFlags flags,
 							 GCancellable	*cancellable,
 							 GError		**error);
+void		 dfu_target_download_async		(DfuTarget	*target,
+							 DfuImage	*image,
+							 DfuTargetTransferFlags flags,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 user_data);
+gboolean	 dfu_target_download_finish		(DfuTarget	*target,
+							 GAsyncResult	*res,
+							 GError		**error);
 DfuCipherKind	 dfu_target_get_cipher_kind		(DfuTarget	*target);
 
 G_END_DECLS
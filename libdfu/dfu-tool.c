@@ -33,13 +33,22 @@
 #include "dfu-cipher-xtea.h"
 #include "dfu-device-private.h"
 #include "dfu-progress-bar.h"
+#include "dfu-target-private.h"
 
 typedef struct {
 	GCancellable		*cancellable;
 	GPtrArray		*cmd_array;
 	gboolean		 force;
+	gboolean		 probe_cache;
+	gboolean		 differential;
+	gint			 quiesce_timeout;
 	gchar			*device_vid_pid;
+	gchar			*all_matching;
+	gchar			*verify;
 	guint16			 transfer_size;
+	gint			 progress_fd;
+	DfuAction		 current_action;
+	DfuDevice		*last_device;
 	DfuProgressBar		*progress_bar;
 } DfuToolPrivate;
 
@@ -61,6 +70,10 @@ dfu_tool_private_free (DfuToolPrivate *priv)
 	if (priv == NULL)
 		return;
 	g_free (priv->device_vid_pid);
+	g_free (priv->all_matching);
+	g_free (priv->verify);
+	if (priv->last_device != NULL)
+		g_object_unref (priv->last_device);
 	g_object_unref (priv->cancellable);
 	if (priv->cmd_array != NULL)
 		g_ptr_array_unref (priv->cmd_array);
@@ -195,6 +208,155 @@ dfu_tool_run (DfuToolPrivate *priv,
 	return FALSE;
 }
 
+static gboolean
+dfu_tool_parse_vid_pid (const gchar *str,
+			guint16 *vid_out,
+			guint16 *pid_out,
+			GError **error)
+{
+	gchar *tmp;
+	guint64 pid;
+	guint64 vid;
+
+	vid = g_ascii_strtoull (str, &tmp, 16);
+	if (vid == 0 || vid > G_MAXUINT16 || tmp[0] != ':') {
+		g_set_error_literal (error,
+				     DFU_ERROR,
+				     DFU_ERROR_INTERNAL,
+				     "Invalid format of VID:PID");
+		return FALSE;
+	}
+	pid = g_ascii_strtoull (tmp + 1, NULL, 16);
+	if (pid == 0 || pid > G_MAXUINT16) {
+		g_set_error_literal (error,
+				     DFU_ERROR,
+				     DFU_ERROR_INTERNAL,
+				     "Invalid format of VID:PID");
+		return FALSE;
+	}
+	*vid_out = (guint16) vid;
+	*pid_out = (guint16) pid;
+	return TRUE;
+}
+
+static gchar *
+dfu_tool_get_probe_cache_path (void)
+{
+	return g_build_filename (g_get_user_cache_dir (),
+				 "dfu-tool",
+				 "probe.cache",
+				 NULL);
+}
+
+static gchar *
+dfu_tool_get_probe_cache_group (DfuDevice *device)
+{
+	GUsbDevice *dev = dfu_device_get_usb_dev (device);
+	if (dev == NULL)
+		return NULL;
+	return g_strdup_printf ("%02x:%02x:%04x:%04x:%04x",
+				g_usb_device_get_bus (dev),
+				g_usb_device_get_address (dev),
+				g_usb_device_get_vid (dev),
+				g_usb_device_get_pid (dev),
+				g_usb_device_get_release (dev));
+}
+
+static void
+dfu_tool_probe_cache_apply (DfuToolPrivate *priv, DfuDevice *device)
+{
+	GPtrArray *targets;
+	gint transfer_size;
+	guint i;
+	g_autofree gchar *fn = NULL;
+	g_autofree gchar *group = NULL;
+	g_autoptr(GKeyFile) keyfile = NULL;
+
+	if (!priv->probe_cache)
+		return;
+	group = dfu_tool_get_probe_cache_group (device);
+	if (group == NULL)
+		return;
+	fn = dfu_tool_get_probe_cache_path ();
+	keyfile = g_key_file_new ();
+	if (!g_key_file_load_from_file (keyfile, fn, G_KEY_FILE_NONE, NULL))
+		return;
+	if (!g_key_file_has_group (keyfile, group))
+		return;
+
+	/* the functional descriptor is sometimes wrong, and re-probing the
+	 * largest working size takes whole seconds */
+	transfer_size = g_key_file_get_integer (keyfile, group,
+						"TransferSize", NULL);
+	if (transfer_size > 0)
+		dfu_device_set_transfer_size (device, (guint16) transfer_size);
+
+	/* seed each target's sector map so the string descriptors never
+	 * have to be read back from the device */
+	targets = dfu_device_get_targets (device);
+	for (i = 0; i < targets->len; i++) {
+		DfuTarget *target = g_ptr_array_index (targets, i);
+		g_autofree gchar *alt_name = NULL;
+		g_autofree gchar *key = NULL;
+		g_autoptr(GError) error_local = NULL;
+		key = g_strdup_printf ("AltName0x%02x",
+				       dfu_target_get_alt_setting (target));
+		alt_name = g_key_file_get_string (keyfile, group, key, NULL);
+		if (alt_name == NULL)
+			continue;
+		if (!dfu_target_setup_with_alt_name (target, alt_name,
+						     &error_local)) {
+			g_debug ("failed to seed %s: %s",
+				 key, error_local->message);
+		}
+	}
+	g_debug ("applied probe cache for %s", group);
+}
+
+static void
+dfu_tool_probe_cache_save (DfuToolPrivate *priv, DfuDevice *device)
+{
+	GPtrArray *targets;
+	guint i;
+	g_autofree gchar *dirname = NULL;
+	g_autofree gchar *fn = NULL;
+	g_autofree gchar *group = NULL;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GKeyFile) keyfile = NULL;
+
+	if (!priv->probe_cache)
+		return;
+	group = dfu_tool_get_probe_cache_group (device);
+	if (group == NULL)
+		return;
+
+	/* merge into the existing cache file */
+	fn = dfu_tool_get_probe_cache_path ();
+	keyfile = g_key_file_new ();
+	g_key_file_load_from_file (keyfile, fn, G_KEY_FILE_KEEP_COMMENTS, NULL);
+	g_key_file_set_integer (keyfile, group, "TransferSize",
+				dfu_device_get_transfer_size (device));
+	targets = dfu_device_get_targets (device);
+	for (i = 0; i < targets->len; i++) {
+		DfuTarget *target = g_ptr_array_index (targets, i);
+		const gchar *alt_name;
+		g_autofree gchar *key = NULL;
+
+		/* only already-probed targets have this without more I/O */
+		alt_name = dfu_target_get_alt_name (target, NULL);
+		if (alt_name == NULL)
+			continue;
+		key = g_strdup_printf ("AltName0x%02x",
+				       dfu_target_get_alt_setting (target));
+		g_key_file_set_string (keyfile, group, key, alt_name);
+	}
+	dirname = g_path_get_dirname (fn);
+	if (g_mkdir_with_parents (dirname, 0700) != 0)
+		return;
+	if (!g_key_file_save_to_file (keyfile, fn, &error_local))
+		g_debug ("failed to save probe cache: %s", error_local->message);
+}
+
 static DfuDevice *
 dfu_tool_get_defalt_device (DfuToolPrivate *priv, GError **error)
 {
@@ -207,39 +369,18 @@ dfu_tool_get_defalt_device (DfuToolPrivate *priv, GError **error)
 
 	/* we specified it manually */
 	if (priv->device_vid_pid != NULL) {
-		gchar *tmp;
-		guint64 pid;
-		guint64 vid;
+		guint16 pid = 0;
+		guint16 vid = 0;
 
 		/* parse */
-		vid = g_ascii_strtoull (priv->device_vid_pid, &tmp, 16);
-		if (vid == 0 || vid > G_MAXUINT16) {
-			g_set_error_literal (error,
-					     DFU_ERROR,
-					     DFU_ERROR_INTERNAL,
-					     "Invalid format of VID:PID");
-			return NULL;
-		}
-		if (tmp[0] != ':') {
-			g_set_error_literal (error,
-					     DFU_ERROR,
-					     DFU_ERROR_INTERNAL,
-					     "Invalid format of VID:PID");
+		if (!dfu_tool_parse_vid_pid (priv->device_vid_pid,
+					     &vid, &pid, error))
 			return NULL;
-		}
-		pid = g_ascii_strtoull (tmp + 1, NULL, 16);
-		if (pid == 0 || pid > G_MAXUINT16) {
-			g_set_error_literal (error,
-					     DFU_ERROR,
-					     DFU_ERROR_INTERNAL,
-					     "Invalid format of VID:PID");
-			return NULL;
-		}
 
 		/* find device */
 		device = dfu_context_get_device_by_vid_pid (dfu_context,
-							    (guint16) vid,
-							    (guint16) pid,
+							    vid,
+							    pid,
 							    error);
 		if (device == NULL)
 			return NULL;
@@ -254,6 +395,11 @@ dfu_tool_get_defalt_device (DfuToolPrivate *priv, GError **error)
 	g_object_set_data_full (G_OBJECT (device), "DfuContext",
 				g_object_ref (dfu_context),
 				(GDestroyNotify) g_object_unref);
+
+	/* apply any cached probe data, and remember the device so the cache
+	 * can be refreshed once the command has run */
+	dfu_tool_probe_cache_apply (priv, device);
+	g_set_object (&priv->last_device, device);
 	return device;
 }
 
@@ -1091,11 +1237,50 @@ dfu_tool_attach (DfuToolPrivate *priv, gchar **values, GError **error)
 	return TRUE;
 }
 
+static gboolean
+dfu_tool_probe_transfer_size (DfuToolPrivate *priv, gchar **values, GError **error)
+{
+	g_autoptr(DfuDevice) device = NULL;
+
+	device = dfu_tool_get_defalt_device (priv, error);
+	if (device == NULL)
+		return FALSE;
+	if (!dfu_device_open (device,
+			      DFU_DEVICE_OPEN_FLAG_NONE,
+			      priv->cancellable,
+			      error))
+		return FALSE;
+	if (!dfu_device_probe_transfer_size (device, priv->cancellable, error))
+		return FALSE;
+	g_print ("%u\n", dfu_device_get_transfer_size (device));
+	return TRUE;
+}
+
+static void
+fu_tool_progress_fd_write (DfuToolPrivate *priv, guint percentage)
+{
+	guint8 buf[4];
+
+	/* compact fixed-size record for machine consumption: magic byte,
+	 * current action, percentage, then an XOR check byte so a reader
+	 * joining mid-stream can resynchronize */
+	buf[0] = 0xd5;
+	buf[1] = (guint8) priv->current_action;
+	buf[2] = (guint8) percentage;
+	buf[3] = buf[0] ^ buf[1] ^ buf[2];
+	if (write (priv->progress_fd, buf, sizeof (buf)) != (gssize) sizeof (buf))
+		g_debug ("failed to write progress record");
+}
+
 static void
 fu_tool_percentage_changed_cb (DfuDevice *device,
 			       guint percentage,
 			       DfuToolPrivate *priv)
 {
+	if (priv->progress_fd >= 0) {
+		fu_tool_progress_fd_write (priv, percentage);
+		return;
+	}
 	dfu_progress_bar_set_percentage (priv->progress_bar, percentage);
 }
 
@@ -1104,6 +1289,11 @@ fu_tool_action_changed_cb (DfuDevice *device,
 			   DfuAction action,
 			   DfuToolPrivate *priv)
 {
+	priv->current_action = action;
+	if (priv->progress_fd >= 0) {
+		fu_tool_progress_fd_write (priv, action == DFU_ACTION_IDLE ? 100 : 0);
+		return;
+	}
 	switch (action) {
 	case DFU_ACTION_IDLE:
 		dfu_progress_bar_set_percentage (priv->progress_bar, 100);
@@ -1396,6 +1586,102 @@ dfu_tool_watch_cancelled_cb (GCancellable *cancellable, gpointer user_data)
 	g_main_loop_quit (loop);
 }
 
+/* how long to wait for the rest of a hotplug burst, e.g. from a hub */
+#define DFU_TOOL_WATCH_BATCH_MS		250
+
+typedef struct {
+	DfuToolPrivate	*priv;
+	GMainLoop	*loop;
+	GPtrArray	*devices_pending;
+	guint		 batch_id;
+	guint		 quiesce_id;
+} DfuToolWatchHelper;
+
+static gboolean
+dfu_tool_watch_quiesce_cb (gpointer user_data)
+{
+	DfuToolWatchHelper *helper = (DfuToolWatchHelper *) user_data;
+	/* TRANSLATORS: the watch is exiting as the bus has been idle */
+	g_print ("%s\n", _("No device activity, exiting"));
+	helper->quiesce_id = 0;
+	g_main_loop_quit (helper->loop);
+	return FALSE;
+}
+
+static void
+dfu_tool_watch_rearm_quiesce (DfuToolWatchHelper *helper)
+{
+	if (helper->priv->quiesce_timeout <= 0)
+		return;
+	if (helper->quiesce_id != 0)
+		g_source_remove (helper->quiesce_id);
+	helper->quiesce_id = g_timeout_add_seconds (helper->priv->quiesce_timeout,
+						    dfu_tool_watch_quiesce_cb,
+						    helper);
+}
+
+static gboolean
+dfu_tool_watch_flush_cb (gpointer user_data)
+{
+	DfuToolWatchHelper *helper = (DfuToolWatchHelper *) user_data;
+	DfuDevice *device;
+	guint i;
+
+	/* print everything that arrived in the burst as one report */
+	helper->batch_id = 0;
+	if (helper->devices_pending->len > 1) {
+		/* TRANSLATORS: several devices arrived at the same time,
+		 * e.g. when a hub was plugged in */
+		g_print (_("%u devices added:\n"), helper->devices_pending->len);
+	}
+	for (i = 0; i < helper->devices_pending->len; i++) {
+		device = g_ptr_array_index (helper->devices_pending, i);
+		dfu_tool_device_added_cb (NULL, device, helper->priv);
+	}
+	g_ptr_array_set_size (helper->devices_pending, 0);
+	return FALSE;
+}
+
+static void
+dfu_tool_watch_device_added_cb (DfuContext *context,
+				DfuDevice *device,
+				gpointer user_data)
+{
+	DfuToolWatchHelper *helper = (DfuToolWatchHelper *) user_data;
+
+	/* wait a short time for the rest of the burst before printing */
+	g_ptr_array_add (helper->devices_pending, g_object_ref (device));
+	if (helper->batch_id == 0) {
+		helper->batch_id = g_timeout_add (DFU_TOOL_WATCH_BATCH_MS,
+						  dfu_tool_watch_flush_cb,
+						  helper);
+	}
+	dfu_tool_watch_rearm_quiesce (helper);
+}
+
+static void
+dfu_tool_watch_device_removed_cb (DfuContext *context,
+				  DfuDevice *device,
+				  gpointer user_data)
+{
+	DfuToolWatchHelper *helper = (DfuToolWatchHelper *) user_data;
+
+	/* never announced, so just drop it from the pending batch */
+	if (!g_ptr_array_remove (helper->devices_pending, device))
+		dfu_tool_device_removed_cb (context, device, helper->priv);
+	dfu_tool_watch_rearm_quiesce (helper);
+}
+
+static void
+dfu_tool_watch_device_changed_cb (DfuContext *context,
+				  DfuDevice *device,
+				  gpointer user_data)
+{
+	DfuToolWatchHelper *helper = (DfuToolWatchHelper *) user_data;
+	dfu_tool_device_changed_cb (context, device, helper->priv);
+	dfu_tool_watch_rearm_quiesce (helper);
+}
+
 static guint8 *
 dfu_tool_get_firmware_contents_default (DfuFirmware *firmware,
 					gsize *length,
@@ -1603,9 +1889,11 @@ dfu_tool_watch (DfuToolPrivate *priv, gchar **values, GError **error)
 {
 	guint i;
 	DfuDevice *device;
+	DfuToolWatchHelper helper;
 	g_autoptr(DfuContext) dfu_context = NULL;
 	g_autoptr(GMainLoop) loop = NULL;
 	g_autoptr(GPtrArray) devices = NULL;
+	g_autoptr(GPtrArray) devices_pending = NULL;
 
 	/* get all the DFU devices */
 	dfu_context = dfu_context_new ();
@@ -1618,17 +1906,33 @@ dfu_tool_watch (DfuToolPrivate *priv, gchar **values, GError **error)
 		dfu_tool_device_added_cb (dfu_context, device, priv);
 	}
 
-	/* watch for any hotplugged device */
+	/* watch for any hotplugged device; there are no periodic sources
+	 * here so the process sleeps until the kernel reports an event */
 	loop = g_main_loop_new (NULL, FALSE);
+	devices_pending = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	helper.priv = priv;
+	helper.loop = loop;
+	helper.devices_pending = devices_pending;
+	helper.batch_id = 0;
+	helper.quiesce_id = 0;
 	g_signal_connect (dfu_context, "device-added",
-			  G_CALLBACK (dfu_tool_device_added_cb), priv);
+			  G_CALLBACK (dfu_tool_watch_device_added_cb), &helper);
 	g_signal_connect (dfu_context, "device-removed",
-			  G_CALLBACK (dfu_tool_device_removed_cb), priv);
+			  G_CALLBACK (dfu_tool_watch_device_removed_cb), &helper);
 	g_signal_connect (dfu_context, "device-changed",
-			  G_CALLBACK (dfu_tool_device_changed_cb), priv);
+			  G_CALLBACK (dfu_tool_watch_device_changed_cb), &helper);
 	g_signal_connect (priv->cancellable, "cancelled",
 			  G_CALLBACK (dfu_tool_watch_cancelled_cb), loop);
+	dfu_tool_watch_rearm_quiesce (&helper);
 	g_main_loop_run (loop);
+
+	/* show anything that arrived just before we quit */
+	if (helper.batch_id != 0) {
+		g_source_remove (helper.batch_id);
+		dfu_tool_watch_flush_cb (&helper);
+	}
+	if (helper.quiesce_id != 0)
+		g_source_remove (helper.quiesce_id);
 	return TRUE;
 }
 
@@ -1675,11 +1979,35 @@ dfu_tool_dump (DfuToolPrivate *priv, gchar **values, GError **error)
 	return TRUE;
 }
 
+static gboolean
+dfu_tool_get_verify_flags (DfuToolPrivate *priv,
+			   DfuTargetTransferFlags *flags,
+			   GError **error)
+{
+	if (priv->verify == NULL || g_strcmp0 (priv->verify, "full") == 0) {
+		*flags |= DFU_TARGET_TRANSFER_FLAG_VERIFY;
+		return TRUE;
+	}
+	if (g_strcmp0 (priv->verify, "fast") == 0) {
+		*flags |= DFU_TARGET_TRANSFER_FLAG_VERIFY;
+		*flags |= DFU_TARGET_TRANSFER_FLAG_VERIFY_FAST;
+		return TRUE;
+	}
+	if (g_strcmp0 (priv->verify, "none") == 0)
+		return TRUE;
+	g_set_error (error,
+		     DFU_ERROR,
+		     DFU_ERROR_INTERNAL,
+		     "Invalid verify mode '%s', expected full|fast|none",
+		     priv->verify);
+	return FALSE;
+}
+
 static gboolean
 dfu_tool_write_alt (DfuToolPrivate *priv, gchar **values, GError **error)
 {
 	DfuImage *image;
-	DfuTargetTransferFlags flags = DFU_TARGET_TRANSFER_FLAG_VERIFY;
+	DfuTargetTransferFlags flags = DFU_TARGET_TRANSFER_FLAG_NONE;
 	g_autofree gchar *str_debug = NULL;
 	g_autoptr(DfuDevice) device = NULL;
 	g_autoptr(DfuFirmware) firmware = NULL;
@@ -1697,6 +2025,14 @@ dfu_tool_write_alt (DfuToolPrivate *priv, gchar **values, GError **error)
 		return FALSE;
 	}
 
+	/* get the verification mode */
+	if (!dfu_tool_get_verify_flags (priv, &flags, error))
+		return FALSE;
+
+	/* only touch the sectors that changed */
+	if (priv->differential)
+		flags |= DFU_TARGET_TRANSFER_FLAG_SKIP_UNCHANGED;
+
 	/* open file */
 	firmware = dfu_firmware_new ();
 	file = g_file_new_for_path (values[0]);
@@ -1817,10 +2153,142 @@ dfu_tool_write_alt (DfuToolPrivate *priv, gchar **values, GError **error)
 	return TRUE;
 }
 
+typedef struct {
+	DfuToolPrivate	*priv;
+	DfuDevice	*device;	/* not refcounted */
+	DfuFirmware	*firmware;	/* not refcounted */
+	GThread		*thread;
+	GError		*error;
+	gboolean	 ret;
+} DfuToolWriteTask;
+
+static gpointer
+dfu_tool_write_worker_cb (gpointer user_data)
+{
+	DfuToolWriteTask *task = (DfuToolWriteTask *) user_data;
+	DfuTargetTransferFlags flags = DFU_TARGET_TRANSFER_FLAG_NONE;
+
+	/* get the verification mode */
+	if (!dfu_tool_get_verify_flags (task->priv, &flags, &task->error))
+		return NULL;
+
+	/* only touch the sectors that changed */
+	if (task->priv->differential)
+		flags |= DFU_TARGET_TRANSFER_FLAG_SKIP_UNCHANGED;
+
+	/* open the device */
+	if (!dfu_device_open (task->device,
+			      DFU_DEVICE_OPEN_FLAG_NONE,
+			      task->priv->cancellable,
+			      &task->error))
+		return NULL;
+
+	/* put in correct mode */
+	if (dfu_device_get_mode (task->device) == DFU_MODE_RUNTIME) {
+		flags |= DFU_TARGET_TRANSFER_FLAG_DETACH;
+		flags |= DFU_TARGET_TRANSFER_FLAG_ATTACH;
+		flags |= DFU_TARGET_TRANSFER_FLAG_WAIT_RUNTIME;
+	}
+
+	/* allow wildcards */
+	if (task->priv->force) {
+		flags |= DFU_TARGET_TRANSFER_FLAG_WILDCARD_VID;
+		flags |= DFU_TARGET_TRANSFER_FLAG_WILDCARD_PID;
+		flags |= DFU_TARGET_TRANSFER_FLAG_ANY_CIPHER;
+	}
+
+	/* transfer */
+	task->ret = dfu_device_download (task->device,
+					 task->firmware,
+					 flags,
+					 task->priv->cancellable,
+					 &task->error);
+	return NULL;
+}
+
+static gboolean
+dfu_tool_write_all_matching (DfuToolPrivate *priv,
+			     DfuFirmware *firmware,
+			     GError **error)
+{
+	GPtrArray *devices;
+	guint nr_failed = 0;
+	guint16 pid = 0;
+	guint16 vid = 0;
+	g_autoptr(DfuContext) dfu_context = NULL;
+	g_autoptr(GPtrArray) tasks = NULL;
+
+	/* parse */
+	if (!dfu_tool_parse_vid_pid (priv->all_matching, &vid, &pid, error))
+		return FALSE;
+
+	/* enumerate the bus just once for all the devices */
+	dfu_context = dfu_context_new ();
+	dfu_context_enumerate (dfu_context, NULL);
+	devices = dfu_context_get_devices (dfu_context);
+	tasks = g_ptr_array_new_with_free_func (g_free);
+	for (guint i = 0; i < devices->len; i++) {
+		DfuDevice *device = g_ptr_array_index (devices, i);
+		DfuToolWriteTask *task;
+		GUsbDevice *usb_dev = dfu_device_get_usb_dev (device);
+		if (usb_dev == NULL)
+			continue;
+		if (g_usb_device_get_vid (usb_dev) != vid ||
+		    g_usb_device_get_pid (usb_dev) != pid)
+			continue;
+		task = g_new0 (DfuToolWriteTask, 1);
+		task->priv = priv;
+		task->device = device;
+		task->firmware = firmware;
+		g_ptr_array_add (tasks, task);
+	}
+	if (tasks->len == 0) {
+		g_set_error (error,
+			     DFU_ERROR,
+			     DFU_ERROR_NOT_FOUND,
+			     "no attached devices matched %s",
+			     priv->all_matching);
+		return FALSE;
+	}
+
+	/* flash all the devices at the same time; the shared progress bar
+	 * cannot show N rows so per-device results are printed instead */
+	g_print ("Flashing %u devices...\n", tasks->len);
+	for (guint i = 0; i < tasks->len; i++) {
+		DfuToolWriteTask *task = g_ptr_array_index (tasks, i);
+		task->thread = g_thread_new ("dfu-write",
+					     dfu_tool_write_worker_cb,
+					     task);
+	}
+	for (guint i = 0; i < tasks->len; i++) {
+		DfuToolWriteTask *task = g_ptr_array_index (tasks, i);
+		g_thread_join (task->thread);
+		g_print ("%s: %s\n",
+			 dfu_device_get_platform_id (task->device),
+			 task->ret ? "OK" : task->error->message);
+		if (!task->ret)
+			nr_failed++;
+		g_clear_error (&task->error);
+	}
+
+	/* summary */
+	if (nr_failed > 0) {
+		g_set_error (error,
+			     DFU_ERROR,
+			     DFU_ERROR_INTERNAL,
+			     "%u of %u devices failed to flash",
+			     nr_failed, tasks->len);
+		return FALSE;
+	}
+	g_print ("%u bytes successfully downloaded to %u devices\n",
+		 dfu_firmware_get_size (firmware), tasks->len);
+	return TRUE;
+}
+
 static gboolean
 dfu_tool_write (DfuToolPrivate *priv, gchar **values, GError **error)
 {
-	DfuTargetTransferFlags flags = DFU_TARGET_TRANSFER_FLAG_VERIFY;
+	DfuTargetTransferFlags flags = DFU_TARGET_TRANSFER_FLAG_NONE;
 	g_autofree gchar *str_debug = NULL;
 	g_autoptr(DfuDevice) device = NULL;
 	g_autoptr(DfuFirmware) firmware = NULL;
@@ -1835,6 +2303,14 @@ dfu_tool_write (DfuToolPrivate *priv, gchar **values, GError **error)
 		return FALSE;
 	}
 
+	/* get the verification mode */
+	if (!dfu_tool_get_verify_flags (priv, &flags, error))
+		return FALSE;
+
+	/* only touch the sectors that changed */
+	if (priv->differential)
+		flags |= DFU_TARGET_TRANSFER_FLAG_SKIP_UNCHANGED;
+
 	/* open file */
 	firmware = dfu_firmware_new ();
 	file = g_file_new_for_path (values[0]);
@@ -1843,6 +2319,10 @@ dfu_tool_write (DfuToolPrivate *priv, gchar **values, GError **error)
 				      priv->cancellable, error))
 		return FALSE;
 
+	/* flash every matching device in parallel */
+	if (priv->all_matching != NULL)
+		return dfu_tool_write_all_matching (priv, firmware, error);
+
 	/* open correct device */
 	device = dfu_tool_get_defalt_device (priv, error);
 	if (device == NULL)
@@ -2095,15 +2575,30 @@ main (int argc, char *argv[])
 			"Print verbose debug statements", NULL },
 		{ "device", 'd', 0, G_OPTION_ARG_STRING, &priv->device_vid_pid,
 			"Specify Vendor/Product ID(s) of DFU device", "VID:PID" },
+		{ "all-matching", '\0', 0, G_OPTION_ARG_STRING, &priv->all_matching,
+			"Flash all devices matching Vendor/Product ID(s)", "VID:PID" },
 		{ "transfer-size", 't', 0, G_OPTION_ARG_STRING, &priv->transfer_size,
 			"Specify the number of bytes per USB transfer", "BYTES" },
 		{ "force", '\0', 0, G_OPTION_ARG_NONE, &priv->force,
 			"Force the action ignoring all warnings", NULL },
+		{ "verify", '\0', 0, G_OPTION_ARG_STRING, &priv->verify,
+			"Set the download verification mode, full|fast|none", "MODE" },
+		{ "progress-fd", '\0', 0, G_OPTION_ARG_INT, &priv->progress_fd,
+			"Write binary progress records to this file descriptor", "FD" },
+		{ "probe-cache", '\0', 0, G_OPTION_ARG_NONE, &priv->probe_cache,
+			"Use an on-disk cache of device probe data", NULL },
+		{ "differential", '\0', 0, G_OPTION_ARG_NONE, &priv->differential,
+			"Only erase and write the sectors that changed", NULL },
+		{ "quiesce-timeout", '\0', 0, G_OPTION_ARG_INT, &priv->quiesce_timeout,
+			"Exit the watch after this many idle seconds", "SECONDS" },
 		{ NULL}
 	};
 
 	setlocale (LC_ALL, "");
 
+	/* fd 0 is valid, so use -1 for 'not set' */
+	priv->progress_fd = -1;
+
 	bindtextdomain (GETTEXT_PACKAGE, LOCALEDIR);
 	bind_textdomain_codeset (GETTEXT_PACKAGE, "UTF-8");
 	textdomain (GETTEXT_PACKAGE);
@@ -2170,6 +2665,12 @@ main (int argc, char *argv[])
 		     /* TRANSLATORS: command description */
 		     _("Attach DFU capable device back to runtime"),
 		     dfu_tool_attach);
+	dfu_tool_add (priv->cmd_array,
+		     "probe-transfer-size",
+		     NULL,
+		     /* TRANSLATORS: command description */
+		     _("Probe the largest working transfer size"),
+		     dfu_tool_probe_transfer_size);
 	dfu_tool_add (priv->cmd_array,
 		     "read",
 		     NULL,
@@ -2298,6 +2799,10 @@ main (int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 
+	/* remember what was probed for next time */
+	if (priv->last_device != NULL)
+		dfu_tool_probe_cache_save (priv, priv->last_device);
+
 	/* success/ */
 	g_object_unref (priv->progress_bar);
 	return EXIT_SUCCESS;
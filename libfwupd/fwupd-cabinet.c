@@ -0,0 +1,386 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2017 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <archive.h>
+#include <archive_entry.h>
+#include <string.h>
+
+#include "fwupd-cabinet-private.h"
+#include "fwupd-device.h"
+#include "fwupd-error.h"
+#include "fwupd-release.h"
+
+/**
+ * fwupd_cabinet_get_metainfo_blobs:
+ * @fd: an open file descriptor for the cabinet archive
+ * @error: the #GError, or %NULL
+ *
+ * Extracts just the MetaInfo members from the cabinet directory without ever
+ * decompressing the firmware payload to disk; inspecting a file only has to
+ * look at the metadata. The file descriptor is not consumed.
+ *
+ * Returns: (transfer container) (element-type GBytes): MetaInfo XML blobs
+ **/
+GPtrArray *
+fwupd_cabinet_get_metainfo_blobs (gint fd, GError **error)
+{
+	int r;
+	struct archive *arch;
+	g_autoptr(GPtrArray) blobs = NULL;
+
+	blobs = g_ptr_array_new_with_free_func ((GDestroyNotify) g_bytes_unref);
+	arch = archive_read_new ();
+	archive_read_support_format_all (arch);
+	archive_read_support_filter_all (arch);
+	r = archive_read_open_fd (arch, fd, 1024 * 128);
+	if (r != ARCHIVE_OK) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "cannot open archive: %s",
+			     archive_error_string (arch));
+		archive_read_free (arch);
+		return NULL;
+	}
+	for (;;) {
+		const gchar *fn;
+		gint64 bufsz;
+		gssize idx = 0;
+		struct archive_entry *entry;
+		g_autofree guint8 *buf = NULL;
+
+		r = archive_read_next_header (arch, &entry);
+		if (r == ARCHIVE_EOF)
+			break;
+		if (r != ARCHIVE_OK) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "cannot read header: %s",
+				     archive_error_string (arch));
+			archive_read_free (arch);
+			return NULL;
+		}
+
+		/* only the metadata members are interesting */
+		fn = archive_entry_pathname (entry);
+		if (fn == NULL || !g_str_has_suffix (fn, ".metainfo.xml")) {
+			archive_read_data_skip (arch);
+			continue;
+		}
+
+		/* read the MetaInfo file into memory */
+		bufsz = archive_entry_size (entry);
+		if (bufsz <= 0 || bufsz > 0x100000) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "MetaInfo size invalid: %s", fn);
+			archive_read_free (arch);
+			return NULL;
+		}
+		buf = g_malloc ((gsize) bufsz);
+		while (idx < bufsz) {
+			gssize rc = archive_read_data (arch, buf + idx,
+						       (gsize) (bufsz - idx));
+			if (rc <= 0)
+				break;
+			idx += rc;
+		}
+		if (idx != bufsz) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "cannot read %s: %s",
+				     fn, archive_error_string (arch));
+			archive_read_free (arch);
+			return NULL;
+		}
+		g_ptr_array_add (blobs, g_bytes_new (buf, (gsize) bufsz));
+	}
+	archive_read_free (arch);
+
+	/* not an archive with MetaInfo inside */
+	if (blobs->len == 0) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "no MetaInfo files in archive");
+		return NULL;
+	}
+	return g_steal_pointer (&blobs);
+}
+
+typedef struct {
+	FwupdResult	*res;
+	GString		*text;		/* content of the current leaf */
+	GString		*markup;	/* non-NULL inside <description> */
+	guint		 markup_depth;
+	gboolean	 markup_for_release;
+	gboolean	 skip_lang;	/* a translated copy of an element */
+	guint		 release_idx;
+	gchar		*url_type;
+} FwupdCabinetParseHelper;
+
+static gboolean
+fwupd_cabinet_parse_has_lang (const gchar **attr_names)
+{
+	for (guint i = 0; attr_names != NULL && attr_names[i] != NULL; i++) {
+		if (g_strcmp0 (attr_names[i], "xml:lang") == 0)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static const gchar *
+fwupd_cabinet_parse_get_attr (const gchar **attr_names,
+			      const gchar **attr_values,
+			      const gchar *name)
+{
+	for (guint i = 0; attr_names != NULL && attr_names[i] != NULL; i++) {
+		if (g_strcmp0 (attr_names[i], name) == 0)
+			return attr_values[i];
+	}
+	return NULL;
+}
+
+static void
+fwupd_cabinet_parse_start_element_cb (GMarkupParseContext *ctx,
+				      const gchar *element_name,
+				      const gchar **attr_names,
+				      const gchar **attr_values,
+				      gpointer user_data,
+				      GError **error)
+{
+	FwupdCabinetParseHelper *helper = (FwupdCabinetParseHelper *) user_data;
+	FwupdRelease *rel = fwupd_result_get_release (helper->res);
+
+	/* rebuild the formatting elements inside the description verbatim */
+	if (helper->markup != NULL) {
+		g_string_append_printf (helper->markup, "<%s>", element_name);
+		helper->markup_depth++;
+		return;
+	}
+
+	/* translated copies are skipped; the C locale version is canonical */
+	helper->skip_lang = fwupd_cabinet_parse_has_lang (attr_names);
+	g_string_set_size (helper->text, 0);
+
+	if (g_strcmp0 (element_name, "release") == 0) {
+		const gchar *version;
+		helper->release_idx++;
+		if (helper->release_idx > 1)
+			return;
+		/* the newest release is listed first by convention */
+		version = fwupd_cabinet_parse_get_attr (attr_names,
+							attr_values,
+							"version");
+		if (version != NULL)
+			fwupd_release_set_version (rel, version);
+		return;
+	}
+	if (g_strcmp0 (element_name, "checksum") == 0 &&
+	    helper->release_idx == 1) {
+		const gchar *fn = fwupd_cabinet_parse_get_attr (attr_names,
+								attr_values,
+								"filename");
+		if (fn != NULL)
+			fwupd_release_set_filename (rel, fn);
+		return;
+	}
+	if (g_strcmp0 (element_name, "url") == 0) {
+		g_free (helper->url_type);
+		helper->url_type = g_strdup (fwupd_cabinet_parse_get_attr (attr_names,
+									   attr_values,
+									   "type"));
+		return;
+	}
+	if (g_strcmp0 (element_name, "description") == 0 &&
+	    !helper->skip_lang) {
+		const GSList *stack = g_markup_parse_context_get_element_stack (ctx);
+		/* only the component description and the one for the
+		 * newest release are interesting */
+		helper->markup_for_release = stack->next != NULL &&
+			g_strcmp0 (stack->next->data, "release") == 0;
+		if (helper->markup_for_release && helper->release_idx != 1)
+			return;
+		helper->markup = g_string_new (NULL);
+		helper->markup_depth = 0;
+		return;
+	}
+}
+
+static void
+fwupd_cabinet_parse_end_element_cb (GMarkupParseContext *ctx,
+				    const gchar *element_name,
+				    gpointer user_data,
+				    GError **error)
+{
+	FwupdCabinetParseHelper *helper = (FwupdCabinetParseHelper *) user_data;
+	FwupdDevice *dev = fwupd_result_get_device (helper->res);
+	FwupdRelease *rel = fwupd_result_get_release (helper->res);
+	const GSList *stack = g_markup_parse_context_get_element_stack (ctx);
+	const gchar *parent = stack->next != NULL ? stack->next->data : NULL;
+	g_autofree gchar *tmp = NULL;
+
+	if (helper->markup != NULL) {
+		if (helper->markup_depth > 0) {
+			g_string_append_printf (helper->markup, "</%s>",
+						element_name);
+			helper->markup_depth--;
+			return;
+		}
+		if (helper->markup_for_release) {
+			fwupd_release_set_description (rel, helper->markup->str);
+		} else {
+			fwupd_device_set_description (dev, helper->markup->str);
+		}
+		g_string_free (helper->markup, TRUE);
+		helper->markup = NULL;
+		return;
+	}
+
+	/* translated leaf, ignore the captured text */
+	if (helper->skip_lang) {
+		helper->skip_lang = FALSE;
+		return;
+	}
+	tmp = g_strstrip (g_strndup (helper->text->str, helper->text->len));
+	if (tmp[0] == '\0')
+		return;
+
+	if (g_strcmp0 (element_name, "id") == 0 &&
+	    g_strcmp0 (parent, "component") == 0) {
+		fwupd_result_set_unique_id (helper->res, tmp);
+		fwupd_release_set_appstream_id (rel, tmp);
+		return;
+	}
+	if (g_strcmp0 (element_name, "name") == 0) {
+		fwupd_release_set_name (rel, tmp);
+		return;
+	}
+	if (g_strcmp0 (element_name, "summary") == 0) {
+		fwupd_release_set_summary (rel, tmp);
+		return;
+	}
+	if (g_strcmp0 (element_name, "developer_name") == 0) {
+		fwupd_release_set_vendor (rel, tmp);
+		return;
+	}
+	if (g_strcmp0 (element_name, "project_license") == 0) {
+		fwupd_release_set_license (rel, tmp);
+		return;
+	}
+	if (g_strcmp0 (element_name, "url") == 0) {
+		if (g_strcmp0 (helper->url_type, "homepage") == 0)
+			fwupd_release_set_homepage (rel, tmp);
+		return;
+	}
+	if (g_strcmp0 (element_name, "firmware") == 0 &&
+	    g_strcmp0 (parent, "provides") == 0) {
+		fwupd_device_add_guid (dev, tmp);
+		return;
+	}
+	if (g_strcmp0 (element_name, "checksum") == 0 &&
+	    helper->release_idx == 1) {
+		fwupd_release_add_checksum (rel, tmp);
+		return;
+	}
+}
+
+static void
+fwupd_cabinet_parse_text_cb (GMarkupParseContext *ctx,
+			     const gchar *text,
+			     gsize text_len,
+			     gpointer user_data,
+			     GError **error)
+{
+	FwupdCabinetParseHelper *helper = (FwupdCabinetParseHelper *) user_data;
+	if (helper->markup != NULL) {
+		g_autofree gchar *escaped = g_markup_escape_text (text, (gssize) text_len);
+		g_string_append (helper->markup, escaped);
+		return;
+	}
+	g_string_append_len (helper->text, text, (gssize) text_len);
+}
+
+/**
+ * fwupd_cabinet_parse_metainfo:
+ * @blob: MetaInfo XML data
+ * @error: the #GError, or %NULL
+ *
+ * Parses a standalone MetaInfo file into a result, without requiring the
+ * AppStream metadata parser the daemon uses. Only the fields the daemon
+ * reports from GetDetails are populated, and device flags are not set as
+ * no attached hardware is consulted.
+ *
+ * Returns: (transfer full): a #FwupdResult, or %NULL for failure
+ **/
+FwupdResult *
+fwupd_cabinet_parse_metainfo (GBytes *blob, GError **error)
+{
+	FwupdDevice *dev;
+	GMarkupParser parser = {
+		fwupd_cabinet_parse_start_element_cb,
+		fwupd_cabinet_parse_end_element_cb,
+		fwupd_cabinet_parse_text_cb,
+		NULL, NULL };
+	g_autoptr(FwupdResult) res = fwupd_result_new ();
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GMarkupParseContext) ctx = NULL;
+	FwupdCabinetParseHelper helper = { NULL };
+
+	helper.res = res;
+	helper.text = g_string_new (NULL);
+	ctx = g_markup_parse_context_new (&parser, G_MARKUP_PREFIX_ERROR_POSITION,
+					  &helper, NULL);
+	if (!g_markup_parse_context_parse (ctx,
+					   g_bytes_get_data (blob, NULL),
+					   (gssize) g_bytes_get_size (blob),
+					   &error_local) ||
+	    !g_markup_parse_context_end_parse (ctx, &error_local)) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "invalid MetaInfo: %s",
+			     error_local->message);
+		g_string_free (helper.text, TRUE);
+		if (helper.markup != NULL)
+			g_string_free (helper.markup, TRUE);
+		g_free (helper.url_type);
+		return NULL;
+	}
+	g_string_free (helper.text, TRUE);
+	g_free (helper.url_type);
+
+	/* firmware with nothing to flash is not installable */
+	dev = fwupd_result_get_device (res);
+	if (fwupd_device_get_guids (dev)->len == 0) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INTERNAL,
+				     "component has no GUIDs");
+		return NULL;
+	}
+	return g_steal_pointer (&res);
+}
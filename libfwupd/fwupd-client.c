@@ -30,6 +30,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 
+#include "fwupd-cabinet-private.h"
 #include "fwupd-client.h"
 #include "fwupd-common.h"
 #include "fwupd-enums.h"
@@ -39,6 +40,8 @@
 #include "fwupd-remote-private.h"
 #include "fwupd-result.h"
 
+#include "fwupd-introspection.h"
+
 static void fwupd_client_finalize	 (GObject *object);
 
 typedef struct {
@@ -46,6 +49,10 @@ typedef struct {
 	guint				 percentage;
 	GDBusConnection			*conn;
 	GDBusProxy			*proxy;
+	guint				 event_rate_max;
+	guint				 event_flush_id;
+	gint64				 event_flush_time;
+	GPtrArray			*event_batch;	/* of FwupdClientEvent */
 } FwupdClientPrivate;
 
 enum {
@@ -54,6 +61,7 @@ enum {
 	SIGNAL_DEVICE_ADDED,
 	SIGNAL_DEVICE_REMOVED,
 	SIGNAL_DEVICE_CHANGED,
+	SIGNAL_EVENT_BATCH,
 	SIGNAL_LAST
 };
 
@@ -101,6 +109,108 @@ fwupd_client_helper_new (void)
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(FwupdClientHelper, fwupd_client_helper_free)
 
+static void
+fwupd_client_event_free (FwupdClientEvent *event)
+{
+	if (event->result != NULL)
+		g_object_unref (event->result);
+	g_free (event);
+}
+
+/* deliver everything that was coalesced since the last flush: the
+ * legacy signals fire once with the final values and the whole batch
+ * goes out in a single ::event-batch emission */
+static void
+fwupd_client_event_flush (FwupdClient *client)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	g_autoptr(GPtrArray) events = NULL;
+
+	priv->event_flush_time = g_get_monotonic_time ();
+	if (priv->event_batch->len == 0)
+		return;
+	events = priv->event_batch;
+	priv->event_batch = g_ptr_array_new_with_free_func ((GDestroyNotify) fwupd_client_event_free);
+
+	for (guint i = 0; i < events->len; i++) {
+		FwupdClientEvent *event = g_ptr_array_index (events, i);
+		if (event->result == NULL) {
+			g_debug ("Emitting ::status-changed() [%s]",
+				 fwupd_status_to_string (priv->status));
+			g_signal_emit (client, signals[SIGNAL_STATUS_CHANGED], 0, priv->status);
+			g_object_notify (G_OBJECT (client), "status");
+			g_object_notify (G_OBJECT (client), "percentage");
+		} else {
+			g_debug ("Emitting ::device-changed(%s)",
+				 fwupd_device_get_id (fwupd_result_get_device (event->result)));
+			g_signal_emit (client, signals[SIGNAL_DEVICE_CHANGED], 0, event->result);
+		}
+	}
+	g_debug ("Emitting ::event-batch() [%u events]", events->len);
+	g_signal_emit (client, signals[SIGNAL_EVENT_BATCH], 0, events);
+}
+
+static gboolean
+fwupd_client_event_flush_cb (gpointer user_data)
+{
+	FwupdClient *client = FWUPD_CLIENT (user_data);
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	priv->event_flush_id = 0;
+	fwupd_client_event_flush (client);
+	return G_SOURCE_REMOVE;
+}
+
+/* one pending entry per device plus one for the daemon state, each
+ * overwritten in place by newer events so a storm of notifications
+ * collapses into whatever was current at delivery time */
+static void
+fwupd_client_event_queue (FwupdClient *client, FwupdResult *result)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	FwupdClientEvent *event = NULL;
+	gint64 interval_us = G_USEC_PER_SEC / priv->event_rate_max;
+	gint64 elapsed_us;
+
+	/* coalesce into an existing entry where possible */
+	for (guint i = 0; i < priv->event_batch->len; i++) {
+		FwupdClientEvent *event_tmp = g_ptr_array_index (priv->event_batch, i);
+		if (result == NULL && event_tmp->result == NULL) {
+			event = event_tmp;
+			break;
+		}
+		if (result != NULL && event_tmp->result != NULL &&
+		    g_strcmp0 (fwupd_device_get_id (fwupd_result_get_device (event_tmp->result)),
+			       fwupd_device_get_id (fwupd_result_get_device (result))) == 0) {
+			/* keep the newest snapshot of the device */
+			g_object_unref (event_tmp->result);
+			event_tmp->result = g_object_ref (result);
+			event = event_tmp;
+			break;
+		}
+	}
+	if (event == NULL) {
+		event = g_new0 (FwupdClientEvent, 1);
+		if (result != NULL)
+			event->result = g_object_ref (result);
+		g_ptr_array_add (priv->event_batch, event);
+	}
+	event->status = priv->status;
+	event->percentage = priv->percentage;
+
+	/* flush straight away if the rate allows it, otherwise wait out
+	 * the remainder of the delivery window */
+	if (priv->event_flush_id != 0)
+		return;
+	elapsed_us = g_get_monotonic_time () - priv->event_flush_time;
+	if (elapsed_us >= interval_us) {
+		fwupd_client_event_flush (client);
+	} else {
+		priv->event_flush_id =
+			g_timeout_add ((guint) ((interval_us - elapsed_us) / 1000) + 1,
+				       fwupd_client_event_flush_cb, client);
+	}
+}
+
 static void
 fwupd_client_properties_changed_cb (GDBusProxy *proxy,
 				    GVariant *changed_properties,
@@ -109,6 +219,7 @@ fwupd_client_properties_changed_cb (GDBusProxy *proxy,
 {
 	FwupdClientPrivate *priv = GET_PRIVATE (client);
 	GVariantDict dict;
+	gboolean changed = FALSE;
 
 	/* print to the console */
 	g_variant_dict_init (&dict, changed_properties);
@@ -117,10 +228,13 @@ fwupd_client_properties_changed_cb (GDBusProxy *proxy,
 		val = g_dbus_proxy_get_cached_property (proxy, "Status");
 		if (val != NULL) {
 			priv->status = g_variant_get_uint32 (val);
-			g_debug ("Emitting ::status-changed() [%s]",
-				 fwupd_status_to_string (priv->status));
-			g_signal_emit (client, signals[SIGNAL_STATUS_CHANGED], 0, priv->status);
-			g_object_notify (G_OBJECT (client), "status");
+			changed = TRUE;
+			if (priv->event_rate_max == 0) {
+				g_debug ("Emitting ::status-changed() [%s]",
+					 fwupd_status_to_string (priv->status));
+				g_signal_emit (client, signals[SIGNAL_STATUS_CHANGED], 0, priv->status);
+				g_object_notify (G_OBJECT (client), "status");
+			}
 		}
 	}
 	if (g_variant_dict_contains (&dict, "Percentage")) {
@@ -128,9 +242,15 @@ fwupd_client_properties_changed_cb (GDBusProxy *proxy,
 		val = g_dbus_proxy_get_cached_property (proxy, "Percentage");
 		if (val != NULL) {
 			priv->percentage = g_variant_get_uint32 (val);
-			g_object_notify (G_OBJECT (client), "percentage");
+			changed = TRUE;
+			if (priv->event_rate_max == 0)
+				g_object_notify (G_OBJECT (client), "percentage");
 		}
 	}
+
+	/* rate-limited delivery */
+	if (priv->event_rate_max > 0 && changed)
+		fwupd_client_event_queue (client, NULL);
 }
 
 static void
@@ -161,7 +281,12 @@ fwupd_client_signal_cb (GDBusProxy *proxy,
 		return;
 	}
 	if (g_strcmp0 (signal_name, "DeviceChanged") == 0) {
+		FwupdClientPrivate *priv = GET_PRIVATE (client);
 		res = fwupd_result_new_from_data (parameters);
+		if (priv->event_rate_max > 0) {
+			fwupd_client_event_queue (client, res);
+			return;
+		}
 		g_signal_emit (client, signals[SIGNAL_DEVICE_CHANGED], 0, res);
 		g_debug ("Emitting ::device-changed(%s)",
 			 fwupd_device_get_id (fwupd_result_get_device (res)));
@@ -189,6 +314,7 @@ gboolean
 fwupd_client_connect (FwupdClient *client, GCancellable *cancellable, GError **error)
 {
 	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	const gchar *socket_path;
 
 	g_return_val_if_fail (FWUPD_IS_CLIENT (client), FALSE);
 	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), FALSE);
@@ -198,17 +324,29 @@ fwupd_client_connect (FwupdClient *client, GCancellable *cancellable, GError **e
 	if (priv->proxy != NULL)
 		return TRUE;
 
-	/* connect to the daemon */
-	priv->conn = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, error);
+	/* an address set up by the daemon for local high-frequency callers,
+	 * which avoids the dbus-daemon forwarding overhead entirely */
+	socket_path = g_getenv ("FWUPD_PRIVATE_SOCKET");
+	if (socket_path != NULL) {
+		g_autofree gchar *address = NULL;
+		address = g_strdup_printf ("unix:path=%s", socket_path);
+		priv->conn = g_dbus_connection_new_for_address_sync (address,
+								     G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT,
+								     NULL,
+								     cancellable,
+								     error);
+	} else {
+		priv->conn = g_bus_get_sync (G_BUS_TYPE_SYSTEM, cancellable, error);
+	}
 	if (priv->conn == NULL)
 		return FALSE;
 	priv->proxy = g_dbus_proxy_new_sync (priv->conn,
 					     G_DBUS_PROXY_FLAGS_NONE,
-					     NULL,
-					     FWUPD_DBUS_SERVICE,
+					     fu_dbus_interfaces[0],
+					     socket_path != NULL ? NULL : FWUPD_DBUS_SERVICE,
 					     FWUPD_DBUS_PATH,
 					     FWUPD_DBUS_INTERFACE,
-					     NULL,
+					     cancellable,
 					     error);
 	if (priv->proxy == NULL)
 		return FALSE;
@@ -219,6 +357,14 @@ fwupd_client_connect (FwupdClient *client, GCancellable *cancellable, GError **e
 	return TRUE;
 }
 
+static const gchar *
+fwupd_client_get_daemon_name (FwupdClient *client)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	/* NULL on a peer connection, which has no bus name to address */
+	return g_dbus_proxy_get_name (priv->proxy);
+}
+
 static GPtrArray *
 fwupd_client_parse_results_from_data (GVariant *devices)
 {
@@ -886,7 +1032,7 @@ fwupd_client_install (FwupdClient *client,
 	fd_list = g_unix_fd_list_new ();
 	retval = g_unix_fd_list_append (fd_list, fd, NULL);
 	g_assert (retval != -1);
-	request = g_dbus_message_new_method_call (FWUPD_DBUS_SERVICE,
+	request = g_dbus_message_new_method_call (fwupd_client_get_daemon_name (client),
 						  FWUPD_DBUS_PATH,
 						  FWUPD_DBUS_INTERFACE,
 						  "Install");
@@ -965,7 +1111,7 @@ fwupd_client_get_details (FwupdClient *client, const gchar *filename,
 	fd_list = g_unix_fd_list_new ();
 	retval = g_unix_fd_list_append (fd_list, fd, NULL);
 	g_assert (retval != -1);
-	request = g_dbus_message_new_method_call (FWUPD_DBUS_SERVICE,
+	request = g_dbus_message_new_method_call (fwupd_client_get_daemon_name (client),
 						  FWUPD_DBUS_PATH,
 						  FWUPD_DBUS_INTERFACE,
 						  "GetDetails");
@@ -1047,7 +1193,7 @@ fwupd_client_get_details_local (FwupdClient *client, const gchar *filename,
 	fd_list = g_unix_fd_list_new ();
 	retval = g_unix_fd_list_append (fd_list, fd, NULL);
 	g_assert (retval != -1);
-	request = g_dbus_message_new_method_call (FWUPD_DBUS_SERVICE,
+	request = g_dbus_message_new_method_call (fwupd_client_get_daemon_name (client),
 						  FWUPD_DBUS_PATH,
 						  FWUPD_DBUS_INTERFACE,
 						  "GetDetailsLocal");
@@ -1080,6 +1226,66 @@ fwupd_client_get_details_local (FwupdClient *client, const gchar *filename,
 	return fwupd_client_parse_results_from_data (helper->val);
 }
 
+/**
+ * fwupd_client_inspect_file:
+ * @client: A #FwupdClient
+ * @filename: the firmware filename, e.g. "firmware.cab"
+ * @cancellable: the #GCancellable, or %NULL
+ * @error: the #GError, or %NULL
+ *
+ * Gets details about a specific firmware file by parsing the MetaInfo
+ * members of the archive in the client process, without a daemon
+ * round-trip. This is much cheaper than fwupd_client_get_details_local()
+ * when inspecting many files, but the results carry no device flags as
+ * the attached hardware is not consulted.
+ *
+ * Returns: (transfer container) (element-type FwupdResult): an array of results
+ *
+ * Since: 0.9.5
+ **/
+GPtrArray *
+fwupd_client_inspect_file (FwupdClient *client, const gchar *filename,
+			   GCancellable *cancellable, GError **error)
+{
+	gint fd;
+	g_autoptr(GPtrArray) blobs = NULL;
+	g_autoptr(GPtrArray) results = NULL;
+
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), NULL);
+	g_return_val_if_fail (filename != NULL, NULL);
+	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	/* open file; no daemon connection is required */
+	fd = open (filename, O_RDONLY);
+	if (fd < 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "failed to open %s",
+			     filename);
+		return NULL;
+	}
+	blobs = fwupd_cabinet_get_metainfo_blobs (fd, error);
+	close (fd);
+	if (blobs == NULL)
+		return NULL;
+
+	/* parse each standalone MetaInfo file */
+	results = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (guint i = 0; i < blobs->len; i++) {
+		GBytes *blob = g_ptr_array_index (blobs, i);
+		FwupdResult *res;
+		if (g_cancellable_set_error_if_cancelled (cancellable, error))
+			return NULL;
+		res = fwupd_cabinet_parse_metainfo (blob, error);
+		if (res == NULL)
+			return NULL;
+		g_ptr_array_add (results, res);
+	}
+	return g_steal_pointer (&results);
+}
+
 /**
  * fwupd_client_get_percentage:
  * @client: A #FwupdClient
@@ -1116,6 +1322,56 @@ fwupd_client_get_status (FwupdClient *client)
 	return priv->status;
 }
 
+/**
+ * fwupd_client_set_max_event_rate:
+ * @client: A #FwupdClient
+ * @max_event_rate: maximum deliveries per second, or 0 for unlimited
+ *
+ * Limits how often daemon status, percentage and device-changed
+ * notifications are delivered. When a limit is set, events arriving
+ * faster than the rate are coalesced -- keeping only the newest state
+ * per device and for the daemon itself -- and delivered together, with
+ * the usual signals fired once per flush and the whole batch also
+ * available from the ::event-batch signal. Device add and remove
+ * events are never coalesced as dropping them would lose information.
+ *
+ * Since: 0.9.5
+ **/
+void
+fwupd_client_set_max_event_rate (FwupdClient *client, guint max_event_rate)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	g_return_if_fail (FWUPD_IS_CLIENT (client));
+	priv->event_rate_max = max_event_rate;
+
+	/* deliver anything still in the window */
+	if (max_event_rate == 0) {
+		if (priv->event_flush_id != 0) {
+			g_source_remove (priv->event_flush_id);
+			priv->event_flush_id = 0;
+		}
+		fwupd_client_event_flush (client);
+	}
+}
+
+/**
+ * fwupd_client_get_max_event_rate:
+ * @client: A #FwupdClient
+ *
+ * Gets the maximum notification delivery rate.
+ *
+ * Returns: maximum deliveries per second, or 0 for unlimited
+ *
+ * Since: 0.9.5
+ **/
+guint
+fwupd_client_get_max_event_rate (FwupdClient *client)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), 0);
+	return priv->event_rate_max;
+}
+
 /**
  * fwupd_client_update_metadata:
  * @client: A #FwupdClient
@@ -1218,7 +1474,7 @@ fwupd_client_update_metadata_with_id (FwupdClient *client,
 	fd_list = g_unix_fd_list_new ();
 	g_unix_fd_list_append (fd_list, fd, NULL);
 	g_unix_fd_list_append (fd_list, fd_sig, NULL);
-	request = g_dbus_message_new_method_call (FWUPD_DBUS_SERVICE,
+	request = g_dbus_message_new_method_call (fwupd_client_get_daemon_name (client),
 						  FWUPD_DBUS_PATH,
 						  FWUPD_DBUS_INTERFACE,
 						  "UpdateMetadataWithId");
@@ -1422,89 +1678,1226 @@ fwupd_client_get_remote_by_id (FwupdClient *client,
 }
 
 static void
-fwupd_client_get_property (GObject *object, guint prop_id,
-			   GValue *value, GParamSpec *pspec)
+fwupd_client_connect_proxy_cb (GObject *source, GAsyncResult *res, gpointer user_data)
 {
-	FwupdClient *client = FWUPD_CLIENT (object);
+	g_autoptr(GTask) task = G_TASK (user_data);
+	FwupdClient *client = FWUPD_CLIENT (g_task_get_source_object (task));
 	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	GError *error = NULL;
 
-	switch (prop_id) {
-	case PROP_STATUS:
-		g_value_set_uint (value, priv->status);
-		break;
-	case PROP_PERCENTAGE:
-		g_value_set_uint (value, priv->percentage);
-		break;
-	default:
-		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
-		break;
+	priv->proxy = g_dbus_proxy_new_finish (res, &error);
+	if (priv->proxy == NULL) {
+		g_task_return_error (task, error);
+		return;
+	}
+	g_signal_connect (priv->proxy, "g-properties-changed",
+			  G_CALLBACK (fwupd_client_properties_changed_cb), client);
+	g_signal_connect (priv->proxy, "g-signal",
+			  G_CALLBACK (fwupd_client_signal_cb), client);
+	g_task_return_boolean (task, TRUE);
+}
+
+static void
+fwupd_client_connect_get_bus_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	g_autoptr(GTask) task = G_TASK (user_data);
+	FwupdClient *client = FWUPD_CLIENT (g_task_get_source_object (task));
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	GError *error = NULL;
+
+	priv->conn = g_bus_get_finish (res, &error);
+	if (priv->conn == NULL) {
+		g_task_return_error (task, error);
+		return;
 	}
+	g_dbus_proxy_new (priv->conn,
+			  G_DBUS_PROXY_FLAGS_NONE,
+			  fu_dbus_interfaces[0],
+			  FWUPD_DBUS_SERVICE,
+			  FWUPD_DBUS_PATH,
+			  FWUPD_DBUS_INTERFACE,
+			  g_task_get_cancellable (task),
+			  fwupd_client_connect_proxy_cb,
+			  g_steal_pointer (&task));
 }
 
 static void
-fwupd_client_set_property (GObject *object, guint prop_id,
-			   const GValue *value, GParamSpec *pspec)
+fwupd_client_connect_get_address_cb (GObject *source, GAsyncResult *res, gpointer user_data)
 {
-	FwupdClient *client = FWUPD_CLIENT (object);
+	g_autoptr(GTask) task = G_TASK (user_data);
+	FwupdClient *client = FWUPD_CLIENT (g_task_get_source_object (task));
 	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	GError *error = NULL;
 
-	switch (prop_id) {
-	case PROP_STATUS:
-		priv->status = g_value_get_uint (value);
+	priv->conn = g_dbus_connection_new_for_address_finish (res, &error);
+	if (priv->conn == NULL) {
+		g_task_return_error (task, error);
+		return;
+	}
+	g_dbus_proxy_new (priv->conn,
+			  G_DBUS_PROXY_FLAGS_NONE,
+			  fu_dbus_interfaces[0],
+			  NULL, /* no bus name on a peer connection */
+			  FWUPD_DBUS_PATH,
+			  FWUPD_DBUS_INTERFACE,
+			  g_task_get_cancellable (task),
+			  fwupd_client_connect_proxy_cb,
+			  g_steal_pointer (&task));
+}
+
+/**
+ * fwupd_client_connect_async:
+ * @client: A #FwupdClient
+ * @cancellable: the #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @callback_data: the data to pass to @callback
+ *
+ * Sets up the client ready for use. Most other _async methods call this
+ * for you, and do you only need to call this if you are just watching
+ * the client.
+ *
+ * Since: 0.9.5
+ **/
+void
+fwupd_client_connect_async (FwupdClient *client,
+			    GCancellable *cancellable,
+			    GAsyncReadyCallback callback,
+			    gpointer callback_data)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	const gchar *socket_path;
+	g_autoptr(GTask) task = NULL;
+
+	g_return_if_fail (FWUPD_IS_CLIENT (client));
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+	task = g_task_new (client, cancellable, callback, callback_data);
+
+	/* nothing to do */
+	if (priv->proxy != NULL) {
+		g_task_return_boolean (task, TRUE);
+		return;
+	}
+
+	/* an address set up by the daemon for local high-frequency callers,
+	 * which avoids the dbus-daemon forwarding overhead entirely */
+	socket_path = g_getenv ("FWUPD_PRIVATE_SOCKET");
+	if (socket_path != NULL) {
+		g_autofree gchar *address = NULL;
+		address = g_strdup_printf ("unix:path=%s", socket_path);
+		g_dbus_connection_new_for_address (address,
+						   G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT,
+						   NULL,
+						   cancellable,
+						   fwupd_client_connect_get_address_cb,
+						   g_steal_pointer (&task));
+		return;
+	}
+
+	/* connect to the daemon */
+	g_bus_get (G_BUS_TYPE_SYSTEM,
+		   cancellable,
+		   fwupd_client_connect_get_bus_cb,
+		   g_steal_pointer (&task));
+}
+
+/**
+ * fwupd_client_connect_finish:
+ * @client: A #FwupdClient
+ * @res: the #GAsyncResult
+ * @error: the #GError, or %NULL
+ *
+ * Gets the result of fwupd_client_connect_async().
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 0.9.5
+ **/
+gboolean
+fwupd_client_connect_finish (FwupdClient *client, GAsyncResult *res, GError **error)
+{
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), FALSE);
+	g_return_val_if_fail (g_task_is_valid (res, client), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+	return g_task_propagate_boolean (G_TASK (res), error);
+}
+
+typedef enum {
+	FWUPD_CLIENT_REPLY_KIND_NONE,
+	FWUPD_CLIENT_REPLY_KIND_RESULTS,
+	FWUPD_CLIENT_REPLY_KIND_DEVICES,
+	FWUPD_CLIENT_REPLY_KIND_RELEASES,
+	FWUPD_CLIENT_REPLY_KIND_RESULT,
+	FWUPD_CLIENT_REPLY_KIND_LAST
+} FwupdClientReplyKind;
+
+typedef struct {
+	gchar			*method_name;
+	GVariant		*parameters;
+	FwupdClientReplyKind	 reply_kind;
+} FwupdClientMethodHelper;
+
+static void
+fwupd_client_method_helper_free (FwupdClientMethodHelper *helper)
+{
+	if (helper->parameters != NULL)
+		g_variant_unref (helper->parameters);
+	g_free (helper->method_name);
+	g_free (helper);
+}
+
+static void
+fwupd_client_method_call_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	g_autoptr(GTask) task = G_TASK (user_data);
+	FwupdClientMethodHelper *helper = g_task_get_task_data (task);
+	GError *error = NULL;
+	g_autoptr(GVariant) val = NULL;
+
+	val = g_dbus_proxy_call_finish (G_DBUS_PROXY (source), res, &error);
+	if (val == NULL) {
+		fwupd_client_fixup_dbus_error (error);
+		g_task_return_error (task, error);
+		return;
+	}
+	switch (helper->reply_kind) {
+	case FWUPD_CLIENT_REPLY_KIND_RESULTS:
+		g_task_return_pointer (task,
+				       fwupd_client_parse_results_from_data (val),
+				       (GDestroyNotify) g_ptr_array_unref);
 		break;
-	case PROP_PERCENTAGE:
-		priv->percentage = g_value_get_uint (value);
+	case FWUPD_CLIENT_REPLY_KIND_DEVICES:
+		g_task_return_pointer (task,
+				       fwupd_client_parse_devices_from_variant (val),
+				       (GDestroyNotify) g_ptr_array_unref);
+		break;
+	case FWUPD_CLIENT_REPLY_KIND_RELEASES:
+		g_task_return_pointer (task,
+				       fwupd_client_parse_releases_from_variant (val),
+				       (GDestroyNotify) g_ptr_array_unref);
+		break;
+	case FWUPD_CLIENT_REPLY_KIND_RESULT:
+		g_task_return_pointer (task,
+				       fwupd_result_new_from_data (val),
+				       (GDestroyNotify) g_object_unref);
 		break;
 	default:
-		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		g_task_return_boolean (task, TRUE);
 		break;
 	}
 }
 
 static void
-fwupd_client_class_init (FwupdClientClass *klass)
+fwupd_client_method_connect_cb (GObject *source, GAsyncResult *res, gpointer user_data)
 {
-	GParamSpec *pspec;
-	GObjectClass *object_class = G_OBJECT_CLASS (klass);
-	object_class->finalize = fwupd_client_finalize;
-	object_class->get_property = fwupd_client_get_property;
-	object_class->set_property = fwupd_client_set_property;
+	g_autoptr(GTask) task = G_TASK (user_data);
+	FwupdClient *client = FWUPD_CLIENT (source);
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	FwupdClientMethodHelper *helper = g_task_get_task_data (task);
+	GError *error = NULL;
 
-	/**
-	 * FwupdClient::changed:
-	 * @client: the #FwupdClient instance that emitted the signal
-	 *
-	 * The ::changed signal is emitted when the daemon internal has
-	 * changed, for instance when a device has been added or removed.
-	 *
-	 * Since: 0.7.0
-	 **/
-	signals [SIGNAL_CHANGED] =
-		g_signal_new ("changed",
-			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
-			      G_STRUCT_OFFSET (FwupdClientClass, changed),
-			      NULL, NULL, g_cclosure_marshal_VOID__VOID,
-			      G_TYPE_NONE, 0);
+	if (!fwupd_client_connect_finish (client, res, &error)) {
+		g_task_return_error (task, error);
+		return;
+	}
+	g_dbus_proxy_call (priv->proxy,
+			   helper->method_name,
+			   helper->parameters,
+			   G_DBUS_CALL_FLAGS_NONE,
+			   -1,
+			   g_task_get_cancellable (task),
+			   fwupd_client_method_call_cb,
+			   g_steal_pointer (&task));
+}
 
-	/**
-	 * FwupdClient::state-changed:
-	 * @client: the #FwupdClient instance that emitted the signal
-	 * @status: the #FwupdStatus
-	 *
-	 * The ::state-changed signal is emitted when the daemon status has
-	 * changed, e.g. going from %FWUPD_STATUS_IDLE to %FWUPD_STATUS_DEVICE_WRITE.
-	 *
-	 * Since: 0.7.0
-	 **/
-	signals [SIGNAL_STATUS_CHANGED] =
-		g_signal_new ("status-changed",
-			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
-			      G_STRUCT_OFFSET (FwupdClientClass, status_changed),
-			      NULL, NULL, g_cclosure_marshal_VOID__UINT,
-			      G_TYPE_NONE, 1, G_TYPE_UINT);
+static void
+fwupd_client_method_call_async (FwupdClient *client,
+				const gchar *method_name,
+				GVariant *parameters,
+				FwupdClientReplyKind reply_kind,
+				GCancellable *cancellable,
+				GAsyncReadyCallback callback,
+				gpointer callback_data)
+{
+	FwupdClientMethodHelper *helper;
+	g_autoptr(GTask) task = NULL;
+
+	task = g_task_new (client, cancellable, callback, callback_data);
+	helper = g_new0 (FwupdClientMethodHelper, 1);
+	helper->method_name = g_strdup (method_name);
+	if (parameters != NULL)
+		helper->parameters = g_variant_ref_sink (parameters);
+	helper->reply_kind = reply_kind;
+	g_task_set_task_data (task, helper,
+			      (GDestroyNotify) fwupd_client_method_helper_free);
+
+	/* connect first, then call into the daemon */
+	fwupd_client_connect_async (client, cancellable,
+				    fwupd_client_method_connect_cb,
+				    g_steal_pointer (&task));
+}
 
-	/**
-	 * FwupdClient::device-added:
+/**
+ * fwupd_client_get_devices_simple_async:
+ * @client: A #FwupdClient
+ * @cancellable: the #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @callback_data: the data to pass to @callback
+ *
+ * Gets all the devices registered with the daemon.
+ *
+ * Since: 0.9.5
+ **/
+void
+fwupd_client_get_devices_simple_async (FwupdClient *client,
+				       GCancellable *cancellable,
+				       GAsyncReadyCallback callback,
+				       gpointer callback_data)
+{
+	g_return_if_fail (FWUPD_IS_CLIENT (client));
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+	fwupd_client_method_call_async (client, "GetDevices", NULL,
+					FWUPD_CLIENT_REPLY_KIND_DEVICES,
+					cancellable, callback, callback_data);
+}
+
+/**
+ * fwupd_client_get_devices_simple_finish:
+ * @client: A #FwupdClient
+ * @res: the #GAsyncResult
+ * @error: the #GError, or %NULL
+ *
+ * Gets the result of fwupd_client_get_devices_simple_async().
+ *
+ * Returns: (element-type FwupdDevice) (transfer container): results
+ *
+ * Since: 0.9.5
+ **/
+GPtrArray *
+fwupd_client_get_devices_simple_finish (FwupdClient *client,
+					GAsyncResult *res,
+					GError **error)
+{
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), NULL);
+	g_return_val_if_fail (g_task_is_valid (res, client), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+	return g_task_propagate_pointer (G_TASK (res), error);
+}
+
+/**
+ * fwupd_client_get_updates_async:
+ * @client: A #FwupdClient
+ * @cancellable: the #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @callback_data: the data to pass to @callback
+ *
+ * Gets all the devices with known updates.
+ *
+ * Since: 0.9.5
+ **/
+void
+fwupd_client_get_updates_async (FwupdClient *client,
+				GCancellable *cancellable,
+				GAsyncReadyCallback callback,
+				gpointer callback_data)
+{
+	g_return_if_fail (FWUPD_IS_CLIENT (client));
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+	fwupd_client_method_call_async (client, "GetUpdates", NULL,
+					FWUPD_CLIENT_REPLY_KIND_RESULTS,
+					cancellable, callback, callback_data);
+}
+
+/**
+ * fwupd_client_get_updates_finish:
+ * @client: A #FwupdClient
+ * @res: the #GAsyncResult
+ * @error: the #GError, or %NULL
+ *
+ * Gets the result of fwupd_client_get_updates_async().
+ *
+ * Returns: (element-type FwupdResult) (transfer container): results
+ *
+ * Since: 0.9.5
+ **/
+GPtrArray *
+fwupd_client_get_updates_finish (FwupdClient *client,
+				 GAsyncResult *res,
+				 GError **error)
+{
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), NULL);
+	g_return_val_if_fail (g_task_is_valid (res, client), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+	return g_task_propagate_pointer (G_TASK (res), error);
+}
+
+/**
+ * fwupd_client_get_releases_async:
+ * @client: A #FwupdClient
+ * @device_id: the device ID
+ * @cancellable: the #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @callback_data: the data to pass to @callback
+ *
+ * Gets all the releases for a specific device.
+ *
+ * Since: 0.9.5
+ **/
+void
+fwupd_client_get_releases_async (FwupdClient *client,
+				 const gchar *device_id,
+				 GCancellable *cancellable,
+				 GAsyncReadyCallback callback,
+				 gpointer callback_data)
+{
+	g_return_if_fail (FWUPD_IS_CLIENT (client));
+	g_return_if_fail (device_id != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+	fwupd_client_method_call_async (client, "GetReleases",
+					g_variant_new ("(s)", device_id),
+					FWUPD_CLIENT_REPLY_KIND_RELEASES,
+					cancellable, callback, callback_data);
+}
+
+/**
+ * fwupd_client_get_releases_finish:
+ * @client: A #FwupdClient
+ * @res: the #GAsyncResult
+ * @error: the #GError, or %NULL
+ *
+ * Gets the result of fwupd_client_get_releases_async().
+ *
+ * Returns: (element-type FwupdRelease) (transfer container): results
+ *
+ * Since: 0.9.5
+ **/
+GPtrArray *
+fwupd_client_get_releases_finish (FwupdClient *client,
+				  GAsyncResult *res,
+				  GError **error)
+{
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), NULL);
+	g_return_val_if_fail (g_task_is_valid (res, client), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+	return g_task_propagate_pointer (G_TASK (res), error);
+}
+
+static void
+fwupd_client_get_device_by_id_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	g_autoptr(GTask) task = G_TASK (user_data);
+	FwupdClient *client = FWUPD_CLIENT (source);
+	const gchar *device_id = g_task_get_task_data (task);
+	GError *error = NULL;
+	g_autoptr(GPtrArray) devices = NULL;
+
+	devices = fwupd_client_get_devices_simple_finish (client, res, &error);
+	if (devices == NULL) {
+		g_task_return_error (task, error);
+		return;
+	}
+
+	/* find the device by ID (client side) */
+	for (guint i = 0; i < devices->len; i++) {
+		FwupdDevice *dev = g_ptr_array_index (devices, i);
+		if (g_strcmp0 (fwupd_device_get_id (dev), device_id) == 0) {
+			g_task_return_pointer (task,
+					       g_object_ref (dev),
+					       (GDestroyNotify) g_object_unref);
+			return;
+		}
+	}
+	g_task_return_new_error (task,
+				 FWUPD_ERROR,
+				 FWUPD_ERROR_NOT_FOUND,
+				 "failed to find %s", device_id);
+}
+
+/**
+ * fwupd_client_get_device_by_id_async:
+ * @client: A #FwupdClient
+ * @device_id: the device ID, e.g. "usb:00:01:03:03"
+ * @cancellable: the #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @callback_data: the data to pass to @callback
+ *
+ * Gets a device by it's device ID.
+ *
+ * Since: 0.9.5
+ **/
+void
+fwupd_client_get_device_by_id_async (FwupdClient *client,
+				     const gchar *device_id,
+				     GCancellable *cancellable,
+				     GAsyncReadyCallback callback,
+				     gpointer callback_data)
+{
+	g_autoptr(GTask) task = NULL;
+
+	g_return_if_fail (FWUPD_IS_CLIENT (client));
+	g_return_if_fail (device_id != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+	task = g_task_new (client, cancellable, callback, callback_data);
+	g_task_set_task_data (task, g_strdup (device_id), g_free);
+	fwupd_client_get_devices_simple_async (client, cancellable,
+					       fwupd_client_get_device_by_id_cb,
+					       g_steal_pointer (&task));
+}
+
+/**
+ * fwupd_client_get_device_by_id_finish:
+ * @client: A #FwupdClient
+ * @res: the #GAsyncResult
+ * @error: the #GError, or %NULL
+ *
+ * Gets the result of fwupd_client_get_device_by_id_async().
+ *
+ * Returns: (transfer full): a #FwupdDevice or %NULL
+ *
+ * Since: 0.9.5
+ **/
+FwupdDevice *
+fwupd_client_get_device_by_id_finish (FwupdClient *client,
+				      GAsyncResult *res,
+				      GError **error)
+{
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), NULL);
+	g_return_val_if_fail (g_task_is_valid (res, client), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+	return g_task_propagate_pointer (G_TASK (res), error);
+}
+
+/**
+ * fwupd_client_verify_async:
+ * @client: A #FwupdClient
+ * @device_id: the device ID
+ * @cancellable: the #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @callback_data: the data to pass to @callback
+ *
+ * Verify a specific device.
+ *
+ * Since: 0.9.5
+ **/
+void
+fwupd_client_verify_async (FwupdClient *client,
+			   const gchar *device_id,
+			   GCancellable *cancellable,
+			   GAsyncReadyCallback callback,
+			   gpointer callback_data)
+{
+	g_return_if_fail (FWUPD_IS_CLIENT (client));
+	g_return_if_fail (device_id != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+	fwupd_client_method_call_async (client, "Verify",
+					g_variant_new ("(s)", device_id),
+					FWUPD_CLIENT_REPLY_KIND_NONE,
+					cancellable, callback, callback_data);
+}
+
+/**
+ * fwupd_client_verify_finish:
+ * @client: A #FwupdClient
+ * @res: the #GAsyncResult
+ * @error: the #GError, or %NULL
+ *
+ * Gets the result of fwupd_client_verify_async().
+ *
+ * Returns: %TRUE for verification success
+ *
+ * Since: 0.9.5
+ **/
+gboolean
+fwupd_client_verify_finish (FwupdClient *client, GAsyncResult *res, GError **error)
+{
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), FALSE);
+	g_return_val_if_fail (g_task_is_valid (res, client), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+	return g_task_propagate_boolean (G_TASK (res), error);
+}
+
+/**
+ * fwupd_client_verify_update_async:
+ * @client: A #FwupdClient
+ * @device_id: the device ID
+ * @cancellable: the #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @callback_data: the data to pass to @callback
+ *
+ * Update the verification record for a specific device.
+ *
+ * Since: 0.9.5
+ **/
+void
+fwupd_client_verify_update_async (FwupdClient *client,
+				  const gchar *device_id,
+				  GCancellable *cancellable,
+				  GAsyncReadyCallback callback,
+				  gpointer callback_data)
+{
+	g_return_if_fail (FWUPD_IS_CLIENT (client));
+	g_return_if_fail (device_id != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+	fwupd_client_method_call_async (client, "VerifyUpdate",
+					g_variant_new ("(s)", device_id),
+					FWUPD_CLIENT_REPLY_KIND_NONE,
+					cancellable, callback, callback_data);
+}
+
+/**
+ * fwupd_client_verify_update_finish:
+ * @client: A #FwupdClient
+ * @res: the #GAsyncResult
+ * @error: the #GError, or %NULL
+ *
+ * Gets the result of fwupd_client_verify_update_async().
+ *
+ * Returns: %TRUE for verification success
+ *
+ * Since: 0.9.5
+ **/
+gboolean
+fwupd_client_verify_update_finish (FwupdClient *client, GAsyncResult *res, GError **error)
+{
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), FALSE);
+	g_return_val_if_fail (g_task_is_valid (res, client), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+	return g_task_propagate_boolean (G_TASK (res), error);
+}
+
+/**
+ * fwupd_client_unlock_async:
+ * @client: A #FwupdClient
+ * @device_id: the device ID
+ * @cancellable: the #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @callback_data: the data to pass to @callback
+ *
+ * Unlocks a specific device so firmware can be read or wrote.
+ *
+ * Since: 0.9.5
+ **/
+void
+fwupd_client_unlock_async (FwupdClient *client,
+			   const gchar *device_id,
+			   GCancellable *cancellable,
+			   GAsyncReadyCallback callback,
+			   gpointer callback_data)
+{
+	g_return_if_fail (FWUPD_IS_CLIENT (client));
+	g_return_if_fail (device_id != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+	fwupd_client_method_call_async (client, "Unlock",
+					g_variant_new ("(s)", device_id),
+					FWUPD_CLIENT_REPLY_KIND_NONE,
+					cancellable, callback, callback_data);
+}
+
+/**
+ * fwupd_client_unlock_finish:
+ * @client: A #FwupdClient
+ * @res: the #GAsyncResult
+ * @error: the #GError, or %NULL
+ *
+ * Gets the result of fwupd_client_unlock_async().
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 0.9.5
+ **/
+gboolean
+fwupd_client_unlock_finish (FwupdClient *client, GAsyncResult *res, GError **error)
+{
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), FALSE);
+	g_return_val_if_fail (g_task_is_valid (res, client), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+	return g_task_propagate_boolean (G_TASK (res), error);
+}
+
+/**
+ * fwupd_client_clear_results_async:
+ * @client: A #FwupdClient
+ * @device_id: the device ID
+ * @cancellable: the #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @callback_data: the data to pass to @callback
+ *
+ * Clears the results for a specific device.
+ *
+ * Since: 0.9.5
+ **/
+void
+fwupd_client_clear_results_async (FwupdClient *client,
+				  const gchar *device_id,
+				  GCancellable *cancellable,
+				  GAsyncReadyCallback callback,
+				  gpointer callback_data)
+{
+	g_return_if_fail (FWUPD_IS_CLIENT (client));
+	g_return_if_fail (device_id != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+	fwupd_client_method_call_async (client, "ClearResults",
+					g_variant_new ("(s)", device_id),
+					FWUPD_CLIENT_REPLY_KIND_NONE,
+					cancellable, callback, callback_data);
+}
+
+/**
+ * fwupd_client_clear_results_finish:
+ * @client: A #FwupdClient
+ * @res: the #GAsyncResult
+ * @error: the #GError, or %NULL
+ *
+ * Gets the result of fwupd_client_clear_results_async().
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 0.9.5
+ **/
+gboolean
+fwupd_client_clear_results_finish (FwupdClient *client, GAsyncResult *res, GError **error)
+{
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), FALSE);
+	g_return_val_if_fail (g_task_is_valid (res, client), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+	return g_task_propagate_boolean (G_TASK (res), error);
+}
+
+/**
+ * fwupd_client_get_results_async:
+ * @client: A #FwupdClient
+ * @device_id: the device ID
+ * @cancellable: the #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @callback_data: the data to pass to @callback
+ *
+ * Gets the results of a previous firmware update for a specific device.
+ *
+ * Since: 0.9.5
+ **/
+void
+fwupd_client_get_results_async (FwupdClient *client,
+				const gchar *device_id,
+				GCancellable *cancellable,
+				GAsyncReadyCallback callback,
+				gpointer callback_data)
+{
+	g_return_if_fail (FWUPD_IS_CLIENT (client));
+	g_return_if_fail (device_id != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+	fwupd_client_method_call_async (client, "GetResults",
+					g_variant_new ("(s)", device_id),
+					FWUPD_CLIENT_REPLY_KIND_RESULT,
+					cancellable, callback, callback_data);
+}
+
+/**
+ * fwupd_client_get_results_finish:
+ * @client: A #FwupdClient
+ * @res: the #GAsyncResult
+ * @error: the #GError, or %NULL
+ *
+ * Gets the result of fwupd_client_get_results_async().
+ *
+ * Returns: (transfer full): a #FwupdResult, or %NULL for failure
+ *
+ * Since: 0.9.5
+ **/
+FwupdResult *
+fwupd_client_get_results_finish (FwupdClient *client, GAsyncResult *res, GError **error)
+{
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), NULL);
+	g_return_val_if_fail (g_task_is_valid (res, client), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+	return g_task_propagate_pointer (G_TASK (res), error);
+}
+
+typedef struct {
+	GDBusMessage		*request;
+	FwupdClientReplyKind	 reply_kind;
+} FwupdClientMessageHelper;
+
+static void
+fwupd_client_message_helper_free (FwupdClientMessageHelper *helper)
+{
+	g_object_unref (helper->request);
+	g_free (helper);
+}
+
+static void
+fwupd_client_send_message_async_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	g_autoptr(GTask) task = G_TASK (user_data);
+	FwupdClientMessageHelper *helper = g_task_get_task_data (task);
+	GDBusConnection *con = G_DBUS_CONNECTION (source);
+	GError *error = NULL;
+	g_autoptr(GDBusMessage) message = NULL;
+
+	message = g_dbus_connection_send_message_with_reply_finish (con, res, &error);
+	if (message == NULL) {
+		fwupd_client_fixup_dbus_error (error);
+		g_task_return_error (task, error);
+		return;
+	}
+	if (g_dbus_message_to_gerror (message, &error)) {
+		fwupd_client_fixup_dbus_error (error);
+		g_task_return_error (task, error);
+		return;
+	}
+	switch (helper->reply_kind) {
+	case FWUPD_CLIENT_REPLY_KIND_RESULTS:
+		g_task_return_pointer (task,
+				       fwupd_client_parse_results_from_data (g_dbus_message_get_body (message)),
+				       (GDestroyNotify) g_ptr_array_unref);
+		break;
+	case FWUPD_CLIENT_REPLY_KIND_RESULT:
+		g_task_return_pointer (task,
+				       fwupd_result_new_from_data (g_dbus_message_get_body (message)),
+				       (GDestroyNotify) g_object_unref);
+		break;
+	default:
+		g_task_return_boolean (task, TRUE);
+		break;
+	}
+}
+
+static void
+fwupd_client_send_message_connect_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	g_autoptr(GTask) task = G_TASK (user_data);
+	FwupdClient *client = FWUPD_CLIENT (source);
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	FwupdClientMessageHelper *helper = g_task_get_task_data (task);
+	GError *error = NULL;
+
+	if (!fwupd_client_connect_finish (client, res, &error)) {
+		g_task_return_error (task, error);
+		return;
+	}
+	g_dbus_connection_send_message_with_reply (priv->conn,
+						   helper->request,
+						   G_DBUS_SEND_MESSAGE_FLAGS_NONE,
+						   G_MAXINT,
+						   NULL,
+						   g_task_get_cancellable (task),
+						   fwupd_client_send_message_async_cb,
+						   g_steal_pointer (&task));
+}
+
+static void
+fwupd_client_send_message_async (FwupdClient *client,
+				 GDBusMessage *request,
+				 FwupdClientReplyKind reply_kind,
+				 GCancellable *cancellable,
+				 GAsyncReadyCallback callback,
+				 gpointer callback_data)
+{
+	FwupdClientMessageHelper *helper;
+	g_autoptr(GTask) task = NULL;
+
+	task = g_task_new (client, cancellable, callback, callback_data);
+	helper = g_new0 (FwupdClientMessageHelper, 1);
+	helper->request = g_object_ref (request);
+	helper->reply_kind = reply_kind;
+	g_task_set_task_data (task, helper,
+			      (GDestroyNotify) fwupd_client_message_helper_free);
+
+	/* connect first, then call into the daemon */
+	fwupd_client_connect_async (client, cancellable,
+				    fwupd_client_send_message_connect_cb,
+				    g_steal_pointer (&task));
+}
+
+/**
+ * fwupd_client_install_async:
+ * @client: A #FwupdClient
+ * @device_id: the device ID
+ * @filename: the filename to install
+ * @install_flags: the #FwupdInstallFlags, e.g. %FWUPD_INSTALL_FLAG_ALLOW_REINSTALL
+ * @cancellable: the #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @callback_data: the data to pass to @callback
+ *
+ * Install a file onto a specific device. As the main loop is not blocked
+ * the ::status-changed signal and the #FwupdClient:percentage property
+ * updates are delivered while the install is in progress.
+ *
+ * Since: 0.9.5
+ **/
+void
+fwupd_client_install_async (FwupdClient *client,
+			    const gchar *device_id,
+			    const gchar *filename,
+			    FwupdInstallFlags install_flags,
+			    GCancellable *cancellable,
+			    GAsyncReadyCallback callback,
+			    gpointer callback_data)
+{
+	GVariantBuilder builder;
+	gint retval;
+	gint fd;
+	g_autoptr(GDBusMessage) request = NULL;
+	g_autoptr(GTask) task = NULL;
+	g_autoptr(GUnixFDList) fd_list = NULL;
+
+	g_return_if_fail (FWUPD_IS_CLIENT (client));
+	g_return_if_fail (device_id != NULL);
+	g_return_if_fail (filename != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+	/* set options */
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_ARRAY);
+	g_variant_builder_add (&builder, "{sv}",
+			       "reason", g_variant_new_string ("user-action"));
+	g_variant_builder_add (&builder, "{sv}",
+			       "filename", g_variant_new_string (filename));
+	if (install_flags & FWUPD_INSTALL_FLAG_OFFLINE) {
+		g_variant_builder_add (&builder, "{sv}",
+				       "offline", g_variant_new_boolean (TRUE));
+	}
+	if (install_flags & FWUPD_INSTALL_FLAG_ALLOW_OLDER) {
+		g_variant_builder_add (&builder, "{sv}",
+				       "allow-older", g_variant_new_boolean (TRUE));
+	}
+	if (install_flags & FWUPD_INSTALL_FLAG_ALLOW_REINSTALL) {
+		g_variant_builder_add (&builder, "{sv}",
+				       "allow-reinstall", g_variant_new_boolean (TRUE));
+	}
+	if (install_flags & FWUPD_INSTALL_FLAG_FORCE) {
+		g_variant_builder_add (&builder, "{sv}",
+				       "force", g_variant_new_boolean (TRUE));
+	}
+
+	/* open file */
+	fd = open (filename, O_RDONLY);
+	if (fd < 0) {
+		task = g_task_new (client, cancellable, callback, callback_data);
+		g_task_return_new_error (task,
+					 FWUPD_ERROR,
+					 FWUPD_ERROR_INVALID_FILE,
+					 "failed to open %s",
+					 filename);
+		return;
+	}
+
+	/* set out of band file descriptor */
+	fd_list = g_unix_fd_list_new ();
+	retval = g_unix_fd_list_append (fd_list, fd, NULL);
+	g_assert (retval != -1);
+	request = g_dbus_message_new_method_call (fwupd_client_get_daemon_name (client),
+						  FWUPD_DBUS_PATH,
+						  FWUPD_DBUS_INTERFACE,
+						  "Install");
+	g_dbus_message_set_unix_fd_list (request, fd_list);
+
+	/* g_unix_fd_list_append did a dup() already */
+	close (fd);
+
+	/* call into daemon */
+	g_dbus_message_set_body (request,
+				 g_variant_new ("(sha{sv})",
+						device_id, fd, &builder));
+	fwupd_client_send_message_async (client, request,
+					 FWUPD_CLIENT_REPLY_KIND_NONE,
+					 cancellable, callback, callback_data);
+}
+
+/**
+ * fwupd_client_install_finish:
+ * @client: A #FwupdClient
+ * @res: the #GAsyncResult
+ * @error: the #GError, or %NULL
+ *
+ * Gets the result of fwupd_client_install_async().
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 0.9.5
+ **/
+gboolean
+fwupd_client_install_finish (FwupdClient *client, GAsyncResult *res, GError **error)
+{
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), FALSE);
+	g_return_val_if_fail (g_task_is_valid (res, client), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+	return g_task_propagate_boolean (G_TASK (res), error);
+}
+
+/**
+ * fwupd_client_get_details_local_async:
+ * @client: A #FwupdClient
+ * @filename: the firmware filename, e.g. "firmware.cab"
+ * @cancellable: the #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @callback_data: the data to pass to @callback
+ *
+ * Gets details about a specific firmware file.
+ *
+ * Since: 0.9.5
+ **/
+void
+fwupd_client_get_details_local_async (FwupdClient *client,
+				      const gchar *filename,
+				      GCancellable *cancellable,
+				      GAsyncReadyCallback callback,
+				      gpointer callback_data)
+{
+	gint fd;
+	gint retval;
+	g_autoptr(GDBusMessage) request = NULL;
+	g_autoptr(GTask) task = NULL;
+	g_autoptr(GUnixFDList) fd_list = NULL;
+
+	g_return_if_fail (FWUPD_IS_CLIENT (client));
+	g_return_if_fail (filename != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+	/* open file */
+	fd = open (filename, O_RDONLY);
+	if (fd < 0) {
+		task = g_task_new (client, cancellable, callback, callback_data);
+		g_task_return_new_error (task,
+					 FWUPD_ERROR,
+					 FWUPD_ERROR_INVALID_FILE,
+					 "failed to open %s",
+					 filename);
+		return;
+	}
+
+	/* set out of band file descriptor */
+	fd_list = g_unix_fd_list_new ();
+	retval = g_unix_fd_list_append (fd_list, fd, NULL);
+	g_assert (retval != -1);
+	request = g_dbus_message_new_method_call (fwupd_client_get_daemon_name (client),
+						  FWUPD_DBUS_PATH,
+						  FWUPD_DBUS_INTERFACE,
+						  "GetDetailsLocal");
+	g_dbus_message_set_unix_fd_list (request, fd_list);
+
+	/* g_unix_fd_list_append did a dup() already */
+	close (fd);
+
+	/* call into daemon */
+	g_dbus_message_set_body (request, g_variant_new ("(h)", fd));
+	fwupd_client_send_message_async (client, request,
+					 FWUPD_CLIENT_REPLY_KIND_RESULTS,
+					 cancellable, callback, callback_data);
+}
+
+/**
+ * fwupd_client_get_details_local_finish:
+ * @client: A #FwupdClient
+ * @res: the #GAsyncResult
+ * @error: the #GError, or %NULL
+ *
+ * Gets the result of fwupd_client_get_details_local_async().
+ *
+ * Returns: (transfer container) (element-type FwupdResult): an array of results
+ *
+ * Since: 0.9.5
+ **/
+GPtrArray *
+fwupd_client_get_details_local_finish (FwupdClient *client,
+				       GAsyncResult *res,
+				       GError **error)
+{
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), NULL);
+	g_return_val_if_fail (g_task_is_valid (res, client), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+	return g_task_propagate_pointer (G_TASK (res), error);
+}
+
+/**
+ * fwupd_client_update_metadata_with_id_async:
+ * @client: A #FwupdClient
+ * @remote_id: the remote ID, e.g. "lvfs-testing"
+ * @metadata_fn: the XML metadata filename
+ * @signature_fn: the GPG signature file
+ * @cancellable: the #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @callback_data: the data to pass to @callback
+ *
+ * Updates the metadata. This allows a session process to download the metadata
+ * and metadata signing file to be passed into the daemon to be checked and
+ * parsed.
+ *
+ * Since: 0.9.5
+ **/
+void
+fwupd_client_update_metadata_with_id_async (FwupdClient *client,
+					    const gchar *remote_id,
+					    const gchar *metadata_fn,
+					    const gchar *signature_fn,
+					    GCancellable *cancellable,
+					    GAsyncReadyCallback callback,
+					    gpointer callback_data)
+{
+	gint fd;
+	gint fd_sig;
+	g_autoptr(GDBusMessage) request = NULL;
+	g_autoptr(GTask) task = NULL;
+	g_autoptr(GUnixFDList) fd_list = NULL;
+
+	g_return_if_fail (FWUPD_IS_CLIENT (client));
+	g_return_if_fail (metadata_fn != NULL);
+	g_return_if_fail (signature_fn != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+	/* open files */
+	fd = open (metadata_fn, O_RDONLY);
+	if (fd < 0) {
+		task = g_task_new (client, cancellable, callback, callback_data);
+		g_task_return_new_error (task,
+					 FWUPD_ERROR,
+					 FWUPD_ERROR_INVALID_FILE,
+					 "failed to open %s",
+					 metadata_fn);
+		return;
+	}
+	fd_sig = open (signature_fn, O_RDONLY);
+	if (fd_sig < 0) {
+		close (fd);
+		task = g_task_new (client, cancellable, callback, callback_data);
+		g_task_return_new_error (task,
+					 FWUPD_ERROR,
+					 FWUPD_ERROR_INVALID_FILE,
+					 "failed to open %s",
+					 signature_fn);
+		return;
+	}
+
+	/* set out of band file descriptors */
+	fd_list = g_unix_fd_list_new ();
+	g_unix_fd_list_append (fd_list, fd, NULL);
+	g_unix_fd_list_append (fd_list, fd_sig, NULL);
+	request = g_dbus_message_new_method_call (fwupd_client_get_daemon_name (client),
+						  FWUPD_DBUS_PATH,
+						  FWUPD_DBUS_INTERFACE,
+						  "UpdateMetadataWithId");
+	g_dbus_message_set_unix_fd_list (request, fd_list);
+
+	/* g_unix_fd_list_append did a dup() already */
+	close (fd);
+	close (fd_sig);
+
+	/* call into daemon */
+	g_dbus_message_set_body (request,
+				 g_variant_new ("(shh)",
+						remote_id != NULL ? remote_id : "",
+						fd, fd_sig));
+	fwupd_client_send_message_async (client, request,
+					 FWUPD_CLIENT_REPLY_KIND_NONE,
+					 cancellable, callback, callback_data);
+}
+
+/**
+ * fwupd_client_update_metadata_with_id_finish:
+ * @client: A #FwupdClient
+ * @res: the #GAsyncResult
+ * @error: the #GError, or %NULL
+ *
+ * Gets the result of fwupd_client_update_metadata_with_id_async().
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 0.9.5
+ **/
+gboolean
+fwupd_client_update_metadata_with_id_finish (FwupdClient *client,
+					     GAsyncResult *res,
+					     GError **error)
+{
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), FALSE);
+	g_return_val_if_fail (g_task_is_valid (res, client), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+	return g_task_propagate_boolean (G_TASK (res), error);
+}
+
+static void
+fwupd_client_get_property (GObject *object, guint prop_id,
+			   GValue *value, GParamSpec *pspec)
+{
+	FwupdClient *client = FWUPD_CLIENT (object);
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+
+	switch (prop_id) {
+	case PROP_STATUS:
+		g_value_set_uint (value, priv->status);
+		break;
+	case PROP_PERCENTAGE:
+		g_value_set_uint (value, priv->percentage);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+fwupd_client_set_property (GObject *object, guint prop_id,
+			   const GValue *value, GParamSpec *pspec)
+{
+	FwupdClient *client = FWUPD_CLIENT (object);
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+
+	switch (prop_id) {
+	case PROP_STATUS:
+		priv->status = g_value_get_uint (value);
+		break;
+	case PROP_PERCENTAGE:
+		priv->percentage = g_value_get_uint (value);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+fwupd_client_class_init (FwupdClientClass *klass)
+{
+	GParamSpec *pspec;
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = fwupd_client_finalize;
+	object_class->get_property = fwupd_client_get_property;
+	object_class->set_property = fwupd_client_set_property;
+
+	/**
+	 * FwupdClient::changed:
+	 * @client: the #FwupdClient instance that emitted the signal
+	 *
+	 * The ::changed signal is emitted when the daemon internal has
+	 * changed, for instance when a device has been added or removed.
+	 *
+	 * Since: 0.7.0
+	 **/
+	signals [SIGNAL_CHANGED] =
+		g_signal_new ("changed",
+			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (FwupdClientClass, changed),
+			      NULL, NULL, g_cclosure_marshal_VOID__VOID,
+			      G_TYPE_NONE, 0);
+
+	/**
+	 * FwupdClient::state-changed:
+	 * @client: the #FwupdClient instance that emitted the signal
+	 * @status: the #FwupdStatus
+	 *
+	 * The ::state-changed signal is emitted when the daemon status has
+	 * changed, e.g. going from %FWUPD_STATUS_IDLE to %FWUPD_STATUS_DEVICE_WRITE.
+	 *
+	 * Since: 0.7.0
+	 **/
+	signals [SIGNAL_STATUS_CHANGED] =
+		g_signal_new ("status-changed",
+			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (FwupdClientClass, status_changed),
+			      NULL, NULL, g_cclosure_marshal_VOID__UINT,
+			      G_TYPE_NONE, 1, G_TYPE_UINT);
+
+	/**
+	 * FwupdClient::device-added:
 	 * @client: the #FwupdClient instance that emitted the signal
 	 * @result: the #FwupdResult
 	 *
@@ -1554,6 +2947,26 @@ fwupd_client_class_init (FwupdClientClass *klass)
 			      NULL, NULL, g_cclosure_marshal_generic,
 			      G_TYPE_NONE, 1, FWUPD_TYPE_RESULT);
 
+	/**
+	 * FwupdClient::event-batch:
+	 * @client: the #FwupdClient instance that emitted the signal
+	 * @events: (element-type FwupdClientEvent): the coalesced events
+	 *
+	 * The ::event-batch signal is emitted at most at the rate set by
+	 * fwupd_client_set_max_event_rate() and carries every status,
+	 * percentage and device change that was coalesced since the last
+	 * delivery. The array is only valid for the duration of the
+	 * signal emission.
+	 *
+	 * Since: 0.9.5
+	 **/
+	signals [SIGNAL_EVENT_BATCH] =
+		g_signal_new ("event-batch",
+			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (FwupdClientClass, event_batch),
+			      NULL, NULL, g_cclosure_marshal_generic,
+			      G_TYPE_NONE, 1, G_TYPE_PTR_ARRAY);
+
 	/**
 	 * FwupdClient:status:
 	 *
@@ -1582,6 +2995,8 @@ fwupd_client_class_init (FwupdClientClass *klass)
 static void
 fwupd_client_init (FwupdClient *client)
 {
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	priv->event_batch = g_ptr_array_new_with_free_func ((GDestroyNotify) fwupd_client_event_free);
 }
 
 static void
@@ -1590,6 +3005,9 @@ fwupd_client_finalize (GObject *object)
 	FwupdClient *client = FWUPD_CLIENT (object);
 	FwupdClientPrivate *priv = GET_PRIVATE (client);
 
+	if (priv->event_flush_id != 0)
+		g_source_remove (priv->event_flush_id);
+	g_ptr_array_unref (priv->event_batch);
 	if (priv->conn != NULL)
 		g_object_unref (priv->conn);
 	if (priv->proxy != NULL)
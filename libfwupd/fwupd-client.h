@@ -34,6 +34,20 @@ G_BEGIN_DECLS
 #define FWUPD_TYPE_CLIENT (fwupd_client_get_type ())
 G_DECLARE_DERIVABLE_TYPE (FwupdClient, fwupd_client, FWUPD, CLIENT, GObject)
 
+/**
+ * FwupdClientEvent:
+ * @result: (nullable): the changed device, or %NULL for a daemon state event
+ * @status: the daemon #FwupdStatus when the event was coalesced
+ * @percentage: the daemon percentage when the event was coalesced
+ *
+ * One coalesced notification, as delivered in the ::event-batch array.
+ **/
+typedef struct {
+	FwupdResult	*result;
+	FwupdStatus	 status;
+	guint		 percentage;
+} FwupdClientEvent;
+
 struct _FwupdClientClass
 {
 	GObjectClass		 parent_class;
@@ -46,8 +60,9 @@ struct _FwupdClientClass
 							 FwupdResult	*result);
 	void			(*device_changed)	(FwupdClient	*client,
 							 FwupdResult	*result);
+	void			(*event_batch)		(FwupdClient	*client,
+							 GPtrArray	*events);
 	/*< private >*/
-	void (*_fwupd_reserved1)	(void);
 	void (*_fwupd_reserved2)	(void);
 	void (*_fwupd_reserved3)	(void);
 	void (*_fwupd_reserved4)	(void);
@@ -75,6 +90,10 @@ GPtrArray	*fwupd_client_get_details_local		(FwupdClient	*client,
 							 const gchar	*filename,
 							 GCancellable	*cancellable,
 							 GError		**error);
+GPtrArray	*fwupd_client_inspect_file		(FwupdClient	*client,
+							 const gchar	*filename,
+							 GCancellable	*cancellable,
+							 GError		**error);
 gboolean	 fwupd_client_verify			(FwupdClient	*client,
 							 const gchar	*device_id,
 							 GCancellable	*cancellable,
@@ -123,6 +142,115 @@ gboolean	 fwupd_client_update_metadata_with_id	(FwupdClient	*client,
 							 GError		**error);
 FwupdStatus	 fwupd_client_get_status		(FwupdClient	*client);
 guint		 fwupd_client_get_percentage		(FwupdClient	*client);
+void		 fwupd_client_set_max_event_rate	(FwupdClient	*client,
+							 guint		 max_event_rate);
+guint		 fwupd_client_get_max_event_rate	(FwupdClient	*client);
+
+void		 fwupd_client_connect_async		(FwupdClient	*client,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 callback_data);
+gboolean	 fwupd_client_connect_finish		(FwupdClient	*client,
+							 GAsyncResult	*res,
+							 GError		**error);
+void		 fwupd_client_get_devices_simple_async	(FwupdClient	*client,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 callback_data);
+GPtrArray	*fwupd_client_get_devices_simple_finish	(FwupdClient	*client,
+							 GAsyncResult	*res,
+							 GError		**error);
+void		 fwupd_client_get_updates_async		(FwupdClient	*client,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 callback_data);
+GPtrArray	*fwupd_client_get_updates_finish	(FwupdClient	*client,
+							 GAsyncResult	*res,
+							 GError		**error);
+void		 fwupd_client_get_releases_async	(FwupdClient	*client,
+							 const gchar	*device_id,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 callback_data);
+GPtrArray	*fwupd_client_get_releases_finish	(FwupdClient	*client,
+							 GAsyncResult	*res,
+							 GError		**error);
+void		 fwupd_client_get_device_by_id_async	(FwupdClient	*client,
+							 const gchar	*device_id,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 callback_data);
+FwupdDevice	*fwupd_client_get_device_by_id_finish	(FwupdClient	*client,
+							 GAsyncResult	*res,
+							 GError		**error);
+void		 fwupd_client_verify_async		(FwupdClient	*client,
+							 const gchar	*device_id,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 callback_data);
+gboolean	 fwupd_client_verify_finish		(FwupdClient	*client,
+							 GAsyncResult	*res,
+							 GError		**error);
+void		 fwupd_client_verify_update_async	(FwupdClient	*client,
+							 const gchar	*device_id,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 callback_data);
+gboolean	 fwupd_client_verify_update_finish	(FwupdClient	*client,
+							 GAsyncResult	*res,
+							 GError		**error);
+void		 fwupd_client_unlock_async		(FwupdClient	*client,
+							 const gchar	*device_id,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 callback_data);
+gboolean	 fwupd_client_unlock_finish		(FwupdClient	*client,
+							 GAsyncResult	*res,
+							 GError		**error);
+void		 fwupd_client_clear_results_async	(FwupdClient	*client,
+							 const gchar	*device_id,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 callback_data);
+gboolean	 fwupd_client_clear_results_finish	(FwupdClient	*client,
+							 GAsyncResult	*res,
+							 GError		**error);
+void		 fwupd_client_get_results_async		(FwupdClient	*client,
+							 const gchar	*device_id,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 callback_data);
+FwupdResult	*fwupd_client_get_results_finish	(FwupdClient	*client,
+							 GAsyncResult	*res,
+							 GError		**error);
+void		 fwupd_client_install_async		(FwupdClient	*client,
+							 const gchar	*device_id,
+							 const gchar	*filename,
+							 FwupdInstallFlags install_flags,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 callback_data);
+gboolean	 fwupd_client_install_finish		(FwupdClient	*client,
+							 GAsyncResult	*res,
+							 GError		**error);
+void		 fwupd_client_get_details_local_async	(FwupdClient	*client,
+							 const gchar	*filename,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 callback_data);
+GPtrArray	*fwupd_client_get_details_local_finish	(FwupdClient	*client,
+							 GAsyncResult	*res,
+							 GError		**error);
+void		 fwupd_client_update_metadata_with_id_async (FwupdClient *client,
+							 const gchar	*remote_id,
+							 const gchar	*metadata_fn,
+							 const gchar	*signature_fn,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 callback_data);
+gboolean	 fwupd_client_update_metadata_with_id_finish (FwupdClient *client,
+							 GAsyncResult	*res,
+							 GError		**error);
 
 GPtrArray	*fwupd_client_get_remotes		(FwupdClient	*client,
 							 GCancellable	*cancellable,
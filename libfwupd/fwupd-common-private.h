@@ -24,7 +24,21 @@
 
 #include <glib.h>
 
+#define FWUPD_GUID_RAW_SZ	16
+
+#define FWUPD_VERSION_KEY_DEPTH	6
+#define FWUPD_VERSION_KEY_SZ	(FWUPD_VERSION_KEY_DEPTH * 4)	/* bytes */
+
 GChecksumType	 fwupd_checksum_guess_kind		(const gchar	*checksum);
 gchar		*fwupd_checksum_format_for_display	(const gchar	*checksum);
+const gchar	*fwupd_strpool_add			(const gchar	*str);
+void		 fwupd_strpool_unref			(const gchar	*str);
+gboolean	 fwupd_guid_from_string			(const gchar	*guidstr,
+							 guint8		*buf);
+gchar		*fwupd_guid_to_string			(const guint8	*buf);
+gboolean	 fwupd_version_key_from_string		(const gchar	*version,
+							 guint8		*buf);
+gint		 fwupd_version_key_compare		(const guint8	*buf1,
+							 const guint8	*buf2);
 
 #endif /* __FWUPD_COMMON_PRIVATE_H */
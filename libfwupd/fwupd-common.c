@@ -83,3 +83,194 @@ fwupd_checksum_format_for_display (const gchar *checksum)
 	GChecksumType kind = fwupd_checksum_guess_kind (checksum);
 	return g_strdup_printf ("%s(%s)", _g_checksum_type_to_string (kind), checksum);
 }
+
+/* a process-wide refcounted pool for identity strings; a host full of
+ * devices repeats the same vendor names, GUIDs and version strings many
+ * times over, so store each value once and hand out the canonical copy */
+static GHashTable *fwupd_strpool_hash = NULL;	/* of string : guint refcount */
+G_LOCK_DEFINE_STATIC (fwupd_strpool);
+
+/**
+ * fwupd_strpool_add:
+ * @str: a string, or %NULL
+ *
+ * Adds a reference to @str in the interned string pool, storing a copy
+ * if it was not already present.
+ *
+ * Returns: the canonical pooled copy, which stays valid until the
+ * matching fwupd_strpool_unref()
+ **/
+const gchar *
+fwupd_strpool_add (const gchar *str)
+{
+	gpointer key = NULL;
+	gpointer value = NULL;
+	const gchar *tmp;
+
+	if (str == NULL)
+		return NULL;
+	G_LOCK (fwupd_strpool);
+	if (fwupd_strpool_hash == NULL) {
+		fwupd_strpool_hash = g_hash_table_new_full (g_str_hash,
+							    g_str_equal,
+							    g_free, NULL);
+	}
+	if (g_hash_table_lookup_extended (fwupd_strpool_hash, str,
+					  &key, &value)) {
+		g_hash_table_steal (fwupd_strpool_hash, str);
+		g_hash_table_insert (fwupd_strpool_hash, key,
+				     GUINT_TO_POINTER (GPOINTER_TO_UINT (value) + 1));
+		tmp = (const gchar *) key;
+	} else {
+		key = g_strdup (str);
+		g_hash_table_insert (fwupd_strpool_hash, key,
+				     GUINT_TO_POINTER (1));
+		tmp = (const gchar *) key;
+	}
+	G_UNLOCK (fwupd_strpool);
+	return tmp;
+}
+
+/**
+ * fwupd_strpool_unref:
+ * @str: a string returned by fwupd_strpool_add(), or %NULL
+ *
+ * Drops a reference on a pooled string, freeing the stored copy when
+ * the last reference goes away.
+ **/
+void
+fwupd_strpool_unref (const gchar *str)
+{
+	gpointer key = NULL;
+	gpointer value = NULL;
+
+	if (str == NULL)
+		return;
+	G_LOCK (fwupd_strpool);
+	if (fwupd_strpool_hash != NULL &&
+	    g_hash_table_lookup_extended (fwupd_strpool_hash, str,
+					  &key, &value)) {
+		if (GPOINTER_TO_UINT (value) > 1) {
+			g_hash_table_steal (fwupd_strpool_hash, str);
+			g_hash_table_insert (fwupd_strpool_hash, key,
+					     GUINT_TO_POINTER (GPOINTER_TO_UINT (value) - 1));
+		} else {
+			g_hash_table_remove (fwupd_strpool_hash, str);
+		}
+	} else {
+		g_warning ("no pooled string %s to unref", str);
+	}
+	G_UNLOCK (fwupd_strpool);
+}
+
+/**
+ * fwupd_guid_from_string:
+ * @guidstr: a GUID, e.g. "2082b5e0-7a64-478a-b1b2-e3404fab6dad"
+ * @buf: a buffer of at least %FWUPD_GUID_RAW_SZ bytes
+ *
+ * Packs a GUID string into its 16 byte binary form. The dashes are
+ * optional, but when present have to be in the conventional positions.
+ *
+ * Returns: %TRUE if @guidstr was a well formed GUID
+ **/
+gboolean
+fwupd_guid_from_string (const gchar *guidstr, guint8 *buf)
+{
+	guint8 nibbles[FWUPD_GUID_RAW_SZ * 2];
+	guint n = 0;
+
+	if (guidstr == NULL)
+		return FALSE;
+	for (guint i = 0; guidstr[i] != '\0'; i++) {
+		gint v;
+		if (guidstr[i] == '-') {
+			if (i != 8 && i != 13 && i != 18 && i != 23)
+				return FALSE;
+			continue;
+		}
+		v = g_ascii_xdigit_value (guidstr[i]);
+		if (v < 0 || n >= FWUPD_GUID_RAW_SZ * 2)
+			return FALSE;
+		nibbles[n++] = (guint8) v;
+	}
+	if (n != FWUPD_GUID_RAW_SZ * 2)
+		return FALSE;
+	for (guint i = 0; i < FWUPD_GUID_RAW_SZ; i++)
+		buf[i] = (guint8) ((nibbles[i * 2] << 4) | nibbles[i * 2 + 1]);
+	return TRUE;
+}
+
+/**
+ * fwupd_guid_to_string:
+ * @buf: %FWUPD_GUID_RAW_SZ bytes packed by fwupd_guid_from_string()
+ *
+ * Formats a binary GUID back into the canonical lowercase string form.
+ *
+ * Returns: a GUID string, free with g_free()
+ **/
+gchar *
+fwupd_guid_to_string (const guint8 *buf)
+{
+	return g_strdup_printf ("%02x%02x%02x%02x-%02x%02x-%02x%02x-"
+				"%02x%02x-%02x%02x%02x%02x%02x%02x",
+				buf[0], buf[1], buf[2], buf[3],
+				buf[4], buf[5], buf[6], buf[7],
+				buf[8], buf[9], buf[10], buf[11],
+				buf[12], buf[13], buf[14], buf[15]);
+}
+
+/**
+ * fwupd_version_key_from_string:
+ * @version: a version, e.g. "1.2.4"
+ * @buf: a buffer of at least %FWUPD_VERSION_KEY_SZ bytes
+ *
+ * Packs a dotted-decimal version into a fixed-size big-endian sort key
+ * that orders under memcmp() the same way as_utils_vercmp() orders the
+ * strings, with missing segments reading as zero. Versions with
+ * alphabetic suffixes, more than %FWUPD_VERSION_KEY_DEPTH segments or
+ * segments over 32 bits are not representable and callers have to fall
+ * back to the string comparison.
+ *
+ * Returns: %TRUE if @version was packed into @buf
+ **/
+gboolean
+fwupd_version_key_from_string (const gchar *version, guint8 *buf)
+{
+	guint depth = 0;
+
+	if (version == NULL || version[0] == '\0')
+		return FALSE;
+	memset (buf, 0, FWUPD_VERSION_KEY_SZ);
+	for (const gchar *p = version; *p != '\0'; depth++) {
+		gchar *endptr = NULL;
+		guint64 segment;
+		if (depth >= FWUPD_VERSION_KEY_DEPTH)
+			return FALSE;
+		segment = g_ascii_strtoull (p, &endptr, 10);
+		if (endptr == p || segment > G_MAXUINT32)
+			return FALSE;
+		if (*endptr != '\0' && *endptr != '.')
+			return FALSE;
+		buf[depth * 4 + 0] = (guint8) (segment >> 24);
+		buf[depth * 4 + 1] = (guint8) (segment >> 16);
+		buf[depth * 4 + 2] = (guint8) (segment >> 8);
+		buf[depth * 4 + 3] = (guint8) segment;
+		p = *endptr == '.' ? endptr + 1 : endptr;
+	}
+	return TRUE;
+}
+
+/**
+ * fwupd_version_key_compare:
+ * @buf1: %FWUPD_VERSION_KEY_SZ bytes packed by fwupd_version_key_from_string()
+ * @buf2: %FWUPD_VERSION_KEY_SZ bytes packed the same way
+ *
+ * Compares two packed version sort keys.
+ *
+ * Returns: an integer less than, equal to, or greater than zero
+ **/
+gint
+fwupd_version_key_compare (const guint8 *buf1, const guint8 *buf2)
+{
+	return memcmp (buf1, buf2, FWUPD_VERSION_KEY_SZ);
+}
@@ -0,0 +1,233 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2017 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <glib-object.h>
+#include <gio/gio.h>
+
+#include "fwupd-device-cache.h"
+#include "fwupd-error.h"
+#include "fwupd-result.h"
+
+/**
+ * SECTION:fwupd-device-cache
+ * @short_description: a local mirror of the daemon device list
+ *
+ * An object that mirrors the daemon's device set on the client side.
+ * The cache is populated with one GetDevices call and then kept current
+ * by applying the per-device signals emitted by the daemon, so repeated
+ * calls to fwupd_device_cache_get_devices() do not cause a D-Bus
+ * round-trip while nothing has changed.
+ *
+ * The incremental updates are only delivered while a main loop is being
+ * iterated, so this is only useful for clients that run one.
+ *
+ * See also: #FwupdClient
+ */
+
+static void fwupd_device_cache_finalize	 (GObject *object);
+
+struct _FwupdDeviceCache {
+	GObject			 parent_instance;
+	FwupdClient		*client;
+	GHashTable		*devices_by_id;	/* of id : FwupdDevice */
+	gboolean		 valid;
+	guint64			 generation;
+	gulong			 signal_ids[3];
+};
+
+G_DEFINE_TYPE (FwupdDeviceCache, fwupd_device_cache, G_TYPE_OBJECT)
+
+static void
+fwupd_device_cache_device_added_cb (FwupdClient *client,
+				    FwupdResult *result,
+				    FwupdDeviceCache *self)
+{
+	FwupdDevice *dev = fwupd_result_get_device (result);
+	if (!self->valid)
+		return;
+	g_hash_table_insert (self->devices_by_id,
+			     g_strdup (fwupd_device_get_id (dev)),
+			     g_object_ref (dev));
+	self->generation++;
+}
+
+static void
+fwupd_device_cache_device_removed_cb (FwupdClient *client,
+				      FwupdResult *result,
+				      FwupdDeviceCache *self)
+{
+	FwupdDevice *dev = fwupd_result_get_device (result);
+	if (!self->valid)
+		return;
+	if (g_hash_table_remove (self->devices_by_id,
+				 fwupd_device_get_id (dev)))
+		self->generation++;
+}
+
+static gint
+fwupd_device_cache_sort_cb (gconstpointer a, gconstpointer b)
+{
+	FwupdDevice *dev_a = *((FwupdDevice **) a);
+	FwupdDevice *dev_b = *((FwupdDevice **) b);
+	return g_strcmp0 (fwupd_device_get_id (dev_a),
+			  fwupd_device_get_id (dev_b));
+}
+
+/**
+ * fwupd_device_cache_get_devices:
+ * @self: A #FwupdDeviceCache
+ * @cancellable: the #GCancellable, or %NULL
+ * @error: the #GError, or %NULL
+ *
+ * Gets all the devices registered with the daemon. The first call fetches
+ * the full list; subsequent calls are answered from the local mirror
+ * without a D-Bus round-trip.
+ *
+ * Returns: (element-type FwupdDevice) (transfer container): devices
+ *
+ * Since: 0.9.5
+ **/
+GPtrArray *
+fwupd_device_cache_get_devices (FwupdDeviceCache *self,
+				GCancellable *cancellable,
+				GError **error)
+{
+	GHashTableIter iter;
+	gpointer value;
+	GPtrArray *array;
+
+	g_return_val_if_fail (FWUPD_IS_DEVICE_CACHE (self), NULL);
+	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	/* fetch the full list just once */
+	if (!self->valid) {
+		g_autoptr(GPtrArray) devices = NULL;
+		devices = fwupd_client_get_devices_simple (self->client,
+							   cancellable,
+							   error);
+		if (devices == NULL)
+			return NULL;
+		g_hash_table_remove_all (self->devices_by_id);
+		for (guint i = 0; i < devices->len; i++) {
+			FwupdDevice *dev = g_ptr_array_index (devices, i);
+			g_hash_table_insert (self->devices_by_id,
+					     g_strdup (fwupd_device_get_id (dev)),
+					     g_object_ref (dev));
+		}
+		self->valid = TRUE;
+		self->generation++;
+	}
+
+	/* hand out a fresh container of the mirrored devices */
+	array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	g_hash_table_iter_init (&iter, self->devices_by_id);
+	while (g_hash_table_iter_next (&iter, NULL, &value))
+		g_ptr_array_add (array, g_object_ref (FWUPD_DEVICE (value)));
+	g_ptr_array_sort (array, fwupd_device_cache_sort_cb);
+	return array;
+}
+
+/**
+ * fwupd_device_cache_get_generation:
+ * @self: A #FwupdDeviceCache
+ *
+ * Gets the generation counter, which is incremented every time the mirrored
+ * device set changes. Clients can compare this against a saved value to
+ * avoid re-processing an unchanged list.
+ *
+ * Returns: a counter, or 0 if the cache has never been populated
+ *
+ * Since: 0.9.5
+ **/
+guint64
+fwupd_device_cache_get_generation (FwupdDeviceCache *self)
+{
+	g_return_val_if_fail (FWUPD_IS_DEVICE_CACHE (self), 0);
+	return self->generation;
+}
+
+static void
+fwupd_device_cache_class_init (FwupdDeviceCacheClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = fwupd_device_cache_finalize;
+}
+
+static void
+fwupd_device_cache_init (FwupdDeviceCache *self)
+{
+	self->devices_by_id = g_hash_table_new_full (g_str_hash, g_str_equal,
+						     g_free,
+						     (GDestroyNotify) g_object_unref);
+}
+
+static void
+fwupd_device_cache_finalize (GObject *object)
+{
+	FwupdDeviceCache *self = FWUPD_DEVICE_CACHE (object);
+
+	for (guint i = 0; i < G_N_ELEMENTS (self->signal_ids); i++) {
+		if (self->signal_ids[i] != 0)
+			g_signal_handler_disconnect (self->client,
+						     self->signal_ids[i]);
+	}
+	g_object_unref (self->client);
+	g_hash_table_unref (self->devices_by_id);
+
+	G_OBJECT_CLASS (fwupd_device_cache_parent_class)->finalize (object);
+}
+
+/**
+ * fwupd_device_cache_new:
+ * @client: A #FwupdClient
+ *
+ * Creates a new device cache that mirrors the daemon device list using
+ * the signals emitted on @client.
+ *
+ * Returns: a new #FwupdDeviceCache
+ *
+ * Since: 0.9.5
+ **/
+FwupdDeviceCache *
+fwupd_device_cache_new (FwupdClient *client)
+{
+	FwupdDeviceCache *self;
+
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), NULL);
+
+	self = g_object_new (FWUPD_TYPE_DEVICE_CACHE, NULL);
+	self->client = g_object_ref (client);
+
+	/* a changed device is just replaced in the mirror */
+	self->signal_ids[0] = g_signal_connect (client, "device-added",
+						G_CALLBACK (fwupd_device_cache_device_added_cb),
+						self);
+	self->signal_ids[1] = g_signal_connect (client, "device-removed",
+						G_CALLBACK (fwupd_device_cache_device_removed_cb),
+						self);
+	self->signal_ids[2] = g_signal_connect (client, "device-changed",
+						G_CALLBACK (fwupd_device_cache_device_added_cb),
+						self);
+	return FWUPD_DEVICE_CACHE (self);
+}
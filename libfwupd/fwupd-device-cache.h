@@ -0,0 +1,44 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2017 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __FWUPD_DEVICE_CACHE_H
+#define __FWUPD_DEVICE_CACHE_H
+
+#include <glib-object.h>
+#include <gio/gio.h>
+
+#include "fwupd-client.h"
+#include "fwupd-device.h"
+
+G_BEGIN_DECLS
+
+#define FWUPD_TYPE_DEVICE_CACHE (fwupd_device_cache_get_type ())
+G_DECLARE_FINAL_TYPE (FwupdDeviceCache, fwupd_device_cache, FWUPD, DEVICE_CACHE, GObject)
+
+FwupdDeviceCache *fwupd_device_cache_new		(FwupdClient	*client);
+GPtrArray	*fwupd_device_cache_get_devices		(FwupdDeviceCache *self,
+							 GCancellable	*cancellable,
+							 GError		**error);
+guint64		 fwupd_device_cache_get_generation	(FwupdDeviceCache *self);
+
+G_END_DECLS
+
+#endif /* __FWUPD_DEVICE_CACHE_H */
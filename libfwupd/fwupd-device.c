@@ -32,13 +32,19 @@
 
 static void fwupd_device_finalize	 (GObject *object);
 
+typedef struct {
+	guint8				 bytes[FWUPD_GUID_RAW_SZ];
+} FwupdGuidRaw;
+
 typedef struct {
 	gchar				*id;
 	guint64				 created;
 	guint64				 modified;
 	guint64				 flags;
 	gchar				*appstream_id;
-	GPtrArray			*guids;
+	GArray				*guids_raw;	/* of FwupdGuidRaw, sorted */
+	GPtrArray			*guids;		/* of pooled string, lazy */
+	const gchar			*guid_default;	/* pooled, first added */
 	gchar				*name;
 	gchar				*summary;
 	gchar				*description;
@@ -128,6 +134,10 @@ fwupd_device_set_summary (FwupdDevice *device, const gchar *summary)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+
+	/* not changed */
+	if (g_strcmp0 (priv->summary, summary) == 0)
+		return;
 	g_free (priv->summary);
 	priv->summary = g_strdup (summary);
 }
@@ -164,10 +174,43 @@ fwupd_device_set_id (FwupdDevice *device, const gchar *id)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+
+	/* not changed */
+	if (g_strcmp0 (priv->id, id) == 0)
+		return;
 	g_free (priv->id);
 	priv->id = g_strdup (id);
 }
 
+/* binary search over the sorted packed GUIDs; when not found @idx_out is
+ * the index the value would have to be inserted at to keep the ordering */
+static gboolean
+fwupd_device_guid_raw_find (FwupdDevicePrivate *priv,
+			    const FwupdGuidRaw *raw,
+			    guint *idx_out)
+{
+	guint lo = 0;
+	guint hi = priv->guids_raw->len;
+	while (lo < hi) {
+		guint mid = (lo + hi) / 2;
+		const FwupdGuidRaw *tmp = &g_array_index (priv->guids_raw,
+							  FwupdGuidRaw, mid);
+		gint rc = memcmp (raw->bytes, tmp->bytes, FWUPD_GUID_RAW_SZ);
+		if (rc == 0) {
+			if (idx_out != NULL)
+				*idx_out = mid;
+			return TRUE;
+		}
+		if (rc < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	if (idx_out != NULL)
+		*idx_out = lo;
+	return FALSE;
+}
+
 /**
  * fwupd_device_get_guids:
  * @device: A #FwupdDevice
@@ -183,6 +226,19 @@ fwupd_device_get_guids (FwupdDevice *device)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_val_if_fail (FWUPD_IS_DEVICE (device), NULL);
+
+	/* materialize strings from the packed form on first use; the same
+	 * container is then kept in sync so callers can hold on to it */
+	if (priv->guids == NULL) {
+		priv->guids = g_ptr_array_new_with_free_func ((GDestroyNotify) fwupd_strpool_unref);
+		for (guint i = 0; i < priv->guids_raw->len; i++) {
+			const FwupdGuidRaw *raw = &g_array_index (priv->guids_raw,
+								  FwupdGuidRaw, i);
+			g_autofree gchar *tmp = fwupd_guid_to_string (raw->bytes);
+			g_ptr_array_add (priv->guids,
+					 (gchar *) fwupd_strpool_add (tmp));
+		}
+	}
 	return priv->guids;
 }
 
@@ -201,16 +257,13 @@ gboolean
 fwupd_device_has_guid (FwupdDevice *device, const gchar *guid)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
-	guint i;
+	FwupdGuidRaw raw;
 
 	g_return_val_if_fail (FWUPD_IS_DEVICE (device), FALSE);
 
-	for (i = 0; i < priv->guids->len; i++) {
-		const gchar *guid_tmp = g_ptr_array_index (priv->guids, i);
-		if (g_strcmp0 (guid, guid_tmp) == 0)
-			return TRUE;
-	}
-	return FALSE;
+	if (!fwupd_guid_from_string (guid, raw.bytes))
+		return FALSE;
+	return fwupd_device_guid_raw_find (priv, &raw, NULL);
 }
 
 /**
@@ -226,17 +279,36 @@ void
 fwupd_device_add_guid (FwupdDevice *device, const gchar *guid)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
+	FwupdGuidRaw raw;
+	guint idx = 0;
+
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
-	if (fwupd_device_has_guid (device, guid))
+
+	/* sixteen packed bytes instead of an owned 37 byte string; a fleet
+	 * view holding thousands of devices repeats these a lot */
+	if (!fwupd_guid_from_string (guid, raw.bytes)) {
+		g_warning ("not adding malformed GUID %s", guid);
 		return;
-	g_ptr_array_add (priv->guids, g_strdup (guid));
+	}
+	if (fwupd_device_guid_raw_find (priv, &raw, &idx))
+		return;
+	g_array_insert_val (priv->guids_raw, idx, raw);
+	if (priv->guid_default == NULL)
+		priv->guid_default = fwupd_strpool_add (guid);
+
+	/* keep any materialized view consistent without rebuilding it */
+	if (priv->guids != NULL) {
+		g_autofree gchar *tmp = fwupd_guid_to_string (raw.bytes);
+		g_ptr_array_insert (priv->guids, (gint) idx,
+				    (gchar *) fwupd_strpool_add (tmp));
+	}
 }
 
 /**
  * fwupd_device_get_guid_default:
  * @device: A #FwupdDevice
  *
- * Gets the default GUID.
+ * Gets the default GUID, i.e. the first one ever added.
  *
  * Returns: the GUID, or %NULL if unset
  *
@@ -247,9 +319,7 @@ fwupd_device_get_guid_default (FwupdDevice *device)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_val_if_fail (FWUPD_IS_DEVICE (device), NULL);
-	if (priv->guids->len == 0)
-		return NULL;
-	return g_ptr_array_index (priv->guids, 0);
+	return priv->guid_default;
 }
 
 /**
@@ -284,6 +354,10 @@ fwupd_device_set_name (FwupdDevice *device, const gchar *name)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+
+	/* not changed */
+	if (g_strcmp0 (priv->name, name) == 0)
+		return;
 	g_free (priv->name);
 	priv->name = g_strdup (name);
 }
@@ -320,8 +394,12 @@ fwupd_device_set_vendor (FwupdDevice *device, const gchar *vendor)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
-	g_free (priv->vendor);
-	priv->vendor = g_strdup (vendor);
+
+	/* not changed */
+	if (g_strcmp0 (priv->vendor, vendor) == 0)
+		return;
+	fwupd_strpool_unref (priv->vendor);
+	priv->vendor = (gchar *) fwupd_strpool_add (vendor);
 }
 
 /**
@@ -356,6 +434,10 @@ fwupd_device_set_description (FwupdDevice *device, const gchar *description)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+
+	/* not changed */
+	if (g_strcmp0 (priv->description, description) == 0)
+		return;
 	g_free (priv->description);
 	priv->description = g_strdup (description);
 }
@@ -392,8 +474,12 @@ fwupd_device_set_version (FwupdDevice *device, const gchar *version)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
-	g_free (priv->version);
-	priv->version = g_strdup (version);
+
+	/* not changed */
+	if (g_strcmp0 (priv->version, version) == 0)
+		return;
+	fwupd_strpool_unref (priv->version);
+	priv->version = (gchar *) fwupd_strpool_add (version);
 }
 
 /**
@@ -428,8 +514,12 @@ fwupd_device_set_version_lowest (FwupdDevice *device, const gchar *version_lowes
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
-	g_free (priv->version_lowest);
-	priv->version_lowest = g_strdup (version_lowest);
+
+	/* not changed */
+	if (g_strcmp0 (priv->version_lowest, version_lowest) == 0)
+		return;
+	fwupd_strpool_unref (priv->version_lowest);
+	priv->version_lowest = (gchar *) fwupd_strpool_add (version_lowest);
 }
 
 /**
@@ -464,6 +554,10 @@ fwupd_device_set_version_bootloader (FwupdDevice *device, const gchar *version_b
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+
+	/* not changed */
+	if (g_strcmp0 (priv->version_bootloader, version_bootloader) == 0)
+		return;
 	g_free (priv->version_bootloader);
 	priv->version_bootloader = g_strdup (version_bootloader);
 }
@@ -535,8 +629,12 @@ fwupd_device_set_provider (FwupdDevice *device, const gchar *provider)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
-	g_free (priv->provider);
-	priv->provider = g_strdup (provider);
+
+	/* not changed */
+	if (g_strcmp0 (priv->provider, provider) == 0)
+		return;
+	fwupd_strpool_unref (priv->provider);
+	priv->provider = (gchar *) fwupd_strpool_add (provider);
 }
 
 /**
@@ -702,11 +800,12 @@ void
 fwupd_device_to_variant_builder (FwupdDevice *device, GVariantBuilder *builder)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
-	if (priv->guids->len > 0) {
+	if (priv->guids_raw->len > 0) {
+		GPtrArray *guids = fwupd_device_get_guids (device);
 		guint i;
 		g_autoptr(GString) str = g_string_new ("");
-		for (i = 0; i < priv->guids->len; i++) {
-			const gchar *guid = g_ptr_array_index (priv->guids, i);
+		for (i = 0; i < guids->len; i++) {
+			const gchar *guid = g_ptr_array_index (guids, i);
 			g_string_append_printf (str, "%s,", guid);
 		}
 		if (str->len > 0)
@@ -911,22 +1010,8 @@ fwupd_pad_kv_unx (GString *str, const gchar *key, guint64 value)
 static void
 fwupd_pad_kv_dfl (GString *str, const gchar *key, guint64 device_flags)
 {
-	guint i;
-	g_autoptr(GString) tmp = NULL;
-
-	tmp = g_string_new ("");
-	for (i = 0; i < 64; i++) {
-		if ((device_flags & ((guint64) 1 << i)) == 0)
-			continue;
-		g_string_append_printf (tmp, "%s|",
-					fwupd_device_flag_to_string ((guint64) 1 << i));
-	}
-	if (tmp->len == 0) {
-		g_string_append (tmp, fwupd_device_flag_to_string (0));
-	} else {
-		g_string_truncate (tmp, tmp->len - 1);
-	}
-	fwupd_pad_kv_str (str, key, tmp->str);
+	fwupd_pad_kv_str (str, key,
+			  fwupd_device_flags_to_string_cached (device_flags));
 }
 
 static void
@@ -955,13 +1040,15 @@ gchar *
 fwupd_device_to_string (FwupdDevice *device)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
+	GPtrArray *guids;
 	GString *str;
 
 	g_return_val_if_fail (FWUPD_IS_DEVICE (device), NULL);
 
 	str = g_string_new ("");
-	for (guint i = 0; i < priv->guids->len; i++) {
-		const gchar *guid = g_ptr_array_index (priv->guids, i);
+	guids = fwupd_device_get_guids (device);
+	for (guint i = 0; i < guids->len; i++) {
+		const gchar *guid = g_ptr_array_index (guids, i);
 		fwupd_pad_kv_str (str, FWUPD_RESULT_KEY_GUID, guid);
 	}
 	fwupd_pad_kv_str (str, FWUPD_RESULT_KEY_DEVICE_ID, priv->id);
@@ -996,7 +1083,7 @@ static void
 fwupd_device_init (FwupdDevice *device)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
-	priv->guids = g_ptr_array_new_with_free_func (g_free);
+	priv->guids_raw = g_array_new (FALSE, FALSE, sizeof (FwupdGuidRaw));
 	priv->checksums = g_ptr_array_new_with_free_func (g_free);
 }
 
@@ -1009,12 +1096,15 @@ fwupd_device_finalize (GObject *object)
 	g_free (priv->description);
 	g_free (priv->id);
 	g_free (priv->name);
-	g_free (priv->vendor);
-	g_free (priv->provider);
-	g_free (priv->version);
-	g_free (priv->version_lowest);
+	fwupd_strpool_unref (priv->vendor);
+	fwupd_strpool_unref (priv->provider);
+	fwupd_strpool_unref (priv->version);
+	fwupd_strpool_unref (priv->version_lowest);
 	g_free (priv->version_bootloader);
-	g_ptr_array_unref (priv->guids);
+	g_array_unref (priv->guids_raw);
+	if (priv->guids != NULL)
+		g_ptr_array_unref (priv->guids);
+	fwupd_strpool_unref (priv->guid_default);
 	g_ptr_array_unref (priv->checksums);
 
 	G_OBJECT_CLASS (fwupd_device_parent_class)->finalize (object);
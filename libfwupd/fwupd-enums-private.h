@@ -22,6 +22,17 @@
 #ifndef __FWUPD_ENUMS_PRIVATE_H
 #define __FWUPD_ENUMS_PRIVATE_H
 
+#include "fwupd-enums.h"
+
+gsize		 fwupd_device_flags_to_string_buf	(FwupdDeviceFlags device_flags,
+							 gchar		*buf,
+							 gsize		 bufsz);
+const gchar	*fwupd_device_flags_to_string_cached	(FwupdDeviceFlags device_flags);
+gsize		 fwupd_trust_flags_to_string_buf	(FwupdTrustFlags trust_flags,
+							 gchar		*buf,
+							 gsize		 bufsz);
+const gchar	*fwupd_trust_flags_to_string_cached	(FwupdTrustFlags trust_flags);
+
 /* FIXME: change the keys to the new names when we bump major version */
 #define FWUPD_RESULT_KEY_DEVICE_CREATED		"Created"	/* t */
 #define FWUPD_RESULT_KEY_DEVICE_DESCRIPTION	"Description"	/* s */
@@ -21,7 +21,55 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include "fwupd-enums.h"
+#include "fwupd-enums-private.h"
+
+/* the same tables back both conversion directions, so neither needs any
+ * allocations or a chain of string comparisons */
+static const gchar *fwupd_status_strings[] = {
+	[FWUPD_STATUS_UNKNOWN]		= "unknown",
+	[FWUPD_STATUS_IDLE]		= "idle",
+	[FWUPD_STATUS_LOADING]		= "loading",
+	[FWUPD_STATUS_DECOMPRESSING]	= "decompressing",
+	[FWUPD_STATUS_DEVICE_RESTART]	= "device-restart",
+	[FWUPD_STATUS_DEVICE_WRITE]	= "device-write",
+	[FWUPD_STATUS_DEVICE_VERIFY]	= "device-verify",
+	[FWUPD_STATUS_SCHEDULING]	= "scheduling",
+};
+
+static const gchar *fwupd_update_state_strings[] = {
+	[FWUPD_UPDATE_STATE_UNKNOWN]	= "unknown",
+	[FWUPD_UPDATE_STATE_PENDING]	= "pending",
+	[FWUPD_UPDATE_STATE_SUCCESS]	= "success",
+	[FWUPD_UPDATE_STATE_FAILED]	= "failed",
+};
+
+/* the flag kinds are bitmasks, so these have to store the value too */
+static const struct {
+	FwupdDeviceFlags	 value;
+	const gchar		*string;
+} fwupd_device_flag_strings[] = {
+	{ FWUPD_DEVICE_FLAG_NONE,		"none" },
+	{ FWUPD_DEVICE_FLAG_INTERNAL,		"internal" },
+	{ FWUPD_DEVICE_FLAG_ALLOW_ONLINE,	"allow-online" },
+	{ FWUPD_DEVICE_FLAG_ALLOW_OFFLINE,	"allow-offline" },
+	{ FWUPD_DEVICE_FLAG_REQUIRE_AC,		"require-ac" },
+	{ FWUPD_DEVICE_FLAG_LOCKED,		"locked" },
+	{ FWUPD_DEVICE_FLAG_SUPPORTED,		"supported" },
+	{ FWUPD_DEVICE_FLAG_NEEDS_BOOTLOADER,	"needs-bootloader" },
+	{ FWUPD_DEVICE_FLAG_UNKNOWN,		"unknown" },
+};
+
+static const struct {
+	FwupdTrustFlags		 value;
+	const gchar		*string;
+} fwupd_trust_flag_strings[] = {
+	{ FWUPD_TRUST_FLAG_NONE,		"none" },
+	{ FWUPD_TRUST_FLAG_PAYLOAD,		"payload" },
+	{ FWUPD_TRUST_FLAG_METADATA,		"metadata" },
+};
 
 /**
  * fwupd_status_to_string:
@@ -36,23 +84,9 @@
 const gchar *
 fwupd_status_to_string (FwupdStatus status)
 {
-	if (status == FWUPD_STATUS_UNKNOWN)
-		return "unknown";
-	if (status == FWUPD_STATUS_IDLE)
-		return "idle";
-	if (status == FWUPD_STATUS_DECOMPRESSING)
-		return "decompressing";
-	if (status == FWUPD_STATUS_LOADING)
-		return "loading";
-	if (status == FWUPD_STATUS_DEVICE_RESTART)
-		return "device-restart";
-	if (status == FWUPD_STATUS_DEVICE_WRITE)
-		return "device-write";
-	if (status == FWUPD_STATUS_DEVICE_VERIFY)
-		return "device-verify";
-	if (status == FWUPD_STATUS_SCHEDULING)
-		return "scheduling";
-	return NULL;
+	if ((guint) status >= G_N_ELEMENTS (fwupd_status_strings))
+		return NULL;
+	return fwupd_status_strings[status];
 }
 
 /**
@@ -68,22 +102,14 @@ fwupd_status_to_string (FwupdStatus status)
 FwupdStatus
 fwupd_status_from_string (const gchar *status)
 {
-	if (g_strcmp0 (status, "unknown") == 0)
-		return FWUPD_STATUS_UNKNOWN;
-	if (g_strcmp0 (status, "idle") == 0)
-		return FWUPD_STATUS_IDLE;
-	if (g_strcmp0 (status, "decompressing") == 0)
-		return FWUPD_STATUS_DECOMPRESSING;
-	if (g_strcmp0 (status, "loading") == 0)
-		return FWUPD_STATUS_LOADING;
-	if (g_strcmp0 (status, "device-restart") == 0)
-		return FWUPD_STATUS_DEVICE_RESTART;
-	if (g_strcmp0 (status, "device-write") == 0)
-		return FWUPD_STATUS_DEVICE_WRITE;
-	if (g_strcmp0 (status, "device-verify") == 0)
-		return FWUPD_STATUS_DEVICE_VERIFY;
-	if (g_strcmp0 (status, "scheduling") == 0)
-		return FWUPD_STATUS_SCHEDULING;
+	if (status != NULL) {
+		for (guint i = 0; i < G_N_ELEMENTS (fwupd_status_strings); i++) {
+			const gchar *tmp = fwupd_status_strings[i];
+			/* cheap first-character reject before the compare */
+			if (tmp[0] == status[0] && strcmp (tmp, status) == 0)
+				return i;
+		}
+	}
 	return FWUPD_STATUS_LAST;
 }
 
@@ -100,24 +126,10 @@ fwupd_status_from_string (const gchar *status)
 const gchar *
 fwupd_device_flag_to_string (FwupdDeviceFlags device_flag)
 {
-	if (device_flag == FWUPD_DEVICE_FLAG_NONE)
-		return "none";
-	if (device_flag == FWUPD_DEVICE_FLAG_INTERNAL)
-		return "internal";
-	if (device_flag == FWUPD_DEVICE_FLAG_ALLOW_ONLINE)
-		return "allow-online";
-	if (device_flag == FWUPD_DEVICE_FLAG_ALLOW_OFFLINE)
-		return "allow-offline";
-	if (device_flag == FWUPD_DEVICE_FLAG_REQUIRE_AC)
-		return "require-ac";
-	if (device_flag == FWUPD_DEVICE_FLAG_LOCKED)
-		return "locked";
-	if (device_flag == FWUPD_DEVICE_FLAG_SUPPORTED)
-		return "supported";
-	if (device_flag == FWUPD_DEVICE_FLAG_NEEDS_BOOTLOADER)
-		return "needs-bootloader";
-	if (device_flag == FWUPD_DEVICE_FLAG_UNKNOWN)
-		return "unknown";
+	for (guint i = 0; i < G_N_ELEMENTS (fwupd_device_flag_strings); i++) {
+		if (fwupd_device_flag_strings[i].value == device_flag)
+			return fwupd_device_flag_strings[i].string;
+	}
 	return NULL;
 }
 
@@ -134,22 +146,15 @@ fwupd_device_flag_to_string (FwupdDeviceFlags device_flag)
 FwupdDeviceFlags
 fwupd_device_flag_from_string (const gchar *device_flag)
 {
-	if (g_strcmp0 (device_flag, "none") == 0)
-		return FWUPD_DEVICE_FLAG_NONE;
-	if (g_strcmp0 (device_flag, "internal") == 0)
-		return FWUPD_DEVICE_FLAG_INTERNAL;
-	if (g_strcmp0 (device_flag, "allow-online") == 0)
-		return FWUPD_DEVICE_FLAG_ALLOW_ONLINE;
-	if (g_strcmp0 (device_flag, "allow-offline") == 0)
-		return FWUPD_DEVICE_FLAG_ALLOW_OFFLINE;
-	if (g_strcmp0 (device_flag, "require-ac") == 0)
-		return FWUPD_DEVICE_FLAG_REQUIRE_AC;
-	if (g_strcmp0 (device_flag, "locked") == 0)
-		return FWUPD_DEVICE_FLAG_LOCKED;
-	if (g_strcmp0 (device_flag, "supported") == 0)
-		return FWUPD_DEVICE_FLAG_SUPPORTED;
-	if (g_strcmp0 (device_flag, "needs-bootloader") == 0)
-		return FWUPD_DEVICE_FLAG_NEEDS_BOOTLOADER;
+	if (device_flag != NULL) {
+		for (guint i = 0; i < G_N_ELEMENTS (fwupd_device_flag_strings); i++) {
+			const gchar *tmp = fwupd_device_flag_strings[i].string;
+			/* cheap first-character reject before the compare */
+			if (tmp[0] == device_flag[0] &&
+			    strcmp (tmp, device_flag) == 0)
+				return fwupd_device_flag_strings[i].value;
+		}
+	}
 	return FWUPD_DEVICE_FLAG_UNKNOWN;
 }
 
@@ -166,15 +171,9 @@ fwupd_device_flag_from_string (const gchar *device_flag)
 const gchar *
 fwupd_update_state_to_string (FwupdUpdateState update_state)
 {
-	if (update_state == FWUPD_UPDATE_STATE_UNKNOWN)
-		return "unknown";
-	if (update_state == FWUPD_UPDATE_STATE_PENDING)
-		return "pending";
-	if (update_state == FWUPD_UPDATE_STATE_SUCCESS)
-		return "success";
-	if (update_state == FWUPD_UPDATE_STATE_FAILED)
-		return "failed";
-	return NULL;
+	if ((guint) update_state >= G_N_ELEMENTS (fwupd_update_state_strings))
+		return NULL;
+	return fwupd_update_state_strings[update_state];
 }
 
 /**
@@ -190,14 +189,15 @@ fwupd_update_state_to_string (FwupdUpdateState update_state)
 FwupdUpdateState
 fwupd_update_state_from_string (const gchar *update_state)
 {
-	if (g_strcmp0 (update_state, "unknown") == 0)
-		return FWUPD_UPDATE_STATE_UNKNOWN;
-	if (g_strcmp0 (update_state, "pending") == 0)
-		return FWUPD_UPDATE_STATE_PENDING;
-	if (g_strcmp0 (update_state, "success") == 0)
-		return FWUPD_UPDATE_STATE_SUCCESS;
-	if (g_strcmp0 (update_state, "failed") == 0)
-		return FWUPD_UPDATE_STATE_FAILED;
+	if (update_state != NULL) {
+		for (guint i = 0; i < G_N_ELEMENTS (fwupd_update_state_strings); i++) {
+			const gchar *tmp = fwupd_update_state_strings[i];
+			/* cheap first-character reject before the compare */
+			if (tmp[0] == update_state[0] &&
+			    strcmp (tmp, update_state) == 0)
+				return i;
+		}
+	}
 	return FWUPD_UPDATE_STATE_UNKNOWN;
 }
 
@@ -214,12 +214,10 @@ fwupd_update_state_from_string (const gchar *update_state)
 const gchar *
 fwupd_trust_flag_to_string (FwupdTrustFlags trust_flag)
 {
-	if (trust_flag == FWUPD_TRUST_FLAG_NONE)
-		return "none";
-	if (trust_flag == FWUPD_TRUST_FLAG_PAYLOAD)
-		return "payload";
-	if (trust_flag == FWUPD_TRUST_FLAG_METADATA)
-		return "metadata";
+	for (guint i = 0; i < G_N_ELEMENTS (fwupd_trust_flag_strings); i++) {
+		if (fwupd_trust_flag_strings[i].value == trust_flag)
+			return fwupd_trust_flag_strings[i].string;
+	}
 	return NULL;
 }
 
@@ -236,11 +234,125 @@ fwupd_trust_flag_to_string (FwupdTrustFlags trust_flag)
 FwupdTrustFlags
 fwupd_trust_flag_from_string (const gchar *trust_flag)
 {
-	if (g_strcmp0 (trust_flag, "none") == 0)
-		return FWUPD_TRUST_FLAG_NONE;
-	if (g_strcmp0 (trust_flag, "payload") == 0)
-		return FWUPD_TRUST_FLAG_PAYLOAD;
-	if (g_strcmp0 (trust_flag, "metadata") == 0)
-		return FWUPD_TRUST_FLAG_METADATA;
+	if (trust_flag != NULL) {
+		for (guint i = 0; i < G_N_ELEMENTS (fwupd_trust_flag_strings); i++) {
+			const gchar *tmp = fwupd_trust_flag_strings[i].string;
+			/* cheap first-character reject before the compare */
+			if (tmp[0] == trust_flag[0] &&
+			    strcmp (tmp, trust_flag) == 0)
+				return fwupd_trust_flag_strings[i].value;
+		}
+	}
 	return FWUPD_TRUST_FLAG_LAST;
 }
+
+G_LOCK_DEFINE_STATIC (fwupd_flags_cache);
+
+/* writes the '|' delimited flag names into a caller-provided buffer
+ * without allocating, returning the length used */
+gsize
+fwupd_device_flags_to_string_buf (FwupdDeviceFlags device_flags,
+				  gchar *buf, gsize bufsz)
+{
+	g_return_val_if_fail (buf != NULL, 0);
+	g_return_val_if_fail (bufsz > 0, 0);
+
+	buf[0] = '\0';
+	for (guint i = 0; i < 64; i++) {
+		const gchar *tmp;
+		if ((device_flags & ((guint64) 1 << i)) == 0)
+			continue;
+		tmp = fwupd_device_flag_to_string ((guint64) 1 << i);
+		if (tmp == NULL)
+			continue;
+		if (buf[0] != '\0')
+			g_strlcat (buf, "|", bufsz);
+		g_strlcat (buf, tmp, bufsz);
+	}
+	if (buf[0] == '\0')
+		g_strlcpy (buf, fwupd_device_flag_to_string (0), bufsz);
+	return strlen (buf);
+}
+
+/* only a handful of distinct flag combinations exist in practice, so the
+ * canonical joined form is built once per bitset and then reused */
+const gchar *
+fwupd_device_flags_to_string_cached (FwupdDeviceFlags device_flags)
+{
+	static GHashTable *cache = NULL;
+	const gchar *tmp;
+
+	G_LOCK (fwupd_flags_cache);
+	if (cache == NULL) {
+		cache = g_hash_table_new_full (g_int64_hash, g_int64_equal,
+					       g_free, g_free);
+	}
+	tmp = g_hash_table_lookup (cache, &device_flags);
+	if (tmp == NULL) {
+		gchar buf[1024];
+		guint64 *key = g_new0 (guint64, 1);
+		fwupd_device_flags_to_string_buf (device_flags, buf, sizeof (buf));
+		*key = device_flags;
+		tmp = g_strdup (buf);
+		g_hash_table_insert (cache, key, (gpointer) tmp);
+	}
+	G_UNLOCK (fwupd_flags_cache);
+
+	/* entries are never removed, so the value stays valid */
+	return tmp;
+}
+
+/* writes the '|' delimited flag names into a caller-provided buffer
+ * without allocating, returning the length used */
+gsize
+fwupd_trust_flags_to_string_buf (FwupdTrustFlags trust_flags,
+				 gchar *buf, gsize bufsz)
+{
+	g_return_val_if_fail (buf != NULL, 0);
+	g_return_val_if_fail (bufsz > 0, 0);
+
+	buf[0] = '\0';
+	for (guint64 i = 1; i < FWUPD_TRUST_FLAG_LAST; i *= 2) {
+		const gchar *tmp;
+		if ((trust_flags & i) == 0)
+			continue;
+		tmp = fwupd_trust_flag_to_string (i);
+		if (tmp == NULL)
+			continue;
+		if (buf[0] != '\0')
+			g_strlcat (buf, "|", bufsz);
+		g_strlcat (buf, tmp, bufsz);
+	}
+	if (buf[0] == '\0')
+		g_strlcpy (buf, fwupd_trust_flag_to_string (0), bufsz);
+	return strlen (buf);
+}
+
+/* only a handful of distinct flag combinations exist in practice, so the
+ * canonical joined form is built once per bitset and then reused */
+const gchar *
+fwupd_trust_flags_to_string_cached (FwupdTrustFlags trust_flags)
+{
+	static GHashTable *cache = NULL;
+	const gchar *tmp;
+	guint64 flags = trust_flags;
+
+	G_LOCK (fwupd_flags_cache);
+	if (cache == NULL) {
+		cache = g_hash_table_new_full (g_int64_hash, g_int64_equal,
+					       g_free, g_free);
+	}
+	tmp = g_hash_table_lookup (cache, &flags);
+	if (tmp == NULL) {
+		gchar buf[1024];
+		guint64 *key = g_new0 (guint64, 1);
+		fwupd_trust_flags_to_string_buf (trust_flags, buf, sizeof (buf));
+		*key = flags;
+		tmp = g_strdup (buf);
+		g_hash_table_insert (cache, key, (gpointer) tmp);
+	}
+	G_UNLOCK (fwupd_flags_cache);
+
+	/* entries are never removed, so the value stays valid */
+	return tmp;
+}
@@ -24,11 +24,13 @@
 
 #include <glib-object.h>
 
+#include "fwupd-common-private.h"
 #include "fwupd-release.h"
 
 G_BEGIN_DECLS
 
 FwupdRelease	*fwupd_release_new_from_data		(GVariant	*data);
+const guint8	*fwupd_release_get_version_key		(FwupdRelease	*release);
 GVariant	*fwupd_release_to_data			(FwupdRelease	*release,
 							 const gchar	*type_string);
 void		 fwupd_release_to_variant_builder	(FwupdRelease	*release,
@@ -46,6 +46,8 @@ typedef struct {
 	gchar				*version;
 	gchar				*remote_id;
 	guint64				 size;
+	guint8				 version_key[FWUPD_VERSION_KEY_SZ];
+	gboolean			 version_key_valid;
 } FwupdReleasePrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (FwupdRelease, fwupd_release, G_TYPE_OBJECT)
@@ -83,6 +85,10 @@ fwupd_release_set_remote_id (FwupdRelease *release, const gchar *remote_id)
 {
 	FwupdReleasePrivate *priv = GET_PRIVATE (release);
 	g_return_if_fail (FWUPD_IS_RELEASE (release));
+
+	/* not changed */
+	if (g_strcmp0 (priv->remote_id, remote_id) == 0)
+		return;
 	g_free (priv->remote_id);
 	priv->remote_id = g_strdup (remote_id);
 }
@@ -119,8 +125,28 @@ fwupd_release_set_version (FwupdRelease *release, const gchar *version)
 {
 	FwupdReleasePrivate *priv = GET_PRIVATE (release);
 	g_return_if_fail (FWUPD_IS_RELEASE (release));
-	g_free (priv->version);
-	priv->version = g_strdup (version);
+
+	/* not changed */
+	if (g_strcmp0 (priv->version, version) == 0)
+		return;
+	fwupd_strpool_unref (priv->version);
+	priv->version = (gchar *) fwupd_strpool_add (version);
+
+	/* pack the comparison key once rather than on every vercmp */
+	priv->version_key_valid =
+		fwupd_version_key_from_string (version, priv->version_key);
+}
+
+/* the precomputed comparison key for the version, or %NULL when the
+ * version is not plain dotted-decimal and string comparison is needed */
+const guint8 *
+fwupd_release_get_version_key (FwupdRelease *release)
+{
+	FwupdReleasePrivate *priv = GET_PRIVATE (release);
+	g_return_val_if_fail (FWUPD_IS_RELEASE (release), NULL);
+	if (!priv->version_key_valid)
+		return NULL;
+	return priv->version_key;
 }
 
 /**
@@ -155,6 +181,10 @@ fwupd_release_set_filename (FwupdRelease *release, const gchar *filename)
 {
 	FwupdReleasePrivate *priv = GET_PRIVATE (release);
 	g_return_if_fail (FWUPD_IS_RELEASE (release));
+
+	/* not changed */
+	if (g_strcmp0 (priv->filename, filename) == 0)
+		return;
 	g_free (priv->filename);
 	priv->filename = g_strdup (filename);
 }
@@ -232,6 +262,10 @@ fwupd_release_set_uri (FwupdRelease *release, const gchar *uri)
 {
 	FwupdReleasePrivate *priv = GET_PRIVATE (release);
 	g_return_if_fail (FWUPD_IS_RELEASE (release));
+
+	/* not changed */
+	if (g_strcmp0 (priv->uri, uri) == 0)
+		return;
 	g_free (priv->uri);
 	priv->uri = g_strdup (uri);
 }
@@ -268,6 +302,10 @@ fwupd_release_set_homepage (FwupdRelease *release, const gchar *homepage)
 {
 	FwupdReleasePrivate *priv = GET_PRIVATE (release);
 	g_return_if_fail (FWUPD_IS_RELEASE (release));
+
+	/* not changed */
+	if (g_strcmp0 (priv->homepage, homepage) == 0)
+		return;
 	g_free (priv->homepage);
 	priv->homepage = g_strdup (homepage);
 }
@@ -304,6 +342,10 @@ fwupd_release_set_description (FwupdRelease *release, const gchar *description)
 {
 	FwupdReleasePrivate *priv = GET_PRIVATE (release);
 	g_return_if_fail (FWUPD_IS_RELEASE (release));
+
+	/* not changed */
+	if (g_strcmp0 (priv->description, description) == 0)
+		return;
 	g_free (priv->description);
 	priv->description = g_strdup (description);
 }
@@ -340,6 +382,10 @@ fwupd_release_set_appstream_id (FwupdRelease *release, const gchar *appstream_id
 {
 	FwupdReleasePrivate *priv = GET_PRIVATE (release);
 	g_return_if_fail (FWUPD_IS_RELEASE (release));
+
+	/* not changed */
+	if (g_strcmp0 (priv->appstream_id, appstream_id) == 0)
+		return;
 	g_free (priv->appstream_id);
 	priv->appstream_id = g_strdup (appstream_id);
 }
@@ -411,6 +457,10 @@ fwupd_release_set_summary (FwupdRelease *release, const gchar *summary)
 {
 	FwupdReleasePrivate *priv = GET_PRIVATE (release);
 	g_return_if_fail (FWUPD_IS_RELEASE (release));
+
+	/* not changed */
+	if (g_strcmp0 (priv->summary, summary) == 0)
+		return;
 	g_free (priv->summary);
 	priv->summary = g_strdup (summary);
 }
@@ -447,8 +497,12 @@ fwupd_release_set_vendor (FwupdRelease *release, const gchar *vendor)
 {
 	FwupdReleasePrivate *priv = GET_PRIVATE (release);
 	g_return_if_fail (FWUPD_IS_RELEASE (release));
-	g_free (priv->vendor);
-	priv->vendor = g_strdup (vendor);
+
+	/* not changed */
+	if (g_strcmp0 (priv->vendor, vendor) == 0)
+		return;
+	fwupd_strpool_unref (priv->vendor);
+	priv->vendor = (gchar *) fwupd_strpool_add (vendor);
 }
 
 /**
@@ -483,6 +537,10 @@ fwupd_release_set_license (FwupdRelease *release, const gchar *license)
 {
 	FwupdReleasePrivate *priv = GET_PRIVATE (release);
 	g_return_if_fail (FWUPD_IS_RELEASE (release));
+
+	/* not changed */
+	if (g_strcmp0 (priv->license, license) == 0)
+		return;
 	g_free (priv->license);
 	priv->license = g_strdup (license);
 }
@@ -519,6 +577,10 @@ fwupd_release_set_name (FwupdRelease *release, const gchar *name)
 {
 	FwupdReleasePrivate *priv = GET_PRIVATE (release);
 	g_return_if_fail (FWUPD_IS_RELEASE (release));
+
+	/* not changed */
+	if (g_strcmp0 (priv->name, name) == 0)
+		return;
 	g_free (priv->name);
 	priv->name = g_strdup (name);
 }
@@ -784,8 +846,8 @@ fwupd_release_finalize (GObject *object)
 	g_free (priv->summary);
 	g_free (priv->uri);
 	g_free (priv->homepage);
-	g_free (priv->vendor);
-	g_free (priv->version);
+	fwupd_strpool_unref (priv->vendor);
+	fwupd_strpool_unref (priv->version);
 	g_free (priv->remote_id);
 	g_ptr_array_unref (priv->checksums);
 
@@ -32,9 +32,13 @@ struct _FwupdRemote
 	gchar			*id;
 	gchar			*filename;
 	gchar			*filename_asc;
+	gchar			*remotes_filename;
+	gchar			*etag;
+	gchar			*last_modified;
 	gboolean		 enabled;
 	SoupURI			*uri;
 	SoupURI			*uri_asc;
+	gchar			**firmware_base_uris;
 };
 
 enum {
@@ -84,7 +88,8 @@ fwupd_remote_load_from_filename (FwupdRemote *self,
 	self->id = g_path_get_basename (filename);
 	g_strdelimit (self->id, ".", '\0');
 
-	/* load file */
+	/* load file, remembering the path so validators can be saved back */
+	self->remotes_filename = g_strdup (filename);
 	kf = g_key_file_new ();
 	if (!g_key_file_load_from_file (kf, filename, G_KEY_FILE_NONE, error))
 		return FALSE;
@@ -112,6 +117,16 @@ fwupd_remote_load_from_filename (FwupdRemote *self,
 	if (password != NULL && password[0] != '\0')
 		soup_uri_set_password (self->uri, password);
 
+	/* the HTTP validators saved from the last successful download */
+	self->etag = g_key_file_get_string (kf, group, "ETag", NULL);
+	self->last_modified = g_key_file_get_string (kf, group, "LastModified", NULL);
+
+	/* prioritized mirrors for firmware payloads, e.g. a LAN mirror
+	 * listed before the upstream CDN */
+	self->firmware_base_uris = g_key_file_get_string_list (kf, group,
+							       "FirmwareBaseURI",
+							       NULL, NULL);
+
 	/* generate the signature URI too */
 	url_asc = g_strdup_printf ("%s.asc", url);
 	self->uri_asc = fwupd_remote_build_uri (self, url_asc, error);
@@ -181,6 +196,97 @@ fwupd_remote_build_uri (FwupdRemote *self, const gchar *url, GError **error)
 	return uri;
 }
 
+/**
+ * fwupd_remote_build_firmware_uris:
+ * @self: A #FwupdRemote
+ * @url: the upstream firmware URL from the metadata
+ * @error: the #GError, or %NULL
+ *
+ * Builds the prioritized list of URIs to try when downloading a firmware
+ * payload. Each base URI from the FirmwareBaseURI config key is combined
+ * with the basename of @url, in the order listed, and the unmodified
+ * upstream @url is appended as the final fallback. Callers should try
+ * each URI in turn and fail over to the next on any download error.
+ *
+ * Returns: (transfer container) (element-type SoupURI): URIs to try in order
+ *
+ * Since: 0.9.5
+ **/
+GPtrArray *
+fwupd_remote_build_firmware_uris (FwupdRemote *self,
+				  const gchar *url,
+				  GError **error)
+{
+	SoupURI *uri;
+	g_autoptr(GPtrArray) uris = NULL;
+
+	g_return_val_if_fail (FWUPD_IS_REMOTE (self), NULL);
+	g_return_val_if_fail (url != NULL, NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	uris = g_ptr_array_new_with_free_func ((GDestroyNotify) soup_uri_free);
+	if (self->firmware_base_uris != NULL) {
+		g_autofree gchar *basename = g_path_get_basename (url);
+		for (guint i = 0; self->firmware_base_uris[i] != NULL; i++) {
+			SoupURI *uri_tmp;
+			g_autofree gchar *url_mirror = NULL;
+			url_mirror = g_build_path ("/",
+						   self->firmware_base_uris[i],
+						   basename, NULL);
+			uri_tmp = fwupd_remote_build_uri (self, url_mirror, error);
+			if (uri_tmp == NULL)
+				return NULL;
+			g_ptr_array_add (uris, uri_tmp);
+		}
+	}
+
+	/* the URI the metadata actually named always goes last */
+	uri = fwupd_remote_build_uri (self, url, error);
+	if (uri == NULL)
+		return NULL;
+	g_ptr_array_add (uris, uri);
+	return g_steal_pointer (&uris);
+}
+
+/**
+ * fwupd_remote_build_patch_uri:
+ * @self: A #FwupdRemote
+ * @checksum: the SHA256 checksum of the current local metadata
+ * @error: the #GError, or %NULL
+ *
+ * Builds the URI of the server-generated patch that upgrades metadata
+ * with @checksum to the current version, e.g.
+ * `firmware.xml.gz.0123abcd….diff`. The server is not required to
+ * generate patches, so downloading this URI may well fail.
+ *
+ * Returns: (transfer full): a #SoupURI, or %NULL for error
+ *
+ * Since: 0.9.5
+ **/
+SoupURI *
+fwupd_remote_build_patch_uri (FwupdRemote *self,
+			      const gchar *checksum,
+			      GError **error)
+{
+	g_autofree gchar *url = NULL;
+	g_autofree gchar *url_metadata = NULL;
+
+	g_return_val_if_fail (FWUPD_IS_REMOTE (self), NULL);
+	g_return_val_if_fail (checksum != NULL, NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	if (self->uri == NULL) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INTERNAL,
+				     "no metadata URI set for remote");
+		return NULL;
+	}
+	url_metadata = soup_uri_to_string (self->uri, FALSE);
+	url = g_strdup_printf ("%s.%s.diff", url_metadata, checksum);
+	return fwupd_remote_build_uri (self, url, error);
+}
+
 /**
  * fwupd_remote_get_uri:
  * @self: A #FwupdRemote
@@ -232,6 +338,96 @@ fwupd_remote_get_enabled (FwupdRemote *self)
 	return self->enabled;
 }
 
+/**
+ * fwupd_remote_get_etag:
+ * @self: A #FwupdRemote
+ *
+ * Gets the ETag validator returned with the last metadata download,
+ * as stored in the remote config file.
+ *
+ * Returns: a string, or %NULL if unset
+ *
+ * Since: 0.9.5
+ **/
+const gchar *
+fwupd_remote_get_etag (FwupdRemote *self)
+{
+	g_return_val_if_fail (FWUPD_IS_REMOTE (self), NULL);
+	return self->etag;
+}
+
+/**
+ * fwupd_remote_get_last_modified:
+ * @self: A #FwupdRemote
+ *
+ * Gets the Last-Modified validator returned with the last metadata
+ * download, as stored in the remote config file.
+ *
+ * Returns: a string, or %NULL if unset
+ *
+ * Since: 0.9.5
+ **/
+const gchar *
+fwupd_remote_get_last_modified (FwupdRemote *self)
+{
+	g_return_val_if_fail (FWUPD_IS_REMOTE (self), NULL);
+	return self->last_modified;
+}
+
+/**
+ * fwupd_remote_set_validators:
+ * @self: A #FwupdRemote
+ * @etag: the ETag header value, or %NULL to clear
+ * @last_modified: the Last-Modified header value, or %NULL to clear
+ * @error: the #GError, or %NULL
+ *
+ * Saves the HTTP validators returned with the last metadata download back
+ * into the remote config file, so the next refresh can make a conditional
+ * request rather than transferring the whole file again. This requires
+ * write access to the config file the remote was loaded from.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 0.9.5
+ **/
+gboolean
+fwupd_remote_set_validators (FwupdRemote *self,
+			     const gchar *etag,
+			     const gchar *last_modified,
+			     GError **error)
+{
+	const gchar *group = "fwupd Remote";
+	g_autoptr(GKeyFile) kf = NULL;
+
+	g_return_val_if_fail (FWUPD_IS_REMOTE (self), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* update the in-memory copy */
+	g_free (self->etag);
+	self->etag = g_strdup (etag);
+	g_free (self->last_modified);
+	self->last_modified = g_strdup (last_modified);
+
+	/* not loaded from a file */
+	if (self->remotes_filename == NULL)
+		return TRUE;
+
+	/* save back to the config file */
+	kf = g_key_file_new ();
+	if (!g_key_file_load_from_file (kf, self->remotes_filename,
+					G_KEY_FILE_KEEP_COMMENTS, error))
+		return FALSE;
+	if (etag != NULL)
+		g_key_file_set_string (kf, group, "ETag", etag);
+	else
+		g_key_file_remove_key (kf, group, "ETag", NULL);
+	if (last_modified != NULL)
+		g_key_file_set_string (kf, group, "LastModified", last_modified);
+	else
+		g_key_file_remove_key (kf, group, "LastModified", NULL);
+	return g_key_file_save_to_file (kf, self->remotes_filename, error);
+}
+
 /**
  * fwupd_remote_get_id:
  * @self: A #FwupdRemote
@@ -332,6 +528,10 @@ fwupd_remote_finalize (GObject *obj)
 	g_free (self->id);
 	g_free (self->filename);
 	g_free (self->filename_asc);
+	g_free (self->remotes_filename);
+	g_free (self->etag);
+	g_free (self->last_modified);
+	g_strfreev (self->firmware_base_uris);
 	if (self->uri != NULL)
 		soup_uri_free (self->uri);
 	if (self->uri_asc != NULL)
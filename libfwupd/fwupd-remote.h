@@ -34,11 +34,23 @@ const gchar	*fwupd_remote_get_id			(FwupdRemote	*self);
 const gchar	*fwupd_remote_get_filename		(FwupdRemote	*self);
 const gchar	*fwupd_remote_get_filename_asc		(FwupdRemote	*self);
 gboolean	 fwupd_remote_get_enabled		(FwupdRemote	*self);
+const gchar	*fwupd_remote_get_etag			(FwupdRemote	*self);
+const gchar	*fwupd_remote_get_last_modified		(FwupdRemote	*self);
+gboolean	 fwupd_remote_set_validators		(FwupdRemote	*self,
+							 const gchar	*etag,
+							 const gchar	*last_modified,
+							 GError		**error);
 SoupURI		*fwupd_remote_get_uri			(FwupdRemote	*self);
 SoupURI		*fwupd_remote_get_uri_asc		(FwupdRemote	*self);
 SoupURI		*fwupd_remote_build_uri			(FwupdRemote	*self,
 							 const gchar	*url,
 							 GError		**error);
+SoupURI		*fwupd_remote_build_patch_uri		(FwupdRemote	*self,
+							 const gchar	*checksum,
+							 GError		**error);
+GPtrArray	*fwupd_remote_build_firmware_uris	(FwupdRemote	*self,
+							 const gchar	*url,
+							 GError		**error);
 
 G_END_DECLS
 
@@ -33,6 +33,9 @@
 #include "fwupd-result.h"
 
 static void fwupd_result_finalize	 (GObject *object);
+static void fwupd_result_from_key_value	 (FwupdResult *result,
+					  const gchar *key,
+					  GVariant *value);
 
 typedef struct {
 	gchar				*unique_id;
@@ -41,6 +44,11 @@ typedef struct {
 	gchar				*update_error;
 	FwupdDevice			*device;
 	FwupdRelease			*release;
+	GVariant			*data;		/* serialized form */
+	GVariant			*kvs;		/* the a{sv} child of data */
+	gboolean			 keys_unpacked;
+	gboolean			 objects_unpacked;
+	gboolean			 modified;
 } FwupdResultPrivate;
 
 enum {
@@ -57,6 +65,55 @@ enum {
 G_DEFINE_TYPE_WITH_PRIVATE (FwupdResult, fwupd_result, G_TYPE_OBJECT)
 #define GET_PRIVATE(o) (fwupd_result_get_instance_private (o))
 
+/* materialize only the result-level keys; this is cheap, and enough for
+ * clients that poll GetDevices and look at nothing but the device ID and
+ * the update state */
+static void
+fwupd_result_ensure_keys (FwupdResult *result)
+{
+	FwupdResultPrivate *priv = GET_PRIVATE (result);
+	GVariantIter iter;
+	GVariant *value;
+	const gchar *key;
+	gboolean modified_tmp = priv->modified;
+
+	if (priv->kvs == NULL || priv->keys_unpacked)
+		return;
+	priv->keys_unpacked = TRUE;
+	g_variant_iter_init (&iter, priv->kvs);
+	while (g_variant_iter_next (&iter, "{&sv}", &key, &value)) {
+		fwupd_result_from_key_value (result, key, value);
+		g_variant_unref (value);
+	}
+
+	/* unpacking does not count as a modification */
+	priv->modified = modified_tmp;
+}
+
+/* materialize the device and release objects from the serialized form */
+static void
+fwupd_result_ensure_objects (FwupdResult *result)
+{
+	FwupdResultPrivate *priv = GET_PRIVATE (result);
+	GVariantIter iter;
+	GVariant *value;
+	const gchar *key;
+	gboolean modified_tmp = priv->modified;
+
+	if (priv->kvs == NULL || priv->objects_unpacked)
+		return;
+	priv->objects_unpacked = TRUE;
+	g_variant_iter_init (&iter, priv->kvs);
+	while (g_variant_iter_next (&iter, "{&sv}", &key, &value)) {
+		fwupd_release_from_key_value (priv->release, key, value);
+		fwupd_device_from_key_value (priv->device, key, value);
+		g_variant_unref (value);
+	}
+
+	/* unpacking does not count as a modification */
+	priv->modified = modified_tmp;
+}
+
 /**
  * fwupd_result_get_unique_id:
  * @result: A #FwupdResult
@@ -72,6 +129,7 @@ fwupd_result_get_unique_id (FwupdResult *result)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), NULL);
+	fwupd_result_ensure_keys (result);
 	return priv->unique_id;
 }
 
@@ -89,6 +147,12 @@ fwupd_result_set_unique_id (FwupdResult *result, const gchar *unique_id)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_if_fail (FWUPD_IS_RESULT (result));
+	fwupd_result_ensure_keys (result);
+
+	/* not changed */
+	if (g_strcmp0 (priv->unique_id, unique_id) == 0)
+		return;
+	priv->modified = TRUE;
 	g_free (priv->unique_id);
 	priv->unique_id = g_strdup (unique_id);
 }
@@ -108,6 +172,7 @@ fwupd_result_get_release (FwupdResult *result)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), NULL);
+	fwupd_result_ensure_objects (result);
 	return priv->release;
 }
 
@@ -126,6 +191,7 @@ fwupd_result_get_device (FwupdResult *result)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), NULL);
+	fwupd_result_ensure_objects (result);
 	return priv->device;
 }
 
@@ -144,6 +210,18 @@ fwupd_result_get_device_id (FwupdResult *result)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), NULL);
+
+	/* read the ID straight out of the serialized form rather than
+	 * materializing the whole device just for one key */
+	if (priv->kvs != NULL && !priv->objects_unpacked) {
+		const gchar *id = fwupd_device_get_id (priv->device);
+		if (id != NULL)
+			return id;
+		if (g_variant_lookup (priv->kvs, FWUPD_RESULT_KEY_DEVICE_ID,
+				      "&s", &id))
+			return id;
+	}
+	fwupd_result_ensure_objects (result);
 	return fwupd_device_get_id (priv->device);
 }
 
@@ -161,6 +239,8 @@ fwupd_result_set_device_id (FwupdResult *result, const gchar *device_id)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_if_fail (FWUPD_IS_RESULT (result));
+	fwupd_result_ensure_objects (result);
+	priv->modified = TRUE;
 	fwupd_device_set_id (priv->device, device_id);
 }
 
@@ -179,6 +259,7 @@ fwupd_result_get_guids (FwupdResult *result)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), NULL);
+	fwupd_result_ensure_objects (result);
 	return fwupd_device_get_guids (priv->device);
 }
 
@@ -198,6 +279,7 @@ fwupd_result_has_guid (FwupdResult *result, const gchar *guid)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), FALSE);
+	fwupd_result_ensure_objects (result);
 	return fwupd_device_has_guid (priv->device, guid);
 }
 
@@ -215,6 +297,8 @@ fwupd_result_add_guid (FwupdResult *result, const gchar *guid)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_if_fail (FWUPD_IS_RESULT (result));
+	fwupd_result_ensure_objects (result);
+	priv->modified = TRUE;
 	fwupd_device_add_guid (priv->device, guid);
 }
 
@@ -233,6 +317,7 @@ fwupd_result_get_guid_default (FwupdResult *result)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), NULL);
+	fwupd_result_ensure_objects (result);
 	return fwupd_device_get_guid_default (priv->device);
 }
 
@@ -253,6 +338,7 @@ fwupd_result_get_guid (FwupdResult *result)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), NULL);
+	fwupd_result_ensure_objects (result);
 	return fwupd_device_get_guid_default (priv->device);
 }
 
@@ -271,6 +357,8 @@ void
 fwupd_result_set_guid (FwupdResult *result, const gchar *guid)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
+	fwupd_result_ensure_objects (result);
+	priv->modified = TRUE;
 	fwupd_device_add_guid (priv->device, guid);
 }
 
@@ -289,6 +377,7 @@ fwupd_result_get_device_name (FwupdResult *result)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), NULL);
+	fwupd_result_ensure_objects (result);
 	return fwupd_device_get_name (priv->device);
 }
 
@@ -306,6 +395,8 @@ fwupd_result_set_device_name (FwupdResult *result, const gchar *device_name)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_if_fail (FWUPD_IS_RESULT (result));
+	fwupd_result_ensure_objects (result);
+	priv->modified = TRUE;
 	fwupd_device_set_name (priv->device, device_name);
 }
 
@@ -324,6 +415,7 @@ fwupd_result_get_device_vendor (FwupdResult *result)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), NULL);
+	fwupd_result_ensure_objects (result);
 	return fwupd_device_get_vendor (priv->device);
 }
 
@@ -341,6 +433,8 @@ fwupd_result_set_device_vendor (FwupdResult *result, const gchar *device_vendor)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_if_fail (FWUPD_IS_RESULT (result));
+	fwupd_result_ensure_objects (result);
+	priv->modified = TRUE;
 	fwupd_device_set_vendor (priv->device, device_vendor);
 }
 
@@ -359,6 +453,7 @@ fwupd_result_get_device_description (FwupdResult *result)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), NULL);
+	fwupd_result_ensure_objects (result);
 	return fwupd_device_get_description (priv->device);
 }
 
@@ -376,6 +471,8 @@ fwupd_result_set_device_description (FwupdResult *result, const gchar *device_de
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_if_fail (FWUPD_IS_RESULT (result));
+	fwupd_result_ensure_objects (result);
+	priv->modified = TRUE;
 	fwupd_device_set_description (priv->device, device_description);
 }
 
@@ -394,6 +491,7 @@ fwupd_result_get_device_version (FwupdResult *result)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), NULL);
+	fwupd_result_ensure_objects (result);
 	return fwupd_device_get_version (priv->device);
 }
 
@@ -411,6 +509,8 @@ fwupd_result_set_device_version (FwupdResult *result, const gchar *device_versio
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_if_fail (FWUPD_IS_RESULT (result));
+	fwupd_result_ensure_objects (result);
+	priv->modified = TRUE;
 	fwupd_device_set_version (priv->device, device_version);
 }
 
@@ -429,6 +529,7 @@ fwupd_result_get_update_version (FwupdResult *result)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), NULL);
+	fwupd_result_ensure_objects (result);
 	return fwupd_release_get_version (priv->release);
 }
 
@@ -447,6 +548,7 @@ fwupd_result_get_device_version_lowest (FwupdResult *result)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), NULL);
+	fwupd_result_ensure_objects (result);
 	return fwupd_device_get_version_lowest (priv->device);
 }
 
@@ -464,6 +566,8 @@ fwupd_result_set_device_version_lowest (FwupdResult *result, const gchar *device
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_if_fail (FWUPD_IS_RESULT (result));
+	fwupd_result_ensure_objects (result);
+	priv->modified = TRUE;
 	fwupd_device_set_version_lowest (priv->device, device_version_lowest);
 }
 
@@ -482,6 +586,7 @@ fwupd_result_get_device_version_bootloader (FwupdResult *result)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), NULL);
+	fwupd_result_ensure_objects (result);
 	return fwupd_device_get_version_bootloader (priv->device);
 }
 
@@ -500,6 +605,8 @@ fwupd_result_set_device_version_bootloader (FwupdResult *result,
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_if_fail (FWUPD_IS_RESULT (result));
+	fwupd_result_ensure_objects (result);
+	priv->modified = TRUE;
 	fwupd_device_set_version_bootloader (priv->device, device_version_bootloader);
 }
 
@@ -518,6 +625,7 @@ fwupd_result_get_device_flashes_left (FwupdResult *result)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), 0);
+	fwupd_result_ensure_objects (result);
 	return fwupd_device_get_flashes_left (priv->device);
 }
 
@@ -535,6 +643,8 @@ fwupd_result_set_device_flashes_left (FwupdResult *result, guint32 flashes_left)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_if_fail (FWUPD_IS_RESULT (result));
+	fwupd_result_ensure_objects (result);
+	priv->modified = TRUE;
 	fwupd_device_set_flashes_left (priv->device, flashes_left);
 }
 
@@ -552,6 +662,8 @@ fwupd_result_set_update_version (FwupdResult *result, const gchar *update_versio
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_if_fail (FWUPD_IS_RESULT (result));
+	fwupd_result_ensure_objects (result);
+	priv->modified = TRUE;
 	fwupd_release_set_version (priv->release, update_version);
 }
 
@@ -570,6 +682,7 @@ fwupd_result_get_update_filename (FwupdResult *result)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), NULL);
+	fwupd_result_ensure_objects (result);
 	return fwupd_release_get_filename (priv->release);
 }
 
@@ -587,6 +700,8 @@ fwupd_result_set_update_filename (FwupdResult *result, const gchar *update_filen
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_if_fail (FWUPD_IS_RESULT (result));
+	fwupd_result_ensure_objects (result);
+	priv->modified = TRUE;
 	fwupd_release_set_filename (priv->release, update_filename);
 }
 
@@ -605,6 +720,7 @@ fwupd_result_get_update_state (FwupdResult *result)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), FWUPD_UPDATE_STATE_UNKNOWN);
+	fwupd_result_ensure_keys (result);
 	return priv->update_state;
 }
 
@@ -622,6 +738,8 @@ fwupd_result_set_update_state (FwupdResult *result, FwupdUpdateState update_stat
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_if_fail (FWUPD_IS_RESULT (result));
+	fwupd_result_ensure_keys (result);
+	priv->modified = TRUE;
 	priv->update_state = update_state;
 }
 
@@ -641,6 +759,7 @@ fwupd_result_get_update_checksum (FwupdResult *result)
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	GPtrArray *checksums;
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), NULL);
+	fwupd_result_ensure_objects (result);
 	checksums = fwupd_release_get_checksums (priv->release);
 	for (guint i = 0; i < checksums->len; i++) {
 		const gchar *checksum = g_ptr_array_index (checksums, i);
@@ -664,6 +783,8 @@ fwupd_result_set_update_checksum (FwupdResult *result, const gchar *update_check
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_if_fail (FWUPD_IS_RESULT (result));
+	fwupd_result_ensure_objects (result);
+	priv->modified = TRUE;
 	fwupd_release_add_checksum (priv->release, update_checksum);
 }
 
@@ -712,6 +833,7 @@ fwupd_result_get_update_uri (FwupdResult *result)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), NULL);
+	fwupd_result_ensure_objects (result);
 	return fwupd_release_get_uri (priv->release);
 }
 
@@ -729,6 +851,8 @@ fwupd_result_set_update_uri (FwupdResult *result, const gchar *update_uri)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_if_fail (FWUPD_IS_RESULT (result));
+	fwupd_result_ensure_objects (result);
+	priv->modified = TRUE;
 	fwupd_release_set_uri (priv->release, update_uri);
 }
 
@@ -747,6 +871,7 @@ fwupd_result_get_update_homepage (FwupdResult *result)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), NULL);
+	fwupd_result_ensure_objects (result);
 	return fwupd_release_get_homepage (priv->release);
 }
 
@@ -764,6 +889,8 @@ fwupd_result_set_update_homepage (FwupdResult *result, const gchar *update_homep
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_if_fail (FWUPD_IS_RESULT (result));
+	fwupd_result_ensure_objects (result);
+	priv->modified = TRUE;
 	fwupd_release_set_homepage (priv->release, update_homepage);
 }
 
@@ -782,6 +909,7 @@ fwupd_result_get_update_description (FwupdResult *result)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), NULL);
+	fwupd_result_ensure_objects (result);
 	return fwupd_release_get_description (priv->release);
 }
 
@@ -799,6 +927,8 @@ fwupd_result_set_update_description (FwupdResult *result, const gchar *update_de
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_if_fail (FWUPD_IS_RESULT (result));
+	fwupd_result_ensure_objects (result);
+	priv->modified = TRUE;
 	fwupd_release_set_description (priv->release, update_description);
 }
 
@@ -817,6 +947,7 @@ fwupd_result_get_update_id (FwupdResult *result)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), NULL);
+	fwupd_result_ensure_objects (result);
 	return fwupd_release_get_appstream_id (priv->release);
 }
 
@@ -834,6 +965,8 @@ fwupd_result_set_update_id (FwupdResult *result, const gchar *update_id)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_if_fail (FWUPD_IS_RESULT (result));
+	fwupd_result_ensure_objects (result);
+	priv->modified = TRUE;
 	fwupd_release_set_appstream_id (priv->release, update_id);
 }
 
@@ -852,6 +985,7 @@ fwupd_result_get_update_size (FwupdResult *result)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), 0);
+	fwupd_result_ensure_objects (result);
 	return fwupd_release_get_size (priv->release);
 }
 
@@ -869,6 +1003,8 @@ fwupd_result_set_update_size (FwupdResult *result, guint64 update_size)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_if_fail (FWUPD_IS_RESULT (result));
+	fwupd_result_ensure_objects (result);
+	priv->modified = TRUE;
 	fwupd_release_set_size (priv->release, update_size);
 }
 
@@ -888,6 +1024,7 @@ fwupd_result_get_device_checksum (FwupdResult *result)
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	GPtrArray *checksums;
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), NULL);
+	fwupd_result_ensure_objects (result);
 	checksums = fwupd_device_get_checksums (priv->device);
 	for (guint i = 0; i < checksums->len; i++) {
 		const gchar *checksum = g_ptr_array_index (checksums, i);
@@ -911,6 +1048,8 @@ fwupd_result_set_device_checksum (FwupdResult *result, const gchar *device_check
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_if_fail (FWUPD_IS_RESULT (result));
+	fwupd_result_ensure_objects (result);
+	priv->modified = TRUE;
 	fwupd_device_add_checksum (priv->device, device_checksum);
 }
 
@@ -959,6 +1098,7 @@ fwupd_result_get_update_summary (FwupdResult *result)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), NULL);
+	fwupd_result_ensure_objects (result);
 	return fwupd_release_get_summary (priv->release);
 }
 
@@ -976,6 +1116,8 @@ fwupd_result_set_update_summary (FwupdResult *result, const gchar *update_summar
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_if_fail (FWUPD_IS_RESULT (result));
+	fwupd_result_ensure_objects (result);
+	priv->modified = TRUE;
 	fwupd_release_set_summary (priv->release, update_summary);
 }
 
@@ -994,6 +1136,7 @@ fwupd_result_get_device_provider (FwupdResult *result)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), NULL);
+	fwupd_result_ensure_objects (result);
 	return fwupd_device_get_provider (priv->device);
 }
 
@@ -1011,6 +1154,8 @@ fwupd_result_set_device_provider (FwupdResult *result, const gchar *device_provi
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_if_fail (FWUPD_IS_RESULT (result));
+	fwupd_result_ensure_objects (result);
+	priv->modified = TRUE;
 	fwupd_device_set_provider (priv->device, device_provider);
 }
 
@@ -1029,6 +1174,7 @@ fwupd_result_get_update_error (FwupdResult *result)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), NULL);
+	fwupd_result_ensure_keys (result);
 	return priv->update_error;
 }
 
@@ -1046,6 +1192,12 @@ fwupd_result_set_update_error (FwupdResult *result, const gchar *update_error)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_if_fail (FWUPD_IS_RESULT (result));
+	fwupd_result_ensure_keys (result);
+
+	/* not changed */
+	if (g_strcmp0 (priv->update_error, update_error) == 0)
+		return;
+	priv->modified = TRUE;
 	g_free (priv->update_error);
 	priv->update_error = g_strdup (update_error);
 }
@@ -1065,6 +1217,7 @@ fwupd_result_get_update_trust_flags (FwupdResult *result)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), 0);
+	fwupd_result_ensure_keys (result);
 	return priv->update_trust_flags;
 }
 
@@ -1082,6 +1235,8 @@ fwupd_result_set_update_trust_flags (FwupdResult *result, FwupdTrustFlags trust_
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_if_fail (FWUPD_IS_RESULT (result));
+	fwupd_result_ensure_keys (result);
+	priv->modified = TRUE;
 	priv->update_trust_flags = trust_flags;
 }
 
@@ -1100,6 +1255,7 @@ fwupd_result_get_update_vendor (FwupdResult *result)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), NULL);
+	fwupd_result_ensure_objects (result);
 	return fwupd_release_get_vendor (priv->release);
 }
 
@@ -1117,6 +1273,8 @@ fwupd_result_set_update_vendor (FwupdResult *result, const gchar *update_vendor)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_if_fail (FWUPD_IS_RESULT (result));
+	fwupd_result_ensure_objects (result);
+	priv->modified = TRUE;
 	fwupd_release_set_vendor (priv->release, update_vendor);
 }
 
@@ -1135,6 +1293,7 @@ fwupd_result_get_update_license (FwupdResult *result)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), NULL);
+	fwupd_result_ensure_objects (result);
 	return fwupd_release_get_license (priv->release);
 }
 
@@ -1152,6 +1311,8 @@ fwupd_result_set_update_license (FwupdResult *result, const gchar *update_licens
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_if_fail (FWUPD_IS_RESULT (result));
+	fwupd_result_ensure_objects (result);
+	priv->modified = TRUE;
 	fwupd_release_set_license (priv->release, update_license);
 }
 
@@ -1170,6 +1331,7 @@ fwupd_result_get_update_name (FwupdResult *result)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), NULL);
+	fwupd_result_ensure_objects (result);
 	return fwupd_release_get_name (priv->release);
 }
 
@@ -1187,6 +1349,8 @@ fwupd_result_set_update_name (FwupdResult *result, const gchar *update_name)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_if_fail (FWUPD_IS_RESULT (result));
+	fwupd_result_ensure_objects (result);
+	priv->modified = TRUE;
 	fwupd_release_set_name (priv->release, update_name);
 }
 
@@ -1205,6 +1369,7 @@ fwupd_result_get_device_flags (FwupdResult *result)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), 0);
+	fwupd_result_ensure_objects (result);
 	return fwupd_device_get_flags (priv->device);
 }
 
@@ -1222,6 +1387,8 @@ fwupd_result_set_device_flags (FwupdResult *result, guint64 device_flags)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_if_fail (FWUPD_IS_RESULT (result));
+	fwupd_result_ensure_objects (result);
+	priv->modified = TRUE;
 	fwupd_device_set_flags (priv->device, device_flags);
 }
 
@@ -1239,6 +1406,8 @@ fwupd_result_add_device_flag (FwupdResult *result, FwupdDeviceFlags flag)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_if_fail (FWUPD_IS_RESULT (result));
+	fwupd_result_ensure_objects (result);
+	priv->modified = TRUE;
 	fwupd_device_add_flag (priv->device, flag);
 }
 
@@ -1256,6 +1425,8 @@ fwupd_result_remove_device_flag (FwupdResult *result, FwupdDeviceFlags flag)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_if_fail (FWUPD_IS_RESULT (result));
+	fwupd_result_ensure_objects (result);
+	priv->modified = TRUE;
 	fwupd_device_remove_flag (priv->device, flag);
 }
 
@@ -1275,6 +1446,7 @@ fwupd_result_has_device_flag (FwupdResult *result, FwupdDeviceFlags flag)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), FALSE);
+	fwupd_result_ensure_objects (result);
 	return fwupd_device_has_flag (priv->device, flag);
 }
 
@@ -1293,6 +1465,7 @@ fwupd_result_get_device_created (FwupdResult *result)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), 0);
+	fwupd_result_ensure_objects (result);
 	return fwupd_device_get_created (priv->device);
 }
 
@@ -1311,6 +1484,8 @@ fwupd_result_set_device_created (FwupdResult *result, guint64 device_created)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_if_fail (FWUPD_IS_RESULT (result));
+	fwupd_result_ensure_objects (result);
+	priv->modified = TRUE;
 	fwupd_device_set_created (priv->device, device_created);
 }
 
@@ -1329,6 +1504,7 @@ fwupd_result_get_device_modified (FwupdResult *result)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), 0);
+	fwupd_result_ensure_objects (result);
 	return fwupd_device_get_modified (priv->device);
 }
 
@@ -1346,6 +1522,8 @@ fwupd_result_set_device_modified (FwupdResult *result, guint64 device_modified)
 {
 	FwupdResultPrivate *priv = GET_PRIVATE (result);
 	g_return_if_fail (FWUPD_IS_RESULT (result));
+	fwupd_result_ensure_objects (result);
+	priv->modified = TRUE;
 	fwupd_device_set_modified (priv->device, device_modified);
 }
 
@@ -1354,7 +1532,9 @@ fwupd_result_set_device_modified (FwupdResult *result, guint64 device_modified)
  * @result: A #FwupdResult
  * @type_string: The Gvariant type string, e.g. "{sa{sv}}" or "(a{sv})"
  *
- * Creates a GVariant from the result data.
+ * Creates a GVariant from the result data. If the result was created using
+ * fwupd_result_new_from_data() and nothing has been modified then the
+ * original variant is returned untouched.
  *
  * Returns: the GVariant, or %NULL for error
  *
@@ -1369,7 +1549,15 @@ fwupd_result_to_data (FwupdResult *result, const gchar *type_string)
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), NULL);
 	g_return_val_if_fail (type_string != NULL, NULL);
 
-	/* create an array with all the metadata in */
+	/* fast path: nothing was modified since deserialization, so the
+	 * variant we were created from is still authoritative */
+	if (priv->data != NULL && !priv->modified &&
+	    g_strcmp0 (g_variant_get_type_string (priv->data), type_string) == 0)
+		return g_variant_ref (priv->data);
+
+	/* unpack everything, then create an array with all the metadata in */
+	fwupd_result_ensure_keys (result);
+	fwupd_result_ensure_objects (result);
 	g_variant_builder_init (&builder, G_VARIANT_TYPE_ARRAY);
 	if (priv->unique_id != NULL) {
 		g_variant_builder_add (&builder, "{sv}",
@@ -1455,22 +1643,8 @@ fwupd_pad_kv_ups (GString *str, const gchar *key, FwupdUpdateState value)
 static void
 fwupd_pad_kv_tfl (GString *str, const gchar *key, FwupdTrustFlags trust_flags)
 {
-	guint i;
-	g_autoptr(GString) tmp = NULL;
-
-	tmp = g_string_new ("");
-	for (i = 1; i < FWUPD_TRUST_FLAG_LAST; i *= 2) {
-		if ((trust_flags & i) == 0)
-			continue;
-		g_string_append_printf (tmp, "%s|",
-					fwupd_trust_flag_to_string (i));
-	}
-	if (tmp->len == 0) {
-		g_string_append (tmp, fwupd_trust_flag_to_string (0));
-	} else {
-		g_string_truncate (tmp, tmp->len - 1);
-	}
-	fwupd_pad_kv_str (str, key, tmp->str);
+	fwupd_pad_kv_str (str, key,
+			  fwupd_trust_flags_to_string_cached (trust_flags));
 }
 
 /**
@@ -1492,6 +1666,8 @@ fwupd_result_to_string (FwupdResult *result)
 	g_autofree gchar *release_str = NULL;
 
 	g_return_val_if_fail (FWUPD_IS_RESULT (result), NULL);
+	fwupd_result_ensure_keys (result);
+	fwupd_result_ensure_objects (result);
 
 	str = g_string_new ("");
 
@@ -1525,9 +1701,11 @@ fwupd_result_get_property (GObject *object, guint prop_id,
 
 	switch (prop_id) {
 	case PROP_DEVICE_ID:
+		fwupd_result_ensure_objects (result);
 		g_value_set_string (value, fwupd_device_get_id (priv->device));
 		break;
 	case PROP_UNIQUE_ID:
+		fwupd_result_ensure_keys (result);
 		g_value_set_string (value, priv->unique_id);
 		break;
 	default:
@@ -1545,9 +1723,13 @@ fwupd_result_set_property (GObject *object, guint prop_id,
 
 	switch (prop_id) {
 	case PROP_DEVICE_ID:
+		fwupd_result_ensure_objects (result);
+		priv->modified = TRUE;
 		fwupd_device_set_id (priv->device, g_value_get_string (value));
 		break;
 	case PROP_UNIQUE_ID:
+		fwupd_result_ensure_keys (result);
+		priv->modified = TRUE;
 		g_free (priv->unique_id);
 		priv->unique_id = g_strdup (g_value_get_string (value));
 		break;
@@ -1597,29 +1779,21 @@ fwupd_result_finalize (GObject *object)
 	g_object_unref (priv->release);
 	g_free (priv->unique_id);
 	g_free (priv->update_error);
+	if (priv->data != NULL)
+		g_variant_unref (priv->data);
+	if (priv->kvs != NULL)
+		g_variant_unref (priv->kvs);
 
 	G_OBJECT_CLASS (fwupd_result_parent_class)->finalize (object);
 }
 
-static void
-fwupd_result_from_variant_iter (FwupdResult *result, GVariantIter *iter)
-{
-	FwupdResultPrivate *priv = GET_PRIVATE (result);
-	GVariant *value;
-	const gchar *key;
-	while (g_variant_iter_next (iter, "{&sv}", &key, &value)) {
-		fwupd_result_from_key_value (result, key, value);
-		fwupd_release_from_key_value (priv->release, key, value);
-		fwupd_device_from_key_value (priv->device, key, value);
-		g_variant_unref (value);
-	}
-}
-
 /**
  * fwupd_result_new_from_data:
  * @data: a #GVariant
  *
- * Creates a new result using packed data.
+ * Creates a new result using packed data. The keys are not unpacked until
+ * something needs them, so creating a result and only looking at the device
+ * ID does not allocate any per-key strings.
  *
  * Returns: a new #FwupdResult, or %NULL if @data was invalid
  *
@@ -1629,21 +1803,25 @@ FwupdResult *
 fwupd_result_new_from_data (GVariant *data)
 {
 	FwupdResult *res = NULL;
-	const gchar *id;
+	FwupdResultPrivate *priv;
 	const gchar *type_string;
-	g_autoptr(GVariantIter) iter = NULL;
 
 	/* format from GetDetails */
 	type_string = g_variant_get_type_string (data);
 	if (g_strcmp0 (type_string, "(a{sv})") == 0) {
 		res = fwupd_result_new ();
-		g_variant_get (data, "(a{sv})", &iter);
-		fwupd_result_from_variant_iter (res, iter);
+		priv = GET_PRIVATE (res);
+		priv->data = g_variant_ref_sink (data);
+		priv->kvs = g_variant_get_child_value (data, 0);
 	} else if (g_strcmp0 (type_string, "{sa{sv}}") == 0) {
+		g_autoptr(GVariant) id = NULL;
 		res = fwupd_result_new ();
-		g_variant_get (data, "{&sa{sv}}", &id, &iter);
-		fwupd_device_set_id (fwupd_result_get_device (res), id);
-		fwupd_result_from_variant_iter (res, iter);
+		priv = GET_PRIVATE (res);
+		priv->data = g_variant_ref_sink (data);
+		id = g_variant_get_child_value (data, 0);
+		fwupd_device_set_id (priv->device,
+				     g_variant_get_string (id, NULL));
+		priv->kvs = g_variant_get_child_value (data, 1);
 	} else {
 		g_warning ("type %s not known", type_string);
 	}
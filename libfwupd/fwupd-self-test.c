@@ -23,10 +23,17 @@
 
 #include <glib-object.h>
 #include <fnmatch.h>
+#include <string.h>
+#if defined(__GLIBC__) && defined(__MALLOC_HOOK_VOLATILE)
+#include <malloc.h>
+#endif
 
+#include "fwupd-cabinet-private.h"
 #include "fwupd-client.h"
+#include "fwupd-common-private.h"
 #include "fwupd-enums.h"
 #include "fwupd-error.h"
+#include "fwupd-release-private.h"
 #include "fwupd-remote.h"
 #include "fwupd-result.h"
 
@@ -94,6 +101,39 @@ fwupd_enums_func (void)
 	}
 }
 
+static void
+fwupd_version_key_func (void)
+{
+	const guint8 *key;
+	guint8 key1[FWUPD_VERSION_KEY_SZ];
+	guint8 key2[FWUPD_VERSION_KEY_SZ];
+	g_autoptr(FwupdRelease) rel = fwupd_release_new ();
+
+	/* ordering matches the numeric comparison, not the string one */
+	g_assert (fwupd_version_key_from_string ("1.2.4", key1));
+	g_assert (fwupd_version_key_from_string ("1.2.10", key2));
+	g_assert_cmpint (fwupd_version_key_compare (key1, key2), <, 0);
+
+	/* missing segments read as zero */
+	g_assert (fwupd_version_key_from_string ("1.2.0", key1));
+	g_assert (fwupd_version_key_from_string ("1.2", key2));
+	g_assert_cmpint (fwupd_version_key_compare (key1, key2), ==, 0);
+
+	/* not representable */
+	g_assert (!fwupd_version_key_from_string ("1.2.3a", key1));
+	g_assert (!fwupd_version_key_from_string ("", key1));
+	g_assert (!fwupd_version_key_from_string (NULL, key1));
+
+	/* the release packs the key when the version is set */
+	fwupd_release_set_version (rel, "1.2.4");
+	key = fwupd_release_get_version_key (rel);
+	g_assert (key != NULL);
+	g_assert (fwupd_version_key_from_string ("1.2.4", key1));
+	g_assert_cmpint (fwupd_version_key_compare (key, key1), ==, 0);
+	fwupd_release_set_version (rel, "CBET1234");
+	g_assert (fwupd_release_get_version_key (rel) == NULL);
+}
+
 static void
 fwupd_result_func (void)
 {
@@ -136,8 +176,8 @@ fwupd_result_func (void)
 
 	ret = as_test_compare_lines (str,
 		"ColorHug2\n"
-		"  Guid:                 2082b5e0-7a64-478a-b1b2-e3404fab6dad\n"
 		"  Guid:                 00000000-0000-0000-0000-000000000000\n"
+		"  Guid:                 2082b5e0-7a64-478a-b1b2-e3404fab6dad\n"
 		"  DeviceID:             USB:foo\n"
 		"  Flags:                allow-offline|require-ac\n"
 		"  FirmwareHash:         SHA1(beefdead)\n"
@@ -155,6 +195,191 @@ fwupd_result_func (void)
 	g_assert (ret);
 }
 
+static void
+fwupd_cabinet_metainfo_func (void)
+{
+	FwupdDevice *dev;
+	FwupdRelease *rel;
+	g_autoptr(FwupdResult) result = NULL;
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GError) error = NULL;
+	const gchar *xml =
+		"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+		"<component type=\"firmware\">\n"
+		"  <id>com.hughski.ColorHug2.firmware</id>\n"
+		"  <name>ColorHug2</name>\n"
+		"  <name xml:lang=\"fr\">ColorHug Deux</name>\n"
+		"  <summary>Firmware for the ColorHug2</summary>\n"
+		"  <description><p>Updating the firmware improves performance.</p></description>\n"
+		"  <provides>\n"
+		"    <firmware type=\"flashed\">2082b5e0-7a64-478a-b1b2-e3404fab6dad</firmware>\n"
+		"  </provides>\n"
+		"  <url type=\"homepage\">http://www.hughski.com/</url>\n"
+		"  <developer_name>Hughski Limited</developer_name>\n"
+		"  <project_license>GPL-2.0+</project_license>\n"
+		"  <releases>\n"
+		"    <release version=\"2.0.3\" timestamp=\"1424116753\">\n"
+		"      <description><p>This release fixes bugs:</p><ul><li>Fix the KSC</li></ul></description>\n"
+		"    </release>\n"
+		"    <release version=\"2.0.2\" timestamp=\"1422368401\"/>\n"
+		"  </releases>\n"
+		"</component>\n";
+
+	blob = g_bytes_new_static (xml, strlen (xml));
+	result = fwupd_cabinet_parse_metainfo (blob, &error);
+	g_assert_no_error (error);
+	g_assert (result != NULL);
+
+	dev = fwupd_result_get_device (result);
+	g_assert (fwupd_device_has_guid (dev, "2082b5e0-7a64-478a-b1b2-e3404fab6dad"));
+	g_assert_cmpstr (fwupd_device_get_description (dev), ==,
+			 "<p>Updating the firmware improves performance.</p>");
+
+	rel = fwupd_result_get_release (result);
+	g_assert_cmpstr (fwupd_release_get_appstream_id (rel), ==,
+			 "com.hughski.ColorHug2.firmware");
+	g_assert_cmpstr (fwupd_release_get_name (rel), ==, "ColorHug2");
+	g_assert_cmpstr (fwupd_release_get_summary (rel), ==,
+			 "Firmware for the ColorHug2");
+	g_assert_cmpstr (fwupd_release_get_vendor (rel), ==, "Hughski Limited");
+	g_assert_cmpstr (fwupd_release_get_license (rel), ==, "GPL-2.0+");
+	g_assert_cmpstr (fwupd_release_get_homepage (rel), ==,
+			 "http://www.hughski.com/");
+	g_assert_cmpstr (fwupd_release_get_version (rel), ==, "2.0.3");
+	g_assert_cmpstr (fwupd_release_get_description (rel), ==,
+			 "<p>This release fixes bugs:</p><ul><li>Fix the KSC</li></ul>");
+
+	/* no firmware provides means nothing to install */
+	g_clear_pointer (&blob, g_bytes_unref);
+	g_clear_object (&result);
+	xml = "<component type=\"firmware\"><id>com.test</id></component>";
+	blob = g_bytes_new_static (xml, strlen (xml));
+	result = fwupd_cabinet_parse_metainfo (blob, &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL);
+	g_assert (result == NULL);
+}
+
+#if defined(__GLIBC__) && defined(__MALLOC_HOOK_VOLATILE)
+static guint fwupd_bench_n_allocs = 0;
+static void *(*fwupd_bench_old_malloc_hook) (size_t, const void *);
+
+static void *
+fwupd_bench_malloc_hook (size_t size, const void *caller)
+{
+	void *result;
+	__malloc_hook = fwupd_bench_old_malloc_hook;
+	result = malloc (size);
+	fwupd_bench_n_allocs++;
+	__malloc_hook = fwupd_bench_malloc_hook;
+	return result;
+}
+
+static void
+fwupd_bench_alloc_counter_start (void)
+{
+	fwupd_bench_n_allocs = 0;
+	fwupd_bench_old_malloc_hook = __malloc_hook;
+	__malloc_hook = fwupd_bench_malloc_hook;
+}
+
+static guint
+fwupd_bench_alloc_counter_stop (void)
+{
+	__malloc_hook = fwupd_bench_old_malloc_hook;
+	return fwupd_bench_n_allocs;
+}
+#else
+static void
+fwupd_bench_alloc_counter_start (void)
+{
+}
+
+static guint
+fwupd_bench_alloc_counter_stop (void)
+{
+	return 0;
+}
+#endif
+
+static FwupdResult *
+fwupd_bench_result_new (guint guid_cnt, gboolean with_release)
+{
+	FwupdResult *result = fwupd_result_new ();
+	FwupdDevice *dev = fwupd_result_get_device (result);
+
+	fwupd_device_set_id (dev, "USB:foo");
+	fwupd_device_set_name (dev, "ColorHug2");
+	fwupd_device_set_flags (dev, FWUPD_DEVICE_FLAG_ALLOW_OFFLINE);
+	fwupd_device_set_created (dev, 1);
+	fwupd_device_add_checksum (dev, "beefdead");
+	for (guint i = 0; i < guid_cnt; i++) {
+		g_autofree gchar *guid = NULL;
+		guid = g_strdup_printf ("00000000-0000-0000-0000-%012x", i);
+		fwupd_device_add_guid (dev, guid);
+	}
+	if (with_release) {
+		FwupdRelease *rel = fwupd_result_get_release (result);
+		fwupd_release_add_checksum (rel, "deadbeef");
+		fwupd_release_set_description (rel, "<p>Hi there!</p>");
+		fwupd_release_set_filename (rel, "firmware.bin");
+		fwupd_release_set_appstream_id (rel, "org.dave.ColorHug.firmware");
+		fwupd_release_set_size (rel, 1024);
+		fwupd_release_set_uri (rel, "http://foo.com");
+		fwupd_release_set_version (rel, "1.2.3");
+	}
+	return result;
+}
+
+static void
+fwupd_bench_result_roundtrip (FwupdResult *result)
+{
+	g_autoptr(FwupdResult) result2 = NULL;
+	g_autoptr(GVariant) data = NULL;
+	data = g_variant_ref_sink (fwupd_result_to_data (result, "(a{sv})"));
+	result2 = fwupd_result_new_from_data (data);
+}
+
+static void
+fwupd_bench_result_run (FwupdResult *result, guint loops)
+{
+	guint n_allocs;
+
+	/* warm up any one-time allocations, then count a single op */
+	fwupd_bench_result_roundtrip (result);
+	fwupd_bench_alloc_counter_start ();
+	fwupd_bench_result_roundtrip (result);
+	n_allocs = fwupd_bench_alloc_counter_stop ();
+
+	g_test_timer_start ();
+	for (guint i = 0; i < loops; i++)
+		fwupd_bench_result_roundtrip (result);
+	g_test_minimized_result (g_test_timer_elapsed () * 1e9 / loops,
+				 "%.0f ns/op, %u allocs/op",
+				 g_test_timer_last () * 1e9 / loops,
+				 n_allocs);
+}
+
+static void
+fwupd_result_perf_small_func (void)
+{
+	g_autoptr(FwupdResult) result = fwupd_bench_result_new (1, FALSE);
+	fwupd_bench_result_run (result, 500000);
+}
+
+static void
+fwupd_result_perf_typical_func (void)
+{
+	g_autoptr(FwupdResult) result = fwupd_bench_result_new (4, TRUE);
+	fwupd_bench_result_run (result, 200000);
+}
+
+static void
+fwupd_result_perf_many_guids_func (void)
+{
+	g_autoptr(FwupdResult) result = fwupd_bench_result_new (256, TRUE);
+	fwupd_bench_result_run (result, 10000);
+}
+
 static void
 fwupd_client_devices_func (void)
 {
@@ -182,6 +407,57 @@ fwupd_client_devices_func (void)
 	g_assert_cmpstr (fwupd_device_get_id (dev), !=, NULL);
 }
 
+typedef struct {
+	GMainLoop	*loop;
+	GPtrArray	*array;
+	GError		*error;
+} FwupdClientAsyncHelper;
+
+static void
+fwupd_client_devices_async_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	FwupdClientAsyncHelper *helper = (FwupdClientAsyncHelper *) user_data;
+	helper->array = fwupd_client_get_devices_simple_finish (FWUPD_CLIENT (source),
+								res, &helper->error);
+	g_main_loop_quit (helper->loop);
+}
+
+static void
+fwupd_client_devices_async_func (void)
+{
+	FwupdDevice *dev;
+	FwupdClientAsyncHelper helper = { NULL, NULL, NULL };
+	g_autoptr(FwupdClient) client = NULL;
+	g_autoptr(GMainLoop) loop = NULL;
+
+	loop = g_main_loop_new (NULL, FALSE);
+	helper.loop = loop;
+	client = fwupd_client_new ();
+	fwupd_client_get_devices_simple_async (client, NULL,
+					       fwupd_client_devices_async_cb,
+					       &helper);
+	g_main_loop_run (loop);
+	if (helper.array == NULL &&
+	    g_error_matches (helper.error, FWUPD_ERROR, FWUPD_ERROR_NOTHING_TO_DO)) {
+		g_clear_error (&helper.error);
+		return;
+	}
+	if (helper.array == NULL &&
+	    g_error_matches (helper.error, FWUPD_ERROR, FWUPD_ERROR_NOT_SUPPORTED)) {
+		g_clear_error (&helper.error);
+		return;
+	}
+	g_assert_no_error (helper.error);
+	g_assert (helper.array != NULL);
+	g_assert_cmpint (helper.array->len, >, 0);
+
+	/* check device */
+	dev = g_ptr_array_index (helper.array, 0);
+	g_assert (FWUPD_IS_DEVICE (dev));
+	g_assert_cmpstr (fwupd_device_get_id (dev), !=, NULL);
+	g_ptr_array_unref (helper.array);
+}
+
 static void
 fwupd_client_remotes_func (void)
 {
@@ -279,10 +555,21 @@ main (int argc, char **argv)
 
 	/* tests go here */
 	g_test_add_func ("/fwupd/enums", fwupd_enums_func);
+	g_test_add_func ("/fwupd/version-key", fwupd_version_key_func);
 	g_test_add_func ("/fwupd/result", fwupd_result_func);
+	g_test_add_func ("/fwupd/cabinet{metainfo}", fwupd_cabinet_metainfo_func);
+	if (g_test_perf ()) {
+		g_test_add_func ("/fwupd/result{perf-small}",
+				 fwupd_result_perf_small_func);
+		g_test_add_func ("/fwupd/result{perf-typical}",
+				 fwupd_result_perf_typical_func);
+		g_test_add_func ("/fwupd/result{perf-many-guids}",
+				 fwupd_result_perf_many_guids_func);
+	}
 	if (fwupd_has_system_bus ()) {
 		g_test_add_func ("/fwupd/client{remotes}", fwupd_client_remotes_func);
 		g_test_add_func ("/fwupd/client{devices}", fwupd_client_devices_func);
+		g_test_add_func ("/fwupd/client{devices-async}", fwupd_client_devices_async_func);
 		g_test_add_func ("/fwupd/client{updates}", fwupd_client_updates_func);
 	}
 	return g_test_run ();
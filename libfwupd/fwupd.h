@@ -32,6 +32,7 @@
 #include <libfwupd/fwupd-client.h>
 #include <libfwupd/fwupd-common.h>
 #include <libfwupd/fwupd-device.h>
+#include <libfwupd/fwupd-device-cache.h>
 #include <libfwupd/fwupd-enums.h>
 #include <libfwupd/fwupd-error.h>
 #include <libfwupd/fwupd-release.h>
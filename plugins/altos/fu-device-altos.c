@@ -26,6 +26,7 @@
 #include <gudev/gudev.h>
 #include <poll.h>
 #include <string.h>
+#include <sys/uio.h>
 #include <termios.h>
 #include <errno.h>
 
@@ -33,6 +34,10 @@
 
 #include "fu-device-altos.h"
 
+/* issue bulk-in reads of this size rather than a syscall per handful of
+ * protocol bytes; replies are parsed out of the buffer afterwards */
+#define FU_DEVICE_ALTOS_TTY_BUF_SZ	4096
+
 typedef struct
 {
 	FuDeviceAltosKind	 kind;
@@ -45,6 +50,9 @@ typedef struct
 	guint64			 addr_bound;
 	struct termios		 tty_termios;
 	gint			 tty_fd;
+	guint8			 tty_buf[FU_DEVICE_ALTOS_TTY_BUF_SZ];
+	gsize			 tty_buf_head;
+	gsize			 tty_buf_tail;
 } FuDeviceAltosPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (FuDeviceAltos, fu_device_altos, FU_TYPE_DEVICE)
@@ -175,27 +183,29 @@ fu_device_altos_find_tty (FuDeviceAltos *device, GError **error)
 	return FALSE;
 }
 
+/* gather-write several protocol segments with one kernel entry each time
+ * the tty can accept data; the loader consumes them back to back */
 static gboolean
-fu_device_altos_tty_write (FuDeviceAltos *device,
-			   const gchar *data,
-			   gssize data_len,
-			   GError **error)
+fu_device_altos_tty_writev (FuDeviceAltos *device,
+			    struct iovec *iov,
+			    guint iovcnt,
+			    GError **error)
 {
 	FuDeviceAltosPrivate *priv = GET_PRIVATE (device);
 	gint rc;
-	gssize idx = 0;
+	gsize total = 0;
 	guint timeout_ms = 500;
 	struct pollfd fds;
 
-	/* lets assume this is text */
-	if (data_len < 0)
-		data_len = strlen (data);
+	for (guint i = 0; i < iovcnt; i++)
+		total += iov[i].iov_len;
 
 	fds.fd = priv->tty_fd;
 	fds.events = POLLOUT;
 
-	g_debug ("write, with timeout %ums", timeout_ms);
-	while (idx < data_len) {
+	g_debug ("write %" G_GSIZE_FORMAT " bytes, with timeout %ums",
+		 total, timeout_ms);
+	while (total > 0) {
 
 		/* wait for data to be allowed to write without blocking */
 		rc = poll (&fds, 1, (gint) timeout_ms);
@@ -212,9 +222,7 @@ fu_device_altos_tty_write (FuDeviceAltos *device,
 
 		/* we can write data */
 		if (fds.revents & POLLOUT) {
-			gssize len;
-			g_debug ("writing %" G_GSSIZE_FORMAT " bytes: %s", data_len, data);
-			len = write (priv->tty_fd, data + idx, data_len - idx);
+			gssize len = writev (priv->tty_fd, iov, (int) iovcnt);
 			if (len < 0) {
 				if (errno == EAGAIN) {
 					g_debug ("got EAGAIN, trying harder");
@@ -223,21 +231,199 @@ fu_device_altos_tty_write (FuDeviceAltos *device,
 				g_set_error (error,
 					     FWUPD_ERROR,
 					     FWUPD_ERROR_WRITE,
-					     "failed to write %" G_GSSIZE_FORMAT
+					     "failed to write %" G_GSIZE_FORMAT
 					     " bytes to %i: %s" ,
-					     data_len,
+					     total,
 					     priv->tty_fd,
 					     strerror (errno));
 				return FALSE;
 			}
 			g_debug ("wrote %" G_GSSIZE_FORMAT " bytes", len);
-			idx += len;
+			total -= (gsize) len;
+
+			/* skip over anything now completely written */
+			for (guint i = 0; i < iovcnt && len > 0; i++) {
+				gsize seg = MIN ((gsize) len, iov[i].iov_len);
+				iov[i].iov_base = (guint8 *) iov[i].iov_base + seg;
+				iov[i].iov_len -= seg;
+				len -= (gssize) seg;
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+static gboolean
+fu_device_altos_tty_write (FuDeviceAltos *device,
+			   const gchar *data,
+			   gssize data_len,
+			   GError **error)
+{
+	struct iovec iov;
+
+	/* lets assume this is text */
+	if (data_len < 0)
+		data_len = strlen (data);
+	iov.iov_base = (gpointer) data;
+	iov.iov_len = (gsize) data_len;
+	return fu_device_altos_tty_writev (device, &iov, 1, error);
+}
+
+/* top up the reply buffer with one large read, returning the number of
+ * bytes added, 0 on timeout or -1 on failure */
+static gssize
+fu_device_altos_tty_fill (FuDeviceAltos *device,
+			  guint timeout_ms,
+			  GError **error)
+{
+	FuDeviceAltosPrivate *priv = GET_PRIVATE (device);
+	gint rc;
+	struct pollfd fds;
+
+	/* compact so one large contiguous read can be issued */
+	if (priv->tty_buf_head == priv->tty_buf_tail) {
+		priv->tty_buf_head = 0;
+		priv->tty_buf_tail = 0;
+	} else if (priv->tty_buf_head > 0) {
+		memmove (priv->tty_buf,
+			 priv->tty_buf + priv->tty_buf_head,
+			 priv->tty_buf_tail - priv->tty_buf_head);
+		priv->tty_buf_tail -= priv->tty_buf_head;
+		priv->tty_buf_head = 0;
+	}
+
+	fds.fd = priv->tty_fd;
+	fds.events = POLLIN;
+	for (;;) {
+		/* wait for data to appear */
+		rc = poll (&fds, 1, (gint) timeout_ms);
+		if (rc == 0)
+			return 0;
+		if (rc < 0) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_READ,
+				     "failed to poll %i",
+				     priv->tty_fd);
+			return -1;
+		}
+		if (fds.revents & POLLIN) {
+			gssize len = read (priv->tty_fd,
+					   priv->tty_buf + priv->tty_buf_tail,
+					   sizeof (priv->tty_buf) - priv->tty_buf_tail);
+			if (len < 0) {
+				if (errno == EAGAIN) {
+					g_debug ("got EAGAIN, trying harder");
+					continue;
+				}
+				g_set_error (error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_READ,
+					     "failed to read %i: %s",
+					     priv->tty_fd,
+					     strerror (errno));
+				return -1;
+			}
+			g_debug ("read %" G_GSSIZE_FORMAT " bytes from device", len);
+			priv->tty_buf_tail += (gsize) len;
+			return len;
+		}
+		if (fds.revents & POLLERR) {
+			g_set_error_literal (error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_READ,
+					     "error condition");
+			return -1;
+		}
+		if (fds.revents & POLLHUP) {
+			g_set_error_literal (error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_READ,
+					     "connection hung up");
+			return -1;
+		}
+		if (fds.revents & POLLNVAL) {
+			g_set_error_literal (error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_READ,
+					     "invalid request");
+			return -1;
 		}
 	}
+}
+
+/* consume exactly @bufsz reply bytes, e.g. one flash page */
+static gboolean
+fu_device_altos_tty_read_buf (FuDeviceAltos *device,
+			      guint8 *buf,
+			      gsize bufsz,
+			      guint timeout_ms,
+			      GError **error)
+{
+	FuDeviceAltosPrivate *priv = GET_PRIVATE (device);
 
+	while (priv->tty_buf_tail - priv->tty_buf_head < bufsz) {
+		gssize len = fu_device_altos_tty_fill (device, timeout_ms, error);
+		if (len < 0)
+			return FALSE;
+		if (len == 0) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_READ,
+				     "no data recieved from device in %ums",
+				     timeout_ms);
+			return FALSE;
+		}
+	}
+	memcpy (buf, priv->tty_buf + priv->tty_buf_head, bufsz);
+	priv->tty_buf_head += bufsz;
 	return TRUE;
 }
 
+/* consume one complete protocol line, without the terminator */
+static GString *
+fu_device_altos_tty_read_line (FuDeviceAltos *device,
+			       guint timeout_ms,
+			       GError **error)
+{
+	FuDeviceAltosPrivate *priv = GET_PRIVATE (device);
+
+	for (;;) {
+		gssize len;
+
+		/* a complete line may already be buffered */
+		for (gsize i = priv->tty_buf_head; i < priv->tty_buf_tail; i++) {
+			if (priv->tty_buf[i] == '\n' || priv->tty_buf[i] == '\r') {
+				GString *str;
+				str = g_string_new_len ((gchar *) priv->tty_buf + priv->tty_buf_head,
+							(gssize) (i - priv->tty_buf_head));
+				priv->tty_buf_head = i + 1;
+				return str;
+			}
+		}
+		if (priv->tty_buf_head == 0 &&
+		    priv->tty_buf_tail == sizeof (priv->tty_buf)) {
+			g_set_error_literal (error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_READ,
+					     "protocol line too long");
+			return NULL;
+		}
+		len = fu_device_altos_tty_fill (device, timeout_ms, error);
+		if (len < 0)
+			return NULL;
+		if (len == 0) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_READ,
+				     "no data recieved from device in %ums",
+				     timeout_ms);
+			return NULL;
+		}
+	}
+}
+
 static GString *
 fu_device_altos_tty_read (FuDeviceAltos *device,
 			  guint timeout_ms,
@@ -384,6 +570,8 @@ fu_device_altos_tty_open (FuDeviceAltos *device, GError **error)
 	}
 
 	/* dump any pending input */
+	priv->tty_buf_head = 0;
+	priv->tty_buf_tail = 0;
 	str = fu_device_altos_tty_read (device, 50, -1, NULL);
 	if (str != NULL)
 		g_debug ("dumping pending buffer: %s", str->str);
@@ -409,8 +597,10 @@ fu_device_altos_read_page (FuDeviceAltos *device, guint address, GError **error)
 	g_autofree gchar *cmd = g_strdup_printf ("R %x\n", address);
 	if (!fu_device_altos_tty_write (device, cmd, -1, error))
 		return NULL;
-	str = fu_device_altos_tty_read (device, 1500, 256, error);
-	if (str == NULL)
+	str = g_string_sized_new (0x100);
+	g_string_set_size (str, 0x100);
+	if (!fu_device_altos_tty_read_buf (device, (guint8 *) str->str,
+					   0x100, 1500, error))
 		return NULL;
 	return g_steal_pointer (&str);
 }
@@ -422,11 +612,59 @@ fu_device_altos_write_page (FuDeviceAltos *device,
 			    guint data_len,
 			    GError **error)
 {
+	struct iovec iov[2];
 	g_autofree gchar *cmd = g_strdup_printf ("W %x\n", address);
-	if (!fu_device_altos_tty_write (device, cmd, -1, error))
+
+	/* the command and the page payload go down in one gather write */
+	iov[0].iov_base = cmd;
+	iov[0].iov_len = strlen (cmd);
+	iov[1].iov_base = (gpointer) data;
+	iov[1].iov_len = data_len;
+	return fu_device_altos_tty_writev (device, iov, 2, error);
+}
+
+static void
+fu_device_altos_get_page (const guint8 *data,
+			  gsize data_len,
+			  guint offset,
+			  guint8 *buf)
+{
+	memset (buf, 0xff, 0x100);
+	if (offset < data_len) {
+		gsize chunk_len = 0x100;
+		if (offset + 0x100 > data_len)
+			chunk_len = data_len - offset;
+		memcpy (buf, data + offset, chunk_len);
+	}
+}
+
+static gboolean
+fu_device_altos_verify_page (FuDeviceAltos *device,
+			     guint address,
+			     const guint8 *buf,
+			     GError **error)
+{
+	g_autoptr(GString) str = NULL;
+	str = fu_device_altos_read_page (device, address, error);
+	if (str == NULL)
 		return FALSE;
-	if (!fu_device_altos_tty_write (device, (const gchar *) data, data_len, error))
+	if (str->len != 0x100) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_WRITE,
+			     "failed to verify @%x, "
+			     "not enough data returned",
+			     address);
 		return FALSE;
+	}
+	if (memcmp (str->str, buf, 0x100) != 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_WRITE,
+			     "failed to verify @%x",
+			     address);
+		return FALSE;
+	}
 	return TRUE;
 }
 
@@ -485,9 +723,9 @@ fu_device_altos_write_firmware (FuDeviceAltos *device,
 	const gchar *data;
 	const gsize data_len;
 	guint flash_len;
+	guint progress_len;
 	g_autoptr(DfuFirmware) firmware = NULL;
 	g_autoptr(GBytes) fw_blob = NULL;
-	g_autoptr(GString) buf = g_string_new (NULL);
 
 	/* check kind */
 	if (priv->kind != FU_DEVICE_ALTOS_KIND_BOOTLOADER) {
@@ -516,6 +754,7 @@ fu_device_altos_write_firmware (FuDeviceAltos *device,
 				     "address range was icorrect");
 		return FALSE;
 	}
+	progress_len = flash_len;
 
 	/* load ihex blob */
 	firmware = dfu_firmware_new ();
@@ -544,23 +783,24 @@ fu_device_altos_write_firmware (FuDeviceAltos *device,
 		return FALSE;
 	}
 
+	/* reading each page back doubles the turnarounds, so by default the
+	 * whole image is verified in one read pass at the end */
+	if ((flags & FU_DEVICE_ALTOS_WRITE_FIRMWARE_FLAG_VERIFY_EACH_PAGE) == 0)
+		progress_len *= 2;
+
 	/* open tty for download */
 	if (!fu_device_altos_tty_open (device, error))
 		return FALSE;
 	for (guint i = 0; i < flash_len; i+= 0x100) {
-		g_autoptr(GString) str = NULL;
 		guint8 buf_tmp[0x100];
 
 		/* copy remaining data into buf if required */
-		memset (buf_tmp, 0xff, sizeof (buf));
-		if (i < data_len) {
-			gsize chunk_len = 0x100;
-			if (i + 0x100 > data_len)
-				chunk_len = data_len - i;
-			memcpy (buf_tmp, data + i, chunk_len);
-		}
+		fu_device_altos_get_page ((const guint8 *) data, data_len,
+					  i, buf_tmp);
 
-		/* verify data from device */
+		/* the loader erases each page after the data has arrived, so
+		 * streaming the next write command down the tty hides the
+		 * erase latency behind the transfer */
 		if (!fu_device_altos_write_page (device,
 						 priv->addr_base + i,
 						 buf_tmp,
@@ -569,36 +809,42 @@ fu_device_altos_write_firmware (FuDeviceAltos *device,
 			return FALSE;
 
 		/* verify data written on device */
-		str = fu_device_altos_read_page (device,
-						 priv->addr_base + i,
-						 error);
-		if (str == NULL)
-			return FALSE;
-		if (str->len != 0x100) {
-			g_set_error (error,
-					     FWUPD_ERROR,
-					     FWUPD_ERROR_WRITE,
-					     "failed to verify @%x, "
-					     "not enough data returned",
-					     (guint) (priv->addr_base + i));
-			return FALSE;
-		}
-		if (memcmp (str->str, buf_tmp, 0x100) != 0) {
-			g_set_error (error,
-					     FWUPD_ERROR,
-					     FWUPD_ERROR_WRITE,
-					     "failed to verify @%x",
-					     (guint) (priv->addr_base + i));
-			return FALSE;
+		if (flags & FU_DEVICE_ALTOS_WRITE_FIRMWARE_FLAG_VERIFY_EACH_PAGE) {
+			if (!fu_device_altos_verify_page (device,
+							  (guint) (priv->addr_base + i),
+							  buf_tmp,
+							  error))
+				return FALSE;
 		}
 
 		/* progress */
 		if (progress_cb != NULL) {
 			progress_cb ((goffset) i,
-				     (goffset) flash_len,
+				     (goffset) progress_len,
 				     progress_data);
 		}
-		g_string_append_len (buf, str->str, str->len);
+	}
+
+	/* verify the whole image in one sequential read pass; the loader has
+	 * no checksum command so the pages are read back and compared */
+	if ((flags & FU_DEVICE_ALTOS_WRITE_FIRMWARE_FLAG_VERIFY_EACH_PAGE) == 0) {
+		for (guint i = 0; i < flash_len; i+= 0x100) {
+			guint8 buf_tmp[0x100];
+			fu_device_altos_get_page ((const guint8 *) data, data_len,
+						  i, buf_tmp);
+			if (!fu_device_altos_verify_page (device,
+							  (guint) (priv->addr_base + i),
+							  buf_tmp,
+							  error))
+				return FALSE;
+
+			/* progress */
+			if (progress_cb != NULL) {
+				progress_cb ((goffset) (flash_len + i),
+					     (goffset) progress_len,
+					     progress_data);
+			}
+		}
 	}
 
 	/* go to application mode */
@@ -609,8 +855,8 @@ fu_device_altos_write_firmware (FuDeviceAltos *device,
 
 	/* progress complete */
 	if (progress_cb != NULL) {
-		progress_cb ((goffset) flash_len,
-			     (goffset) flash_len,
+		progress_cb ((goffset) progress_len,
+			     (goffset) progress_len,
 			     progress_data);
 	}
 
@@ -692,8 +938,7 @@ static gboolean
 fu_device_altos_probe_bootloader (FuDeviceAltos *device, GError **error)
 {
 	FuDeviceAltosPrivate *priv = GET_PRIVATE (device);
-	g_auto(GStrv) lines = NULL;
-	g_autoptr(GString) str = NULL;
+	guint line_cnt = 0;
 
 	/* get tty for upload */
 	if (!fu_device_altos_find_tty (device, error))
@@ -704,40 +949,49 @@ fu_device_altos_probe_bootloader (FuDeviceAltos *device, GError **error)
 	/* get the version information */
 	if (!fu_device_altos_tty_write (device, "v\n", -1, error))
 		return FALSE;
-	str = fu_device_altos_tty_read (device, 100, -1, error);
-	if (str == NULL) {
-		fu_device_altos_tty_close (device, NULL);
-		return FALSE;
-	}
 
-	/* parse each line */
-	lines = g_strsplit_set (str->str, "\n\r", -1);
-	for (guint i = 0; lines[i] != NULL; i++) {
+	/* parse each complete line; the listing has no terminator, so it is
+	 * over when the device goes quiet */
+	for (;;) {
+		g_autoptr(GError) error_local = NULL;
+		g_autoptr(GString) line = NULL;
+
+		line = fu_device_altos_tty_read_line (device, 100, &error_local);
+		if (line == NULL) {
+			if (line_cnt == 0) {
+				g_propagate_error (error,
+						   g_steal_pointer (&error_local));
+				fu_device_altos_tty_close (device, NULL);
+				return FALSE;
+			}
+			break;
+		}
 
 		/* ignore */
-		if (lines[i][0] == '\0')
+		if (line->len == 0)
 			continue;
-		if (g_str_has_prefix (lines[i], "manufacturer     "))
+		line_cnt++;
+		if (g_str_has_prefix (line->str, "manufacturer     "))
 			continue;
-		if (g_str_has_prefix (lines[i], "product          "))
+		if (g_str_has_prefix (line->str, "product          "))
 			continue;
 
 		/* we can flash firmware */
-		if (g_strcmp0 (lines[i], "altos-loader") == 0) {
+		if (g_strcmp0 (line->str, "altos-loader") == 0) {
 			fu_device_remove_flag (FU_DEVICE (device),
 					       FWUPD_DEVICE_FLAG_NEEDS_BOOTLOADER);
 			continue;
 		}
 
 		/* version number */
-		if (g_str_has_prefix (lines[i], "software-version ")) {
-			fu_device_set_version (FU_DEVICE (device), lines[i] + 17);
+		if (g_str_has_prefix (line->str, "software-version ")) {
+			fu_device_set_version (FU_DEVICE (device), line->str + 17);
 			continue;
 		}
 
 		/* address base and bound */
-		if (g_str_has_prefix (lines[i], "flash-range      ")) {
-			g_auto(GStrv) addrs = g_strsplit (lines[i] + 17, " ", -1);
+		if (g_str_has_prefix (line->str, "flash-range      ")) {
+			g_auto(GStrv) addrs = g_strsplit (line->str + 17, " ", -1);
 			priv->addr_base = g_ascii_strtoull (addrs[0], NULL, 16);
 			priv->addr_bound = g_ascii_strtoull (addrs[1], NULL, 16);
 			g_debug ("base: %x, bound: %x",
@@ -747,7 +1001,7 @@ fu_device_altos_probe_bootloader (FuDeviceAltos *device, GError **error)
 		}
 
 		/* unknown line */
-		g_warning ("unknown data: '%s'", lines[i]);
+		g_warning ("unknown data: '%s'", line->str);
 	}
 
 	/* done */
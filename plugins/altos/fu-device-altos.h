@@ -48,6 +48,7 @@ typedef enum {
 typedef enum {
 	FU_DEVICE_ALTOS_WRITE_FIRMWARE_FLAG_NONE	= 0,
 	FU_DEVICE_ALTOS_WRITE_FIRMWARE_FLAG_REBOOT	= 1 << 0,
+	FU_DEVICE_ALTOS_WRITE_FIRMWARE_FLAG_VERIFY_EACH_PAGE = 1 << 1,
 	/*< private >*/
 	FU_DEVICE_ALTOS_WRITE_FIRMWARE_FLAG_LAST
 } FuDeviceAltosWriteFirmwareFlag;
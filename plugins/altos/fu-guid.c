@@ -0,0 +1 @@
+../../src/fu-guid.c
\ No newline at end of file
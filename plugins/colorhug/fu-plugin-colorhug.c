@@ -24,6 +24,7 @@
 #include <colord.h>
 #include <colorhug.h>
 
+#include "fu-checksum.h"
 #include "fu-plugin.h"
 #include "fu-plugin-vfuncs.h"
 
@@ -172,6 +173,7 @@ fu_plugin_verify (FuPlugin *plugin,
 	gsize len;
 	g_autoptr(GError) error_local = NULL;
 	g_autofree guint8 *data2 = NULL;
+	g_autoptr(GPtrArray) hashes = NULL;
 	GChecksumType checksum_types[] = {
 		G_CHECKSUM_SHA1,
 		G_CHECKSUM_SHA256,
@@ -210,12 +212,9 @@ fu_plugin_verify (FuPlugin *plugin,
 	}
 
 	/* get the checksum */
-	for (guint i = 0; checksum_types[i] != 0; i++) {
-		g_autofree gchar *hash = NULL;
-		hash = g_compute_checksum_for_data (checksum_types[i],
-						    (guchar *) data2, len);
-		fu_device_add_checksum (device, hash);
-	}
+	hashes = fu_checksum_compute_multiple (data2, len, checksum_types);
+	for (guint i = 0; i < hashes->len; i++)
+		fu_device_add_checksum (device, g_ptr_array_index (hashes, i));
 
 	/* we're done here */
 	if (!g_usb_device_close (item->usb_device, &error_local))
@@ -224,6 +223,14 @@ fu_plugin_verify (FuPlugin *plugin,
 	return TRUE;
 }
 
+static gboolean
+fu_plugin_colorhug_got_version_cb (gpointer user_data)
+{
+	FuPluginItem *item = (FuPluginItem *) user_data;
+	fu_plugin_colorhug_get_firmware_version (item);
+	return item->got_version;
+}
+
 gboolean
 fu_plugin_update_online (FuPlugin *plugin,
 			 FuDevice *device,
@@ -295,37 +302,24 @@ fu_plugin_update_online (FuPlugin *plugin,
 	if (!fu_plugin_colorhug_open (item, error))
 		return FALSE;
 
-	/* write firmware */
-	g_debug ("ColorHug: Writing firmware");
+	/* write and verify the firmware as one queued transaction so the
+	 * read-back starts as soon as the last block has been written,
+	 * rather than paying the queue set-up cost twice */
+	g_debug ("ColorHug: Writing and verifying firmware");
 	ch_device_queue_write_firmware (data->device_queue, item->usb_device,
 					g_bytes_get_data (item->fw_bin, NULL),
 					g_bytes_get_size (item->fw_bin));
-	fu_plugin_set_status (plugin, FWUPD_STATUS_DEVICE_WRITE);
-	if (!ch_device_queue_process (data->device_queue,
-				      CH_DEVICE_QUEUE_PROCESS_FLAGS_NONE,
-				      NULL, &error_local)) {
-		g_set_error (error,
-			     FWUPD_ERROR,
-			     FWUPD_ERROR_WRITE,
-			     "failed to write firmware: %s",
-			     error_local->message);
-		g_usb_device_close (item->usb_device, NULL);
-		return FALSE;
-	}
-
-	/* verify firmware */
-	g_debug ("ColorHug: Veifying firmware");
 	ch_device_queue_verify_firmware (data->device_queue, item->usb_device,
 					 g_bytes_get_data (item->fw_bin, NULL),
 					 g_bytes_get_size (item->fw_bin));
-	fu_plugin_set_status (plugin, FWUPD_STATUS_DEVICE_VERIFY);
+	fu_plugin_set_status (plugin, FWUPD_STATUS_DEVICE_WRITE);
 	if (!ch_device_queue_process (data->device_queue,
 				      CH_DEVICE_QUEUE_PROCESS_FLAGS_NONE,
 				      NULL, &error_local)) {
 		g_set_error (error,
 			     FWUPD_ERROR,
 			     FWUPD_ERROR_WRITE,
-			     "failed to verify firmware: %s",
+			     "failed to write and verify firmware: %s",
 			     error_local->message);
 		g_usb_device_close (item->usb_device, NULL);
 		return FALSE;
@@ -382,10 +376,20 @@ fu_plugin_update_online (FuPlugin *plugin,
 		return FALSE;
 	}
 
-	/* get the new firmware version */
+	/* get the new firmware version; the device can stay busy for a short
+	 * time after booting the new firmware, so retry with an escalating
+	 * delay rather than giving up after one attempt */
 	g_debug ("ColorHug: Getting new firmware version");
 	item->got_version = FALSE;
-	fu_plugin_colorhug_get_firmware_version (item);
+	{
+		g_autoptr(GError) error_version = NULL;
+		if (!fu_plugin_wait_for_condition (plugin, 5000,
+						   fu_plugin_colorhug_got_version_cb,
+						   item, &error_version)) {
+			g_warning ("failed to read new firmware version: %s",
+				   error_version->message);
+		}
+	}
 
 	if (item->got_version)
 		g_debug ("ColorHug: DONE!");
@@ -20,8 +20,64 @@
  */
 
 #include <appstream-glib.h>
+#include <string.h>
 #include "fu-dell-common.h"
 
+/* The dock topology is expensive to read -- every lookup is at least one
+ * SMM round-trip -- and it cannot change until a dock is plugged in or
+ * removed, so a snapshot is taken on first request and shared by every
+ * user of this file in the process. The dell plugin invalidates it from
+ * the dock NIC hotplug events. */
+typedef enum {
+	DOCK_CACHE_STATE_UNKNOWN,
+	DOCK_CACHE_STATE_ABSENT,
+	DOCK_CACHE_STATE_LOCATED,
+	DOCK_CACHE_STATE_COMPLETE
+} DockCacheState;
+
+static GMutex		 fu_dell_dock_mutex;
+static DockCacheState	 fu_dell_dock_state = DOCK_CACHE_STATE_UNKNOWN;
+static guint32		 fu_dell_dock_location = 0;
+static DOCK_INFO_RECORD	 fu_dell_dock_record;
+
+/* Executing a SMI freezes every CPU for the call duration, so issuing
+ * one from the daemon main loop injects a latency spike into every
+ * concurrent D-Bus request. Requests pushed here run on one persistent
+ * worker -- SMM serializes the whole machine so more workers would not
+ * help -- and the completion callback is delivered back on the main
+ * loop as an idle source. */
+typedef struct {
+	GFunc		 func;		/* runs on the worker */
+	GSourceFunc	 done_cb;	/* runs on the main loop, or NULL */
+	gpointer	 user_data;
+} FuDellSmiRequest;
+
+static GThreadPool	*fu_dell_smi_pool = NULL;
+
+static void
+fu_dell_smi_pool_run_cb (gpointer data, gpointer user_data)
+{
+	FuDellSmiRequest *req = data;
+	req->func (req->user_data, NULL);
+	if (req->done_cb != NULL)
+		g_idle_add (req->done_cb, req->user_data);
+	g_free (req);
+}
+
+void
+fu_dell_smi_queue_push (GFunc func, GSourceFunc done_cb, gpointer user_data)
+{
+	FuDellSmiRequest *req = g_new0 (FuDellSmiRequest, 1);
+	req->func = func;
+	req->done_cb = done_cb;
+	req->user_data = user_data;
+	if (fu_dell_smi_pool == NULL) {
+		fu_dell_smi_pool = g_thread_pool_new (fu_dell_smi_pool_run_cb,
+						      NULL, 1, TRUE, NULL);
+	}
+	g_thread_pool_push (fu_dell_smi_pool, req, NULL);
+}
+
 /* These are for dock query capabilities */
 struct dock_count_in {
 	guint32 argument;
@@ -57,21 +113,6 @@ _dell_smi_obj_free (FuDellSmiObj *obj)
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC (FuDellSmiObj, _dell_smi_obj_free);
 
-gboolean
-fu_dell_supported (void)
-{
-	guint8 dell_supported = 0;
-	struct smbios_struct *de_table;
-
-        de_table = smbios_get_next_struct_by_handle (0, 0xDE00);
-        if (!de_table)
-		return FALSE;
-	smbios_struct_get_data (de_table, &(dell_supported), 0x00, sizeof(guint8));
-	if (dell_supported != 0xDE)
-		return FALSE;
-	return TRUE;
-}
-
 /* don't actually clear if we're testing */
 gboolean
 fu_dell_clear_smi (FuDellSmiObj *obj)
@@ -131,8 +172,8 @@ fu_dell_execute_simple_smi (FuDellSmiObj *obj, guint16 class, guint16 select)
 	return TRUE;
 }
 
-gboolean
-fu_dell_detect_dock (FuDellSmiObj *smi_obj, guint32 *location)
+static gboolean
+fu_dell_detect_dock_smi (FuDellSmiObj *smi_obj, guint32 *location)
 {
 	struct dock_count_in *count_args;
 	struct dock_count_out *count_out;
@@ -165,16 +206,51 @@ fu_dell_detect_dock (FuDellSmiObj *smi_obj, guint32 *location)
 	return TRUE;
 }
 
+/* the mutex must be held */
+static gboolean
+fu_dell_detect_dock_locked (FuDellSmiObj *smi_obj, guint32 *location)
+{
+	if (fu_dell_dock_state == DOCK_CACHE_STATE_ABSENT)
+		return FALSE;
+	if (fu_dell_dock_state >= DOCK_CACHE_STATE_LOCATED) {
+		*location = fu_dell_dock_location;
+		return TRUE;
+	}
+	if (!fu_dell_detect_dock_smi (smi_obj, location)) {
+		fu_dell_dock_state = DOCK_CACHE_STATE_ABSENT;
+		return FALSE;
+	}
+	fu_dell_dock_location = *location;
+	fu_dell_dock_state = DOCK_CACHE_STATE_LOCATED;
+	return TRUE;
+}
+
 gboolean
-fu_dell_query_dock (FuDellSmiObj *smi_obj, DOCK_UNION *buf)
+fu_dell_detect_dock (FuDellSmiObj *smi_obj, guint32 *location)
+{
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	/* the test suite provides its own buffers, never cache them */
+	if (smi_obj->fake_smbios)
+		return fu_dell_detect_dock_smi (smi_obj, location);
+
+	locker = g_mutex_locker_new (&fu_dell_dock_mutex);
+	return fu_dell_detect_dock_locked (smi_obj, location);
+}
+
+void
+fu_dell_dock_invalidate (void)
+{
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&fu_dell_dock_mutex);
+	fu_dell_dock_state = DOCK_CACHE_STATE_UNKNOWN;
+}
+
+static gboolean
+fu_dell_query_dock_smi (FuDellSmiObj *smi_obj, guint32 location, DOCK_UNION *buf)
 {
 	gint result;
-	guint32 location;
 	guint buf_size;
 
-	if (!fu_dell_detect_dock (smi_obj, &location))
-		return FALSE;
-
 	fu_dell_clear_smi (smi_obj);
 
 	/* look up more information on dock */
@@ -210,6 +286,34 @@ fu_dell_query_dock (FuDellSmiObj *smi_obj, DOCK_UNION *buf)
 	return TRUE;
 }
 
+gboolean
+fu_dell_query_dock (FuDellSmiObj *smi_obj, DOCK_UNION *buf)
+{
+	guint32 location;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	/* the test suite provides its own buffers, never cache them */
+	if (smi_obj->fake_smbios) {
+		if (!fu_dell_detect_dock_smi (smi_obj, &location))
+			return FALSE;
+		return fu_dell_query_dock_smi (smi_obj, location, buf);
+	}
+
+	locker = g_mutex_locker_new (&fu_dell_dock_mutex);
+	if (fu_dell_dock_state == DOCK_CACHE_STATE_COMPLETE) {
+		buf->record = &fu_dell_dock_record;
+		return TRUE;
+	}
+	if (!fu_dell_detect_dock_locked (smi_obj, &location))
+		return FALSE;
+	if (!fu_dell_query_dock_smi (smi_obj, location, buf))
+		return FALSE;
+	memcpy (&fu_dell_dock_record, buf->buf, sizeof (DOCK_INFO_RECORD));
+	buf->record = &fu_dell_dock_record;
+	fu_dell_dock_state = DOCK_CACHE_STATE_COMPLETE;
+	return TRUE;
+}
+
 const gchar*
 fu_dell_get_dock_type (guint8 type)
 {
@@ -87,9 +87,6 @@ typedef enum _CABLE_TYPE
 	CABLE_TYPE_TBT
 } CABLE_TYPE;
 
-gboolean
-fu_dell_supported (void);
-
 gboolean
 fu_dell_clear_smi (FuDellSmiObj *obj);
 
@@ -108,6 +105,12 @@ fu_dell_detect_dock (FuDellSmiObj *obj, guint32 *location);
 gboolean
 fu_dell_query_dock (FuDellSmiObj *smi_obj, DOCK_UNION *buf);
 
+void
+fu_dell_dock_invalidate (void);
+
+void
+fu_dell_smi_queue_push (GFunc func, GSourceFunc done_cb, gpointer user_data);
+
 const gchar*
 fu_dell_get_dock_type (guint8 type);
 
@@ -33,6 +33,7 @@
 #include <unistd.h>
 #include <fcntl.h>
 
+#include "fu-guid.h"
 #include "fu-plugin-dell.h"
 #include "fu-quirks.h"
 #include "fu-plugin-vfuncs.h"
@@ -285,44 +286,18 @@ fu_plugin_dock_node (FuPlugin *plugin, GUsbDevice *device,
 }
 
 
-void
-fu_plugin_dell_device_added_cb (GUsbContext *ctx,
-				GUsbDevice *device,
-				FuPlugin *plugin)
+static void
+fu_plugin_dell_dock_rescan (FuPlugin *plugin, GUsbDevice *device, DOCK_UNION buf)
 {
-	FuPluginData *data = fu_plugin_get_data (plugin);
 	AsVersionParseFlag parse_flags;
-	guint16 pid;
-	guint16 vid;
 	const gchar *query_str;
 	const gchar *component_name = NULL;
-	DOCK_UNION buf;
 	DOCK_INFO *dock_info;
 	efi_guid_t guid_raw;
 	efi_guid_t tmpguid;
 	gboolean old_ec = FALSE;
 	g_autofree gchar *fw_str = NULL;
 
-	/* don't look up immediately if a dock is connected as that would
-	   mean a SMI on every USB device that showed up on the system */
-	if (!data->smi_obj->fake_smbios) {
-		vid = g_usb_device_get_vid (device);
-		pid = g_usb_device_get_pid (device);
-	} else {
-		vid = data->fake_vid;
-		pid = data->fake_pid;
-	}
-
-	/* we're going to match on the Realtek NIC in the dock */
-	if (vid != DOCK_NIC_VID || pid != DOCK_NIC_PID)
-		return;
-
-	buf.buf = NULL;
-	if (!fu_dell_query_dock (data->smi_obj, &buf)) {
-		g_debug ("No dock detected.");
-		return;
-	}
-
 	if (buf.record->dock_info_header.dir_version != 1) {
 		g_debug ("Dock info header version unknown: %d",
 			 buf.record->dock_info_header.dir_version);
@@ -400,6 +375,91 @@ fu_plugin_dell_device_added_cb (GUsbContext *ctx,
 	}
 }
 
+typedef struct {
+	FuPlugin	*plugin;
+	GUsbDevice	*device;
+	DOCK_UNION	 buf;
+	gboolean	 ret;
+} FuPluginDockQueryHelper;
+
+/* runs on the SMI worker; uses a private SMI object so any concurrent
+ * main-loop SMI traffic is not corrupted */
+static void
+fu_plugin_dell_dock_query_worker_cb (gpointer user_data, gpointer unused)
+{
+	FuPluginDockQueryHelper *helper = user_data;
+	g_autoptr(FuDellSmiObj) smi_obj = g_malloc0 (sizeof (FuDellSmiObj));
+
+	smi_obj->smi = dell_smi_factory (DELL_SMI_DEFAULTS);
+	helper->buf.buf = NULL;
+	helper->ret = fu_dell_query_dock (smi_obj, &helper->buf);
+}
+
+static gboolean
+fu_plugin_dell_dock_query_done_cb (gpointer user_data)
+{
+	FuPluginDockQueryHelper *helper = user_data;
+
+	if (helper->ret)
+		fu_plugin_dell_dock_rescan (helper->plugin, helper->device, helper->buf);
+	else
+		g_debug ("No dock detected.");
+	g_object_unref (helper->plugin);
+	if (helper->device != NULL)
+		g_object_unref (helper->device);
+	g_free (helper);
+	return FALSE;
+}
+
+void
+fu_plugin_dell_device_added_cb (GUsbContext *ctx,
+				GUsbDevice *device,
+				FuPlugin *plugin)
+{
+	FuPluginData *data = fu_plugin_get_data (plugin);
+	guint16 pid;
+	guint16 vid;
+	DOCK_UNION buf;
+	FuPluginDockQueryHelper *helper;
+
+	/* don't look up immediately if a dock is connected as that would
+	   mean a SMI on every USB device that showed up on the system */
+	if (!data->smi_obj->fake_smbios) {
+		vid = g_usb_device_get_vid (device);
+		pid = g_usb_device_get_pid (device);
+	} else {
+		vid = data->fake_vid;
+		pid = data->fake_pid;
+	}
+
+	/* we're going to match on the Realtek NIC in the dock */
+	if (vid != DOCK_NIC_VID || pid != DOCK_NIC_PID)
+		return;
+
+	/* a dock just appeared; drop any stale topology snapshot */
+	fu_dell_dock_invalidate ();
+
+	/* the test suite expects the rescan synchronously */
+	if (data->smi_obj->fake_smbios) {
+		buf.buf = NULL;
+		if (!fu_dell_query_dock (data->smi_obj, &buf)) {
+			g_debug ("No dock detected.");
+			return;
+		}
+		fu_plugin_dell_dock_rescan (plugin, device, buf);
+		return;
+	}
+
+	/* the query executes in SMM with every CPU frozen; run it on the
+	 * SMI worker so the main loop keeps servicing D-Bus requests */
+	helper = g_new0 (FuPluginDockQueryHelper, 1);
+	helper->plugin = g_object_ref (plugin);
+	helper->device = device != NULL ? g_object_ref (device) : NULL;
+	fu_dell_smi_queue_push (fu_plugin_dell_dock_query_worker_cb,
+				fu_plugin_dell_dock_query_done_cb,
+				helper);
+}
+
 void
 fu_plugin_dell_device_removed_cb (GUsbContext *ctx,
 				  GUsbDevice *device,
@@ -430,6 +490,9 @@ fu_plugin_dell_device_removed_cb (GUsbContext *ctx,
 	if (vid != DOCK_NIC_VID || pid != DOCK_NIC_PID)
 		return;
 
+	/* the dock has gone; drop the cached topology snapshot */
+	fu_dell_dock_invalidate ();
+
 	/* remove any components already in database? */
 	for (guint i = 0; i < G_N_ELEMENTS (guids); i++) {
 		guid_raw = &guids[i];
@@ -449,13 +512,23 @@ fu_plugin_dell_device_removed_cb (GUsbContext *ctx,
 gboolean
 fu_plugin_get_results (FuPlugin *plugin, FuDevice *device, GError **error)
 {
-	struct smbios_struct *de_table;
+	FuSmbios *smbios = fu_plugin_get_smbios (plugin);
 	guint16 completion_code = 0xFFFF;
 	const gchar *tmp = NULL;
 
 	/* look at offset 0x06 for identifier meaning completion code */
-	de_table = smbios_get_next_struct_by_type (0, 0xDE);
-	smbios_struct_get_data (de_table, &completion_code, 0x06, sizeof (guint16));
+	if (smbios != NULL) {
+		GBytes *de_table = fu_smbios_get_data (smbios, 0xDE, NULL);
+		if (de_table != NULL) {
+			gsize len = 0;
+			const guint8 *buf = g_bytes_get_data (de_table, &len);
+			if (len >= 0x06 + sizeof (guint16)) {
+				memcpy (&completion_code,
+					buf + 0x06,
+					sizeof (guint16));
+			}
+		}
+	}
 
 	if (completion_code == DELL_SUCCESS) {
 		fu_device_set_update_state (device, FWUPD_UPDATE_STATE_SUCCESS);
@@ -514,6 +587,82 @@ fu_plugin_get_results (FuPlugin *plugin, FuDevice *device, GError **error)
 	return TRUE;
 }
 
+static gchar *
+fu_plugin_dell_smbios_checksum (FuPlugin *plugin)
+{
+	FuSmbios *smbios = fu_plugin_get_smbios (plugin);
+	GBytes *de_table;
+	GBytes *system_table;
+	g_autoptr(GChecksum) csum = NULL;
+
+	if (smbios == NULL)
+		return NULL;
+	system_table = fu_smbios_get_data (smbios, 0x01, NULL);
+	if (system_table == NULL)
+		return NULL;
+	csum = g_checksum_new (G_CHECKSUM_SHA1);
+	g_checksum_update (csum,
+			   g_bytes_get_data (system_table, NULL),
+			   g_bytes_get_size (system_table));
+	de_table = fu_smbios_get_data (smbios, 0xDE, NULL);
+	if (de_table != NULL) {
+		g_checksum_update (csum,
+				   g_bytes_get_data (de_table, NULL),
+				   g_bytes_get_size (de_table));
+	}
+	return g_strdup (g_checksum_get_string (csum));
+}
+
+static gchar *
+fu_plugin_dell_cache_fn (void)
+{
+	return g_build_filename (LOCALSTATEDIR, "lib", "fwupd", "dell.cache", NULL);
+}
+
+static guint16
+fu_plugin_dell_get_system_id (FuPlugin *plugin)
+{
+	FuPluginData *data = fu_plugin_get_data (plugin);
+	g_autofree gchar *csum = NULL;
+	g_autofree gchar *fn = NULL;
+	g_autoptr(GKeyFile) kf = g_key_file_new ();
+
+	if (data->system_id_set)
+		return data->system_id;
+	if (data->smi_obj->fake_smbios)
+		return 0;
+
+	/* the system ID is immutable for a given SMBIOS image, so repeat
+	 * boots can skip the libsmbios table walk */
+	csum = fu_plugin_dell_smbios_checksum (plugin);
+	fn = fu_plugin_dell_cache_fn ();
+	if (csum != NULL &&
+	    g_key_file_load_from_file (kf, fn, G_KEY_FILE_NONE, NULL)) {
+		gint tmp = g_key_file_get_integer (kf, csum, "SystemId", NULL);
+		if (tmp != 0) {
+			data->system_id = (guint16) tmp;
+			data->system_id_set = TRUE;
+			return data->system_id;
+		}
+	}
+	data->system_id = (guint16) sysinfo_get_dell_system_id ();
+	data->system_id_set = TRUE;
+
+	/* not being able to save is not fatal, just slow */
+	if (csum != NULL && data->system_id != 0) {
+		g_autofree gchar *dirname = g_path_get_dirname (fn);
+		g_autoptr(GError) error_local = NULL;
+		g_key_file_set_integer (kf, csum, "SystemId", data->system_id);
+		if (g_mkdir_with_parents (dirname, 0755) != 0) {
+			g_debug ("failed to create %s", dirname);
+			return data->system_id;
+		}
+		if (!g_key_file_save_to_file (kf, fn, &error_local))
+			g_debug ("failed to save %s: %s", fn, error_local->message);
+	}
+	return data->system_id;
+}
+
 gboolean
 fu_plugin_dell_detect_tpm (FuPlugin *plugin, GError **error)
 {
@@ -575,8 +724,7 @@ fu_plugin_dell_detect_tpm (FuPlugin *plugin, GError **error)
 		return FALSE;
 	}
 
-	if (!data->smi_obj->fake_smbios)
-		system_id = (guint16) sysinfo_get_dell_system_id ();
+	system_id = fu_plugin_dell_get_system_id (plugin);
 
 	for (guint i = 0; i < G_N_ELEMENTS (tpm_switch_blacklist); i++) {
 		if (tpm_switch_blacklist[i] == system_id) {
@@ -585,11 +733,11 @@ fu_plugin_dell_detect_tpm (FuPlugin *plugin, GError **error)
 	}
 
 	tpm_guid_raw = g_strdup_printf ("%04x-%s", system_id, tpm_mode);
-	tpm_guid = as_utils_guid_from_string (tpm_guid_raw);
+	tpm_guid = fu_guid_from_string (tpm_guid_raw);
 	tpm_id = g_strdup_printf ("DELL-%s" G_GUINT64_FORMAT, tpm_guid);
 
 	tpm_guid_raw_alt = g_strdup_printf ("%04x-%s", system_id, tpm_mode_alt);
-	tpm_guid_alt = as_utils_guid_from_string (tpm_guid_raw_alt);
+	tpm_guid_alt = fu_guid_from_string (tpm_guid_raw_alt);
 	tpm_id_alt = g_strdup_printf ("DELL-%s" G_GUINT64_FORMAT, tpm_guid_alt);
 
 	g_debug ("Creating primary TPM GUID %s and secondary TPM GUID %s",
@@ -832,6 +980,17 @@ fu_plugin_coldplug_cleanup (FuPlugin *plugin, GError **error)
 	return fu_dell_toggle_flash (NULL, error, FALSE);
 }
 
+static gboolean
+fu_dell_supported (FuPlugin *plugin)
+{
+	FuSmbios *smbios = fu_plugin_get_smbios (plugin);
+
+	/* the Dell-specific structure is in the shared table parse */
+	if (smbios == NULL)
+		return FALSE;
+	return fu_smbios_get_data (smbios, 0xDE, NULL) != NULL;
+}
+
 void
 fu_plugin_init (FuPlugin *plugin)
 {
@@ -840,7 +999,7 @@ fu_plugin_init (FuPlugin *plugin)
 					       g_free, (GDestroyNotify) fu_plugin_device_free);
 
 	data->smi_obj = g_malloc0 (sizeof (FuDellSmiObj));
-	if (fu_dell_supported ())
+	if (fu_dell_supported (plugin))
 		data->smi_obj->smi = dell_smi_factory (DELL_SMI_DEFAULTS);
 	data->smi_obj->fake_smbios = FALSE;
 	if (g_getenv ("FWUPD_DELL_FAKE_SMBIOS") != NULL)
@@ -870,7 +1029,7 @@ fu_plugin_startup (FuPlugin *plugin, GError **error)
 		return TRUE;
 	}
 
-	if (!fu_dell_supported ()) {
+	if (!fu_dell_supported (plugin)) {
 		g_set_error (error,
 			     FWUPD_ERROR,
 			     FWUPD_ERROR_NOT_SUPPORTED,
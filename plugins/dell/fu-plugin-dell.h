@@ -31,6 +31,8 @@ struct FuPluginData {
 	FuDellSmiObj		*smi_obj;
 	guint16			fake_vid;
 	guint16			fake_pid;
+	guint16			system_id;
+	gboolean		system_id_set;
 };
 
 void
@@ -24,6 +24,7 @@
 #include <appstream-glib.h>
 #include <libdfu/dfu.h>
 
+#include "fu-checksum.h"
 #include "fu-plugin.h"
 #include "fu-plugin-vfuncs.h"
 
@@ -292,6 +293,7 @@ fu_plugin_verify (FuPlugin *plugin,
 	g_autoptr(DfuDevice) dfu_device = NULL;
 	g_autoptr(DfuFirmware) dfu_firmware = NULL;
 	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GPtrArray) hashes = NULL;
 	GChecksumType checksum_types[] = {
 		G_CHECKSUM_SHA1,
 		G_CHECKSUM_SHA256,
@@ -349,11 +351,9 @@ fu_plugin_verify (FuPlugin *plugin,
 	blob_fw = dfu_firmware_write_data (dfu_firmware, error);
 	if (blob_fw == NULL)
 		return FALSE;
-	for (guint i = 0; checksum_types[i] != 0; i++) {
-		g_autofree gchar *hash = NULL;
-		hash = g_compute_checksum_for_bytes (checksum_types[i], blob_fw);
-		fu_device_add_checksum (dev, hash);
-	}
+	hashes = fu_checksum_compute_multiple_bytes (blob_fw, checksum_types);
+	for (guint i = 0; i < hashes->len; i++)
+		fu_device_add_checksum (dev, g_ptr_array_index (hashes, i));
 	fu_plugin_set_status (plugin, FWUPD_STATUS_IDLE);
 	return TRUE;
 }
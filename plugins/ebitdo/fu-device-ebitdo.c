@@ -38,6 +38,9 @@ G_DEFINE_TYPE_WITH_PRIVATE (FuDeviceEbitdo, fu_device_ebitdo, FU_TYPE_DEVICE)
 
 #define GET_PRIVATE(o) (fu_device_ebitdo_get_instance_private (o))
 
+#define FU_EBITDO_WRITE_BLOCK_SZ	32	/* bytes */
+#define FU_EBITDO_WRITE_WINDOW_SZ	8	/* blocks in flight */
+
 /**
  * fu_device_ebitdo_kind_from_string:
  * @kind: the string.
@@ -437,6 +440,94 @@ fu_device_ebitdo_get_serial (FuDeviceEbitdo *device)
 	return priv->serial;
 }
 
+static gboolean
+fu_device_ebitdo_write_block (FuDeviceEbitdo *device,
+			      const guint8 *data,
+			      guint32 offset,
+			      GError **error)
+{
+	g_autoptr(GError) error_local = NULL;
+	if (!fu_device_ebitdo_send (device,
+				 FU_EBITDO_PKT_TYPE_USER_CMD,
+				 FU_EBITDO_PKT_CMD_UPDATE_FIRMWARE_DATA,
+				 FU_EBITDO_PKT_CMD_FW_UPDATE_DATA,
+				 data, FU_EBITDO_WRITE_BLOCK_SZ,
+				 &error_local)) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_INVALID_DATA,
+			     "Failed to write firmware @0x%04x: %s",
+			     offset, error_local->message);
+		return FALSE;
+	}
+	if (!fu_device_ebitdo_receive (device, NULL, 0, &error_local)) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_INVALID_DATA,
+			     "Failed to get ACK for write firmware @0x%04x: %s",
+			     offset, error_local->message);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static gboolean
+fu_device_ebitdo_write_blocks (FuDeviceEbitdo *device,
+			       const guint8 *data,
+			       guint32 offset,
+			       guint blocks_cnt,
+			       guint32 *offset_failed,
+			       GError **error)
+{
+	guint i;
+	guint j;
+	g_autoptr(GError) error_local = NULL;
+
+	/* stream the whole window; the bootloader queues one status reply
+	 * per data packet so the replies can be drained afterwards */
+	for (i = 0; i < blocks_cnt; i++) {
+		if (!fu_device_ebitdo_send (device,
+					 FU_EBITDO_PKT_TYPE_USER_CMD,
+					 FU_EBITDO_PKT_CMD_UPDATE_FIRMWARE_DATA,
+					 FU_EBITDO_PKT_CMD_FW_UPDATE_DATA,
+					 data + (i * FU_EBITDO_WRITE_BLOCK_SZ),
+					 FU_EBITDO_WRITE_BLOCK_SZ,
+					 &error_local)) {
+			/* drain the replies already in flight */
+			for (j = 0; j < i; j++)
+				fu_device_ebitdo_receive (device, NULL, 0, NULL);
+			if (offset_failed != NULL)
+				*offset_failed = offset + (i * FU_EBITDO_WRITE_BLOCK_SZ);
+			g_set_error (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_INVALID_DATA,
+				     "Failed to write firmware @0x%04x: %s",
+				     offset + (i * FU_EBITDO_WRITE_BLOCK_SZ),
+				     error_local->message);
+			return FALSE;
+		}
+	}
+	for (i = 0; i < blocks_cnt; i++) {
+		if (!fu_device_ebitdo_receive (device, NULL, 0, &error_local)) {
+			/* the loader stops committing data after a failure,
+			 * so drain any stale replies and let the caller
+			 * retransmit from the first unacknowledged block */
+			for (j = i + 1; j < blocks_cnt; j++)
+				fu_device_ebitdo_receive (device, NULL, 0, NULL);
+			if (offset_failed != NULL)
+				*offset_failed = offset + (i * FU_EBITDO_WRITE_BLOCK_SZ);
+			g_set_error (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_INVALID_DATA,
+				     "Failed to get ACK for write firmware @0x%04x: %s",
+				     offset + (i * FU_EBITDO_WRITE_BLOCK_SZ),
+				     error_local->message);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
 gboolean
 fu_device_ebitdo_write_firmware (FuDeviceEbitdo *device, GBytes *fw,
 			      GFileProgressCallback progress_cb,
@@ -446,7 +537,8 @@ fu_device_ebitdo_write_firmware (FuDeviceEbitdo *device, GBytes *fw,
 	FuDeviceEbitdoPrivate *priv = GET_PRIVATE (device);
 	FuEbitdoFirmwareHeader *hdr;
 	const guint8 *payload_data;
-	const guint chunk_sz = 32;
+	guint blocks_cnt = 0;
+	guint window_sz = FU_EBITDO_WRITE_WINDOW_SZ;
 	guint32 offset;
 	guint32 payload_len;
 	guint32 serial_new[3];
@@ -519,36 +611,55 @@ fu_device_ebitdo_write_firmware (FuDeviceEbitdo *device, GBytes *fw,
 		return FALSE;
 	}
 
-	/* flash the firmware in 32 byte blocks */
+	/* flash the firmware in 32 byte blocks, keeping a window of blocks
+	 * in flight to hide the per-block ACK latency */
 	payload_data = g_bytes_get_data (fw, NULL);
 	payload_data += sizeof(FuEbitdoFirmwareHeader);
-	for (offset = 0; offset < payload_len; offset += chunk_sz) {
+	for (offset = 0; offset < payload_len; offset += blocks_cnt * FU_EBITDO_WRITE_BLOCK_SZ) {
+		blocks_cnt = MIN (window_sz,
+				  (payload_len - offset + FU_EBITDO_WRITE_BLOCK_SZ - 1) /
+				  FU_EBITDO_WRITE_BLOCK_SZ);
 		if (g_getenv ("FU_EBITDO_DEBUG") != NULL) {
 			g_debug ("writing %u bytes to 0x%04x of 0x%04x",
-				 chunk_sz, offset, payload_len);
+				 blocks_cnt * FU_EBITDO_WRITE_BLOCK_SZ,
+				 offset, payload_len);
 		}
 		if (progress_cb != NULL)
 			progress_cb (offset, payload_len, progress_data);
-		if (!fu_device_ebitdo_send (device,
-					 FU_EBITDO_PKT_TYPE_USER_CMD,
-					 FU_EBITDO_PKT_CMD_UPDATE_FIRMWARE_DATA,
-					 FU_EBITDO_PKT_CMD_FW_UPDATE_DATA,
-					 payload_data + offset, chunk_sz,
-					 &error_local)) {
-			g_set_error (error,
-				     G_IO_ERROR,
-				     G_IO_ERROR_INVALID_DATA,
-				     "Failed to write firmware @0x%04x: %s",
-				     offset, error_local->message);
-			return FALSE;
-		}
-		if (!fu_device_ebitdo_receive (device, NULL, 0, &error_local)) {
-			g_set_error (error,
-				     G_IO_ERROR,
-				     G_IO_ERROR_INVALID_DATA,
-				     "Failed to get ACK for write firmware @0x%04x: %s",
-				     offset, error_local->message);
-			return FALSE;
+		if (blocks_cnt > 1) {
+			guint32 offset_failed = offset;
+			guint32 offset_tmp;
+			g_autoptr(GError) error_window = NULL;
+			if (fu_device_ebitdo_write_blocks (device,
+							   payload_data + offset,
+							   offset,
+							   blocks_cnt,
+							   &offset_failed,
+							   &error_window))
+				continue;
+
+			/* retransmit the unacknowledged blocks one at a time
+			 * and drop to the serial protocol for the rest of
+			 * the image */
+			g_debug ("windowed write failed (%s), retrying @0x%04x with window=1",
+				 error_window->message, offset_failed);
+			for (offset_tmp = offset_failed;
+			     offset_tmp < offset + (blocks_cnt * FU_EBITDO_WRITE_BLOCK_SZ) &&
+			     offset_tmp < payload_len;
+			     offset_tmp += FU_EBITDO_WRITE_BLOCK_SZ) {
+				if (!fu_device_ebitdo_write_block (device,
+								   payload_data + offset_tmp,
+								   offset_tmp,
+								   error))
+					return FALSE;
+			}
+			window_sz = 1;
+		} else {
+			if (!fu_device_ebitdo_write_block (device,
+							   payload_data + offset,
+							   offset,
+							   error))
+				return FALSE;
 		}
 	}
 
@@ -0,0 +1,339 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2017 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "config.h"
+
+#include "fu-ebitdo-batch.h"
+
+#define FU_EBITDO_BATCH_MAX_PARALLEL_DEFAULT	4
+
+/* one attached controller being updated as part of the batch */
+typedef struct {
+	FuEbitdoBatch		*batch;		/* no ref */
+	FuDeviceEbitdo		*device;
+	GError			*error;
+} FuEbitdoBatchSession;
+
+struct _FuEbitdoBatch {
+	GObject			 parent_instance;
+	GPtrArray		*sessions;
+	guint			 max_parallel;
+
+	/* only valid while fu_ebitdo_batch_write_firmware() is running;
+	 * all three are owned by the calling thread, the workers only
+	 * ever touch them through idle sources on @context */
+	GMainContext		*context;
+	GBytes			*fw;
+	FuEbitdoBatchProgressFunc progress_cb;
+	gpointer		 progress_data;
+	guint			 pending_cnt;
+};
+
+G_DEFINE_TYPE (FuEbitdoBatch, fu_ebitdo_batch, G_TYPE_OBJECT)
+
+static void
+fu_ebitdo_batch_session_free (FuEbitdoBatchSession *session)
+{
+	if (session->error != NULL)
+		g_error_free (session->error);
+	g_object_unref (session->device);
+	g_free (session);
+}
+
+/**
+ * fu_ebitdo_batch_set_max_parallel:
+ * @batch: a #FuEbitdoBatch
+ * @max_parallel: number of controllers to write at the same time
+ *
+ * Sets how many controllers are flashed concurrently; each in-flight
+ * session holds its own open USB handle.
+ **/
+void
+fu_ebitdo_batch_set_max_parallel (FuEbitdoBatch *batch, guint max_parallel)
+{
+	g_return_if_fail (FU_IS_EBITDO_BATCH (batch));
+	g_return_if_fail (max_parallel > 0);
+	batch->max_parallel = max_parallel;
+}
+
+/**
+ * fu_ebitdo_batch_add_device:
+ * @batch: a #FuEbitdoBatch
+ * @device: a #FuDeviceEbitdo in bootloader mode
+ *
+ * Adds a controller to the batch. The device is not opened until
+ * fu_ebitdo_batch_write_firmware() runs its session.
+ **/
+void
+fu_ebitdo_batch_add_device (FuEbitdoBatch *batch, FuDeviceEbitdo *device)
+{
+	FuEbitdoBatchSession *session;
+	g_return_if_fail (FU_IS_EBITDO_BATCH (batch));
+	g_return_if_fail (FU_IS_DEVICE_EBITDO (device));
+	session = g_new0 (FuEbitdoBatchSession, 1);
+	session->batch = batch;
+	session->device = g_object_ref (device);
+	g_ptr_array_add (batch->sessions, session);
+}
+
+/**
+ * fu_ebitdo_batch_get_device_count:
+ * @batch: a #FuEbitdoBatch
+ *
+ * Returns: the number of controllers added to the batch
+ **/
+guint
+fu_ebitdo_batch_get_device_count (FuEbitdoBatch *batch)
+{
+	g_return_val_if_fail (FU_IS_EBITDO_BATCH (batch), 0);
+	return batch->sessions->len;
+}
+
+/**
+ * fu_ebitdo_batch_get_device_error:
+ * @batch: a #FuEbitdoBatch
+ * @device: a #FuDeviceEbitdo previously added to the batch
+ *
+ * Gets the failure for one controller from the last
+ * fu_ebitdo_batch_write_firmware() call.
+ *
+ * Returns: a #GError, or %NULL if the session succeeded
+ **/
+const GError *
+fu_ebitdo_batch_get_device_error (FuEbitdoBatch *batch, FuDeviceEbitdo *device)
+{
+	g_return_val_if_fail (FU_IS_EBITDO_BATCH (batch), NULL);
+	g_return_val_if_fail (FU_IS_DEVICE_EBITDO (device), NULL);
+	for (guint i = 0; i < batch->sessions->len; i++) {
+		FuEbitdoBatchSession *session = g_ptr_array_index (batch->sessions, i);
+		if (session->device == device)
+			return session->error;
+	}
+	return NULL;
+}
+
+typedef struct {
+	FuEbitdoBatchSession	*session;
+	goffset			 current;
+	goffset			 total;
+} FuEbitdoBatchProgressEvent;
+
+/* runs in the calling thread, dispatched from the batch context */
+static gboolean
+fu_ebitdo_batch_progress_idle_cb (gpointer user_data)
+{
+	FuEbitdoBatchProgressEvent *event = (FuEbitdoBatchProgressEvent *) user_data;
+	FuEbitdoBatch *batch = event->session->batch;
+	if (batch->progress_cb != NULL) {
+		batch->progress_cb (event->session->device,
+				    event->current,
+				    event->total,
+				    batch->progress_data);
+	}
+	return G_SOURCE_REMOVE;
+}
+
+/* runs in the worker thread */
+static void
+fu_ebitdo_batch_progress_cb (goffset current, goffset total, gpointer user_data)
+{
+	FuEbitdoBatchSession *session = (FuEbitdoBatchSession *) user_data;
+	FuEbitdoBatchProgressEvent *event = g_new0 (FuEbitdoBatchProgressEvent, 1);
+	event->session = session;
+	event->current = current;
+	event->total = total;
+	g_main_context_invoke_full (session->batch->context,
+				    G_PRIORITY_DEFAULT,
+				    fu_ebitdo_batch_progress_idle_cb,
+				    event, g_free);
+}
+
+/* runs in the calling thread, dispatched from the batch context */
+static gboolean
+fu_ebitdo_batch_session_done_idle_cb (gpointer user_data)
+{
+	FuEbitdoBatchSession *session = (FuEbitdoBatchSession *) user_data;
+	session->batch->pending_cnt--;
+	return G_SOURCE_REMOVE;
+}
+
+/* runs in the worker thread; each session opens and closes its own
+ * USB handle so sessions never share device state */
+static void
+fu_ebitdo_batch_session_thread_cb (gpointer data, gpointer user_data)
+{
+	FuEbitdoBatchSession *session = (FuEbitdoBatchSession *) data;
+	FuEbitdoBatch *batch = session->batch;
+
+	/* only the bootloader can do the update */
+	if (fu_device_ebitdo_get_kind (session->device) !=
+	    FU_DEVICE_EBITDO_KIND_BOOTLOADER) {
+		g_set_error_literal (&session->error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_NOT_SUPPORTED,
+				     "device is not in bootloader mode");
+		goto out;
+	}
+
+	/* open, write the whole image, close */
+	if (!fu_device_ebitdo_open (session->device, &session->error))
+		goto out;
+	if (!fu_device_ebitdo_write_firmware (session->device,
+					      batch->fw,
+					      fu_ebitdo_batch_progress_cb,
+					      session,
+					      &session->error)) {
+		fu_device_ebitdo_close (session->device, NULL);
+		goto out;
+	}
+	if (!fu_device_ebitdo_close (session->device, &session->error))
+		goto out;
+out:
+	g_main_context_invoke_full (batch->context,
+				    G_PRIORITY_DEFAULT,
+				    fu_ebitdo_batch_session_done_idle_cb,
+				    session, NULL);
+}
+
+/**
+ * fu_ebitdo_batch_write_firmware:
+ * @batch: a #FuEbitdoBatch
+ * @fw: the firmware image to write to every controller
+ * @progress_cb: (scope call): function to call as each session advances
+ * @progress_data: user data for @progress_cb
+ * @error: a #GError, or %NULL
+ *
+ * Writes @fw to every controller in the batch, running up to the
+ * configured number of sessions in parallel. Progress callbacks are
+ * delivered in the calling thread, tagged with the device they belong
+ * to. The call blocks until every session has finished; per-device
+ * failures do not stop the other sessions and can be inspected
+ * afterwards with fu_ebitdo_batch_get_device_error().
+ *
+ * Returns: %TRUE if every controller was updated
+ **/
+gboolean
+fu_ebitdo_batch_write_firmware (FuEbitdoBatch *batch,
+				GBytes *fw,
+				FuEbitdoBatchProgressFunc progress_cb,
+				gpointer progress_data,
+				GError **error)
+{
+	guint failed_cnt = 0;
+	GThreadPool *pool;
+	g_autoptr(GMainContext) context = NULL;
+
+	g_return_val_if_fail (FU_IS_EBITDO_BATCH (batch), FALSE);
+	g_return_val_if_fail (fw != NULL, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* sanity check */
+	if (batch->sessions->len == 0) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_NOTHING_TO_DO,
+				     "no devices in the batch");
+		return FALSE;
+	}
+
+	/* all progress and completion events funnel through this
+	 * context, which only the calling thread iterates */
+	context = g_main_context_new ();
+	batch->context = context;
+	batch->fw = fw;
+	batch->progress_cb = progress_cb;
+	batch->progress_data = progress_data;
+	batch->pending_cnt = batch->sessions->len;
+
+	/* the pool size is the parallelism cap */
+	pool = g_thread_pool_new (fu_ebitdo_batch_session_thread_cb,
+				  batch,
+				  (gint) batch->max_parallel,
+				  FALSE,
+				  error);
+	if (pool == NULL)
+		return FALSE;
+	for (guint i = 0; i < batch->sessions->len; i++) {
+		FuEbitdoBatchSession *session = g_ptr_array_index (batch->sessions, i);
+		g_clear_error (&session->error);
+		g_thread_pool_push (pool, session, NULL);
+	}
+
+	/* dispatch progress until the last session completes */
+	while (batch->pending_cnt > 0)
+		g_main_context_iteration (context, TRUE);
+	g_thread_pool_free (pool, FALSE, TRUE);
+	batch->context = NULL;
+	batch->fw = NULL;
+	batch->progress_cb = NULL;
+	batch->progress_data = NULL;
+
+	/* summarize the batch */
+	for (guint i = 0; i < batch->sessions->len; i++) {
+		FuEbitdoBatchSession *session = g_ptr_array_index (batch->sessions, i);
+		if (session->error != NULL)
+			failed_cnt++;
+	}
+	if (failed_cnt > 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_WRITE,
+			     "failed to update %u of %u controllers",
+			     failed_cnt, batch->sessions->len);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static void
+fu_ebitdo_batch_finalize (GObject *object)
+{
+	FuEbitdoBatch *batch = FU_EBITDO_BATCH (object);
+	g_ptr_array_unref (batch->sessions);
+	G_OBJECT_CLASS (fu_ebitdo_batch_parent_class)->finalize (object);
+}
+
+static void
+fu_ebitdo_batch_class_init (FuEbitdoBatchClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = fu_ebitdo_batch_finalize;
+}
+
+static void
+fu_ebitdo_batch_init (FuEbitdoBatch *batch)
+{
+	batch->sessions = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_ebitdo_batch_session_free);
+	batch->max_parallel = FU_EBITDO_BATCH_MAX_PARALLEL_DEFAULT;
+}
+
+/**
+ * fu_ebitdo_batch_new:
+ *
+ * Creates a new #FuEbitdoBatch.
+ *
+ * Returns: (transfer full): a #FuEbitdoBatch
+ **/
+FuEbitdoBatch *
+fu_ebitdo_batch_new (void)
+{
+	return FU_EBITDO_BATCH (g_object_new (FU_TYPE_EBITDO_BATCH, NULL));
+}
@@ -0,0 +1,55 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2017 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __FU_EBITDO_BATCH_H
+#define __FU_EBITDO_BATCH_H
+
+#include <glib-object.h>
+
+#include "fu-device-ebitdo.h"
+
+G_BEGIN_DECLS
+
+#define FU_TYPE_EBITDO_BATCH (fu_ebitdo_batch_get_type ())
+G_DECLARE_FINAL_TYPE (FuEbitdoBatch, fu_ebitdo_batch, FU, EBITDO_BATCH, GObject)
+
+typedef void	(*FuEbitdoBatchProgressFunc)		(FuDeviceEbitdo	*device,
+							 goffset	 current,
+							 goffset	 total,
+							 gpointer	 user_data);
+
+FuEbitdoBatch	*fu_ebitdo_batch_new			(void);
+void		 fu_ebitdo_batch_set_max_parallel	(FuEbitdoBatch	*batch,
+							 guint		 max_parallel);
+void		 fu_ebitdo_batch_add_device		(FuEbitdoBatch	*batch,
+							 FuDeviceEbitdo	*device);
+guint		 fu_ebitdo_batch_get_device_count	(FuEbitdoBatch	*batch);
+gboolean	 fu_ebitdo_batch_write_firmware		(FuEbitdoBatch	*batch,
+							 GBytes		*fw,
+							 FuEbitdoBatchProgressFunc progress_cb,
+							 gpointer	 progress_data,
+							 GError		**error);
+const GError	*fu_ebitdo_batch_get_device_error	(FuEbitdoBatch	*batch,
+							 FuDeviceEbitdo	*device);
+
+G_END_DECLS
+
+#endif /* __FU_EBITDO_BATCH_H */
@@ -23,38 +23,80 @@
 
 #include "fu-ebitdo-common.h"
 #include "fu-device-ebitdo.h"
+#include "fu-ebitdo-batch.h"
 
 static void
-fu_ebitdo_write_progress_cb (goffset current, goffset total, gpointer user_data)
+fu_ebitdo_write_progress_cb (FuDeviceEbitdo *dev,
+			     goffset current,
+			     goffset total,
+			     gpointer user_data)
 {
 	gdouble percentage = -1.f;
 	if (total > 0)
 		percentage = (100.f * (gdouble) current) / (gdouble) total;
-	g_print ("Written %" G_GOFFSET_FORMAT "/%" G_GOFFSET_FORMAT " bytes [%.1f%%]\n",
+	g_print ("[%s] Written %" G_GOFFSET_FORMAT "/%" G_GOFFSET_FORMAT " bytes [%.1f%%]\n",
+		 fu_device_get_id (FU_DEVICE (dev)),
 		 current, total, percentage);
 }
 
+static void
+fu_ebitdo_print_bootloader_steps (FuDeviceEbitdo *dev)
+{
+	g_print ("1. Disconnect the controller\n");
+	switch (fu_device_ebitdo_get_kind (dev)) {
+	case FU_DEVICE_EBITDO_KIND_FC30:
+	case FU_DEVICE_EBITDO_KIND_NES30:
+	case FU_DEVICE_EBITDO_KIND_SFC30:
+	case FU_DEVICE_EBITDO_KIND_SNES30:
+		g_print ("2. Hold down L+R+START for 3 seconds until "
+			 "both LED lights flashing.\n");
+		break;
+	case FU_DEVICE_EBITDO_KIND_FC30PRO:
+	case FU_DEVICE_EBITDO_KIND_NES30PRO:
+		g_print ("2. Hold down RETURN+POWER for 3 seconds until "
+			 "both LED lights flashing.\n");
+		break;
+	case FU_DEVICE_EBITDO_KIND_FC30_ARCADE:
+		g_print ("2. Hold down L1+R1+HOME for 3 seconds until "
+			 "both blue LED and green LED blink.\n");
+		break;
+	default:
+		g_print ("2. Do what it says in the manual.\n");
+		break;
+	}
+	g_print ("3. Connect controller\n");
+}
+
 int
 main (int argc, char **argv)
 {
 	gsize len;
 	guint i;
+	guint64 max_parallel = 4;
 	g_autofree guint8 *data = NULL;
-	g_autoptr(FuDeviceEbitdo) dev = NULL;
+	g_autoptr(FuEbitdoBatch) batch = fu_ebitdo_batch_new ();
 	g_autoptr(GBytes) fw = NULL;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(GPtrArray) devices = NULL;
+	g_autoptr(GPtrArray) devs = NULL;
 	g_autoptr(GUsbContext) usb_ctx = NULL;
 
 	g_setenv ("G_MESSAGES_DEBUG", "all", TRUE);
 
 	/* require filename */
-	if (argc != 2) {
-		g_print ("USAGE: %s <filename>\n", argv[0]);
+	if (argc != 2 && argc != 3) {
+		g_print ("USAGE: %s <filename> [max-parallel]\n", argv[0]);
 		return 1;
 	}
+	if (argc == 3) {
+		max_parallel = g_ascii_strtoull (argv[2], NULL, 10);
+		if (max_parallel == 0) {
+			g_print ("Invalid max-parallel value %s\n", argv[2]);
+			return 1;
+		}
+	}
 
-	/* get the device */
+	/* get all supported devices */
 	usb_ctx = g_usb_context_new (&error);
 	if (usb_ctx == NULL) {
 		g_print ("Failed to open USB devices: %s\n", error->message);
@@ -62,57 +104,34 @@ main (int argc, char **argv)
 	}
 	g_usb_context_enumerate (usb_ctx);
 	devices = g_usb_context_get_devices (usb_ctx);
+	devs = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	for (i = 0; i < devices->len; i++) {
 		GUsbDevice *usb_dev_tmp = g_ptr_array_index (devices, i);
-		g_autoptr(FuDeviceEbitdo) dev_tmp = fu_device_ebitdo_new (usb_dev_tmp);
-		if (dev_tmp != NULL) {
-			dev = g_object_ref (dev_tmp);
-			break;
-		}
+		FuDeviceEbitdo *dev_tmp = fu_device_ebitdo_new (usb_dev_tmp);
+		if (dev_tmp == NULL)
+			continue;
+		fu_device_set_id (FU_DEVICE (dev_tmp),
+				  g_usb_device_get_platform_id (usb_dev_tmp));
+		g_ptr_array_add (devs, dev_tmp);
 	}
 
 	/* nothing supported */
-	if (dev == NULL) {
+	if (devs->len == 0) {
 		g_print ("No supported device plugged in!\n");
 		return 1;
 	}
 
-	/* open device */
-	if (!fu_device_ebitdo_open (dev, &error)) {
-		g_print ("Failed to open USB device: %s\n", error->message);
-		return 1;
+	/* flash everything already in bootloader mode */
+	for (i = 0; i < devs->len; i++) {
+		FuDeviceEbitdo *dev_tmp = g_ptr_array_index (devs, i);
+		if (fu_device_ebitdo_get_kind (dev_tmp) ==
+		    FU_DEVICE_EBITDO_KIND_BOOTLOADER)
+			fu_ebitdo_batch_add_device (batch, dev_tmp);
 	}
-	g_print ("Device Firmware Ver: %s\n",
-		 fu_device_get_version (FU_DEVICE (dev)));
-	g_print ("Device Verification ID:\n");
-	for (i = 0; i < 9; i++)
-		g_print ("\t%u = 0x%08x\n", i, fu_device_ebitdo_get_serial(dev)[i]);
 
 	/* not in bootloader mode, so print what to do */
-	if (!fu_device_has_flag (dev, FWUPD_DEVICE_FLAG_NEEDS_BOOTLOADER)) {
-		g_print ("1. Disconnect the controller\n");
-		switch (fu_device_ebitdo_get_kind (dev)) {
-		case FU_DEVICE_EBITDO_KIND_FC30:
-		case FU_DEVICE_EBITDO_KIND_NES30:
-		case FU_DEVICE_EBITDO_KIND_SFC30:
-		case FU_DEVICE_EBITDO_KIND_SNES30:
-			g_print ("2. Hold down L+R+START for 3 seconds until "
-				 "both LED lights flashing.\n");
-			break;
-		case FU_DEVICE_EBITDO_KIND_FC30PRO:
-		case FU_DEVICE_EBITDO_KIND_NES30PRO:
-			g_print ("2. Hold down RETURN+POWER for 3 seconds until "
-				 "both LED lights flashing.\n");
-			break;
-		case FU_DEVICE_EBITDO_KIND_FC30_ARCADE:
-			g_print ("2. Hold down L1+R1+HOME for 3 seconds until "
-				 "both blue LED and green LED blink.\n");
-			break;
-		default:
-			g_print ("2. Do what it says in the manual.\n");
-			break;
-		}
-		g_print ("3. Connect controller\n");
+	if (fu_ebitdo_batch_get_device_count (batch) == 0) {
+		fu_ebitdo_print_bootloader_steps (g_ptr_array_index (devs, 0));
 		return 1;
 	}
 
@@ -122,23 +141,31 @@ main (int argc, char **argv)
 		return 1;
 	}
 
-	/* update with data blob */
+	/* update all the controllers in parallel sessions */
 	fw = g_bytes_new (data, len);
-	if (!fu_device_ebitdo_write_firmware (dev, fw,
-					      fu_ebitdo_write_progress_cb, NULL,
-					      &error)) {
-		g_print ("Failed to write firmware: %s\n", error->message);
-		return 1;
-	}
-
-	/* close device */
-	if (!fu_device_ebitdo_close (dev, &error)) {
-		g_print ("Failed to close USB device: %s\n", error->message);
+	fu_ebitdo_batch_set_max_parallel (batch, (guint) max_parallel);
+	g_print ("Updating %u controller(s), %u at a time\n",
+		 fu_ebitdo_batch_get_device_count (batch),
+		 (guint) max_parallel);
+	if (!fu_ebitdo_batch_write_firmware (batch, fw,
+					     fu_ebitdo_write_progress_cb, NULL,
+					     &error)) {
+		for (i = 0; i < devs->len; i++) {
+			FuDeviceEbitdo *dev_tmp = g_ptr_array_index (devs, i);
+			const GError *error_dev;
+			error_dev = fu_ebitdo_batch_get_device_error (batch, dev_tmp);
+			if (error_dev != NULL) {
+				g_print ("[%s] Failed to write firmware: %s\n",
+					 fu_device_get_id (FU_DEVICE (dev_tmp)),
+					 error_dev->message);
+			}
+		}
+		g_print ("%s\n", error->message);
 		return 1;
 	}
 
 	/* success */
-	g_print ("Now turn off the controller with the power button.\n");
+	g_print ("Now turn off the controller(s) with the power button.\n");
 
 	return 0;
 }
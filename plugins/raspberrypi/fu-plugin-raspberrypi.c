@@ -21,10 +21,17 @@
 
 #include "config.h"
 
+/* for syncfs() */
+#define _GNU_SOURCE
+
 #include <appstream-glib.h>
 #include <archive_entry.h>
 #include <archive.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <glib/gstdio.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "fu-plugin.h"
 #include "fu-plugin-vfuncs.h"
@@ -32,6 +39,10 @@
 
 #define FU_PLUGIN_RPI_FIRMWARE_FILENAME		"start.elf"
 
+/* a multiple of every common SD card erase block, so the FAT driver sees
+ * large aligned requests instead of the decompressor's small chunks */
+#define FU_PLUGIN_RPI_WRITE_BLOCK_SZ		(512 * 1024)
+
 struct FuPluginData {
 	gchar			*fw_dir;
 };
@@ -144,19 +155,118 @@ fu_plugin_raspberrypi_parse_firmware (FuDevice *device, const gchar *fn, GError
 }
 
 static gboolean
-fu_plugin_raspberrypi_explode_file (struct archive_entry *entry, const gchar *dir)
+fu_plugin_raspberrypi_write_all (gint fd, const guint8 *buf, gsize bufsz,
+				 const gchar *path, GError **error)
 {
-	const gchar *tmp;
-	g_autofree gchar *buf = NULL;
+	gsize idx = 0;
+	while (idx < bufsz) {
+		gssize rc = write (fd, buf + idx, bufsz - idx);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_WRITE,
+				     "Cannot write %s: %s",
+				     path, g_strerror (errno));
+			return FALSE;
+		}
+		idx += (gsize) rc;
+	}
+	return TRUE;
+}
+
+/* stream one archive member straight to the boot partition; the data never
+ * collects in memory and hits the card in whole aligned blocks */
+static gboolean
+fu_plugin_raspberrypi_write_entry (struct archive *arch,
+				   struct archive_entry *entry,
+				   const gchar *fw_dir,
+				   guint8 *buf,
+				   GError **error)
+{
+	const gchar *fn = archive_entry_pathname (entry);
+	gint fd;
+	g_autofree gchar *parent = NULL;
+	g_autofree gchar *path = NULL;
 
 	/* no output file */
-	if (archive_entry_pathname (entry) == NULL)
+	if (fn == NULL)
+		return TRUE;
+	path = g_build_filename (fw_dir, fn, NULL);
+
+	/* directories just have to exist */
+	if (archive_entry_filetype (entry) == AE_IFDIR) {
+		if (g_mkdir_with_parents (path, 0755) != 0) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_WRITE,
+				     "Cannot create %s: %s",
+				     path, g_strerror (errno));
+			return FALSE;
+		}
+		return TRUE;
+	}
+
+	/* a tarball does not have to carry the directory members */
+	parent = g_path_get_dirname (path);
+	if (g_mkdir_with_parents (parent, 0755) != 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_WRITE,
+			     "Cannot create %s: %s",
+			     parent, g_strerror (errno));
 		return FALSE;
+	}
+	fd = g_open (path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_WRITE,
+			     "Cannot open %s: %s",
+			     path, g_strerror (errno));
+		return FALSE;
+	}
+	for (;;) {
+		gsize buflen = 0;
+
+		/* fill a whole block before writing */
+		while (buflen < FU_PLUGIN_RPI_WRITE_BLOCK_SZ) {
+			gssize rc = archive_read_data (arch, buf + buflen,
+						       FU_PLUGIN_RPI_WRITE_BLOCK_SZ - buflen);
+			if (rc < 0) {
+				g_set_error (error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_INTERNAL,
+					     "Cannot extract %s: %s",
+					     fn, archive_error_string (arch));
+				close (fd);
+				return FALSE;
+			}
+			if (rc == 0)
+				break;
+			buflen += (gsize) rc;
+		}
+		if (buflen == 0)
+			break;
+		if (!fu_plugin_raspberrypi_write_all (fd, buf, buflen,
+						      path, error)) {
+			close (fd);
+			return FALSE;
+		}
+		if (buflen < FU_PLUGIN_RPI_WRITE_BLOCK_SZ)
+			break;
+	}
 
-	/* update output path */
-	tmp = archive_entry_pathname (entry);
-	buf = g_build_filename (dir, tmp, NULL);
-	archive_entry_update_pathname_utf8 (entry, buf);
+	/* the flush barrier comes once at the very end of the update */
+	if (close (fd) < 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_WRITE,
+			     "Cannot close %s: %s",
+			     path, g_strerror (errno));
+		return FALSE;
+	}
 	return TRUE;
 }
 
@@ -169,13 +279,17 @@ fu_plugin_update_online (FuPlugin *plugin,
 {
 	FuPluginData *data = fu_plugin_get_data (plugin);
 	gboolean ret = TRUE;
-	gboolean valid;
+	guint entry_cnt = 0;
+	guint entry_idx = 0;
 	int r;
 	struct archive *arch = NULL;
 	struct archive_entry *entry;
+	gint dirfd = -1;
+	g_autofree guint8 *buf = NULL;
 	g_autofree gchar *fwfn = NULL;
 
-	/* decompress anything matching either glob */
+	/* count the members first so progress can be reported while
+	 * streaming; this only parses headers and skips all the data */
 	fu_plugin_set_status (plugin, FWUPD_STATUS_DECOMPRESSING);
 	arch = archive_read_new ();
 	archive_read_support_format_all (arch);
@@ -192,9 +306,7 @@ fu_plugin_update_online (FuPlugin *plugin,
 			     archive_error_string (arch));
 		goto out;
 	}
-	fu_plugin_set_status (plugin, FWUPD_STATUS_DEVICE_WRITE);
 	for (;;) {
-		g_autofree gchar *path = NULL;
 		r = archive_read_next_header (arch, &entry);
 		if (r == ARCHIVE_EOF)
 			break;
@@ -207,31 +319,93 @@ fu_plugin_update_online (FuPlugin *plugin,
 				     archive_error_string (arch));
 			goto out;
 		}
+		entry_cnt++;
+		archive_read_data_skip (arch);
+	}
+	archive_read_close (arch);
+	archive_read_free (arch);
 
-		/* only extract if valid */
-		valid = fu_plugin_raspberrypi_explode_file (entry, data->fw_dir);
-		if (!valid)
-			continue;
-		r = archive_read_extract (arch, entry, 0);
+	/* stream each member straight to the boot partition */
+	arch = archive_read_new ();
+	archive_read_support_format_all (arch);
+	archive_read_support_filter_all (arch);
+	r = archive_read_open_memory (arch,
+				      (void *) g_bytes_get_data (blob_fw, NULL),
+				      (size_t) g_bytes_get_size (blob_fw));
+	if (r) {
+		ret = FALSE;
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INTERNAL,
+			     "Cannot open: %s",
+			     archive_error_string (arch));
+		goto out;
+	}
+	buf = g_malloc (FU_PLUGIN_RPI_WRITE_BLOCK_SZ);
+	fu_plugin_set_status (plugin, FWUPD_STATUS_DEVICE_WRITE);
+	for (;;) {
+		r = archive_read_next_header (arch, &entry);
+		if (r == ARCHIVE_EOF)
+			break;
 		if (r != ARCHIVE_OK) {
 			ret = FALSE;
 			g_set_error (error,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_INTERNAL,
-				     "Cannot extract: %s",
+				     "Cannot read header: %s",
 				     archive_error_string (arch));
 			goto out;
 		}
+		if (!fu_plugin_raspberrypi_write_entry (arch, entry,
+							data->fw_dir,
+							buf, error)) {
+			ret = FALSE;
+			goto out;
+		}
+		if (entry_cnt > 0) {
+			fu_plugin_set_percentage (plugin,
+						  ++entry_idx * 100 / entry_cnt);
+		}
 	}
 
+	/* one flush barrier for the whole update rather than letting the
+	 * FAT driver order every small metadata write individually */
+	dirfd = g_open (data->fw_dir, O_RDONLY | O_DIRECTORY, 0);
+	if (dirfd < 0) {
+		ret = FALSE;
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_WRITE,
+			     "Cannot open %s: %s",
+			     data->fw_dir, g_strerror (errno));
+		goto out;
+	}
+#ifdef __GLIBC__
+	if (syncfs (dirfd) < 0) {
+		ret = FALSE;
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_WRITE,
+			     "Cannot sync %s: %s",
+			     data->fw_dir, g_strerror (errno));
+		goto out;
+	}
+#else
+	sync ();
+#endif
+
 	/* get the new VC build info */
 	fu_plugin_set_status (plugin, FWUPD_STATUS_DEVICE_VERIFY);
 	fwfn = g_build_filename (data->fw_dir,
 				 FU_PLUGIN_RPI_FIRMWARE_FILENAME,
 				 NULL);
-	if (!fu_plugin_raspberrypi_parse_firmware (device, fwfn, error))
-		return FALSE;
+	if (!fu_plugin_raspberrypi_parse_firmware (device, fwfn, error)) {
+		ret = FALSE;
+		goto out;
+	}
 out:
+	if (dirfd >= 0)
+		close (dirfd);
 	if (arch != NULL) {
 		archive_read_close (arch);
 		archive_read_free (arch);
@@ -29,16 +29,93 @@
 
 #define STEELSERIES_TRANSACTION_TIMEOUT		1000 /* ms */
 
+static gchar *
+fu_plugin_steelseries_get_version (GUsbDevice *usb_device, GError **error)
+{
+	const guint8 iface_idx = 0x00;
+	gchar *version = NULL;
+	gsize actual_len = 0;
+	guint8 data[32];
+	g_autoptr(GError) error_local = NULL;
+
+	/* get exclusive access */
+	if (!g_usb_device_open (usb_device, error))
+		return NULL;
+	if (!g_usb_device_claim_interface (usb_device, iface_idx,
+					   G_USB_DEVICE_CLAIM_INTERFACE_BIND_KERNEL_DRIVER,
+					   error)) {
+		g_prefix_error (error, "failed to claim interface: ");
+		g_usb_device_close (usb_device, NULL);
+		return NULL;
+	}
+
+	/* one exchange identifies the device: send the info request, then
+	 * block on the interrupt endpoint until the firmware posts the
+	 * combined report -- no fixed delays are required */
+	memset (data, 0x00, sizeof(data));
+	data[0] = 0x16;
+	if (!g_usb_device_control_transfer (usb_device,
+					    G_USB_DEVICE_DIRECTION_HOST_TO_DEVICE,
+					    G_USB_DEVICE_REQUEST_TYPE_CLASS,
+					    G_USB_DEVICE_RECIPIENT_INTERFACE,
+					    0x09,
+					    0x0200,
+					    0x0000,
+					    data,
+					    sizeof(data),
+					    &actual_len,
+					    STEELSERIES_TRANSACTION_TIMEOUT,
+					    NULL,
+					    error)) {
+		g_prefix_error (error, "failed to do control transfer: ");
+		goto out;
+	}
+	if (actual_len != 32) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_INVALID_DATA,
+			     "only wrote %" G_GSIZE_FORMAT " bytes",
+			     actual_len);
+		goto out;
+	}
+	if (!g_usb_device_interrupt_transfer (usb_device,
+					      0x81, /* EP1 IN */
+					      data,
+					      sizeof(data),
+					      &actual_len,
+					      STEELSERIES_TRANSACTION_TIMEOUT,
+					      NULL,
+					      error)) {
+		g_prefix_error (error, "failed to do EP1 transfer: ");
+		goto out;
+	}
+	if (actual_len != 32) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_INVALID_DATA,
+			     "only read %" G_GSIZE_FORMAT " bytes",
+			     actual_len);
+		goto out;
+	}
+	version = g_strdup_printf ("%i.%i.%i",
+				   data[0], data[1], data[2]);
+out:
+	/* release the device even when the exchange failed */
+	if (!g_usb_device_release_interface (usb_device, iface_idx,
+					     G_USB_DEVICE_CLAIM_INTERFACE_BIND_KERNEL_DRIVER,
+					     &error_local))
+		g_warning ("failed to release interface: %s", error_local->message);
+	if (!g_usb_device_close (usb_device, NULL))
+		g_debug ("failed to close device");
+	return version;
+}
+
 static void
 fu_plugin_steelseries_device_added_cb (GUsbContext *ctx,
 				       GUsbDevice *usb_device,
 				       FuPlugin *plugin)
 {
 	const gchar *platform_id = NULL;
-	const guint8 iface_idx = 0x00;
-	gboolean ret;
-	gsize actual_len = 0;
-	guint8 data[32];
 	g_autofree gchar *devid1 = NULL;
 	g_autofree gchar *version = NULL;
 	g_autoptr(AsProfile) profile = as_profile_new ();
@@ -66,60 +143,10 @@ fu_plugin_steelseries_device_added_cb (GUsbContext *ctx,
 		return;
 	}
 
-	/* get exclusive access */
-	if (!g_usb_device_open (usb_device, &error_local)) {
-		g_warning ("failed to open device: %s", error_local->message);
-		return;
-	}
-	if (!g_usb_device_claim_interface (usb_device, iface_idx,
-					   G_USB_DEVICE_CLAIM_INTERFACE_BIND_KERNEL_DRIVER,
-					   &error_local)) {
-		g_warning ("failed to claim interface: %s", error_local->message);
-		g_usb_device_close (usb_device, NULL);
-		return;
-	}
-
 	/* get firmware version on SteelSeries Rival 100 */
-	memset (data, 0x00, sizeof(data));
-	data[0] = 0x16;
-	ret = g_usb_device_control_transfer (usb_device,
-					     G_USB_DEVICE_DIRECTION_HOST_TO_DEVICE,
-					     G_USB_DEVICE_REQUEST_TYPE_CLASS,
-					     G_USB_DEVICE_RECIPIENT_INTERFACE,
-					     0x09,
-					     0x0200,
-					     0x0000,
-					     data,
-					     sizeof(data),
-					     &actual_len,
-					     STEELSERIES_TRANSACTION_TIMEOUT,
-					     NULL,
-					     &error_local);
-	if (!ret) {
-		g_warning ("failed to go control transfer: %s", error_local->message);
-		g_usb_device_close (usb_device, NULL);
-		return;
-	}
-	if (actual_len != 32) {
-		g_warning ("only wrote %" G_GSIZE_FORMAT "bytes", actual_len);
-		return;
-	}
-	ret = g_usb_device_interrupt_transfer (usb_device,
-					       0x81, /* EP1 IN */
-					       data,
-					       sizeof(data),
-					       &actual_len,
-					       STEELSERIES_TRANSACTION_TIMEOUT,
-					       NULL,
-					       &error_local);
-	if (!ret) {
-		g_warning ("failed to do EP1 transfer: %s", error_local->message);
-		g_usb_device_close (usb_device, NULL);
-		return;
-	}
-	if (actual_len != 32) {
-		g_warning ("only read %" G_GSIZE_FORMAT "bytes", actual_len);
-		g_usb_device_close (usb_device, NULL);
+	version = fu_plugin_steelseries_get_version (usb_device, &error_local);
+	if (version == NULL) {
+		g_warning ("failed to get version: %s", error_local->message);
 		return;
 	}
 
@@ -127,8 +154,6 @@ fu_plugin_steelseries_device_added_cb (GUsbContext *ctx,
 	dev = fu_device_new ();
 	fu_device_set_id (dev, platform_id);
 	fu_device_set_name (dev, "SteelSeries Rival 100");
-	version = g_strdup_printf ("%i.%i.%i",
-				   data[0], data[1], data[2]);
 	fu_device_set_version (dev, version);
 
 	/* use the USB VID:PID hash */
@@ -136,17 +161,6 @@ fu_plugin_steelseries_device_added_cb (GUsbContext *ctx,
 				  g_usb_device_get_vid (usb_device),
 				  g_usb_device_get_pid (usb_device));
 	fu_device_add_guid (dev, devid1);
-
-	/* we're done here */
-	if (!g_usb_device_release_interface (usb_device, iface_idx,
-					     G_USB_DEVICE_CLAIM_INTERFACE_BIND_KERNEL_DRIVER,
-					     &error_local)) {
-		g_warning ("failed to release interface: %s", error_local->message);
-		g_usb_device_close (usb_device, NULL);
-		return;
-	}
-	if (!g_usb_device_close (usb_device, &error_local))
-		g_debug ("Failed to close: %s", error_local->message);
 	fu_plugin_device_add (plugin, dev);
 	fu_plugin_cache_add (plugin, platform_id, dev);
 }
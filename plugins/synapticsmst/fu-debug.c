@@ -0,0 +1 @@
+../../src/fu-debug.c
\ No newline at end of file
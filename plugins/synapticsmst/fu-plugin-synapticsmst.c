@@ -268,6 +268,18 @@ fu_plugin_synapticsmst_enumerate (FuPlugin *plugin,
 	return TRUE;
 }
 
+static gboolean
+fu_synapticsmst_device_awake_cb (gpointer user_data)
+{
+	SynapticsMSTDevice *device = SYNAPTICSMST_DEVICE (user_data);
+	g_autoptr(GError) error_local = NULL;
+	if (!synapticsmst_device_open_session (device, &error_local)) {
+		g_debug ("MST hub not awake yet: %s", error_local->message);
+		return FALSE;
+	}
+	return TRUE;
+}
+
 static void
 fu_synapticsmst_write_progress_cb (goffset current, goffset total, gpointer user_data)
 {
@@ -304,13 +316,19 @@ fu_plugin_update_online (FuPlugin *plugin,
 	rad = g_ascii_strtoull (split[4], NULL, 0);
 
 
-	/* sleep to allow device wakeup to complete */
-	g_debug ("waiting %d seconds for MST hub wakeup",
-		 SYNAPTICS_FLASH_MODE_DELAY);
-	g_usleep (SYNAPTICS_FLASH_MODE_DELAY * 1000000);
-
 	device = synapticsmst_device_new (kind, aux_node, layer, rad);
 
+	/* keep one session open across enumerate, flash and re-enumerate
+	 * rather than walking the remote control chain for each phase;
+	 * wait for the device wakeup by retrying the open so the wait ends
+	 * as soon as the hub responds rather than sleeping worst-case */
+	if (!fu_plugin_wait_for_condition (plugin,
+					   SYNAPTICS_FLASH_MODE_DELAY * 1000,
+					   fu_synapticsmst_device_awake_cb,
+					   device,
+					   error))
+		return FALSE;
+
 	if (!synapticsmst_device_enumerate_device (device, error))
 		return FALSE;
 	if (synapticsmst_device_board_id_to_string (synapticsmst_device_get_board_id (device)) != NULL) {
@@ -337,7 +355,7 @@ fu_plugin_update_online (FuPlugin *plugin,
 	}
 	fu_device_set_version (dev, synapticsmst_device_get_version (device));
 
-	return TRUE;
+	return synapticsmst_device_close_session (device, error);
 }
 
 static void
@@ -355,6 +373,9 @@ fu_plugin_synapticsmst_redo_enumeration_cb (GUsbContext *ctx,
 	if (vid != DOCK_NIC_VID || pid != DOCK_NIC_PID)
 		return;
 
+	/* the aux topology just changed, so don't trust pooled handles */
+	synapticsmst_device_fd_cache_clear ();
+
 	/* Request daemon to redo coldplug, this wakes up Dell devices */
 	fu_plugin_recoldplug (plugin);
 }
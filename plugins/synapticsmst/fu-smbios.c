@@ -0,0 +1 @@
+../../src/fu-smbios.c
\ No newline at end of file
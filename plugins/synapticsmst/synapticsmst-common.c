@@ -103,6 +103,35 @@ synapticsmst_common_read_dpcd (SynapticsMSTConnection *connection,
 	return synapticsmst_common_aux_node_read (connection, offset, buf, length);
 }
 
+/* a native AUX transaction carries at most 16 bytes */
+#define AUX_MAX_TRANSFER_SIZE	16
+
+guint8
+synapticsmst_common_read_dpcd_block (SynapticsMSTConnection *connection,
+				     gint offset,
+				     gint *buf,
+				     gint length)
+{
+	guint8 *buf8 = (guint8 *) buf;
+
+	/* coalesce the whole register range into the fewest maximal
+	 * transfers rather than issuing one ~1ms transaction per register */
+	while (length > 0) {
+		gint cur_length = length;
+		guint8 rc;
+		if (cur_length > AUX_MAX_TRANSFER_SIZE)
+			cur_length = AUX_MAX_TRANSFER_SIZE;
+		rc = synapticsmst_common_read_dpcd (connection, offset,
+						    (gint *) buf8, cur_length);
+		if (rc)
+			return rc;
+		offset += cur_length;
+		buf8 += cur_length;
+		length -= cur_length;
+	}
+	return DPCD_SUCCESS;
+}
+
 guint8
 synapticsmst_common_write_dpcd (SynapticsMSTConnection *connection,
 				gint offset,
@@ -204,6 +233,101 @@ synapticsmst_common_rc_set_command (SynapticsMSTConnection *connection,
 	return rc;
 }
 
+/* Like synapticsmst_common_rc_set_command(), but transfers the next
+ * unit into the RC data window while the hub is still committing the
+ * previous one. The RC engine copies the window when the command byte
+ * is written, so the mailbox is free for the next payload during the
+ * EEPROM commit wait instead of the channel going idle. */
+guint8
+synapticsmst_common_rc_set_command_pipelined (SynapticsMSTConnection *connection,
+					      gint rc_cmd,
+					      gint length,
+					      gint offset,
+					      const guint8 *buf)
+{
+	guint8 rc = 0;
+	gint cur_offset = offset;
+	gint cur_length;
+	gint data_left = length;
+	gint cmd;
+	gint readData = 0;
+	long deadline;
+	struct timespec t_spec;
+
+	/* stage the first unit */
+	cur_length = data_left > UNIT_SIZE ? UNIT_SIZE : data_left;
+	rc = synapticsmst_common_write_dpcd (connection, REG_RC_DATA,
+					     (gint *)buf, cur_length);
+	if (rc)
+		return rc;
+
+	while (data_left) {
+		gint next_length = data_left - cur_length;
+		if (next_length > UNIT_SIZE)
+			next_length = UNIT_SIZE;
+
+		/* write offset */
+		rc = synapticsmst_common_write_dpcd (connection,
+						     REG_RC_OFFSET,
+						     &cur_offset, 4);
+		if (rc)
+			break;
+
+		/* write length */
+		rc = synapticsmst_common_write_dpcd (connection,
+						     REG_RC_LEN,
+						     &cur_length, 4);
+		if (rc)
+			break;
+
+		/* send command */
+		cmd = 0x80 | rc_cmd;
+		rc = synapticsmst_common_write_dpcd (connection,
+						     REG_RC_CMD,
+						     &cmd, 1);
+		if (rc)
+			break;
+
+		/* stage the next unit while the hub commits this one */
+		if (next_length > 0) {
+			rc = synapticsmst_common_write_dpcd (connection,
+							     REG_RC_DATA,
+							     (gint *)(buf + cur_length),
+							     next_length);
+			if (rc)
+				break;
+		}
+
+		/* wait command complete */
+		clock_gettime (CLOCK_REALTIME, &t_spec);
+		deadline = t_spec.tv_sec + MAX_WAIT_TIME;
+
+		do {
+			rc = synapticsmst_common_read_dpcd (connection,
+							    REG_RC_CMD,
+							    &readData, 2);
+			clock_gettime (CLOCK_REALTIME, &t_spec);
+			if (t_spec.tv_sec > deadline) {
+				rc = -1;
+			}
+		} while (rc == 0 && readData & 0x80);
+
+		if (rc)
+			break;
+		else if (readData & 0xFF00) {
+			rc = (readData >> 8) & 0xFF;
+			break;
+		}
+
+		buf += cur_length;
+		cur_offset += cur_length;
+		data_left -= cur_length;
+		cur_length = next_length;
+	}
+
+	return rc;
+}
+
 guint8
 synapticsmst_common_rc_get_command (SynapticsMSTConnection *connection,
 				    gint rc_cmd,
@@ -289,6 +413,112 @@ synapticsmst_common_rc_get_command (SynapticsMSTConnection *connection,
 	return rc;
 }
 
+/* Like synapticsmst_common_rc_get_command(), but keeps the next read
+ * window in flight while the previous one is being consumed. The RC
+ * engine only fills the data window when a command completes, so after
+ * the completion poll the next command can be issued immediately and
+ * the payload read out of the mailbox while the hub is already
+ * fetching the following window from EEPROM. The access pattern has to
+ * be strictly sequential, which EEPROM dump and verify both are. */
+guint8
+synapticsmst_common_rc_get_command_pipelined (SynapticsMSTConnection *connection,
+					      gint rc_cmd,
+					      gint length,
+					      gint offset,
+					      guint8 *buf)
+{
+	guint8 rc = 0;
+	gint cur_offset = offset;
+	gint cur_length;
+	gint data_need = length;
+	gint cmd;
+	gint readData = 0;
+	long deadline;
+	struct timespec t_spec;
+
+	/* issue the first window */
+	cur_length = data_need > UNIT_SIZE ? UNIT_SIZE : data_need;
+	rc = synapticsmst_common_write_dpcd (connection,
+					     REG_RC_OFFSET,
+					     &cur_offset, 4);
+	if (rc)
+		return rc;
+	rc = synapticsmst_common_write_dpcd (connection,
+					     REG_RC_LEN,
+					     &cur_length, 4);
+	if (rc)
+		return rc;
+	cmd = 0x80 | rc_cmd;
+	rc = synapticsmst_common_write_dpcd (connection,
+					     REG_RC_CMD,
+					     &cmd, 1);
+	if (rc)
+		return rc;
+
+	while (data_need) {
+		gint next_offset = cur_offset + cur_length;
+		gint next_length = data_need - cur_length;
+		if (next_length > UNIT_SIZE)
+			next_length = UNIT_SIZE;
+
+		/* wait command complete */
+		clock_gettime (CLOCK_REALTIME, &t_spec);
+		deadline = t_spec.tv_sec + MAX_WAIT_TIME;
+
+		do {
+			rc = synapticsmst_common_read_dpcd (connection,
+							    REG_RC_CMD,
+							    &readData, 2);
+			clock_gettime (CLOCK_REALTIME, &t_spec);
+			if (t_spec.tv_sec > deadline) {
+				rc = -1;
+			}
+		} while (rc == 0 && readData & 0x80);
+
+		if (rc)
+			break;
+		else if (readData & 0xFF00) {
+			rc = (readData >> 8) & 0xFF;
+			break;
+		}
+
+		/* put the next window in flight before consuming this one */
+		if (next_length > 0) {
+			rc = synapticsmst_common_write_dpcd (connection,
+							     REG_RC_OFFSET,
+							     &next_offset, 4);
+			if (rc)
+				break;
+			rc = synapticsmst_common_write_dpcd (connection,
+							     REG_RC_LEN,
+							     &next_length, 4);
+			if (rc)
+				break;
+			cmd = 0x80 | rc_cmd;
+			rc = synapticsmst_common_write_dpcd (connection,
+							     REG_RC_CMD,
+							     &cmd, 1);
+			if (rc)
+				break;
+		}
+
+		/* read the completed window from the mailbox */
+		rc = synapticsmst_common_read_dpcd (connection,
+						    REG_RC_DATA,
+						    (gint *)buf,
+						    cur_length);
+		if (rc)
+			break;
+
+		buf += cur_length;
+		cur_offset += cur_length;
+		data_need -= cur_length;
+		cur_length = next_length;
+	}
+
+	return rc;
+}
+
 guint8
 synapticsmst_common_rc_special_get_command (SynapticsMSTConnection *connection,
 					    gint rc_cmd,
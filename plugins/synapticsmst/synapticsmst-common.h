@@ -89,6 +89,11 @@ guint8		 synapticsmst_common_read_dpcd 			(SynapticsMSTConnection *connection,
 								 gint	*buf,
 								 gint	 length);
 
+guint8		 synapticsmst_common_read_dpcd_block		(SynapticsMSTConnection *connection,
+								 gint	 offset,
+								 gint	*buf,
+								 gint	 length);
+
 guint8		 synapticsmst_common_write_dpcd 		(SynapticsMSTConnection *connection,
 								 gint	 offset,
 								 const gint *buf,
@@ -100,12 +105,24 @@ guint8		 synapticsmst_common_rc_set_command 		(SynapticsMSTConnection *connectio
 								 gint	 offset,
 								 const guint8	*buf);
 
+guint8		 synapticsmst_common_rc_set_command_pipelined	(SynapticsMSTConnection *connection,
+								 gint	 rc_cmd,
+								 gint	 length,
+								 gint	 offset,
+								 const guint8	*buf);
+
 guint8		 synapticsmst_common_rc_get_command 		(SynapticsMSTConnection *connection,
 								 gint	 rc_cmd,
 								 gint	 length,
 								 gint	 offset,
 								 guint8	*buf);
 
+guint8		 synapticsmst_common_rc_get_command_pipelined	(SynapticsMSTConnection *connection,
+									 gint	 rc_cmd,
+									 gint	 length,
+									 gint	 offset,
+									 guint8	*buf);
+
 guint8		 synapticsmst_common_rc_special_get_command	(SynapticsMSTConnection *connection,
 								 gint	 rc_cmd,
 								 gint	 cmd_length,
@@ -32,6 +32,9 @@
 #include "synapticsmst-common.h"
 
 #define BLOCK_UNIT		64
+/* with pipelined writes the commit wait overlaps the next transfer, so
+ * larger blocks just mean fewer stalls between them */
+#define BLOCK_UNIT_PIPELINED	1024
 
 typedef struct
 {
@@ -47,12 +50,66 @@ typedef struct
 	gboolean		has_cascade;
 	gchar			*fw_dir;
 	gboolean		test_mode;
+	gboolean		session_open;
 } SynapticsMSTDevicePrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (SynapticsMSTDevice, synapticsmst_device, G_TYPE_OBJECT)
 
 #define GET_PRIVATE(o) (synapticsmst_device_get_instance_private (o))
 
+/* the aux node handles are shared between the transient device objects
+ * and kept open for the lifetime of the plugin; each open costs a kernel
+ * AUX probe so re-opening around every operation is wasteful */
+static GHashTable *synapticsmst_device_fd_cache = NULL;	/* of path : fd */
+
+static gint
+synapticsmst_device_fd_cache_lookup (const gchar *filename)
+{
+	if (synapticsmst_device_fd_cache == NULL)
+		return 0;
+	return GPOINTER_TO_INT (g_hash_table_lookup (synapticsmst_device_fd_cache,
+						     filename));
+}
+
+static void
+synapticsmst_device_fd_cache_insert (const gchar *filename, gint fd)
+{
+	if (synapticsmst_device_fd_cache == NULL) {
+		synapticsmst_device_fd_cache =
+			g_hash_table_new_full (g_str_hash, g_str_equal,
+					       g_free, NULL);
+	}
+	g_hash_table_insert (synapticsmst_device_fd_cache,
+			     g_strdup (filename),
+			     GINT_TO_POINTER (fd));
+}
+
+static void
+synapticsmst_device_fd_cache_drop (const gchar *filename)
+{
+	gint fd;
+	if (synapticsmst_device_fd_cache == NULL)
+		return;
+	fd = GPOINTER_TO_INT (g_hash_table_lookup (synapticsmst_device_fd_cache,
+						   filename));
+	if (fd > 0)
+		close (fd);
+	g_hash_table_remove (synapticsmst_device_fd_cache, filename);
+}
+
+void
+synapticsmst_device_fd_cache_clear (void)
+{
+	GHashTableIter iter;
+	gpointer value;
+	if (synapticsmst_device_fd_cache == NULL)
+		return;
+	g_hash_table_iter_init (&iter, synapticsmst_device_fd_cache);
+	while (g_hash_table_iter_next (&iter, NULL, &value))
+		close (GPOINTER_TO_INT (value));
+	g_hash_table_remove_all (synapticsmst_device_fd_cache);
+}
+
 SynapticsMSTDeviceKind
 synapticsmst_device_kind_from_string (const gchar *kind)
 {
@@ -104,7 +161,8 @@ synapticsmst_device_finalize (GObject *object)
 	SynapticsMSTDevice *device = SYNAPTICSMST_DEVICE (object);
 	SynapticsMSTDevicePrivate *priv = GET_PRIVATE (device);
 
-	if (priv->fd > 0)
+	/* pooled handles outlive the device object */
+	if (priv->test_mode && priv->fd > 0)
 		close (priv->fd);
 
 	g_free (priv->fw_dir);
@@ -241,6 +299,40 @@ synapticsmst_device_disable_remote_control (SynapticsMSTDevice *device, GError *
 	}
 }
 
+/* Opening the aux node and walking the chain to enable remote control
+ * costs one RC command per layer, each of which is several AUX
+ * transactions plus a completion poll. A session keeps both alive so
+ * consecutive operations on the same device only pay that price once. */
+gboolean
+synapticsmst_device_open_session (SynapticsMSTDevice *device, GError **error)
+{
+	SynapticsMSTDevicePrivate *priv = GET_PRIVATE (device);
+
+	if (priv->session_open)
+		return TRUE;
+	if (!synapticsmst_device_open (device, error)) {
+		g_prefix_error (error,
+				"failed to open device in DP Aux Node %s: ",
+				synapticsmst_device_get_aux_node (device));
+		return FALSE;
+	}
+	if (!synapticsmst_device_enable_remote_control (device, error))
+		return FALSE;
+	priv->session_open = TRUE;
+	return TRUE;
+}
+
+gboolean
+synapticsmst_device_close_session (SynapticsMSTDevice *device, GError **error)
+{
+	SynapticsMSTDevicePrivate *priv = GET_PRIVATE (device);
+
+	if (!priv->session_open)
+		return TRUE;
+	priv->session_open = FALSE;
+	return synapticsmst_device_disable_remote_control (device, error);
+}
+
 gboolean
 synapticsmst_device_scan_cascade_device (SynapticsMSTDevice *device,
 					 GError ** error,
@@ -348,26 +440,23 @@ synapticsmst_device_enumerate_device (SynapticsMSTDevice *device, GError **error
 {
 	SynapticsMSTDevicePrivate *priv = GET_PRIVATE (device);
 	guint8 byte[16];
+	guint8 block[REG_FIRMWARE_VERSION + 3 - REG_VENDOR_ID];
+	gboolean close_session = !priv->session_open;
 	g_autofree gchar *system = NULL;
 	guint8 rc;
 	g_autoptr(SynapticsMSTConnection) connection = NULL;
 
 	//FIXME?
-	if (!synapticsmst_device_open (device, error)) {
-		g_prefix_error (error, "Failed to open device in DP Aux Node %s: ",
-				synapticsmst_device_get_aux_node (device));
+	if (!synapticsmst_device_open_session (device, error))
 		return FALSE;
-	}
 
-	/* enable remote control */
-	if (!synapticsmst_device_enable_remote_control (device, error))
-		return FALSE;
-
-	/* read firmware version */
+	/* prefetch the chip ID and firmware version in one AUX transfer
+	 * rather than issuing a transaction per register */
 	connection = synapticsmst_common_new (priv->fd, priv->layer, priv->rad);
-	rc = synapticsmst_common_read_dpcd (connection,
-					    REG_FIRMWARE_VERSION,
-					    (gint *)byte, 3);
+	rc = synapticsmst_common_read_dpcd_block (connection,
+						  REG_VENDOR_ID,
+						  (gint *)block,
+						  sizeof (block));
 	if (rc) {
 		g_set_error_literal (error,
 				     G_IO_ERROR,
@@ -375,26 +464,19 @@ synapticsmst_device_enumerate_device (SynapticsMSTDevice *device, GError **error
 				     "Failed to read dpcd from device");
 		return FALSE;
 	}
-	priv->version = g_strdup_printf ("%1d.%02d.%03d", byte[0], byte[1], byte[2]);
+	priv->version = g_strdup_printf ("%1d.%02d.%03d",
+					 block[REG_FIRMWARE_VERSION - REG_VENDOR_ID],
+					 block[REG_FIRMWARE_VERSION - REG_VENDOR_ID + 1],
+					 block[REG_FIRMWARE_VERSION - REG_VENDOR_ID + 2]);
+	priv->chip_id = g_strdup_printf ("VMM%02x%02x",
+					 block[REG_CHIP_ID - REG_VENDOR_ID],
+					 block[REG_CHIP_ID - REG_VENDOR_ID + 1]);
 
 	/* read board ID */
 	if (!synapticsmst_device_read_board_id (device, connection, byte, error))
 		return FALSE;
 	priv->board_id = (byte[0] << 8) | (byte[1]);
 
-	/* read board chip_id */
-	rc = synapticsmst_common_read_dpcd (connection,
-					    REG_CHIP_ID,
-					    (gint *)byte, 2);
-	if (rc) {
-		g_set_error_literal (error,
-				     G_IO_ERROR,
-				     G_IO_ERROR_INVALID_DATA,
-				     "Failed to read dpcd from device");
-		return FALSE;
-	}
-	priv->chip_id = g_strdup_printf ("VMM%02x%02x", byte[0], byte[1]);
-
 	switch (priv->board_id >> 8) {
 	/* only dell is supported for today */
 	case CUSTOMERID_DELL:
@@ -422,7 +504,8 @@ synapticsmst_device_enumerate_device (SynapticsMSTDevice *device, GError **error
 		break;
 	/* EVB development board */
 	case 0:
-		priv->board_id = (byte[0] << 8 | byte[1]);
+		priv->board_id = (block[REG_CHIP_ID - REG_VENDOR_ID] << 8 |
+				  block[REG_CHIP_ID - REG_VENDOR_ID + 1]);
 		break;
 	/* unknown */
 	default:
@@ -430,8 +513,9 @@ synapticsmst_device_enumerate_device (SynapticsMSTDevice *device, GError **error
 		priv->board_id = 0xFF;
 	}
 
-	/* disable remote control */
-	if (!synapticsmst_device_disable_remote_control (device, error))
+	/* disable remote control unless part of a longer session */
+	if (close_session &&
+	    !synapticsmst_device_close_session (device, error))
 		return FALSE;
 
 	return TRUE;
@@ -523,6 +607,7 @@ synapticsmst_device_write_firmware (SynapticsMSTDevice *device,
 	guint16 tmp;
 	guint16 erase_code = 0xFFFF;
 	SynapticsMSTDevicePrivate *priv = GET_PRIVATE (device);
+	gboolean close_session = !priv->session_open;
 	g_autoptr(SynapticsMSTConnection) connection = NULL;
 
 	/* get firmware data and check size */
@@ -619,15 +704,7 @@ synapticsmst_device_write_firmware (SynapticsMSTDevice *device,
 		return FALSE;
 	}
 
-	if (!synapticsmst_device_open (device, error)) {
-		g_prefix_error (error,
-				"can't open DP Aux node %s",
-				synapticsmst_device_get_aux_node (device));
-		return FALSE;
-	}
-
-	/* enable remote control */
-	if (!synapticsmst_device_enable_remote_control (device, error))
+	if (!synapticsmst_device_open_session (device, error))
 		return FALSE;
 
 	/* erase SPI flash */
@@ -643,32 +720,32 @@ synapticsmst_device_write_firmware (SynapticsMSTDevice *device,
 	}
 
 	/* update firmware */
-	write_loops = (payload_len / BLOCK_UNIT);
+	write_loops = (payload_len / BLOCK_UNIT_PIPELINED);
 	data_to_write = payload_len;
 	rc = 0;
 	offset = 0;
 
-	if (payload_len % BLOCK_UNIT)
+	if (payload_len % BLOCK_UNIT_PIPELINED)
 		write_loops++;
 
 	if (progress_cb == NULL)
 		g_debug ("updating... 0%%");
 
 	for (guint32 i = 0; i < write_loops; i++) {
-		guint8 length = BLOCK_UNIT;
-		if (data_to_write < BLOCK_UNIT)
+		guint32 length = BLOCK_UNIT_PIPELINED;
+		if (data_to_write < BLOCK_UNIT_PIPELINED)
 			length = data_to_write;
 
-		rc = synapticsmst_common_rc_set_command (connection,
-							 UPDC_WRITE_TO_EEPROM,
-							 length, offset,
-							 payload_data + offset);
+		rc = synapticsmst_common_rc_set_command_pipelined (connection,
+								   UPDC_WRITE_TO_EEPROM,
+								   length, offset,
+								   payload_data + offset);
 		if (rc) {
 			/* repeat once */
-			rc = synapticsmst_common_rc_set_command (connection,
-								 UPDC_WRITE_TO_EEPROM,
-								 length, offset,
-								 payload_data + offset);
+			rc = synapticsmst_common_rc_set_command_pipelined (connection,
+									   UPDC_WRITE_TO_EEPROM,
+									   length, offset,
+									   payload_data + offset);
 		}
 
 		if (rc)
@@ -676,10 +753,10 @@ synapticsmst_device_write_firmware (SynapticsMSTDevice *device,
 
 		offset += length;
 		data_to_write -= length;
-		percentage = i * 100 / (write_loops - 1);
+		percentage = (i + 1) * 100 / write_loops;
 		if (progress_cb != NULL) {
-			progress_cb ((goffset) i * 100,
-				     (goffset) (write_loops -1) * 100,
+			progress_cb ((goffset) (i + 1) * 100,
+				     (goffset) write_loops * 100,
 				     progress_data);
 		} else {
 			g_debug ("updating... %d%%\n", percentage);
@@ -718,8 +795,9 @@ synapticsmst_device_write_firmware (SynapticsMSTDevice *device,
 
 	}
 
-	/* disable remote control and close aux node */
-	if (!synapticsmst_device_disable_remote_control (device, error))
+	/* disable remote control unless part of a longer session */
+	if (close_session &&
+	    !synapticsmst_device_close_session (device, error))
 		return FALSE;
 
 	if (rc) {
@@ -729,6 +807,58 @@ synapticsmst_device_write_firmware (SynapticsMSTDevice *device,
 	}
 }
 
+gboolean
+synapticsmst_device_dump_eeprom (SynapticsMSTDevice *device,
+				 guint8 *buf,
+				 guint32 length,
+				 GError **error)
+{
+	SynapticsMSTDevicePrivate *priv = GET_PRIVATE (device);
+	gboolean close_session = !priv->session_open;
+	guint8 rc;
+	g_autoptr(SynapticsMSTConnection) connection = NULL;
+
+	/* check size */
+	if (length > 0x10000 || length == 0) {
+		g_set_error_literal (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_INVALID_DATA,
+				     "EEPROM dump length invalid");
+		return FALSE;
+	}
+
+	/* enable remote control */
+	if (!synapticsmst_device_open_session (device, error))
+		return FALSE;
+
+	/* the dump is perfectly sequential, so read ahead: the next read
+	 * window stays in flight while the previous one is consumed */
+	connection = synapticsmst_common_new (priv->fd, priv->layer, priv->rad);
+	rc = synapticsmst_common_rc_get_command_pipelined (connection,
+							   UPDC_READ_FROM_EEPROM,
+							   length, 0, buf);
+	if (rc) {
+		/* fall back to the synchronous window-at-a-time path */
+		g_debug ("pipelined EEPROM read failed (%u), retrying synchronously", rc);
+		rc = synapticsmst_common_rc_get_command (connection,
+							 UPDC_READ_FROM_EEPROM,
+							 length, 0, buf);
+	}
+	if (rc) {
+		g_set_error_literal (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_INVALID_DATA,
+				     "Failed to read EEPROM from device");
+		return FALSE;
+	}
+
+	/* disable remote control unless part of a longer session */
+	if (close_session &&
+	    !synapticsmst_device_close_session (device, error))
+		return FALSE;
+	return TRUE;
+}
+
 SynapticsMSTDevice *
 synapticsmst_device_new (SynapticsMSTDeviceKind kind,
 			 const gchar *aux_node,
@@ -756,12 +886,15 @@ synapticsmst_device_open (SynapticsMSTDevice *device, GError **error)
 {
 	SynapticsMSTDevicePrivate *priv = GET_PRIVATE (device);
 	g_autofree gchar *filename = NULL;
+	gboolean cached = FALSE;
 	guint8 byte[4];
 	g_autoptr(SynapticsMSTConnection) connection = NULL;
 
 	/* file doesn't exist on this system */
 	filename = g_strdup_printf ("%s/%s", priv->fw_dir, priv->aux_node);
 	if (!g_file_test (filename, G_FILE_TEST_EXISTS)) {
+		if (!priv->test_mode)
+			synapticsmst_device_fd_cache_drop (filename);
 		g_set_error (error,
 			     G_IO_ERROR,
 			     G_IO_ERROR_NOT_FOUND,
@@ -770,15 +903,28 @@ synapticsmst_device_open (SynapticsMSTDevice *device, GError **error)
 		return FALSE;
 	}
 
+	/* reuse the pooled handle when there is one; the register check
+	 * below revalidates it, so a handle gone stale after a hotplug is
+	 * dropped rather than trusted; test mode juggles the node per
+	 * phase so it keeps a private handle */
+	if (!priv->test_mode)
+		priv->fd = synapticsmst_device_fd_cache_lookup (filename);
+	cached = priv->fd > 0;
+
 	/* can't open aux node, try use sudo to get the permission */
-	priv->fd = open (filename, O_RDWR);
-	if (priv->fd == -1) {
-		g_set_error (error,
-			     G_IO_ERROR,
-			     G_IO_ERROR_PERMISSION_DENIED,
-			     "cannot open device %s",
-			     filename);
-		return FALSE;
+	if (!cached) {
+		if (priv->test_mode && priv->fd > 0)
+			close (priv->fd);
+		priv->fd = open (filename, O_RDWR);
+		if (priv->fd == -1) {
+			priv->fd = 0;
+			g_set_error (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_PERMISSION_DENIED,
+				     "cannot open device %s",
+				     filename);
+			return FALSE;
+		}
 	}
 
 	connection = synapticsmst_common_new (priv->fd, 0, 0);
@@ -787,8 +933,13 @@ synapticsmst_device_open (SynapticsMSTDevice *device, GError **error)
 			synapticsmst_common_aux_node_read (connection,
 							   REG_VENDOR_ID,
 							   (gint *)byte, 3);
-			if (byte[0] == 0x90 && byte[1] == 0xCC && byte[2] == 0x24)
+			if (byte[0] == 0x90 && byte[1] == 0xCC && byte[2] == 0x24) {
+				if (!cached && !priv->test_mode) {
+					synapticsmst_device_fd_cache_insert (filename,
+									     priv->fd);
+				}
 				return TRUE;
+			}
 		}
 	}
 
@@ -797,7 +948,10 @@ synapticsmst_device_open (SynapticsMSTDevice *device, GError **error)
 			     G_IO_ERROR,
 			     G_IO_ERROR_INVALID_DATA,
 			     "no device");
-	close (priv->fd);
+	if (cached)
+		synapticsmst_device_fd_cache_drop (filename);
+	else
+		close (priv->fd);
 	priv->fd = 0;
 	return FALSE;
 }
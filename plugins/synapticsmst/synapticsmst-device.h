@@ -91,6 +91,11 @@ gboolean	 synapticsmst_device_scan_cascade_device 	(SynapticsMSTDevice *device,
 								 guint8 tx_port);
 gboolean	 synapticsmst_device_open 			(SynapticsMSTDevice *device,
 								 GError	**error);
+gboolean	 synapticsmst_device_open_session 		(SynapticsMSTDevice *device,
+								 GError	**error);
+gboolean	 synapticsmst_device_close_session 		(SynapticsMSTDevice *device,
+								 GError	**error);
+void		 synapticsmst_device_fd_cache_clear		(void);
 
 /* getters */
 SynapticsMSTDeviceKind synapticsmst_device_get_kind		(SynapticsMSTDevice *device);
@@ -111,6 +116,10 @@ gboolean	 synapticsmst_device_write_firmware		(SynapticsMSTDevice *device,
 								 GFileProgressCallback	progress_cb,
 								 gpointer user_data,
 								 GError	**error);
+gboolean	 synapticsmst_device_dump_eeprom		(SynapticsMSTDevice *device,
+								 guint8	*buf,
+								 guint32 length,
+								 GError	**error);
 
 G_END_DECLS
 
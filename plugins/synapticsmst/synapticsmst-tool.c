@@ -25,8 +25,12 @@
 #include "synapticsmst-common.h"
 #include "synapticsmst-device.h"
 
+#include <fcntl.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #include <glib/gi18n.h>
 #include <glib-unix.h>
 #include <libintl.h>
@@ -337,6 +341,126 @@ synapticsmst_tool_flash (SynapticsMSTToolPrivate *priv,
 	return TRUE;
 }
 
+/* the update payload is capped at 64KiB so dump the same amount */
+#define SYNAPTICSMST_EEPROM_DUMP_SIZE	0x10000
+
+typedef struct {
+	SynapticsMSTDevice	*device;
+	gchar			*filename;
+	GError			*error;
+	gboolean		 ret;
+} SynapticsMSTToolDumpHelper;
+
+static void
+synapticsmst_tool_dump_helper_free (SynapticsMSTToolDumpHelper *helper)
+{
+	g_object_unref (helper->device);
+	g_free (helper->filename);
+	if (helper->error != NULL)
+		g_error_free (helper->error);
+	g_free (helper);
+}
+
+static gpointer
+synapticsmst_tool_dump_thread_cb (gpointer user_data)
+{
+	SynapticsMSTToolDumpHelper *helper = (SynapticsMSTToolDumpHelper *) user_data;
+	gint fd;
+	guint8 *map;
+
+	/* pre-size the output file and map it so each register window is
+	 * written straight to the page cache as it arrives */
+	fd = open (helper->filename, O_CREAT | O_RDWR, 0644);
+	if (fd == -1) {
+		g_set_error (&helper->error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_FAILED,
+			     "cannot create %s", helper->filename);
+		return NULL;
+	}
+	if (ftruncate (fd, SYNAPTICSMST_EEPROM_DUMP_SIZE) != 0) {
+		g_set_error (&helper->error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_FAILED,
+			     "cannot resize %s", helper->filename);
+		close (fd);
+		return NULL;
+	}
+	map = mmap (NULL, SYNAPTICSMST_EEPROM_DUMP_SIZE,
+		    PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		g_set_error (&helper->error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_FAILED,
+			     "cannot map %s", helper->filename);
+		close (fd);
+		return NULL;
+	}
+	helper->ret = synapticsmst_device_dump_eeprom (helper->device,
+						       map,
+						       SYNAPTICSMST_EEPROM_DUMP_SIZE,
+						       &helper->error);
+	munmap (map, SYNAPTICSMST_EEPROM_DUMP_SIZE);
+	close (fd);
+	return NULL;
+}
+
+static gboolean
+synapticsmst_tool_dump (SynapticsMSTToolPrivate *priv,
+			gchar **values,
+			guint8 device_index,
+			GError **error)
+{
+	const gchar *prefix = "synapticsmst";
+	g_autoptr(GPtrArray) helpers = NULL;
+	g_autoptr(GPtrArray) threads = NULL;
+
+	if (g_strv_length (values) >= 1)
+		prefix = values[0];
+
+	/* check avaliable dp aux nodes and add devices */
+	if (!synapticsmst_tool_scan_aux_nodes (priv, error))
+		return FALSE;
+
+	/* each direct device has an independent aux node, so dump them all
+	 * at the same time; cascaded devices share the parent node and
+	 * cannot be read concurrently with it */
+	helpers = g_ptr_array_new_with_free_func ((GDestroyNotify) synapticsmst_tool_dump_helper_free);
+	threads = g_ptr_array_new ();
+	for (guint8 i = 0; i < priv->device_array->len; i++) {
+		SynapticsMSTDevice *device = g_ptr_array_index (priv->device_array, i);
+		SynapticsMSTToolDumpHelper *helper;
+		if (synapticsmst_device_get_kind (device) != SYNAPTICSMST_DEVICE_KIND_DIRECT)
+			continue;
+		helper = g_new0 (SynapticsMSTToolDumpHelper, 1);
+		helper->device = g_object_ref (device);
+		helper->filename = g_strdup_printf ("%s-%s.bin",
+						    prefix,
+						    synapticsmst_device_get_aux_node (device));
+		g_ptr_array_add (helpers, helper);
+		g_ptr_array_add (threads,
+				 g_thread_new ("mst-dump",
+					       synapticsmst_tool_dump_thread_cb,
+					       helper));
+	}
+	for (guint i = 0; i < threads->len; i++)
+		g_thread_join (g_ptr_array_index (threads, i));
+
+	/* report all the results, failing on the first error */
+	for (guint i = 0; i < helpers->len; i++) {
+		SynapticsMSTToolDumpHelper *helper = g_ptr_array_index (helpers, i);
+		if (!helper->ret) {
+			g_propagate_prefixed_error (error,
+						    g_steal_pointer (&helper->error),
+						    "failed to dump to %s: ",
+						    helper->filename);
+			return FALSE;
+		}
+		g_print ("Dumped EEPROM to %s\n", helper->filename);
+	}
+	return TRUE;
+}
+
 static gboolean
 synapticsmst_tool_run (SynapticsMSTToolPrivate *priv,
 		       const gchar *command,
@@ -413,6 +537,12 @@ main (int argc, char **argv)
 			       /* TRANSLATORS: command description */
 			       _("Flash firmware file to MST device"),
 			       synapticsmst_tool_flash);
+	synapticsmst_tool_add (priv->cmd_array,
+			       "dump",
+			       "[FILENAME-PREFIX]",
+			       /* TRANSLATORS: command description */
+			       _("Dump hub EEPROM contents to files"),
+			       synapticsmst_tool_dump);
 
 	/* do stuff on ctrl+c */
 	priv->cancellable = g_cancellable_new ();
@@ -26,25 +26,55 @@
 
 struct FuPluginData {
 	GMutex			 mutex;
+	guint			 device_count;
+	guint			 guid_count;
+	guint			 attach_delay;
+	guint			 update_duration;
+	guint			 attach_idx;
+	guint			 attach_id;
 };
 
+static guint
+fu_plugin_test_get_env_uint (const gchar *key, guint value_default)
+{
+	const gchar *tmp = g_getenv (key);
+	if (tmp == NULL)
+		return value_default;
+	return (guint) g_ascii_strtoull (tmp, NULL, 10);
+}
+
 void
 fu_plugin_init (FuPlugin *plugin)
 {
-	fu_plugin_alloc_data (plugin, sizeof (FuPluginData));
+	FuPluginData *data = fu_plugin_alloc_data (plugin, sizeof (FuPluginData));
 
 	/* only enable when testing */
 	if (g_getenv ("FWUPD_ENABLE_TEST_PLUGIN") == NULL) {
 		fu_plugin_set_enabled (plugin, FALSE);
 		return;
 	}
+
+	/* synthetic load generator, for measuring daemon scaling before a
+	 * fleet actually reaches these device counts */
+	data->device_count = fu_plugin_test_get_env_uint ("FWUPD_TEST_PLUGIN_DEVICE_COUNT", 0);
+	data->guid_count = fu_plugin_test_get_env_uint ("FWUPD_TEST_PLUGIN_GUID_COUNT", 4);
+	data->attach_delay = fu_plugin_test_get_env_uint ("FWUPD_TEST_PLUGIN_ATTACH_DELAY", 0);
+	data->update_duration = fu_plugin_test_get_env_uint ("FWUPD_TEST_PLUGIN_UPDATE_DURATION", 0);
+	if (data->device_count > 0) {
+		g_debug ("generating %u devices with %u GUIDs, "
+			 "attach delay %ums, update duration %ums",
+			 data->device_count, data->guid_count,
+			 data->attach_delay, data->update_duration);
+	}
 	g_debug ("init");
 }
 
 void
 fu_plugin_destroy (FuPlugin *plugin)
 {
-	//FuPluginData *data = fu_plugin_get_data (plugin);
+	FuPluginData *data = fu_plugin_get_data (plugin);
+	if (data->attach_id != 0)
+		g_source_remove (data->attach_id);
 	g_debug ("destroy");
 }
 
@@ -55,10 +85,64 @@ fu_plugin_startup (FuPlugin *plugin, GError **error)
 	return TRUE;
 }
 
+static FuDevice *
+fu_plugin_test_create_device (FuPlugin *plugin, guint idx)
+{
+	FuPluginData *data = fu_plugin_get_data (plugin);
+	FuDevice *device = fu_device_new ();
+	g_autofree gchar *id = g_strdup_printf ("FakeDevice%04u", idx);
+	g_autofree gchar *name = g_strdup_printf ("Integrated_Webcam(TM) #%u", idx);
+
+	fu_device_set_id (device, id);
+	fu_device_set_name (device, name);
+	fu_device_set_version (device, "1.2.3");
+	for (guint i = 0; i < data->guid_count; i++) {
+		g_autofree gchar *guid = NULL;
+		guid = g_strdup_printf ("00000000-0000-0000-%04x-%012x", idx, i);
+		fu_device_add_guid (device, guid);
+	}
+	return device;
+}
+
+static gboolean
+fu_plugin_test_attach_cb (gpointer user_data)
+{
+	FuPlugin *plugin = FU_PLUGIN (user_data);
+	FuPluginData *data = fu_plugin_get_data (plugin);
+	g_autoptr(FuDevice) device = NULL;
+
+	device = fu_plugin_test_create_device (plugin, data->attach_idx++);
+	fu_plugin_device_add (plugin, device);
+	if (data->attach_idx >= data->device_count) {
+		data->attach_id = 0;
+		return FALSE;
+	}
+	return TRUE;
+}
+
 gboolean
 fu_plugin_coldplug (FuPlugin *plugin, GError **error)
 {
+	FuPluginData *data = fu_plugin_get_data (plugin);
 	g_autoptr(FuDevice) device = NULL;
+
+	/* register the synthetic fleet, optionally staggering the attach
+	 * timing to simulate a hotplug burst rather than a single batch */
+	if (data->device_count > 0) {
+		if (data->attach_delay > 0) {
+			data->attach_id = g_timeout_add (data->attach_delay,
+							 fu_plugin_test_attach_cb,
+							 plugin);
+			return TRUE;
+		}
+		for (guint i = 0; i < data->device_count; i++) {
+			g_autoptr(FuDevice) device_tmp = NULL;
+			device_tmp = fu_plugin_test_create_device (plugin, i);
+			fu_plugin_device_add (plugin, device_tmp);
+		}
+		return TRUE;
+	}
+
 	device = fu_device_new ();
 	fu_device_set_id (device, "FakeDevice");
 	fu_device_add_guid (device, "00000000-0000-0000-0000-000000000000");
@@ -74,6 +158,8 @@ fu_plugin_update_online (FuPlugin *plugin,
 			 FwupdInstallFlags flags,
 			 GError **error)
 {
+	FuPluginData *data = fu_plugin_get_data (plugin);
+
 	if (flags & FWUPD_INSTALL_FLAG_OFFLINE) {
 		g_set_error_literal (error,
 				     FWUPD_ERROR,
@@ -82,5 +168,16 @@ fu_plugin_update_online (FuPlugin *plugin,
 	}
 	fu_plugin_set_status (plugin, FWUPD_STATUS_DECOMPRESSING);
 	fu_plugin_set_status (plugin, FWUPD_STATUS_DEVICE_WRITE);
+
+	/* simulate a slow flash with progress, to inject realistic
+	 * latency into batch update runs */
+	if (data->update_duration > 0) {
+		for (guint i = 0; i <= 100; i += 5) {
+			fu_plugin_set_percentage (plugin, i);
+			g_usleep (data->update_duration * 1000 / 21);
+		}
+		fu_plugin_add_transfer_stall (plugin, data->update_duration);
+	}
+	fu_plugin_add_transfer_bytes (plugin, g_bytes_get_size (blob_fw));
 	return TRUE;
 }
@@ -278,9 +278,12 @@ fu_plugin_thunderbolt_schedule_rescan (FuPlugin *plugin)
 	FuPluginData *data = fu_plugin_get_data (plugin);
 
 	/* this delay is a work-around for potential race conditions in which
-	 * the udev event arrives to fwupd prior to the daemon refreshing */
+	 * the udev event arrives to fwupd prior to the daemon refreshing;
+	 * keep the first timer running rather than postponing it on every
+	 * event so the authorization-sequence storm from a dock attach
+	 * coalesces into one rescan with a bounded delay */
 	if (data->refresh_id != 0)
-		g_source_remove (data->refresh_id);
+		return;
 	data->refresh_id = g_timeout_add (FU_PLUGIN_THUNDERBOLT_DAEMON_DELAY,
 					  fu_plugin_thunderbolt_schedule_rescan_cb,
 					  plugin);
@@ -341,6 +344,7 @@ fu_plugin_update_online (FuPlugin *plugin,
 	}
 
 	/* validate the image */
+	fu_plugin_set_status (plugin, FWUPD_STATUS_DEVICE_VERIFY);
 	blob = (const guint8 *) g_bytes_get_data (blob_fw, &blob_sz);
 	rc = tbt_fwu_Controller_validateFWImage (info->controller, blob, blob_sz);
 	if (rc != TBT_OK) {
@@ -352,7 +356,12 @@ fu_plugin_update_online (FuPlugin *plugin,
 		return FALSE;
 	}
 
-	/* update the device */
+	/* update the device; staging the image into non-active NVM can take
+	 * minutes, so start from a known percentage and let the library's
+	 * progress callback tick it forward rather than leaving the session
+	 * stuck at whatever the previous phase reported */
+	fu_plugin_set_status (plugin, FWUPD_STATUS_DEVICE_WRITE);
+	fu_plugin_set_percentage (plugin, 0);
 	rc = tbt_fwu_Controller_updateFW (info->controller,
 					  blob,
 					  blob_sz,
@@ -367,6 +376,9 @@ fu_plugin_update_online (FuPlugin *plugin,
 		return FALSE;
 	}
 
+	/* keep the transfer accounting in step with the other plugins */
+	fu_plugin_add_transfer_bytes (plugin, blob_sz);
+
 	/* success */
 	return TRUE;
 }
@@ -416,6 +428,10 @@ fu_plugin_thunderbolt_uevent_cb (GUdevClient *gudev_client,
 		return;
 	}
 	if (g_strcmp0 (action, "add") == 0) {
+		/* already tracked; checking the syspath is much cheaper than
+		 * opening the sysfs attributes for the VID:PID match */
+		if (fu_plugin_thunderbolt_find_devpath (plugin, udev_device) != NULL)
+			return;
 		if (fu_plugin_thunderbolt_device_matches (udev_device)) {
 			g_debug ("potentially adding tbt device");
 			fu_plugin_thunderbolt_add_devpath (plugin, udev_device);
@@ -425,13 +441,40 @@ fu_plugin_thunderbolt_uevent_cb (GUdevClient *gudev_client,
 	}
 }
 
+static void
+fu_plugin_thunderbolt_device_added_cb (FuUdevBackend *udev_backend,
+				       GUdevDevice *udev_device,
+				       FuPlugin *plugin)
+{
+	fu_plugin_thunderbolt_uevent_cb (NULL, "add", udev_device, plugin);
+}
+
+static void
+fu_plugin_thunderbolt_device_removed_cb (FuUdevBackend *udev_backend,
+					 GUdevDevice *udev_device,
+					 FuPlugin *plugin)
+{
+	fu_plugin_thunderbolt_uevent_cb (NULL, "remove", udev_device, plugin);
+}
+
 void
 fu_plugin_init (FuPlugin *plugin)
 {
 	FuPluginData *data = fu_plugin_alloc_data (plugin, sizeof (FuPluginData));
+	FuUdevBackend *udev_backend = fu_plugin_get_udev_backend (plugin);
 	const gchar *subsystems[] = { "pci", NULL };
 	data->infos = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_plugin_thunderbolt_info_free);
 	data->devpaths = g_ptr_array_new_with_free_func (g_free);
+
+	/* subscribe to the shared index when running inside the daemon */
+	if (udev_backend != NULL) {
+		g_signal_connect (udev_backend, "device-added::pci",
+				  G_CALLBACK (fu_plugin_thunderbolt_device_added_cb), plugin);
+		g_signal_connect (udev_backend, "device-removed::pci",
+				  G_CALLBACK (fu_plugin_thunderbolt_device_removed_cb), plugin);
+		return;
+	}
+
 	data->gudev_client = g_udev_client_new (subsystems);
 	g_signal_connect (data->gudev_client, "uevent",
 			  G_CALLBACK (fu_plugin_thunderbolt_uevent_cb), plugin);
@@ -441,13 +484,17 @@ void
 fu_plugin_destroy (FuPlugin *plugin)
 {
 	FuPluginData *data = fu_plugin_get_data (plugin);
+	FuUdevBackend *udev_backend = fu_plugin_get_udev_backend (plugin);
 	if (data->refresh_id != 0)
 		g_source_remove (data->refresh_id);
 	g_ptr_array_unref (data->infos);
 	g_ptr_array_unref (data->devpaths);
 	tbt_fwu_freeControllerList (data->controllers, data->controllers_len);
 	tbt_fwu_shutdown ();
-	g_object_unref (data->gudev_client);
+	if (udev_backend != NULL)
+		g_signal_handlers_disconnect_by_data (udev_backend, plugin);
+	if (data->gudev_client != NULL)
+		g_object_unref (data->gudev_client);
 }
 
 gboolean
@@ -469,24 +516,39 @@ gboolean
 fu_plugin_coldplug (FuPlugin *plugin, GError **error)
 {
 	FuPluginData *data = fu_plugin_get_data (plugin);
+	FuUdevBackend *udev_backend = fu_plugin_get_udev_backend (plugin);
 	gboolean found = FALSE;
 	g_autoptr(GList) devices = NULL;
 
-	/* get all devices of class */
-	devices = g_udev_client_query_by_subsystem (data->gudev_client, "pci");
-	for (GList *l = devices; l != NULL; l = l->next) {
-		GUdevDevice *udev_device = l->data;
-		if (fu_plugin_thunderbolt_device_matches (udev_device)) {
-			fu_plugin_thunderbolt_add_devpath (plugin, udev_device);
-			found = TRUE;
-			break;
+	/* get all devices of class, serving from the shared index when
+	 * running inside the daemon */
+	if (udev_backend != NULL) {
+		g_autoptr(GPtrArray) devices_tmp = NULL;
+		devices_tmp = fu_udev_backend_get_devices (udev_backend, "pci");
+		for (guint i = 0; i < devices_tmp->len; i++) {
+			GUdevDevice *udev_device = g_ptr_array_index (devices_tmp, i);
+			if (fu_plugin_thunderbolt_device_matches (udev_device)) {
+				fu_plugin_thunderbolt_add_devpath (plugin, udev_device);
+				found = TRUE;
+				break;
+			}
+		}
+	} else {
+		devices = g_udev_client_query_by_subsystem (data->gudev_client, "pci");
+		for (GList *l = devices; l != NULL; l = l->next) {
+			GUdevDevice *udev_device = l->data;
+			if (fu_plugin_thunderbolt_device_matches (udev_device)) {
+				fu_plugin_thunderbolt_add_devpath (plugin, udev_device);
+				found = TRUE;
+				break;
+			}
 		}
+		g_list_foreach (devices, (GFunc) g_object_unref, NULL);
 	}
 	if (found) {
 		g_debug ("found thunderbolt PCI device on coldplug");
 		if (!fu_plugin_thunderbolt_rescan (plugin, error))
 			return FALSE;
 	}
-	g_list_foreach (devices, (GFunc) g_object_unref, NULL);
 	return TRUE;
 }
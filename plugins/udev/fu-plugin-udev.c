@@ -22,6 +22,8 @@
 #include "config.h"
 
 #include <appstream-glib.h>
+#include <errno.h>
+#include <glib/gstdio.h>
 #include <gudev/gudev.h>
 
 #include "fu-plugin.h"
@@ -42,11 +44,112 @@ fu_plugin_udev_get_id (GUdevDevice *device)
 	return id;
 }
 
+static gchar *
+fu_plugin_udev_rom_cache_fn (void)
+{
+	return g_build_filename (LOCALSTATEDIR, "lib", "fwupd", "rom.cache", NULL);
+}
+
+/* the group name keys the cache by the PCI identity, the ROM size and a
+ * hash of the first sector; reading one sector is enough to tell whether
+ * the ROM has been reflashed since the entry was written, and stale
+ * entries just never match again */
+static gchar *
+fu_plugin_udev_rom_cache_group (FuDevice *device,
+				const gchar *rom_fn,
+				GError **error)
+{
+	const gchar *rom_id = fu_device_get_metadata (device, "RomId");
+	gssize sz;
+	guint8 buffer[512];
+	g_autofree gchar *csum = NULL;
+	g_autoptr(GFile) file = NULL;
+	g_autoptr(GFileInfo) info = NULL;
+	g_autoptr(GInputStream) stream = NULL;
+
+	if (rom_id == NULL) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_NOT_SUPPORTED,
+				     "no PCI identity for device");
+		return NULL;
+	}
+	file = g_file_new_for_path (rom_fn);
+	info = g_file_query_info (file, G_FILE_ATTRIBUTE_STANDARD_SIZE,
+				  G_FILE_QUERY_INFO_NONE, NULL, error);
+	if (info == NULL)
+		return NULL;
+
+	/* we have to enable the read for devices */
+	if (g_str_has_prefix (rom_fn, "/sys")) {
+		g_autoptr(GFileOutputStream) output_stream = NULL;
+		output_stream = g_file_replace (file, NULL, FALSE,
+						G_FILE_CREATE_NONE, NULL, error);
+		if (output_stream == NULL)
+			return NULL;
+		if (g_output_stream_write (G_OUTPUT_STREAM (output_stream), "1", 1,
+					   NULL, error) < 0)
+			return NULL;
+	}
+	stream = G_INPUT_STREAM (g_file_read (file, NULL, error));
+	if (stream == NULL)
+		return NULL;
+	sz = g_input_stream_read (stream, buffer, sizeof (buffer), NULL, error);
+	if (sz < 0)
+		return NULL;
+	csum = g_compute_checksum_for_data (G_CHECKSUM_SHA1, buffer, (gsize) sz);
+	return g_strdup_printf ("%s:%" G_GOFFSET_FORMAT ":%s",
+				rom_id, g_file_info_get_size (info), csum);
+}
+
+static GKeyFile *
+fu_plugin_udev_rom_cache_load (void)
+{
+	g_autofree gchar *fn = fu_plugin_udev_rom_cache_fn ();
+	GKeyFile *keyfile = g_key_file_new ();
+	g_key_file_load_from_file (keyfile, fn, G_KEY_FILE_NONE, NULL);
+	return keyfile;
+}
+
+static void
+fu_plugin_udev_rom_cache_save (const gchar *group, FuRom *rom)
+{
+	GPtrArray *checksums = fu_rom_get_checksums (rom);
+	g_autofree gchar *fn = fu_plugin_udev_rom_cache_fn ();
+	g_autofree gchar *dirname = g_path_get_dirname (fn);
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GKeyFile) keyfile = fu_plugin_udev_rom_cache_load ();
+
+	if (fu_rom_get_version (rom) != NULL)
+		g_key_file_set_string (keyfile, group, "Version",
+				       fu_rom_get_version (rom));
+	if (fu_rom_get_guid (rom) != NULL)
+		g_key_file_set_string (keyfile, group, "Guid",
+				       fu_rom_get_guid (rom));
+	if (checksums->len > 0) {
+		g_autofree const gchar **strv = g_new0 (const gchar *, checksums->len + 1);
+		for (guint i = 0; i < checksums->len; i++)
+			strv[i] = g_ptr_array_index (checksums, i);
+		g_key_file_set_string_list (keyfile, group, "Checksums",
+					    strv, checksums->len);
+	}
+
+	/* not being able to save is not fatal, just slow */
+	if (g_mkdir_with_parents (dirname, 0755) != 0) {
+		g_debug ("failed to save ROM cache: %s", g_strerror (errno));
+		return;
+	}
+	if (!g_key_file_save_to_file (keyfile, fn, &error_local))
+		g_debug ("failed to save ROM cache: %s", error_local->message);
+}
+
 gboolean
 fu_plugin_unlock (FuPlugin *plugin, FuDevice *device, GError **error)
 {
 	const gchar *rom_fn;
+	g_autofree gchar *group = NULL;
 	g_autoptr(FuRom) rom = NULL;
+	g_autoptr(GError) error_cache = NULL;
 	g_autoptr(GFile) file = NULL;
 
 	/* get the FW version from the rom */
@@ -59,10 +162,34 @@ fu_plugin_unlock (FuPlugin *plugin, FuDevice *device, GError **error)
 				     "Unable to read firmware from device");
 		return FALSE;
 	}
+
+	/* the parse results may be cached from a previous daemon start */
+	group = fu_plugin_udev_rom_cache_group (device, rom_fn, &error_cache);
+	if (group == NULL) {
+		g_debug ("not using ROM cache: %s", error_cache->message);
+	} else {
+		g_autofree gchar *guid_cached = NULL;
+		g_autofree gchar *version_cached = NULL;
+		g_autoptr(GKeyFile) keyfile = fu_plugin_udev_rom_cache_load ();
+		version_cached = g_key_file_get_string (keyfile, group, "Version", NULL);
+		guid_cached = g_key_file_get_string (keyfile, group, "Guid", NULL);
+		if (version_cached != NULL && guid_cached != NULL) {
+			g_debug ("using cached ROM details for %s",
+				 fu_device_get_id (device));
+			if (g_strcmp0 (fu_device_get_version (device),
+				       version_cached) != 0)
+				fu_device_set_version (device, version_cached);
+			fu_device_add_guid (device, guid_cached);
+			return TRUE;
+		}
+	}
+
 	file = g_file_new_for_path (rom_fn);
 	rom = fu_rom_new ();
 	if (!fu_rom_load_file (rom, file, FU_ROM_LOAD_FLAG_BLANK_PPID, NULL, error))
 		return FALSE;
+	if (group != NULL)
+		fu_plugin_udev_rom_cache_save (group, rom);
 
 	/* update version */
 	if (g_strcmp0 (fu_device_get_version (device),
@@ -90,6 +217,8 @@ fu_plugin_verify (FuPlugin *plugin,
 {
 	GPtrArray *checksums;
 	const gchar *rom_fn;
+	g_autofree gchar *group = NULL;
+	g_autoptr(GError) error_cache = NULL;
 	g_autoptr(GFile) file = NULL;
 	g_autoptr(FuRom) rom = NULL;
 
@@ -102,10 +231,32 @@ fu_plugin_verify (FuPlugin *plugin,
 				     "Unable to read firmware from device");
 		return FALSE;
 	}
+
+	/* the parse results may be cached from a previous daemon start */
+	group = fu_plugin_udev_rom_cache_group (device, rom_fn, &error_cache);
+	if (group == NULL) {
+		g_debug ("not using ROM cache: %s", error_cache->message);
+	} else {
+		g_auto(GStrv) checksums_cached = NULL;
+		g_autoptr(GKeyFile) keyfile = fu_plugin_udev_rom_cache_load ();
+		checksums_cached = g_key_file_get_string_list (keyfile, group,
+							       "Checksums",
+							       NULL, NULL);
+		if (checksums_cached != NULL) {
+			g_debug ("using cached ROM checksums for %s",
+				 fu_device_get_id (device));
+			for (guint i = 0; checksums_cached[i] != NULL; i++)
+				fu_device_add_checksum (device, checksums_cached[i]);
+			return TRUE;
+		}
+	}
+
 	file = g_file_new_for_path (rom_fn);
 	rom = fu_rom_new ();
 	if (!fu_rom_load_file (rom, file, FU_ROM_LOAD_FLAG_BLANK_PPID, NULL, error))
 		return FALSE;
+	if (group != NULL)
+		fu_plugin_udev_rom_cache_save (group, rom);
 	checksums = fu_rom_get_checksums (rom);
 	for (guint i = 0; i < checksums->len; i++) {
 		const gchar *checksum = g_ptr_array_index (checksums, i);
@@ -180,8 +331,22 @@ fu_plugin_udev_add (FuPlugin *plugin, GUdevDevice *device)
 	/* get the FW version from the rom when unlocked */
 	rom_fn = g_build_filename (g_udev_device_get_sysfs_path (device), "rom", NULL);
 	if (g_file_test (rom_fn, G_FILE_TEST_EXISTS)) {
+		const gchar *pci_dev = g_udev_device_get_sysfs_attr (device, "device");
+		const gchar *pci_ven = g_udev_device_get_sysfs_attr (device, "vendor");
+		const gchar *sub_dev = g_udev_device_get_sysfs_attr (device, "subsystem_device");
+		const gchar *sub_ven = g_udev_device_get_sysfs_attr (device, "subsystem_vendor");
 		fu_device_set_metadata (dev, "RomFilename", rom_fn);
 		fu_device_add_flag (dev, FWUPD_DEVICE_FLAG_LOCKED);
+
+		/* this identity keys the ROM parse cache */
+		if (pci_ven != NULL && pci_dev != NULL) {
+			g_autofree gchar *rom_id = NULL;
+			rom_id = g_strdup_printf ("%s:%s:%s:%s",
+						  pci_ven, pci_dev,
+						  sub_ven != NULL ? sub_ven : "none",
+						  sub_dev != NULL ? sub_dev : "none");
+			fu_device_set_metadata (dev, "RomId", rom_id);
+		}
 	}
 
 	/* insert to hash */
@@ -223,12 +388,42 @@ fu_plugin_udev_uevent_cb (GUdevClient *gudev_client,
 	}
 }
 
+static void
+fu_plugin_udev_device_added_cb (FuUdevBackend *udev_backend,
+				GUdevDevice *udev_device,
+				FuPlugin *plugin)
+{
+	fu_plugin_udev_add (plugin, udev_device);
+}
+
+static void
+fu_plugin_udev_device_removed_cb (FuUdevBackend *udev_backend,
+				  GUdevDevice *udev_device,
+				  FuPlugin *plugin)
+{
+	fu_plugin_udev_remove (plugin, udev_device);
+}
+
 void
 fu_plugin_init (FuPlugin *plugin)
 {
 	FuPluginData *data = fu_plugin_alloc_data (plugin, sizeof (FuPluginData));
+	FuUdevBackend *udev_backend = fu_plugin_get_udev_backend (plugin);
 	const gchar *subsystems[] = { NULL };
 
+	/* subscribe to the shared index when running inside the daemon */
+	if (udev_backend != NULL) {
+		g_signal_connect (udev_backend, "device-added::usb",
+				  G_CALLBACK (fu_plugin_udev_device_added_cb), plugin);
+		g_signal_connect (udev_backend, "device-added::pci",
+				  G_CALLBACK (fu_plugin_udev_device_added_cb), plugin);
+		g_signal_connect (udev_backend, "device-removed::usb",
+				  G_CALLBACK (fu_plugin_udev_device_removed_cb), plugin);
+		g_signal_connect (udev_backend, "device-removed::pci",
+				  G_CALLBACK (fu_plugin_udev_device_removed_cb), plugin);
+		return;
+	}
+
 	data->gudev_client = g_udev_client_new (subsystems);
 	g_signal_connect (data->gudev_client, "uevent",
 			  G_CALLBACK (fu_plugin_udev_uevent_cb), plugin);
@@ -238,13 +433,18 @@ void
 fu_plugin_destroy (FuPlugin *plugin)
 {
 	FuPluginData *data = fu_plugin_get_data (plugin);
-	g_object_unref (data->gudev_client);
+	FuUdevBackend *udev_backend = fu_plugin_get_udev_backend (plugin);
+	if (udev_backend != NULL)
+		g_signal_handlers_disconnect_by_data (udev_backend, plugin);
+	if (data->gudev_client != NULL)
+		g_object_unref (data->gudev_client);
 }
 
 gboolean
 fu_plugin_coldplug (FuPlugin *plugin, GError **error)
 {
 	FuPluginData *data = fu_plugin_get_data (plugin);
+	FuUdevBackend *udev_backend = fu_plugin_get_udev_backend (plugin);
 	GList *devices;
 	GUdevDevice *udev_device;
 	const gchar *devclass[] = { "usb", "pci", NULL };
@@ -255,6 +455,18 @@ fu_plugin_coldplug (FuPlugin *plugin, GError **error)
 		g_autoptr(AsProfileTask) ptask = NULL;
 		ptask = as_profile_start (profile, "FuPluginUdev:coldplug{%s}", devclass[i]);
 		g_assert (ptask != NULL);
+
+		/* serve from the shared index rather than walking sysfs */
+		if (udev_backend != NULL) {
+			g_autoptr(GPtrArray) devices_tmp = NULL;
+			devices_tmp = fu_udev_backend_get_devices (udev_backend,
+								   devclass[i]);
+			for (guint j = 0; j < devices_tmp->len; j++) {
+				udev_device = g_ptr_array_index (devices_tmp, j);
+				fu_plugin_udev_add (plugin, udev_device);
+			}
+			continue;
+		}
 		devices = g_udev_client_query_by_subsystem (data->gudev_client,
 							    devclass[i]);
 		for (GList *l = devices; l != NULL; l = l->next) {
@@ -28,18 +28,41 @@
 
 #include "fu-rom.h"
 
-static gboolean
-fu_fuzzer_rom_parse (const gchar *fn, GError **error)
+typedef struct {
+	GMainLoop	*loop;
+	guint		 pending;
+} FuFuzzerRomHelper;
+
+typedef struct {
+	FuFuzzerRomHelper *helper;
+	const gchar	*fn;
+	FuRom		*rom;
+	GError		*error;
+} FuFuzzerRomItem;
+
+static void
+fu_fuzzer_rom_item_free (FuFuzzerRomItem *item)
+{
+	g_object_unref (item->rom);
+	if (item->error != NULL)
+		g_error_free (item->error);
+	g_free (item);
+}
+
+static void
+fu_fuzzer_rom_load_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	FuFuzzerRomItem *item = (FuFuzzerRomItem *) user_data;
+	fu_rom_load_file_finish (FU_ROM (source), res, &item->error);
+	if (--item->helper->pending == 0)
+		g_main_loop_quit (item->helper->loop);
+}
+
+static void
+fu_fuzzer_rom_print (const gchar *fn, FuRom *rom)
 {
 	GPtrArray *checksums;
-	g_autoptr(FuRom) rom = NULL;
-	g_autoptr(GFile) file = NULL;
-
-	g_debug ("loading %s", fn);
-	file = g_file_new_for_path (fn);
-	rom = fu_rom_new ();
-	if (!fu_rom_load_file (rom, file, FU_ROM_LOAD_FLAG_NONE, NULL, error))
-		return FALSE;
+
 	g_print ("filename:%s\n", fn);
 	g_print ("kind:%s\n", fu_rom_kind_to_string (fu_rom_get_kind (rom)));
 	g_print ("version:%s\n", fu_rom_get_version (rom));
@@ -53,7 +76,6 @@ fu_fuzzer_rom_parse (const gchar *fn, GError **error)
 	g_print ("guid:%s\n", fu_rom_get_guid (rom));
 	g_print ("vendor:%u\n", fu_rom_get_vendor (rom));
 	g_print ("model:%u\n\n", fu_rom_get_model (rom));
-	return TRUE;
 }
 
 static gboolean
@@ -191,13 +213,40 @@ main (int argc, char *argv[])
 		g_setenv ("G_MESSAGES_DEBUG", "all", TRUE);
 	if (g_strcmp0 (argv[1], "rom") == 0) {
 		gboolean all_successful = TRUE;
+		FuFuzzerRomHelper helper;
+		g_autoptr(GMainLoop) loop = g_main_loop_new (NULL, FALSE);
+		g_autoptr(GPtrArray) items = NULL;
+
+		/* the reads run on a bounded worker pool, so the total time
+		 * is set by the slowest file, not the sum */
+		items = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_fuzzer_rom_item_free);
+		helper.loop = loop;
+		helper.pending = (guint) argc - 2;
 		for (i = 2; i < (guint) argc; i++) {
-			g_autoptr(GError) error = NULL;
-			if (!fu_fuzzer_rom_parse (argv[i], &error)) {
+			FuFuzzerRomItem *item;
+			g_autoptr(GFile) file = g_file_new_for_path (argv[i]);
+			item = g_new0 (FuFuzzerRomItem, 1);
+			item->helper = &helper;
+			item->fn = argv[i];
+			item->rom = fu_rom_new ();
+			g_ptr_array_add (items, item);
+			g_debug ("loading %s", item->fn);
+			fu_rom_load_file_async (item->rom, file,
+						FU_ROM_LOAD_FLAG_NONE, NULL,
+						fu_fuzzer_rom_load_cb, item);
+		}
+		g_main_loop_run (loop);
+
+		/* print the results in command line order */
+		for (i = 0; i < items->len; i++) {
+			FuFuzzerRomItem *item = g_ptr_array_index (items, i);
+			if (item->error != NULL) {
 				g_print ("Failed to parse %s: %s\n",
-					 argv[i], error->message);
+					 item->fn, item->error->message);
 				all_successful = FALSE;
+				continue;
 			}
+			fu_fuzzer_rom_print (item->fn, item->rom);
 		}
 		return all_successful ? EXIT_SUCCESS : EXIT_FAILURE;
 	}
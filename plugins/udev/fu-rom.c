@@ -28,6 +28,7 @@
 #include <glib/gstdio.h>
 #include <string.h>
 
+#include "fu-guid.h"
 #include "fu-rom.h"
 
 static void fu_rom_finalize			 (GObject *object);
@@ -92,31 +93,119 @@ fu_rom_kind_to_string (FuRomKind kind)
 	return NULL;
 }
 
+typedef struct {
+	const gchar	*needle;
+	gsize		 needle_len;
+	guint8		 skip[0x100];
+} FuRomNeedle;
+
+/* all the needles are compile-time constants, so each Boyer-Moore-Horspool
+ * skip table only has to be computed the first time the needle is seen;
+ * the mutex only guards insertion as entries are never moved or removed */
+static const FuRomNeedle *
+fu_rom_get_needle (const gchar *needle)
+{
+	static FuRomNeedle cache[16];
+	static guint cache_len = 0;
+	static GMutex mutex;
+	FuRomNeedle *tmp;
+
+	g_mutex_lock (&mutex);
+	for (guint i = 0; i < cache_len; i++) {
+		if (g_strcmp0 (cache[i].needle, needle) == 0) {
+			g_mutex_unlock (&mutex);
+			return &cache[i];
+		}
+	}
+	g_assert (cache_len < G_N_ELEMENTS (cache));
+	tmp = &cache[cache_len];
+	tmp->needle = needle;
+	tmp->needle_len = strlen (needle);
+	for (guint i = 0; i < G_N_ELEMENTS (tmp->skip); i++)
+		tmp->skip[i] = (guint8) tmp->needle_len;
+	for (guint i = 0; i < tmp->needle_len - 1; i++)
+		tmp->skip[(guint8) needle[i]] = (guint8) (tmp->needle_len - 1 - i);
+	cache_len++;
+	g_mutex_unlock (&mutex);
+	return tmp;
+}
+
+static gboolean
+fu_rom_pci_get_haystack (FuRomPciHeader *hdr,
+			 guint8 **haystack,
+			 gsize *haystack_len)
+{
+	if (hdr->rom_data == NULL)
+		return FALSE;
+	if (hdr->data_len > hdr->rom_len)
+		return FALSE;
+	*haystack = &hdr->rom_data[hdr->data_len];
+	*haystack_len = hdr->rom_len - hdr->data_len;
+	return TRUE;
+}
+
 static guint8 *
 fu_rom_pci_strstr (FuRomPciHeader *hdr, const gchar *needle)
 {
-	gsize needle_len;
+	const FuRomNeedle *n;
 	guint8 *haystack;
 	gsize haystack_len;
+	gsize i = 0;
 
 	if (needle == NULL || needle[0] == '\0')
 		return NULL;
-	if (hdr->rom_data == NULL)
-		return NULL;
-	if (hdr->data_len > hdr->rom_len)
+	if (!fu_rom_pci_get_haystack (hdr, &haystack, &haystack_len))
 		return NULL;
-	haystack = &hdr->rom_data[hdr->data_len];
-	haystack_len = hdr->rom_len - hdr->data_len;
-	needle_len = strlen (needle);
-	if (needle_len > haystack_len)
+	n = fu_rom_get_needle (needle);
+	if (n->needle_len > haystack_len)
 		return NULL;
-	for (guint i = 0; i < haystack_len - needle_len; i++) {
-		if (memcmp (haystack + i, needle, needle_len) == 0)
+
+	/* Boyer-Moore-Horspool, skipping ahead by however many bytes the
+	 * mismatched character says cannot start a match */
+	while (i < haystack_len - n->needle_len) {
+		if (memcmp (haystack + i, needle, n->needle_len) == 0)
 			return &haystack[i];
+		i += n->skip[haystack[i + n->needle_len - 1]];
 	}
 	return NULL;
 }
 
+/* scans the region just once, remembering the first match for every needle
+ * so callers can keep their priority ordering */
+static void
+fu_rom_pci_strstr_multi (FuRomPciHeader *hdr,
+			 const gchar **needles,
+			 guint8 **results,
+			 guint n_needles)
+{
+	const FuRomNeedle *n[8];
+	guint8 *haystack;
+	gsize haystack_len;
+	guint found = 0;
+
+	g_assert (n_needles <= G_N_ELEMENTS (n));
+	for (guint j = 0; j < n_needles; j++) {
+		n[j] = fu_rom_get_needle (needles[j]);
+		results[j] = NULL;
+	}
+	if (!fu_rom_pci_get_haystack (hdr, &haystack, &haystack_len))
+		return;
+	for (gsize i = 0; i < haystack_len && found < n_needles; i++) {
+		for (guint j = 0; j < n_needles; j++) {
+			if (results[j] != NULL)
+				continue;
+			if (haystack[i] != (guint8) needles[j][0])
+				continue;
+			if (i + n[j]->needle_len > haystack_len)
+				continue;
+			if (memcmp (haystack + i, needles[j], n[j]->needle_len) == 0) {
+				results[j] = &haystack[i];
+				found++;
+			}
+		}
+	}
+}
+
 static guint
 fu_rom_blank_serial_numbers (guint8 *buffer, guint buffer_sz)
 {
@@ -132,6 +221,22 @@ fu_rom_blank_serial_numbers (guint8 *buffer, guint buffer_sz)
 	return i;
 }
 
+static gboolean
+fu_rom_get_debug_enabled (void)
+{
+	/* the hex dumps are thrown away unless debug output is actually
+	 * turned on, and building them costs real time when coldplugging
+	 * multi-GPU systems */
+	static gint enabled = -1;
+	if (enabled == -1) {
+		const gchar *domains = g_getenv ("G_MESSAGES_DEBUG");
+		enabled = domains != NULL &&
+			  (g_strcmp0 (domains, "all") == 0 ||
+			   g_strstr_len (domains, -1, G_LOG_DOMAIN) != NULL);
+	}
+	return enabled > 0;
+}
+
 static gchar *
 fu_rom_get_hex_dump (guint8 *buffer, gssize sz)
 {
@@ -238,6 +343,10 @@ fu_rom_pci_print_header (FuRomPciHeader *hdr)
 	g_autofree gchar *data_str = NULL;
 	g_autofree gchar *reserved_str = NULL;
 
+	/* everything here is debug output */
+	if (!fu_rom_get_debug_enabled ())
+		return;
+
 	g_debug ("PCI Header");
 	g_debug (" RomOffset: 0x%04x", hdr->rom_offset);
 	g_debug (" RomSize:   0x%04x", hdr->rom_len);
@@ -430,9 +539,11 @@ fu_rom_pci_get_header (guint8 *buffer, gssize sz)
 		if (memcmp (buffer, "\x56\x4e", 2) == 0) {
 			g_debug ("-- using NVIDIA ROM quirk");
 		} else {
-			g_autofree gchar *sig_str = NULL;
-			sig_str = fu_rom_get_hex_dump (buffer, MIN (16, sz));
-			g_debug ("Not PCI ROM %s", sig_str);
+			if (fu_rom_get_debug_enabled ()) {
+				g_autofree gchar *sig_str = NULL;
+				sig_str = fu_rom_get_hex_dump (buffer, MIN (16, sz));
+				g_debug ("Not PCI ROM %s", sig_str);
+			}
 			return NULL;
 		}
 	}
@@ -480,24 +591,25 @@ fu_rom_find_version_pci (FuRomPciHeader *hdr)
 static gchar *
 fu_rom_find_version_nvidia (FuRomPciHeader *hdr)
 {
-	gchar *str;
+	const gchar *needles[] = { "Version ", "Vension:", "Version" };
+	guint8 *results[3];
 
 	/* static location for some firmware */
 	if (memcmp (hdr->rom_data + 0x013d, "Version ", 8) == 0)
 		return g_strdup ((gchar *) &hdr->rom_data[0x013d + 8]);
 
+	/* one pass over the region for all the search strings */
+	fu_rom_pci_strstr_multi (hdr, needles, results, G_N_ELEMENTS (needles));
+
 	/* usual search string */
-	str = (gchar *) fu_rom_pci_strstr (hdr, "Version ");
-	if (str != NULL)
-		return g_strdup (str + 8);
+	if (results[0] != NULL)
+		return g_strdup ((gchar *) results[0] + 8);
 
 	/* broken */
-	str = (gchar *) fu_rom_pci_strstr (hdr, "Vension:");
-	if (str != NULL)
-		return g_strdup (str + 8);
-	str = (gchar *) fu_rom_pci_strstr (hdr, "Version");
-	if (str != NULL)
-		return g_strdup (str + 7);
+	if (results[1] != NULL)
+		return g_strdup ((gchar *) results[1] + 8);
+	if (results[2] != NULL)
+		return g_strdup ((gchar *) results[2] + 7);
 
 	/* fallback to VBIOS */
 	if (memcmp (hdr->rom_data + 0xfa, "VBIOS Ver", 9) == 0)
@@ -508,13 +620,16 @@ fu_rom_find_version_nvidia (FuRomPciHeader *hdr)
 static gchar *
 fu_rom_find_version_intel (FuRomPciHeader *hdr)
 {
-	gchar *str;
+	const gchar *needles[] = { "Build Number:", "VBIOS " };
+	guint8 *results[2];
+
+	/* one pass over the region for all the search strings */
+	fu_rom_pci_strstr_multi (hdr, needles, results, G_N_ELEMENTS (needles));
 
 	/* 2175_RYan PC 14.34  06/06/2013  21:27:53 */
-	str = (gchar *) fu_rom_pci_strstr (hdr, "Build Number:");
-	if (str != NULL) {
+	if (results[0] != NULL) {
 		g_auto(GStrv) split = NULL;
-		split = g_strsplit (str + 14, " ", -1);
+		split = g_strsplit ((gchar *) results[0] + 14, " ", -1);
 		for (guint i = 0; split[i] != NULL; i++) {
 			if (g_strstr_len (split[i], -1, ".") == NULL)
 				continue;
@@ -523,25 +638,26 @@ fu_rom_find_version_intel (FuRomPciHeader *hdr)
 	}
 
 	/* fallback to VBIOS */
-	str = (gchar *) fu_rom_pci_strstr (hdr, "VBIOS ");
-	if (str != NULL)
-		return g_strdup (str + 6);
+	if (results[1] != NULL)
+		return g_strdup ((gchar *) results[1] + 6);
 	return NULL;
 }
 
 static gchar *
 fu_rom_find_version_ati (FuRomPciHeader *hdr)
 {
-	gchar *str;
+	const gchar *needles[] = { " VER0", " VR" };
+	guint8 *results[2];
 
-	str = (gchar *) fu_rom_pci_strstr (hdr, " VER0");
-	if (str != NULL)
-		return g_strdup (str + 4);
+	/* one pass over the region for all the search strings */
+	fu_rom_pci_strstr_multi (hdr, needles, results, G_N_ELEMENTS (needles));
+
+	if (results[0] != NULL)
+		return g_strdup ((gchar *) results[0] + 4);
 
 	/* broken */
-	str = (gchar *) fu_rom_pci_strstr (hdr, " VR");
-	if (str != NULL)
-		return g_strdup (str + 4);
+	if (results[1] != NULL)
+		return g_strdup ((gchar *) results[1] + 4);
 	return NULL;
 }
 
@@ -713,7 +829,7 @@ fu_rom_load_data (FuRom *rom,
 	/* update guid */
 	id = g_strdup_printf ("PCI\\VEN_%04X&DEV_%04X",
 			      priv->vendor_id, priv->device_id);
-	priv->guid = as_utils_guid_from_string (id);
+	priv->guid = fu_guid_from_string (id);
 	g_debug ("using %s for %s", priv->guid, id);
 
 	/* not known */
@@ -728,13 +844,68 @@ fu_rom_load_data (FuRom *rom,
 	return TRUE;
 }
 
+/* walks the image chain in the data read so far and returns the number of
+ * bytes the images actually cover, or 0 if the end of the chain has not
+ * been read yet and more data is needed */
+static gsize
+fu_rom_get_data_extent (guint8 *buffer, gsize sz)
+{
+	gboolean seen_last_image = FALSE;
+	guint32 jump = 0;
+	guint32 hdr_sz = 0;
+
+	/* optional IFR header */
+	if (sz > 0x17 && memcmp (buffer, "NVGI", 4) == 0) {
+		guint16 ifr_sz_raw;
+		memcpy (&ifr_sz_raw, &buffer[0x15], 2);
+		hdr_sz = GUINT16_FROM_BE (ifr_sz_raw);
+	}
+
+	while ((gsize) hdr_sz + jump + 0x1a < sz) {
+		guint8 *base = &buffer[hdr_sz + jump];
+		guint32 rom_len;
+		guint16 cpi_ptr;
+
+		/* chain has ended; if the last-image flag was seen then
+		 * whatever follows can only be padding */
+		if (memcmp (base, "\x55\xaa", 2) != 0 &&
+		    memcmp (base, "\x56\x4e", 2) != 0) {
+			if (seen_last_image)
+				return hdr_sz + jump;
+			return 0;
+		}
+
+		/* find the last-image flag in the PCI data */
+		cpi_ptr = ((guint16) base[0x19] << 8) + base[0x18];
+		if (cpi_ptr > 0 &&
+		    (gsize) hdr_sz + jump + cpi_ptr + 0x16 < sz) {
+			guint8 *cpi = base + cpi_ptr;
+			if (memcmp (cpi, "PCIR", 4) == 0 ||
+			    memcmp (cpi, "RGIS", 4) == 0 ||
+			    memcmp (cpi, "NPDS", 4) == 0 ||
+			    memcmp (cpi, "NPDE", 4) == 0) {
+				if (cpi[0x15] == 0x80)
+					seen_last_image = TRUE;
+			}
+		}
+
+		/* a zero size means 'the rest of the file' */
+		rom_len = base[0x02] * 512;
+		if (rom_len == 0)
+			return 0;
+		jump += rom_len;
+	}
+	return 0;
+}
+
 gboolean
 fu_rom_load_file (FuRom *rom, GFile *file, FuRomLoadFlags flags,
 		  GCancellable *cancellable, GError **error)
 {
 	FuRomPrivate *priv = GET_PRIVATE (rom);
 	const gssize buffer_sz = 0x400000;
-	gssize sz;
+	const gssize chunk_sz = 0x10000;
+	gssize sz = 0;
 	guint number_reads = 0;
 	g_autoptr(GError) error_local = NULL;
 	g_autofree gchar *fn = NULL;
@@ -769,38 +940,38 @@ fu_rom_load_file (FuRom *rom, GFile *file, FuRomLoadFlags flags,
 			return FALSE;
 	}
 
-	/* read out the header */
+	/* read the ROM in windows, stopping as soon as the image chain is
+	 * known to be complete; reading a 1 MB+ server GPU ROM through slow
+	 * config space access takes whole seconds and the version strings
+	 * all live in the first images */
 	buffer = g_malloc ((gsize) buffer_sz);
-	sz = g_input_stream_read (priv->stream, buffer, buffer_sz,
-				  cancellable, error);
-	if (sz < 0)
-		return FALSE;
-	if (sz < 512) {
-		g_set_error (error,
-			     FWUPD_ERROR,
-			     FWUPD_ERROR_INVALID_FILE,
-			     "Firmware too small: %" G_GSSIZE_FORMAT " bytes", sz);
-		return FALSE;
-	}
-
-	/* ensure we got enough data to fill the buffer */
 	while (sz < buffer_sz) {
 		gssize sz_chunk;
+		gsize extent;
 		sz_chunk = g_input_stream_read (priv->stream,
 						buffer + sz,
-						buffer_sz - sz,
+						MIN (chunk_sz, buffer_sz - sz),
 						cancellable,
 						error);
+		if (sz_chunk < 0)
+			return FALSE;
 		if (sz_chunk == 0)
 			break;
 		g_debug ("ROM returned 0x%04x bytes, adding 0x%04x...",
 			 (guint) sz, (guint) sz_chunk);
-		if (sz_chunk < 0)
-			return FALSE;
 		sz += sz_chunk;
 
-		/* check the firmware isn't serving us small chunks */
-		if (number_reads++ > 16) {
+		/* all the images are in already; anything further is only
+		 * padding that the parser would ignore anyway */
+		extent = fu_rom_get_data_extent (buffer, (gsize) sz);
+		if (extent > 0 && extent <= (gsize) sz) {
+			g_debug ("stopping read early, 0x%04x bytes covers "
+				 "all images", (guint) extent);
+			break;
+		}
+
+		/* check the firmware isn't serving us tiny chunks */
+		if (sz_chunk < 0x1000 && number_reads++ > 16) {
 			g_set_error_literal (error,
 					     FWUPD_ERROR,
 					     FWUPD_ERROR_INVALID_FILE,
@@ -808,11 +979,89 @@ fu_rom_load_file (FuRom *rom, GFile *file, FuRomLoadFlags flags,
 			return FALSE;
 		}
 	}
+	if (sz < 512) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "Firmware too small: %" G_GSSIZE_FORMAT " bytes", sz);
+		return FALSE;
+	}
 	g_debug ("ROM buffer filled %" G_GSSIZE_FORMAT "kb/%" G_GSSIZE_FORMAT "kb",
 		 sz / 0x400, buffer_sz / 0x400);
 	return fu_rom_load_data (rom, buffer, sz, flags, cancellable, error);
 }
 
+/* reading a ROM goes through slow PCI config space access, so keep the
+ * number of devices being read at the same time bounded */
+#define FU_ROM_LOAD_MAX_THREADS		4
+
+typedef struct {
+	GFile		*file;
+	FuRomLoadFlags	 flags;
+} FuRomLoadHelper;
+
+static void
+fu_rom_load_helper_free (FuRomLoadHelper *helper)
+{
+	g_object_unref (helper->file);
+	g_free (helper);
+}
+
+static void
+fu_rom_load_file_pool_cb (gpointer data, gpointer user_data)
+{
+	g_autoptr(GTask) task = G_TASK (data);
+	FuRom *rom = FU_ROM (g_task_get_source_object (task));
+	FuRomLoadHelper *helper = g_task_get_task_data (task);
+	GError *error = NULL;
+
+	if (g_task_return_error_if_cancelled (task))
+		return;
+	if (!fu_rom_load_file (rom, helper->file, helper->flags,
+			       g_task_get_cancellable (task), &error)) {
+		g_task_return_error (task, error);
+		return;
+	}
+	g_task_return_boolean (task, TRUE);
+}
+
+void
+fu_rom_load_file_async (FuRom *rom, GFile *file, FuRomLoadFlags flags,
+			GCancellable *cancellable,
+			GAsyncReadyCallback callback, gpointer user_data)
+{
+	static GThreadPool *pool = NULL;
+	FuRomLoadHelper *helper;
+	GTask *task;
+
+	g_return_if_fail (FU_IS_ROM (rom));
+	g_return_if_fail (G_IS_FILE (file));
+
+	/* the pool is shared so reads queued for many devices still only
+	 * touch a few of them at once */
+	if (g_once_init_enter (&pool)) {
+		GThreadPool *tmp;
+		tmp = g_thread_pool_new (fu_rom_load_file_pool_cb, NULL,
+					 FU_ROM_LOAD_MAX_THREADS, FALSE, NULL);
+		g_once_init_leave (&pool, tmp);
+	}
+
+	helper = g_new0 (FuRomLoadHelper, 1);
+	helper->file = g_object_ref (file);
+	helper->flags = flags;
+	task = g_task_new (rom, cancellable, callback, user_data);
+	g_task_set_task_data (task, helper, (GDestroyNotify) fu_rom_load_helper_free);
+	g_thread_pool_push (pool, task, NULL);
+}
+
+gboolean
+fu_rom_load_file_finish (FuRom *rom, GAsyncResult *res, GError **error)
+{
+	g_return_val_if_fail (FU_IS_ROM (rom), FALSE);
+	g_return_val_if_fail (g_task_is_valid (res, rom), FALSE);
+	return g_task_propagate_boolean (G_TASK (res), error);
+}
+
 FuRomKind
 fu_rom_get_kind (FuRom *rom)
 {
@@ -57,6 +57,15 @@ gboolean	 fu_rom_load_file			(FuRom		*rom,
 							 FuRomLoadFlags	 flags,
 							 GCancellable	*cancellable,
 							 GError		**error);
+void		 fu_rom_load_file_async			(FuRom		*rom,
+							 GFile		*file,
+							 FuRomLoadFlags	 flags,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 user_data);
+gboolean	 fu_rom_load_file_finish		(FuRom		*rom,
+							 GAsyncResult	*res,
+							 GError		**error);
 gboolean	 fu_rom_load_data			(FuRom		*rom,
 							 guint8		*buffer,
 							 gsize		 buffer_sz,
@@ -169,6 +169,128 @@ fu_plugin_get_results (FuPlugin *plugin, FuDevice *device, GError **error)
 	return TRUE;
 }
 
+/* EFI_CAPSULE_HEADER: CapsuleGuid, HeaderSize, Flags, CapsuleImageSize */
+#define FU_PLUGIN_UEFI_CAPSULE_HEADER_SIZE	28	/* bytes */
+
+/* EFI_FIRMWARE_MANAGEMENT_CAPSULE_ID_GUID; the payload GUIDs are inside
+ * the capsule body and are not checked here */
+#define FU_PLUGIN_UEFI_FMP_CAPSULE_GUID	"6dcbd5ed-e82d-4c44-bda1-7194199ad92a"
+
+static gboolean
+fu_plugin_uefi_check_capsule_header (GBytes *blob_fw,
+				     const gchar *guid_device,
+				     GError **error)
+{
+	const guint8 *blob;
+	gsize blob_sz = 0;
+	guint32 header_size;
+	guint32 image_size;
+	g_autofree gchar *guid_str = NULL;
+
+	blob = g_bytes_get_data (blob_fw, &blob_sz);
+	if (blob_sz < FU_PLUGIN_UEFI_CAPSULE_HEADER_SIZE) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "capsule of %" G_GSIZE_FORMAT " bytes is too small",
+			     blob_sz);
+		return FALSE;
+	}
+	memcpy (&header_size, blob + 16, sizeof (header_size));
+	header_size = GUINT32_FROM_LE (header_size);
+	memcpy (&image_size, blob + 24, sizeof (image_size));
+	image_size = GUINT32_FROM_LE (image_size);
+
+	/* a bare firmware image is legal input as fwup adds the capsule
+	 * header itself, so only enforce the checks when the payload
+	 * actually starts with a plausible header */
+	if (header_size < FU_PLUGIN_UEFI_CAPSULE_HEADER_SIZE ||
+	    header_size > blob_sz) {
+		g_debug ("no capsule header found, staging image as-is");
+		return TRUE;
+	}
+	if (image_size > blob_sz) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "capsule is truncated: header claims %u bytes "
+			     "but only %" G_GSIZE_FORMAT " are present",
+			     image_size, blob_sz);
+		return FALSE;
+	}
+	if (image_size < header_size) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "capsule image size %u is smaller than its "
+			     "header size %u",
+			     image_size, header_size);
+		return FALSE;
+	}
+
+	/* the capsule has to be for the ESRT entry we are about to update */
+	guid_str = g_strdup ("00000000-0000-0000-0000-000000000000");
+	if (efi_guid_to_str ((efi_guid_t *) blob, &guid_str) < 0) {
+		g_warning ("failed to convert capsule guid to string");
+		return TRUE;
+	}
+	if (g_ascii_strcasecmp (guid_str, guid_device) != 0 &&
+	    g_ascii_strcasecmp (guid_str, FU_PLUGIN_UEFI_FMP_CAPSULE_GUID) != 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_SUPPORTED,
+			     "capsule %s does not match ESRT entry %s",
+			     guid_str, guid_device);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+typedef struct {
+	fwup_resource		*re;
+	guint64			 hardware_instance;
+	GBytes			*blob_fw;
+	GMainLoop		*loop;
+	GError			*error;
+	gboolean		 ret;
+} FuPluginUefiUpdateHelper;
+
+static void
+fu_plugin_uefi_update_thread_cb (GTask *task,
+				 gpointer source_object,
+				 gpointer task_data,
+				 GCancellable *cancellable)
+{
+	FuPluginUefiUpdateHelper *helper = (FuPluginUefiUpdateHelper *) task_data;
+	int rc;
+
+	/* this stages the capsule to the ESP and sets the EFI variables,
+	 * which for a large capsule can take a long time */
+	rc = fwup_set_up_update_with_buf (helper->re,
+					  helper->hardware_instance,
+					  g_bytes_get_data (helper->blob_fw, NULL),
+					  g_bytes_get_size (helper->blob_fw));
+	if (rc < 0) {
+		g_task_return_new_error (task,
+					 FWUPD_ERROR,
+					 FWUPD_ERROR_NOT_SUPPORTED,
+					 "UEFI firmware update failed: %s",
+					 strerror (rc));
+		return;
+	}
+	g_task_return_boolean (task, TRUE);
+}
+
+static void
+fu_plugin_uefi_update_done_cb (GObject *source_object,
+			       GAsyncResult *res,
+			       gpointer user_data)
+{
+	FuPluginUefiUpdateHelper *helper = (FuPluginUefiUpdateHelper *) user_data;
+	helper->ret = g_task_propagate_boolean (G_TASK (res), &helper->error);
+	g_main_loop_quit (helper->loop);
+}
+
 gboolean
 fu_plugin_update_offline (FuPlugin *plugin,
 			  FuDevice *device,
@@ -176,35 +298,46 @@ fu_plugin_update_offline (FuPlugin *plugin,
 			  FwupdInstallFlags flags,
 			  GError **error)
 {
-	g_autoptr(GError) error_local = NULL;
-	fwup_resource *re = NULL;
+	FuPluginUefiUpdateHelper helper;
 	guint64 hardware_instance = 0;	/* FIXME */
-	int rc;
 	g_autoptr(fwup_resource_iter) iter = NULL;
+	g_autoptr(GMainLoop) loop = NULL;
+	g_autoptr(GTask) task = NULL;
 	const gchar *str;
 
 	/* get the hardware we're referencing */
 	fwup_resource_iter_create (&iter);
-	re = fu_plugin_uefi_find (iter, fu_device_get_guid_default (device), error);
-	if (re == NULL)
+	helper.re = fu_plugin_uefi_find (iter, fu_device_get_guid_default (device), error);
+	if (helper.re == NULL)
+		return FALSE;
+
+	/* cheap header-only checks catch a truncated or wrong-SKU capsule
+	 * before any of the multi-hundred-MB copy to the ESP has happened */
+	if (!fu_plugin_uefi_check_capsule_header (blob_fw,
+						  fu_device_get_guid_default (device),
+						  error))
 		return FALSE;
 
 	/* TRANSLATORS: this is shown when updating the firmware after the reboot */
 	str = _("Installing firmware update…");
 	g_assert (str != NULL);
 
-	/* perform the update */
+	/* stage the capsule on a worker thread so the daemon can keep
+	 * servicing requests during the multi-hundred-MB copy to the ESP */
 	g_debug ("Performing UEFI capsule update");
 	fu_plugin_set_status (plugin, FWUPD_STATUS_SCHEDULING);
-	rc = fwup_set_up_update_with_buf (re, hardware_instance,
-					  g_bytes_get_data (blob_fw, NULL),
-					  g_bytes_get_size (blob_fw));
-	if (rc < 0) {
-		g_set_error (error,
-			     FWUPD_ERROR,
-			     FWUPD_ERROR_NOT_SUPPORTED,
-			     "UEFI firmware update failed: %s",
-			     strerror (rc));
+	loop = g_main_loop_new (NULL, FALSE);
+	helper.hardware_instance = hardware_instance;
+	helper.blob_fw = blob_fw;
+	helper.loop = loop;
+	helper.error = NULL;
+	helper.ret = FALSE;
+	task = g_task_new (NULL, NULL, fu_plugin_uefi_update_done_cb, &helper);
+	g_task_set_task_data (task, &helper, NULL);
+	g_task_run_in_thread (task, fu_plugin_uefi_update_thread_cb);
+	g_main_loop_run (loop);
+	if (!helper.ret) {
+		g_propagate_error (error, helper.error);
 		return FALSE;
 	}
 	return TRUE;
@@ -228,6 +361,134 @@ fu_plugin_uefi_get_version_format (void)
 	return AS_VERSION_PARSE_FLAG_USE_TRIPLET;
 }
 
+#define FU_PLUGIN_UEFI_ESRT_ENTRIES	"/sys/firmware/efi/esrt/entries"
+
+static gint
+fu_plugin_uefi_strcmp_cb (gconstpointer a, gconstpointer b)
+{
+	return g_strcmp0 (*(const gchar **) a, *(const gchar **) b);
+}
+
+/* checksum the sysfs ESRT, which is cheap to read; the expensive part of
+ * the fwup walk is the efivar read behind each resource */
+static gchar *
+fu_plugin_uefi_esrt_checksum (void)
+{
+	const gchar *attrs[] = { "fw_class",
+				 "fw_version",
+				 "lowest_supported_fw_version",
+				 "last_attempt_version",
+				 "last_attempt_status",
+				 NULL };
+	const gchar *fn;
+	g_autoptr(GChecksum) csum = g_checksum_new (G_CHECKSUM_SHA1);
+	g_autoptr(GDir) dir = NULL;
+	g_autoptr(GPtrArray) names = NULL;
+
+	dir = g_dir_open (FU_PLUGIN_UEFI_ESRT_ENTRIES, 0, NULL);
+	if (dir == NULL)
+		return NULL;
+	names = g_ptr_array_new_with_free_func (g_free);
+	while ((fn = g_dir_read_name (dir)) != NULL)
+		g_ptr_array_add (names, g_strdup (fn));
+	if (names->len == 0)
+		return NULL;
+	g_ptr_array_sort (names, fu_plugin_uefi_strcmp_cb);
+	for (guint i = 0; i < names->len; i++) {
+		const gchar *name = g_ptr_array_index (names, i);
+		g_checksum_update (csum, (const guchar *) name, -1);
+		for (guint j = 0; attrs[j] != NULL; j++) {
+			g_autofree gchar *data = NULL;
+			g_autofree gchar *fn_attr = NULL;
+			fn_attr = g_build_filename (FU_PLUGIN_UEFI_ESRT_ENTRIES,
+						    name, attrs[j], NULL);
+			if (g_file_get_contents (fn_attr, &data, NULL, NULL))
+				g_checksum_update (csum, (const guchar *) data, -1);
+		}
+	}
+	return g_strdup (g_checksum_get_string (csum));
+}
+
+static gchar *
+fu_plugin_uefi_cache_fn (void)
+{
+	return g_build_filename (LOCALSTATEDIR, "lib", "fwupd", "uefi.cache", NULL);
+}
+
+static gboolean
+fu_plugin_uefi_coldplug_from_cache (FuPlugin *plugin,
+				    const gchar *esrt_csum,
+				    const gchar *display_name)
+{
+	g_autofree gchar *fn = fu_plugin_uefi_cache_fn ();
+	g_auto(GStrv) guids = NULL;
+	g_auto(GStrv) ids = NULL;
+	g_auto(GStrv) versions = NULL;
+	g_auto(GStrv) versions_lowest = NULL;
+	g_autoptr(GKeyFile) kf = g_key_file_new ();
+
+	if (!g_key_file_load_from_file (kf, fn, G_KEY_FILE_NONE, NULL))
+		return FALSE;
+	ids = g_key_file_get_string_list (kf, esrt_csum, "Ids", NULL, NULL);
+	guids = g_key_file_get_string_list (kf, esrt_csum, "Guids", NULL, NULL);
+	versions = g_key_file_get_string_list (kf, esrt_csum, "Versions", NULL, NULL);
+	versions_lowest = g_key_file_get_string_list (kf, esrt_csum, "VersionsLowest", NULL, NULL);
+	if (ids == NULL || guids == NULL ||
+	    versions == NULL || versions_lowest == NULL)
+		return FALSE;
+	if (g_strv_length (ids) != g_strv_length (guids) ||
+	    g_strv_length (ids) != g_strv_length (versions) ||
+	    g_strv_length (ids) != g_strv_length (versions_lowest))
+		return FALSE;
+	for (guint i = 0; ids[i] != NULL; i++) {
+		g_autoptr(FuDevice) dev = fu_device_new ();
+		fu_device_set_id (dev, ids[i]);
+		fu_device_add_guid (dev, guids[i]);
+		fu_device_set_version (dev, versions[i]);
+		if (display_name != NULL)
+			fu_device_set_name (dev, display_name);
+		if (versions_lowest[i][0] != '\0')
+			fu_device_set_version_lowest (dev, versions_lowest[i]);
+		fu_device_add_flag (dev, FWUPD_DEVICE_FLAG_INTERNAL);
+		fu_device_add_flag (dev, FWUPD_DEVICE_FLAG_ALLOW_OFFLINE);
+		fu_device_add_flag (dev, FWUPD_DEVICE_FLAG_REQUIRE_AC);
+		fu_plugin_device_add (plugin, dev);
+	}
+	return TRUE;
+}
+
+static void
+fu_plugin_uefi_cache_save (const gchar *esrt_csum,
+			   GPtrArray *ids,
+			   GPtrArray *guids,
+			   GPtrArray *versions,
+			   GPtrArray *versions_lowest)
+{
+	g_autofree gchar *dirname = NULL;
+	g_autofree gchar *fn = fu_plugin_uefi_cache_fn ();
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GKeyFile) kf = g_key_file_new ();
+
+	/* write a fresh file so stale generations self-expire when the
+	 * ESRT changes; not being able to save is not fatal, just slow */
+	g_key_file_set_string_list (kf, esrt_csum, "Ids",
+				    (const gchar * const *) ids->pdata, ids->len);
+	g_key_file_set_string_list (kf, esrt_csum, "Guids",
+				    (const gchar * const *) guids->pdata, guids->len);
+	g_key_file_set_string_list (kf, esrt_csum, "Versions",
+				    (const gchar * const *) versions->pdata, versions->len);
+	g_key_file_set_string_list (kf, esrt_csum, "VersionsLowest",
+				    (const gchar * const *) versions_lowest->pdata,
+				    versions_lowest->len);
+	dirname = g_path_get_dirname (fn);
+	if (g_mkdir_with_parents (dirname, 0755) != 0) {
+		g_debug ("failed to create %s", dirname);
+		return;
+	}
+	if (!g_key_file_save_to_file (kf, fn, &error_local))
+		g_debug ("failed to save %s: %s", fn, error_local->message);
+}
+
 gboolean
 fu_plugin_unlock (FuPlugin *plugin,
 			 FuDevice *device,
@@ -266,9 +527,14 @@ fu_plugin_coldplug (FuPlugin *plugin, GError **error)
 	g_autofree gchar *display_name = NULL;
 	fwup_resource *re;
 	gint supported;
+	g_autofree gchar *esrt_csum = NULL;
 	g_autofree gchar *guid = NULL;
 	g_autoptr(FuDevice) dev = NULL;
 	g_autoptr(fwup_resource_iter) iter = NULL;
+	g_autoptr(GPtrArray) cache_guids = NULL;
+	g_autoptr(GPtrArray) cache_ids = NULL;
+	g_autoptr(GPtrArray) cache_versions = NULL;
+	g_autoptr(GPtrArray) cache_versions_lowest = NULL;
 
 	/* supported = 0 : ESRT unspported
 	   supported = 1 : unlocked, ESRT supported
@@ -296,6 +562,23 @@ fu_plugin_coldplug (FuPlugin *plugin, GError **error)
 		return TRUE;
 	}
 
+	/* set Display Name to the system for all capsules */
+	if (g_file_get_contents ("/sys/class/dmi/id/product_name",
+				 &display_name, NULL, NULL)) {
+		if (display_name != NULL)
+			g_strchomp (display_name);
+	}
+
+	/* the ESRT only changes when the firmware does, so serve the
+	 * resource list from the cache and skip the efivar walk when the
+	 * sysfs copy is unchanged */
+	esrt_csum = fu_plugin_uefi_esrt_checksum ();
+	if (esrt_csum != NULL &&
+	    fu_plugin_uefi_coldplug_from_cache (plugin, esrt_csum, display_name)) {
+		g_debug ("ESRT unchanged, using cached resource list");
+		return TRUE;
+	}
+
 	/* this can fail if we have no permissions */
 	if (fwup_resource_iter_create (&iter) < 0) {
 		g_set_error_literal (error,
@@ -305,16 +588,13 @@ fu_plugin_coldplug (FuPlugin *plugin, GError **error)
 		return FALSE;
 	}
 
-	/* set Display Name to the system for all capsules */
-	if (g_file_get_contents ("/sys/class/dmi/id/product_name",
-				 &display_name, NULL, NULL)) {
-		if (display_name != NULL)
-			g_strchomp (display_name);
-	}
-
 	/* add each device */
 	guid = g_strdup ("00000000-0000-0000-0000-000000000000");
 	parse_flags = fu_plugin_uefi_get_version_format ();
+	cache_ids = g_ptr_array_new_with_free_func (g_free);
+	cache_guids = g_ptr_array_new_with_free_func (g_free);
+	cache_versions = g_ptr_array_new_with_free_func (g_free);
+	cache_versions_lowest = g_ptr_array_new_with_free_func (g_free);
 	while (fwup_resource_iter_next (iter, &re) > 0) {
 		efi_guid_t *guid_raw;
 		guint32 version_raw;
@@ -351,6 +631,20 @@ fu_plugin_coldplug (FuPlugin *plugin, GError **error)
 		fu_device_add_flag (dev, FWUPD_DEVICE_FLAG_ALLOW_OFFLINE);
 		fu_device_add_flag (dev, FWUPD_DEVICE_FLAG_REQUIRE_AC);
 		fu_plugin_device_add (plugin, dev);
+
+		/* remember for next startup */
+		g_ptr_array_add (cache_ids, g_strdup (id));
+		g_ptr_array_add (cache_guids, g_strdup (guid));
+		g_ptr_array_add (cache_versions, g_strdup (version));
+		g_ptr_array_add (cache_versions_lowest,
+				 g_strdup (version_lowest != NULL ? version_lowest : ""));
+	}
+	if (esrt_csum != NULL) {
+		fu_plugin_uefi_cache_save (esrt_csum,
+					   cache_ids,
+					   cache_guids,
+					   cache_versions,
+					   cache_versions_lowest);
 	}
 	return TRUE;
 }
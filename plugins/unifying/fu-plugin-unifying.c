@@ -36,6 +36,132 @@ struct FuPluginData {
 	gboolean		 ignore_replug;
 };
 
+static gchar *
+fu_plugin_unifying_get_cache_fn (void)
+{
+	return g_build_filename (LOCALSTATEDIR, "lib", "fwupd",
+				 "unifying.cache", NULL);
+}
+
+static void
+fu_plugin_unifying_cache_save (LuDevice *device)
+{
+	GPtrArray *guids;
+	const gchar *group;
+	const gchar *tmp;
+	g_autofree const gchar **guids_strv = NULL;
+	g_autofree gchar *dirname = NULL;
+	g_autofree gchar *fn = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GKeyFile) keyfile = g_key_file_new ();
+
+	/* only paired peripherals are expensive to re-query */
+	if (lu_device_get_kind (device) != LU_DEVICE_KIND_PERIPHERAL)
+		return;
+
+	/* load any existing inventory */
+	fn = fu_plugin_unifying_get_cache_fn ();
+	dirname = g_path_get_dirname (fn);
+	if (g_mkdir_with_parents (dirname, 0755) != 0) {
+		g_warning ("failed to create %s", dirname);
+		return;
+	}
+	g_key_file_load_from_file (keyfile, fn, G_KEY_FILE_KEEP_COMMENTS, NULL);
+
+	/* save everything needed to register the device */
+	group = lu_device_get_platform_id (device);
+	tmp = lu_device_get_product (device);
+	if (tmp != NULL)
+		g_key_file_set_string (keyfile, group, "Product", tmp);
+	tmp = lu_device_get_vendor (device);
+	if (tmp != NULL)
+		g_key_file_set_string (keyfile, group, "Vendor", tmp);
+	tmp = lu_device_get_version_fw (device);
+	if (tmp != NULL)
+		g_key_file_set_string (keyfile, group, "VersionFw", tmp);
+	tmp = lu_device_get_version_bl (device);
+	if (tmp != NULL)
+		g_key_file_set_string (keyfile, group, "VersionBl", tmp);
+	g_key_file_set_boolean (keyfile, group, "CanFlash",
+				lu_device_has_flag (device, LU_DEVICE_FLAG_CAN_FLASH));
+	guids = lu_device_get_guids (device);
+	if (guids->len > 0) {
+		guids_strv = g_new0 (const gchar *, guids->len + 1);
+		for (guint i = 0; i < guids->len; i++)
+			guids_strv[i] = g_ptr_array_index (guids, i);
+		g_key_file_set_string_list (keyfile, group, "Guids",
+					    guids_strv, guids->len);
+	}
+	if (!g_key_file_save_to_file (keyfile, fn, &error))
+		g_warning ("failed to save peripheral inventory: %s",
+			   error->message);
+}
+
+static void
+fu_plugin_unifying_cache_invalidate (LuDevice *device)
+{
+	g_autofree gchar *fn = fu_plugin_unifying_get_cache_fn ();
+	g_autoptr(GKeyFile) keyfile = g_key_file_new ();
+	if (!g_key_file_load_from_file (keyfile, fn, G_KEY_FILE_KEEP_COMMENTS, NULL))
+		return;
+	if (!g_key_file_remove_group (keyfile, lu_device_get_platform_id (device), NULL))
+		return;
+	g_key_file_save_to_file (keyfile, fn, NULL);
+}
+
+static gboolean
+fu_plugin_unifying_device_added_from_cache (FuPlugin *plugin, LuDevice *device)
+{
+	const gchar *group;
+	g_autofree gchar *fn = NULL;
+	g_autofree gchar *product = NULL;
+	g_autofree gchar *vendor = NULL;
+	g_autofree gchar *version_bl = NULL;
+	g_autofree gchar *version_fw = NULL;
+	g_auto(GStrv) guids = NULL;
+	g_autoptr(FuDevice) dev = NULL;
+	g_autoptr(GKeyFile) keyfile = g_key_file_new ();
+
+	/* only peripherals are cached */
+	if (lu_device_get_kind (device) != LU_DEVICE_KIND_PERIPHERAL)
+		return FALSE;
+
+	/* do we have enough saved state to register without probing */
+	fn = fu_plugin_unifying_get_cache_fn ();
+	if (!g_key_file_load_from_file (keyfile, fn, G_KEY_FILE_NONE, NULL))
+		return FALSE;
+	group = lu_device_get_platform_id (device);
+	if (!g_key_file_has_group (keyfile, group))
+		return FALSE;
+	product = g_key_file_get_string (keyfile, group, "Product", NULL);
+	version_fw = g_key_file_get_string (keyfile, group, "VersionFw", NULL);
+	if (product == NULL || version_fw == NULL)
+		return FALSE;
+
+	/* create new FuDevice without opening the receiver */
+	dev = fu_device_new ();
+	if (g_key_file_get_boolean (keyfile, group, "CanFlash", NULL))
+		fu_device_add_flag (dev, FWUPD_DEVICE_FLAG_ALLOW_ONLINE);
+	fu_device_set_id (dev, group);
+	fu_device_set_name (dev, product);
+	vendor = g_key_file_get_string (keyfile, group, "Vendor", NULL);
+	if (vendor != NULL)
+		fu_device_set_vendor (dev, vendor);
+	fu_device_set_version (dev, version_fw);
+	version_bl = g_key_file_get_string (keyfile, group, "VersionBl", NULL);
+	if (version_bl != NULL)
+		fu_device_set_version_bootloader (dev, version_bl);
+	guids = g_key_file_get_string_list (keyfile, group, "Guids", NULL, NULL);
+	for (guint i = 0; guids != NULL && guids[i] != NULL; i++)
+		fu_device_add_guid (dev, guids[i]);
+
+	/* insert to hash */
+	g_debug ("restored %s from the peripheral inventory", group);
+	fu_plugin_device_add (plugin, dev);
+	fu_plugin_cache_add (plugin, fu_device_get_id (dev), dev);
+	return TRUE;
+}
+
 static gboolean
 fu_plugin_unifying_device_added (FuPlugin *plugin,
 				 LuDevice *device,
@@ -78,9 +204,66 @@ fu_plugin_unifying_device_added (FuPlugin *plugin,
 	/* insert to hash */
 	fu_plugin_device_add (plugin, dev);
 	fu_plugin_cache_add (plugin, fu_device_get_id (dev), dev);
+
+	/* save the probe results for the next coldplug */
+	fu_plugin_unifying_cache_save (device);
 	return TRUE;
 }
 
+typedef struct {
+	FuPlugin		*plugin;
+	LuDevice		*device;
+} FuPluginUnifyingRefreshHelper;
+
+static gboolean
+fu_plugin_unifying_refresh_cb (gpointer user_data)
+{
+	FuPluginUnifyingRefreshHelper *helper = (FuPluginUnifyingRefreshHelper *) user_data;
+	FuPlugin *plugin = helper->plugin;
+	LuDevice *device = helper->device;
+	FuDevice *dev;
+	const gchar *platform_id = lu_device_get_platform_id (device);
+	g_autoptr(GError) error = NULL;
+
+	/* re-probe; an unpaired or replaced peripheral invalidates the
+	 * registration we restored from the inventory */
+	dev = fu_plugin_cache_lookup (plugin, platform_id);
+	if (!lu_device_open (device, &error)) {
+		g_warning ("failed to verify %s, dropping from inventory: %s",
+			   platform_id, error->message);
+		if (dev != NULL) {
+			fu_plugin_device_remove (plugin, dev);
+			fu_plugin_cache_remove (plugin, platform_id);
+		}
+		fu_plugin_unifying_cache_invalidate (device);
+		goto out;
+	}
+
+	/* the saved state still matches the hardware */
+	if (dev != NULL &&
+	    g_strcmp0 (fu_device_get_version (dev),
+		       lu_device_get_version_fw (device)) == 0 &&
+	    g_strcmp0 (fu_device_get_name (dev),
+		       lu_device_get_product (device)) == 0) {
+		lu_device_close (device, NULL);
+		goto out;
+	}
+
+	/* stale, so replace with the freshly probed state */
+	g_debug ("inventory for %s was stale, re-registering", platform_id);
+	if (dev != NULL) {
+		fu_plugin_device_remove (plugin, dev);
+		fu_plugin_cache_remove (plugin, platform_id);
+	}
+	lu_device_close (device, NULL);
+	if (!fu_plugin_unifying_device_added (plugin, device, &error))
+		g_warning ("failed to re-add %s: %s", platform_id, error->message);
+out:
+	g_object_unref (helper->device);
+	g_free (helper);
+	return FALSE;
+}
+
 static void
 lu_write_progress_cb (goffset current, goffset total, gpointer user_data)
 {
@@ -186,6 +369,19 @@ fu_plugin_unifying_device_added_cb (LuContext *ctx,
 	if (data->ignore_replug)
 		return;
 
+	/* register from the saved inventory and verify lazily, so coldplug
+	 * does not have to round-trip through the receiver */
+	if (fu_plugin_unifying_device_added_from_cache (plugin, device)) {
+		FuPluginUnifyingRefreshHelper *helper;
+		helper = g_new0 (FuPluginUnifyingRefreshHelper, 1);
+		helper->plugin = plugin;
+		helper->device = g_object_ref (device);
+		g_idle_add_full (G_PRIORITY_LOW,
+				 fu_plugin_unifying_refresh_cb,
+				 helper, NULL);
+		return;
+	}
+
 	/* add */
 	if (!fu_plugin_unifying_device_added (plugin, device, &error)) {
 		if (!g_error_matches (error,
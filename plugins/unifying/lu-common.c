@@ -51,9 +51,18 @@ lu_buffer_read_uint16 (const gchar *str)
 void
 lu_dump_raw (const gchar *title, const guint8 *data, gsize len)
 {
-	g_autoptr(GString) str = g_string_new (NULL);
-	if (len == 0)
+	static gint verbose = -1;
+	g_autoptr(GString) str = NULL;
+
+	/* formatting the hex dump costs more than most of the exchanges it
+	 * describes, so skip it outright unless verbose logging is on */
+	if (verbose == -1) {
+		verbose = g_getenv ("VERBOSE") != NULL ||
+			  g_getenv ("G_MESSAGES_DEBUG") != NULL;
+	}
+	if (!verbose || len == 0)
 		return;
+	str = g_string_new (NULL);
 	g_string_append_printf (str, "%s:", title);
 	for (gsize i = strlen (title); i < 16; i++)
 		g_string_append (str, " ");
@@ -88,8 +97,8 @@ lu_nonblock_flush (gint fd, GError **error)
 		},
 	};
 	while (g_poll (poll, G_N_ELEMENTS(poll), 0) > 0) {
-		gchar c;
-		gint r = read (fd, &c, 1);
+		guint8 buf[64];
+		gssize r = read (fd, buf, sizeof (buf));
 		if (r < 0 && errno != EINTR)
 			break;
 	}
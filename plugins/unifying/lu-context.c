@@ -474,6 +474,48 @@ lu_context_init (LuContext *ctx)
 						  g_free, NULL);
 }
 
+/* each paired peripheral has its own hidraw node, so the multi-ms HID++
+ * exchanges for different peripherals can run at the same time */
+#define LU_CONTEXT_PROBE_MAX_THREADS	4
+
+static void
+lu_context_probe_device_cb (gpointer data, gpointer user_data)
+{
+	LuDevice *device = LU_DEVICE (data);
+	g_autoptr(GError) error = NULL;
+	if (!lu_device_open (device, &error)) {
+		g_debug ("failed to open %s: %s",
+			 lu_device_get_platform_id (device),
+			 error->message);
+	}
+}
+
+static void
+lu_context_probe_peripherals (LuContext *ctx)
+{
+	GThreadPool *pool;
+
+	pool = g_thread_pool_new (lu_context_probe_device_cb, ctx,
+				  LU_CONTEXT_PROBE_MAX_THREADS, FALSE, NULL);
+	for (guint i = 0; i < ctx->devices->len; i++) {
+		LuDevice *device = g_ptr_array_index (ctx->devices, i);
+		if (lu_device_get_kind (device) != LU_DEVICE_KIND_PERIPHERAL)
+			continue;
+
+		/* queue up the flags notifications so the added signals
+		 * all fire back on this thread once the workers are done */
+		g_object_freeze_notify (G_OBJECT (device));
+		g_thread_pool_push (pool, device, NULL);
+	}
+	g_thread_pool_free (pool, FALSE, TRUE);
+	for (guint i = 0; i < ctx->devices->len; i++) {
+		LuDevice *device = g_ptr_array_index (ctx->devices, i);
+		if (lu_device_get_kind (device) != LU_DEVICE_KIND_PERIPHERAL)
+			continue;
+		g_object_thaw_notify (G_OBJECT (device));
+	}
+}
+
 void
 lu_context_coldplug (LuContext *ctx)
 {
@@ -492,6 +534,10 @@ lu_context_coldplug (LuContext *ctx)
 		g_object_unref (udev_device);
 	}
 
+	/* probe all the paired peripherals in parallel rather than
+	 * waiting for the first poll tick to walk them one by one */
+	lu_context_probe_peripherals (ctx);
+
 	/* done */
 	ctx->done_coldplug = TRUE;
 }
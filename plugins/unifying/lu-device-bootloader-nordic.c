@@ -121,27 +121,10 @@ lu_device_bootloader_nordic_probe (LuDevice *device, GError **error)
 }
 
 static gboolean
-lu_device_bootloader_nordic_write (LuDevice *device,
-				   guint16 addr, guint8 len, const guint8 *data,
-				   GError **error)
+lu_device_bootloader_nordic_write_check (LuDeviceBootloaderRequest *req,
+					 guint16 addr,
+					 GError **error)
 {
-	g_autoptr(LuDeviceBootloaderRequest) req = lu_device_bootloader_request_new ();
-	req->cmd = LU_DEVICE_BOOTLOADER_CMD_WRITE;
-	req->addr = addr;
-	req->len = len;
-	if (req->len > 28) {
-		g_set_error (error,
-			     G_IO_ERROR,
-			     G_IO_ERROR_FAILED,
-			     "failed to write @%04x: data length too large %02x",
-			     addr, req->len);
-		return FALSE;
-	}
-	memcpy (req->data, data, req->len);
-	if (!lu_device_bootloader_request (device, req, error)) {
-		g_prefix_error (error, "failed to transfer fw @0x%02x: ", addr);
-		return FALSE;
-	}
 	if (req->cmd == LU_DEVICE_BOOTLOADER_CMD_WRITE_INVALID_ADDR) {
 		g_set_error (error,
 			     G_IO_ERROR,
@@ -184,6 +167,51 @@ lu_device_bootloader_nordic_write (LuDevice *device,
 	return TRUE;
 }
 
+static gboolean
+lu_device_bootloader_nordic_write (LuDevice *device,
+				   guint16 addr, guint8 len, const guint8 *data,
+				   GError **error)
+{
+	g_autoptr(LuDeviceBootloaderRequest) req = lu_device_bootloader_request_new ();
+	req->cmd = LU_DEVICE_BOOTLOADER_CMD_WRITE;
+	req->addr = addr;
+	req->len = len;
+	if (req->len > 28) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_FAILED,
+			     "failed to write @%04x: data length too large %02x",
+			     addr, req->len);
+		return FALSE;
+	}
+	memcpy (req->data, data, req->len);
+	if (!lu_device_bootloader_request (device, req, error)) {
+		g_prefix_error (error, "failed to transfer fw @0x%02x: ", addr);
+		return FALSE;
+	}
+	return lu_device_bootloader_nordic_write_check (req, addr, error);
+}
+
+static gboolean
+lu_device_bootloader_nordic_write_batch (LuDevice *device,
+					 GPtrArray *batch,
+					 GError **error)
+{
+	if (batch->len == 0)
+		return TRUE;
+	if (!lu_device_bootloader_request_batch (device, batch, error)) {
+		g_prefix_error (error, "failed to transfer fw: ");
+		return FALSE;
+	}
+	for (guint i = 0; i < batch->len; i++) {
+		LuDeviceBootloaderRequest *req = g_ptr_array_index (batch, i);
+		if (!lu_device_bootloader_nordic_write_check (req, req->addr, error))
+			return FALSE;
+	}
+	g_ptr_array_set_size (batch, 0);
+	return TRUE;
+}
+
 static gboolean
 lu_device_bootloader_nordic_erase (LuDevice *device, guint16 addr, GError **error)
 {
@@ -223,6 +251,7 @@ lu_device_bootloader_nordic_write_firmware (LuDevice *device,
 {
 	const LuDeviceBootloaderRequest *payload;
 	guint16 addr;
+	g_autoptr(GPtrArray) batch = NULL;
 	g_autoptr(GPtrArray) reqs = NULL;
 
 	/* erase firmware pages up to the bootloader */
@@ -233,22 +262,29 @@ lu_device_bootloader_nordic_write_firmware (LuDevice *device,
 			return FALSE;
 	}
 
-	/* transfer payload */
+	/* transfer payload, bursting a window of packets before checking
+	 * the queued write statuses */
 	reqs = lu_device_bootloader_parse_requests (fw, error);
 	if (reqs == NULL)
 		return FALSE;
+	batch = g_ptr_array_new_with_free_func (g_free);
 	for (guint i = 1; i < reqs->len; i++) {
+		LuDeviceBootloaderRequest *req;
 		payload = g_ptr_array_index (reqs, i);
 
 		/* skip the bootloader */
 		if (payload->addr > lu_device_bootloader_get_addr_hi (device))
 			break;
 
-		if (!lu_device_bootloader_nordic_write (device,
-							payload->addr,
-							payload->len,
-							payload->data,
-							error))
+		req = lu_device_bootloader_request_new ();
+		req->cmd = LU_DEVICE_BOOTLOADER_CMD_WRITE;
+		req->addr = payload->addr;
+		req->len = payload->len;
+		memcpy (req->data, payload->data, payload->len);
+		g_ptr_array_add (batch, req);
+		if (batch->len < lu_device_bootloader_get_batchsz (device))
+			continue;
+		if (!lu_device_bootloader_nordic_write_batch (device, batch, error))
 			return FALSE;
 		if (progress_cb != NULL) {
 			progress_cb ((goffset) i * 32,
@@ -256,6 +292,8 @@ lu_device_bootloader_nordic_write_firmware (LuDevice *device,
 				     progress_data);
 		}
 	}
+	if (!lu_device_bootloader_nordic_write_batch (device, batch, error))
+		return FALSE;
 
 	/* send the first managed packet last, excluding the reset vector */
 	payload = g_ptr_array_index (reqs, 0);
@@ -296,4 +334,7 @@ lu_device_bootloader_nordic_class_init (LuDeviceBootloaderNordicClass *klass)
 static void
 lu_device_bootloader_nordic_init (LuDeviceBootloaderNordic *device)
 {
+	/* the Nordic bootloader queues write statuses, so a window of
+	 * payload packets can be streamed before checking the results */
+	lu_device_bootloader_set_batchsz (LU_DEVICE (device), 8);
 }
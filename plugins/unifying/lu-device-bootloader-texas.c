@@ -122,6 +122,49 @@ lu_device_bootloader_texas_clear_ram_buffer (LuDevice *device, guint16 addr, GEr
 	return TRUE;
 }
 
+static gboolean
+lu_device_bootloader_texas_write_ram_buffer_check (LuDeviceBootloaderRequest *req,
+						   GError **error)
+{
+	if (req->cmd == LU_DEVICE_BOOTLOADER_CMD_WRITE_RAM_BUFFER_INVALID_ADDR) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_FAILED,
+			     "failed to write ram buffer @%04x: invalid location",
+			     req->addr);
+		return FALSE;
+	}
+	if (req->cmd == LU_DEVICE_BOOTLOADER_CMD_WRITE_RAM_BUFFER_OVERFLOW) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_FAILED,
+			     "failed to write ram buffer @%04x: invalid size 0x%02x",
+			     req->addr, req->len);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static gboolean
+lu_device_bootloader_texas_write_batch (LuDevice *device,
+					GPtrArray *batch,
+					GError **error)
+{
+	if (batch->len == 0)
+		return TRUE;
+	if (!lu_device_bootloader_request_batch (device, batch, error)) {
+		g_prefix_error (error, "failed to write ram buffer: ");
+		return FALSE;
+	}
+	for (guint i = 0; i < batch->len; i++) {
+		LuDeviceBootloaderRequest *req = g_ptr_array_index (batch, i);
+		if (!lu_device_bootloader_texas_write_ram_buffer_check (req, error))
+			return FALSE;
+	}
+	g_ptr_array_set_size (batch, 0);
+	return TRUE;
+}
+
 static gboolean
 lu_device_bootloader_texas_write_firmware (LuDevice *device,
 					   GBytes *fw,
@@ -130,8 +173,8 @@ lu_device_bootloader_texas_write_firmware (LuDevice *device,
 					   GError **error)
 {
 	const LuDeviceBootloaderRequest *payload;
+	g_autoptr(GPtrArray) batch = NULL;
 	g_autoptr(GPtrArray) reqs = NULL;
-	g_autoptr(LuDeviceBootloaderRequest) req = lu_device_bootloader_request_new ();
 
 	/* transfer payload */
 	reqs = lu_device_bootloader_parse_requests (fw, error);
@@ -146,8 +189,11 @@ lu_device_bootloader_texas_write_firmware (LuDevice *device,
 	if (!lu_device_bootloader_texas_clear_ram_buffer (device, 0x0000, error))
 		return FALSE;
 
-	/* transfer payload */
+	/* transfer payload, bursting the RAM buffer packets for each page
+	 * and only draining the statuses before the page is committed */
+	batch = g_ptr_array_new_with_free_func (g_free);
 	for (guint i = 0; i < reqs->len; i++) {
+		LuDeviceBootloaderRequest *req;
 		payload = g_ptr_array_index (reqs, i);
 
 		/* skip the bootloader */
@@ -173,36 +219,22 @@ lu_device_bootloader_texas_write_firmware (LuDevice *device,
 		}
 
 		/* build packet */
+		req = lu_device_bootloader_request_new ();
 		req->cmd = LU_DEVICE_BOOTLOADER_CMD_WRITE_RAM_BUFFER;
 		req->addr = payload->addr % 0x80;
 		req->len = payload->len;
 		memcpy (req->data, payload->data, payload->len);
-		if (!lu_device_bootloader_request (device, req, error)) {
-			g_prefix_error (error,
-					"failed to write ram bufer @0x%02x: ",
-					req->addr);
-			return FALSE;
-		}
-		if (req->cmd == LU_DEVICE_BOOTLOADER_CMD_WRITE_RAM_BUFFER_INVALID_ADDR) {
-			g_set_error (error,
-				     G_IO_ERROR,
-				     G_IO_ERROR_FAILED,
-				     "failed to write ram buffer @%04x: invalid location",
-				     req->addr);
-			return FALSE;
-		}
-		if (req->cmd == LU_DEVICE_BOOTLOADER_CMD_WRITE_RAM_BUFFER_OVERFLOW) {
-			g_set_error (error,
-				     G_IO_ERROR,
-				     G_IO_ERROR_FAILED,
-				     "failed to write ram buffer @%04x: invalid size 0x%02x",
-				     req->addr, req->len);
-			return FALSE;
+		g_ptr_array_add (batch, req);
+		if (batch->len >= lu_device_bootloader_get_batchsz (device)) {
+			if (!lu_device_bootloader_texas_write_batch (device, batch, error))
+				return FALSE;
 		}
 
 		/* flush RAM buffer to EEPROM */
 		if ((payload->addr + 0x10) % 0x80 == 0) {
 			guint16 addr_start = payload->addr - (7 * 0x10);
+			if (!lu_device_bootloader_texas_write_batch (device, batch, error))
+				return FALSE;
 			g_debug ("addr flush @ 0x%04x for 0x%04x",
 				 payload->addr, addr_start);
 			if (!lu_device_bootloader_texas_flash_ram_buffer (device,
@@ -223,6 +255,10 @@ lu_device_bootloader_texas_write_firmware (LuDevice *device,
 		}
 	}
 
+	/* drain anything left in the RAM buffer */
+	if (!lu_device_bootloader_texas_write_batch (device, batch, error))
+		return FALSE;
+
 	/* check CRC */
 	if (!lu_device_bootloader_texas_compute_and_test_crc (device, error))
 		return FALSE;
@@ -282,4 +318,7 @@ lu_device_bootloader_texas_class_init (LuDeviceBootloaderTexasClass *klass)
 static void
 lu_device_bootloader_texas_init (LuDeviceBootloaderTexas *device)
 {
+	/* a full EEPROM page is 8 packets of 16 bytes, all buffered in RAM
+	 * before the flush so the whole page can be streamed in one burst */
+	lu_device_bootloader_set_batchsz (LU_DEVICE (device), 8);
 }
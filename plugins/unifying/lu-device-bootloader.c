@@ -32,6 +32,7 @@ typedef struct
 	guint16			 flash_addr_lo;
 	guint16			 flash_addr_hi;
 	guint16			 flash_blocksize;
+	guint			 req_batchsz;
 } LuDeviceBootloaderPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (LuDeviceBootloader, lu_device_bootloader, LU_TYPE_DEVICE)
@@ -121,6 +122,25 @@ lu_device_bootloader_get_blocksize (LuDevice *device)
 	return priv->flash_blocksize;
 }
 
+guint
+lu_device_bootloader_get_batchsz (LuDevice *device)
+{
+	LuDeviceBootloader *device_bootloader = LU_DEVICE_BOOTLOADER (device);
+	LuDeviceBootloaderPrivate *priv = GET_PRIVATE (device_bootloader);
+	g_return_val_if_fail (LU_IS_DEVICE (device), 1);
+	return priv->req_batchsz;
+}
+
+void
+lu_device_bootloader_set_batchsz (LuDevice *device, guint batchsz)
+{
+	LuDeviceBootloader *device_bootloader = LU_DEVICE_BOOTLOADER (device);
+	LuDeviceBootloaderPrivate *priv = GET_PRIVATE (device_bootloader);
+	g_return_if_fail (LU_IS_DEVICE (device));
+	g_return_if_fail (batchsz > 0);
+	priv->req_batchsz = batchsz;
+}
+
 static gboolean
 lu_device_bootloader_attach (LuDevice *device, GError **error)
 {
@@ -193,15 +213,14 @@ lu_device_bootloader_close (LuDevice *device, GError **error)
 	return TRUE;
 }
 
-gboolean
-lu_device_bootloader_request (LuDevice *device,
-			      LuDeviceBootloaderRequest *req,
-			      GError **error)
+static gboolean
+lu_device_bootloader_request_send (LuDevice *device,
+				   LuDeviceBootloaderRequest *req,
+				   GError **error)
 {
 	GUsbDevice *usb_device = lu_device_get_usb_device (device);
 	gsize actual_length = 0;
 	guint8 buf_request[32];
-	guint8 buf_response[32];
 
 	/* build packet */
 	memset (buf_request, 0x00, sizeof (buf_request));
@@ -214,7 +233,6 @@ lu_device_bootloader_request (LuDevice *device,
 	/* send request */
 	lu_dump_raw ("host->device", buf_request, sizeof (buf_request));
 	if (usb_device != NULL) {
-		g_autofree guint8 *data_in_buf = g_memdup (buf_request, sizeof (buf_request));
 		if (!g_usb_device_control_transfer (usb_device,
 						    G_USB_DEVICE_DIRECTION_HOST_TO_DEVICE,
 						    G_USB_DEVICE_REQUEST_TYPE_CLASS,
@@ -231,10 +249,17 @@ lu_device_bootloader_request (LuDevice *device,
 			return FALSE;
 		}
 	}
+	return TRUE;
+}
 
-	/* no response required or expected */
-	if (req->cmd == LU_DEVICE_BOOTLOADER_CMD_REBOOT)
-		return TRUE;
+static gboolean
+lu_device_bootloader_request_recv (LuDevice *device,
+				   LuDeviceBootloaderRequest *req,
+				   GError **error)
+{
+	GUsbDevice *usb_device = lu_device_get_usb_device (device);
+	gsize actual_length = 0;
+	guint8 buf_response[32];
 
 	/* get response */
 	memset (buf_response, 0x00, sizeof (buf_response));
@@ -252,7 +277,7 @@ lu_device_bootloader_request (LuDevice *device,
 		}
 	} else {
 		/* emulated */
-		buf_response[0] = buf_request[0];
+		buf_response[0] = req->cmd;
 		if (buf_response[0] == LU_DEVICE_BOOTLOADER_CMD_GET_MEMINFO) {
 			buf_response[3] = 0x06; /* len */
 			buf_response[4] = 0x40; /* lo MSB */
@@ -291,9 +316,118 @@ lu_device_bootloader_request (LuDevice *device,
 	return TRUE;
 }
 
+gboolean
+lu_device_bootloader_request (LuDevice *device,
+			      LuDeviceBootloaderRequest *req,
+			      GError **error)
+{
+	if (!lu_device_bootloader_request_send (device, req, error))
+		return FALSE;
+
+	/* no response required or expected */
+	if (req->cmd == LU_DEVICE_BOOTLOADER_CMD_REBOOT)
+		return TRUE;
+
+	return lu_device_bootloader_request_recv (device, req, error);
+}
+
+static gboolean
+lu_device_bootloader_request_burst (LuDevice *device,
+				    LuDeviceBootloaderRequest **reqs,
+				    guint reqs_sz,
+				    GError **error)
+{
+	/* stream the whole window of requests before draining any of the
+	 * responses; the bootloader queues one response per request so the
+	 * status for each packet is still verified, just up to a window
+	 * late rather than costing a USB round-trip per packet */
+	for (guint i = 0; i < reqs_sz; i++) {
+		if (!lu_device_bootloader_request_send (device, reqs[i], error))
+			return FALSE;
+	}
+	for (guint i = 0; i < reqs_sz; i++) {
+		if (!lu_device_bootloader_request_recv (device, reqs[i], error))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static void
+lu_device_bootloader_request_drain (LuDevice *device)
+{
+	GUsbDevice *usb_device = lu_device_get_usb_device (device);
+	gsize actual_length = 0;
+	guint8 buf_response[32];
+
+	/* discard any responses still queued from a failed burst so a
+	 * replay pairs each request with its own response again */
+	if (usb_device == NULL)
+		return;
+	while (g_usb_device_interrupt_transfer (usb_device,
+						LU_DEVICE_EP1,
+						buf_response,
+						sizeof (buf_response),
+						&actual_length,
+						LU_DEVICE_DRAIN_TIMEOUT_MS,
+						NULL,
+						NULL)) {
+		lu_dump_raw ("device->host (drained)",
+			     buf_response, actual_length);
+	}
+}
+
+static gboolean
+lu_device_bootloader_request_bisect (LuDevice *device,
+				     LuDeviceBootloaderRequest **reqs,
+				     guint reqs_sz,
+				     GError **error)
+{
+	g_autoptr(GError) error_local = NULL;
+
+	/* common case */
+	if (lu_device_bootloader_request_burst (device, reqs, reqs_sz, &error_local))
+		return TRUE;
+	lu_device_bootloader_request_drain (device);
+
+	/* cannot split any further, so the failure is real */
+	if (reqs_sz == 1) {
+		g_propagate_error (error, g_steal_pointer (&error_local));
+		return FALSE;
+	}
+
+	/* replay each half of the window on its own; the RAM buffer writes
+	 * are idempotent so re-sending the packets that did land is safe */
+	g_debug ("burst of %u packets failed, bisecting: %s",
+		 reqs_sz, error_local->message);
+	if (!lu_device_bootloader_request_bisect (device, reqs,
+						  reqs_sz / 2, error))
+		return FALSE;
+	return lu_device_bootloader_request_bisect (device,
+						    reqs + reqs_sz / 2,
+						    reqs_sz - reqs_sz / 2,
+						    error);
+}
+
+gboolean
+lu_device_bootloader_request_batch (LuDevice *device,
+				    GPtrArray *reqs,
+				    GError **error)
+{
+	if (reqs->len == 0)
+		return TRUE;
+	return lu_device_bootloader_request_bisect (device,
+						    (LuDeviceBootloaderRequest **) reqs->pdata,
+						    reqs->len,
+						    error);
+}
+
 static void
 lu_device_bootloader_init (LuDeviceBootloader *device)
 {
+	LuDeviceBootloaderPrivate *priv = GET_PRIVATE (device);
+
+	/* no batching unless the subclass opts in */
+	priv->req_batchsz = 1;
 }
 
 static void
@@ -89,10 +89,16 @@ GPtrArray	*lu_device_bootloader_parse_requests	(GBytes		*fw,
 gboolean	 lu_device_bootloader_request		(LuDevice	*device,
 							 LuDeviceBootloaderRequest *req,
 							 GError		**error);
+gboolean	 lu_device_bootloader_request_batch	(LuDevice	*device,
+							 GPtrArray	*reqs,
+							 GError		**error);
 
 guint16		 lu_device_bootloader_get_addr_lo	(LuDevice	*device);
 guint16		 lu_device_bootloader_get_addr_hi	(LuDevice	*device);
 guint16		 lu_device_bootloader_get_blocksize	(LuDevice	*device);
+guint		 lu_device_bootloader_get_batchsz	(LuDevice	*device);
+void		 lu_device_bootloader_set_batchsz	(LuDevice	*device,
+							 guint		 batchsz);
 
 G_END_DECLS
 
@@ -304,21 +304,59 @@ lu_device_hidpp_receive (LuDevice *device,
 	return TRUE;
 }
 
+static gboolean
+lu_device_hidpp_msg_is_notification (LuDeviceHidppMsg *msg)
+{
+	if (msg->report_id != HIDPP_REPORT_ID_SHORT)
+		return FALSE;
+	switch (msg->sub_id) {
+	case HIDPP_SUBID_DEVICE_CONNECTION:
+	case HIDPP_SUBID_DEVICE_DISCONNECTION:
+	case HIDPP_SUBID_DEVICE_LOCKING_CHANGED:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
 gboolean
 lu_device_hidpp_transfer (LuDevice *device, LuDeviceHidppMsg *msg, GError **error)
 {
 	LuDevicePrivate *priv = GET_PRIVATE (device);
-	const guint timeout = LU_DEVICE_TIMEOUT_MS;
+	LuDeviceClass *klass = LU_DEVICE_GET_CLASS (device);
+	gint64 deadline;
 	g_autoptr(LuDeviceHidppMsg) msg_tmp = lu_device_hidpp_new ();
 
 	/* send */
-	if (!lu_device_hidpp_send (device, msg, timeout, error))
+	if (!lu_device_hidpp_send (device, msg, LU_DEVICE_TIMEOUT_MS, error))
 		return FALSE;
 
-	/* keep trying to receive until we get a valid reply */
+	/* keep trying to receive until we get a valid reply; one deadline
+	 * covers the whole request so notification traffic arriving in
+	 * between does not restart the full timeout window each time */
+	deadline = g_get_monotonic_time () + LU_DEVICE_TIMEOUT_MS * 1000;
 	while (1) {
-		if (!lu_device_hidpp_receive (device, msg_tmp, timeout, error))
+		gint64 remaining = (deadline - g_get_monotonic_time ()) / 1000;
+		if (remaining <= 0) {
+			g_set_error_literal (error,
+					     G_IO_ERROR,
+					     G_IO_ERROR_TIMED_OUT,
+					     "timed out waiting for reply");
 			return FALSE;
+		}
+		if (!lu_device_hidpp_receive (device, msg_tmp,
+					      (guint) remaining, error))
+			return FALSE;
+
+		/* route any connection notification to the subclass rather
+		 * than discarding it, then keep waiting for our reply */
+		if (lu_device_hidpp_msg_is_notification (msg_tmp)) {
+			g_debug ("device changed");
+			if (klass->poll != NULL &&
+			    !klass->poll (device, error))
+				return FALSE;
+			continue;
+		}
 		if (msg_tmp->report_id == 0x10 || msg_tmp->report_id == 0x11)
 			break;
 		g_debug ("ignoring message with report 0x%02x", msg_tmp->report_id);
@@ -789,17 +827,10 @@ lu_device_poll (LuDevice *device, GError **error)
 	}
 
 	/* unifying receiver notification */
-	if (msg->report_id == HIDPP_REPORT_ID_SHORT) {
-		switch (msg->sub_id) {
-		case HIDPP_SUBID_DEVICE_CONNECTION:
-		case HIDPP_SUBID_DEVICE_DISCONNECTION:
-		case HIDPP_SUBID_DEVICE_LOCKING_CHANGED:
-			g_debug ("device changed");
-			if (klass->poll != NULL)
-				return klass->poll (device, error);
-		default:
-			break;
-		}
+	if (lu_device_hidpp_msg_is_notification (msg)) {
+		g_debug ("device changed");
+		if (klass->poll != NULL)
+			return klass->poll (device, error);
 	}
 	return TRUE;
 }
@@ -63,6 +63,7 @@ struct _LuDeviceClass
 #define LU_DEVICE_EP1				0x81
 #define LU_DEVICE_EP3				0x83
 #define LU_DEVICE_TIMEOUT_MS			2500
+#define LU_DEVICE_DRAIN_TIMEOUT_MS		50
 
 typedef enum {
 	LU_DEVICE_KIND_UNKNOWN,
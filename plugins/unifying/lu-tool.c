@@ -31,6 +31,7 @@ typedef struct {
 	GPtrArray		*cmd_array;
 	LuContext		*ctx;
 	LuDeviceKind		 emulation_kind;
+	gboolean		 json;
 } FuLuToolPrivate;
 
 static void
@@ -287,34 +288,129 @@ lu_tool_info_device (FuLuToolPrivate *priv, LuDevice *device, GError **error)
 	return lu_device_close (device, error);
 }
 
+static void
+lu_tool_json_append (GString *str, const gchar *key, const gchar *value)
+{
+	g_autofree gchar *tmp = g_strescape (value, NULL);
+	g_string_append_printf (str, "    \"%s\": \"%s\",\n", key, tmp);
+}
+
+static gboolean
+lu_tool_info_device_json (FuLuToolPrivate *priv,
+			  LuDevice *device,
+			  GString *str,
+			  GError **error)
+{
+	GPtrArray *guids;
+	g_autofree gchar *flags = NULL;
+	g_autoptr(GError) error_local = NULL;
+
+	/* open */
+	if (!lu_device_open (device, &error_local))
+		lu_tool_json_append (str, "error", error_local->message);
+
+	/* add to the object */
+	lu_tool_json_append (str, "type",
+			     lu_device_kind_to_string (lu_device_get_kind (device)));
+	flags = lu_device_flags_to_string (lu_device_get_flags (device));
+	lu_tool_json_append (str, "flags", flags);
+	if (lu_device_get_hidpp_id (device) != HIDPP_DEVICE_ID_UNSET) {
+		g_string_append_printf (str, "    \"hidpp-id\": %u,\n",
+					lu_device_get_hidpp_id (device));
+	}
+	if (lu_device_get_hidpp_version (device) != 0) {
+		g_string_append_printf (str, "    \"hidpp-version\": %u,\n",
+					lu_device_get_hidpp_version (device));
+	}
+	if (lu_device_get_platform_id (device) != NULL)
+		lu_tool_json_append (str, "platform-id",
+				     lu_device_get_platform_id (device));
+	if (lu_device_get_vendor (device) != NULL)
+		lu_tool_json_append (str, "vendor",
+				     lu_device_get_vendor (device));
+	if (lu_device_get_product (device) != NULL)
+		lu_tool_json_append (str, "product",
+				     lu_device_get_product (device));
+	if (lu_device_get_battery_level (device) != 0) {
+		g_string_append_printf (str, "    \"battery-level\": %u,\n",
+					lu_device_get_battery_level (device));
+	}
+	if (lu_device_get_version_fw (device) != NULL)
+		lu_tool_json_append (str, "version-firmware",
+				     lu_device_get_version_fw (device));
+	if (lu_device_get_version_bl (device) != NULL)
+		lu_tool_json_append (str, "version-bootloader",
+				     lu_device_get_version_bl (device));
+	guids = lu_device_get_guids (device);
+	if (guids->len > 0) {
+		g_string_append (str, "    \"guids\": [");
+		for (guint i = 0; i < guids->len; i++) {
+			const gchar *guid = g_ptr_array_index (guids, i);
+			g_string_append_printf (str, "\"%s\"", guid);
+			if (i != guids->len - 1)
+				g_string_append (str, ", ");
+		}
+		g_string_append (str, "],\n");
+	}
+
+	/* remove the trailing comma */
+	if (g_str_has_suffix (str->str, ",\n"))
+		g_string_truncate (str, str->len - 2);
+	g_string_append (str, "\n");
+
+	/* close device */
+	return lu_device_close (device, error);
+}
+
 static gboolean
 lu_tool_info (FuLuToolPrivate *priv, gchar **values, GError **error)
 {
 	GPtrArray *devices = NULL;
-	g_autoptr(LuContext) ctx = NULL;
+	g_autoptr(GString) str = NULL;
+
+	/* machine readable */
+	if (priv->json)
+		str = g_string_new ("[\n");
 
 	/* emulated */
 	if (priv->emulation_kind != LU_DEVICE_KIND_UNKNOWN) {
 		g_autoptr(LuDevice) device = NULL;
 		device = lu_device_fake_new (priv->emulation_kind);
-		if (!lu_tool_info_device (priv, device, error))
-			return FALSE;
+		if (str != NULL) {
+			g_string_append (str, "  {\n");
+			if (!lu_tool_info_device_json (priv, device, str, error))
+				return FALSE;
+			g_string_append (str, "  },\n");
+		} else {
+			if (!lu_tool_info_device (priv, device, error))
+				return FALSE;
+		}
 	}
 
-	/* get the devices */
-	ctx = lu_context_new (error);
-	if (ctx == NULL) {
-		g_prefix_error (error, "Failed to create context: ");
-		return FALSE;
-	}
-	devices = lu_context_get_devices (ctx);
+	/* get the devices from the shared context */
+	devices = lu_context_get_devices (priv->ctx);
 	for (guint i = 0; i < devices->len; i++) {
 		LuDevice *device = g_ptr_array_index (devices, i);
+		if (str != NULL) {
+			g_string_append (str, "  {\n");
+			if (!lu_tool_info_device_json (priv, device, str, error))
+				return FALSE;
+			g_string_append (str, "  },\n");
+			continue;
+		}
 		if (!lu_tool_info_device (priv, device, error))
 			return FALSE;
 		if (i != devices->len - 1)
 			g_print ("\n");
 	}
+
+	/* print the complete document */
+	if (str != NULL) {
+		if (g_str_has_suffix (str->str, ",\n"))
+			g_string_truncate (str, str->len - 2);
+		g_string_append (str, "\n]\n");
+		g_print ("%s", str->str);
+	}
 	return TRUE;
 }
 
@@ -524,6 +620,165 @@ lu_tool_detach (FuLuToolPrivate *priv, gchar **values, GError **error)
 	return TRUE;
 }
 
+static gint
+lu_tool_bench_latency_sort_cb (gconstpointer a, gconstpointer b)
+{
+	guint32 latency_a = *((const guint32 *) a);
+	guint32 latency_b = *((const guint32 *) b);
+	if (latency_a < latency_b)
+		return -1;
+	if (latency_a > latency_b)
+		return 1;
+	return 0;
+}
+
+static guint32
+lu_tool_bench_percentile (GArray *latencies, guint percentile)
+{
+	guint idx = ((latencies->len - 1) * percentile) / 100;
+	return g_array_index (latencies, guint32, idx);
+}
+
+static gboolean
+lu_tool_bench (FuLuToolPrivate *priv, gchar **values, GError **error)
+{
+	gdouble elapsed;
+	gint64 start;
+	guint64 count = 100;
+	guint retries_total = 0;
+	g_autoptr(GArray) latencies = NULL;
+	g_autoptr(GString) csv = NULL;
+	g_autoptr(LuDevice) device = NULL;
+
+	/* check args */
+	if (g_strv_length (values) >= 1) {
+		count = g_ascii_strtoull (values[0], NULL, 10);
+		if (count == 0 || count > 100000) {
+			g_set_error_literal (error,
+					     G_IO_ERROR,
+					     G_IO_ERROR_FAILED,
+					     "Invalid arguments, expected "
+					     "[COUNT] [CSV-FILENAME]"
+					     " -- e.g. `1000 results.csv`");
+			return FALSE;
+		}
+	}
+
+	/* open device */
+	device = lu_get_default_device (priv, error);
+	if (device == NULL)
+		return FALSE;
+	if (!lu_device_open (device, error))
+		return FALSE;
+
+	/* read the firmware information register repeatedly; this is the
+	 * same benign request the probe uses so it is safe under load */
+	latencies = g_array_new (FALSE, FALSE, sizeof (guint32));
+	csv = g_string_new ("sample,latency_us,retries\n");
+	start = g_get_monotonic_time ();
+	for (guint i = 0; i < count; i++) {
+		guint retries = 0;
+		guint32 latency;
+		gint64 before = g_get_monotonic_time ();
+		while (1) {
+			g_autoptr(GError) error_local = NULL;
+			g_autoptr(LuDeviceHidppMsg) msg = lu_device_hidpp_new ();
+			msg->report_id = HIDPP_REPORT_ID_SHORT;
+			msg->device_id = lu_device_get_hidpp_id (device);
+			msg->sub_id = HIDPP_SUBID_GET_REGISTER;
+			msg->function_id = HIDPP_REGISTER_DEVICE_FIRMWARE_INFORMATION;
+			msg->data[0] = 0x01;
+			if (lu_device_hidpp_transfer (device, msg, &error_local))
+				break;
+			if (++retries >= 3) {
+				g_propagate_prefixed_error (error,
+							    g_steal_pointer (&error_local),
+							    "Benchmark failed at sample %u: ",
+							    i);
+				lu_device_close (device, NULL);
+				return FALSE;
+			}
+		}
+		latency = (guint32) (g_get_monotonic_time () - before);
+		retries_total += retries;
+		g_array_append_val (latencies, latency);
+		g_string_append_printf (csv, "%u,%u,%u\n", i, latency, retries);
+	}
+	elapsed = (gdouble) (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC;
+
+	/* per-sample data, to a file if one was given */
+	if (g_strv_length (values) >= 2) {
+		if (!g_file_set_contents (values[1], csv->str, -1, error)) {
+			lu_device_close (device, NULL);
+			return FALSE;
+		}
+	} else {
+		g_print ("%s", csv->str);
+	}
+
+	/* summary */
+	g_array_sort (latencies, lu_tool_bench_latency_sort_cb);
+	g_print ("Samples:        %u\n", latencies->len);
+	g_print ("Retries:        %u\n", retries_total);
+	g_print ("Latency min:    %.2fms\n",
+		 lu_tool_bench_percentile (latencies, 0) / 1000.f);
+	g_print ("Latency p50:    %.2fms\n",
+		 lu_tool_bench_percentile (latencies, 50) / 1000.f);
+	g_print ("Latency p90:    %.2fms\n",
+		 lu_tool_bench_percentile (latencies, 90) / 1000.f);
+	g_print ("Latency p99:    %.2fms\n",
+		 lu_tool_bench_percentile (latencies, 99) / 1000.f);
+	g_print ("Latency max:    %.2fms\n",
+		 lu_tool_bench_percentile (latencies, 100) / 1000.f);
+	g_print ("Request rate:   %.1f/sec\n",
+		 (gdouble) latencies->len / elapsed);
+
+	/* close device */
+	return lu_device_close (device, error);
+}
+
+static gboolean
+lu_tool_run_script (FuLuToolPrivate *priv, gchar **values, GError **error)
+{
+	g_autofree gchar *data = NULL;
+	g_auto(GStrv) lines = NULL;
+
+	/* check args */
+	if (g_strv_length (values) != 1) {
+		g_set_error_literal (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_FAILED,
+				     "Invalid arguments, expected FILENAME"
+				     " -- e.g. `provision.txt`");
+		return FALSE;
+	}
+
+	/* run each line as one command, reusing the open context so the
+	 * enumeration and receiver handshake only happen once */
+	if (!g_file_get_contents (values[0], &data, NULL, error))
+		return FALSE;
+	lines = g_strsplit (data, "\n", -1);
+	for (guint i = 0; lines[i] != NULL; i++) {
+		gint argc = 0;
+		g_auto(GStrv) argv = NULL;
+
+		/* skip blank lines and comments */
+		g_strstrip (lines[i]);
+		if (lines[i][0] == '\0' || lines[i][0] == '#')
+			continue;
+		if (!g_shell_parse_argv (lines[i], &argc, &argv, error)) {
+			g_prefix_error (error, "Failed to parse line %u: ", i + 1);
+			return FALSE;
+		}
+		if (!lu_tool_run (priv, argv[0], &argv[1], error)) {
+			g_prefix_error (error, "Failed at line %u [%s]: ",
+					i + 1, lines[i]);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
 static void
 lu_tool_log_handler_cb (const gchar *log_domain,
 			      GLogLevelFlags log_level,
@@ -548,6 +803,8 @@ main (int argc, char **argv)
 			"Print verbose debug statements", NULL },
 		{ "emulate", 'e', 0, G_OPTION_ARG_STRING, &emulation_kind,
 			"Emulate a device type", NULL },
+		{ "json", '\0', 0, G_OPTION_ARG_NONE, &priv->json,
+			"Print machine readable JSON output", NULL },
 		{ NULL}
 	};
 
@@ -580,6 +837,14 @@ main (int argc, char **argv)
 		     "detach", NULL,
 		     "Detach to bootloader mode",
 		     lu_tool_detach);
+	lu_tool_add (priv->cmd_array,
+		     "run", "FILENAME",
+		     "Run commands from a script using one context",
+		     lu_tool_run_script);
+	lu_tool_add (priv->cmd_array,
+		     "bench", "[COUNT] [CSV-FILENAME]",
+		     "Benchmark the HID++ round-trip latency",
+		     lu_tool_bench);
 
 	/* sort by command name */
 	g_ptr_array_sort (priv->cmd_array,
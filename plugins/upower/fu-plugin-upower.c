@@ -42,13 +42,32 @@ fu_plugin_destroy (FuPlugin *plugin)
 		g_object_unref (data->proxy);
 }
 
+static void
+fu_plugin_upower_properties_changed_cb (GDBusProxy *proxy,
+					GVariant *changed_properties,
+					GStrv invalidated_properties,
+					FuPlugin *plugin)
+{
+	g_autoptr(GVariant) value = NULL;
+	value = g_variant_lookup_value (changed_properties, "OnBattery",
+					G_VARIANT_TYPE_BOOLEAN);
+	if (value != NULL) {
+		g_debug ("now %s battery power",
+			 g_variant_get_boolean (value) ? "on" : "off");
+	}
+}
+
 gboolean
 fu_plugin_startup (FuPlugin *plugin, GError **error)
 {
 	FuPluginData *data = fu_plugin_get_data (plugin);
+
+	/* subscribing to PropertiesChanged here keeps the property cache
+	 * current, so the power-safety check at update time is a memory
+	 * read rather than a synchronous round-trip per device */
 	data->proxy =
 		g_dbus_proxy_new_for_bus_sync (G_BUS_TYPE_SYSTEM,
-					       G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS,
+					       G_DBUS_PROXY_FLAGS_NONE,
 					       NULL,
 					       "org.freedesktop.UPower",
 					       "/org/freedesktop/UPower",
@@ -59,6 +78,9 @@ fu_plugin_startup (FuPlugin *plugin, GError **error)
 		g_prefix_error (error, "failed to conect to upower: ");
 		return FALSE;
 	}
+	g_signal_connect (data->proxy, "g-properties-changed",
+			  G_CALLBACK (fu_plugin_upower_properties_changed_cb),
+			  plugin);
 	return TRUE;
 }
 
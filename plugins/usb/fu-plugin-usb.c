@@ -26,11 +26,51 @@
 #include "fu-plugin.h"
 #include "fu-plugin-vfuncs.h"
 
+struct FuPluginData {
+	GHashTable		*probed;	/* platform_id:1 */
+};
+
+typedef struct {
+	guint8		 device_class;
+	guint16		 vid_start;
+	guint16		 vid_end;
+} FuPluginUsbSkipItem;
+
+/* fixed-function device classes this plugin can never update; they are
+ * matched against the cached device descriptor so rejecting them costs
+ * no bus traffic at all */
+static const FuPluginUsbSkipItem fu_plugin_usb_skip_items[] = {
+	{ G_USB_DEVICE_CLASS_HUB,			0x0000, 0xffff },
+	{ G_USB_DEVICE_CLASS_HID,			0x0000, 0xffff },
+	{ G_USB_DEVICE_CLASS_AUDIO,			0x0000, 0xffff },
+	{ G_USB_DEVICE_CLASS_VIDEO,			0x0000, 0xffff },
+	{ G_USB_DEVICE_CLASS_PRINTER,			0x0000, 0xffff },
+	{ G_USB_DEVICE_CLASS_MASS_STORAGE,		0x0000, 0xffff },
+	{ G_USB_DEVICE_CLASS_WIRELESS_CONTROLLER,	0x0000, 0xffff },
+};
+
+static gboolean
+fu_plugin_usb_device_filtered (GUsbDevice *device)
+{
+	guint8 device_class = g_usb_device_get_device_class (device);
+	guint16 vid = g_usb_device_get_vid (device);
+	for (guint i = 0; i < G_N_ELEMENTS (fu_plugin_usb_skip_items); i++) {
+		const FuPluginUsbSkipItem *item = &fu_plugin_usb_skip_items[i];
+		if (device_class != item->device_class)
+			continue;
+		if (vid < item->vid_start || vid > item->vid_end)
+			continue;
+		return TRUE;
+	}
+	return FALSE;
+}
+
 static void
 fu_plugin_usb_device_added_cb (GUsbContext *ctx,
 				 GUsbDevice *device,
 				 FuPlugin *plugin)
 {
+	FuPluginData *data = fu_plugin_get_data (plugin);
 	const gchar *platform_id = NULL;
 	guint8 idx = 0x00;
 	g_autofree gchar *devid1 = NULL;
@@ -42,8 +82,9 @@ fu_plugin_usb_device_added_cb (GUsbContext *ctx,
 	g_autoptr(FuDevice) dev = NULL;
 	g_autoptr(GError) error = NULL;
 
-	/* ignore hubs */
-	if (g_usb_device_get_device_class (device) == G_USB_DEVICE_CLASS_HUB)
+	/* ignore hubs, input devices, cameras and other fixed-function
+	 * classes using only the cached device descriptor */
+	if (fu_plugin_usb_device_filtered (device))
 		return;
 	ptask = as_profile_start (profile, "FuPluginUsb:added{%04x:%04x}",
 				  g_usb_device_get_vid (device),
@@ -58,6 +99,22 @@ fu_plugin_usb_device_added_cb (GUsbContext *ctx,
 		return;
 	}
 
+	/* the device descriptor is already cached by GUsb, so devices with
+	 * no product string can be rejected before we generate any traffic */
+	idx = g_usb_device_get_product_index (device);
+	if (idx == 0x00) {
+		g_debug ("no product string descriptor");
+		return;
+	}
+
+	/* already probed and rejected; only a physical replug can change
+	 * the string descriptors */
+	if (g_hash_table_contains (data->probed, platform_id)) {
+		g_debug ("ignoring already-probed %s", platform_id);
+		return;
+	}
+	g_hash_table_add (data->probed, g_strdup (platform_id));
+
 	/* try to get the version without claiming interface */
 	if (!g_usb_device_open (device, &error)) {
 		g_debug ("Failed to open: %s", error->message);
@@ -69,15 +126,14 @@ fu_plugin_usb_device_added_cb (GUsbContext *ctx,
 	fu_device_set_id (dev, platform_id);
 
 	/* get product */
-	idx = g_usb_device_get_product_index (device);
-	if (idx != 0x00) {
+	{
 		g_autoptr(AsProfileTask) ptask2 = NULL;
 		ptask2 = as_profile_start_literal (profile, "FuPluginUsb:get-string-desc");
 		g_assert (ptask2 != NULL);
 		product = g_usb_device_get_string_descriptor (device, idx, NULL);
 	}
 	if (product == NULL) {
-		g_debug ("no product string descriptor");
+		g_debug ("failed to read product string descriptor");
 		g_usb_device_close (device, NULL);
 		return;
 	}
@@ -135,11 +191,15 @@ fu_plugin_usb_device_removed_cb (GUsbContext *ctx,
 				   GUsbDevice *device,
 				   FuPlugin *plugin)
 {
+	FuPluginData *data = fu_plugin_get_data (plugin);
 	FuDevice *dev;
 	const gchar *platform_id = NULL;
 
-	/* already in database */
+	/* re-probe if the same address is used again */
 	platform_id = g_usb_device_get_platform_id (device);
+	g_hash_table_remove (data->probed, platform_id);
+
+	/* already in database */
 	dev = fu_plugin_cache_lookup (plugin, platform_id);
 	if (dev == NULL)
 		return;
@@ -148,6 +208,21 @@ fu_plugin_usb_device_removed_cb (GUsbContext *ctx,
 	fu_plugin_cache_remove (plugin, platform_id);
 }
 
+void
+fu_plugin_init (FuPlugin *plugin)
+{
+	FuPluginData *data = fu_plugin_alloc_data (plugin, sizeof (FuPluginData));
+	data->probed = g_hash_table_new_full (g_str_hash, g_str_equal,
+					      g_free, NULL);
+}
+
+void
+fu_plugin_destroy (FuPlugin *plugin)
+{
+	FuPluginData *data = fu_plugin_get_data (plugin);
+	g_hash_table_unref (data->probed);
+}
+
 gboolean
 fu_plugin_startup (FuPlugin *plugin, GError **error)
 {
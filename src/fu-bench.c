@@ -0,0 +1,735 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2017 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <fwupd.h>
+#include <gio/gio.h>
+#include <locale.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* this is only valid in this file */
+#define FWUPD_ERROR_INVALID_ARGS	(FWUPD_ERROR_LAST+1)
+
+#define FU_BENCH_COUNT_DEFAULT		100
+#define FU_BENCH_COUNT_MAX		1000000
+
+/* RSS sampling cadence for the soak workload; frequent enough to see a
+ * leak trend over a few hundred iterations, cheap enough to not perturb
+ * the numbers being measured */
+#define FU_BENCH_SOAK_SAMPLE_EVERY	50
+
+/* RSS growth past the warmup phase that gets flagged as a probable leak;
+ * one page per ~250 iterations is well above allocator noise */
+#define FU_BENCH_SOAK_LEAK_KB_PER_1K	16
+
+typedef struct {
+	GCancellable		*cancellable;
+	GMainLoop		*loop;
+	GOptionContext		*context;
+	GPtrArray		*cmd_array;
+	FwupdClient		*client;
+	gboolean		 json;
+	guint			 count;
+	guint			 parallel;
+
+	/* per-run state */
+	const gchar		*workload;
+	const gchar		*filename;
+	const gchar		*device_id;
+	guint			 submitted;
+	guint			 completed;
+	guint			 failures;
+	gchar			*failure_msg;
+	GArray			*latencies;	/* of guint32, us */
+	gint64			 time_start;
+
+	/* soak-only state */
+	gboolean		 soak;
+	GArray			*rss_samples;	/* of guint, kB */
+	guint64			 stage_us[FWUPD_STATUS_LAST];
+	FwupdStatus		 stage_last;
+	gint64			 stage_time;
+} FuBenchPrivate;
+
+typedef gboolean (*FuBenchPrivateCb)	(FuBenchPrivate	*priv,
+					 gchar		**values,
+					 GError		**error);
+
+typedef struct {
+	gchar		*name;
+	gchar		*arguments;
+	gchar		*description;
+	FuBenchPrivateCb callback;
+} FuBenchItem;
+
+typedef struct {
+	FuBenchPrivate	*priv;
+	gint64		 time_start;
+} FuBenchOp;
+
+static void
+fu_bench_item_free (FuBenchItem *item)
+{
+	g_free (item->name);
+	g_free (item->arguments);
+	g_free (item->description);
+	g_free (item);
+}
+
+static gint
+fu_bench_sort_command_name_cb (FuBenchItem **item1, FuBenchItem **item2)
+{
+	return g_strcmp0 ((*item1)->name, (*item2)->name);
+}
+
+static void
+fu_bench_add (GPtrArray *array,
+	      const gchar *name,
+	      const gchar *arguments,
+	      const gchar *description,
+	      FuBenchPrivateCb callback)
+{
+	FuBenchItem *item = g_new0 (FuBenchItem, 1);
+	item->name = g_strdup (name);
+	item->arguments = g_strdup (arguments);
+	item->description = g_strdup (description);
+	item->callback = callback;
+	g_ptr_array_add (array, item);
+}
+
+static gchar *
+fu_bench_get_descriptions (GPtrArray *array)
+{
+	gsize len;
+	const gsize max_len = 35;
+	GString *string;
+
+	/* print each command */
+	string = g_string_new ("");
+	for (guint i = 0; i < array->len; i++) {
+		FuBenchItem *item = g_ptr_array_index (array, i);
+		g_string_append (string, "  ");
+		g_string_append (string, item->name);
+		len = strlen (item->name) + 2;
+		if (item->arguments != NULL) {
+			g_string_append (string, " ");
+			g_string_append (string, item->arguments);
+			len += strlen (item->arguments) + 1;
+		}
+		if (len < max_len) {
+			for (gsize j = len; j < max_len + 1; j++)
+				g_string_append_c (string, ' ');
+			g_string_append (string, item->description);
+			g_string_append_c (string, '\n');
+		} else {
+			g_string_append_c (string, '\n');
+			for (gsize j = 0; j < max_len + 1; j++)
+				g_string_append_c (string, ' ');
+			g_string_append (string, item->description);
+			g_string_append_c (string, '\n');
+		}
+	}
+
+	/* remove trailing newline */
+	if (string->len > 0)
+		g_string_set_size (string, string->len - 1);
+
+	return g_string_free (string, FALSE);
+}
+
+static void
+fu_bench_op_submit (FuBenchPrivate *priv);
+
+static guint
+fu_bench_get_daemon_rss (void);
+
+static void
+fu_bench_op_done (FuBenchOp *op, const GError *error)
+{
+	FuBenchPrivate *priv = op->priv;
+	guint32 latency = (guint32) (g_get_monotonic_time () - op->time_start);
+
+	g_array_append_val (priv->latencies, latency);
+	priv->completed++;
+
+	/* track the RSS trend over the run, not just the final value */
+	if (priv->soak && priv->completed % FU_BENCH_SOAK_SAMPLE_EVERY == 0) {
+		guint rss_kb = fu_bench_get_daemon_rss ();
+		g_array_append_val (priv->rss_samples, rss_kb);
+	}
+	if (error != NULL) {
+		priv->failures++;
+		if (priv->failure_msg == NULL)
+			priv->failure_msg = g_strdup (error->message);
+	}
+	g_free (op);
+
+	/* keep the pipeline full until the target count is reached */
+	if (priv->submitted < priv->count) {
+		fu_bench_op_submit (priv);
+		return;
+	}
+	if (priv->completed >= priv->count)
+		g_main_loop_quit (priv->loop);
+}
+
+static void
+fu_bench_get_devices_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	FuBenchOp *op = (FuBenchOp *) user_data;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) devices = NULL;
+
+	devices = fwupd_client_get_devices_simple_finish (FWUPD_CLIENT (source),
+							  res, &error);
+	/* an empty device list is a valid daemon answer, not a failure */
+	if (devices == NULL &&
+	    g_error_matches (error, FWUPD_ERROR, FWUPD_ERROR_NOTHING_TO_DO))
+		g_clear_error (&error);
+	fu_bench_op_done (op, error);
+}
+
+static void
+fu_bench_get_details_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	FuBenchOp *op = (FuBenchOp *) user_data;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) results = NULL;
+
+	results = fwupd_client_get_details_local_finish (FWUPD_CLIENT (source),
+							 res, &error);
+	fu_bench_op_done (op, error);
+}
+
+static void
+fu_bench_install_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	FuBenchOp *op = (FuBenchOp *) user_data;
+	g_autoptr(GError) error = NULL;
+
+	fwupd_client_install_finish (FWUPD_CLIENT (source), res, &error);
+	fu_bench_op_done (op, error);
+}
+
+static void
+fu_bench_status_notify_cb (GObject *object, GParamSpec *pspec, gpointer user_data)
+{
+	FuBenchPrivate *priv = (FuBenchPrivate *) user_data;
+	FwupdStatus status = fwupd_client_get_status (FWUPD_CLIENT (object));
+	gint64 now = g_get_monotonic_time ();
+
+	/* attribute the elapsed wall time to the stage we are leaving; with
+	 * one operation in flight this is an exact per-stage breakdown */
+	if (priv->stage_last < FWUPD_STATUS_LAST)
+		priv->stage_us[priv->stage_last] += (guint64) (now - priv->stage_time);
+	priv->stage_last = status;
+	priv->stage_time = now;
+}
+
+static void
+fu_bench_op_submit (FuBenchPrivate *priv)
+{
+	FuBenchOp *op = g_new0 (FuBenchOp, 1);
+	op->priv = priv;
+	op->time_start = g_get_monotonic_time ();
+	priv->submitted++;
+	if (g_strcmp0 (priv->workload, "get-devices") == 0) {
+		fwupd_client_get_devices_simple_async (priv->client,
+						       priv->cancellable,
+						       fu_bench_get_devices_cb,
+						       op);
+	} else if (g_strcmp0 (priv->workload, "get-details") == 0) {
+		fwupd_client_get_details_local_async (priv->client,
+						      priv->filename,
+						      priv->cancellable,
+						      fu_bench_get_details_cb,
+						      op);
+	} else if (g_strcmp0 (priv->workload, "install") == 0 ||
+		   g_strcmp0 (priv->workload, "soak") == 0) {
+		fwupd_client_install_async (priv->client,
+					    priv->device_id,
+					    priv->filename,
+					    FWUPD_INSTALL_FLAG_NONE,
+					    priv->cancellable,
+					    fu_bench_install_cb,
+					    op);
+	} else {
+		g_assert_not_reached ();
+	}
+}
+
+static gint
+fu_bench_latency_sort_cb (gconstpointer a, gconstpointer b)
+{
+	guint32 la = *((const guint32 *) a);
+	guint32 lb = *((const guint32 *) b);
+	if (la < lb)
+		return -1;
+	if (la > lb)
+		return 1;
+	return 0;
+}
+
+static guint32
+fu_bench_percentile (GArray *latencies, guint percentile)
+{
+	guint idx;
+	if (latencies->len == 0)
+		return 0;
+	idx = ((latencies->len - 1) * percentile) / 100;
+	return g_array_index (latencies, guint32, idx);
+}
+
+static guint
+fu_bench_get_daemon_rss (void)
+{
+	guint32 pid = 0;
+	g_autofree gchar *fn = NULL;
+	g_autofree gchar *status = NULL;
+	g_auto(GStrv) lines = NULL;
+	g_autoptr(GDBusConnection) conn = NULL;
+	g_autoptr(GVariant) val = NULL;
+
+	/* ask the bus for the PID of whoever owns the daemon name; this
+	 * also works when pointing at a private bus instance */
+	conn = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, NULL);
+	if (conn == NULL)
+		return 0;
+	val = g_dbus_connection_call_sync (conn,
+					   "org.freedesktop.DBus",
+					   "/org/freedesktop/DBus",
+					   "org.freedesktop.DBus",
+					   "GetConnectionUnixProcessID",
+					   g_variant_new ("(s)", FWUPD_DBUS_SERVICE),
+					   G_VARIANT_TYPE ("(u)"),
+					   G_DBUS_CALL_FLAGS_NONE,
+					   -1, NULL, NULL);
+	if (val == NULL)
+		return 0;
+	g_variant_get (val, "(u)", &pid);
+
+	/* kernel-accounted resident set, in kB */
+	fn = g_strdup_printf ("/proc/%u/status", pid);
+	if (!g_file_get_contents (fn, &status, NULL, NULL))
+		return 0;
+	lines = g_strsplit (status, "\n", -1);
+	for (guint i = 0; lines[i] != NULL; i++) {
+		if (g_str_has_prefix (lines[i], "VmRSS:"))
+			return (guint) g_ascii_strtoull (lines[i] + 6, NULL, 10);
+	}
+	return 0;
+}
+
+static gdouble
+fu_bench_soak_rss_window_mean (GArray *samples, guint start, guint len)
+{
+	guint64 total = 0;
+	if (len == 0)
+		return 0.f;
+	for (guint i = start; i < start + len && i < samples->len; i++)
+		total += g_array_index (samples, guint, i);
+	return (gdouble) total / (gdouble) len;
+}
+
+/* compare the mean RSS of the first and last post-warmup windows and
+ * normalize the growth to per-1000-iterations, so runs of different
+ * lengths are comparable and a slow leak shows up as a steady slope */
+static gdouble
+fu_bench_soak_rss_growth_per_1k (FuBenchPrivate *priv)
+{
+	GArray *samples = priv->rss_samples;
+	guint warmup = samples->len / 4;
+	guint window = (samples->len - warmup) / 4;
+	gdouble first, last;
+	guint span_ops;
+
+	if (window == 0)
+		return 0.f;
+	first = fu_bench_soak_rss_window_mean (samples, warmup, window);
+	last = fu_bench_soak_rss_window_mean (samples,
+					      samples->len - window, window);
+	span_ops = (samples->len - warmup - window) * FU_BENCH_SOAK_SAMPLE_EVERY;
+	if (span_ops == 0)
+		return 0.f;
+	return (last - first) * 1000.f / (gdouble) span_ops;
+}
+
+static void
+fu_bench_report (FuBenchPrivate *priv)
+{
+	gdouble elapsed_ms;
+	gdouble ops_per_sec = 0.f;
+	guint rss_kb = fu_bench_get_daemon_rss ();
+
+	elapsed_ms = (g_get_monotonic_time () - priv->time_start) / 1000.f;
+	if (elapsed_ms > 0)
+		ops_per_sec = priv->completed * 1000.f / elapsed_ms;
+	g_array_sort (priv->latencies, fu_bench_latency_sort_cb);
+
+	/* machine readable, stable key order so CI can diff runs */
+	if (priv->json) {
+		g_autoptr(GString) str = g_string_new ("{\n");
+		g_string_append_printf (str, "  \"workload\": \"%s\",\n",
+					priv->workload);
+		g_string_append_printf (str, "  \"count\": %u,\n",
+					priv->completed);
+		g_string_append_printf (str, "  \"parallel\": %u,\n",
+					priv->parallel);
+		g_string_append_printf (str, "  \"failures\": %u,\n",
+					priv->failures);
+		if (priv->failure_msg != NULL) {
+			g_autofree gchar *tmp = g_strescape (priv->failure_msg, NULL);
+			g_string_append_printf (str, "  \"failure-first\": \"%s\",\n", tmp);
+		}
+		g_string_append_printf (str, "  \"elapsed-ms\": %.3f,\n",
+					elapsed_ms);
+		g_string_append_printf (str, "  \"ops-per-sec\": %.2f,\n",
+					ops_per_sec);
+		g_string_append_printf (str, "  \"latency-ms\": {\n");
+		g_string_append_printf (str, "    \"min\": %.3f,\n",
+					fu_bench_percentile (priv->latencies, 0) / 1000.f);
+		g_string_append_printf (str, "    \"p50\": %.3f,\n",
+					fu_bench_percentile (priv->latencies, 50) / 1000.f);
+		g_string_append_printf (str, "    \"p90\": %.3f,\n",
+					fu_bench_percentile (priv->latencies, 90) / 1000.f);
+		g_string_append_printf (str, "    \"p99\": %.3f,\n",
+					fu_bench_percentile (priv->latencies, 99) / 1000.f);
+		g_string_append_printf (str, "    \"max\": %.3f\n",
+					fu_bench_percentile (priv->latencies, 100) / 1000.f);
+		g_string_append (str, "  },\n");
+		g_string_append_printf (str, "  \"daemon-rss-kb\": %u", rss_kb);
+		if (priv->soak) {
+			gdouble growth = fu_bench_soak_rss_growth_per_1k (priv);
+			guint rss_first = 0;
+			guint rss_peak = 0;
+			for (guint i = 0; i < priv->rss_samples->len; i++) {
+				guint tmp = g_array_index (priv->rss_samples, guint, i);
+				if (i == 0)
+					rss_first = tmp;
+				if (tmp > rss_peak)
+					rss_peak = tmp;
+			}
+			g_string_append_printf (str, ",\n  \"updates-per-hour\": %.0f,\n",
+						ops_per_sec * 3600.f);
+			g_string_append (str, "  \"stage-ms\": {\n");
+			for (guint i = 0; i < FWUPD_STATUS_LAST; i++) {
+				if (priv->stage_us[i] == 0)
+					continue;
+				g_string_append_printf (str, "    \"%s\": %.1f,\n",
+							fwupd_status_to_string (i),
+							priv->stage_us[i] / 1000.f);
+			}
+			/* remove the trailing comma from the last stage */
+			if (g_str_has_suffix (str->str, ",\n"))
+				g_string_set_size (str, str->len - 2);
+			g_string_append (str, "\n  },\n");
+			g_string_append_printf (str, "  \"rss-first-kb\": %u,\n", rss_first);
+			g_string_append_printf (str, "  \"rss-peak-kb\": %u,\n", rss_peak);
+			g_string_append_printf (str, "  \"rss-growth-kb-per-1k\": %.2f,\n",
+						growth);
+			g_string_append_printf (str, "  \"leak-suspected\": %s",
+						growth > FU_BENCH_SOAK_LEAK_KB_PER_1K ?
+							"true" : "false");
+		}
+		g_string_append (str, "\n}\n");
+		g_print ("%s", str->str);
+		return;
+	}
+
+	/* human readable */
+	g_print ("Workload:\t%s\n", priv->workload);
+	g_print ("Completed:\t%u (%u failed)\n", priv->completed, priv->failures);
+	if (priv->failure_msg != NULL)
+		g_print ("First failure:\t%s\n", priv->failure_msg);
+	g_print ("Parallel:\t%u\n", priv->parallel);
+	g_print ("Elapsed:\t%.1fms\n", elapsed_ms);
+	g_print ("Rate:\t\t%.1f ops/sec\n", ops_per_sec);
+	g_print ("Latency:\tmin %.2fms, p50 %.2fms, p90 %.2fms, "
+		 "p99 %.2fms, max %.2fms\n",
+		 fu_bench_percentile (priv->latencies, 0) / 1000.f,
+		 fu_bench_percentile (priv->latencies, 50) / 1000.f,
+		 fu_bench_percentile (priv->latencies, 90) / 1000.f,
+		 fu_bench_percentile (priv->latencies, 99) / 1000.f,
+		 fu_bench_percentile (priv->latencies, 100) / 1000.f);
+	g_print ("Daemon RSS:\t%ukB\n", rss_kb);
+	if (priv->soak) {
+		gdouble growth = fu_bench_soak_rss_growth_per_1k (priv);
+		guint rss_first = 0;
+		guint rss_peak = 0;
+		for (guint i = 0; i < priv->rss_samples->len; i++) {
+			guint tmp = g_array_index (priv->rss_samples, guint, i);
+			if (i == 0)
+				rss_first = tmp;
+			if (tmp > rss_peak)
+				rss_peak = tmp;
+		}
+		g_print ("Rate:\t\t%.0f updates/hour\n", ops_per_sec * 3600.f);
+		g_print ("Stages:\n");
+		for (guint i = 0; i < FWUPD_STATUS_LAST; i++) {
+			if (priv->stage_us[i] == 0)
+				continue;
+			g_print ("  %s:\t%.1fms\n",
+				 fwupd_status_to_string (i),
+				 priv->stage_us[i] / 1000.f);
+		}
+		g_print ("RSS trend:\tfirst %ukB, peak %ukB, last %ukB "
+			 "(%+.2fkB per 1000 updates)\n",
+			 rss_first, rss_peak, rss_kb, growth);
+		if (growth > FU_BENCH_SOAK_LEAK_KB_PER_1K)
+			g_print ("WARNING:\tRSS growth suggests a daemon memory leak\n");
+	}
+}
+
+static gboolean
+fu_bench_run_workload (FuBenchPrivate *priv, GError **error)
+{
+	guint in_flight = MIN (priv->parallel, priv->count);
+
+	priv->submitted = 0;
+	priv->completed = 0;
+	priv->failures = 0;
+	priv->latencies = g_array_sized_new (FALSE, FALSE,
+					     sizeof (guint32), priv->count);
+	priv->time_start = g_get_monotonic_time ();
+
+	/* prime the pipeline; each completion resubmits until done */
+	for (guint i = 0; i < in_flight; i++)
+		fu_bench_op_submit (priv);
+	g_main_loop_run (priv->loop);
+
+	/* every operation failing is a setup problem, not a result */
+	if (priv->failures == priv->completed) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INTERNAL,
+			     "all %u operations failed: %s",
+			     priv->failures,
+			     priv->failure_msg != NULL ?
+					priv->failure_msg : "unknown error");
+		return FALSE;
+	}
+	fu_bench_report (priv);
+	return TRUE;
+}
+
+static gboolean
+fu_bench_get_devices (FuBenchPrivate *priv, gchar **values, GError **error)
+{
+	priv->workload = "get-devices";
+	return fu_bench_run_workload (priv, error);
+}
+
+static gboolean
+fu_bench_get_details (FuBenchPrivate *priv, gchar **values, GError **error)
+{
+	if (g_strv_length (values) < 1) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_ARGS,
+				     "Invalid arguments: expected 'filename.cab'");
+		return FALSE;
+	}
+	priv->workload = "get-details";
+	priv->filename = values[0];
+	return fu_bench_run_workload (priv, error);
+}
+
+static gboolean
+fu_bench_install (FuBenchPrivate *priv, gchar **values, GError **error)
+{
+	if (g_strv_length (values) < 2) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_ARGS,
+				     "Invalid arguments: expected "
+				     "'device-id filename.cab'");
+		return FALSE;
+	}
+	priv->workload = "install";
+	priv->device_id = values[0];
+	priv->filename = values[1];
+	return fu_bench_run_workload (priv, error);
+}
+
+static gboolean
+fu_bench_soak (FuBenchPrivate *priv, gchar **values, GError **error)
+{
+	gboolean ret;
+	gulong notify_id;
+	guint rss_kb;
+
+	if (g_strv_length (values) < 2) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_ARGS,
+				     "Invalid arguments: expected "
+				     "'device-id filename.cab'");
+		return FALSE;
+	}
+
+	/* the per-stage breakdown attributes daemon status transitions to
+	 * wall time, which is only exact with one operation in flight */
+	if (priv->parallel != 1) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_ARGS,
+				     "Invalid arguments: soak requires --parallel 1");
+		return FALSE;
+	}
+	priv->workload = "soak";
+	priv->device_id = values[0];
+	priv->filename = values[1];
+	priv->soak = TRUE;
+	priv->rss_samples = g_array_new (FALSE, FALSE, sizeof (guint));
+	rss_kb = fu_bench_get_daemon_rss ();
+	g_array_append_val (priv->rss_samples, rss_kb);
+	priv->stage_last = FWUPD_STATUS_IDLE;
+	priv->stage_time = g_get_monotonic_time ();
+	notify_id = g_signal_connect (priv->client, "notify::status",
+				      G_CALLBACK (fu_bench_status_notify_cb),
+				      priv);
+	ret = fu_bench_run_workload (priv, error);
+	g_signal_handler_disconnect (priv->client, notify_id);
+	return ret;
+}
+
+static gboolean
+fu_bench_run (FuBenchPrivate *priv, const gchar *command,
+	      gchar **values, GError **error)
+{
+	/* find command */
+	for (guint i = 0; i < priv->cmd_array->len; i++) {
+		FuBenchItem *item = g_ptr_array_index (priv->cmd_array, i);
+		if (g_strcmp0 (item->name, command) == 0)
+			return item->callback (priv, values, error);
+	}
+
+	/* not found */
+	g_set_error_literal (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_ARGS,
+			     "Command not found");
+	return FALSE;
+}
+
+int
+main (int argc, char *argv[])
+{
+	gboolean ret;
+	gboolean json = FALSE;
+	gint count = FU_BENCH_COUNT_DEFAULT;
+	gint parallel = 1;
+	g_autofree gchar *cmd_descriptions = NULL;
+	g_autoptr(GError) error = NULL;
+	FuBenchPrivate *priv;
+	const GOptionEntry options[] = {
+		{ "count", 'c', 0, G_OPTION_ARG_INT, &count,
+			"Number of operations to perform", "COUNT" },
+		{ "parallel", 'p', 0, G_OPTION_ARG_INT, &parallel,
+			"Number of operations kept in flight", "COUNT" },
+		{ "json", '\0', 0, G_OPTION_ARG_NONE, &json,
+			"Print machine readable JSON output", NULL },
+		{ NULL}
+	};
+
+	setlocale (LC_ALL, "");
+
+	/* ensure D-Bus errors are registered */
+	fwupd_error_quark ();
+
+	/* create helper object */
+	priv = g_new0 (FuBenchPrivate, 1);
+	priv->loop = g_main_loop_new (NULL, FALSE);
+	priv->cancellable = g_cancellable_new ();
+
+	/* add commands */
+	priv->cmd_array = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_bench_item_free);
+	fu_bench_add (priv->cmd_array,
+		      "get-devices",
+		      NULL,
+		      "Flood the daemon with GetDevices calls",
+		      fu_bench_get_devices);
+	fu_bench_add (priv->cmd_array,
+		      "get-details",
+		      "FILENAME",
+		      "Flood the daemon with GetDetails calls for a firmware file",
+		      fu_bench_get_details);
+	fu_bench_add (priv->cmd_array,
+		      "install",
+		      "DEVICE-ID FILENAME",
+		      "Flood the daemon with Install calls, e.g. against the test plugin",
+		      fu_bench_install);
+	fu_bench_add (priv->cmd_array,
+		      "soak",
+		      "DEVICE-ID FILENAME",
+		      "Drive sustained installs, tracking per-stage time and the RSS trend",
+		      fu_bench_soak);
+
+	/* sort by command name */
+	g_ptr_array_sort (priv->cmd_array,
+			  (GCompareFunc) fu_bench_sort_command_name_cb);
+
+	/* get a list of the commands */
+	priv->context = g_option_context_new (NULL);
+	cmd_descriptions = fu_bench_get_descriptions (priv->cmd_array);
+	g_option_context_set_summary (priv->context, cmd_descriptions);
+
+	g_set_application_name ("Firmware Benchmark Utility");
+	g_option_context_add_main_entries (priv->context, options, NULL);
+	ret = g_option_context_parse (priv->context, &argc, &argv, &error);
+	if (!ret) {
+		g_print ("Failed to parse arguments: %s\n", error->message);
+		return EXIT_FAILURE;
+	}
+	if (count < 1 || count > FU_BENCH_COUNT_MAX) {
+		g_print ("Invalid count, expected 1..%u\n", FU_BENCH_COUNT_MAX);
+		return EXIT_FAILURE;
+	}
+	if (parallel < 1 || parallel > count) {
+		g_print ("Invalid parallelism, expected 1..count\n");
+		return EXIT_FAILURE;
+	}
+	priv->count = (guint) count;
+	priv->parallel = (guint) parallel;
+	priv->json = json;
+
+	/* connect to the daemon */
+	priv->client = fwupd_client_new ();
+
+	/* run the specified command */
+	ret = fu_bench_run (priv, argv[1] != NULL ? argv[1] : "",
+			    (gchar**) &argv[2], &error);
+	if (!ret) {
+		if (g_error_matches (error, FWUPD_ERROR, FWUPD_ERROR_INVALID_ARGS)) {
+			g_autofree gchar *tmp = NULL;
+			tmp = g_option_context_get_help (priv->context, TRUE, NULL);
+			g_print ("%s\n\n%s", error->message, tmp);
+		} else {
+			g_print ("%s\n", error->message);
+		}
+		return EXIT_FAILURE;
+	}
+
+	/* success */
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,221 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2017 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* A FuBlob is a refcounted read-only mapping of a firmware payload. Where
+ * the kernel supports it the backing store is a sealed memfd, so the pages
+ * can be shared across the daemon/plugin boundary (and with helper
+ * processes) without a multi-hundred-MB capsule ever being duplicated in
+ * anonymous memory, and the contents provably cannot change once sealed.
+ * GBytes views created with fu_blob_get_bytes() are zero-copy and pin the
+ * mapping for their lifetime. */
+
+#include "config.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fu-blob.h"
+
+#if defined(F_ADD_SEALS) && defined(__NR_memfd_create)
+#define FU_BLOB_HAVE_MEMFD
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC		0x0001U
+#endif
+#ifndef MFD_ALLOW_SEALING
+#define MFD_ALLOW_SEALING	0x0002U
+#endif
+#endif
+
+struct _FuBlob {
+	gint		 refcnt;
+	gpointer	 addr;		/* NULL if using bytes fallback */
+	gsize		 len;
+	gboolean	 sealed;
+	GBytes		*bytes_fallback;
+};
+
+static FuBlob *
+fu_blob_new_from_mmap (gpointer addr, gsize len, gboolean sealed)
+{
+	FuBlob *blob = g_new0 (FuBlob, 1);
+	blob->refcnt = 1;
+	blob->addr = addr;
+	blob->len = len;
+	blob->sealed = sealed;
+	return blob;
+}
+
+#ifdef FU_BLOB_HAVE_MEMFD
+static gint
+fu_blob_memfd_create (void)
+{
+	return (gint) syscall (__NR_memfd_create, "fwupd-blob",
+			       MFD_CLOEXEC | MFD_ALLOW_SEALING);
+}
+#endif
+
+/**
+ * fu_blob_new_from_bytes:
+ * @bytes: the payload contents
+ * @error: A #GError or %NULL
+ *
+ * Creates a sealed read-only blob from in-memory data. If sealing is not
+ * available on this kernel the data is just referenced, which keeps the old
+ * behaviour at the cost of the pages staying anonymous.
+ *
+ * Returns: a #FuBlob, or %NULL on error
+ **/
+FuBlob *
+fu_blob_new_from_bytes (GBytes *bytes, GError **error)
+{
+#ifdef FU_BLOB_HAVE_MEMFD
+	const guint8 *data;
+	gpointer addr;
+	gsize size;
+	gint fd;
+
+	g_return_val_if_fail (bytes != NULL, NULL);
+
+	data = g_bytes_get_data (bytes, &size);
+	if (size > 0) {
+		fd = fu_blob_memfd_create ();
+		if (fd >= 0) {
+			if (write (fd, data, size) == (gssize) size &&
+			    fcntl (fd, F_ADD_SEALS,
+				   F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE) == 0) {
+				addr = mmap (NULL, size, PROT_READ,
+					     MAP_PRIVATE, fd, 0);
+				close (fd);
+				if (addr != MAP_FAILED)
+					return fu_blob_new_from_mmap (addr, size, TRUE);
+			} else {
+				close (fd);
+			}
+		}
+	}
+#endif
+
+	/* fallback: reference the existing allocation */
+	{
+		FuBlob *blob = g_new0 (FuBlob, 1);
+		blob->refcnt = 1;
+		blob->len = g_bytes_get_size (bytes);
+		blob->bytes_fallback = g_bytes_ref (bytes);
+		return blob;
+	}
+}
+
+/**
+ * fu_blob_new_from_fd:
+ * @fd: a seekable file descriptor, e.g. an extracted payload file
+ * @error: A #GError or %NULL
+ *
+ * Maps an existing file read-only. The fd is not consumed.
+ *
+ * Returns: a #FuBlob, or %NULL on error
+ **/
+FuBlob *
+fu_blob_new_from_fd (gint fd, GError **error)
+{
+	gpointer addr;
+	struct stat st;
+
+	if (fstat (fd, &st) != 0 || st.st_size == 0) {
+		g_set_error_literal (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_FAILED,
+				     "failed to stat payload fd");
+		return NULL;
+	}
+	addr = mmap (NULL, (gsize) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (addr == MAP_FAILED) {
+		g_set_error_literal (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_FAILED,
+				     "failed to map payload fd");
+		return NULL;
+	}
+	return fu_blob_new_from_mmap (addr, (gsize) st.st_size, FALSE);
+}
+
+FuBlob *
+fu_blob_ref (FuBlob *blob)
+{
+	g_return_val_if_fail (blob != NULL, NULL);
+	g_atomic_int_inc (&blob->refcnt);
+	return blob;
+}
+
+void
+fu_blob_unref (FuBlob *blob)
+{
+	g_return_if_fail (blob != NULL);
+	if (!g_atomic_int_dec_and_test (&blob->refcnt))
+		return;
+	if (blob->addr != NULL)
+		munmap (blob->addr, blob->len);
+	if (blob->bytes_fallback != NULL)
+		g_bytes_unref (blob->bytes_fallback);
+	g_free (blob);
+}
+
+static void
+fu_blob_bytes_destroy_cb (gpointer user_data)
+{
+	fu_blob_unref ((FuBlob *) user_data);
+}
+
+/**
+ * fu_blob_get_bytes:
+ * @blob: A #FuBlob
+ *
+ * Creates a zero-copy #GBytes view over the mapping; the view holds a
+ * reference on the blob so the mapping outlives all views.
+ *
+ * Returns: (transfer full): a #GBytes
+ **/
+GBytes *
+fu_blob_get_bytes (FuBlob *blob)
+{
+	g_return_val_if_fail (blob != NULL, NULL);
+	if (blob->addr == NULL)
+		return g_bytes_ref (blob->bytes_fallback);
+	return g_bytes_new_with_free_func (blob->addr, blob->len,
+					   fu_blob_bytes_destroy_cb,
+					   fu_blob_ref (blob));
+}
+
+gsize
+fu_blob_get_size (FuBlob *blob)
+{
+	g_return_val_if_fail (blob != NULL, 0);
+	return blob->len;
+}
+
+gboolean
+fu_blob_is_sealed (FuBlob *blob)
+{
+	g_return_val_if_fail (blob != NULL, FALSE);
+	return blob->sealed;
+}
@@ -0,0 +1,45 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2017 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __FU_BLOB_H
+#define __FU_BLOB_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _FuBlob FuBlob;
+
+FuBlob		*fu_blob_new_from_bytes		(GBytes		*bytes,
+						 GError		**error);
+FuBlob		*fu_blob_new_from_fd		(gint		 fd,
+						 GError		**error);
+FuBlob		*fu_blob_ref			(FuBlob		*blob);
+void		 fu_blob_unref			(FuBlob		*blob);
+GBytes		*fu_blob_get_bytes		(FuBlob		*blob);
+gsize		 fu_blob_get_size		(FuBlob		*blob);
+gboolean	 fu_blob_is_sealed		(FuBlob		*blob);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(FuBlob, fu_blob_unref)
+
+G_END_DECLS
+
+#endif /* __FU_BLOB_H */
@@ -0,0 +1,94 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2017 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "fu-checksum.h"
+
+#define FU_CHECKSUM_CHUNK_SIZE		0x10000	/* bytes */
+
+/**
+ * fu_checksum_compute_multiple:
+ * @data: the payload
+ * @len: size of @data in bytes
+ * @kinds: a zero-terminated array of #GChecksumType
+ *
+ * Computes several digests of the same payload in one streaming pass,
+ * rather than reading a large firmware image through memory once per
+ * checksum kind.
+ *
+ * Returns: (transfer full): an array of checksum strings, in @kinds order
+ **/
+GPtrArray *
+fu_checksum_compute_multiple (const guint8 *data, gsize len,
+			      const GChecksumType *kinds)
+{
+	guint n_kinds;
+	g_autofree GChecksum **csums = NULL;
+	g_autoptr(GPtrArray) hashes = NULL;
+
+	g_return_val_if_fail (data != NULL, NULL);
+	g_return_val_if_fail (kinds != NULL, NULL);
+
+	for (n_kinds = 0; kinds[n_kinds] != 0; n_kinds++);
+	csums = g_new0 (GChecksum *, n_kinds);
+	for (guint i = 0; i < n_kinds; i++)
+		csums[i] = g_checksum_new (kinds[i]);
+
+	/* feed each chunk to all the contexts whilst it is still hot in
+	 * the CPU cache */
+	for (gsize off = 0; off < len; off += FU_CHECKSUM_CHUNK_SIZE) {
+		gsize chunksz = MIN (len - off, FU_CHECKSUM_CHUNK_SIZE);
+		for (guint i = 0; i < n_kinds; i++)
+			g_checksum_update (csums[i], data + off, (gssize) chunksz);
+	}
+
+	hashes = g_ptr_array_new_with_free_func (g_free);
+	for (guint i = 0; i < n_kinds; i++) {
+		g_ptr_array_add (hashes,
+				 g_strdup (g_checksum_get_string (csums[i])));
+		g_checksum_free (csums[i]);
+	}
+	return g_steal_pointer (&hashes);
+}
+
+/**
+ * fu_checksum_compute_multiple_bytes:
+ * @blob: the payload
+ * @kinds: a zero-terminated array of #GChecksumType
+ *
+ * Computes several digests of the same payload in one streaming pass.
+ *
+ * Returns: (transfer full): an array of checksum strings, in @kinds order
+ **/
+GPtrArray *
+fu_checksum_compute_multiple_bytes (GBytes *blob, const GChecksumType *kinds)
+{
+	gsize len = 0;
+	const guint8 *data;
+
+	g_return_val_if_fail (blob != NULL, NULL);
+
+	data = g_bytes_get_data (blob, &len);
+	return fu_checksum_compute_multiple (data, len, kinds);
+}
@@ -28,6 +28,23 @@
 
 static gboolean _verbose = FALSE;
 static gboolean _console = FALSE;
+static gboolean _timing = FALSE;
+
+typedef struct {
+	gchar		*phase;
+	gint64		 start;		/* µs, monotonic */
+	gint64		 duration;	/* µs */
+} FuDebugTimingItem;
+
+static GPtrArray *_timing_items = NULL;
+static GMutex _timing_mutex;
+
+static void
+fu_debug_timing_item_free (FuDebugTimingItem *item)
+{
+	g_free (item->phase);
+	g_free (item);
+}
 
 gboolean
 fu_debug_is_verbose (void)
@@ -43,12 +60,202 @@ fu_debug_is_verbose (void)
 }
 
 
+gboolean
+fu_debug_is_timing (void)
+{
+	return _timing;
+}
+
+/**
+ * fu_debug_timing_start:
+ *
+ * Returns a timestamp for fu_debug_timing_end(), which is cheap enough to
+ * call unconditionally on the startup path.
+ **/
+gint64
+fu_debug_timing_start (void)
+{
+	return g_get_monotonic_time ();
+}
+
+/**
+ * fu_debug_timing_end:
+ * @start: the value from fu_debug_timing_start()
+ * @fmt: printf format for the phase name, e.g. "coldplug{%s}"
+ *
+ * Records one named startup phase. Safe to call from any thread, as plugin
+ * coldplug runs on worker threads.
+ **/
+void
+fu_debug_timing_end (gint64 start, const gchar *fmt, ...)
+{
+	FuDebugTimingItem *item;
+	va_list args;
+
+	if (!_timing)
+		return;
+	item = g_new0 (FuDebugTimingItem, 1);
+	va_start (args, fmt);
+	item->phase = g_strdup_vprintf (fmt, args);
+	va_end (args);
+	item->start = start;
+	item->duration = g_get_monotonic_time () - start;
+	g_mutex_lock (&_timing_mutex);
+	if (_timing_items == NULL) {
+		_timing_items = g_ptr_array_new_with_free_func ((GDestroyNotify)
+								fu_debug_timing_item_free);
+	}
+	g_ptr_array_add (_timing_items, item);
+	g_mutex_unlock (&_timing_mutex);
+}
+
+/**
+ * fu_debug_timing_report:
+ *
+ * Prints all recorded phases to stdout as a JSON array so CI images can
+ * regress-test boot latency. Offsets are relative to the earliest phase.
+ **/
+void
+fu_debug_timing_report (void)
+{
+	gint64 first = 0;
+
+	if (!_timing || _timing_items == NULL)
+		return;
+	g_mutex_lock (&_timing_mutex);
+	for (guint i = 0; i < _timing_items->len; i++) {
+		FuDebugTimingItem *item = g_ptr_array_index (_timing_items, i);
+		if (first == 0 || item->start < first)
+			first = item->start;
+	}
+	g_print ("{\"timings\":[");
+	for (guint i = 0; i < _timing_items->len; i++) {
+		FuDebugTimingItem *item = g_ptr_array_index (_timing_items, i);
+		g_print ("%s{\"phase\":\"%s\",\"offset_ms\":%.3f,\"duration_ms\":%.3f}",
+			 i == 0 ? "" : ",",
+			 item->phase,
+			 (gdouble) (item->start - first) / 1000.f,
+			 (gdouble) item->duration / 1000.f);
+	}
+	g_print ("]}\n");
+	g_mutex_unlock (&_timing_mutex);
+}
+
+/* flight recorder: the last few hundred log records are always kept in
+ * memory as raw strings and only rendered when somebody asks for a dump,
+ * so the steady-state cost of a suppressed g_debug is one strdup and a
+ * ring slot rather than timestamp formatting and console I/O */
+#define FU_DEBUG_RING_SIZE	512
+
+typedef struct {
+	gint64		 time_us;	/* wallclock, µs */
+	GLogLevelFlags	 level;
+	gchar		*domain;
+	gchar		*message;
+} FuDebugRingRecord;
+
+static FuDebugRingRecord _ring[FU_DEBUG_RING_SIZE];
+static guint _ring_head = 0;
+static guint _ring_cnt = 0;
+static GMutex _ring_mutex;
+
+static void
+fu_debug_ring_add (const gchar *log_domain,
+		   GLogLevelFlags log_level,
+		   const gchar *message)
+{
+	FuDebugRingRecord *rec;
+
+	g_mutex_lock (&_ring_mutex);
+	rec = &_ring[_ring_head];
+	g_free (rec->domain);
+	g_free (rec->message);
+	rec->time_us = g_get_real_time ();
+	rec->level = log_level;
+	rec->domain = g_strdup (log_domain);
+	rec->message = g_strdup (message);
+	_ring_head = (_ring_head + 1) % FU_DEBUG_RING_SIZE;
+	if (_ring_cnt < FU_DEBUG_RING_SIZE)
+		_ring_cnt++;
+	g_mutex_unlock (&_ring_mutex);
+}
+
+/**
+ * fu_debug_ring_dump:
+ *
+ * Renders the flight recorder contents, oldest record first. This is the
+ * only place that pays for formatting, so it is fine to call from a D-Bus
+ * method or from a crash path on a production host.
+ *
+ * Returns: (transfer full): text to show the user, or %NULL if empty
+ **/
+gchar *
+fu_debug_ring_dump (void)
+{
+	g_autoptr(GString) str = NULL;
+
+	g_mutex_lock (&_ring_mutex);
+	if (_ring_cnt == 0) {
+		g_mutex_unlock (&_ring_mutex);
+		return NULL;
+	}
+	str = g_string_new (NULL);
+	for (guint i = 0; i < _ring_cnt; i++) {
+		FuDebugRingRecord *rec;
+		const gchar *lvl = "";
+		guint idx = (_ring_head + FU_DEBUG_RING_SIZE - _ring_cnt + i) %
+				FU_DEBUG_RING_SIZE;
+		g_autoptr(GDateTime) dt = NULL;
+
+		rec = &_ring[idx];
+		dt = g_date_time_new_from_unix_utc (rec->time_us / G_USEC_PER_SEC);
+		if (rec->level & G_LOG_LEVEL_WARNING)
+			lvl = "WARNING: ";
+		else if (rec->level & (G_LOG_LEVEL_CRITICAL | G_LOG_LEVEL_ERROR))
+			lvl = "CRITICAL: ";
+		g_string_append_printf (str, "%02i:%02i:%02i:%04i %s %s%s\n",
+					g_date_time_get_hour (dt),
+					g_date_time_get_minute (dt),
+					g_date_time_get_second (dt),
+					(gint) ((rec->time_us / 1000) % 1000),
+					rec->domain != NULL ? rec->domain : "",
+					lvl,
+					rec->message);
+	}
+	g_mutex_unlock (&_ring_mutex);
+	return g_string_free (g_steal_pointer (&str), FALSE);
+}
+
+static void
+fu_debug_ring_destroy (void)
+{
+	g_mutex_lock (&_ring_mutex);
+	for (guint i = 0; i < FU_DEBUG_RING_SIZE; i++) {
+		g_clear_pointer (&_ring[i].domain, g_free);
+		g_clear_pointer (&_ring[i].message, g_free);
+	}
+	_ring_head = 0;
+	_ring_cnt = 0;
+	g_mutex_unlock (&_ring_mutex);
+}
+
 static void
 fu_debug_ignore_cb (const gchar *log_domain,
 		    GLogLevelFlags log_level,
 		    const gchar *message,
 		    gpointer user_data)
 {
+	/* always recorded, even when not printed */
+	fu_debug_ring_add (log_domain, log_level, message);
+
+	/* fatal: the process is about to abort, so flush the flight
+	 * recorder where the journal will pick it up */
+	if (log_level & G_LOG_LEVEL_ERROR) {
+		g_autofree gchar *dump = fu_debug_ring_dump ();
+		if (dump != NULL)
+			g_printerr ("%s", dump);
+	}
+
 	/* syslog */
 	switch (log_level) {
 	case G_LOG_LEVEL_INFO:
@@ -72,6 +279,9 @@ fu_debug_handler_cb (const gchar *log_domain,
 	g_autoptr(GDateTime) dt = g_date_time_new_now_utc ();
 	g_autoptr(GString) domain = NULL;
 
+	/* keep the flight recorder consistent in verbose mode too */
+	fu_debug_ring_add (log_domain, log_level, message);
+
 	/* time header */
 	tmp = g_strdup_printf ("%02i:%02i:%02i:%04i",
 			       g_date_time_get_hour (dt),
@@ -128,6 +338,9 @@ fu_debug_pre_parse_hook (GOptionContext *context,
 		{ "verbose", 'v', 0, G_OPTION_ARG_NONE, &_verbose,
 		  /* TRANSLATORS: turn on all debugging */
 		  N_("Show debugging information for all files"), NULL },
+		{ "timing", '\0', 0, G_OPTION_ARG_NONE, &_timing,
+		  /* TRANSLATORS: print a machine-readable startup timing report */
+		  N_("Print startup phase timings as JSON"), NULL },
 		{ NULL}
 	};
 
@@ -139,6 +352,8 @@ fu_debug_pre_parse_hook (GOptionContext *context,
 void
 fu_debug_destroy (void)
 {
+	g_clear_pointer (&_timing_items, g_ptr_array_unref);
+	fu_debug_ring_destroy ();
 }
 
 void
@@ -148,10 +363,13 @@ fu_debug_setup (gboolean enabled)
 		g_log_set_fatal_mask (NULL, G_LOG_LEVEL_ERROR |
 					    G_LOG_LEVEL_CRITICAL);
 		g_log_set_default_handler (fu_debug_handler_cb, NULL);
+		/* plugins gate expensive debug formatting on the same
+		 * variable fu_debug_is_verbose() falls back to */
+		g_setenv ("VERBOSE", "1", FALSE);
 	} else {
-		/* hide all debugging */
-		g_log_set_handler (G_LOG_DOMAIN, G_LOG_LEVEL_DEBUG,
-				   fu_debug_ignore_cb, NULL);
+		/* hide all debugging, but still feed every domain into the
+		 * flight recorder so a dump is useful on production hosts */
+		g_log_set_default_handler (fu_debug_ignore_cb, NULL);
 	}
 
 	/* are we on an actual TTY? */
@@ -28,5 +28,12 @@ gboolean	 fu_debug_is_verbose		(void);
 GOptionGroup	*fu_debug_get_option_group	(void);
 void		 fu_debug_setup			(gboolean	 enabled);
 void		 fu_debug_destroy		(void);
+gboolean	 fu_debug_is_timing		(void);
+gint64		 fu_debug_timing_start		(void);
+void		 fu_debug_timing_end		(gint64		 start,
+						 const gchar	*fmt,
+						 ...) G_GNUC_PRINTF (2, 3);
+void		 fu_debug_timing_report		(void);
+gchar		*fu_debug_ring_dump		(void);
 
 #endif /* __FU_DEBUG_H__ */
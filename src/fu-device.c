@@ -26,6 +26,7 @@
 #include <gio/gio.h>
 
 #include "fu-device.h"
+#include "fu-guid.h"
 
 static void fu_device_finalize			 (GObject *object);
 
@@ -76,7 +77,7 @@ fu_device_add_guid (FuDevice *device, const gchar *guid)
 {
 	/* make valid */
 	if (!as_utils_guid_is_valid (guid)) {
-		g_autofree gchar *tmp = as_utils_guid_from_string (guid);
+		g_autofree gchar *tmp = fu_guid_from_string (guid);
 		g_debug ("using %s for %s", tmp, guid);
 		fwupd_device_add_guid (fwupd_result_get_device (FWUPD_RESULT (device)), tmp);
 		return;
@@ -0,0 +1,151 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2017 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <appstream-glib.h>
+#include <glib.h>
+
+#include "fu-guid.h"
+
+/* deriving a GUID is a SHA-1 computation per call, and the same source
+ * strings are derived constantly -- every HWID per boot, every DeviceID
+ * per enumeration -- so memoize the results process-wide */
+#define FU_GUID_CACHE_MAX_ENTRIES	512
+
+static GMutex		 fu_guid_mutex;
+static GHashTable	*fu_guid_cache = NULL;		/* source:guid */
+static GQueue		 fu_guid_cache_mru = G_QUEUE_INIT;
+
+/* the mutex must be held; moves the entry to most-recently-used */
+static gchar *
+fu_guid_cache_get (const gchar *key)
+{
+	gpointer key_orig = NULL;
+	gpointer guid = NULL;
+
+	if (fu_guid_cache == NULL)
+		return NULL;
+	if (!g_hash_table_lookup_extended (fu_guid_cache, key, &key_orig, &guid))
+		return NULL;
+	g_queue_remove (&fu_guid_cache_mru, key_orig);
+	g_queue_push_tail (&fu_guid_cache_mru, key_orig);
+	return g_strdup (guid);
+}
+
+/* the mutex must be held; evicts the least-recently-used entry */
+static void
+fu_guid_cache_add (const gchar *key, const gchar *guid)
+{
+	gchar *key_owned;
+
+	if (fu_guid_cache == NULL) {
+		fu_guid_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+						       g_free, g_free);
+	}
+	if (g_hash_table_size (fu_guid_cache) >= FU_GUID_CACHE_MAX_ENTRIES) {
+		gchar *key_old = g_queue_pop_head (&fu_guid_cache_mru);
+		g_hash_table_remove (fu_guid_cache, key_old);
+	}
+	key_owned = g_strdup (key);
+	g_hash_table_insert (fu_guid_cache, key_owned, g_strdup (guid));
+	g_queue_push_tail (&fu_guid_cache_mru, key_owned);
+}
+
+/**
+ * fu_guid_from_string:
+ * @str: A source string, e.g. "PCI\VEN_8086&DEV_0A2B"
+ *
+ * Returns the GUID derived from a namespace string, as
+ * as_utils_guid_from_string() would, but with the result memoized so the
+ * same string is not hashed again on every enumeration.
+ *
+ * Returns: (transfer full): a GUID string, or %NULL for error
+ **/
+gchar *
+fu_guid_from_string (const gchar *str)
+{
+	gchar *guid;
+	g_autofree gchar *tmp = NULL;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_val_if_fail (str != NULL, NULL);
+
+	locker = g_mutex_locker_new (&fu_guid_mutex);
+	guid = fu_guid_cache_get (str);
+	if (guid != NULL)
+		return guid;
+	tmp = as_utils_guid_from_string (str);
+	if (tmp == NULL)
+		return NULL;
+	fu_guid_cache_add (str, tmp);
+	return g_steal_pointer (&tmp);
+}
+
+/**
+ * fu_guid_from_string_ns:
+ * @namespace_id: A custom GUID namespace
+ * @str: A source string
+ * @error: A #GError or %NULL
+ *
+ * Returns the Microsoft-compatible GUID for a string, i.e. converted to
+ * UTF-16 and hashed into @namespace_id, with the result memoized.
+ *
+ * Returns: (transfer full): a GUID string, or %NULL for error
+ **/
+gchar *
+fu_guid_from_string_ns (const gchar *namespace_id, const gchar *str, GError **error)
+{
+#if AS_CHECK_VERSION(0,6,13)
+	gchar *guid;
+	glong items_written = 0;
+	g_autofree gchar *key = NULL;
+	g_autofree gchar *tmp = NULL;
+	g_autofree gunichar2 *data = NULL;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_val_if_fail (namespace_id != NULL, NULL);
+	g_return_val_if_fail (str != NULL, NULL);
+
+	key = g_strdup_printf ("%s:%s", namespace_id, str);
+	locker = g_mutex_locker_new (&fu_guid_mutex);
+	guid = fu_guid_cache_get (key);
+	if (guid != NULL)
+		return guid;
+	data = g_utf8_to_utf16 (str, -1, NULL, &items_written, error);
+	if (data == NULL)
+		return NULL;
+	tmp = as_utils_guid_from_data (namespace_id,
+				       (guint8 *) data,
+				       items_written * 2,
+				       error);
+	if (tmp == NULL)
+		return NULL;
+	fu_guid_cache_add (key, tmp);
+	return g_steal_pointer (&tmp);
+#else
+	g_set_error_literal (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_NOT_SUPPORTED,
+			     "libappstream-glib 0.6.13 is required");
+	return NULL;
+#endif
+}
@@ -24,7 +24,9 @@
 #include <string.h>
 #include <appstream-glib.h>
 
+#include "fu-guid.h"
 #include "fu-hwids.h"
+#include "fu-smbios.h"
 
 struct _FuHwids {
 	GObject			 parent_instance;
@@ -42,26 +44,43 @@ fu_hwids_get_value (FuHwids *self, const gchar *key)
 static gchar *
 fu_hwids_get_guid_for_str (const gchar *str, GError **error)
 {
-#if AS_CHECK_VERSION(0,6,13)
 	const gchar *namespace_id = "70ffd812-4c7f-4c7d-0000-000000000000";
-	glong items_written = 0;
-	g_autofree gunichar2 *data = NULL;
+	return fu_guid_from_string_ns (namespace_id, str, error);
+}
+
+/**
+ * fu_hwids_get_checksum:
+ * @self: A #FuHwids
+ *
+ * Gets a checksum that identifies the raw SMBIOS values, which only changes
+ * when the system firmware is modified.
+ *
+ * Returns: a SHA1 hash, or %NULL if no values have been read.
+ **/
+gchar *
+fu_hwids_get_checksum (FuHwids *self)
+{
+	g_autoptr(GChecksum) csum = NULL;
+	g_autoptr(GList) keys = NULL;
 
-	/* convert to UTF-16 and convert to GUID using custom namespace */
-	data = g_utf8_to_utf16 (str, -1, NULL, &items_written, error);
-	if (data == NULL)
+	g_return_val_if_fail (FU_IS_HWIDS (self), NULL);
+
+	if (g_hash_table_size (self->hash) == 0)
 		return NULL;
-	return as_utils_guid_from_data (namespace_id,
-					(guint8*) data,
-					items_written * 2,
-					error);
-#else
-	g_set_error_literal (error,
-			     G_IO_ERROR,
-			     G_IO_ERROR_NOT_SUPPORTED,
-			     "libappstream-glib 0.6.13 is required");
-	return FALSE;
-#endif
+
+	/* sort the keys so the hash is stable */
+	csum = g_checksum_new (G_CHECKSUM_SHA1);
+	keys = g_list_sort (g_hash_table_get_keys (self->hash),
+			    (GCompareFunc) g_strcmp0);
+	for (GList *l = keys; l != NULL; l = l->next) {
+		const gchar *key = l->data;
+		const gchar *value = g_hash_table_lookup (self->hash, key);
+		g_checksum_update (csum, (const guchar *) key, -1);
+		g_checksum_update (csum, (const guchar *) "=", 1);
+		g_checksum_update (csum, (const guchar *) value, -1);
+		g_checksum_update (csum, (const guchar *) "\n", 1);
+	}
+	return g_strdup (g_checksum_get_string (csum));
 }
 
 /**
@@ -282,6 +301,93 @@ fu_hwids_setup (FuHwids *self, const gchar *sysfsdir, GError **error)
 	return TRUE;
 }
 
+/**
+ * fu_hwids_setup_from_smbios:
+ * @self: A #FuHwids
+ * @smbios: A #FuSmbios that has already been set up
+ * @error: A #GError or %NULL
+ *
+ * Reads all the SMBIOS values from an already-parsed DMI table, which avoids
+ * opening and reading a dozen separate sysfs files.
+ *
+ * Returns: %TRUE for success
+ **/
+gboolean
+fu_hwids_setup_from_smbios (FuHwids *self, FuSmbios *smbios, GError **error)
+{
+	struct {
+		const gchar *key;
+		guint8 type;
+		guint8 offset;
+		gboolean is_integer;
+	} smbiosfield[] = {
+		{ FU_HWIDS_KEY_MANUFACTURER,		0x01, 0x04, FALSE },
+		{ FU_HWIDS_KEY_ENCLOSURE_KIND,		0x03, 0x05, TRUE },
+		{ FU_HWIDS_KEY_FAMILY,			0x01, 0x1a, FALSE },
+		{ FU_HWIDS_KEY_PRODUCT_NAME,		0x01, 0x05, FALSE },
+		{ FU_HWIDS_KEY_PRODUCT_SKU,		0x01, 0x19, FALSE },
+		{ FU_HWIDS_KEY_BIOS_VENDOR,		0x00, 0x04, FALSE },
+		{ FU_HWIDS_KEY_BIOS_VERSION,		0x00, 0x05, FALSE },
+		{ FU_HWIDS_KEY_BIOS_MAJOR_RELEASE,	0x00, 0x14, TRUE },
+		{ FU_HWIDS_KEY_BIOS_MINOR_RELEASE,	0x00, 0x15, TRUE },
+		{ FU_HWIDS_KEY_BASEBOARD_MANUFACTURER,	0x02, 0x04, FALSE },
+		{ FU_HWIDS_KEY_BASEBOARD_PRODUCT,	0x02, 0x05, FALSE },
+		{ NULL, 0x00, 0x00, FALSE }
+	};
+
+	g_return_val_if_fail (FU_IS_HWIDS (self), FALSE);
+	g_return_val_if_fail (FU_IS_SMBIOS (smbios), FALSE);
+
+	for (guint i = 0; smbiosfield[i].key != NULL; i++) {
+		const gchar *contents_hdr;
+		g_autofree gchar *contents = NULL;
+		g_autoptr(GError) error_local = NULL;
+
+		if (smbiosfield[i].is_integer) {
+			guint tmp = fu_smbios_get_integer (smbios,
+							   smbiosfield[i].type,
+							   smbiosfield[i].offset,
+							   &error_local);
+			if (tmp == G_MAXUINT) {
+				g_debug ("no %s so ignoring: %s",
+					 smbiosfield[i].key,
+					 error_local->message);
+				continue;
+			}
+			contents = g_strdup_printf ("%u", tmp);
+		} else {
+			const gchar *tmp = fu_smbios_get_string (smbios,
+								 smbiosfield[i].type,
+								 smbiosfield[i].offset,
+								 &error_local);
+			if (tmp == NULL) {
+				g_debug ("no %s so ignoring: %s",
+					 smbiosfield[i].key,
+					 error_local->message);
+				continue;
+			}
+			contents = g_strdup (tmp);
+		}
+		g_debug ("smbios property %s=%s", smbiosfield[i].key, contents);
+
+		/* both dummy values used by vendors */
+		if (g_strcmp0 (contents, "Not Available") == 0)
+			continue;
+		if (g_strcmp0 (contents, "Not Defined") == 0)
+			continue;
+
+		/* weirdly, remove leading zeros */
+		contents_hdr = contents;
+		while (contents_hdr[0] == '0')
+			contents_hdr++;
+		g_hash_table_insert (self->hash,
+				     g_strdup (smbiosfield[i].key),
+				     g_strdup (contents_hdr));
+	}
+
+	return TRUE;
+}
+
 static void
 fu_hwids_finalize (GObject *object)
 {
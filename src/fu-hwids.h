@@ -24,6 +24,8 @@
 
 #include <glib-object.h>
 
+#include "fu-smbios.h"
+
 G_BEGIN_DECLS
 
 #define FU_TYPE_HWIDS (fu_hwids_get_type ())
@@ -46,6 +48,7 @@ FuHwids		*fu_hwids_new			(void);
 
 const gchar	*fu_hwids_get_value		(FuHwids	*self,
 						 const gchar	*key);
+gchar		*fu_hwids_get_checksum		(FuHwids	*self);
 const gchar	*fu_hwids_get_replace_keys	(FuHwids	*self,
 						 const gchar	*key);
 gchar		*fu_hwids_get_replace_values	(FuHwids	*self,
@@ -57,6 +60,9 @@ gchar		*fu_hwids_get_guid		(FuHwids	*self,
 gboolean	 fu_hwids_setup			(FuHwids	*self,
 						 const gchar	*sysfsdir,
 						 GError		**error);
+gboolean	 fu_hwids_setup_from_smbios	(FuHwids	*self,
+						 FuSmbios	*smbios,
+						 GError		**error);
 
 G_END_DECLS
 
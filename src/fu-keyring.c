@@ -24,12 +24,23 @@
 #include <fwupd.h>
 #include <gpgme.h>
 
+#include "fu-debug.h"
 #include "fu-keyring.h"
+#include "fu-trace.h"
 
 static void fu_keyring_finalize			 (GObject *object);
 
+#define FU_KEYRING_VERIFIED_CACHE	"/var/cache/fwupd/verified.cache"
+#define FU_KEYRING_BUILTIN_PREFIX	"/org/freedesktop/fwupd/pki"
+
 typedef struct {
 	gpgme_ctx_t		 ctx;
+	GChecksum		*state_csum;	/* of imported public keys */
+	GHashTable		*verified;	/* cache-key:1 */
+	gboolean		 verified_loaded;
+	GThread			*thread_preload;
+	gchar			*preload_dir;
+	GError			*preload_error;
 } FuKeyringPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (FuKeyring, fu_keyring, G_TYPE_OBJECT)
@@ -37,11 +48,22 @@ G_DEFINE_TYPE_WITH_PRIVATE (FuKeyring, fu_keyring, G_TYPE_OBJECT)
 
 G_DEFINE_AUTO_CLEANUP_FREE_FUNC(gpgme_data_t, gpgme_data_release, NULL)
 
+static gchar *
+fu_keyring_get_homedir (void)
+{
+	return g_build_filename (LOCALSTATEDIR,
+				 "lib",
+				 PACKAGE_NAME,
+				 "gnupg",
+				 NULL);
+}
+
 static gboolean
 fu_keyring_setup (FuKeyring *keyring, GError **error)
 {
 	FuKeyringPrivate *priv = GET_PRIVATE (keyring);
 	gpgme_error_t rc;
+	gint64 timing = fu_debug_timing_start ();
 	g_autofree gchar *gpg_home = NULL;
 
 	g_return_val_if_fail (FU_IS_KEYRING (keyring), FALSE);
@@ -86,11 +108,7 @@ fu_keyring_setup (FuKeyring *keyring, GError **error)
 	}
 
 	/* set a custom home directory */
-	gpg_home = g_build_filename (LOCALSTATEDIR,
-				     "lib",
-				     PACKAGE_NAME,
-				     "gnupg",
-				     NULL);
+	gpg_home = fu_keyring_get_homedir ();
 	if (g_mkdir_with_parents (gpg_home, 0700) < 0) {
 		g_set_error (error,
 			     FWUPD_ERROR,
@@ -116,11 +134,15 @@ fu_keyring_setup (FuKeyring *keyring, GError **error)
 	/* enable armor mode */
 	gpgme_set_armor (priv->ctx, TRUE);
 
+	fu_debug_timing_end (timing, "keyring-setup");
 	return TRUE;
 }
 
-gboolean
-fu_keyring_add_public_key (FuKeyring *keyring, const gchar *filename, GError **error)
+static gboolean
+fu_keyring_add_public_key_blob (FuKeyring *keyring,
+				GBytes *blob,
+				const gchar *name,
+				GError **error)
 {
 	FuKeyringPrivate *priv = GET_PRIVATE (keyring);
 	gpgme_error_t rc;
@@ -128,18 +150,17 @@ fu_keyring_add_public_key (FuKeyring *keyring, const gchar *filename, GError **e
 	gpgme_import_status_t s;
 	g_auto(gpgme_data_t) data = NULL;
 
-	g_return_val_if_fail (FU_IS_KEYRING (keyring), FALSE);
-	g_return_val_if_fail (filename != NULL, FALSE);
-
 	/* import public key */
-	g_debug ("Adding public key %s", filename);
-	rc = gpgme_data_new_from_file (&data, filename, 1);
+	g_debug ("Adding public key %s", name);
+	rc = gpgme_data_new_from_mem (&data,
+				      g_bytes_get_data (blob, NULL),
+				      g_bytes_get_size (blob), 0);
 	if (rc != GPG_ERR_NO_ERROR) {
 		g_set_error (error,
 			     FWUPD_ERROR,
 			     FWUPD_ERROR_INTERNAL,
 			     "failed to load %s: %s",
-			     filename, gpgme_strerror (rc));
+			     name, gpgme_strerror (rc));
 		return FALSE;
 	}
 	rc = gpgme_op_import (priv->ctx, data);
@@ -148,10 +169,16 @@ fu_keyring_add_public_key (FuKeyring *keyring, const gchar *filename, GError **e
 			     FWUPD_ERROR,
 			     FWUPD_ERROR_INTERNAL,
 			     "failed to import %s: %s",
-			     filename, gpgme_strerror (rc));
+			     name, gpgme_strerror (rc));
 		return FALSE;
 	}
 
+	/* include the key in the keyring state, so the verification cache
+	 * goes stale when a key is added, removed or changed */
+	g_checksum_update (priv->state_csum,
+			   g_bytes_get_data (blob, NULL),
+			   (gssize) g_bytes_get_size (blob));
+
 	/* print what keys were imported */
 	result = gpgme_op_import_result (priv->ctx);
 	for (s = result->imports; s != NULL; s = s->next) {
@@ -169,16 +196,93 @@ fu_keyring_add_public_key (FuKeyring *keyring, const gchar *filename, GError **e
 			     FWUPD_ERROR,
 			     FWUPD_ERROR_INTERNAL,
 			     "key import failed %s",
-			     filename);
+			     name);
 		return FALSE;
 	}
 	return TRUE;
 }
 
+gboolean
+fu_keyring_add_public_key (FuKeyring *keyring, const gchar *filename, GError **error)
+{
+	gsize key_len = 0;
+	g_autofree gchar *key_data = NULL;
+	g_autoptr(GBytes) blob = NULL;
+
+	g_return_val_if_fail (FU_IS_KEYRING (keyring), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+
+	if (!g_file_get_contents (filename, &key_data, &key_len, error))
+		return FALSE;
+	blob = g_bytes_new_take (g_steal_pointer (&key_data), key_len);
+	return fu_keyring_add_public_key_blob (keyring, blob, filename, error);
+}
+
+static gboolean
+fu_keyring_import_blobs (FuKeyring *keyring,
+			 GPtrArray *blobs,	/* of GBytes */
+			 GPtrArray *names,	/* of utf8 */
+			 const gchar *stamp_id,
+			 GError **error)
+{
+	FuKeyringPrivate *priv = GET_PRIVATE (keyring);
+	g_autofree gchar *gpg_home = NULL;
+	g_autofree gchar *stamp_fn = NULL;
+	g_autofree gchar *stamp_old = NULL;
+	g_autoptr(GChecksum) bundle = g_checksum_new (G_CHECKSUM_SHA256);
+
+	for (guint i = 0; i < blobs->len; i++) {
+		GBytes *blob = g_ptr_array_index (blobs, i);
+		g_checksum_update (bundle,
+				   g_bytes_get_data (blob, NULL),
+				   (gssize) g_bytes_get_size (blob));
+	}
+
+	/* the pubring was built from exactly this bundle of keys, so skip
+	 * the per-key import parsing and just account the keyring state */
+	gpg_home = fu_keyring_get_homedir ();
+	stamp_fn = g_strdup_printf ("%s/fwupd-imported-%s.sha256",
+				    gpg_home, stamp_id);
+	if (g_file_get_contents (stamp_fn, &stamp_old, NULL, NULL) &&
+	    g_strcmp0 (stamp_old, g_checksum_get_string (bundle)) == 0) {
+		g_debug ("bundle %s unchanged, skipping import", stamp_id);
+		for (guint i = 0; i < blobs->len; i++) {
+			GBytes *blob = g_ptr_array_index (blobs, i);
+			g_checksum_update (priv->state_csum,
+					   g_bytes_get_data (blob, NULL),
+					   (gssize) g_bytes_get_size (blob));
+		}
+		return TRUE;
+	}
+
+	/* import each key, leaving the stamp for the next daemon start */
+	for (guint i = 0; i < blobs->len; i++) {
+		if (!fu_keyring_add_public_key_blob (keyring,
+						     g_ptr_array_index (blobs, i),
+						     g_ptr_array_index (names, i),
+						     error))
+			return FALSE;
+	}
+	if (!g_file_set_contents (stamp_fn,
+				  g_checksum_get_string (bundle), -1, NULL))
+		g_debug ("failed to save %s", stamp_fn);
+	return TRUE;
+}
+
+static gint
+fu_keyring_name_sort_cb (gconstpointer a, gconstpointer b)
+{
+	return g_strcmp0 (*((const gchar **) a), *((const gchar **) b));
+}
+
 gboolean
 fu_keyring_add_public_keys (FuKeyring *keyring, const gchar *dirname, GError **error)
 {
+	const gchar *filename;
+	g_autofree gchar *stamp_id = NULL;
 	g_autoptr(GDir) dir = NULL;
+	g_autoptr(GPtrArray) blobs = NULL;
+	g_autoptr(GPtrArray) names = NULL;
 
 	g_return_val_if_fail (FU_IS_KEYRING (keyring), FALSE);
 	g_return_val_if_fail (dirname != NULL, FALSE);
@@ -187,20 +291,139 @@ fu_keyring_add_public_keys (FuKeyring *keyring, const gchar *dirname, GError **e
 	if (!fu_keyring_setup (keyring, error))
 		return FALSE;
 
-	/* search all the public key files */
+	/* search all the public key files, sorted so the bundle checksum
+	 * does not depend on readdir ordering */
 	dir = g_dir_open (dirname, 0, error);
 	if (dir == NULL)
 		return FALSE;
-	do {
-		const gchar *filename;
-		g_autofree gchar *path_tmp = NULL;
-		filename = g_dir_read_name (dir);
-		if (filename == NULL)
-			break;
-		path_tmp = g_build_filename (dirname, filename, NULL);
-		if (!fu_keyring_add_public_key (keyring, path_tmp, error))
+	names = g_ptr_array_new_with_free_func (g_free);
+	while ((filename = g_dir_read_name (dir)) != NULL)
+		g_ptr_array_add (names, g_build_filename (dirname, filename, NULL));
+	g_ptr_array_sort (names, fu_keyring_name_sort_cb);
+	blobs = g_ptr_array_new_with_free_func ((GDestroyNotify) g_bytes_unref);
+	for (guint i = 0; i < names->len; i++) {
+		gchar *key_data = NULL;
+		gsize key_len = 0;
+		if (!g_file_get_contents (g_ptr_array_index (names, i),
+					  &key_data, &key_len, error))
 			return FALSE;
-	} while (TRUE);
+		g_ptr_array_add (blobs, g_bytes_new_take (key_data, key_len));
+	}
+	stamp_id = g_path_get_basename (dirname);
+	return fu_keyring_import_blobs (keyring, blobs, names, stamp_id, error);
+}
+
+gboolean
+fu_keyring_add_builtin_keys (FuKeyring *keyring, GError **error)
+{
+	g_auto(GStrv) children = NULL;
+	g_autoptr(GPtrArray) blobs = NULL;
+	g_autoptr(GPtrArray) names = NULL;
+
+	g_return_val_if_fail (FU_IS_KEYRING (keyring), FALSE);
+
+	/* setup context */
+	if (!fu_keyring_setup (keyring, error))
+		return FALSE;
+
+	/* the vendor keys compiled into the binary */
+	children = g_resources_enumerate_children (FU_KEYRING_BUILTIN_PREFIX,
+						   G_RESOURCE_LOOKUP_FLAGS_NONE,
+						   error);
+	if (children == NULL)
+		return FALSE;
+	names = g_ptr_array_new_with_free_func (g_free);
+	for (guint i = 0; children[i] != NULL; i++) {
+		g_ptr_array_add (names, g_build_path ("/",
+						      FU_KEYRING_BUILTIN_PREFIX,
+						      children[i], NULL));
+	}
+	g_ptr_array_sort (names, fu_keyring_name_sort_cb);
+	blobs = g_ptr_array_new_with_free_func ((GDestroyNotify) g_bytes_unref);
+	for (guint i = 0; i < names->len; i++) {
+		GBytes *blob = g_resources_lookup_data (g_ptr_array_index (names, i),
+							G_RESOURCE_LOOKUP_FLAGS_NONE,
+							error);
+		if (blob == NULL)
+			return FALSE;
+		g_ptr_array_add (blobs, blob);
+	}
+	return fu_keyring_import_blobs (keyring, blobs, names, "builtin", error);
+}
+
+static gpointer
+fu_keyring_preload_thread_cb (gpointer user_data)
+{
+	FuKeyring *keyring = FU_KEYRING (user_data);
+	FuKeyringPrivate *priv = GET_PRIVATE (keyring);
+	gint64 timing = fu_debug_timing_start ();
+
+	if (priv->preload_dir != NULL) {
+		if (!fu_keyring_add_public_keys (keyring,
+						 priv->preload_dir,
+						 &priv->preload_error))
+			return NULL;
+	} else {
+		if (!fu_keyring_add_builtin_keys (keyring,
+						  &priv->preload_error))
+			return NULL;
+	}
+	fu_debug_timing_end (timing, "keyring-preload{%s}",
+			     priv->preload_dir != NULL ? priv->preload_dir : "builtin");
+	return NULL;
+}
+
+/**
+ * fu_keyring_preload:
+ * @keyring: A #FuKeyring
+ * @dirname: A directory of public keys, e.g. "/etc/pki/fwupd", or %NULL to
+ * use the vendor keys compiled into the binary
+ *
+ * Starts setting up gpgme and importing the public keys on a worker thread,
+ * as spawning gpg and creating the homedir is slow. Any verify call made
+ * before the thread has finished blocks until it has; any failure is
+ * reported from fu_keyring_preload_wait() or the verify call itself.
+ **/
+void
+fu_keyring_preload (FuKeyring *keyring, const gchar *dirname)
+{
+	FuKeyringPrivate *priv = GET_PRIVATE (keyring);
+
+	g_return_if_fail (FU_IS_KEYRING (keyring));
+	g_return_if_fail (priv->thread_preload == NULL);
+
+	priv->preload_dir = g_strdup (dirname);
+	priv->thread_preload = g_thread_new ("FuKeyring",
+					     fu_keyring_preload_thread_cb,
+					     keyring);
+}
+
+/**
+ * fu_keyring_preload_wait:
+ * @keyring: A #FuKeyring
+ * @error: A #GError or %NULL
+ *
+ * Waits for any fu_keyring_preload() to finish. If the keyring was never
+ * preloaded this does nothing.
+ *
+ * Returns: %TRUE for success
+ **/
+gboolean
+fu_keyring_preload_wait (FuKeyring *keyring, GError **error)
+{
+	FuKeyringPrivate *priv = GET_PRIVATE (keyring);
+
+	g_return_val_if_fail (FU_IS_KEYRING (keyring), FALSE);
+
+	if (priv->thread_preload != NULL) {
+		g_thread_join (priv->thread_preload);
+		priv->thread_preload = NULL;
+	}
+	if (priv->preload_error != NULL) {
+		if (error != NULL)
+			*error = g_error_copy (priv->preload_error);
+		return FALSE;
+	}
 	return TRUE;
 }
 
@@ -273,6 +496,10 @@ fu_keyring_verify_file (FuKeyring *keyring,
 	g_return_val_if_fail (filename != NULL, FALSE);
 	g_return_val_if_fail (signature != NULL, FALSE);
 
+	/* wait for any preload to finish */
+	if (!fu_keyring_preload_wait (keyring, error))
+		return FALSE;
+
 	/* setup context */
 	if (!fu_keyring_setup (keyring, error))
 		return FALSE;
@@ -311,7 +538,9 @@ fu_keyring_verify_file (FuKeyring *keyring,
 	}
 
 	/* verify */
+	fu_trace (gpgme_verify_start);
 	rc = gpgme_op_verify (priv->ctx, sig, data, NULL);
+	fu_trace (gpgme_verify_done);
 	if (rc != GPG_ERR_NO_ERROR) {
 		g_set_error (error,
 			     FWUPD_ERROR,
@@ -340,6 +569,91 @@ fu_keyring_verify_file (FuKeyring *keyring,
 	return TRUE;
 }
 
+static gchar *
+fu_keyring_get_cache_key (FuKeyring *keyring,
+			  GBytes *payload,
+			  GBytes *payload_signature)
+{
+	FuKeyringPrivate *priv = GET_PRIVATE (keyring);
+	g_autofree gchar *csum_payload = NULL;
+	g_autofree gchar *csum_sig = NULL;
+	g_autoptr(GChecksum) state = NULL;
+
+	/* the key covers the payload, the signature and the keyring state so
+	 * a cached result can never outlive any of its inputs */
+	csum_payload = g_compute_checksum_for_bytes (G_CHECKSUM_SHA256, payload);
+	csum_sig = g_compute_checksum_for_bytes (G_CHECKSUM_SHA256, payload_signature);
+	state = g_checksum_copy (priv->state_csum);
+	return g_strdup_printf ("%s:%s:%s",
+				csum_payload,
+				csum_sig,
+				g_checksum_get_string (state));
+}
+
+static void
+fu_keyring_verified_load (FuKeyring *keyring)
+{
+	FuKeyringPrivate *priv = GET_PRIVATE (keyring);
+	g_autofree gchar *data = NULL;
+	g_auto(GStrv) lines = NULL;
+	g_autoptr(GError) error_local = NULL;
+
+	/* already done */
+	if (priv->verified_loaded)
+		return;
+	priv->verified_loaded = TRUE;
+
+	/* no cache file is perfectly fine */
+	if (!g_file_get_contents (FU_KEYRING_VERIFIED_CACHE,
+				  &data, NULL, &error_local)) {
+		g_debug ("failed to load %s: %s",
+			 FU_KEYRING_VERIFIED_CACHE, error_local->message);
+		return;
+	}
+	lines = g_strsplit (data, "\n", -1);
+	for (guint i = 0; lines[i] != NULL; i++) {
+		if (lines[i][0] == '\0')
+			continue;
+		g_hash_table_insert (priv->verified,
+				     g_strdup (lines[i]),
+				     GUINT_TO_POINTER (1));
+	}
+	g_debug ("loaded %u verification results from %s",
+		 g_hash_table_size (priv->verified),
+		 FU_KEYRING_VERIFIED_CACHE);
+}
+
+static void
+fu_keyring_verified_add (FuKeyring *keyring, const gchar *cache_key)
+{
+	FuKeyringPrivate *priv = GET_PRIVATE (keyring);
+	g_autofree gchar *dirname = NULL;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GList) keys = NULL;
+	g_autoptr(GString) str = NULL;
+
+	g_hash_table_insert (priv->verified,
+			     g_strdup (cache_key),
+			     GUINT_TO_POINTER (1));
+
+	/* persist for the next daemon start; failing to do so just means
+	 * paying for the gpgme round-trip again */
+	str = g_string_new (NULL);
+	keys = g_hash_table_get_keys (priv->verified);
+	for (GList *l = keys; l != NULL; l = l->next)
+		g_string_append_printf (str, "%s\n", (const gchar *) l->data);
+	dirname = g_path_get_dirname (FU_KEYRING_VERIFIED_CACHE);
+	if (g_mkdir_with_parents (dirname, 0755) != 0) {
+		g_debug ("failed to create %s", dirname);
+		return;
+	}
+	if (!g_file_set_contents (FU_KEYRING_VERIFIED_CACHE,
+				  str->str, (gssize) str->len, &error_local)) {
+		g_debug ("failed to save %s: %s",
+			 FU_KEYRING_VERIFIED_CACHE, error_local->message);
+	}
+}
+
 gboolean
 fu_keyring_verify_data (FuKeyring *keyring,
 			GBytes *payload,
@@ -347,6 +661,7 @@ fu_keyring_verify_data (FuKeyring *keyring,
 			GError **error)
 {
 	FuKeyringPrivate *priv = GET_PRIVATE (keyring);
+	g_autofree gchar *cache_key = NULL;
 	gpgme_error_t rc;
 	gpgme_signature_t s;
 	gpgme_verify_result_t result;
@@ -357,10 +672,23 @@ fu_keyring_verify_data (FuKeyring *keyring,
 	g_return_val_if_fail (payload != NULL, FALSE);
 	g_return_val_if_fail (payload_signature != NULL, FALSE);
 
+	/* wait for any preload to finish */
+	if (!fu_keyring_preload_wait (keyring, error))
+		return FALSE;
+
 	/* setup context */
 	if (!fu_keyring_setup (keyring, error))
 		return FALSE;
 
+	/* exactly this payload already verified with this signature and
+	 * keyring, so skip the gpgme round-trip */
+	fu_keyring_verified_load (keyring);
+	cache_key = fu_keyring_get_cache_key (keyring, payload, payload_signature);
+	if (g_hash_table_lookup (priv->verified, cache_key) != NULL) {
+		g_debug ("using cached verification result");
+		return TRUE;
+	}
+
 	/* load file data */
 	rc = gpgme_data_new_from_mem (&data,
 				      g_bytes_get_data (payload, NULL),
@@ -386,7 +714,9 @@ fu_keyring_verify_data (FuKeyring *keyring,
 	}
 
 	/* verify */
+	fu_trace (gpgme_verify_start);
 	rc = gpgme_op_verify (priv->ctx, sig, data, NULL);
+	fu_trace (gpgme_verify_done);
 	if (rc != GPG_ERR_NO_ERROR) {
 		g_set_error (error,
 			     FWUPD_ERROR,
@@ -413,9 +743,34 @@ fu_keyring_verify_data (FuKeyring *keyring,
 		if (!fu_keyring_check_signature (s, error))
 			return FALSE;
 	}
+
+	/* save the success so this payload never hits gpgme again */
+	fu_keyring_verified_add (keyring, cache_key);
 	return TRUE;
 }
 
+/**
+ * fu_keyring_warm_cache:
+ * @keyring: A #FuKeyring
+ * @payload: the payload, e.g. the metadata XML
+ * @payload_signature: the detached signature
+ * @error: A #GError or %NULL
+ *
+ * Verifies the payload now, at install time, so that any re-validation of
+ * the same data can use the cached result rather than spawning gpg again.
+ *
+ * Returns: %TRUE for success
+ **/
+gboolean
+fu_keyring_warm_cache (FuKeyring *keyring,
+		       GBytes *payload,
+		       GBytes *payload_signature,
+		       GError **error)
+{
+	return fu_keyring_verify_data (keyring, payload,
+				       payload_signature, error);
+}
+
 static void
 fu_keyring_class_init (FuKeyringClass *klass)
 {
@@ -426,6 +781,10 @@ fu_keyring_class_init (FuKeyringClass *klass)
 static void
 fu_keyring_init (FuKeyring *keyring)
 {
+	FuKeyringPrivate *priv = GET_PRIVATE (keyring);
+	priv->state_csum = g_checksum_new (G_CHECKSUM_SHA256);
+	priv->verified = g_hash_table_new_full (g_str_hash, g_str_equal,
+						g_free, NULL);
 }
 
 static void
@@ -434,6 +793,12 @@ fu_keyring_finalize (GObject *object)
 	FuKeyring *keyring = FU_KEYRING (object);
 	FuKeyringPrivate *priv = GET_PRIVATE (keyring);
 
+	if (priv->thread_preload != NULL)
+		g_thread_join (priv->thread_preload);
+	g_free (priv->preload_dir);
+	g_clear_error (&priv->preload_error);
+	g_checksum_free (priv->state_csum);
+	g_hash_table_unref (priv->verified);
 	if (priv->ctx != NULL)
 		gpgme_release (priv->ctx);
 
@@ -43,6 +43,12 @@ gboolean	 fu_keyring_add_public_keys		(FuKeyring	*keyring,
 gboolean	 fu_keyring_add_public_key		(FuKeyring	*keyring,
 							 const gchar	*filename,
 							 GError		**error);
+gboolean	 fu_keyring_add_builtin_keys		(FuKeyring	*keyring,
+							 GError		**error);
+void		 fu_keyring_preload			(FuKeyring	*keyring,
+							 const gchar	*dirname);
+gboolean	 fu_keyring_preload_wait		(FuKeyring	*keyring,
+							 GError		**error);
 gboolean	 fu_keyring_verify_file			(FuKeyring	*keyring,
 							 const gchar	*filename,
 							 const gchar	*signature,
@@ -51,6 +57,10 @@ gboolean	 fu_keyring_verify_data			(FuKeyring	*keyring,
 							 GBytes		*payload,
 							 GBytes		*payload_signature,
 							 GError		**error);
+gboolean	 fu_keyring_warm_cache			(FuKeyring	*keyring,
+							 GBytes		*payload,
+							 GBytes		*payload_signature,
+							 GError		**error);
 
 G_END_DECLS
 
@@ -24,28 +24,39 @@
 #include <fwupd.h>
 #include <appstream-glib.h>
 #include <glib/gstdio.h>
+#include <glib-unix.h>
 #include <gio/gio.h>
 #include <gio/gunixfdlist.h>
 #include <gio/gunixinputstream.h>
 #include <glib/gi18n.h>
 #include <locale.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
 #include <polkit/polkit.h>
 #include <stdlib.h>
+#include <string.h>
 #include <fcntl.h>
+#include <unistd.h>
 
+#include "fwupd-cabinet-private.h"
 #include "fwupd-common-private.h"
 #include "fwupd-enums-private.h"
 #include "fwupd-release-private.h"
-#include "fwupd-resources.h"
+#include "fu-introspection.h"
 
 #include "fu-debug.h"
 #include "fu-device.h"
 #include "fu-hwids.h"
+#include "fu-smbios.h"
 #include "fu-plugin-private.h"
+#include "fu-blob.h"
 #include "fu-keyring.h"
+#include "fu-metadata-cache.h"
 #include "fu-pending.h"
 #include "fu-plugin.h"
 #include "fu-quirks.h"
+#include "fu-trace.h"
 
 #ifndef HAVE_POLKIT_0_114
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(PolkitAuthorizationResult, g_object_unref)
@@ -54,49 +65,241 @@ G_DEFINE_AUTOPTR_CLEANUP_FUNC(PolkitSubject, g_object_unref)
 
 #define FU_MAIN_FIRMWARE_SIZE_MAX	(32 * 1024 * 1024)	/* bytes */
 
+#define FU_MAIN_METADATA_XML		"/var/cache/app-info/xmls/fwupd.xml"
+#define FU_MAIN_VERIFY_XML		"/var/cache/app-info/xmls/fwupd-verify.xml"
+#define FU_MAIN_METADATA_CACHE		"/var/cache/fwupd/metadata.cache"
+#define FU_MAIN_HWIDS_CACHE		"/var/cache/fwupd/hwids.cache"
+#define FU_MAIN_HWIDS_CACHE_VERSION	1
+
 typedef struct {
 	GDBusConnection		*connection;
-	GDBusNodeInfo		*introspection_daemon;
 	GDBusProxy		*proxy_uid;
 	GUsbContext		*usb_ctx;
+	FuUdevBackend		*udev_backend;
 	GKeyFile		*config;
 	GMainLoop		*loop;
 	GPtrArray		*devices;	/* of FuDeviceItem */
+	GHashTable		*devices_by_id;	/* of id : FuDeviceItem */
+	GHashTable		*devices_by_guid;/* of guid : FuDeviceItem */
+	guint64			 generation;
+	guint			 changed_coalesce_id;
+	GPtrArray		*changed_ids;	/* of device id */
+	GVariant		*devices_reply;	/* whole GetDevices reply */
+	guint64			 devices_reply_generation;
 	PolkitAuthority		*authority;
+	GHashTable		*auth_cache;	/* of sender:action-id : grant time */
+	guint			 auth_owner_sub_id;
+	GHashTable		*subscriptions;	/* of sender : FuMainSubscription */
 	FwupdStatus		 status;
 	guint			 percentage;
+	guint			 percentage_coalesce_id;
+	gint64			 percentage_emit_time;
+	gboolean		 session_active;
+	guint64			 session_total_bytes;
+	guint64			 session_done_bytes;
+	guint64			 session_device_bytes;
+	guint			 session_percentage;
 	FuPending		*pending;
 	AsProfile		*profile;
 	AsStore			*store;
+	AsStore			*store_verify;	/* lazy-loaded fwupd-verify.xml */
+	GHashTable		*store_index;	/* of guid : AsApp */
+	guint64			 store_generation;
 	guint			 store_changed_id;
+	guint			 idle_shed_id;
+	guint			 idle_shed_timeout;	/* minutes, 0 = never */
+	GFileMonitor		*monitor_metadata;
+	GFileMonitor		*monitor_verify;
+	guint			 metadata_reload_id;
+	gint64			 metadata_write_time;
+	gint64			 verify_write_time;
+	gboolean		 verify_all_running;
 	guint			 owner_id;
+	GDBusServer		*private_server;
+	GPtrArray		*private_conns;	/* of GDBusConnection */
 	gboolean		 coldplug_running;
+	gboolean		 coldplug_done;
 	guint			 coldplug_id;
 	guint			 coldplug_delay;
+	guint			 coldplug_percentage;
+	GPtrArray		*coldplug_queue;	/* of GDBusMethodInvocation */
+	GThread			*startup_thread;
 	GPtrArray		*plugins;	/* of FuPlugin */
 	GHashTable		*plugins_hash;	/* of name : FuPlugin */
 	GHashTable		*hwids;		/* of hwid : 1 */
+	GHashTable		*update_stats;	/* of device id : stats string */
+	FuQuirks		*quirks;	/* lazy-loaded */
+	FuSmbios		*smbios;
+	FuKeyring		*keyring_fw;	/* for firmware archives */
+	FuKeyring		*keyring_md;	/* for metadata */
 } FuMainPrivate;
 
 typedef struct {
 	FuDevice		*device;
 	FuPlugin		*plugin;
+	guint64			 generation;
+	GVariant		*serialized;	/* cached result dictionary */
+	guint64			 serialized_generation;
+	const gchar		*id;		/* interned */
+	GPtrArray		*guids_sorted;	/* borrowed from the device */
+	gchar			*update_version;	/* version at last resolve */
+	guint64			 update_generation;
+	gboolean		 update_result;
 } FuDeviceItem;
 
 static gboolean fu_main_get_updates_item_update (FuMainPrivate *priv, FuDeviceItem *item);
+static GVariant *fu_main_item_to_serialized (FuDeviceItem *item);
+static void fu_main_store_changed_cb (AsStore *store, FuMainPrivate *priv);
+static AsStore *fu_main_store_ensure (FuMainPrivate *priv);
+static void fu_main_idle_shed_rearm (FuMainPrivate *priv);
+static void fu_main_hwids_cache_invalidate (void);
+
+#define FU_MAIN_CHANGED_COALESCE_MS	250
+#define FU_MAIN_PERCENTAGE_COALESCE_MS	100
+#define FU_MAIN_AUTH_CACHE_TTL		60	/* seconds */
+#define FU_MAIN_IDLE_SHED_TIMEOUT	15	/* minutes */
+#define FU_MAIN_SHUTDOWN_BUDGET_MS	500
+#define FU_MAIN_MONITOR_DEBOUNCE_MS	200
+#define FU_MAIN_SELF_WRITE_GRACE_US	(2 * G_USEC_PER_SEC)
+
+typedef struct {
+	FuMainPrivate		*priv;
+	gchar			*sender;
+	guint			 watcher_id;
+	GHashTable		*device_ids;	/* of id : 1, NULL = all */
+	gboolean		 summary_only;
+} FuMainSubscription;
 
 static void
-fu_main_emit_changed (FuMainPrivate *priv)
+fu_main_subscription_free (FuMainSubscription *sub)
 {
-	/* not yet connected */
-	if (priv->connection == NULL)
-		return;
+	if (sub->watcher_id != 0)
+		g_bus_unwatch_name (sub->watcher_id);
+	if (sub->device_ids != NULL)
+		g_hash_table_unref (sub->device_ids);
+	g_free (sub->sender);
+	g_slice_free (FuMainSubscription, sub);
+}
+
+static void
+fu_main_subscription_vanished_cb (GDBusConnection *connection,
+				  const gchar *name,
+				  gpointer user_data)
+{
+	FuMainSubscription *sub = (FuMainSubscription *) user_data;
+	g_debug ("%s vanished, dropping subscription", name);
+	g_hash_table_remove (sub->priv->subscriptions, name);
+}
+
+/* broadcast for legacy clients, plus a targeted copy for each sender
+ * that narrowed its interests with Subscribe(); subscribers hold no
+ * broad match rules, so the bus only wakes them for their own copies
+ * rather than for every device in an enumeration burst */
+static void
+fu_main_emit_signal_filtered (FuMainPrivate *priv,
+			      const gchar *signal_name,
+			      GVariant *parameters,
+			      const gchar *device_id)
+{
+	GHashTableIter iter;
+	gpointer value;
+	g_autoptr(GVariant) val = NULL;
+
+	if (parameters != NULL)
+		val = g_variant_ref_sink (parameters);
 	g_dbus_connection_emit_signal (priv->connection,
 				       NULL,
 				       FWUPD_DBUS_PATH,
 				       FWUPD_DBUS_INTERFACE,
-				       "Changed",
-				       NULL, NULL);
+				       signal_name,
+				       val, NULL);
+	if (priv->subscriptions == NULL)
+		return;
+	g_hash_table_iter_init (&iter, priv->subscriptions);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		FuMainSubscription *sub = (FuMainSubscription *) value;
+
+		/* per-device signals honour the declared interests; the
+		 * summary signals always go to every subscriber */
+		if (device_id != NULL) {
+			if (sub->summary_only)
+				continue;
+			if (sub->device_ids != NULL &&
+			    g_hash_table_lookup (sub->device_ids, device_id) == NULL)
+				continue;
+		}
+		g_dbus_connection_emit_signal (priv->connection,
+					       sub->sender,
+					       FWUPD_DBUS_PATH,
+					       FWUPD_DBUS_INTERFACE,
+					       signal_name,
+					       val, NULL);
+	}
+}
+
+static gboolean
+fu_main_changed_coalesce_cb (gpointer user_data)
+{
+	FuMainPrivate *priv = (FuMainPrivate *) user_data;
+	GVariantBuilder builder;
+
+	priv->changed_coalesce_id = 0;
+	priv->generation++;
+
+	/* the traditional catch-all signal, once per burst */
+	fu_main_emit_signal_filtered (priv, "Changed", NULL, NULL);
+
+	/* the richer form carrying the affected ids and the generation so
+	 * clients can fetch just the delta with GetDevicesSince */
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("as"));
+	for (guint i = 0; i < priv->changed_ids->len; i++) {
+		g_variant_builder_add (&builder, "s",
+				       g_ptr_array_index (priv->changed_ids, i));
+	}
+	fu_main_emit_signal_filtered (priv, "DevicesChanged",
+				      g_variant_new ("(tas)",
+						     priv->generation,
+						     &builder),
+				      NULL);
+	g_ptr_array_set_size (priv->changed_ids, 0);
+	return G_SOURCE_REMOVE;
+}
+
+/* a unifying receiver can produce a burst of per-peripheral events; batch
+ * everything inside a short window into one signal emission */
+static void
+fu_main_emit_changed_for_device (FuMainPrivate *priv, FuDevice *device)
+{
+	/* not yet connected */
+	if (priv->connection == NULL)
+		return;
+	if (device != NULL) {
+		const gchar *id = fu_device_get_id (device);
+		gboolean found = FALSE;
+		FuDeviceItem *item = g_hash_table_lookup (priv->devices_by_id, id);
+		if (item != NULL)
+			item->generation = priv->generation + 1;
+		for (guint i = 0; i < priv->changed_ids->len; i++) {
+			if (g_strcmp0 (g_ptr_array_index (priv->changed_ids, i),
+				       id) == 0) {
+				found = TRUE;
+				break;
+			}
+		}
+		if (!found)
+			g_ptr_array_add (priv->changed_ids, g_strdup (id));
+	}
+	if (priv->changed_coalesce_id == 0) {
+		priv->changed_coalesce_id =
+			g_timeout_add (FU_MAIN_CHANGED_COALESCE_MS,
+				       fu_main_changed_coalesce_cb, priv);
+	}
+}
+
+static void
+fu_main_emit_changed (FuMainPrivate *priv)
+{
+	fu_main_emit_changed_for_device (priv, NULL);
 }
 
 static void
@@ -108,12 +311,9 @@ fu_main_emit_device_added (FuMainPrivate *priv, FuDevice *device)
 	if (priv->connection == NULL)
 		return;
 	val = fwupd_result_to_data (FWUPD_RESULT (device), "(a{sv})");
-	g_dbus_connection_emit_signal (priv->connection,
-				       NULL,
-				       FWUPD_DBUS_PATH,
-				       FWUPD_DBUS_INTERFACE,
-				       "DeviceAdded",
-				       val, NULL);
+	fu_main_emit_signal_filtered (priv, "DeviceAdded", val,
+				      fu_device_get_id (device));
+	fu_main_emit_changed_for_device (priv, device);
 }
 
 static void
@@ -125,12 +325,9 @@ fu_main_emit_device_removed (FuMainPrivate *priv, FuDevice *device)
 	if (priv->connection == NULL)
 		return;
 	val = fwupd_result_to_data (FWUPD_RESULT (device), "(a{sv})");
-	g_dbus_connection_emit_signal (priv->connection,
-				       NULL,
-				       FWUPD_DBUS_PATH,
-				       FWUPD_DBUS_INTERFACE,
-				       "DeviceRemoved",
-				       val, NULL);
+	fu_main_emit_signal_filtered (priv, "DeviceRemoved", val,
+				      fu_device_get_id (device));
+	fu_main_emit_changed_for_device (priv, device);
 }
 
 static void
@@ -142,12 +339,9 @@ fu_main_emit_device_changed (FuMainPrivate *priv, FuDevice *device)
 	if (priv->connection == NULL)
 		return;
 	val = fwupd_result_to_data (FWUPD_RESULT (device), "(a{sv})");
-	g_dbus_connection_emit_signal (priv->connection,
-				       NULL,
-				       FWUPD_DBUS_PATH,
-				       FWUPD_DBUS_INTERFACE,
-				       "DeviceChanged",
-				       val, NULL);
+	fu_main_emit_signal_filtered (priv, "DeviceChanged", val,
+				      fu_device_get_id (device));
+	fu_main_emit_changed_for_device (priv, device);
 }
 
 static void
@@ -196,17 +390,71 @@ fu_main_set_status (FuMainPrivate *priv, FwupdStatus status)
 	fu_main_emit_property_changed (priv, "Status", g_variant_new_uint32 (status));
 }
 
+/* safe to call from the coldplug worker threads; GDBus signal
+ * emission is thread-safe and the value is only ever monotonic */
+static void
+fu_main_set_coldplug_percentage (FuMainPrivate *priv, guint percentage)
+{
+	if (priv->coldplug_percentage == percentage)
+		return;
+	priv->coldplug_percentage = percentage;
+	g_debug ("Emitting PropertyChanged('ColdplugPercentage'='%u%%')",
+		 percentage);
+	fu_main_emit_property_changed (priv, "ColdplugPercentage",
+				       g_variant_new_uint32 (percentage));
+}
+
+static void
+fu_main_emit_percentage (FuMainPrivate *priv)
+{
+	priv->percentage_emit_time = g_get_monotonic_time ();
+	g_debug ("Emitting PropertyChanged('Percentage'='%u%%')",
+		 priv->percentage);
+	fu_main_emit_property_changed (priv, "Percentage",
+				       g_variant_new_uint32 (priv->percentage));
+}
+
+static gboolean
+fu_main_percentage_coalesce_cb (gpointer user_data)
+{
+	FuMainPrivate *priv = (FuMainPrivate *) user_data;
+	priv->percentage_coalesce_id = 0;
+	fu_main_emit_percentage (priv);
+	return FALSE;
+}
+
 static void
 fu_main_set_percentage (FuMainPrivate *priv, guint percentage)
 {
+	gint64 elapsed_ms;
+
 	if (priv->percentage == percentage)
 		return;
 	priv->percentage = percentage;
 
+	/* rate limit the property traffic; a DFU transfer can produce
+	 * hundreds of ticks per second and each one costs a wakeup in
+	 * dbus-daemon and in every client with a proxy -- the endpoints
+	 * always go out straight away so state transitions are not lost */
+	elapsed_ms = (g_get_monotonic_time () -
+		      priv->percentage_emit_time) / 1000;
+	if (percentage != 0 && percentage != 100 &&
+	    elapsed_ms < FU_MAIN_PERCENTAGE_COALESCE_MS) {
+		if (priv->percentage_coalesce_id == 0) {
+			priv->percentage_coalesce_id =
+				g_timeout_add (FU_MAIN_PERCENTAGE_COALESCE_MS - elapsed_ms,
+					       fu_main_percentage_coalesce_cb,
+					       priv);
+		}
+		return;
+	}
+
 	/* emit changed */
-	g_debug ("Emitting PropertyChanged('Percentage'='%u%%')", percentage);
-	fu_main_emit_property_changed (priv, "Percentage",
-				       g_variant_new_uint32 (percentage));
+	if (priv->percentage_coalesce_id != 0) {
+		g_source_remove (priv->percentage_coalesce_id);
+		priv->percentage_coalesce_id = 0;
+	}
+	fu_main_emit_percentage (priv);
 }
 
 static GVariant *
@@ -225,11 +473,9 @@ fu_main_device_array_to_variant (GPtrArray *devices, GError **error)
 
 	g_variant_builder_init (&builder, G_VARIANT_TYPE_ARRAY);
 	for (guint i = 0; i < devices->len; i++) {
-		GVariant *tmp;
-		FuDeviceItem *item;
-		item = g_ptr_array_index (devices, i);
-		tmp = fwupd_result_to_data (FWUPD_RESULT (item->device), "{sa{sv}}");
-		g_variant_builder_add_value (&builder, tmp);
+		FuDeviceItem *item = g_ptr_array_index (devices, i);
+		g_variant_builder_add_value (&builder,
+					     fu_main_item_to_serialized (item));
 	}
 	return g_variant_new ("(a{sa{sv}})", &builder);
 }
@@ -239,6 +485,8 @@ fu_main_invocation_return_value (FuMainPrivate *priv,
 				 GDBusMethodInvocation *invocation,
 				 GVariant *parameters)
 {
+	fu_trace1 (method_return,
+		   g_dbus_method_invocation_get_method_name (invocation));
 	fu_main_set_status (priv, FWUPD_STATUS_IDLE);
 	g_dbus_method_invocation_return_value (invocation, parameters);
 }
@@ -248,6 +496,9 @@ fu_main_invocation_return_error (FuMainPrivate *priv,
 				 GDBusMethodInvocation *invocation,
 				 const GError *error)
 {
+	fu_trace2 (method_error,
+		   g_dbus_method_invocation_get_method_name (invocation),
+		   error->message);
 	fu_main_set_status (priv, FWUPD_STATUS_IDLE);
 	g_dbus_method_invocation_return_gerror (invocation, error);
 }
@@ -255,33 +506,157 @@ fu_main_invocation_return_error (FuMainPrivate *priv,
 static void
 fu_main_item_free (FuDeviceItem *item)
 {
+	if (item->serialized != NULL)
+		g_variant_unref (item->serialized);
+	if (item->guids_sorted != NULL)
+		g_ptr_array_unref (item->guids_sorted);
+	g_free (item->update_version);
 	g_object_unref (item->device);
 	g_object_unref (item->plugin);
-	g_free (item);
+	g_slice_free (FuDeviceItem, item);
+}
+
+/* for device mutations that do not go through the changed signal, e.g.
+ * the update metadata added when looking for updates */
+static void
+fu_main_item_invalidate_serialized (FuMainPrivate *priv, FuDeviceItem *item)
+{
+	g_clear_pointer (&item->serialized, g_variant_unref);
+	g_clear_pointer (&priv->devices_reply, g_variant_unref);
+}
+
+/* device listings are polled by clients, so reuse the per-device
+ * dictionary until the device next changes */
+static GVariant *
+fu_main_item_to_serialized (FuDeviceItem *item)
+{
+	if (item->serialized != NULL &&
+	    item->serialized_generation != item->generation)
+		g_clear_pointer (&item->serialized, g_variant_unref);
+	if (item->serialized == NULL) {
+		item->serialized = g_variant_ref_sink (fwupd_result_to_data (FWUPD_RESULT (item->device),
+									     "{sa{sv}}"));
+		item->serialized_generation = item->generation;
+	}
+	return item->serialized;
+}
+
+/* the complete GetDevices reply is also cached, so that a poll from a
+ * client when nothing has changed is just a refcount bump */
+static GVariant *
+fu_main_get_devices_reply (FuMainPrivate *priv, GError **error)
+{
+	GVariant *val;
+
+	/* a change burst is still being coalesced and the generation has
+	 * not been bumped yet, so this reply cannot be cached */
+	if (priv->changed_coalesce_id != 0) {
+		g_clear_pointer (&priv->devices_reply, g_variant_unref);
+		val = fu_main_device_array_to_variant (priv->devices, error);
+		if (val == NULL)
+			return NULL;
+		return g_variant_ref_sink (val);
+	}
+
+	/* something changed since the reply was built */
+	if (priv->devices_reply != NULL &&
+	    priv->devices_reply_generation != priv->generation)
+		g_clear_pointer (&priv->devices_reply, g_variant_unref);
+	if (priv->devices_reply == NULL) {
+		val = fu_main_device_array_to_variant (priv->devices, error);
+		if (val == NULL)
+			return NULL;
+		priv->devices_reply = g_variant_ref_sink (val);
+		priv->devices_reply_generation = priv->generation;
+	}
+	return g_variant_ref (priv->devices_reply);
+}
+
+/* priv->devices owns the items; these hash indexes borrow them so that the
+ * per-D-Bus-call lookups are O(1) even with dozens of devices attached */
+static gint
+fu_main_guid_sort_cb (gconstpointer a, gconstpointer b)
+{
+	return g_strcmp0 (*((const gchar **) a), *((const gchar **) b));
+}
+
+static void
+fu_main_item_add (FuMainPrivate *priv, FuDeviceItem *item)
+{
+	GPtrArray *guids = fu_device_get_guids (item->device);
+	const gchar *equivalent_id = fu_device_get_equivalent_id (item->device);
+
+	/* precompute the identity artifacts used on every resolve-and-reply;
+	 * the GUID strings stay owned by the device, which the item refs */
+	item->id = g_intern_string (fu_device_get_id (item->device));
+	item->guids_sorted = g_ptr_array_new ();
+	for (guint i = 0; i < guids->len; i++)
+		g_ptr_array_add (item->guids_sorted, g_ptr_array_index (guids, i));
+	g_ptr_array_sort (item->guids_sorted, fu_main_guid_sort_cb);
+
+	g_clear_pointer (&priv->devices_reply, g_variant_unref);
+	g_ptr_array_add (priv->devices, item);
+	g_hash_table_insert (priv->devices_by_id,
+			     g_strdup (item->id), item);
+	if (equivalent_id != NULL) {
+		g_hash_table_insert (priv->devices_by_id,
+				     g_strdup (equivalent_id), item);
+	}
+	for (guint i = 0; i < guids->len; i++) {
+		g_hash_table_insert (priv->devices_by_guid,
+				     g_strdup (g_ptr_array_index (guids, i)),
+				     item);
+	}
+}
+
+static gboolean
+fu_main_item_hash_remove_cb (gpointer key, gpointer value, gpointer user_data)
+{
+	return value == user_data;
+}
+
+static void
+fu_main_item_remove (FuMainPrivate *priv, FuDeviceItem *item)
+{
+	g_clear_pointer (&priv->devices_reply, g_variant_unref);
+	g_hash_table_foreach_remove (priv->devices_by_id,
+				     fu_main_item_hash_remove_cb, item);
+	g_hash_table_foreach_remove (priv->devices_by_guid,
+				     fu_main_item_hash_remove_cb, item);
+	g_ptr_array_remove (priv->devices, item);
+}
+
+/* binary search over the sorted list built at registration, so the
+ * membership test does not degrade on devices like docks that expose a
+ * dozen or more GUIDs */
+static gboolean
+fu_main_item_has_guid (FuDeviceItem *item, const gchar *guid)
+{
+	guint lo = 0;
+	guint hi = item->guids_sorted->len;
+	while (lo < hi) {
+		guint mid = (lo + hi) / 2;
+		gint rc = g_strcmp0 (guid, g_ptr_array_index (item->guids_sorted, mid));
+		if (rc == 0)
+			return TRUE;
+		if (rc < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return FALSE;
 }
 
 static FuDeviceItem *
 fu_main_get_item_by_id (FuMainPrivate *priv, const gchar *id)
 {
-	for (guint i = 0; i < priv->devices->len; i++) {
-		FuDeviceItem *item = g_ptr_array_index (priv->devices, i);
-		if (g_strcmp0 (fu_device_get_id (item->device), id) == 0)
-			return item;
-		if (g_strcmp0 (fu_device_get_equivalent_id (item->device), id) == 0)
-			return item;
-	}
-	return NULL;
+	return g_hash_table_lookup (priv->devices_by_id, id);
 }
 
 static FuDeviceItem *
 fu_main_get_item_by_guid (FuMainPrivate *priv, const gchar *guid)
 {
-	for (guint i = 0; i < priv->devices->len; i++) {
-		FuDeviceItem *item = g_ptr_array_index (priv->devices, i);
-		if (fu_device_has_guid (item->device, guid))
-			return item;
-	}
-	return NULL;
+	return g_hash_table_lookup (priv->devices_by_guid, guid);
 }
 
 static FuPlugin *
@@ -303,6 +678,67 @@ fu_main_get_sysconfig_dir (void)
 	return "/etc";
 }
 
+/* copy the client-passed fd to an unlinked temporary file in bounded chunks
+ * and then map it, so a large cabinet archive is file-backed rather than
+ * sitting in anonymous daemon heap */
+static GBytes *
+fu_main_spool_fd_to_bytes (gint fd, GError **error)
+{
+	gint fd_tmp;
+	gssize len;
+	guint8 buf[0x8000];
+	guint64 total = 0;
+	g_autoptr(GMappedFile) mmap_file = NULL;
+
+	fd_tmp = open (g_get_tmp_dir (), O_TMPFILE | O_RDWR, 0600);
+	if (fd_tmp < 0) {
+		/* no O_TMPFILE support; fall back to a named file we unlink
+		 * immediately */
+		g_autofree gchar *fn = NULL;
+		fd_tmp = g_file_open_tmp ("fwupd-XXXXXX.cab", &fn, error);
+		if (fd_tmp < 0)
+			return NULL;
+		g_unlink (fn);
+	}
+	while ((len = read (fd, buf, sizeof(buf))) > 0) {
+		total += (guint64) len;
+		if (total > FU_MAIN_FIRMWARE_SIZE_MAX) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "firmware archive too large, limit %uMB",
+				     FU_MAIN_FIRMWARE_SIZE_MAX / (1024 * 1024));
+			close (fd_tmp);
+			close (fd);
+			return NULL;
+		}
+		if (write (fd_tmp, buf, (size_t) len) != len) {
+			g_set_error_literal (error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_WRITE,
+					     "failed to spool firmware archive");
+			close (fd_tmp);
+			close (fd);
+			return NULL;
+		}
+	}
+	close (fd);
+	if (len < 0) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_READ,
+				     "failed to read firmware archive");
+		close (fd_tmp);
+		return NULL;
+	}
+	fu_trace1 (cab_spool_done, total);
+	mmap_file = g_mapped_file_new_from_fd (fd_tmp, FALSE, error);
+	close (fd_tmp);
+	if (mmap_file == NULL)
+		return NULL;
+	return g_mapped_file_get_bytes (mmap_file);
+}
+
 static void
 fu_main_set_release_from_item (FwupdRelease *rel, AsRelease *release)
 {
@@ -334,7 +770,8 @@ fu_main_set_release_from_item (FwupdRelease *rel, AsRelease *release)
 }
 
 static gboolean
-fu_main_get_release_trust_flags (AsRelease *release,
+fu_main_get_release_trust_flags (FuMainPrivate *priv,
+				 AsRelease *release,
 				 FwupdTrustFlags *trust_flags,
 				 GError **error)
 {
@@ -345,7 +782,6 @@ fu_main_get_release_trust_flags (AsRelease *release,
 	g_autofree gchar *pki_dir = NULL;
 	g_autofree gchar *fn_signature = NULL;
 	g_autoptr(GError) error_local = NULL;
-	g_autoptr(FuKeyring) kr = NULL;
 
 	/* no filename? */
 	csum_tmp = as_release_get_checksum_by_target (release, AS_CHECKSUM_TARGET_CONTENT);
@@ -387,10 +823,8 @@ fu_main_get_release_trust_flags (AsRelease *release,
 	}
 
 	/* verify against the system trusted keys */
-	kr = fu_keyring_new ();
-	if (!fu_keyring_add_public_keys (kr, pki_dir, error))
-		return FALSE;
-	if (!fu_keyring_verify_data (kr, blob_payload, blob_signature, &error_local)) {
+	if (!fu_keyring_warm_cache (priv->keyring_fw, blob_payload,
+				    blob_signature, &error_local)) {
 		g_warning ("untrusted as failed to verify: %s",
 			   error_local->message);
 		return TRUE;
@@ -416,10 +850,12 @@ typedef struct {
 	FwupdTrustFlags		 trust_flags;
 	GPtrArray		*devices;	/* of FuDevice */
 	GPtrArray		*blob_fws;	/* of GBytes */
+	GHashTable		*blob_cache;	/* of source GBytes : sealed view */
 	FwupdInstallFlags	 flags;
 	GBytes			*blob_cab;
 	gboolean		 is_downgrade;
 	FuMainAuthKind		 auth_kind;
+	gchar			*auth_key;	/* sender:action-id */
 	FuMainPrivate		*priv;
 } FuMainAuthHelper;
 
@@ -431,12 +867,15 @@ fu_main_helper_free (FuMainAuthHelper *helper)
 		g_ptr_array_unref (helper->devices);
 	if (helper->blob_fws != NULL)
 		g_ptr_array_unref (helper->blob_fws);
+	if (helper->blob_cache != NULL)
+		g_hash_table_unref (helper->blob_cache);
 	if (helper->blob_cab != NULL)
 		g_bytes_unref (helper->blob_cab);
 	if (helper->store != NULL)
 		g_object_unref (helper->store);
+	g_free (helper->auth_key);
 	g_object_unref (helper->invocation);
-	g_free (helper);
+	g_slice_free (FuMainAuthHelper, helper);
 }
 
 static gboolean
@@ -512,18 +951,25 @@ fu_main_verify_update_device_to_app (FuDevice *device)
 static gboolean
 fu_main_plugin_verify_update_authenticated (FuMainAuthHelper *helper, GError **error)
 {
-	const gchar *fn = "/var/cache/app-info/xmls/fwupd-verify.xml";
-	g_autoptr(AsStore) store = NULL;
+	const gchar *fn = FU_MAIN_VERIFY_XML;
+	AsStore *store;
 	g_autoptr(GFile) xml_file = NULL;
 
-	/* load existing store */
-	store = as_store_new ();
-	as_store_set_api_version (store, 0.9);
+	/* load the existing store once and keep it cached; only this daemon
+	 * writes the file, and an attestation sweep across every device
+	 * would otherwise re-parse the XML for each call */
 	xml_file = g_file_new_for_path (fn);
-	if (g_file_query_exists (xml_file, NULL)) {
-		if (!as_store_from_file (store, xml_file, NULL, NULL, error))
-			return FALSE;
+	if (helper->priv->store_verify == NULL) {
+		g_autoptr(AsStore) store_tmp = as_store_new ();
+		as_store_set_api_version (store_tmp, 0.9);
+		if (g_file_query_exists (xml_file, NULL)) {
+			if (!as_store_from_file (store_tmp, xml_file,
+						 NULL, NULL, error))
+				return FALSE;
+		}
+		helper->priv->store_verify = g_steal_pointer (&store_tmp);
 	}
+	store = helper->priv->store_verify;
 
 	/* check the devices still exists */
 	for (guint i = 0; i < helper->devices->len; i ++) {
@@ -572,18 +1018,61 @@ fu_main_plugin_verify_update_authenticated (FuMainAuthHelper *helper, GError **e
 			return FALSE;
 		}
 
-		/* add to store */
+		/* add to store, replacing any previous attestation so the
+		 * cached store does not grow duplicates */
 		app = fu_main_verify_update_device_to_app (item->device);
+		as_store_remove_app_by_id (store, as_app_get_id (app));
 		as_store_add_app (store, app);
 	}
 
 	/* write */
 	g_debug ("writing %s", fn);
-	return as_store_to_file (store, xml_file,
-				 AS_NODE_TO_XML_FLAG_ADD_HEADER |
-				 AS_NODE_TO_XML_FLAG_FORMAT_INDENT |
-				 AS_NODE_TO_XML_FLAG_FORMAT_MULTILINE,
-				 NULL, error);
+	if (!as_store_to_file (store, xml_file,
+			       AS_NODE_TO_XML_FLAG_ADD_HEADER |
+			       AS_NODE_TO_XML_FLAG_FORMAT_INDENT |
+			       AS_NODE_TO_XML_FLAG_FORMAT_MULTILINE,
+			       NULL, error)) {
+		/* drop the cache so it is reloaded from whatever is really
+		 * on disk next time */
+		g_clear_object (&helper->priv->store_verify);
+		return FALSE;
+	}
+	helper->priv->verify_write_time = g_get_monotonic_time ();
+	return TRUE;
+}
+
+static void
+fu_main_plugins_pending_commit (FuMainPrivate *priv)
+{
+	/* flush any batched pending-database writes to disk */
+	for (guint i = 0; i < priv->plugins->len; i++) {
+		FuPlugin *plugin = g_ptr_array_index (priv->plugins, i);
+		g_autoptr(GError) error_local = NULL;
+		if (!fu_plugin_runner_pending_commit (plugin, &error_local)) {
+			g_warning ("failed to commit pending database: %s",
+				   error_local->message);
+		}
+	}
+}
+
+static void
+fu_main_session_progress_start (FuMainPrivate *priv, GPtrArray *blob_fws)
+{
+	priv->session_total_bytes = 0;
+	priv->session_done_bytes = 0;
+	priv->session_device_bytes = 0;
+	priv->session_percentage = 0;
+	for (guint i = 0; i < blob_fws->len; i++) {
+		GBytes *blob_fw = g_ptr_array_index (blob_fws, i);
+		priv->session_total_bytes += g_bytes_get_size (blob_fw);
+	}
+	priv->session_active = priv->session_total_bytes > 0;
+}
+
+static void
+fu_main_session_progress_stop (FuMainPrivate *priv)
+{
+	priv->session_active = FALSE;
 }
 
 static gboolean
@@ -628,18 +1117,57 @@ fu_main_plugin_update_authenticated (FuMainAuthHelper *helper, GError **error)
 		}
 	}
 
-	/* run the correct plugin for each device */
+	/* run the correct plugin for each device, weighting the session
+	 * progress by each member payload size */
+	fu_main_session_progress_start (priv, helper->blob_fws);
 	for (guint i = 0; i < helper->devices->len; i ++) {
 		FuDevice *device = g_ptr_array_index (helper->devices, i);
 		GBytes *blob_fw = g_ptr_array_index (helper->blob_fws, i);
+		FuPendingPhase phase = FU_PENDING_PHASE_NONE;
 		item = fu_main_get_item_by_id (helper->priv,
 					       fu_device_get_id (device));
+		priv->session_device_bytes = g_bytes_get_size (blob_fw);
+
+		/* a checkpointed member of an interrupted session is already
+		 * running the new firmware; skip the flash unless the user
+		 * explicitly asked for a reinstall */
+		if ((helper->flags & FWUPD_INSTALL_FLAG_ALLOW_REINSTALL) == 0 &&
+		    fu_pending_get_checkpoint (priv->pending,
+					       fu_device_get_id (device),
+					       &phase, NULL, NULL) &&
+		    phase == FU_PENDING_PHASE_COMPLETE) {
+			g_autoptr(FwupdResult) res_pending = NULL;
+			res_pending = fu_pending_get_device (priv->pending,
+							     fu_device_get_id (device),
+							     NULL);
+			if (res_pending != NULL &&
+			    g_strcmp0 (fwupd_release_get_version (fwupd_result_get_release (res_pending)),
+				       fu_device_get_version (item->device)) == 0) {
+				g_debug ("skipping %s, already flashed to %s "
+					 "before the interruption",
+					 fu_device_get_id (device),
+					 fu_device_get_version (item->device));
+				priv->session_done_bytes += priv->session_device_bytes;
+				priv->session_device_bytes = 0;
+				continue;
+			}
+		}
+
+		/* checkpoint the attempt before touching the hardware, and
+		 * land it on disk now; surviving a power loss mid-flash is
+		 * the whole point */
+		fu_pending_transaction_begin (priv->pending, NULL);
+		fu_pending_set_checkpoint (priv->pending, FWUPD_RESULT (device),
+					   FU_PENDING_PHASE_WRITING, 0, NULL);
+		fu_pending_transaction_commit (priv->pending, NULL);
 
 		/* signal to all the plugins the update is about to happen */
 		for (guint j = 0; j < priv->plugins->len; j++) {
 			FuPlugin *plugin = g_ptr_array_index (priv->plugins, j);
-			if (!fu_plugin_runner_update_prepare (plugin, device, error))
+			if (!fu_plugin_runner_update_prepare (plugin, device, error)) {
+				fu_main_session_progress_stop (priv);
 				return FALSE;
+			}
 		}
 
 		/* do the update */
@@ -660,9 +1188,41 @@ fu_main_plugin_update_authenticated (FuMainAuthHelper *helper, GError **error)
 						   error_local->message);
 				}
 			}
+			fu_main_plugins_pending_commit (priv);
+
+			/* record how far the transfer got, for protocols
+			 * that can resume mid-payload */
+			fu_pending_transaction_begin (priv->pending, NULL);
+			fu_pending_set_checkpoint (priv->pending,
+						   FWUPD_RESULT (device),
+						   FU_PENDING_PHASE_WRITING,
+						   fu_plugin_get_transfer_bytes (item->plugin),
+						   NULL);
+			fu_pending_transaction_commit (priv->pending, NULL);
+			fu_main_session_progress_stop (priv);
 			return FALSE;
 		}
 
+		/* land this member's batched writes and its checkpoint now;
+		 * a power loss between members must not re-flash this one */
+		{
+			g_autoptr(GError) error_local = NULL;
+			if (!fu_plugin_runner_pending_commit (item->plugin,
+							      &error_local)) {
+				g_warning ("failed to commit pending database: %s",
+					   error_local->message);
+			}
+		}
+		fu_pending_transaction_begin (priv->pending, NULL);
+		fu_pending_set_checkpoint (priv->pending, FWUPD_RESULT (device),
+					   FU_PENDING_PHASE_COMPLETE,
+					   g_bytes_get_size (blob_fw), NULL);
+		fu_pending_transaction_commit (priv->pending, NULL);
+
+		/* this member is done; later devices report on top of it */
+		priv->session_done_bytes += priv->session_device_bytes;
+		priv->session_device_bytes = 0;
+
 		/* signal to all the plugins the update has happened */
 		for (guint j = 0; j < priv->plugins->len; j++) {
 			FuPlugin *plugin = g_ptr_array_index (priv->plugins, j);
@@ -673,48 +1233,53 @@ fu_main_plugin_update_authenticated (FuMainAuthHelper *helper, GError **error)
 			}
 		}
 
+		/* keep the per-device transfer accounting for GetStats, so
+		 * slow devices can be told apart from slow hosts post-hoc */
+		{
+			guint duration_ms = fu_plugin_get_update_duration_ms (item->plugin);
+			guint stall_ms = fu_plugin_get_transfer_stall_ms (item->plugin);
+			guint64 bytes = fu_plugin_get_transfer_bytes (item->plugin);
+			guint64 kbps = 0;
+			if (duration_ms > stall_ms) {
+				kbps = (bytes * 1000) /
+					((guint64) (duration_ms - stall_ms) * 1024);
+			}
+			g_hash_table_insert (priv->update_stats,
+					     g_strdup (fu_device_get_id (device)),
+					     g_strdup_printf ("bytes=%" G_GUINT64_FORMAT ";"
+							      "duration-ms=%u;"
+							      "stall-ms=%u;"
+							      "retries=%u;"
+							      "kbps=%" G_GUINT64_FORMAT,
+							      bytes,
+							      duration_ms,
+							      stall_ms,
+							      fu_plugin_get_transfer_retries (item->plugin),
+							      kbps));
+		}
+
+		/* updating the system firmware changes the HWIDs */
+		if (g_strcmp0 (fu_plugin_get_name (item->plugin), "uefi") == 0)
+			fu_main_hwids_cache_invalidate ();
+
 		/* make the UI update */
 		fu_device_set_modified (item->device, (guint64) g_get_real_time () / G_USEC_PER_SEC);
 		fu_main_emit_device_changed (helper->priv, item->device);
 	}
 
+	/* the session is over, flush everything to disk in one transaction */
+	fu_main_session_progress_stop (priv);
+	fu_main_plugins_pending_commit (priv);
+
 	/* make the UI update */
 	fu_main_emit_changed (helper->priv);
 	return TRUE;
 }
 
 static void
-fu_main_check_authorization_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+fu_main_authorization_granted (FuMainAuthHelper *helper)
 {
-	FuMainAuthHelper *helper = (FuMainAuthHelper *) user_data;
 	g_autoptr(GError) error = NULL;
-	g_autoptr(GError) error_local = NULL;
-	g_autoptr(PolkitAuthorizationResult) auth = NULL;
-
-	/* get result */
-	auth = polkit_authority_check_authorization_finish (POLKIT_AUTHORITY (source),
-							    res, &error_local);
-	if (auth == NULL) {
-		g_set_error (&error,
-			     FWUPD_ERROR,
-			     FWUPD_ERROR_AUTH_FAILED,
-			     "could not check for auth: %s",
-			     error_local->message);
-		fu_main_invocation_return_error (helper->priv, helper->invocation, error);
-		fu_main_helper_free (helper);
-		return;
-	}
-
-	/* did not auth */
-	if (!polkit_authorization_result_get_is_authorized (auth)) {
-		g_set_error_literal (&error,
-				     FWUPD_ERROR,
-				     FWUPD_ERROR_AUTH_FAILED,
-				     "failed to obtain auth");
-		fu_main_invocation_return_error (helper->priv, helper->invocation, error);
-		fu_main_helper_free (helper);
-		return;
-	}
 
 	/* we're good to go */
 	if (helper->auth_kind == FU_MAIN_AUTH_KIND_INSTALL) {
@@ -750,15 +1315,90 @@ fu_main_check_authorization_cb (GObject *source, GAsyncResult *res, gpointer use
 	fu_main_helper_free (helper);
 }
 
-static gchar *
-fu_main_get_guids_from_store (AsStore *store)
+static void
+fu_main_check_authorization_cb (GObject *source, GAsyncResult *res, gpointer user_data)
 {
-	AsProvide *prov;
-	GPtrArray *provides;
-	GPtrArray *apps;
-	GString *str = g_string_new ("");
-
-	/* return a string with all the firmware apps in the store */
+	FuMainAuthHelper *helper = (FuMainAuthHelper *) user_data;
+	gint64 *granted;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(PolkitAuthorizationResult) auth = NULL;
+
+	/* get result */
+	auth = polkit_authority_check_authorization_finish (POLKIT_AUTHORITY (source),
+							    res, &error_local);
+	if (auth == NULL) {
+		g_set_error (&error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_AUTH_FAILED,
+			     "could not check for auth: %s",
+			     error_local->message);
+		fu_main_invocation_return_error (helper->priv, helper->invocation, error);
+		fu_main_helper_free (helper);
+		return;
+	}
+
+	/* did not auth */
+	if (!polkit_authorization_result_get_is_authorized (auth)) {
+		g_set_error_literal (&error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_AUTH_FAILED,
+				     "failed to obtain auth");
+		fu_main_invocation_return_error (helper->priv, helper->invocation, error);
+		fu_main_helper_free (helper);
+		return;
+	}
+
+	/* remember the decision until the sender disconnects or the entry
+	 * expires; polkit is only consulted again after that */
+	granted = g_new0 (gint64, 1);
+	*granted = g_get_monotonic_time ();
+	g_hash_table_insert (helper->priv->auth_cache,
+			     g_strdup (helper->auth_key),
+			     granted);
+	fu_main_authorization_granted (helper);
+}
+
+static void
+fu_main_authorize (FuMainAuthHelper *helper,
+		   const gchar *sender,
+		   const gchar *action_id)
+{
+	gint64 *granted;
+	g_autoptr(PolkitSubject) subject = NULL;
+
+	/* a recent grant for the same sender and action skips polkitd */
+	helper->auth_key = g_strdup_printf ("%s:%s", sender, action_id);
+	granted = g_hash_table_lookup (helper->priv->auth_cache, helper->auth_key);
+	if (granted != NULL) {
+		if (g_get_monotonic_time () - *granted <
+		    FU_MAIN_AUTH_CACHE_TTL * G_USEC_PER_SEC) {
+			g_debug ("using cached auth for %s", helper->auth_key);
+			fu_main_authorization_granted (helper);
+			return;
+		}
+		g_hash_table_remove (helper->priv->auth_cache, helper->auth_key);
+	}
+
+	subject = polkit_system_bus_name_new (sender);
+	polkit_authority_check_authorization (helper->priv->authority, subject,
+					      action_id,
+					      NULL,
+					      POLKIT_CHECK_AUTHORIZATION_FLAGS_ALLOW_USER_INTERACTION,
+					      NULL,
+					      fu_main_check_authorization_cb,
+					      helper);
+}
+
+static gchar *
+fu_main_get_guids_from_store (AsStore *store)
+{
+	AsProvide *prov;
+	GPtrArray *provides;
+	GPtrArray *apps;
+	GString *str = g_string_new ("");
+
+	/* return a string with all the firmware apps in the store */
 	apps = as_store_get_apps (store);
 	for (guint i = 0; i < apps->len; i++) {
 		AsApp *app = AS_APP (g_ptr_array_index (apps, i));
@@ -777,19 +1417,20 @@ fu_main_get_guids_from_store (AsStore *store)
 }
 
 static void
-fu_main_vendor_quirk_release_version (AsApp *app)
+fu_main_vendor_quirk_release_version (FuMainPrivate *priv, AsApp *app)
 {
-	AsVersionParseFlag flags = AS_VERSION_PARSE_FLAG_USE_TRIPLET;
+	AsVersionParseFlag flags;
 	GPtrArray *releases;
 
 	/* no quirk required */
 	if (as_app_get_kind (app) != AS_APP_KIND_FIRMWARE)
 		return;
 
-	for (guint i = 0; quirk_table[i].identifier != NULL; i++) {
-		if (g_str_has_prefix (as_app_get_id(app), quirk_table[i].identifier))
-			flags = quirk_table[i].flags;
-	}
+	/* the quirk files are only parsed when something needs them */
+	if (priv->quirks == NULL)
+		priv->quirks = fu_quirks_new ();
+	flags = fu_quirks_get_version_parse_flags (priv->quirks,
+						   as_app_get_id (app));
 
 	/* fix each release */
 	releases = as_app_get_releases (app);
@@ -818,7 +1459,48 @@ fu_main_vendor_quirk_release_version (AsApp *app)
 		/* convert to dotted decimal */
 		version_new = as_utils_version_from_uint32 ((guint32) ver_uint32, flags);
 		as_release_set_version (rel, version_new);
+		g_object_set_data (G_OBJECT (rel), "fwupd::VersionKey", NULL);
+	}
+}
+
+static guint8 fu_main_version_key_invalid[FWUPD_VERSION_KEY_SZ];
+
+/* the packed sort key for the release version, parsed once and stashed
+ * on the release object; versions that cannot be packed are remembered
+ * as such so the parse is not retried on every poll */
+static const guint8 *
+fu_main_release_get_version_key (AsRelease *release)
+{
+	guint8 *key = g_object_get_data (G_OBJECT (release), "fwupd::VersionKey");
+	if (key == fu_main_version_key_invalid)
+		return NULL;
+	if (key == NULL) {
+		key = g_malloc0 (FWUPD_VERSION_KEY_SZ);
+		if (!fwupd_version_key_from_string (as_release_get_version (release), key)) {
+			g_free (key);
+			g_object_set_data (G_OBJECT (release), "fwupd::VersionKey",
+					   fu_main_version_key_invalid);
+			return NULL;
+		}
+		g_object_set_data_full (G_OBJECT (release), "fwupd::VersionKey",
+					key, g_free);
+	}
+	return key;
+}
+
+/* compares the release version against a device version, using the
+ * precomputed keys when both sides have one */
+static gint
+fu_main_release_vercmp (AsRelease *release,
+			const guint8 *version_key,
+			const gchar *version)
+{
+	if (version_key != NULL) {
+		const guint8 *key = fu_main_release_get_version_key (release);
+		if (key != NULL)
+			return fwupd_version_key_compare (key, version_key);
 	}
+	return as_utils_vercmp (as_release_get_version (release), version);
 }
 
 #if AS_CHECK_VERSION(0,6,7)
@@ -861,15 +1543,70 @@ fu_main_check_version_requirement (AsApp *app,
 }
 #endif
 
+static void
+fu_main_store_index_add_app (FuMainPrivate *priv, AsApp *app)
+{
+	GPtrArray *provides = as_app_get_provides (app);
+	for (guint i = 0; i < provides->len; i++) {
+		AsProvide *prov = AS_PROVIDE (g_ptr_array_index (provides, i));
+		if (as_provide_get_kind (prov) != AS_PROVIDE_KIND_FIRMWARE_FLASHED)
+			continue;
+		g_hash_table_insert (priv->store_index,
+				     g_strdup (as_provide_get_value (prov)),
+				     g_object_ref (app));
+	}
+}
+
+/* built once per metadata load, rather than scanning every app on each
+ * per-device GetUpdates call */
+static GHashTable *
+fu_main_store_get_index (FuMainPrivate *priv)
+{
+	GPtrArray *apps;
+
+	if (priv->store_index != NULL)
+		return priv->store_index;
+	priv->store_index = g_hash_table_new_full (g_str_hash, g_str_equal,
+						   g_free,
+						   (GDestroyNotify) g_object_unref);
+	apps = as_store_get_apps (priv->store);
+	for (guint i = 0; i < apps->len; i++) {
+		AsApp *app = AS_APP (g_ptr_array_index (apps, i));
+		fu_main_store_index_add_app (priv, app);
+	}
+	g_debug ("indexed %u GUIDs from %u apps",
+		 g_hash_table_size (priv->store_index), apps->len);
+	return priv->store_index;
+}
+
 static AsApp *
-fu_main_store_get_app_by_guids (AsStore *store, FuDevice *device)
+fu_main_store_get_app_by_guid (FuMainPrivate *priv, AsStore *store,
+			       const gchar *guid)
+{
+	/* the daemon store may have been shed while idle */
+	if (store == NULL)
+		store = fu_main_store_ensure (priv);
+	if (store == NULL)
+		return NULL;
+
+	/* the daemon-owned store has a hash index; transient stores built from
+	 * a single cab file do not warrant one */
+	if (store == priv->store)
+		return g_hash_table_lookup (fu_main_store_get_index (priv), guid);
+	return as_store_get_app_by_provide (store,
+					    AS_PROVIDE_KIND_FIRMWARE_FLASHED,
+					    guid);
+}
+
+static AsApp *
+fu_main_store_get_app_by_guids (FuMainPrivate *priv, AsStore *store,
+				FuDevice *device)
 {
 	GPtrArray *guids = fu_device_get_guids (device);
 	for (guint i = 0; i < guids->len; i++) {
 		AsApp *app = NULL;
-		app = as_store_get_app_by_provide (store,
-						   AS_PROVIDE_KIND_FIRMWARE_FLASHED,
-						   g_ptr_array_index (guids, i));
+		app = fu_main_store_get_app_by_guid (priv, store,
+						     g_ptr_array_index (guids, i));
 		if (app != NULL)
 			return app;
 	}
@@ -929,13 +1666,14 @@ fu_main_update_helper_for_device (FuMainAuthHelper *helper,
 	AsChecksum *csum_tmp;
 	AsRelease *rel;
 	GBytes *blob_fw;
+	GBytes *blob_shared;
 	const gchar *tmp;
 	const gchar *version;
 	gboolean is_downgrade;
 	gint vercmp;
 
 	/* find from guid */
-	app = fu_main_store_get_app_by_guids (helper->store, device);
+	app = fu_main_store_get_app_by_guids (helper->priv, helper->store, device);
 	if (app == NULL) {
 		g_autofree gchar *guid = NULL;
 		guid = fu_main_get_guids_from_store (helper->store);
@@ -1016,7 +1754,7 @@ fu_main_update_helper_for_device (FuMainAuthHelper *helper,
 	}
 
 	/* possibly convert the version from 0x to dotted */
-	fu_main_vendor_quirk_release_version (app);
+	fu_main_vendor_quirk_release_version (helper->priv, app);
 
 	version = as_release_get_version (rel);
 	fu_device_set_update_version (device, version);
@@ -1076,11 +1814,27 @@ fu_main_update_helper_for_device (FuMainAuthHelper *helper,
 		helper->is_downgrade = is_downgrade;
 
 	/* verify */
-	if (!fu_main_get_release_trust_flags (rel, &helper->trust_flags, error))
+	if (!fu_main_get_release_trust_flags (helper->priv, rel,
+					      &helper->trust_flags, error))
 		return FALSE;
 
-	/* success */
-	g_ptr_array_add (helper->blob_fws, g_bytes_ref (blob_fw));
+	/* success: plugins get a zero-copy view of a sealed mapping, and
+	 * identical devices in the same session share one mapping instead
+	 * of sealing a copy of the payload per device */
+	if (helper->blob_cache == NULL) {
+		helper->blob_cache = g_hash_table_new_full (g_direct_hash,
+							    g_direct_equal,
+							    NULL,
+							    (GDestroyNotify) g_bytes_unref);
+	}
+	blob_shared = g_hash_table_lookup (helper->blob_cache, blob_fw);
+	if (blob_shared == NULL) {
+		g_autoptr(FuBlob) blob_sealed = NULL;
+		blob_sealed = fu_blob_new_from_bytes (blob_fw, NULL);
+		blob_shared = fu_blob_get_bytes (blob_sealed);
+		g_hash_table_insert (helper->blob_cache, blob_fw, blob_shared);
+	}
+	g_ptr_array_add (helper->blob_fws, g_bytes_ref (blob_shared));
 	return TRUE;
 }
 
@@ -1091,8 +1845,10 @@ fu_main_update_helper (FuMainAuthHelper *helper, GError **error)
 
 	/* load store file which also decompresses firmware */
 	fu_main_set_status (helper->priv, FWUPD_STATUS_DECOMPRESSING);
+	fu_trace1 (cab_extract_start, g_bytes_get_size (helper->blob_cab));
 	if (!as_store_from_bytes (helper->store, helper->blob_cab, NULL, error))
 		return FALSE;
+	fu_trace (cab_extract_done);
 
 	/* we've specified a specific device; failure is critical */
 	if (helper->devices->len > 0) {
@@ -1113,7 +1869,7 @@ fu_main_update_helper (FuMainAuthHelper *helper, GError **error)
 
 		/* guid found */
 		item = g_ptr_array_index (helper->priv->devices, i);
-		app = fu_main_store_get_app_by_guids (helper->store, item->device);
+		app = fu_main_store_get_app_by_guids (helper->priv, helper->store, item->device);
 		if (app == NULL)
 			continue;
 
@@ -1129,7 +1885,7 @@ fu_main_update_helper (FuMainAuthHelper *helper, GError **error)
 						       item->device,
 						       &error_local)) {
 			g_debug ("failed to add %s: %s",
-				 fu_device_get_id (item->device),
+				 item->id,
 				 error_local->message);
 
 			/* save this for later */
@@ -1244,10 +2000,10 @@ fu_main_get_item_by_id_fallback_pending (FuMainPrivate *priv, const gchar *id, G
 					     "no plugin %s found", tmp);
 				return NULL;
 			}
-			item = g_new0 (FuDeviceItem, 1);
+			item = g_slice_new0 (FuDeviceItem);
 			item->device = g_object_ref (dev);
 			item->plugin = g_object_ref (plugin);
-			g_ptr_array_add (priv->devices, item);
+			fu_main_item_add (priv, item);
 
 			/* FIXME: just a boolean on FuDeviceItem? */
 			fu_device_set_metadata (dev, "FakeDevice", "TRUE");
@@ -1300,6 +2056,95 @@ fu_main_get_action_id_for_device (FuMainAuthHelper *helper)
 	return "org.freedesktop.fwupd.update-internal";
 }
 
+static void
+fu_main_app_get_flashed_guids (AsApp *app, GPtrArray *guids)
+{
+	GPtrArray *provides = as_app_get_provides (app);
+	for (guint i = 0; i < provides->len; i++) {
+		AsProvide *prov = g_ptr_array_index (provides, i);
+		if (as_provide_get_kind (prov) != AS_PROVIDE_KIND_FIRMWARE_FLASHED)
+			continue;
+		g_ptr_array_add (guids, g_strdup (as_provide_get_value (prov)));
+	}
+}
+
+static gboolean
+fu_main_app_is_same (AsApp *app_old, AsApp *app_new)
+{
+	GPtrArray *rels_old = as_app_get_releases (app_old);
+	GPtrArray *rels_new = as_app_get_releases (app_new);
+
+	/* a different remote now provides this app */
+	if (g_strcmp0 (as_app_get_metadata_item (app_old, "fwupd::RemoteID"),
+		       as_app_get_metadata_item (app_new, "fwupd::RemoteID")) != 0)
+		return FALSE;
+
+	/* compare each release by version and container checksum */
+	if (rels_old->len != rels_new->len)
+		return FALSE;
+	for (guint i = 0; i < rels_new->len; i++) {
+		AsRelease *rel_old = g_ptr_array_index (rels_old, i);
+		AsRelease *rel_new = g_ptr_array_index (rels_new, i);
+		AsChecksum *csum_old = as_release_get_checksum_by_target (rel_old,
+									  AS_CHECKSUM_TARGET_CONTAINER);
+		AsChecksum *csum_new = as_release_get_checksum_by_target (rel_new,
+									  AS_CHECKSUM_TARGET_CONTAINER);
+		if (g_strcmp0 (as_release_get_version (rel_old),
+			       as_release_get_version (rel_new)) != 0)
+			return FALSE;
+		if (g_strcmp0 (csum_old != NULL ? as_checksum_get_value (csum_old) : NULL,
+			       csum_new != NULL ? as_checksum_get_value (csum_new) : NULL) != 0)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* re-check only the devices that match one of the affected GUIDs, rather
+ * than every attached device */
+static void
+fu_main_store_changed_guids (FuMainPrivate *priv, GPtrArray *guids_changed)
+{
+	g_autoptr(GHashTable) guids_hash = NULL;
+
+	/* cached update resolutions were made against the old metadata */
+	priv->store_generation++;
+
+	guids_hash = g_hash_table_new (g_str_hash, g_str_equal);
+	for (guint i = 0; i < guids_changed->len; i++) {
+		g_hash_table_add (guids_hash,
+				  g_ptr_array_index (guids_changed, i));
+	}
+	for (guint i = 0; i < priv->devices->len; i++) {
+		FuDeviceItem *item = g_ptr_array_index (priv->devices, i);
+		GPtrArray *device_guids = fu_device_get_guids (item->device);
+		gboolean matches = FALSE;
+		for (guint j = 0; j < device_guids->len; j++) {
+			if (g_hash_table_contains (guids_hash,
+						   g_ptr_array_index (device_guids, j))) {
+				matches = TRUE;
+				break;
+			}
+		}
+		if (!matches)
+			continue;
+		if (fu_main_get_updates_item_update (priv, item))
+			fu_main_emit_device_changed (priv, item->device);
+	}
+}
+
+/* the XML read-and-hash is much cheaper than the XML parse, and tells us if
+ * the binary metadata cache is still valid */
+static gchar *
+fu_main_get_metadata_checksum (void)
+{
+	gsize len = 0;
+	g_autofree gchar *data = NULL;
+	if (!g_file_get_contents (FU_MAIN_METADATA_XML, &data, &len, NULL))
+		return NULL;
+	return g_compute_checksum_for_data (G_CHECKSUM_SHA1,
+					    (const guchar *) data, len);
+}
+
 static gboolean
 fu_main_daemon_update_metadata (FuMainPrivate *priv, const gchar *remote_id,
 				gint fd, gint fd_sig, GError **error)
@@ -1307,12 +2152,16 @@ fu_main_daemon_update_metadata (FuMainPrivate *priv, const gchar *remote_id,
 	const guint8 *data;
 	gsize size;
 	GPtrArray *apps;
+	GPtrArray *apps_old;
+	g_autofree gchar *checksum = NULL;
 	g_autofree gchar *xml = NULL;
+	g_autoptr(GHashTable) ids_new = NULL;
+	g_autoptr(GPtrArray) apps_removed = NULL;
+	g_autoptr(GPtrArray) guids_changed = NULL;
 	g_autoptr(AsStore) store = NULL;
 	g_autoptr(GBytes) bytes = NULL;
 	g_autoptr(GBytes) bytes_raw = NULL;
 	g_autoptr(GBytes) bytes_sig = NULL;
-	g_autoptr(FuKeyring) kr = NULL;
 	g_autoptr(GConverter) converter = NULL;
 	g_autoptr(GFile) file = NULL;
 	g_autoptr(GFile) file_parent = NULL;
@@ -1320,6 +2169,9 @@ fu_main_daemon_update_metadata (FuMainPrivate *priv, const gchar *remote_id,
 	g_autoptr(GInputStream) stream = NULL;
 	g_autoptr(GInputStream) stream_sig = NULL;
 
+	/* the live store may have been shed while idle */
+	fu_main_store_ensure (priv);
+
 	/* read the entire file into memory */
 	stream_fd = g_unix_input_stream_new (fd, TRUE);
 	bytes_raw = g_input_stream_read_bytes (stream_fd, 0x100000, NULL, error);
@@ -1333,10 +2185,7 @@ fu_main_daemon_update_metadata (FuMainPrivate *priv, const gchar *remote_id,
 		return FALSE;
 
 	/* verify file */
-	kr = fu_keyring_new ();
-	if (!fu_keyring_add_public_keys (kr, "/etc/pki/fwupd-metadata", error))
-		return FALSE;
-	if (!fu_keyring_verify_data (kr, bytes_raw, bytes_sig, error))
+	if (!fu_keyring_verify_data (priv->keyring_md, bytes_raw, bytes_sig, error))
 		return FALSE;
 
 	/* peek the file type and get data */
@@ -1377,18 +2226,74 @@ fu_main_daemon_update_metadata (FuMainPrivate *priv, const gchar *remote_id,
 	if (!as_store_from_xml (store, xml, NULL, error))
 		return FALSE;
 
-	/* add the new application from the store */
-	as_store_remove_all (priv->store);
+	/* merge into the live store, only touching entries that actually
+	 * changed; hourly refreshes typically alter a handful of apps and a
+	 * full remove-and-re-add would invalidate every downstream cache */
+	g_signal_handlers_block_by_func (priv->store,
+					 fu_main_store_changed_cb, priv);
+	ids_new = g_hash_table_new (g_str_hash, g_str_equal);
+	guids_changed = g_ptr_array_new_with_free_func (g_free);
 	apps = as_store_get_apps (store);
 	for (guint i = 0; i < apps->len; i++) {
 		AsApp *app = g_ptr_array_index (apps, i);
 		if (remote_id != NULL && remote_id[0] != '\0')
 			as_app_add_metadata (app, "fwupd::RemoteID", remote_id);
+		g_hash_table_add (ids_new, (gpointer) as_app_get_id (app));
+	}
+
+	/* remove apps no longer present in the new metadata */
+	apps_removed = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	apps_old = as_store_get_apps (priv->store);
+	for (guint i = 0; i < apps_old->len; i++) {
+		AsApp *app = g_ptr_array_index (apps_old, i);
+		if (g_hash_table_contains (ids_new, as_app_get_id (app)))
+			continue;
+		g_ptr_array_add (apps_removed, g_object_ref (app));
+	}
+	for (guint i = 0; i < apps_removed->len; i++) {
+		AsApp *app = g_ptr_array_index (apps_removed, i);
+		fu_main_app_get_flashed_guids (app, guids_changed);
+		as_store_remove_app (priv->store, app);
+	}
+
+	/* add apps that are new or changed */
+	for (guint i = 0; i < apps->len; i++) {
+		AsApp *app = g_ptr_array_index (apps, i);
+		AsApp *app_old = as_store_get_app_by_id (priv->store,
+							 as_app_get_id (app));
+		if (app_old != NULL) {
+			if (fu_main_app_is_same (app_old, app))
+				continue;
+			fu_main_app_get_flashed_guids (app_old, guids_changed);
+			as_store_remove_app (priv->store, app_old);
+		}
+		fu_main_app_get_flashed_guids (app, guids_changed);
 		as_store_add_app (priv->store, app);
 	}
+	g_signal_handlers_unblock_by_func (priv->store,
+					   fu_main_store_changed_cb, priv);
+
+	/* update the GUID index in place if it has been built */
+	if (priv->store_index != NULL) {
+		for (guint i = 0; i < guids_changed->len; i++) {
+			g_hash_table_remove (priv->store_index,
+					     g_ptr_array_index (guids_changed, i));
+		}
+		for (guint i = 0; i < apps->len; i++) {
+			AsApp *app = g_ptr_array_index (apps, i);
+			AsApp *app_store = as_store_get_app_by_id (priv->store,
+								   as_app_get_id (app));
+			if (app_store != NULL)
+				fu_main_store_index_add_app (priv, app_store);
+		}
+	}
+
+	/* notify just the devices that match an affected GUID */
+	if (guids_changed->len > 0)
+		fu_main_store_changed_guids (priv, guids_changed);
 
 	/* ensure directory exists */
-	file = g_file_new_for_path ("/var/cache/app-info/xmls/fwupd.xml");
+	file = g_file_new_for_path (FU_MAIN_METADATA_XML);
 	file_parent = g_file_get_parent (file);
 	if (!g_file_query_exists (file_parent, NULL)) {
 		if (!g_file_make_directory_with_parents (file_parent, NULL, error))
@@ -1405,6 +2310,19 @@ fu_main_daemon_update_metadata (FuMainPrivate *priv, const gchar *remote_id,
 			       NULL, error)) {
 		return FALSE;
 	}
+	priv->metadata_write_time = g_get_monotonic_time ();
+
+	/* refresh the binary cache used to skip the XML parse on startup */
+	checksum = fu_main_get_metadata_checksum ();
+	if (checksum != NULL) {
+		g_autoptr(GError) error_cache = NULL;
+		if (!fu_metadata_cache_save (priv->store,
+					     FU_MAIN_METADATA_CACHE,
+					     checksum, &error_cache)) {
+			g_warning ("failed to save metadata cache: %s",
+				   error_cache->message);
+		}
+	}
 
 	return TRUE;
 }
@@ -1443,40 +2361,253 @@ fu_main_store_delay_cb (gpointer user_data)
 static void
 fu_main_store_changed_cb (AsStore *store, FuMainPrivate *priv)
 {
+	/* force the GUID index to be rebuilt on next use, and re-resolve
+	 * any cached per-device update results */
+	g_clear_pointer (&priv->store_index, g_hash_table_unref);
+	priv->store_generation++;
 	if (priv->store_changed_id != 0)
 		return;
 	priv->store_changed_id = g_timeout_add (200, fu_main_store_delay_cb, priv);
 }
 
 static gboolean
-fu_main_get_updates_item_update (FuMainPrivate *priv, FuDeviceItem *item)
+fu_main_store_load (FuMainPrivate *priv, GError **error)
+{
+	g_autofree gchar *checksum_metadata = NULL;
+	g_autoptr(GError) error_cache = NULL;
+
+	priv->store = as_store_new ();
+	g_signal_connect (priv->store, "changed",
+			  G_CALLBACK (fu_main_store_changed_cb), priv);
+	as_store_set_watch_flags (priv->store, AS_STORE_WATCH_FLAG_ADDED |
+					       AS_STORE_WATCH_FLAG_REMOVED);
+
+	/* load AppStream, preferring the binary cache to the XML parse */
+	as_store_add_filter (priv->store, AS_APP_KIND_FIRMWARE);
+	checksum_metadata = fu_main_get_metadata_checksum ();
+	if (checksum_metadata != NULL &&
+	    fu_metadata_cache_load (priv->store, FU_MAIN_METADATA_CACHE,
+				    checksum_metadata, &error_cache)) {
+		g_debug ("loaded metadata from %s", FU_MAIN_METADATA_CACHE);
+		return TRUE;
+	}
+	if (error_cache != NULL)
+		g_debug ("not using metadata cache: %s", error_cache->message);
+	return as_store_load (priv->store,
+			      AS_STORE_LOAD_FLAG_IGNORE_INVALID |
+			      AS_STORE_LOAD_FLAG_APP_INFO_SYSTEM,
+			      NULL, error);
+}
+
+static AsStore *
+fu_main_store_ensure (FuMainPrivate *priv)
+{
+	g_autoptr(GError) error = NULL;
+
+	/* reload after an idle shed; the cost is bounded by the mmap-able
+	 * binary cache rather than a full XML parse */
+	if (priv->store != NULL)
+		return priv->store;
+	g_debug ("reloading metadata store after idle shed");
+	if (!fu_main_store_load (priv, &error))
+		g_warning ("failed to reload metadata: %s", error->message);
+	return priv->store;
+}
+
+static gboolean
+fu_main_idle_shed_cb (gpointer user_data)
+{
+	FuMainPrivate *priv = (FuMainPrivate *) user_data;
+
+	priv->idle_shed_id = 0;
+
+	/* never shed mid-action; try again later */
+	if (priv->status != FWUPD_STATUS_IDLE || priv->session_active) {
+		fu_main_idle_shed_rearm (priv);
+		return G_SOURCE_REMOVE;
+	}
+
+	/* drop the parsed metadata stores and every cache derived from
+	 * them; all of it is rebuilt lazily on the next request */
+	g_debug ("idle for %u minutes, shedding caches", priv->idle_shed_timeout);
+	if (priv->store_changed_id != 0) {
+		g_source_remove (priv->store_changed_id);
+		priv->store_changed_id = 0;
+	}
+	g_clear_object (&priv->store);
+	g_clear_object (&priv->store_verify);
+	g_clear_pointer (&priv->store_index, g_hash_table_unref);
+	priv->store_generation++;
+	g_clear_pointer (&priv->devices_reply, g_variant_unref);
+	for (guint i = 0; i < priv->devices->len; i++) {
+		FuDeviceItem *item = g_ptr_array_index (priv->devices, i);
+		fu_main_item_invalidate_serialized (priv, item);
+	}
+#ifdef __GLIBC__
+	/* actually hand the freed pages back to the kernel so the idle
+	 * RSS drops, rather than just shrinking the malloc arena */
+	malloc_trim (0);
+#endif
+	return G_SOURCE_REMOVE;
+}
+
+static void
+fu_main_idle_shed_rearm (FuMainPrivate *priv)
+{
+	if (priv->idle_shed_timeout == 0)
+		return;
+	if (priv->idle_shed_id != 0)
+		g_source_remove (priv->idle_shed_id);
+	priv->idle_shed_id = g_timeout_add_seconds (priv->idle_shed_timeout * 60,
+						    fu_main_idle_shed_cb, priv);
+}
+
+static gboolean
+fu_main_metadata_reload_cb (gpointer user_data)
+{
+	FuMainPrivate *priv = (FuMainPrivate *) user_data;
+
+	priv->metadata_reload_id = 0;
+
+	/* when shed the next request reloads from disk anyway; the cache
+	 * checksum no longer matches so the new XML gets parsed then */
+	if (priv->store == NULL)
+		return G_SOURCE_REMOVE;
+
+	/* somebody replaced the metadata behind our back, e.g. a
+	 * config-management push; reload and re-evaluate every device */
+	g_debug ("metadata changed on disk, reloading");
+	if (priv->store_changed_id != 0) {
+		g_source_remove (priv->store_changed_id);
+		priv->store_changed_id = 0;
+	}
+	g_clear_object (&priv->store);
+	g_clear_pointer (&priv->store_index, g_hash_table_unref);
+	priv->store_generation++;
+	g_clear_pointer (&priv->devices_reply, g_variant_unref);
+	for (guint i = 0; i < priv->devices->len; i++) {
+		FuDeviceItem *item = g_ptr_array_index (priv->devices, i);
+		fu_main_item_invalidate_serialized (priv, item);
+	}
+	fu_main_store_ensure (priv);
+	priv->store_changed_id = g_timeout_add (200, fu_main_store_delay_cb, priv);
+	return G_SOURCE_REMOVE;
+}
+
+static void
+fu_main_metadata_monitor_changed_cb (GFileMonitor *monitor,
+				     GFile *file,
+				     GFile *other_file,
+				     GFileMonitorEvent event_type,
+				     gpointer user_data)
+{
+	FuMainPrivate *priv = (FuMainPrivate *) user_data;
+
+	/* the daemon itself just wrote the file; the live store is current */
+	if (g_get_monotonic_time () - priv->metadata_write_time <
+	    FU_MAIN_SELF_WRITE_GRACE_US)
+		return;
+
+	/* an atomic replace produces several events; act once at the end */
+	if (priv->metadata_reload_id != 0)
+		g_source_remove (priv->metadata_reload_id);
+	priv->metadata_reload_id = g_timeout_add (FU_MAIN_MONITOR_DEBOUNCE_MS,
+						  fu_main_metadata_reload_cb,
+						  priv);
+}
+
+static void
+fu_main_verify_monitor_changed_cb (GFileMonitor *monitor,
+				   GFile *file,
+				   GFile *other_file,
+				   GFileMonitorEvent event_type,
+				   gpointer user_data)
+{
+	FuMainPrivate *priv = (FuMainPrivate *) user_data;
+
+	/* our own attestation write; the cached store already matches */
+	if (g_get_monotonic_time () - priv->verify_write_time <
+	    FU_MAIN_SELF_WRITE_GRACE_US)
+		return;
+
+	/* loaded lazily, so dropping the cache is the whole reload */
+	if (priv->store_verify != NULL) {
+		g_debug ("verify store changed on disk, dropping cache");
+		g_clear_object (&priv->store_verify);
+	}
+}
+
+static void
+fu_main_monitors_setup (FuMainPrivate *priv)
+{
+	g_autoptr(GError) error_md = NULL;
+	g_autoptr(GError) error_vfy = NULL;
+	g_autoptr(GFile) file_md = g_file_new_for_path (FU_MAIN_METADATA_XML);
+	g_autoptr(GFile) file_vfy = g_file_new_for_path (FU_MAIN_VERIFY_XML);
+
+	/* inotify-backed, so noticing an external push costs no steady-state
+	 * wakeups at all; this also covers the case where the store came
+	 * from the binary cache and appstream-glib set up no file watch */
+	priv->monitor_metadata = g_file_monitor_file (file_md,
+						      G_FILE_MONITOR_NONE,
+						      NULL, &error_md);
+	if (priv->monitor_metadata != NULL) {
+		g_signal_connect (priv->monitor_metadata, "changed",
+				  G_CALLBACK (fu_main_metadata_monitor_changed_cb),
+				  priv);
+	} else {
+		g_warning ("failed to watch %s: %s",
+			   FU_MAIN_METADATA_XML, error_md->message);
+	}
+	priv->monitor_verify = g_file_monitor_file (file_vfy,
+						    G_FILE_MONITOR_NONE,
+						    NULL, &error_vfy);
+	if (priv->monitor_verify != NULL) {
+		g_signal_connect (priv->monitor_verify, "changed",
+				  G_CALLBACK (fu_main_verify_monitor_changed_cb),
+				  priv);
+	} else {
+		g_warning ("failed to watch %s: %s",
+			   FU_MAIN_VERIFY_XML, error_vfy->message);
+	}
+}
+
+static gboolean
+fu_main_get_updates_item_resolve (FuMainPrivate *priv, FuDeviceItem *item)
 {
 	AsApp *app;
 	AsRelease *release;
 	GPtrArray *releases;
 	const gchar *tmp;
 	const gchar *version;
+	guint8 version_key[FWUPD_VERSION_KEY_SZ];
+	const guint8 *version_key_ptr = NULL;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(GPtrArray) updates_list = NULL;
 
-	/* get device version */
+	/* get device version, packing the comparison key just once */
 	version = fu_device_get_version (item->device);
 	if (version == NULL)
 		return FALSE;
+	if (fwupd_version_key_from_string (version, version_key))
+		version_key_ptr = version_key;
+
+	/* the update metadata set below changes the serialized form */
+	fu_main_item_invalidate_serialized (priv, item);
 
 	/* match the GUIDs in the XML */
-	app = fu_main_store_get_app_by_guids (priv->store, item->device);
+	app = fu_main_store_get_app_by_guids (priv, priv->store, item->device);
 	if (app == NULL)
 		return FALSE;
 
 	/* possibly convert the version from 0x to dotted */
-	fu_main_vendor_quirk_release_version (app);
+	fu_main_vendor_quirk_release_version (priv, app);
 
 	/* get latest release */
 	release = as_app_get_release_default (app);
 	if (release == NULL) {
 		g_debug ("%s [%s] has no firmware update metadata",
-			 fu_device_get_id (item->device),
+			 item->id,
 			 fu_device_get_name (item->device));
 		return FALSE;
 	}
@@ -1486,9 +2617,9 @@ fu_main_get_updates_item_update (FuMainPrivate *priv, FuDeviceItem *item)
 			       FWUPD_DEVICE_FLAG_SUPPORTED);
 
 	/* check if actually newer than what we have installed */
-	if (as_utils_vercmp (as_release_get_version (release), version) <= 0) {
+	if (fu_main_release_vercmp (release, version_key_ptr, version) <= 0) {
 		g_debug ("%s has no firmware updates",
-			 fu_device_get_id (item->device));
+			 item->id);
 		return FALSE;
 	}
 
@@ -1502,7 +2633,7 @@ fu_main_get_updates_item_update (FuMainPrivate *priv, FuDeviceItem *item)
 	if (!fu_device_has_flag (item->device, FWUPD_DEVICE_FLAG_ALLOW_OFFLINE) &&
 	    !fu_device_has_flag (item->device, FWUPD_DEVICE_FLAG_ALLOW_ONLINE)) {
 		g_debug ("ignoring %s [%s] as not updatable live or offline",
-			 fu_device_get_id (item->device),
+			 item->id,
 			 fu_device_get_name (item->device));
 		return FALSE;
 	}
@@ -1546,7 +2677,7 @@ fu_main_get_updates_item_update (FuMainPrivate *priv, FuDeviceItem *item)
 	releases = as_app_get_releases (app);
 	for (guint i = 0; i < releases->len; i++) {
 		release = g_ptr_array_index (releases, i);
-		if (as_utils_vercmp (as_release_get_version (release), version) <= 0)
+		if (fu_main_release_vercmp (release, version_key_ptr, version) <= 0)
 			continue;
 		tmp = as_release_get_description (release, NULL);
 		if (tmp == NULL)
@@ -1579,6 +2710,26 @@ fu_main_get_updates_item_update (FuMainPrivate *priv, FuDeviceItem *item)
 	return TRUE;
 }
 
+/* monitoring agents poll GetUpdates far more often than the metadata or
+ * the devices actually change, so the resolution is memoized per device;
+ * the device version and the store generation together key the answer,
+ * and a generation bump from a metadata merge invalidates it exactly */
+static gboolean
+fu_main_get_updates_item_update (FuMainPrivate *priv, FuDeviceItem *item)
+{
+	const gchar *version = fu_device_get_version (item->device);
+	if (version != NULL &&
+	    item->update_version != NULL &&
+	    item->update_generation == priv->store_generation &&
+	    g_strcmp0 (version, item->update_version) == 0)
+		return item->update_result;
+	item->update_result = fu_main_get_updates_item_resolve (priv, item);
+	g_free (item->update_version);
+	item->update_version = g_strdup (version);
+	item->update_generation = priv->store_generation;
+	return item->update_result;
+}
+
 /* find any updates using the AppStream metadata */
 static GPtrArray *
 fu_main_get_updates (FuMainPrivate *priv, GError **error)
@@ -1606,9 +2757,8 @@ fu_main_get_releases_to_variant (FuMainPrivate *priv, FuDeviceItem *item, GError
 	for (guint i = 0; i < device_guids->len; i++) {
 		GPtrArray *releases;
 		const gchar *guid = g_ptr_array_index (device_guids, i);
-		AsApp *app = as_store_get_app_by_provide (priv->store,
-							  AS_PROVIDE_KIND_FIRMWARE_FLASHED,
-							  guid);
+		AsApp *app = fu_main_store_get_app_by_guid (priv, priv->store,
+							    guid);
 		if (app == NULL)
 			continue;
 		releases = as_app_get_releases (app);
@@ -1681,18 +2831,74 @@ fu_main_get_store_from_fd (FuMainPrivate *priv, gint fd, GError **error)
 	return g_steal_pointer (&store);
 }
 
-static FwupdResult *
-fu_main_get_result_from_app (FuMainPrivate *priv, AsApp *app, GError **error)
+static AsApp *
+fu_main_get_app_from_metainfo_blob (GBytes *blob, GError **error)
 {
-	FwupdTrustFlags trust_flags = FWUPD_TRUST_FLAG_NONE;
-	AsRelease *release;
-	FwupdDevice *dev;
-	FwupdRelease *rel;
-	GPtrArray *provides;
-	g_autoptr(FwupdResult) res = NULL;
-
-	res = fwupd_result_new ();
-	dev = fwupd_result_get_device (res);
+	gint fd_tmp;
+	g_autofree gchar *fn_tmp = NULL;
+	g_autoptr(AsApp) app = as_app_new ();
+
+	/* appstream-glib has no API to parse MetaInfo data from memory,
+	 * so use a temporary file; this is only ever a few kB */
+	fd_tmp = g_file_open_tmp ("fwupd-XXXXXX.metainfo.xml", &fn_tmp, error);
+	if (fd_tmp < 0)
+		return NULL;
+	close (fd_tmp);
+	if (!g_file_set_contents (fn_tmp,
+				  g_bytes_get_data (blob, NULL),
+				  (gssize) g_bytes_get_size (blob),
+				  error)) {
+		g_unlink (fn_tmp);
+		return NULL;
+	}
+	if (!as_app_parse_file (app, fn_tmp, AS_APP_PARSE_FLAG_NONE, error)) {
+		g_unlink (fn_tmp);
+		return NULL;
+	}
+	g_unlink (fn_tmp);
+	return g_steal_pointer (&app);
+}
+
+/* extract just the MetaInfo members from the cabinet directory without ever
+ * decompressing the payload to disk or checksumming it; GetDetails only has
+ * to return the metadata. The member extraction itself is shared with
+ * fwupd_client_inspect_file() in libfwupd */
+static AsStore *
+fu_main_get_metainfo_store_from_fd (FuMainPrivate *priv, gint fd, GError **error)
+{
+	g_autoptr(AsStore) store = as_store_new ();
+	g_autoptr(GPtrArray) blobs = NULL;
+
+	fu_trace (cab_metainfo_start);
+	blobs = fwupd_cabinet_get_metainfo_blobs (fd, error);
+	if (blobs == NULL)
+		return NULL;
+	for (guint i = 0; i < blobs->len; i++) {
+		GBytes *blob = g_ptr_array_index (blobs, i);
+		g_autoptr(AsApp) app = NULL;
+
+		/* parse standalone */
+		app = fu_main_get_app_from_metainfo_blob (blob, error);
+		if (app == NULL)
+			return NULL;
+		as_store_add_app (store, app);
+	}
+	fu_trace1 (cab_metainfo_done, as_store_get_apps (store)->len);
+	return g_steal_pointer (&store);
+}
+
+static FwupdResult *
+fu_main_get_result_from_app (FuMainPrivate *priv, AsApp *app, GError **error)
+{
+	FwupdTrustFlags trust_flags = FWUPD_TRUST_FLAG_NONE;
+	AsRelease *release;
+	FwupdDevice *dev;
+	FwupdRelease *rel;
+	GPtrArray *provides;
+	g_autoptr(FwupdResult) res = NULL;
+
+	res = fwupd_result_new ();
+	dev = fwupd_result_get_device (res);
 	provides = as_app_get_provides (app);
 	for (guint i = 0; i < provides->len; i++) {
 		AsProvide *prov = AS_PROVIDE (g_ptr_array_index (provides, i));
@@ -1710,7 +2916,7 @@ fu_main_get_result_from_app (FuMainPrivate *priv, AsApp *app, GError **error)
 		item = fu_main_get_item_by_guid (priv, guid);
 		if (item != NULL) {
 			fwupd_device_set_flags (dev, fu_device_get_flags (item->device));
-			fwupd_device_set_id (dev, fu_device_get_id (item->device));
+			fwupd_device_set_id (dev, item->id);
 		}
 
 		/* add GUID */
@@ -1730,12 +2936,12 @@ fu_main_get_result_from_app (FuMainPrivate *priv, AsApp *app, GError **error)
 
 	/* verify trust */
 	release = as_app_get_release_default (app);
-	if (!fu_main_get_release_trust_flags (release, &trust_flags, error))
+	if (!fu_main_get_release_trust_flags (priv, release, &trust_flags, error))
 		return NULL;
 	fwupd_result_set_update_trust_flags (res, trust_flags);
 
 	/* possibly convert the version from 0x to dotted */
-	fu_main_vendor_quirk_release_version (app);
+	fu_main_vendor_quirk_release_version (priv, app);
 
 	/* create a result with all the metadata in */
 	fwupd_device_set_description (dev, as_app_get_description (app, NULL));
@@ -1756,17 +2962,12 @@ fu_main_get_result_from_app (FuMainPrivate *priv, AsApp *app, GError **error)
 }
 
 static GVariant *
-fu_main_get_details_from_fd (FuMainPrivate *priv, gint fd, GError **error)
+fu_main_get_details_from_store (FuMainPrivate *priv, AsStore *store, GError **error)
 {
 	AsApp *app = NULL;
 	GPtrArray *apps;
-	g_autoptr(AsStore) store = NULL;
 	g_autoptr(FwupdResult) res = NULL;
 
-	store = fu_main_get_store_from_fd (priv, fd, error);
-	if (store == NULL)
-		return NULL;
-
 	/* get all apps */
 	apps = as_store_get_apps (store);
 	if (apps->len == 0) {
@@ -1781,7 +2982,7 @@ fu_main_get_details_from_fd (FuMainPrivate *priv, gint fd, GError **error)
 		 * so try to find the first thing that's installed */
 		for (guint i = 0; i < priv->devices->len; i++) {
 			FuDeviceItem *item = g_ptr_array_index (priv->devices, i);
-			app = fu_main_store_get_app_by_guids (store, item->device);
+			app = fu_main_store_get_app_by_guids (priv, store, item->device);
 			if (app != NULL)
 				break;
 		}
@@ -1804,15 +3005,10 @@ fu_main_get_details_from_fd (FuMainPrivate *priv, gint fd, GError **error)
 }
 
 static GVariant *
-fu_main_get_details_local_from_fd (FuMainPrivate *priv, gint fd, GError **error)
+fu_main_get_details_local_from_store (FuMainPrivate *priv, AsStore *store, GError **error)
 {
 	GPtrArray *apps;
 	GVariantBuilder builder;
-	g_autoptr(AsStore) store = NULL;
-
-	store = fu_main_get_store_from_fd (priv, fd, error);
-	if (store == NULL)
-		return NULL;
 
 	/* get all apps */
 	apps = as_store_get_apps (store);
@@ -1845,6 +3041,461 @@ fu_main_get_details_local_from_fd (FuMainPrivate *priv, gint fd, GError **error)
 	return g_variant_new ("(a{sa{sv}})", &builder);
 }
 
+typedef struct {
+	FuMainPrivate		*priv;
+	GDBusMethodInvocation	*invocation;
+	gint			 fd;
+	gboolean		 all_apps;
+} FuMainGetDetailsHelper;
+
+static void
+fu_main_get_details_helper_free (FuMainGetDetailsHelper *helper)
+{
+	g_slice_free (FuMainGetDetailsHelper, helper);
+}
+
+static void
+fu_main_get_details_thread_cb (GTask *task,
+			       gpointer source_object,
+			       gpointer task_data,
+			       GCancellable *cancellable)
+{
+	FuMainGetDetailsHelper *helper = (FuMainGetDetailsHelper *) task_data;
+	GError *error = NULL;
+	AsStore *store;
+	g_autoptr(GError) error_local = NULL;
+
+	/* this can be slow for a large archive, so it runs on the worker;
+	 * the store is private to this request so no locking is required */
+	store = fu_main_get_metainfo_store_from_fd (helper->priv, helper->fd,
+						    &error_local);
+	if (store != NULL) {
+		close (helper->fd);
+		g_task_return_pointer (task, store,
+				       (GDestroyNotify) g_object_unref);
+		return;
+	}
+
+	/* fall back to the full parse for anything the metadata-only
+	 * path could not handle */
+	g_debug ("metadata-only parse failed: %s", error_local->message);
+	if (lseek (helper->fd, 0, SEEK_SET) < 0) {
+		close (helper->fd);
+		g_task_return_new_error (task,
+					 FWUPD_ERROR,
+					 FWUPD_ERROR_INVALID_FILE,
+					 "failed to rewind archive");
+		return;
+	}
+	store = fu_main_get_store_from_fd (helper->priv, helper->fd, &error);
+	if (store == NULL) {
+		g_task_return_error (task, error);
+		return;
+	}
+	g_task_return_pointer (task, store, (GDestroyNotify) g_object_unref);
+}
+
+static void
+fu_main_get_details_done_cb (GObject *source_object,
+			     GAsyncResult *res,
+			     gpointer user_data)
+{
+	FuMainGetDetailsHelper *helper = (FuMainGetDetailsHelper *) user_data;
+	GVariant *val;
+	g_autoptr(AsStore) store = NULL;
+	g_autoptr(GError) error = NULL;
+
+	/* back on the main context; the shared device state is only touched
+	 * from here */
+	store = g_task_propagate_pointer (G_TASK (res), &error);
+	if (store == NULL) {
+		fu_main_invocation_return_error (helper->priv,
+						 helper->invocation, error);
+		return;
+	}
+	if (helper->all_apps) {
+		val = fu_main_get_details_local_from_store (helper->priv,
+							    store, &error);
+	} else {
+		val = fu_main_get_details_from_store (helper->priv,
+						      store, &error);
+	}
+	if (val == NULL) {
+		fu_main_invocation_return_error (helper->priv,
+						 helper->invocation, error);
+		return;
+	}
+	fu_main_invocation_return_value (helper->priv, helper->invocation, val);
+}
+
+static void
+fu_main_get_details_async (FuMainPrivate *priv,
+			   GDBusMethodInvocation *invocation,
+			   gint fd,
+			   gboolean all_apps)
+{
+	FuMainGetDetailsHelper *helper;
+	g_autoptr(GTask) task = NULL;
+
+	/* run the cab parse on a worker thread so a slow GetDetails does
+	 * not block unrelated method calls from other clients */
+	helper = g_slice_new0 (FuMainGetDetailsHelper);
+	helper->priv = priv;
+	helper->invocation = invocation;
+	helper->fd = fd;
+	helper->all_apps = all_apps;
+	task = g_task_new (NULL, NULL, fu_main_get_details_done_cb, helper);
+	g_task_set_task_data (task, helper,
+			      (GDestroyNotify) fu_main_get_details_helper_free);
+	g_task_run_in_thread (task, fu_main_get_details_thread_cb);
+}
+
+/* parse a 'kB' value from /proc/self/status, e.g. VmRSS */
+static guint64
+fu_main_get_memory_kb (const gchar *key)
+{
+	g_autofree gchar *buf = NULL;
+	g_autofree gchar *needle = NULL;
+	gchar *tmp;
+
+	if (!g_file_get_contents ("/proc/self/status", &buf, NULL, NULL))
+		return 0;
+	needle = g_strdup_printf ("%s:", key);
+	tmp = g_strstr_len (buf, -1, needle);
+	if (tmp == NULL)
+		return 0;
+	return g_ascii_strtoull (tmp + strlen (needle), NULL, 10);
+}
+
+static GVariant *
+fu_main_get_stats (FuMainPrivate *priv)
+{
+	GVariantBuilder builder;
+	guint serialized_cnt = 0;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+
+	/* metadata store; report rather than reload when shed so that RSS
+	 * monitoring does not itself undo the idle shedding */
+	g_variant_builder_add (&builder, "{sv}", "StoreLoaded",
+			       g_variant_new_boolean (priv->store != NULL));
+	if (priv->store != NULL) {
+		g_variant_builder_add (&builder, "{sv}", "StoreApps",
+				       g_variant_new_uint32 (as_store_get_apps (priv->store)->len));
+	}
+	if (priv->store_index != NULL) {
+		g_variant_builder_add (&builder, "{sv}", "StoreIndexGuids",
+				       g_variant_new_uint32 (g_hash_table_size (priv->store_index)));
+	}
+
+	/* devices, and how many have a cached D-Bus serialization */
+	for (guint i = 0; i < priv->devices->len; i++) {
+		FuDeviceItem *item = g_ptr_array_index (priv->devices, i);
+		if (item->serialized != NULL)
+			serialized_cnt++;
+	}
+	g_variant_builder_add (&builder, "{sv}", "Devices",
+			       g_variant_new_uint32 (priv->devices->len));
+	g_variant_builder_add (&builder, "{sv}", "DevicesSerialized",
+			       g_variant_new_uint32 (serialized_cnt));
+
+	/* per-plugin device cache occupancy */
+	g_variant_builder_add (&builder, "{sv}", "Plugins",
+			       g_variant_new_uint32 (priv->plugins->len));
+	for (guint i = 0; i < priv->plugins->len; i++) {
+		FuPlugin *plugin = g_ptr_array_index (priv->plugins, i);
+		g_autofree gchar *key = NULL;
+		guint cnt = fu_plugin_get_cache_size (plugin);
+		if (cnt == 0)
+			continue;
+		key = g_strdup_printf ("PluginCache(%s)",
+				       fu_plugin_get_name (plugin));
+		g_variant_builder_add (&builder, "{sv}", key,
+				       g_variant_new_uint32 (cnt));
+	}
+
+	/* per-vfunc runtime accounting, so a stalling plugin is visible
+	 * here before it shows up as user complaints */
+	for (guint i = 0; i < priv->plugins->len; i++) {
+		FuPlugin *plugin = g_ptr_array_index (priv->plugins, i);
+		g_autofree gchar *key = NULL;
+		g_autofree gchar *stats = fu_plugin_get_runtime_stats (plugin);
+		if (stats == NULL)
+			continue;
+		key = g_strdup_printf ("PluginRuntime(%s)",
+				       fu_plugin_get_name (plugin));
+		g_variant_builder_add (&builder, "{sv}", key,
+				       g_variant_new_string (stats));
+	}
+
+	/* transfer accounting from updates done this daemon lifetime */
+	if (g_hash_table_size (priv->update_stats) > 0) {
+		GHashTableIter iter;
+		gpointer id, stats;
+		g_hash_table_iter_init (&iter, priv->update_stats);
+		while (g_hash_table_iter_next (&iter, &id, &stats)) {
+			g_autofree gchar *key = NULL;
+			key = g_strdup_printf ("UpdateStats(%s)",
+					       (const gchar *) id);
+			g_variant_builder_add (&builder, "{sv}", key,
+					       g_variant_new_string ((const gchar *) stats));
+		}
+	}
+
+	/* sqlite allocations for the pending database */
+	g_variant_builder_add (&builder, "{sv}", "PendingDbBytes",
+			       g_variant_new_uint64 (fu_pending_get_memory_used (priv->pending)));
+
+	/* process-wide, so any regression shows up even if the
+	 * per-subsystem counters above do not explain it */
+	g_variant_builder_add (&builder, "{sv}", "VmRssKb",
+			       g_variant_new_uint64 (fu_main_get_memory_kb ("VmRSS")));
+	g_variant_builder_add (&builder, "{sv}", "VmPeakKb",
+			       g_variant_new_uint64 (fu_main_get_memory_kb ("VmPeak")));
+
+	return g_variant_new ("(a{sv})", &builder);
+}
+
+static gboolean
+fu_main_method_is_read_only (const gchar *method_name)
+{
+	const gchar *methods[] = {
+		"GetDevices",
+		"GetDevicesPaged",
+		"GetDevicesSince",
+		"GetStats",
+		"DumpDebugLog",
+		"Query",
+		"GetUpdates",
+		"GetReleases",
+		"GetResults",
+		"GetDetails",
+		"GetDetailsLocal",
+		NULL };
+	return g_strv_contains (methods, method_name);
+}
+
+/* anything answering from or acting on the device list is wrong until
+ * the hardware has actually been probed; everything else -- daemon
+ * properties, file inspection, statistics -- can be answered from the
+ * moment the bus name is owned */
+static gboolean
+fu_main_method_requires_coldplug (const gchar *method_name)
+{
+	const gchar *methods[] = {
+		"GetDevices",
+		"GetDevicesPaged",
+		"GetDevicesSince",
+		"Query",
+		"GetUpdates",
+		"GetReleases",
+		"ClearResults",
+		"GetResults",
+		"UpdateMetadata",
+		"UpdateMetadataWithId",
+		"Unlock",
+		"VerifyUpdate",
+		"Verify",
+		"Install",
+		"InstallMultiple",
+		"VerifyAll",
+		NULL };
+	return g_strv_contains (methods, method_name);
+}
+
+/* compare the firmware checksum the plugin read back against the one in
+ * the AppStream metadata for the version the device claims to run */
+static gboolean
+fu_main_verify_item_checksum (FuMainPrivate *priv, FuDeviceItem *item, GError **error)
+{
+	AsApp *app;
+	AsChecksum *csum;
+	AsRelease *release;
+	GPtrArray *checksums;
+	const gchar *hash = NULL;
+	const gchar *version = NULL;
+
+	/* find component in metadata */
+	app = fu_main_store_get_app_by_guids (priv, priv->store, item->device);
+	if (app == NULL) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_NOT_FOUND,
+				     "No metadata");
+		return FALSE;
+	}
+
+	/* find version in metadata */
+	version = fu_device_get_version (item->device);
+	release = as_app_get_release (app, version);
+	if (release == NULL)
+		release = as_app_get_release_default (app);
+	if (release == NULL) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_FOUND,
+			     "No version %s", version);
+		return FALSE;
+	}
+
+	/* find checksum */
+	csum = as_release_get_checksum_by_target (release, AS_CHECKSUM_TARGET_CONTENT);
+	if (csum == NULL) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_FOUND,
+			     "No content checksum for %s", version);
+		return FALSE;
+	}
+
+	/* get the matching checksum */
+	checksums = fu_device_get_checksums (item->device);
+	if (checksums->len == 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_FOUND,
+			     "No device checksums for %s", version);
+		return FALSE;
+	}
+	for (guint j = 0; j < checksums->len; j++) {
+		const gchar *hash_tmp = g_ptr_array_index (checksums, j);
+		GChecksumType hash_kind = fwupd_checksum_guess_kind (hash_tmp);
+		if (as_checksum_get_kind (csum) == hash_kind) {
+			hash = hash_tmp;
+			break;
+		}
+	}
+	if (hash == NULL) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_FOUND,
+			     "No matching hash kind for %s", version);
+		return FALSE;
+	}
+	if (g_strcmp0 (as_checksum_get_value (csum), hash) != 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_FOUND,
+			     "For v%s expected %s, got %s",
+			     version,
+			     as_checksum_get_value (csum),
+			     hash);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+typedef struct {
+	FuMainPrivate		*priv;
+	GDBusMethodInvocation	*invocation;
+	GHashTable		*results;	/* of device id : result, "" = pass */
+	guint			 cnt_pending;
+	GThreadPool		*pool;
+} FuMainVerifyAllHelper;
+
+typedef struct {
+	FuMainVerifyAllHelper	*helper;
+	FuPlugin		*plugin;
+	GPtrArray		*devices;	/* of FuDevice */
+} FuMainVerifyAllTask;
+
+typedef struct {
+	FuMainVerifyAllHelper	*helper;
+	FuDevice		*device;
+	GError			*error;
+} FuMainVerifyAllResult;
+
+static void
+fu_main_verify_all_task_free (FuMainVerifyAllTask *task)
+{
+	g_ptr_array_unref (task->devices);
+	g_object_unref (task->plugin);
+	g_slice_free (FuMainVerifyAllTask, task);
+}
+
+/* runs on the main context as each device finishes; the firmware
+ * read-back happened on a pool thread, but the metadata comparison is
+ * cheap and every daemon structure is only ever touched from here */
+static gboolean
+fu_main_verify_all_result_cb (gpointer user_data)
+{
+	FuMainVerifyAllResult *res = (FuMainVerifyAllResult *) user_data;
+	FuMainVerifyAllHelper *helper = res->helper;
+	FuMainPrivate *priv = helper->priv;
+	FuDeviceItem *item;
+
+	item = fu_main_get_item_by_id (priv, fu_device_get_id (res->device));
+	if (item == NULL) {
+		if (res->error == NULL) {
+			g_set_error (&res->error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_NOT_FOUND,
+				     "device %s was removed",
+				     fu_device_get_id (res->device));
+		}
+	} else {
+		fu_main_item_invalidate_serialized (priv, item);
+		if (res->error == NULL)
+			fu_main_verify_item_checksum (priv, item, &res->error);
+
+		/* stream the refreshed checksum to any listening clients
+		 * rather than making them wait for the whole sweep */
+		fu_main_emit_device_changed (priv, item->device);
+	}
+	g_hash_table_insert (helper->results,
+			     g_strdup (fu_device_get_id (res->device)),
+			     g_strdup (res->error != NULL ? res->error->message : ""));
+
+	/* everything has completed, send the summary */
+	if (--helper->cnt_pending == 0) {
+		GVariantBuilder builder;
+		GHashTableIter iter;
+		gpointer key, value;
+
+		g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{ss}"));
+		g_hash_table_iter_init (&iter, helper->results);
+		while (g_hash_table_iter_next (&iter, &key, &value)) {
+			g_variant_builder_add (&builder, "{ss}",
+					       (const gchar *) key,
+					       (const gchar *) value);
+		}
+		fu_main_invocation_return_value (priv, helper->invocation,
+						 g_variant_new ("(a{ss})", &builder));
+		g_thread_pool_free (helper->pool, FALSE, TRUE);
+		g_hash_table_unref (helper->results);
+		g_object_unref (helper->invocation);
+		priv->verify_all_running = FALSE;
+		g_slice_free (FuMainVerifyAllHelper, helper);
+	}
+
+	g_clear_error (&res->error);
+	g_object_unref (res->device);
+	g_slice_free (FuMainVerifyAllResult, res);
+	return G_SOURCE_REMOVE;
+}
+
+static void
+fu_main_verify_all_thread_cb (gpointer data, gpointer user_data)
+{
+	FuMainVerifyAllTask *task = (FuMainVerifyAllTask *) data;
+
+	/* devices sharing a plugin share a bus, so they are read back in
+	 * series; devices on other buses are being read at the same time */
+	for (guint i = 0; i < task->devices->len; i++) {
+		FuDevice *device = g_ptr_array_index (task->devices, i);
+		FuMainVerifyAllResult *res = g_slice_new0 (FuMainVerifyAllResult);
+		res->helper = task->helper;
+		res->device = g_object_ref (device);
+		fu_plugin_runner_verify (task->plugin, device,
+					 FU_PLUGIN_VERIFY_FLAG_NONE,
+					 &res->error);
+		g_main_context_invoke_full (NULL, G_PRIORITY_DEFAULT,
+					    fu_main_verify_all_result_cb,
+					    res, NULL);
+	}
+	fu_main_verify_all_task_free (task);
+}
+
 static void
 fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 			    const gchar *object_path, const gchar *interface_name,
@@ -1855,10 +3506,38 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 	GVariant *val;
 	g_autoptr(GError) error = NULL;
 
+	fu_trace2 (method_call, method_name, sender);
+
+	/* any request counts as activity for the idle shed policy */
+	fu_main_idle_shed_rearm (priv);
+
+	/* peer connections on the private socket have no bus name to pass
+	 * to polkit, so only the read-only subset is available there */
+	if (sender == NULL && !fu_main_method_is_read_only (method_name)) {
+		g_set_error (&error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_AUTH_FAILED,
+			     "%s is not available on the private socket",
+			     method_name);
+		fu_main_invocation_return_error (priv, invocation, error);
+		return;
+	}
+
+	/* park device-dependent calls until coldplug has finished; they
+	 * are replayed in arrival order the moment the device list is
+	 * trustworthy */
+	if (!priv->coldplug_done &&
+	    fu_main_method_requires_coldplug (method_name)) {
+		g_debug ("deferring %s() until coldplug has finished",
+			 method_name);
+		g_ptr_array_add (priv->coldplug_queue, invocation);
+		return;
+	}
+
 	/* return 'as' */
 	if (g_strcmp0 (method_name, "GetDevices") == 0) {
 		g_debug ("Called %s()", method_name);
-		val = fu_main_device_array_to_variant (priv->devices, &error);
+		val = fu_main_get_devices_reply (priv, &error);
 		if (val == NULL) {
 			if (g_error_matches (error,
 					     FWUPD_ERROR,
@@ -1869,6 +3548,203 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 			return;
 		}
 		fu_main_invocation_return_value (priv, invocation, val);
+		g_variant_unref (val);
+		return;
+	}
+
+	/* return 'a{sa{sv}}t' */
+	if (g_strcmp0 (method_name, "GetDevicesSince") == 0) {
+		GVariantBuilder builder;
+		guint64 generation = 0;
+		g_variant_get (parameters, "(t)", &generation);
+		g_debug ("Called %s(%" G_GUINT64_FORMAT ")",
+			 method_name, generation);
+		g_variant_builder_init (&builder, G_VARIANT_TYPE_ARRAY);
+		for (guint i = 0; i < priv->devices->len; i++) {
+			FuDeviceItem *item = g_ptr_array_index (priv->devices, i);
+			if (generation != 0 && item->generation <= generation)
+				continue;
+			g_variant_builder_add_value (&builder,
+						     fu_main_item_to_serialized (item));
+		}
+		val = g_variant_new ("(a{sa{sv}}t)", &builder, priv->generation);
+		fu_main_invocation_return_value (priv, invocation, val);
+		return;
+	}
+
+	/* return 'a{sa{sv}}t' */
+	if (g_strcmp0 (method_name, "GetDevicesPaged") == 0) {
+		GVariantBuilder builder;
+		guint64 offset = 0;
+		guint64 limit = 0;
+		g_variant_get (parameters, "(tt)", &offset, &limit);
+		g_debug ("Called %s(%" G_GUINT64_FORMAT ",%" G_GUINT64_FORMAT ")",
+			 method_name, offset, limit);
+		g_variant_builder_init (&builder, G_VARIANT_TYPE_ARRAY);
+		for (guint64 i = offset; i < priv->devices->len; i++) {
+			FuDeviceItem *item = g_ptr_array_index (priv->devices, i);
+			if (limit != 0 && i >= offset + limit)
+				break;
+			g_variant_builder_add_value (&builder,
+						     fu_main_item_to_serialized (item));
+		}
+		val = g_variant_new ("(a{sa{sv}}t)", &builder,
+				     (guint64) priv->devices->len);
+		fu_main_invocation_return_value (priv, invocation, val);
+		return;
+	}
+
+	/* return 'a{sv}' */
+	if (g_strcmp0 (method_name, "GetStats") == 0) {
+		g_debug ("Called %s()", method_name);
+		val = fu_main_get_stats (priv);
+		fu_main_invocation_return_value (priv, invocation, val);
+		return;
+	}
+
+	/* return 's' */
+	if (g_strcmp0 (method_name, "DumpDebugLog") == 0) {
+		g_autofree gchar *dump = NULL;
+		g_debug ("Called %s()", method_name);
+		dump = fu_debug_ring_dump ();
+		val = g_variant_new ("(s)", dump != NULL ? dump : "");
+		fu_main_invocation_return_value (priv, invocation, val);
+		return;
+	}
+
+	/* return '' */
+	if (g_strcmp0 (method_name, "Subscribe") == 0) {
+		FuMainSubscription *sub;
+		GVariant *prop_value;
+		gchar *prop_key;
+		g_autoptr(GVariantIter) iter = NULL;
+
+		g_variant_get (parameters, "(a{sv})", &iter);
+		g_debug ("Called %s()", method_name);
+
+		/* peer connections have no unique name to unicast to */
+		if (sender == NULL) {
+			g_set_error_literal (&error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_NOT_SUPPORTED,
+					     "subscriptions require a bus connection");
+			fu_main_invocation_return_error (priv, invocation, error);
+			return;
+		}
+
+		sub = g_slice_new0 (FuMainSubscription);
+		sub->priv = priv;
+		sub->sender = g_strdup (sender);
+		while (g_variant_iter_next (iter, "{&sv}",
+					    &prop_key, &prop_value)) {
+			g_debug ("got subscription option %s", prop_key);
+			if (g_strcmp0 (prop_key, "device-ids") == 0) {
+				g_autofree const gchar **ids = NULL;
+				ids = g_variant_get_strv (prop_value, NULL);
+				sub->device_ids = g_hash_table_new_full (g_str_hash,
+									 g_str_equal,
+									 g_free, NULL);
+				for (guint i = 0; ids[i] != NULL; i++) {
+					g_hash_table_insert (sub->device_ids,
+							     g_strdup (ids[i]),
+							     GINT_TO_POINTER (1));
+				}
+			}
+			if (g_strcmp0 (prop_key, "summary-only") == 0)
+				sub->summary_only = g_variant_get_boolean (prop_value);
+			g_variant_unref (prop_value);
+		}
+
+		/* drop the interests the moment the client goes away, so a
+		 * crashed agent does not accumulate unicast copies */
+		sub->watcher_id = g_bus_watch_name_on_connection (priv->connection,
+								  sender,
+								  G_BUS_NAME_WATCHER_FLAGS_NONE,
+								  NULL,
+								  fu_main_subscription_vanished_cb,
+								  sub, NULL);
+
+		/* calling again just replaces the old interests */
+		if (priv->subscriptions == NULL) {
+			priv->subscriptions = g_hash_table_new_full (g_str_hash,
+								     g_str_equal,
+								     g_free,
+								     (GDestroyNotify) fu_main_subscription_free);
+		}
+		g_hash_table_insert (priv->subscriptions,
+				     g_strdup (sender), sub);
+		fu_main_invocation_return_value (priv, invocation, NULL);
+		return;
+	}
+
+	/* return 'a(sss)' */
+	if (g_strcmp0 (method_name, "Query") == 0) {
+		GVariantBuilder builder;
+		GVariantIter *iter = NULL;
+		GVariant *value;
+		const gchar *key;
+		guint64 flags_required = 0;
+		g_autofree gchar *guid = NULL;
+		g_autofree gchar *newer_than = NULL;
+		g_autofree gchar *vendor = NULL;
+
+		g_variant_get (parameters, "(a{sv})", &iter);
+		while (g_variant_iter_next (iter, "{&sv}", &key, &value)) {
+			if (g_strcmp0 (key, "vendor") == 0)
+				vendor = g_variant_dup_string (value, NULL);
+			else if (g_strcmp0 (key, "guid") == 0)
+				guid = g_variant_dup_string (value, NULL);
+			else if (g_strcmp0 (key, "newer-than") == 0)
+				newer_than = g_variant_dup_string (value, NULL);
+			else if (g_strcmp0 (key, "flags") == 0)
+				flags_required = g_variant_get_uint64 (value);
+			else
+				g_debug ("ignoring unknown predicate %s", key);
+			g_variant_unref (value);
+		}
+		g_variant_iter_free (iter);
+		g_debug ("Called %s()", method_name);
+
+		g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sss)"));
+		for (guint i = 0; i < priv->devices->len; i++) {
+			AsApp *app;
+			AsRelease *release;
+			FuDeviceItem *item = g_ptr_array_index (priv->devices, i);
+			FwupdDevice *dev = fwupd_result_get_device (FWUPD_RESULT (item->device));
+			const gchar *version;
+			const gchar *version_new = "";
+
+			/* per-device predicates */
+			if (vendor != NULL &&
+			    g_strcmp0 (fwupd_device_get_vendor (dev), vendor) != 0)
+				continue;
+			if (guid != NULL && !fu_main_item_has_guid (item, guid))
+				continue;
+			if ((fu_device_get_flags (item->device) & flags_required) != flags_required)
+				continue;
+
+			/* the newest version in the metadata, found with the
+			 * same index probes GetUpdates uses */
+			version = fu_device_get_version (item->device);
+			app = fu_main_store_get_app_by_guids (priv, priv->store,
+							      item->device);
+			if (app != NULL) {
+				release = as_app_get_release_default (app);
+				if (release != NULL)
+					version_new = as_release_get_version (release);
+			}
+			if (newer_than != NULL &&
+			    (version_new[0] == '\0' ||
+			     as_utils_vercmp (version_new, newer_than) <= 0))
+				continue;
+
+			g_variant_builder_add (&builder, "(sss)",
+					       item->id,
+					       version != NULL ? version : "",
+					       version_new);
+		}
+		val = g_variant_new ("(a(sss))", &builder);
+		fu_main_invocation_return_value (priv, invocation, val);
 		return;
 	}
 
@@ -1970,11 +3846,13 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 			return;
 		}
 
-		/* call into the plugin */
+		/* call into the plugin, which copies the pending state
+		 * into the device */
 		if (!fu_plugin_runner_get_results (item->plugin, item->device, &error)) {
 			fu_main_invocation_return_error (priv, invocation, error);
 			return;
 		}
+		fu_main_item_invalidate_serialized (priv, item);
 
 		/* ensure the unique ID is set */
 		if (fwupd_result_get_unique_id (FWUPD_RESULT (item->device)) == NULL) {
@@ -2084,7 +3962,6 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 		FuDeviceItem *item = NULL;
 		FuMainAuthHelper *helper;
 		const gchar *id = NULL;
-		g_autoptr(PolkitSubject) subject = NULL;
 
 		/* check the id exists */
 		g_variant_get (parameters, "(&s)", &id);
@@ -2110,7 +3987,7 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 		}
 
 		/* process the firmware */
-		helper = g_new0 (FuMainAuthHelper, 1);
+		helper = g_slice_new0 (FuMainAuthHelper);
 		helper->auth_kind = FU_MAIN_AUTH_KIND_UNLOCK;
 		helper->invocation = g_object_ref (invocation);
 		helper->devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
@@ -2120,14 +3997,7 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 		g_ptr_array_add (helper->devices, g_object_ref (item->device));
 
 		/* authenticate */
-		subject = polkit_system_bus_name_new (sender);
-		polkit_authority_check_authorization (helper->priv->authority, subject,
-						      "org.freedesktop.fwupd.device-unlock",
-						      NULL,
-						      POLKIT_CHECK_AUTHORIZATION_FLAGS_ALLOW_USER_INTERACTION,
-						      NULL,
-						      fu_main_check_authorization_cb,
-						      helper);
+		fu_main_authorize (helper, sender, "org.freedesktop.fwupd.device-unlock");
 		return;
 	}
 
@@ -2136,7 +4006,6 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 		FuDeviceItem *item = NULL;
 		FuMainAuthHelper *helper;
 		const gchar *id = NULL;
-		g_autoptr(PolkitSubject) subject = NULL;
 
 		/* check the id exists */
 		g_variant_get (parameters, "(&s)", &id);
@@ -2152,7 +4021,7 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 		}
 
 		/* process the firmware */
-		helper = g_new0 (FuMainAuthHelper, 1);
+		helper = g_slice_new0 (FuMainAuthHelper);
 		helper->auth_kind = FU_MAIN_AUTH_KIND_VERIFY_UPDATE;
 		helper->invocation = g_object_ref (invocation);
 		helper->devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
@@ -2160,27 +4029,14 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 		g_ptr_array_add (helper->devices, g_object_ref (item->device));
 
 		/* authenticate */
-		subject = polkit_system_bus_name_new (sender);
-		polkit_authority_check_authorization (helper->priv->authority, subject,
-						      "org.freedesktop.fwupd.verify-update",
-						      NULL,
-						      POLKIT_CHECK_AUTHORIZATION_FLAGS_ALLOW_USER_INTERACTION,
-						      NULL,
-						      fu_main_check_authorization_cb,
-						      helper);
+		fu_main_authorize (helper, sender, "org.freedesktop.fwupd.verify-update");
 		return;
 	}
 
 	/* return 's' */
 	if (g_strcmp0 (method_name, "Verify") == 0) {
-		AsApp *app;
-		AsChecksum *csum;
-		AsRelease *release;
 		FuDeviceItem *item = NULL;
-		GPtrArray *checksums;
-		const gchar *hash = NULL;
 		const gchar *id = NULL;
-		const gchar *version = NULL;
 
 		/* check the id exists */
 		g_variant_get (parameters, "(&s)", &id);
@@ -2201,81 +4057,101 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 			fu_main_invocation_return_error (priv, invocation, error);
 			return;
 		}
+		fu_main_item_invalidate_serialized (priv, item);
 
-		/* find component in metadata */
-		app = fu_main_store_get_app_by_guids (priv->store, item->device);
-		if (app == NULL) {
-			g_set_error_literal (&error,
-					     FWUPD_ERROR,
-					     FWUPD_ERROR_NOT_FOUND,
-					     "No metadata");
+		/* check it against the metadata */
+		if (!fu_main_verify_item_checksum (priv, item, &error)) {
 			fu_main_invocation_return_error (priv, invocation, error);
 			return;
 		}
+		fu_main_invocation_return_value (priv, invocation, NULL);
+		return;
+	}
 
-		/* find version in metadata */
-		version = fu_device_get_version (item->device);
-		release = as_app_get_release (app, version);
-		if (release == NULL)
-			release = as_app_get_release_default (app);
-		if (release == NULL) {
-			g_set_error (&error,
-				     FWUPD_ERROR,
-				     FWUPD_ERROR_NOT_FOUND,
-				     "No version %s", version);
-			fu_main_invocation_return_error (priv, invocation, error);
-			return;
-		}
+	/* return 'a{ss}' */
+	if (g_strcmp0 (method_name, "VerifyAll") == 0) {
+		FuMainVerifyAllHelper *helper;
+		GHashTableIter iter;
+		GThreadPool *pool;
+		gpointer value;
+		g_autoptr(GError) error_pool = NULL;
+		g_autoptr(GHashTable) tasks = NULL;
 
-		/* find checksum */
-		csum = as_release_get_checksum_by_target (release, AS_CHECKSUM_TARGET_CONTENT);
-		if (csum == NULL) {
-			g_set_error (&error,
-				     FWUPD_ERROR,
-				     FWUPD_ERROR_NOT_FOUND,
-				     "No content checksum for %s", version);
+		g_debug ("Called %s()", method_name);
+
+		/* one sweep at a time; the per-plugin serialisation below
+		 * assumes nothing else is driving the plugins */
+		if (priv->verify_all_running) {
+			g_set_error_literal (&error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_ALREADY_PENDING,
+					     "a verification sweep is already in progress");
 			fu_main_invocation_return_error (priv, invocation, error);
 			return;
 		}
-
-		/* get the matching checksum */
-		checksums = fu_device_get_checksums (item->device);
-		if (checksums->len == 0) {
-			g_set_error (&error,
-				     FWUPD_ERROR,
-				     FWUPD_ERROR_NOT_FOUND,
-				     "No device checksums for %s", version);
+		if (priv->devices->len == 0) {
+			g_set_error_literal (&error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_NOTHING_TO_DO,
+					     "no devices to verify");
 			fu_main_invocation_return_error (priv, invocation, error);
 			return;
 		}
-		for (guint j = 0; j < checksums->len; j++) {
-			const gchar *hash_tmp = g_ptr_array_index (checksums, j);
-			GChecksumType hash_kind = fwupd_checksum_guess_kind (hash_tmp);
-			if (as_checksum_get_kind (csum) == hash_kind) {
-				hash = hash_tmp;
-				break;
+
+		/* resolve the metadata store once up-front; every comparison
+		 * in the sweep then hits the same cached instance instead of
+		 * racing to lazy-load it from the result callbacks */
+		fu_main_store_ensure (priv);
+
+		helper = g_slice_new0 (FuMainVerifyAllHelper);
+		helper->priv = priv;
+		helper->invocation = g_object_ref (invocation);
+		helper->results = g_hash_table_new_full (g_str_hash, g_str_equal,
+							 g_free, g_free);
+
+		/* group the devices by the plugin that owns them; each group
+		 * is one unit of work for the pool */
+		tasks = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+					       NULL, (GDestroyNotify) fu_main_verify_all_task_free);
+		for (guint i = 0; i < priv->devices->len; i++) {
+			FuDeviceItem *item = g_ptr_array_index (priv->devices, i);
+			FuMainVerifyAllTask *task;
+			task = g_hash_table_lookup (tasks, item->plugin);
+			if (task == NULL) {
+				task = g_slice_new0 (FuMainVerifyAllTask);
+				task->helper = helper;
+				task->plugin = g_object_ref (item->plugin);
+				task->devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+				g_hash_table_insert (tasks, item->plugin, task);
 			}
+			g_ptr_array_add (task->devices, g_object_ref (item->device));
+			helper->cnt_pending++;
 		}
-		if (hash == NULL) {
+
+		pool = g_thread_pool_new (fu_main_verify_all_thread_cb, helper,
+					  (gint) MIN (g_hash_table_size (tasks),
+						      g_get_num_processors ()),
+					  FALSE, &error_pool);
+		if (pool == NULL) {
 			g_set_error (&error,
 				     FWUPD_ERROR,
-				     FWUPD_ERROR_NOT_FOUND,
-				     "No matching hash kind for %s", version);
+				     FWUPD_ERROR_INTERNAL,
+				     "failed to create verify pool: %s",
+				     error_pool->message);
+			g_hash_table_unref (helper->results);
+			g_object_unref (helper->invocation);
+			g_slice_free (FuMainVerifyAllHelper, helper);
 			fu_main_invocation_return_error (priv, invocation, error);
 			return;
 		}
-		if (g_strcmp0 (as_checksum_get_value (csum), hash) != 0) {
-			g_set_error (&error,
-				     FWUPD_ERROR,
-				     FWUPD_ERROR_NOT_FOUND,
-				     "For v%s expected %s, got %s",
-				     version,
-				     as_checksum_get_value (csum),
-				     hash);
-			fu_main_invocation_return_error (priv, invocation, error);
-			return;
+		helper->pool = pool;
+		priv->verify_all_running = TRUE;
+		fu_main_set_status (priv, FWUPD_STATUS_DEVICE_VERIFY);
+		g_hash_table_iter_init (&iter, tasks);
+		while (g_hash_table_iter_next (&iter, NULL, &value)) {
+			g_hash_table_iter_steal (&iter);
+			g_thread_pool_push (pool, value, NULL);
 		}
-		fu_main_invocation_return_value (priv, invocation, NULL);
 		return;
 	}
 
@@ -2292,10 +4168,8 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 		gchar *prop_key;
 		gint32 fd_handle = 0;
 		gint fd;
-		g_autoptr(PolkitSubject) subject = NULL;
 		g_autoptr(GVariantIter) iter = NULL;
 		g_autoptr(GBytes) blob_cab = NULL;
-		g_autoptr(GInputStream) stream = NULL;
 
 		/* check the id exists */
 		g_variant_get (parameters, "(&sha{sv})", &id, &fd_handle, &iter);
@@ -2306,10 +4180,134 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 				g_set_error (&error,
 					     FWUPD_ERROR,
 					     FWUPD_ERROR_NOT_FOUND,
-					     "no such device %s", id);
+					     "no such device %s", id);
+				fu_main_invocation_return_error (priv, invocation, error);
+				return;
+			}
+		}
+
+		/* get options */
+		while (g_variant_iter_next (iter, "{&sv}",
+					    &prop_key, &prop_value)) {
+			g_debug ("got option %s", prop_key);
+			if (g_strcmp0 (prop_key, "offline") == 0 &&
+			    g_variant_get_boolean (prop_value) == TRUE)
+				flags |= FWUPD_INSTALL_FLAG_OFFLINE;
+			if (g_strcmp0 (prop_key, "allow-older") == 0 &&
+			    g_variant_get_boolean (prop_value) == TRUE)
+				flags |= FWUPD_INSTALL_FLAG_ALLOW_OLDER;
+			if (g_strcmp0 (prop_key, "allow-reinstall") == 0 &&
+			    g_variant_get_boolean (prop_value) == TRUE)
+				flags |= FWUPD_INSTALL_FLAG_ALLOW_REINSTALL;
+			if (g_strcmp0 (prop_key, "force") == 0 &&
+			    g_variant_get_boolean (prop_value) == TRUE)
+				flags |= FWUPD_INSTALL_FLAG_FORCE;
+			g_variant_unref (prop_value);
+		}
+
+		/* get the fd */
+		message = g_dbus_method_invocation_get_message (invocation);
+		fd_list = g_dbus_message_get_unix_fd_list (message);
+		if (fd_list == NULL || g_unix_fd_list_get_length (fd_list) != 1) {
+			g_set_error (&error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INTERNAL,
+				     "invalid handle");
+			fu_main_invocation_return_error (priv, invocation, error);
+			return;
+		}
+		fd = g_unix_fd_list_get (fd_list, 0, &error);
+		if (fd < 0) {
+			fu_main_invocation_return_error (priv, invocation, error);
+			return;
+		}
+
+		/* spool the fd to a file-backed mapping in bounded chunks */
+		blob_cab = fu_main_spool_fd_to_bytes (fd, &error);
+		if (blob_cab == NULL){
+			fu_main_invocation_return_error (priv, invocation, error);
+			return;
+		}
+
+		/* process the firmware */
+		helper = g_slice_new0 (FuMainAuthHelper);
+		helper->auth_kind = FU_MAIN_AUTH_KIND_INSTALL;
+		helper->invocation = g_object_ref (invocation);
+		helper->trust_flags = FWUPD_TRUST_FLAG_NONE;
+		helper->blob_cab = g_bytes_ref (blob_cab);
+		helper->flags = flags;
+		helper->priv = priv;
+		helper->store = as_store_new ();
+		helper->devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+		helper->blob_fws = g_ptr_array_new_with_free_func ((GDestroyNotify) g_bytes_unref);
+		if (item != NULL)
+			g_ptr_array_add (helper->devices, g_object_ref (item->device));
+		if (!fu_main_update_helper (helper, &error)) {
+			fu_main_invocation_return_error (helper->priv, helper->invocation, error);
+			fu_main_helper_free (helper);
+			return;
+		}
+
+		/* is root */
+		if (fu_main_dbus_get_uid (priv, sender) == 0) {
+			if (!fu_main_plugin_update_authenticated (helper, &error)) {
+				fu_main_invocation_return_error (priv, invocation, error);
+			} else {
+				fu_main_invocation_return_value (priv, invocation, NULL);
+			}
+			fu_main_helper_free (helper);
+			return;
+		}
+
+		/* authenticate */
+		action_id = fu_main_get_action_id_for_device (helper);
+		fu_main_authorize (helper, sender, action_id);
+		return;
+	}
+
+	/* return '' */
+	if (g_strcmp0 (method_name, "InstallMultiple") == 0) {
+		FuMainAuthHelper *helper;
+		FwupdInstallFlags flags = FWUPD_INSTALL_FLAG_NONE;
+		GDBusMessage *message;
+		GUnixFDList *fd_list;
+		GVariant *prop_value;
+		const gchar *action_id;
+		gchar *prop_key;
+		gint32 fd_handle = 0;
+		gint fd;
+		g_autofree const gchar **ids = NULL;
+		g_autoptr(GPtrArray) items = NULL;
+		g_autoptr(GVariant) ids_val = NULL;
+		g_autoptr(GVariantIter) iter = NULL;
+		g_autoptr(GBytes) blob_cab = NULL;
+
+		/* check all the ids exist before spooling anything */
+		g_variant_get (parameters, "(@asha{sv})",
+			       &ids_val, &fd_handle, &iter);
+		ids = g_variant_get_strv (ids_val, NULL);
+		g_debug ("Called %s(%u ids,%i)", method_name,
+			 (guint) g_strv_length ((gchar **) ids), fd_handle);
+		if (ids[0] == NULL) {
+			g_set_error_literal (&error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_INVALID_ARGS,
+					     "no device ids specified");
+			fu_main_invocation_return_error (priv, invocation, error);
+			return;
+		}
+		items = g_ptr_array_new ();
+		for (guint i = 0; ids[i] != NULL; i++) {
+			FuDeviceItem *item = fu_main_get_item_by_id (priv, ids[i]);
+			if (item == NULL) {
+				g_set_error (&error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_NOT_FOUND,
+					     "no such device %s", ids[i]);
 				fu_main_invocation_return_error (priv, invocation, error);
 				return;
 			}
+			g_ptr_array_add (items, item);
 		}
 
 		/* get options */
@@ -2331,7 +4329,8 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 			g_variant_unref (prop_value);
 		}
 
-		/* get the fd */
+		/* get the fd; the payload crosses the bus exactly once no
+		 * matter how many devices it is installed to */
 		message = g_dbus_method_invocation_get_message (invocation);
 		fd_list = g_dbus_message_get_unix_fd_list (message);
 		if (fd_list == NULL || g_unix_fd_list_get_length (fd_list) != 1) {
@@ -2348,18 +4347,16 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 			return;
 		}
 
-		/* read the entire fd to a data blob */
-		stream = g_unix_input_stream_new (fd, TRUE);
-		blob_cab = g_input_stream_read_bytes (stream,
-						      FU_MAIN_FIRMWARE_SIZE_MAX,
-						      NULL, &error);
+		/* spool the fd to a file-backed mapping in bounded chunks */
+		blob_cab = fu_main_spool_fd_to_bytes (fd, &error);
 		if (blob_cab == NULL){
 			fu_main_invocation_return_error (priv, invocation, error);
 			return;
 		}
 
-		/* process the firmware */
-		helper = g_new0 (FuMainAuthHelper, 1);
+		/* process the firmware; signature checking and decompression
+		 * happen once for the whole batch */
+		helper = g_slice_new0 (FuMainAuthHelper);
 		helper->auth_kind = FU_MAIN_AUTH_KIND_INSTALL;
 		helper->invocation = g_object_ref (invocation);
 		helper->trust_flags = FWUPD_TRUST_FLAG_NONE;
@@ -2369,8 +4366,10 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 		helper->store = as_store_new ();
 		helper->devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 		helper->blob_fws = g_ptr_array_new_with_free_func ((GDestroyNotify) g_bytes_unref);
-		if (item != NULL)
+		for (guint i = 0; i < items->len; i++) {
+			FuDeviceItem *item = g_ptr_array_index (items, i);
 			g_ptr_array_add (helper->devices, g_object_ref (item->device));
+		}
 		if (!fu_main_update_helper (helper, &error)) {
 			fu_main_invocation_return_error (helper->priv, helper->invocation, error);
 			fu_main_helper_free (helper);
@@ -2388,16 +4387,10 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 			return;
 		}
 
-		/* authenticate */
+		/* authenticate once for the whole batch; the action id is
+		 * already chosen from the least-trusted member */
 		action_id = fu_main_get_action_id_for_device (helper);
-		subject = polkit_system_bus_name_new (sender);
-		polkit_authority_check_authorization (helper->priv->authority, subject,
-						      action_id,
-						      NULL,
-						      POLKIT_CHECK_AUTHORIZATION_FLAGS_ALLOW_USER_INTERACTION,
-						      NULL,
-						      fu_main_check_authorization_cb,
-						      helper);
+		fu_main_authorize (helper, sender, action_id);
 		return;
 	}
 
@@ -2429,13 +4422,8 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 			return;
 		}
 
-		/* get details about the file */
-		val = fu_main_get_details_from_fd (priv, fd, &error);
-		if (val == NULL) {
-			fu_main_invocation_return_error (priv, invocation, error);
-			return;
-		}
-		fu_main_invocation_return_value (priv, invocation, val);
+		/* get details about the file on a worker thread */
+		fu_main_get_details_async (priv, invocation, fd, FALSE);
 		return;
 	}
 
@@ -2467,13 +4455,8 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 			return;
 		}
 
-		/* get details about the file */
-		val = fu_main_get_details_local_from_fd (priv, fd, &error);
-		if (val == NULL) {
-			fu_main_invocation_return_error (priv, invocation, error);
-			return;
-		}
-		fu_main_invocation_return_value (priv, invocation, val);
+		/* get details about the file on a worker thread */
+		fu_main_get_details_async (priv, invocation, fd, TRUE);
 		return;
 	}
 
@@ -2499,6 +4482,9 @@ fu_main_daemon_get_property (GDBusConnection *connection_, const gchar *sender,
 	if (g_strcmp0 (property_name, "Status") == 0)
 		return g_variant_new_uint32 (priv->status);
 
+	if (g_strcmp0 (property_name, "ColdplugPercentage") == 0)
+		return g_variant_new_uint32 (priv->coldplug_percentage);
+
 	/* return an error */
 	g_set_error (error,
 		     G_DBUS_ERROR,
@@ -2517,6 +4503,7 @@ fu_main_plugins_setup (FuMainPrivate *priv)
 	g_assert (ptask != NULL);
 	for (guint i = 0; i < priv->plugins->len; i++) {
 		g_autoptr(GError) error = NULL;
+		gint64 timing = fu_debug_timing_start ();
 		g_autoptr(AsProfileTask) ptask2 = NULL;
 		FuPlugin *plugin = g_ptr_array_index (priv->plugins, i);
 		ptask2 = as_profile_start (priv->profile,
@@ -2527,13 +4514,72 @@ fu_main_plugins_setup (FuMainPrivate *priv)
 			fu_plugin_set_enabled (plugin, FALSE);
 			g_warning ("disabling plugin because: %s", error->message);
 		}
+		fu_debug_timing_end (timing, "startup{%s}",
+				     fu_plugin_get_name (plugin));
+	}
+}
+
+typedef struct {
+	FuMainPrivate		*priv;
+	GMutex			 mutex;
+	GCond			 cond;
+	GHashTable		*done;		/* plugin name : 1 */
+	guint			 cnt_pending;
+} FuMainColdplugCtx;
+
+static void
+fu_main_plugin_coldplug_thread_cb (gpointer data, gpointer user_data)
+{
+	FuPlugin *plugin = FU_PLUGIN (data);
+	FuMainColdplugCtx *ctx = (FuMainColdplugCtx *) user_data;
+	gint64 timing = fu_debug_timing_start ();
+	g_autoptr(GError) error = NULL;
+
+	if (!fu_plugin_runner_coldplug (plugin, &error)) {
+		fu_plugin_set_enabled (plugin, FALSE);
+		g_warning ("disabling plugin because: %s", error->message);
+	}
+
+	fu_debug_timing_end (timing, "coldplug{%s}", fu_plugin_get_name (plugin));
+
+	/* mark as done and wake up the scheduler */
+	g_mutex_lock (&ctx->mutex);
+	g_hash_table_insert (ctx->done,
+			     g_strdup (fu_plugin_get_name (plugin)),
+			     GINT_TO_POINTER (1));
+	ctx->cnt_pending--;
+	fu_main_set_coldplug_percentage (ctx->priv,
+					 g_hash_table_size (ctx->done) * 100 /
+					 ctx->priv->plugins->len);
+	g_cond_broadcast (&ctx->cond);
+	g_mutex_unlock (&ctx->mutex);
+}
+
+static gboolean
+fu_main_plugin_coldplug_deps_done (FuPlugin *plugin, FuMainColdplugCtx *ctx)
+{
+	GPtrArray *deps = fu_plugin_get_coldplug_dependencies (plugin);
+	for (guint i = 0; i < deps->len; i++) {
+		const gchar *name = g_ptr_array_index (deps, i);
+		FuPlugin *dep = g_hash_table_lookup (ctx->priv->plugins_hash, name);
+
+		/* nonexistent or disabled plugins cannot hold us up */
+		if (dep == NULL || !fu_plugin_get_enabled (dep))
+			continue;
+		if (g_hash_table_lookup (ctx->done, name) == NULL)
+			return FALSE;
 	}
+	return TRUE;
 }
 
 static void
 fu_main_plugins_coldplug (FuMainPrivate *priv)
 {
+	FuMainColdplugCtx ctx;
 	g_autoptr(AsProfileTask) ptask = NULL;
+	g_autoptr(GError) error_pool = NULL;
+	g_autoptr(GHashTable) started = NULL;
+	GThreadPool *pool;
 
 	/* don't allow coldplug to be scheduled when in coldplug */
 	priv->coldplug_running = TRUE;
@@ -2552,22 +4598,79 @@ fu_main_plugins_coldplug (FuMainPrivate *priv)
 		g_usleep (priv->coldplug_delay * 1000);
 	}
 
-	/* exec */
+	/* exec: each plugin probes independent hardware, so dispatch onto a
+	 * thread pool and only serialize plugins that declared a dependency
+	 * with fu_plugin_add_coldplug_dependency() */
 	ptask = as_profile_start_literal (priv->profile, "FuMain:coldplug");
 	g_assert (ptask != NULL);
-	for (guint i = 0; i < priv->plugins->len; i++) {
-		g_autoptr(GError) error = NULL;
-		g_autoptr(AsProfileTask) ptask2 = NULL;
-		FuPlugin *plugin = g_ptr_array_index (priv->plugins, i);
-		ptask2 = as_profile_start (priv->profile,
-					   "FuMain:coldplug{%s}",
-					   fu_plugin_get_name (plugin));
-		g_assert (ptask2 != NULL);
-		if (!fu_plugin_runner_coldplug (plugin, &error)) {
-			fu_plugin_set_enabled (plugin, FALSE);
-			g_warning ("disabling plugin because: %s", error->message);
+	g_mutex_init (&ctx.mutex);
+	g_cond_init (&ctx.cond);
+	ctx.priv = priv;
+	ctx.done = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	ctx.cnt_pending = 0;
+	started = g_hash_table_new (g_direct_hash, g_direct_equal);
+	pool = g_thread_pool_new (fu_main_plugin_coldplug_thread_cb, &ctx,
+				  (gint) g_get_num_processors (),
+				  FALSE, &error_pool);
+	if (pool == NULL) {
+		/* fall back to the old serial behaviour */
+		g_warning ("failed to create coldplug pool: %s",
+			   error_pool->message);
+		for (guint i = 0; i < priv->plugins->len; i++) {
+			FuPlugin *plugin = g_ptr_array_index (priv->plugins, i);
+			fu_main_plugin_coldplug_thread_cb (plugin, &ctx);
+		}
+	} else {
+		g_mutex_lock (&ctx.mutex);
+		while (g_hash_table_size (ctx.done) < priv->plugins->len) {
+			gboolean any_dispatched = FALSE;
+			for (guint pass = 0; pass < 2; pass++) {
+				/* plugins that blew their runtime budget are
+				 * only dispatched once nothing healthy is
+				 * runnable or in flight, so a wedged device
+				 * cannot hold everybody else back */
+				if (pass == 1 &&
+				    (any_dispatched || ctx.cnt_pending > 0))
+					break;
+				for (guint i = 0; i < priv->plugins->len; i++) {
+					FuPlugin *plugin = g_ptr_array_index (priv->plugins, i);
+					if (g_hash_table_lookup (started, plugin) != NULL)
+						continue;
+					if (fu_plugin_get_deprioritized (plugin) != (pass == 1))
+						continue;
+					if (!fu_main_plugin_coldplug_deps_done (plugin, &ctx))
+						continue;
+					g_hash_table_insert (started, plugin,
+							     GINT_TO_POINTER (1));
+					ctx.cnt_pending++;
+					g_thread_pool_push (pool, plugin, NULL);
+					any_dispatched = TRUE;
+				}
+			}
+
+			/* a dependency cycle means nothing can be pushed and
+			 * nothing is in flight; run the stragglers serially */
+			if (!any_dispatched && ctx.cnt_pending == 0) {
+				g_warning ("coldplug dependency cycle detected");
+				for (guint i = 0; i < priv->plugins->len; i++) {
+					FuPlugin *plugin = g_ptr_array_index (priv->plugins, i);
+					if (g_hash_table_lookup (started, plugin) != NULL)
+						continue;
+					g_hash_table_insert (started, plugin,
+							     GINT_TO_POINTER (1));
+					ctx.cnt_pending++;
+					g_thread_pool_push (pool, plugin, NULL);
+				}
+			}
+			if (g_hash_table_size (ctx.done) < priv->plugins->len)
+				g_cond_wait (&ctx.cond, &ctx.mutex);
 		}
+		g_mutex_unlock (&ctx.mutex);
+		g_thread_pool_free (pool, FALSE, TRUE);
 	}
+	g_hash_table_unref (ctx.done);
+	g_cond_clear (&ctx.cond);
+	g_mutex_clear (&ctx.mutex);
 
 	/* cleanup */
 	for (guint i = 0; i < priv->plugins->len; i++) {
@@ -2581,6 +4684,114 @@ fu_main_plugins_coldplug (FuMainPrivate *priv)
 	priv->coldplug_running = FALSE;
 }
 
+static void
+fu_main_name_owner_changed_cb (GDBusConnection *connection,
+			       const gchar *sender_name,
+			       const gchar *object_path,
+			       const gchar *interface_name,
+			       const gchar *signal_name,
+			       GVariant *parameters,
+			       gpointer user_data)
+{
+	FuMainPrivate *priv = (FuMainPrivate *) user_data;
+	GHashTableIter iter;
+	const gchar *name = NULL;
+	const gchar *old_owner = NULL;
+	const gchar *new_owner = NULL;
+	gpointer key;
+
+	/* only care about names leaving the bus */
+	g_variant_get (parameters, "(&s&s&s)", &name, &old_owner, &new_owner);
+	if (new_owner[0] != '\0')
+		return;
+
+	/* the sender is gone, forget any cached authorizations it held */
+	g_hash_table_iter_init (&iter, priv->auth_cache);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		const gchar *tmp = (const gchar *) key;
+		if (g_str_has_prefix (tmp, name) &&
+		    tmp[strlen (name)] == ':')
+			g_hash_table_iter_remove (&iter);
+	}
+}
+
+static void
+fu_main_private_connection_closed_cb (GDBusConnection *connection,
+				      gboolean remote_peer_vanished,
+				      GError *error,
+				      gpointer user_data)
+{
+	FuMainPrivate *priv = (FuMainPrivate *) user_data;
+	g_debug ("FuMain: private socket connection closed");
+	g_ptr_array_remove (priv->private_conns, connection);
+}
+
+static gboolean
+fu_main_private_server_new_connection_cb (GDBusServer *server,
+					  GDBusConnection *connection,
+					  gpointer user_data)
+{
+	FuMainPrivate *priv = (FuMainPrivate *) user_data;
+	guint registration_id;
+	static const GDBusInterfaceVTable interface_vtable = {
+		fu_main_daemon_method_call,
+		fu_main_daemon_get_property,
+		NULL
+	};
+
+	registration_id = g_dbus_connection_register_object (connection,
+							     FWUPD_DBUS_PATH,
+							     fu_dbus_interfaces[0],
+							     &interface_vtable,
+							     priv,  /* user_data */
+							     NULL,  /* user_data_free_func */
+							     NULL); /* GError** */
+	if (registration_id == 0)
+		return FALSE;
+	g_signal_connect (connection, "closed",
+			  G_CALLBACK (fu_main_private_connection_closed_cb), priv);
+	g_ptr_array_add (priv->private_conns, g_object_ref (connection));
+	g_debug ("FuMain: new private socket connection");
+	return TRUE;
+}
+
+static void
+fu_main_private_server_setup (FuMainPrivate *priv)
+{
+	g_autofree gchar *address = NULL;
+	g_autofree gchar *guid = NULL;
+	g_autofree gchar *socket_path = NULL;
+	g_autoptr(GError) error = NULL;
+
+	/* opt-in, for local high-frequency callers that want to skip the
+	 * dbus-daemon round-trips; access control is purely the filesystem
+	 * permissions on the socket itself */
+	socket_path = g_key_file_get_string (priv->config, "fwupd",
+					     "PrivateSocket", NULL);
+	if (socket_path == NULL || socket_path[0] == '\0')
+		return;
+	g_unlink (socket_path);
+	address = g_strdup_printf ("unix:path=%s", socket_path);
+	guid = g_dbus_generate_guid ();
+	priv->private_server = g_dbus_server_new_sync (address,
+						       G_DBUS_SERVER_FLAGS_NONE,
+						       guid,
+						       NULL, /* GDBusAuthObserver */
+						       NULL, /* GCancellable */
+						       &error);
+	if (priv->private_server == NULL) {
+		g_warning ("failed to listen on %s: %s",
+			   socket_path, error->message);
+		return;
+	}
+	priv->private_conns = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	g_signal_connect (priv->private_server, "new-connection",
+			  G_CALLBACK (fu_main_private_server_new_connection_cb),
+			  priv);
+	g_dbus_server_start (priv->private_server);
+	g_debug ("FuMain: listening on private socket %s", socket_path);
+}
+
 static void
 fu_main_on_bus_acquired_cb (GDBusConnection *connection,
 			    const gchar *name,
@@ -2596,9 +4807,22 @@ fu_main_on_bus_acquired_cb (GDBusConnection *connection,
 	};
 
 	priv->connection = g_object_ref (connection);
+
+	/* drop cached polkit authorizations when a sender disconnects */
+	priv->auth_owner_sub_id =
+		g_dbus_connection_signal_subscribe (connection,
+						    "org.freedesktop.DBus",
+						    "org.freedesktop.DBus",
+						    "NameOwnerChanged",
+						    "/org/freedesktop/DBus",
+						    NULL,
+						    G_DBUS_SIGNAL_FLAGS_NONE,
+						    fu_main_name_owner_changed_cb,
+						    priv, NULL);
+
 	registration_id = g_dbus_connection_register_object (connection,
 							     FWUPD_DBUS_PATH,
-							     priv->introspection_daemon->interfaces[0],
+							     fu_dbus_interfaces[0],
 							     &interface_vtable,
 							     priv,  /* user_data */
 							     NULL,  /* user_data_free_func */
@@ -2652,23 +4876,48 @@ fu_main_timed_exit_cb (gpointer user_data)
 	return G_SOURCE_REMOVE;
 }
 
-static GDBusNodeInfo *
-fu_main_load_introspection (const gchar *filename, GError **error)
+static gpointer
+fu_main_shutdown_flush_thread_cb (gpointer user_data)
 {
-	g_autoptr(GBytes) data = NULL;
-	g_autofree gchar *path = NULL;
+	FuMainPrivate *priv = (FuMainPrivate *) user_data;
+	g_autoptr(GError) error = NULL;
 
-	/* lookup data */
-	path = g_build_filename ("/org/freedesktop/fwupd", filename, NULL);
-	data = g_resource_lookup_data (fu_get_resource (),
-				       path,
-				       G_RESOURCE_LOOKUP_FLAGS_NONE,
-				       error);
-	if (data == NULL)
-		return NULL;
+	if (!fu_pending_shutdown_flush (priv->pending, &error))
+		g_warning ("failed to flush pending database: %s", error->message);
+
+	/* skip the free-before-exit walk; everything still allocated is
+	 * process-lifetime and the kernel reclaims it faster than we can */
+	_exit (0);
+	return NULL;
+}
+
+static gboolean
+fu_main_shutdown_watchdog_cb (gpointer user_data)
+{
+	g_warning ("shutdown flush overran its budget, exiting anyway");
+	_exit (0);
+	return G_SOURCE_REMOVE;
+}
+
+static gboolean
+fu_main_sigterm_cb (gpointer user_data)
+{
+	FuMainPrivate *priv = (FuMainPrivate *) user_data;
+
+	/* release the name first so new requests fail over to activation
+	 * rather than queueing against a daemon that is going away */
+	g_debug ("SIGTERM, flushing state to disk");
+	if (priv->owner_id != 0) {
+		g_bus_unown_name (priv->owner_id);
+		priv->owner_id = 0;
+	}
 
-	/* build introspection from XML */
-	return g_dbus_node_info_new_for_xml (g_bytes_get_data (data, NULL), error);
+	/* checkpoint the pending database off the main thread, with a hard
+	 * deadline so a stuck disk cannot stall the host shutdown */
+	g_timeout_add (FU_MAIN_SHUTDOWN_BUDGET_MS,
+		       fu_main_shutdown_watchdog_cb, NULL);
+	g_thread_new ("shutdown-flush", fu_main_shutdown_flush_thread_cb, priv);
+	return G_SOURCE_REMOVE;
 }
 
 static void
@@ -2709,17 +4958,17 @@ fu_main_plugin_device_added_cb (FuPlugin *plugin,
 	item = fu_main_get_item_by_id (priv, fu_device_get_id (device));
 	if (item != NULL) {
 		g_debug ("already added %s by %s, ignoring same device from %s",
-			 fu_device_get_id (item->device),
+			 item->id,
 			 fu_device_get_plugin (item->device),
 			 fu_plugin_get_name (plugin));
 		return;
 	}
 
 	/* create new device */
-	item = g_new0 (FuDeviceItem, 1);
+	item = g_slice_new0 (FuDeviceItem);
 	item->device = g_object_ref (device);
 	item->plugin = g_object_ref (plugin);
-	g_ptr_array_add (priv->devices, item);
+	fu_main_item_add (priv, item);
 
 	/* match the metadata at this point so clients can tell if the
 	 * device is worthy */
@@ -2754,7 +5003,7 @@ fu_main_plugin_device_removed_cb (FuPlugin *plugin,
 
 	/* make the UI update */
 	fu_main_emit_device_removed (priv, device);
-	g_ptr_array_remove (priv->devices, item);
+	fu_main_item_remove (priv, item);
 	fu_main_emit_changed (priv);
 }
 
@@ -2773,6 +5022,23 @@ fu_main_plugin_percentage_changed_cb (FuPlugin *plugin,
 					gpointer user_data)
 {
 	FuMainPrivate *priv = (FuMainPrivate *) user_data;
+
+	/* compose member-device progress into one session percentage
+	 * weighted by payload size, so a composite update does not jump
+	 * back to zero every time the next plugin starts reporting */
+	if (priv->session_active) {
+		guint session_pc;
+		guint64 done_bytes = priv->session_done_bytes +
+			priv->session_device_bytes * MIN (percentage, 100) / 100;
+		session_pc = (guint) (done_bytes * 100 / priv->session_total_bytes);
+
+		/* never go backwards inside one session */
+		if (session_pc < priv->session_percentage)
+			session_pc = priv->session_percentage;
+		priv->session_percentage = session_pc;
+		fu_main_set_percentage (priv, session_pc);
+		return;
+	}
 	fu_main_set_percentage (priv, percentage);
 }
 
@@ -2796,6 +5062,12 @@ fu_main_plugin_recoldplug_cb (FuPlugin *plugin, FuMainPrivate *priv)
 	g_debug ("scheduling a recoldplug");
 	if (priv->coldplug_id != 0)
 		g_source_remove (priv->coldplug_id);
+	if (priv->changed_coalesce_id != 0) {
+		g_source_remove (priv->changed_coalesce_id);
+		priv->changed_coalesce_id = 0;
+	}
+	if (priv->changed_ids != NULL)
+		g_ptr_array_set_size (priv->changed_ids, 0);
 	priv->coldplug_id = g_timeout_add (1500, fu_main_recoldplug_delay_cb, priv);
 }
 
@@ -2807,14 +5079,136 @@ fu_main_plugin_set_coldplug_delay_cb (FuPlugin *plugin, guint duration, FuMainPr
 		 duration, priv->coldplug_delay);
 }
 
+static gboolean
+fu_main_hwids_cache_load (FuMainPrivate *priv,
+			  const gchar *checksum,
+			  GError **error)
+{
+	GVariantIter iter;
+	const gchar *checksum_tmp = NULL;
+	const gchar *guid;
+	guint32 version = 0;
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GMappedFile) mmap = NULL;
+	g_autoptr(GVariant) guids = NULL;
+	g_autoptr(GVariant) variant = NULL;
+
+	mmap = g_mapped_file_new (FU_MAIN_HWIDS_CACHE, FALSE, error);
+	if (mmap == NULL)
+		return FALSE;
+	bytes = g_mapped_file_get_bytes (mmap);
+	variant = g_variant_new_from_bytes (G_VARIANT_TYPE ("(usas)"),
+					    bytes, FALSE);
+	if (variant == NULL) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_INVALID_DATA,
+			     "%s is not a HWID cache",
+			     FU_MAIN_HWIDS_CACHE);
+		return FALSE;
+	}
+	g_variant_get (variant, "(u&s@as)", &version, &checksum_tmp, &guids);
+	if (version != FU_MAIN_HWIDS_CACHE_VERSION) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_INVALID_DATA,
+			     "cache version %u, expected %u",
+			     version, FU_MAIN_HWIDS_CACHE_VERSION);
+		return FALSE;
+	}
+	if (g_strcmp0 (checksum_tmp, checksum) != 0) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_INVALID_DATA,
+			     "cache checksum %s, expected %s",
+			     checksum_tmp, checksum);
+		return FALSE;
+	}
+	g_variant_iter_init (&iter, guids);
+	while (g_variant_iter_next (&iter, "&s", &guid)) {
+		g_hash_table_insert (priv->hwids,
+				     g_strdup (guid),
+				     GUINT_TO_POINTER (1));
+	}
+	return TRUE;
+}
+
+static gboolean
+fu_main_hwids_cache_save (FuMainPrivate *priv,
+			  const gchar *checksum,
+			  GError **error)
+{
+	GVariantBuilder builder;
+	g_autofree gchar *dirname = NULL;
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GList) guids = NULL;
+	g_autoptr(GVariant) variant = NULL;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("as"));
+	guids = g_hash_table_get_keys (priv->hwids);
+	for (GList *l = guids; l != NULL; l = l->next)
+		g_variant_builder_add (&builder, "s", l->data);
+	variant = g_variant_ref_sink (g_variant_new ("(usas)",
+						     (guint32) FU_MAIN_HWIDS_CACHE_VERSION,
+						     checksum,
+						     &builder));
+
+	/* ensure directory exists */
+	dirname = g_path_get_dirname (FU_MAIN_HWIDS_CACHE);
+	if (g_mkdir_with_parents (dirname, 0755) != 0) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_FAILED,
+			     "failed to create %s", dirname);
+		return FALSE;
+	}
+
+	bytes = g_variant_get_data_as_bytes (variant);
+	return g_file_set_contents (FU_MAIN_HWIDS_CACHE,
+				    g_bytes_get_data (bytes, NULL),
+				    (gssize) g_bytes_get_size (bytes),
+				    error);
+}
+
+static void
+fu_main_hwids_cache_invalidate (void)
+{
+	/* the system firmware was just modified, so the SMBIOS values and
+	 * therefore the HWIDs may be different on next boot */
+	if (g_unlink (FU_MAIN_HWIDS_CACHE) == 0)
+		g_debug ("removed %s", FU_MAIN_HWIDS_CACHE);
+}
+
 static gboolean
 fu_main_load_hwids (FuMainPrivate *priv, GError **error)
 {
+	g_autofree gchar *checksum = NULL;
 	g_autoptr(FuHwids) hwids = fu_hwids_new ();
 
-	/* read files in /sys */
-	if (!fu_hwids_setup (hwids, NULL, error))
-		return FALSE;
+	/* use the shared SMBIOS parse, falling back to the per-file
+	 * sysfs reads when the DMI table was not available */
+	if (priv->smbios != NULL) {
+		if (!fu_hwids_setup_from_smbios (hwids, priv->smbios, error))
+			return FALSE;
+	} else {
+		if (!fu_hwids_setup (hwids, NULL, error))
+			return FALSE;
+	}
+
+	/* load the cached GUIDs with one read; the cache is keyed by a hash
+	 * of the DMI strings so it goes stale only on a firmware update */
+	checksum = fu_hwids_get_checksum (hwids);
+	if (checksum != NULL) {
+		g_autoptr(GError) error_cache = NULL;
+		if (fu_main_hwids_cache_load (priv, checksum, &error_cache)) {
+			g_debug ("loaded %u HWIDs from %s",
+				 g_hash_table_size (priv->hwids),
+				 FU_MAIN_HWIDS_CACHE);
+			return TRUE;
+		}
+		g_debug ("failed to load %s: %s",
+			 FU_MAIN_HWIDS_CACHE, error_cache->message);
+	}
 
 	/* add GUIDs */
 	for (guint i = 0; i < 15; i++) {
@@ -2839,15 +5233,38 @@ fu_main_load_hwids (FuMainPrivate *priv, GError **error)
 		g_debug ("{%s}   <- %s", guid, values);
 	}
 
+	/* save for next boot */
+	if (checksum != NULL) {
+		g_autoptr(GError) error_cache = NULL;
+		if (!fu_main_hwids_cache_save (priv, checksum, &error_cache)) {
+			g_warning ("failed to save %s: %s",
+				   FU_MAIN_HWIDS_CACHE, error_cache->message);
+		}
+	}
+
 	return TRUE;
 }
 
+/* the plugin derives its name the same way in fu_plugin_open() */
+static gchar *
+fu_main_get_plugin_name_for_filename (const gchar *filename)
+{
+	const gchar *str = g_strstr_len (filename, -1, "libfu_plugin_");
+	gchar *name;
+	if (str == NULL)
+		return NULL;
+	name = g_strdup (str + 13);
+	g_strdelimit (name, ".", '\0');
+	return name;
+}
+
 static gboolean
 fu_main_load_plugins (FuMainPrivate *priv, GError **error)
 {
 	const gchar *fn;
 	g_autoptr(GDir) dir = NULL;
 	g_auto(GStrv) blacklist = NULL;
+	g_auto(GStrv) whitelist = NULL;
 
 	/* get plugin blacklist */
 	blacklist = g_key_file_get_string_list (priv->config,
@@ -2856,12 +5273,22 @@ fu_main_load_plugins (FuMainPrivate *priv, GError **error)
 						NULL, /* length */
 						NULL);
 
+	/* an optional whitelist; when set only the named plugins are loaded */
+	whitelist = g_key_file_get_string_list (priv->config,
+						"fwupd",
+						"WhitelistPlugins",
+						NULL, /* length */
+						NULL);
+	if (whitelist != NULL && g_strv_length (whitelist) == 0)
+		g_clear_pointer (&whitelist, g_strfreev);
+
 	/* search */
 	dir = g_dir_open (PLUGINDIR, 0, error);
 	if (dir == NULL)
 		return FALSE;
 	while ((fn = g_dir_read_name (dir)) != NULL) {
 		g_autofree gchar *filename = NULL;
+		g_autofree gchar *name = NULL;
 		g_autoptr(FuPlugin) plugin = NULL;
 		g_autoptr(GError) error_local = NULL;
 
@@ -2869,11 +5296,30 @@ fu_main_load_plugins (FuMainPrivate *priv, GError **error)
 		if (!g_str_has_suffix (fn, ".so"))
 			continue;
 
+		/* check the config before paying for the dlopen and the
+		 * plugin init; the name is derived from the filename */
+		name = fu_main_get_plugin_name_for_filename (fn);
+		if (name == NULL)
+			continue;
+		if (blacklist != NULL &&
+		    g_strv_contains ((const gchar * const *) blacklist, name)) {
+			g_debug ("%s blacklisted by config", name);
+			continue;
+		}
+		if (whitelist != NULL &&
+		    !g_strv_contains ((const gchar * const *) whitelist, name)) {
+			g_debug ("%s not in config whitelist", name);
+			continue;
+		}
+
 		/* open module */
 		filename = g_build_filename (PLUGINDIR, fn, NULL);
 		plugin = fu_plugin_new ();
 		fu_plugin_set_usb_context (plugin, priv->usb_ctx);
+		fu_plugin_set_udev_backend (plugin, priv->udev_backend);
 		fu_plugin_set_hwids (plugin, priv->hwids);
+		if (priv->smbios != NULL)
+			fu_plugin_set_smbios (plugin, priv->smbios);
 		g_debug ("adding plugin %s", filename);
 		if (!fu_plugin_open (plugin, filename, &error_local)) {
 			g_warning ("failed to open plugin %s: %s",
@@ -2881,16 +5327,6 @@ fu_main_load_plugins (FuMainPrivate *priv, GError **error)
 			continue;
 		}
 
-		/* is blacklisted */
-		if (blacklist != NULL &&
-		    g_strv_contains ((const gchar * const *) blacklist,
-				     fu_plugin_get_name (plugin))) {
-			fu_plugin_set_enabled (plugin, FALSE);
-			g_debug ("%s blacklisted by config",
-				 fu_plugin_get_name (plugin));
-			continue;
-		}
-
 		/* watch for changes */
 		g_signal_connect (plugin, "device-added",
 				  G_CALLBACK (fu_main_plugin_device_added_cb),
@@ -2940,7 +5376,7 @@ fu_main_check_plugins_pending (FuMainPrivate *priv, GError **error)
 }
 
 static gboolean
-fu_main_perhaps_own_name (gpointer user_data)
+fu_main_coldplug_settled_cb (gpointer user_data)
 {
 	FuMainPrivate *priv = (FuMainPrivate *) user_data;
 	g_autoptr(GError) error = NULL;
@@ -2951,22 +5387,57 @@ fu_main_perhaps_own_name (gpointer user_data)
 		return G_SOURCE_CONTINUE;
 	}
 
-	/* own the object */
-	g_debug ("registering D-Bus service");
-	priv->owner_id = g_bus_own_name (G_BUS_TYPE_SYSTEM,
-					 FWUPD_DBUS_SERVICE,
-					 G_BUS_NAME_OWNER_FLAGS_ALLOW_REPLACEMENT |
-					 G_BUS_NAME_OWNER_FLAGS_REPLACE,
-					 fu_main_on_bus_acquired_cb,
-					 fu_main_on_name_acquired_cb,
-					 fu_main_on_name_lost_cb,
-					 priv, NULL);
+	/* the device list can be trusted from now on */
+	priv->coldplug_done = TRUE;
+	fu_main_set_coldplug_percentage (priv, 100);
+
+	/* replay anything that arrived while the hardware was probed */
+	while (priv->coldplug_queue->len > 0) {
+		GDBusMethodInvocation *invocation =
+			g_object_ref (g_ptr_array_index (priv->coldplug_queue, 0));
+		g_ptr_array_remove_index (priv->coldplug_queue, 0);
+		g_debug ("replaying deferred %s()",
+			 g_dbus_method_invocation_get_method_name (invocation));
+		fu_main_daemon_method_call (g_dbus_method_invocation_get_connection (invocation),
+					    g_dbus_method_invocation_get_sender (invocation),
+					    g_dbus_method_invocation_get_object_path (invocation),
+					    g_dbus_method_invocation_get_interface_name (invocation),
+					    g_dbus_method_invocation_get_method_name (invocation),
+					    g_dbus_method_invocation_get_parameters (invocation),
+					    invocation, priv);
+	}
 	return G_SOURCE_REMOVE;
 }
 
+/* everything that touches real hardware happens here, off the main
+ * thread, so the bus name is answering trivial requests while the
+ * slowest plugin is still probing */
+static gpointer
+fu_main_startup_thread_cb (gpointer user_data)
+{
+	FuMainPrivate *priv = (FuMainPrivate *) user_data;
+
+	/* add devices */
+	fu_main_plugins_setup (priv);
+	g_usb_context_enumerate (priv->usb_ctx);
+	fu_udev_backend_coldplug (priv->udev_backend);
+	fu_main_plugins_coldplug (priv);
+
+	/* print the startup phase report for --timing */
+	fu_debug_timing_report ();
+
+	/* wait out any device delays back on the main thread */
+	g_timeout_add (200, fu_main_coldplug_settled_cb, priv);
+	return NULL;
+}
+
 static void
 fu_main_private_free (FuMainPrivate *priv)
 {
+	if (priv->startup_thread != NULL)
+		g_thread_join (priv->startup_thread);
+	if (priv->coldplug_queue != NULL)
+		g_ptr_array_unref (priv->coldplug_queue);
 	if (priv->loop != NULL)
 		g_main_loop_unref (priv->loop);
 	if (priv->owner_id > 0)
@@ -2975,30 +5446,78 @@ fu_main_private_free (FuMainPrivate *priv)
 		g_object_unref (priv->proxy_uid);
 	if (priv->usb_ctx != NULL)
 		g_object_unref (priv->usb_ctx);
+	if (priv->udev_backend != NULL)
+		g_object_unref (priv->udev_backend);
 	if (priv->config != NULL)
 		g_key_file_unref (priv->config);
-	if (priv->connection != NULL)
+	if (priv->connection != NULL) {
+		if (priv->auth_owner_sub_id != 0)
+			g_dbus_connection_signal_unsubscribe (priv->connection,
+							      priv->auth_owner_sub_id);
 		g_object_unref (priv->connection);
+	}
+	if (priv->private_server != NULL) {
+		g_dbus_server_stop (priv->private_server);
+		g_object_unref (priv->private_server);
+	}
+	if (priv->private_conns != NULL)
+		g_ptr_array_unref (priv->private_conns);
 	if (priv->authority != NULL)
 		g_object_unref (priv->authority);
+	if (priv->auth_cache != NULL)
+		g_hash_table_unref (priv->auth_cache);
+	if (priv->subscriptions != NULL)
+		g_hash_table_unref (priv->subscriptions);
+	if (priv->update_stats != NULL)
+		g_hash_table_unref (priv->update_stats);
 	if (priv->profile != NULL)
 		g_object_unref (priv->profile);
 	if (priv->store != NULL)
 		g_object_unref (priv->store);
-	if (priv->introspection_daemon != NULL)
-		g_dbus_node_info_unref (priv->introspection_daemon);
+	if (priv->store_index != NULL)
+		g_hash_table_unref (priv->store_index);
+	if (priv->store_verify != NULL)
+		g_object_unref (priv->store_verify);
 	if (priv->store_changed_id != 0)
 		g_source_remove (priv->store_changed_id);
 	if (priv->pending != NULL)
 		g_object_unref (priv->pending);
 	if (priv->coldplug_id != 0)
 		g_source_remove (priv->coldplug_id);
+	if (priv->changed_coalesce_id != 0)
+		g_source_remove (priv->changed_coalesce_id);
+	if (priv->percentage_coalesce_id != 0)
+		g_source_remove (priv->percentage_coalesce_id);
+	if (priv->idle_shed_id != 0)
+		g_source_remove (priv->idle_shed_id);
+	if (priv->metadata_reload_id != 0)
+		g_source_remove (priv->metadata_reload_id);
+	if (priv->monitor_metadata != NULL)
+		g_object_unref (priv->monitor_metadata);
+	if (priv->monitor_verify != NULL)
+		g_object_unref (priv->monitor_verify);
+	if (priv->changed_ids != NULL)
+		g_ptr_array_unref (priv->changed_ids);
+	if (priv->devices_reply != NULL)
+		g_variant_unref (priv->devices_reply);
 	if (priv->plugins != NULL)
 		g_ptr_array_unref (priv->plugins);
 	if (priv->hwids != NULL)
 		g_hash_table_unref (priv->hwids);
+	if (priv->quirks != NULL)
+		g_object_unref (priv->quirks);
+	if (priv->smbios != NULL)
+		g_object_unref (priv->smbios);
+	if (priv->keyring_fw != NULL)
+		g_object_unref (priv->keyring_fw);
+	if (priv->keyring_md != NULL)
+		g_object_unref (priv->keyring_md);
 	if (priv->plugins_hash != NULL)
 		g_hash_table_unref (priv->plugins_hash);
+	if (priv->devices_by_id != NULL)
+		g_hash_table_unref (priv->devices_by_id);
+	if (priv->devices_by_guid != NULL)
+		g_hash_table_unref (priv->devices_by_guid);
 	g_ptr_array_unref (priv->devices);
 	g_free (priv);
 }
@@ -3019,10 +5538,13 @@ main (int argc, char *argv[])
 		  _("Exit after the engine has loaded"), NULL },
 		{ NULL}
 	};
+	const gchar *udev_subsystems[] = { "usb", "pci", "hidraw", NULL };
 	g_autoptr(FuMainPrivate) priv = NULL;
 	g_autoptr(GError) error = NULL;
+	g_autoptr(GError) error_smbios = NULL;
 	g_autoptr(GOptionContext) context = NULL;
 	g_autofree gchar *config_file = NULL;
+	g_autofree gchar *pki_dir = NULL;
 
 	setlocale (LC_ALL, "");
 
@@ -3047,25 +5569,29 @@ main (int argc, char *argv[])
 	priv->status = FWUPD_STATUS_IDLE;
 	priv->percentage = 0;
 	priv->devices = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_main_item_free);
+	priv->devices_by_id = g_hash_table_new_full (g_str_hash, g_str_equal,
+						     g_free, NULL);
+	priv->devices_by_guid = g_hash_table_new_full (g_str_hash, g_str_equal,
+						       g_free, NULL);
+	priv->changed_ids = g_ptr_array_new_with_free_func (g_free);
+	priv->coldplug_queue = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	priv->auth_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+						  g_free, g_free);
+	priv->update_stats = g_hash_table_new_full (g_str_hash, g_str_equal,
+						    g_free, g_free);
 	priv->loop = g_main_loop_new (NULL, FALSE);
 	priv->pending = fu_pending_new ();
-	priv->store = as_store_new ();
 	priv->profile = as_profile_new ();
-	g_signal_connect (priv->store, "changed",
-			  G_CALLBACK (fu_main_store_changed_cb), priv);
-	as_store_set_watch_flags (priv->store, AS_STORE_WATCH_FLAG_ADDED |
-					       AS_STORE_WATCH_FLAG_REMOVED);
 
-	/* load AppStream */
-	as_store_add_filter (priv->store, AS_APP_KIND_FIRMWARE);
-	if (!as_store_load (priv->store,
-			    AS_STORE_LOAD_FLAG_IGNORE_INVALID |
-			    AS_STORE_LOAD_FLAG_APP_INFO_SYSTEM,
-			    NULL, &error)){
+	/* load AppStream, preferring the binary cache to the XML parse */
+	if (!fu_main_store_load (priv, &error)) {
 		g_printerr ("Failed to load AppStream data: %s\n", error->message);
 		return EXIT_FAILURE;
 	}
 
+	/* watch for external metadata and attestation pushes */
+	fu_main_monitors_setup (priv);
+
 	/* read config file */
 	config_file = g_build_filename (fu_main_get_sysconfig_dir (), "fwupd.conf", NULL);
 	g_debug ("loading config values from %s", config_file);
@@ -3077,6 +5603,22 @@ main (int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 
+	/* how long to stay fully resident with no requests */
+	priv->idle_shed_timeout = FU_MAIN_IDLE_SHED_TIMEOUT;
+	if (g_key_file_has_key (priv->config, "fwupd", "IdleShedTimeout", NULL)) {
+		priv->idle_shed_timeout = (guint)
+			g_key_file_get_integer (priv->config, "fwupd",
+						"IdleShedTimeout", NULL);
+	}
+	fu_main_idle_shed_rearm (priv);
+
+	/* how many completed updates to keep per device */
+	if (g_key_file_has_key (priv->config, "fwupd", "PendingHistoryDepth", NULL)) {
+		fu_pending_set_history_depth (priv->pending, (guint)
+			g_key_file_get_integer (priv->config, "fwupd",
+						"PendingHistoryDepth", NULL));
+	}
+
 	/* set shared USB context */
 	priv->usb_ctx = g_usb_context_new (&error);
 	if (priv->usb_ctx == NULL) {
@@ -3084,6 +5626,20 @@ main (int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 
+	/* set shared udev backend; one enumeration pass serves every plugin */
+	priv->udev_backend = fu_udev_backend_new (udev_subsystems);
+	if (priv->udev_backend == NULL) {
+		g_printerr ("Failed to get udev backend\n");
+		return EXIT_FAILURE;
+	}
+
+	/* parse the DMI table once, shared by the hwids and the plugins */
+	priv->smbios = fu_smbios_new ();
+	if (!fu_smbios_setup (priv->smbios, &error_smbios)) {
+		g_debug ("failed to parse SMBIOS: %s", error_smbios->message);
+		g_clear_object (&priv->smbios);
+	}
+
 	/* load the hwids */
 	priv->hwids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 	if (!fu_main_load_hwids (priv, &error)) {
@@ -3100,6 +5656,21 @@ main (int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 
+	/* import the public keys on worker threads; the first verify call
+	 * blocks until the import has finished -- falling back to the keys
+	 * compiled into the binary when the pki directory was never set up */
+	priv->keyring_fw = fu_keyring_new ();
+	pki_dir = g_build_filename (fu_main_get_sysconfig_dir (), "pki", "fwupd", NULL);
+	if (g_file_test (pki_dir, G_FILE_TEST_EXISTS))
+		fu_keyring_preload (priv->keyring_fw, pki_dir);
+	else
+		fu_keyring_preload (priv->keyring_fw, NULL);
+	priv->keyring_md = fu_keyring_new ();
+	if (g_file_test ("/etc/pki/fwupd-metadata", G_FILE_TEST_EXISTS))
+		fu_keyring_preload (priv->keyring_md, "/etc/pki/fwupd-metadata");
+	else
+		fu_keyring_preload (priv->keyring_md, NULL);
+
 	/* disable udev? */
 	if (!g_key_file_get_boolean (priv->config, "fwupd", "EnableOptionROM", NULL)) {
 		FuPlugin *plugin = g_hash_table_lookup (priv->plugins_hash, "udev");
@@ -3107,14 +5678,6 @@ main (int argc, char *argv[])
 			fu_plugin_set_enabled (plugin, FALSE);
 	}
 
-	/* load introspection from file */
-	priv->introspection_daemon = fu_main_load_introspection (FWUPD_DBUS_INTERFACE ".xml",
-								 &error);
-	if (priv->introspection_daemon == NULL) {
-		g_printerr ("Failed to load introspection: %s\n", error->message);
-		return EXIT_FAILURE;
-	}
-
 	/* get authority */
 	priv->authority = polkit_authority_get_sync (NULL, &error);
 	if (priv->authority == NULL) {
@@ -3122,13 +5685,30 @@ main (int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 
-	/* add devices */
-	fu_main_plugins_setup (priv);
-	g_usb_context_enumerate (priv->usb_ctx);
-	fu_main_plugins_coldplug (priv);
+	/* own the bus name straight away; properties and cheap methods
+	 * answer immediately and device-dependent calls are queued until
+	 * coldplug has finished */
+	g_debug ("registering D-Bus service");
+	priv->owner_id = g_bus_own_name (G_BUS_TYPE_SYSTEM,
+					 FWUPD_DBUS_SERVICE,
+					 G_BUS_NAME_OWNER_FLAGS_ALLOW_REPLACEMENT |
+					 G_BUS_NAME_OWNER_FLAGS_REPLACE,
+					 fu_main_on_bus_acquired_cb,
+					 fu_main_on_name_acquired_cb,
+					 fu_main_on_name_lost_cb,
+					 priv, NULL);
+
+	/* probe the hardware on a worker thread */
+	priv->startup_thread = g_thread_new ("FuStartup",
+					     fu_main_startup_thread_cb,
+					     priv);
+
+	/* optionally listen on a peer-to-peer socket as well */
+	fu_main_private_server_setup (priv);
 
-	/* keep polling until all the plugins are ready */
-	g_timeout_add (200, fu_main_perhaps_own_name, priv);
+	/* flush state and exit inside the shutdown budget */
+	g_unix_signal_add (SIGTERM, fu_main_sigterm_cb, priv);
+	g_unix_signal_add (SIGINT, fu_main_sigterm_cb, priv);
 
 	/* Only timeout and close the mainloop if we have specified it
 	 * on the command line */
@@ -0,0 +1,439 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2017 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* The AppStream XML is slow to parse and the daemon pays that cost on every
+ * start before the bus name is even owned. After a successful UpdateMetadata
+ * the daemon serializes the subset of the store it actually uses into a
+ * GVariant blob on disk. The serialized GVariant format is offset-based
+ * rather than pointer-based, so on the next startup the file can be mapped
+ * read-only and strings are read straight out of the mapping without an XML
+ * parser in sight.
+ *
+ * The cache records the checksum of the XML it was generated from; if the
+ * XML has been modified behind our back we throw the cache away and parse
+ * the XML as before. */
+
+#include "config.h"
+
+#include <appstream-glib.h>
+
+#include "fu-metadata-cache.h"
+
+#define FU_METADATA_CACHE_VERSION	1
+
+static GVariant *
+fu_metadata_cache_release_to_variant (AsRelease *release)
+{
+	GVariantBuilder builder;
+	GVariantBuilder csums;
+	GPtrArray *checksums;
+	const gchar *tmp;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	tmp = as_release_get_version (release);
+	if (tmp != NULL) {
+		g_variant_builder_add (&builder, "{sv}", "version",
+				       g_variant_new_string (tmp));
+	}
+	tmp = as_release_get_description (release, NULL);
+	if (tmp != NULL) {
+		g_variant_builder_add (&builder, "{sv}", "description",
+				       g_variant_new_string (tmp));
+	}
+	tmp = as_release_get_location_default (release);
+	if (tmp != NULL) {
+		g_variant_builder_add (&builder, "{sv}", "location",
+				       g_variant_new_string (tmp));
+	}
+	g_variant_builder_add (&builder, "{sv}", "size-installed",
+			       g_variant_new_uint64 (as_release_get_size (release, AS_SIZE_KIND_INSTALLED)));
+	g_variant_builder_add (&builder, "{sv}", "size-download",
+			       g_variant_new_uint64 (as_release_get_size (release, AS_SIZE_KIND_DOWNLOAD)));
+
+	/* both the container and content checksums, with filenames */
+	g_variant_builder_init (&csums, G_VARIANT_TYPE ("a(uss)"));
+	checksums = as_release_get_checksums (release);
+	for (guint i = 0; i < checksums->len; i++) {
+		AsChecksum *csum = g_ptr_array_index (checksums, i);
+		const gchar *value = as_checksum_get_value (csum);
+		const gchar *fn = as_checksum_get_filename (csum);
+		g_variant_builder_add (&csums, "(uss)",
+				       (guint32) as_checksum_get_target (csum),
+				       value != NULL ? value : "",
+				       fn != NULL ? fn : "");
+	}
+	g_variant_builder_add (&builder, "{sv}", "checksums",
+			       g_variant_builder_end (&csums));
+	return g_variant_builder_end (&builder);
+}
+
+static GVariant *
+fu_metadata_cache_app_to_variant (AsApp *app)
+{
+	GVariantBuilder builder;
+	GVariantBuilder array;
+	GPtrArray *provides;
+	GPtrArray *releases;
+	GHashTable *metadata;
+	const gchar *tmp;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	g_variant_builder_add (&builder, "{sv}", "id",
+			       g_variant_new_string (as_app_get_id (app)));
+	tmp = as_app_get_name (app, NULL);
+	if (tmp != NULL) {
+		g_variant_builder_add (&builder, "{sv}", "name",
+				       g_variant_new_string (tmp));
+	}
+	tmp = as_app_get_comment (app, NULL);
+	if (tmp != NULL) {
+		g_variant_builder_add (&builder, "{sv}", "comment",
+				       g_variant_new_string (tmp));
+	}
+	tmp = as_app_get_description (app, NULL);
+	if (tmp != NULL) {
+		g_variant_builder_add (&builder, "{sv}", "description",
+				       g_variant_new_string (tmp));
+	}
+	tmp = as_app_get_developer_name (app, NULL);
+	if (tmp != NULL) {
+		g_variant_builder_add (&builder, "{sv}", "developer-name",
+				       g_variant_new_string (tmp));
+	}
+	tmp = as_app_get_url_item (app, AS_URL_KIND_HOMEPAGE);
+	if (tmp != NULL) {
+		g_variant_builder_add (&builder, "{sv}", "homepage",
+				       g_variant_new_string (tmp));
+	}
+	tmp = as_app_get_project_license (app);
+	if (tmp != NULL) {
+		g_variant_builder_add (&builder, "{sv}", "license",
+				       g_variant_new_string (tmp));
+	}
+
+	/* only fwupd:: keys are ever used by the daemon */
+	metadata = as_app_get_metadata (app);
+	if (metadata != NULL) {
+		GHashTableIter iter;
+		gpointer key, value;
+		GVariantBuilder dict;
+		g_variant_builder_init (&dict, G_VARIANT_TYPE ("a{ss}"));
+		g_hash_table_iter_init (&iter, metadata);
+		while (g_hash_table_iter_next (&iter, &key, &value)) {
+			g_variant_builder_add (&dict, "{ss}",
+					       (const gchar *) key,
+					       (const gchar *) value);
+		}
+		g_variant_builder_add (&builder, "{sv}", "metadata",
+				       g_variant_builder_end (&dict));
+	}
+
+	/* flashed firmware GUIDs */
+	g_variant_builder_init (&array, G_VARIANT_TYPE ("as"));
+	provides = as_app_get_provides (app);
+	for (guint i = 0; i < provides->len; i++) {
+		AsProvide *prov = g_ptr_array_index (provides, i);
+		if (as_provide_get_kind (prov) != AS_PROVIDE_KIND_FIRMWARE_FLASHED)
+			continue;
+		g_variant_builder_add (&array, "s", as_provide_get_value (prov));
+	}
+	g_variant_builder_add (&builder, "{sv}", "guids",
+			       g_variant_builder_end (&array));
+
+#if AS_CHECK_VERSION(0,6,7)
+	/* version requirements */
+	{
+		GPtrArray *requires = as_app_get_requires (app);
+		GVariantBuilder reqs;
+		g_variant_builder_init (&reqs, G_VARIANT_TYPE ("a(uuss)"));
+		for (guint i = 0; i < requires->len; i++) {
+			AsRequire *req = g_ptr_array_index (requires, i);
+			const gchar *value = as_require_get_value (req);
+			const gchar *version = as_require_get_version (req);
+			g_variant_builder_add (&reqs, "(uuss)",
+					       (guint32) as_require_get_kind (req),
+					       (guint32) as_require_get_compare (req),
+					       value != NULL ? value : "",
+					       version != NULL ? version : "");
+		}
+		g_variant_builder_add (&builder, "{sv}", "requires",
+				       g_variant_builder_end (&reqs));
+	}
+#endif
+
+	/* releases, newest first */
+	g_variant_builder_init (&array, G_VARIANT_TYPE ("aa{sv}"));
+	releases = as_app_get_releases (app);
+	for (guint i = 0; i < releases->len; i++) {
+		AsRelease *release = g_ptr_array_index (releases, i);
+		g_variant_builder_add_value (&array,
+					     fu_metadata_cache_release_to_variant (release));
+	}
+	g_variant_builder_add (&builder, "{sv}", "releases",
+			       g_variant_builder_end (&array));
+
+	return g_variant_builder_end (&builder);
+}
+
+/**
+ * fu_metadata_cache_save:
+ * @store: an #AsStore with firmware apps
+ * @filename: the cache location, e.g. "/var/cache/fwupd/metadata.cache"
+ * @checksum: the SHA1 of the XML the store was built from
+ * @error: A #GError or %NULL
+ *
+ * Serializes the store to an mmap-able binary cache file.
+ *
+ * Returns: %TRUE for success
+ **/
+gboolean
+fu_metadata_cache_save (AsStore *store,
+			const gchar *filename,
+			const gchar *checksum,
+			GError **error)
+{
+	GPtrArray *apps = as_store_get_apps (store);
+	GVariantBuilder builder;
+	g_autofree gchar *dirname = NULL;
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GVariant) variant = NULL;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("aa{sv}"));
+	for (guint i = 0; i < apps->len; i++) {
+		AsApp *app = g_ptr_array_index (apps, i);
+		if (as_app_get_kind (app) != AS_APP_KIND_FIRMWARE)
+			continue;
+		g_variant_builder_add_value (&builder,
+					     fu_metadata_cache_app_to_variant (app));
+	}
+	variant = g_variant_ref_sink (g_variant_new ("(usaa{sv})",
+						     (guint32) FU_METADATA_CACHE_VERSION,
+						     checksum,
+						     &builder));
+
+	/* ensure directory exists */
+	dirname = g_path_get_dirname (filename);
+	if (g_mkdir_with_parents (dirname, 0755) != 0) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_FAILED,
+			     "failed to create %s", dirname);
+		return FALSE;
+	}
+
+	bytes = g_variant_get_data_as_bytes (variant);
+	return g_file_set_contents (filename,
+				    g_bytes_get_data (bytes, NULL),
+				    (gssize) g_bytes_get_size (bytes),
+				    error);
+}
+
+static void
+fu_metadata_cache_release_from_variant (AsApp *app, GVariant *variant)
+{
+	GVariantIter iter;
+	const gchar *tmp;
+	guint64 size;
+	g_autoptr(AsRelease) release = as_release_new ();
+	g_autoptr(GVariant) csums = NULL;
+
+	if (g_variant_lookup (variant, "version", "&s", &tmp))
+		as_release_set_version (release, tmp);
+	if (g_variant_lookup (variant, "description", "&s", &tmp))
+		as_release_set_description (release, NULL, tmp);
+	if (g_variant_lookup (variant, "location", "&s", &tmp))
+		as_release_add_location (release, tmp);
+	if (g_variant_lookup (variant, "size-installed", "t", &size))
+		as_release_set_size (release, AS_SIZE_KIND_INSTALLED, size);
+	if (g_variant_lookup (variant, "size-download", "t", &size))
+		as_release_set_size (release, AS_SIZE_KIND_DOWNLOAD, size);
+	csums = g_variant_lookup_value (variant, "checksums",
+					G_VARIANT_TYPE ("a(uss)"));
+	if (csums != NULL) {
+		guint32 target;
+		const gchar *value;
+		const gchar *fn;
+		g_variant_iter_init (&iter, csums);
+		while (g_variant_iter_loop (&iter, "(u&s&s)",
+					    &target, &value, &fn)) {
+			g_autoptr(AsChecksum) csum = as_checksum_new ();
+			as_checksum_set_target (csum, target);
+			if (value[0] != '\0')
+				as_checksum_set_value (csum, value);
+			if (fn[0] != '\0')
+				as_checksum_set_filename (csum, fn);
+			as_release_add_checksum (release, csum);
+		}
+	}
+	as_app_add_release (app, release);
+}
+
+static AsApp *
+fu_metadata_cache_app_from_variant (GVariant *variant)
+{
+	GVariantIter iter;
+	GVariant *child;
+	const gchar *tmp;
+	g_autoptr(AsApp) app = as_app_new ();
+	g_autoptr(GVariant) dict = NULL;
+	g_autoptr(GVariant) guids = NULL;
+	g_autoptr(GVariant) releases = NULL;
+
+	as_app_set_kind (app, AS_APP_KIND_FIRMWARE);
+	if (g_variant_lookup (variant, "id", "&s", &tmp))
+		as_app_set_id (app, tmp);
+	if (g_variant_lookup (variant, "name", "&s", &tmp))
+		as_app_set_name (app, NULL, tmp);
+	if (g_variant_lookup (variant, "comment", "&s", &tmp))
+		as_app_set_comment (app, NULL, tmp);
+	if (g_variant_lookup (variant, "description", "&s", &tmp))
+		as_app_set_description (app, NULL, tmp);
+	if (g_variant_lookup (variant, "developer-name", "&s", &tmp))
+		as_app_set_developer_name (app, NULL, tmp);
+	if (g_variant_lookup (variant, "homepage", "&s", &tmp))
+		as_app_add_url (app, AS_URL_KIND_HOMEPAGE, tmp);
+	if (g_variant_lookup (variant, "license", "&s", &tmp))
+		as_app_set_project_license (app, tmp);
+	dict = g_variant_lookup_value (variant, "metadata",
+				       G_VARIANT_TYPE ("a{ss}"));
+	if (dict != NULL) {
+		const gchar *key;
+		const gchar *value;
+		g_variant_iter_init (&iter, dict);
+		while (g_variant_iter_loop (&iter, "{&s&s}", &key, &value))
+			as_app_add_metadata (app, key, value);
+	}
+	guids = g_variant_lookup_value (variant, "guids",
+					G_VARIANT_TYPE ("as"));
+	if (guids != NULL) {
+		g_variant_iter_init (&iter, guids);
+		while (g_variant_iter_loop (&iter, "&s", &tmp)) {
+			g_autoptr(AsProvide) prov = as_provide_new ();
+			as_provide_set_kind (prov, AS_PROVIDE_KIND_FIRMWARE_FLASHED);
+			as_provide_set_value (prov, tmp);
+			as_app_add_provide (app, prov);
+		}
+	}
+#if AS_CHECK_VERSION(0,6,7)
+	{
+		g_autoptr(GVariant) reqs = NULL;
+		reqs = g_variant_lookup_value (variant, "requires",
+					       G_VARIANT_TYPE ("a(uuss)"));
+		if (reqs != NULL) {
+			guint32 kind;
+			guint32 compare;
+			const gchar *value;
+			const gchar *version;
+			g_variant_iter_init (&iter, reqs);
+			while (g_variant_iter_loop (&iter, "(uu&s&s)",
+						    &kind, &compare,
+						    &value, &version)) {
+				g_autoptr(AsRequire) req = as_require_new ();
+				as_require_set_kind (req, kind);
+				as_require_set_compare (req, compare);
+				if (value[0] != '\0')
+					as_require_set_value (req, value);
+				if (version[0] != '\0')
+					as_require_set_version (req, version);
+				as_app_add_require (app, req);
+			}
+		}
+	}
+#endif
+	releases = g_variant_lookup_value (variant, "releases",
+					   G_VARIANT_TYPE ("aa{sv}"));
+	if (releases != NULL) {
+		g_variant_iter_init (&iter, releases);
+		while ((child = g_variant_iter_next_value (&iter)) != NULL) {
+			fu_metadata_cache_release_from_variant (app, child);
+			g_variant_unref (child);
+		}
+	}
+	return g_steal_pointer (&app);
+}
+
+/**
+ * fu_metadata_cache_load:
+ * @store: an #AsStore to populate
+ * @filename: the cache location, e.g. "/var/cache/fwupd/metadata.cache"
+ * @checksum: the SHA1 of the XML the cache is expected to match
+ * @error: A #GError or %NULL
+ *
+ * Maps the binary cache read-only and populates the store from it without
+ * parsing any XML. If the cache does not exist, is from a different cache
+ * format version, or was generated from different XML then an error is
+ * returned and the caller should parse the XML as usual.
+ *
+ * Returns: %TRUE for success
+ **/
+gboolean
+fu_metadata_cache_load (AsStore *store,
+			const gchar *filename,
+			const gchar *checksum,
+			GError **error)
+{
+	GVariantIter iter;
+	GVariant *child;
+	guint32 version = 0;
+	const gchar *checksum_tmp = NULL;
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GMappedFile) mmap = NULL;
+	g_autoptr(GVariant) apps = NULL;
+	g_autoptr(GVariant) variant = NULL;
+
+	mmap = g_mapped_file_new (filename, FALSE, error);
+	if (mmap == NULL)
+		return FALSE;
+	bytes = g_mapped_file_get_bytes (mmap);
+	variant = g_variant_new_from_bytes (G_VARIANT_TYPE ("(usaa{sv})"),
+					    bytes, FALSE);
+	if (variant == NULL) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_INVALID_DATA,
+			     "%s is not a metadata cache", filename);
+		return FALSE;
+	}
+	g_variant_get (variant, "(u&s@aa{sv})", &version, &checksum_tmp, &apps);
+	if (version != FU_METADATA_CACHE_VERSION) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_INVALID_DATA,
+			     "cache version %u, expected %u",
+			     version, FU_METADATA_CACHE_VERSION);
+		return FALSE;
+	}
+	if (g_strcmp0 (checksum_tmp, checksum) != 0) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_INVALID_DATA,
+			     "cache checksum %s, expected %s",
+			     checksum_tmp, checksum);
+		return FALSE;
+	}
+	g_variant_iter_init (&iter, apps);
+	while ((child = g_variant_iter_next_value (&iter)) != NULL) {
+		g_autoptr(AsApp) app = fu_metadata_cache_app_from_variant (child);
+		as_store_add_app (store, app);
+		g_variant_unref (child);
+	}
+	return TRUE;
+}
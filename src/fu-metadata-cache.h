@@ -0,0 +1,41 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2017 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __FU_METADATA_CACHE_H
+#define __FU_METADATA_CACHE_H
+
+#include <glib.h>
+#include <appstream-glib.h>
+
+G_BEGIN_DECLS
+
+gboolean	 fu_metadata_cache_save			(AsStore	*store,
+							 const gchar	*filename,
+							 const gchar	*checksum,
+							 GError		**error);
+gboolean	 fu_metadata_cache_load			(AsStore	*store,
+							 const gchar	*filename,
+							 const gchar	*checksum,
+							 GError		**error);
+
+G_END_DECLS
+
+#endif /* __FU_METADATA_CACHE_H */
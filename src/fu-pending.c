@@ -27,12 +27,28 @@
 #include <sqlite3.h>
 #include <stdlib.h>
 
+#include "fu-debug.h"
 #include "fu-pending.h"
+#include "fu-trace.h"
 
 static void fu_pending_finalize			 (GObject *object);
 
+/* how many completed updates to keep in the history table per device */
+#define FU_PENDING_HISTORY_DEPTH_DEFAULT	8
+
 typedef struct {
 	sqlite3				*db;
+	sqlite3_stmt			*stmt_add_device;
+	sqlite3_stmt			*stmt_remove_device;
+	sqlite3_stmt			*stmt_set_state;
+	sqlite3_stmt			*stmt_set_error_msg;
+	sqlite3_stmt			*stmt_set_transfer;
+	sqlite3_stmt			*stmt_set_checkpoint;
+	sqlite3_stmt			*stmt_history_add;
+	sqlite3_stmt			*stmt_history_prune;
+	gboolean			 in_transaction;
+	gboolean			 read_only;
+	guint				 history_depth;
 } FuPendingPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (FuPending, fu_pending, G_TYPE_OBJECT)
@@ -45,6 +61,7 @@ fu_pending_load (FuPending *pending, GError **error)
 	char *error_msg = NULL;
 	const char *statement;
 	gint rc;
+	gint64 timing;
 	g_autofree gchar *dirname = NULL;
 	g_autofree gchar *filename = NULL;
 	g_autoptr(GFile) file = NULL;
@@ -54,16 +71,23 @@ fu_pending_load (FuPending *pending, GError **error)
 
 	/* create directory */
 	dirname = g_build_filename (LOCALSTATEDIR, "lib", "fwupd", NULL);
-	file = g_file_new_for_path (dirname);
-	if (!g_file_query_exists (file, NULL)) {
-		if (!g_file_make_directory_with_parents (file, NULL, error))
-			return FALSE;
+	if (!priv->read_only) {
+		file = g_file_new_for_path (dirname);
+		if (!g_file_query_exists (file, NULL)) {
+			if (!g_file_make_directory_with_parents (file, NULL, error))
+				return FALSE;
+		}
 	}
 
 	/* open */
+	timing = fu_debug_timing_start ();
 	filename = g_build_filename (dirname, "pending.db", NULL);
-	g_debug ("FuPending: trying to open database '%s'", filename);
-	rc = sqlite3_open (filename, &priv->db);
+	g_debug ("FuPending: trying to open database '%s'%s", filename,
+		 priv->read_only ? " read-only" : "");
+	rc = sqlite3_open_v2 (filename, &priv->db,
+			      priv->read_only ? SQLITE_OPEN_READONLY :
+			      SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE,
+			      NULL);
 	if (rc != SQLITE_OK) {
 		g_set_error (error,
 			     FWUPD_ERROR,
@@ -74,6 +98,24 @@ fu_pending_load (FuPending *pending, GError **error)
 		return FALSE;
 	}
 
+	/* no schema repair is possible without write access; WAL mode is a
+	 * property of the database file so concurrent daemon writes are
+	 * still safe to read past */
+	if (priv->read_only) {
+		fu_debug_timing_end (timing, "pending-db-open");
+		return TRUE;
+	}
+
+	/* use write-ahead logging so reads do not block the scheduler,
+	 * and only sync to the WAL at transaction boundaries */
+	rc = sqlite3_exec (priv->db, "PRAGMA journal_mode=WAL;",
+			   NULL, NULL, &error_msg);
+	if (rc != SQLITE_OK) {
+		g_debug ("FuPending: failed to set WAL mode: %s", error_msg);
+		sqlite3_free (error_msg);
+	}
+	sqlite3_exec (priv->db, "PRAGMA synchronous=NORMAL;", NULL, NULL, NULL);
+
 	/* check devices */
 	rc = sqlite3_exec (priv->db, "SELECT * FROM pending LIMIT 1",
 			   NULL, NULL, &error_msg);
@@ -141,18 +183,135 @@ fu_pending_load (FuPending *pending, GError **error)
 		sqlite3_exec (priv->db, statement, NULL, NULL, NULL);
 	}
 
+	/* check pending has transfer accounting (since 0.9.5) */
+	rc = sqlite3_exec (priv->db,
+			   "SELECT transfer_bytes FROM pending LIMIT 1",
+			   NULL, NULL, &error_msg);
+	if (rc != SQLITE_OK) {
+		g_debug ("FuPending: altering table to repair: %s", error_msg);
+		sqlite3_free (error_msg);
+		statement = "ALTER TABLE pending ADD COLUMN transfer_bytes INTEGER DEFAULT 0;";
+		sqlite3_exec (priv->db, statement, NULL, NULL, NULL);
+		statement = "ALTER TABLE pending ADD COLUMN update_duration_ms INTEGER DEFAULT 0;";
+		sqlite3_exec (priv->db, statement, NULL, NULL, NULL);
+		statement = "ALTER TABLE pending ADD COLUMN transfer_stall_ms INTEGER DEFAULT 0;";
+		sqlite3_exec (priv->db, statement, NULL, NULL, NULL);
+		statement = "ALTER TABLE pending ADD COLUMN transfer_retries INTEGER DEFAULT 0;";
+		sqlite3_exec (priv->db, statement, NULL, NULL, NULL);
+	}
+
+	/* check pending has resume checkpoints (since 0.9.5) */
+	rc = sqlite3_exec (priv->db,
+			   "SELECT checkpoint_phase FROM pending LIMIT 1",
+			   NULL, NULL, &error_msg);
+	if (rc != SQLITE_OK) {
+		g_debug ("FuPending: altering table to repair: %s", error_msg);
+		sqlite3_free (error_msg);
+		statement = "ALTER TABLE pending ADD COLUMN checkpoint_phase INTEGER DEFAULT 0;";
+		sqlite3_exec (priv->db, statement, NULL, NULL, NULL);
+		statement = "ALTER TABLE pending ADD COLUMN checkpoint_offset INTEGER DEFAULT 0;";
+		sqlite3_exec (priv->db, statement, NULL, NULL, NULL);
+	}
+
+	/* check the history table and indexes exist (since 0.9.5);
+	 * device_id needs no extra index on pending as it is already the
+	 * primary key */
+	rc = sqlite3_exec (priv->db,
+			   "SELECT device_id FROM history LIMIT 1",
+			   NULL, NULL, &error_msg);
+	if (rc != SQLITE_OK) {
+		g_debug ("FuPending: creating history table: %s", error_msg);
+		sqlite3_free (error_msg);
+		statement = "CREATE TABLE history ("
+			    "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+			    "device_id TEXT NOT NULL,"
+			    "timestamp TIMESTAMP DEFAULT CURRENT_TIMESTAMP NOT NULL,"
+			    "state INTEGER DEFAULT 0,"
+			    "error TEXT,"
+			    "version_old TEXT,"
+			    "version_new TEXT);";
+		sqlite3_exec (priv->db, statement, NULL, NULL, NULL);
+		statement = "CREATE INDEX idx_history_device_id ON history (device_id);";
+		sqlite3_exec (priv->db, statement, NULL, NULL, NULL);
+		statement = "CREATE INDEX idx_pending_state ON pending (state);";
+		sqlite3_exec (priv->db, statement, NULL, NULL, NULL);
+		/* refresh the query planner statistics after the migration */
+		sqlite3_exec (priv->db, "ANALYZE;", NULL, NULL, NULL);
+	}
+
+	fu_debug_timing_end (timing, "pending-db-open");
+	return TRUE;
+}
+
+void
+fu_pending_set_read_only (FuPending *pending, gboolean read_only)
+{
+	FuPendingPrivate *priv = GET_PRIVATE (pending);
+	g_return_if_fail (FU_IS_PENDING (pending));
+	g_return_if_fail (priv->db == NULL);
+	priv->read_only = read_only;
+}
+
+void
+fu_pending_set_history_depth (FuPending *pending, guint history_depth)
+{
+	FuPendingPrivate *priv = GET_PRIVATE (pending);
+	g_return_if_fail (FU_IS_PENDING (pending));
+	priv->history_depth = history_depth;
+}
+
+static gboolean
+fu_pending_stmt_prepare (FuPending *pending,
+			 sqlite3_stmt **stmt,
+			 const char *sql,
+			 GError **error)
+{
+	FuPendingPrivate *priv = GET_PRIVATE (pending);
+	gint rc;
+
+	/* already compiled */
+	if (*stmt != NULL)
+		return TRUE;
+	rc = sqlite3_prepare_v2 (priv->db, sql, -1, stmt, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_WRITE,
+			     "Cannot prepare statement: %s",
+			     sqlite3_errmsg (priv->db));
+		return FALSE;
+	}
 	return TRUE;
 }
 
+static gboolean
+fu_pending_stmt_run (FuPending *pending, sqlite3_stmt *stmt, GError **error)
+{
+	FuPendingPrivate *priv = GET_PRIVATE (pending);
+	gboolean ret = TRUE;
+	gint rc;
+
+	rc = sqlite3_step (stmt);
+	if (rc != SQLITE_DONE) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_WRITE,
+			     "SQL error: %s",
+			     sqlite3_errmsg (priv->db));
+		ret = FALSE;
+	}
+
+	/* keep the compiled statement for next time */
+	sqlite3_reset (stmt);
+	sqlite3_clear_bindings (stmt);
+	return ret;
+}
+
 gboolean
-fu_pending_add_device (FuPending *pending, FwupdResult *res, GError **error)
+fu_pending_transaction_begin (FuPending *pending, GError **error)
 {
 	FuPendingPrivate *priv = GET_PRIVATE (pending);
-	FwupdDevice *dev = fwupd_result_get_device (res);
-	FwupdRelease *rel = fwupd_result_get_release (res);
 	char *error_msg = NULL;
-	char *statement;
-	gboolean ret = TRUE;
 	gint rc;
 
 	g_return_val_if_fail (FU_IS_PENDING (pending), FALSE);
@@ -163,27 +322,12 @@ fu_pending_add_device (FuPending *pending, FwupdResult *res, GError **error)
 			return FALSE;
 	}
 
-	g_debug ("FuPending: add device %s", fwupd_device_get_id (dev));
-	statement = sqlite3_mprintf ("INSERT INTO pending (device_id,"
-							  "unique_id,"
-							  "state,"
-							  "filename,"
-							  "display_name,"
-							  "provider,"
-							  "version_old,"
-							  "version_new) "
-				     "VALUES ('%q','%q','%i','%q','%q','%q','%q','%q')",
-				     fwupd_device_get_id (dev),
-				     fwupd_result_get_unique_id (res),
-				     FWUPD_UPDATE_STATE_PENDING,
-				     fwupd_release_get_filename (rel),
-				     fwupd_device_get_name (dev),
-				     fwupd_device_get_provider (dev),
-				     fwupd_device_get_version (dev),
-				     fwupd_release_get_version (rel));
+	/* already open */
+	if (priv->in_transaction)
+		return TRUE;
 
-	/* insert entry */
-	rc = sqlite3_exec (priv->db, statement, NULL, NULL, &error_msg);
+	g_debug ("FuPending: begin transaction");
+	rc = sqlite3_exec (priv->db, "BEGIN IMMEDIATE;", NULL, NULL, &error_msg);
 	if (rc != SQLITE_OK) {
 		g_set_error (error,
 			     FWUPD_ERROR,
@@ -191,39 +335,28 @@ fu_pending_add_device (FuPending *pending, FwupdResult *res, GError **error)
 			     "SQL error: %s",
 			     error_msg);
 		sqlite3_free (error_msg);
-		ret = FALSE;
-		goto out;
+		return FALSE;
 	}
-out:
-	sqlite3_free (statement);
-	return ret;
+	priv->in_transaction = TRUE;
+	return TRUE;
 }
 
 gboolean
-fu_pending_remove_device (FuPending *pending, FwupdResult *res, GError **error)
+fu_pending_transaction_commit (FuPending *pending, GError **error)
 {
 	FuPendingPrivate *priv = GET_PRIVATE (pending);
-	FwupdDevice *dev = fwupd_result_get_device (res);
 	char *error_msg = NULL;
-	char *statement;
-	gboolean ret = TRUE;
 	gint rc;
 
 	g_return_val_if_fail (FU_IS_PENDING (pending), FALSE);
 
-	/* lazy load */
-	if (priv->db == NULL) {
-		if (!fu_pending_load (pending, error))
-			return FALSE;
-	}
-
-	g_debug ("FuPending: remove device %s", fwupd_device_get_id (dev));
-	statement = sqlite3_mprintf ("DELETE FROM pending WHERE "
-				     "device_id = '%q';",
-				     fwupd_device_get_id (dev));
+	/* nothing batched */
+	if (!priv->in_transaction)
+		return TRUE;
 
-	/* remove entry */
-	rc = sqlite3_exec (priv->db, statement, NULL, NULL, &error_msg);
+	g_debug ("FuPending: commit transaction");
+	fu_trace (sqlite_commit);
+	rc = sqlite3_exec (priv->db, "COMMIT;", NULL, NULL, &error_msg);
 	if (rc != SQLITE_OK) {
 		g_set_error (error,
 			     FWUPD_ERROR,
@@ -231,12 +364,118 @@ fu_pending_remove_device (FuPending *pending, FwupdResult *res, GError **error)
 			     "SQL error: %s",
 			     error_msg);
 		sqlite3_free (error_msg);
-		ret = FALSE;
-		goto out;
+		return FALSE;
 	}
-out:
-	sqlite3_free (statement);
-	return ret;
+	priv->in_transaction = FALSE;
+	return TRUE;
+}
+
+gboolean
+fu_pending_add_device (FuPending *pending, FwupdResult *res, GError **error)
+{
+	FuPendingPrivate *priv = GET_PRIVATE (pending);
+	FwupdDevice *dev = fwupd_result_get_device (res);
+	FwupdRelease *rel = fwupd_result_get_release (res);
+
+	g_return_val_if_fail (FU_IS_PENDING (pending), FALSE);
+
+	/* lazy load */
+	if (priv->db == NULL) {
+		if (!fu_pending_load (pending, error))
+			return FALSE;
+	}
+
+	g_debug ("FuPending: add device %s", fwupd_device_get_id (dev));
+	if (!fu_pending_stmt_prepare (pending, &priv->stmt_add_device,
+				      "INSERT INTO pending (device_id,"
+							   "unique_id,"
+							   "state,"
+							   "filename,"
+							   "display_name,"
+							   "provider,"
+							   "version_old,"
+							   "version_new) "
+				      "VALUES (?1,?2,?3,?4,?5,?6,?7,?8)",
+				      error))
+		return FALSE;
+
+	/* insert entry */
+	sqlite3_bind_text (priv->stmt_add_device, 1,
+			   fwupd_device_get_id (dev), -1, SQLITE_TRANSIENT);
+	sqlite3_bind_text (priv->stmt_add_device, 2,
+			   fwupd_result_get_unique_id (res), -1, SQLITE_TRANSIENT);
+	sqlite3_bind_int (priv->stmt_add_device, 3,
+			  FWUPD_UPDATE_STATE_PENDING);
+	sqlite3_bind_text (priv->stmt_add_device, 4,
+			   fwupd_release_get_filename (rel), -1, SQLITE_TRANSIENT);
+	sqlite3_bind_text (priv->stmt_add_device, 5,
+			   fwupd_device_get_name (dev), -1, SQLITE_TRANSIENT);
+	sqlite3_bind_text (priv->stmt_add_device, 6,
+			   fwupd_device_get_provider (dev), -1, SQLITE_TRANSIENT);
+	sqlite3_bind_text (priv->stmt_add_device, 7,
+			   fwupd_device_get_version (dev), -1, SQLITE_TRANSIENT);
+	sqlite3_bind_text (priv->stmt_add_device, 8,
+			   fwupd_release_get_version (rel), -1, SQLITE_TRANSIENT);
+	return fu_pending_stmt_run (pending, priv->stmt_add_device, error);
+}
+
+gboolean
+fu_pending_remove_device (FuPending *pending, FwupdResult *res, GError **error)
+{
+	FuPendingPrivate *priv = GET_PRIVATE (pending);
+	FwupdDevice *dev = fwupd_result_get_device (res);
+
+	g_return_val_if_fail (FU_IS_PENDING (pending), FALSE);
+
+	/* lazy load */
+	if (priv->db == NULL) {
+		if (!fu_pending_load (pending, error))
+			return FALSE;
+	}
+
+	g_debug ("FuPending: remove device %s", fwupd_device_get_id (dev));
+
+	/* archive the final row into the bounded per-device history */
+	if (!fu_pending_stmt_prepare (pending, &priv->stmt_history_add,
+				      "INSERT INTO history (device_id,"
+							   "timestamp,"
+							   "state,"
+							   "error,"
+							   "version_old,"
+							   "version_new) "
+				      "SELECT device_id,timestamp,state,error,"
+					     "version_old,version_new "
+				      "FROM pending WHERE device_id = ?1;",
+				      error))
+		return FALSE;
+	sqlite3_bind_text (priv->stmt_history_add, 1,
+			   fwupd_device_get_id (dev), -1, SQLITE_TRANSIENT);
+	if (!fu_pending_stmt_run (pending, priv->stmt_history_add, error))
+		return FALSE;
+
+	/* prune the ring so fleet-aged installs stay bounded */
+	if (!fu_pending_stmt_prepare (pending, &priv->stmt_history_prune,
+				      "DELETE FROM history WHERE device_id = ?1 "
+				      "AND id NOT IN (SELECT id FROM history "
+				      "WHERE device_id = ?1 "
+				      "ORDER BY id DESC LIMIT ?2);",
+				      error))
+		return FALSE;
+	sqlite3_bind_text (priv->stmt_history_prune, 1,
+			   fwupd_device_get_id (dev), -1, SQLITE_TRANSIENT);
+	sqlite3_bind_int (priv->stmt_history_prune, 2, priv->history_depth);
+	if (!fu_pending_stmt_run (pending, priv->stmt_history_prune, error))
+		return FALSE;
+
+	if (!fu_pending_stmt_prepare (pending, &priv->stmt_remove_device,
+				      "DELETE FROM pending WHERE device_id = ?1;",
+				      error))
+		return FALSE;
+
+	/* remove entry */
+	sqlite3_bind_text (priv->stmt_remove_device, 1,
+			   fwupd_device_get_id (dev), -1, SQLITE_TRANSIENT);
+	return fu_pending_stmt_run (pending, priv->stmt_remove_device, error);
 }
 
 static gint
@@ -302,6 +541,11 @@ fu_pending_device_sqlite_cb (void *data,
 				fwupd_result_set_update_error (res, argv[i]);
 			continue;
 		}
+		if (g_strcmp0 (col_name[i], "checkpoint_phase") == 0 ||
+		    g_strcmp0 (col_name[i], "checkpoint_offset") == 0) {
+			/* only interesting via fu_pending_get_checkpoint() */
+			continue;
+		}
 		g_warning ("unhandled %s=%s", col_name[i], argv[i]);
 	}
 
@@ -403,6 +647,21 @@ out:
 	return array;
 }
 
+guint64
+fu_pending_get_memory_used (FuPending *pending)
+{
+	FuPendingPrivate *priv = GET_PRIVATE (pending);
+
+	g_return_val_if_fail (FU_IS_PENDING (pending), 0);
+
+	/* nothing has hit the database yet */
+	if (priv->db == NULL)
+		return 0;
+
+	/* this includes the page cache and any prepared statements */
+	return (guint64) sqlite3_memory_used ();
+}
+
 gboolean
 fu_pending_set_state (FuPending *pending,
 		      FwupdResult *res,
@@ -411,10 +670,6 @@ fu_pending_set_state (FuPending *pending,
 {
 	FuPendingPrivate *priv = GET_PRIVATE (pending);
 	FwupdDevice *dev = fwupd_result_get_device (res);
-	char *error_msg = NULL;
-	char *statement;
-	gboolean ret = TRUE;
-	gint rc;
 
 	g_return_val_if_fail (FU_IS_PENDING (pending), FALSE);
 
@@ -427,35 +682,170 @@ fu_pending_set_state (FuPending *pending,
 	g_debug ("FuPending: set state of %s to %s",
 		 fwupd_device_get_id (dev),
 		 fwupd_update_state_to_string (state));
-	statement = sqlite3_mprintf ("UPDATE pending SET state='%i' WHERE "
-				     "device_id = '%q';",
-				     state, fwupd_device_get_id (dev));
+	if (!fu_pending_stmt_prepare (pending, &priv->stmt_set_state,
+				      "UPDATE pending SET state = ?1 WHERE "
+				      "device_id = ?2;",
+				      error))
+		return FALSE;
 
-	/* remove entry */
-	rc = sqlite3_exec (priv->db, statement, NULL, NULL, &error_msg);
+	/* update entry */
+	sqlite3_bind_int (priv->stmt_set_state, 1, state);
+	sqlite3_bind_text (priv->stmt_set_state, 2,
+			   fwupd_device_get_id (dev), -1, SQLITE_TRANSIENT);
+	return fu_pending_stmt_run (pending, priv->stmt_set_state, error);
+}
+
+gboolean
+fu_pending_shutdown_flush (FuPending *pending, GError **error)
+{
+	FuPendingPrivate *priv = GET_PRIVATE (pending);
+	char *error_msg = NULL;
+	gint rc;
+
+	g_return_val_if_fail (FU_IS_PENDING (pending), FALSE);
+
+	/* never loaded, nothing to reconcile on disk */
+	if (priv->db == NULL)
+		return TRUE;
+
+	/* land any open transaction */
+	if (priv->in_transaction) {
+		if (!fu_pending_transaction_commit (pending, error))
+			return FALSE;
+	}
+
+	/* fold the whole WAL back into the main database in one pass, so
+	 * nothing is left to replay when the next boot opens the file */
+	g_debug ("FuPending: checkpointing WAL for shutdown");
+	rc = sqlite3_exec (priv->db, "PRAGMA wal_checkpoint(TRUNCATE);",
+			   NULL, NULL, &error_msg);
 	if (rc != SQLITE_OK) {
 		g_set_error (error,
 			     FWUPD_ERROR,
 			     FWUPD_ERROR_WRITE,
-			     "SQL error: %s",
+			     "Cannot checkpoint database: %s",
 			     error_msg);
 		sqlite3_free (error_msg);
-		ret = FALSE;
-		goto out;
+		return FALSE;
 	}
-out:
-	sqlite3_free (statement);
-	return ret;
+	return TRUE;
 }
 
 gboolean
-fu_pending_set_error_msg (FuPending *pending,
-			  FwupdResult *res,
-			  const gchar *error_msg2,
-			  GError **error)
+fu_pending_set_transfer_stats (FuPending *pending,
+			       FwupdResult *res,
+			       guint64 transfer_bytes,
+			       guint update_duration_ms,
+			       guint transfer_stall_ms,
+			       guint transfer_retries,
+			       GError **error)
+{
+	FuPendingPrivate *priv = GET_PRIVATE (pending);
+	FwupdDevice *dev = fwupd_result_get_device (res);
+
+	g_return_val_if_fail (FU_IS_PENDING (pending), FALSE);
+
+	/* lazy load */
+	if (priv->db == NULL) {
+		if (!fu_pending_load (pending, error))
+			return FALSE;
+	}
+
+	g_debug ("FuPending: set transfer stats of %s to "
+		 "%" G_GUINT64_FORMAT "b/%ums/%ums/%u",
+		 fwupd_device_get_id (dev),
+		 transfer_bytes, update_duration_ms,
+		 transfer_stall_ms, transfer_retries);
+	if (!fu_pending_stmt_prepare (pending, &priv->stmt_set_transfer,
+				      "UPDATE pending SET "
+				      "transfer_bytes = ?1, "
+				      "update_duration_ms = ?2, "
+				      "transfer_stall_ms = ?3, "
+				      "transfer_retries = ?4 WHERE "
+				      "device_id = ?5;",
+				      error))
+		return FALSE;
+
+	/* update entry */
+	sqlite3_bind_int64 (priv->stmt_set_transfer, 1, (sqlite3_int64) transfer_bytes);
+	sqlite3_bind_int (priv->stmt_set_transfer, 2, update_duration_ms);
+	sqlite3_bind_int (priv->stmt_set_transfer, 3, transfer_stall_ms);
+	sqlite3_bind_int (priv->stmt_set_transfer, 4, transfer_retries);
+	sqlite3_bind_text (priv->stmt_set_transfer, 5,
+			   fwupd_device_get_id (dev), -1, SQLITE_TRANSIENT);
+	return fu_pending_stmt_run (pending, priv->stmt_set_transfer, error);
+}
+
+gboolean
+fu_pending_set_checkpoint (FuPending *pending,
+			   FwupdResult *res,
+			   FuPendingPhase phase,
+			   guint64 offset,
+			   GError **error)
 {
 	FuPendingPrivate *priv = GET_PRIVATE (pending);
 	FwupdDevice *dev = fwupd_result_get_device (res);
+
+	g_return_val_if_fail (FU_IS_PENDING (pending), FALSE);
+
+	/* lazy load */
+	if (priv->db == NULL) {
+		if (!fu_pending_load (pending, error))
+			return FALSE;
+	}
+
+	g_debug ("FuPending: set checkpoint of %s to %u@%" G_GUINT64_FORMAT,
+		 fwupd_device_get_id (dev), phase, offset);
+	if (!fu_pending_stmt_prepare (pending, &priv->stmt_set_checkpoint,
+				      "UPDATE pending SET "
+				      "checkpoint_phase = ?1, "
+				      "checkpoint_offset = ?2 WHERE "
+				      "device_id = ?3;",
+				      error))
+		return FALSE;
+
+	/* update entry */
+	sqlite3_bind_int (priv->stmt_set_checkpoint, 1, phase);
+	sqlite3_bind_int64 (priv->stmt_set_checkpoint, 2, (sqlite3_int64) offset);
+	sqlite3_bind_text (priv->stmt_set_checkpoint, 3,
+			   fwupd_device_get_id (dev), -1, SQLITE_TRANSIENT);
+	return fu_pending_stmt_run (pending, priv->stmt_set_checkpoint, error);
+}
+
+typedef struct {
+	FuPendingPhase		 phase;
+	guint64			 offset;
+	gboolean		 found;
+} FuPendingCheckpoint;
+
+static gint
+fu_pending_checkpoint_sqlite_cb (void *data,
+				 gint argc,
+				 gchar **argv,
+				 gchar **col_name)
+{
+	FuPendingCheckpoint *ckpt = (FuPendingCheckpoint *) data;
+	for (gint i = 0; i < argc; i++) {
+		if (g_strcmp0 (col_name[i], "checkpoint_phase") == 0 &&
+		    argv[i] != NULL)
+			ckpt->phase = atoi (argv[i]);
+		if (g_strcmp0 (col_name[i], "checkpoint_offset") == 0 &&
+		    argv[i] != NULL)
+			ckpt->offset = g_ascii_strtoull (argv[i], NULL, 10);
+	}
+	ckpt->found = TRUE;
+	return 0;
+}
+
+gboolean
+fu_pending_get_checkpoint (FuPending *pending,
+			   const gchar *device_id,
+			   FuPendingPhase *phase,
+			   guint64 *offset,
+			   GError **error)
+{
+	FuPendingPrivate *priv = GET_PRIVATE (pending);
+	FuPendingCheckpoint ckpt = { FU_PENDING_PHASE_NONE, 0, FALSE };
 	char *error_msg = NULL;
 	char *statement;
 	gboolean ret = TRUE;
@@ -469,30 +859,75 @@ fu_pending_set_error_msg (FuPending *pending,
 			return FALSE;
 	}
 
-	g_debug ("FuPending: add comment to %s: %s",
-		 fwupd_device_get_id (dev), error_msg2);
-	statement = sqlite3_mprintf ("UPDATE pending SET error='%q' WHERE "
-				     "device_id = '%q';",
-				     error_msg2,
-				     fwupd_device_get_id (dev));
-
-	/* remove entry */
-	rc = sqlite3_exec (priv->db, statement, NULL, NULL, &error_msg);
+	statement = sqlite3_mprintf ("SELECT checkpoint_phase,checkpoint_offset "
+				     "FROM pending WHERE device_id = '%q';",
+				     device_id);
+	rc = sqlite3_exec (priv->db,
+			   statement,
+			   fu_pending_checkpoint_sqlite_cb,
+			   &ckpt,
+			   &error_msg);
 	if (rc != SQLITE_OK) {
 		g_set_error (error,
 			     FWUPD_ERROR,
-			     FWUPD_ERROR_WRITE,
+			     FWUPD_ERROR_READ,
 			     "SQL error: %s",
 			     error_msg);
 		sqlite3_free (error_msg);
 		ret = FALSE;
 		goto out;
 	}
+	if (!ckpt.found) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_FOUND,
+			     "no pending entry for %s",
+			     device_id);
+		ret = FALSE;
+		goto out;
+	}
+	if (phase != NULL)
+		*phase = ckpt.phase;
+	if (offset != NULL)
+		*offset = ckpt.offset;
 out:
 	sqlite3_free (statement);
 	return ret;
 }
 
+gboolean
+fu_pending_set_error_msg (FuPending *pending,
+			  FwupdResult *res,
+			  const gchar *error_msg2,
+			  GError **error)
+{
+	FuPendingPrivate *priv = GET_PRIVATE (pending);
+	FwupdDevice *dev = fwupd_result_get_device (res);
+
+	g_return_val_if_fail (FU_IS_PENDING (pending), FALSE);
+
+	/* lazy load */
+	if (priv->db == NULL) {
+		if (!fu_pending_load (pending, error))
+			return FALSE;
+	}
+
+	g_debug ("FuPending: add comment to %s: %s",
+		 fwupd_device_get_id (dev), error_msg2);
+	if (!fu_pending_stmt_prepare (pending, &priv->stmt_set_error_msg,
+				      "UPDATE pending SET error = ?1 WHERE "
+				      "device_id = ?2;",
+				      error))
+		return FALSE;
+
+	/* update entry */
+	sqlite3_bind_text (priv->stmt_set_error_msg, 1,
+			   error_msg2, -1, SQLITE_TRANSIENT);
+	sqlite3_bind_text (priv->stmt_set_error_msg, 2,
+			   fwupd_device_get_id (dev), -1, SQLITE_TRANSIENT);
+	return fu_pending_stmt_run (pending, priv->stmt_set_error_msg, error);
+}
+
 static void
 fu_pending_class_init (FuPendingClass *klass)
 {
@@ -503,6 +938,8 @@ fu_pending_class_init (FuPendingClass *klass)
 static void
 fu_pending_init (FuPending *pending)
 {
+	FuPendingPrivate *priv = GET_PRIVATE (pending);
+	priv->history_depth = FU_PENDING_HISTORY_DEPTH_DEFAULT;
 }
 
 static void
@@ -511,8 +948,21 @@ fu_pending_finalize (GObject *object)
 	FuPending *pending = FU_PENDING (object);
 	FuPendingPrivate *priv = GET_PRIVATE (pending);
 
-	if (priv->db != NULL)
+	if (priv->db != NULL) {
+		if (priv->in_transaction) {
+			g_warning ("FuPending: transaction not committed, flushing");
+			sqlite3_exec (priv->db, "COMMIT;", NULL, NULL, NULL);
+		}
+		sqlite3_finalize (priv->stmt_add_device);
+		sqlite3_finalize (priv->stmt_remove_device);
+		sqlite3_finalize (priv->stmt_set_state);
+		sqlite3_finalize (priv->stmt_set_error_msg);
+		sqlite3_finalize (priv->stmt_set_transfer);
+		sqlite3_finalize (priv->stmt_set_checkpoint);
+		sqlite3_finalize (priv->stmt_history_add);
+		sqlite3_finalize (priv->stmt_history_prune);
 		sqlite3_close (priv->db);
+	}
 
 	G_OBJECT_CLASS (fu_pending_parent_class)->finalize (object);
 }
@@ -36,8 +36,25 @@ struct _FuPendingClass
 	GObjectClass		 parent_class;
 };
 
+/* how far through the payload an interrupted session got, persisted per
+ * device so the next attempt can skip or resume instead of starting over */
+typedef enum {
+	FU_PENDING_PHASE_NONE,		/* nothing attempted yet */
+	FU_PENDING_PHASE_WRITING,	/* payload transfer was in progress */
+	FU_PENDING_PHASE_COMPLETE,	/* device fully flashed and cleaned up */
+	FU_PENDING_PHASE_LAST
+} FuPendingPhase;
+
 FuPending	*fu_pending_new				(void);
 
+void		 fu_pending_set_read_only		(FuPending	*pending,
+							 gboolean	 read_only);
+void		 fu_pending_set_history_depth		(FuPending	*pending,
+							 guint		 history_depth);
+gboolean	 fu_pending_transaction_begin		(FuPending	*pending,
+							 GError		**error);
+gboolean	 fu_pending_transaction_commit		(FuPending	*pending,
+							 GError		**error);
 gboolean	 fu_pending_add_device			(FuPending	*pending,
 							 FwupdResult	*res,
 							 GError		**error);
@@ -45,6 +62,23 @@ gboolean	 fu_pending_set_state			(FuPending	*pending,
 							 FwupdResult	*res,
 							 FwupdUpdateState	 state,
 							 GError		**error);
+gboolean	 fu_pending_set_transfer_stats		(FuPending	*pending,
+							 FwupdResult	*res,
+							 guint64	 transfer_bytes,
+							 guint		 update_duration_ms,
+							 guint		 transfer_stall_ms,
+							 guint		 transfer_retries,
+							 GError		**error);
+gboolean	 fu_pending_set_checkpoint		(FuPending	*pending,
+							 FwupdResult	*res,
+							 FuPendingPhase	 phase,
+							 guint64	 offset,
+							 GError		**error);
+gboolean	 fu_pending_get_checkpoint		(FuPending	*pending,
+							 const gchar	*device_id,
+							 FuPendingPhase	*phase,
+							 guint64	*offset,
+							 GError		**error);
 gboolean	 fu_pending_set_error_msg		(FuPending	*pending,
 							 FwupdResult	*res,
 							 const gchar	*error_msg,
@@ -57,6 +91,9 @@ FwupdResult	*fu_pending_get_device			(FuPending	*pending,
 							 GError		**error);
 GPtrArray	*fu_pending_get_devices			(FuPending	*pending,
 							 GError		**error);
+guint64		 fu_pending_get_memory_used		(FuPending	*pending);
+gboolean	 fu_pending_shutdown_flush		(FuPending	*pending,
+							 GError		**error);
 
 G_END_DECLS
 
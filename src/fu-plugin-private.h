@@ -31,8 +31,20 @@ G_BEGIN_DECLS
 FuPlugin	*fu_plugin_new				(void);
 void		 fu_plugin_set_usb_context		(FuPlugin	*plugin,
 							 GUsbContext	*usb_ctx);
+void		 fu_plugin_set_udev_backend		(FuPlugin	*plugin,
+							 FuUdevBackend	*udev_backend);
 void		 fu_plugin_set_hwids			(FuPlugin	*plugin,
 							 GHashTable	*hwids);
+void		 fu_plugin_set_smbios			(FuPlugin	*plugin,
+							 FuSmbios	*smbios);
+GPtrArray	*fu_plugin_get_coldplug_dependencies	(FuPlugin	*plugin);
+guint		 fu_plugin_get_cache_size		(FuPlugin	*plugin);
+guint64		 fu_plugin_get_transfer_bytes		(FuPlugin	*plugin);
+guint		 fu_plugin_get_transfer_stall_ms	(FuPlugin	*plugin);
+guint		 fu_plugin_get_transfer_retries		(FuPlugin	*plugin);
+guint		 fu_plugin_get_update_duration_ms	(FuPlugin	*plugin);
+gboolean	 fu_plugin_get_deprioritized		(FuPlugin	*plugin);
+gchar		*fu_plugin_get_runtime_stats		(FuPlugin	*plugin);
 gboolean	 fu_plugin_open				(FuPlugin	*plugin,
 							 const gchar	*filename,
 							 GError		**error);
@@ -63,6 +75,8 @@ gboolean	 fu_plugin_runner_verify		(FuPlugin	*plugin,
 gboolean	 fu_plugin_runner_unlock		(FuPlugin	*plugin,
 							 FuDevice	*device,
 							 GError		**error);
+gboolean	 fu_plugin_runner_pending_commit	(FuPlugin	*plugin,
+							 GError		**error);
 gboolean	 fu_plugin_runner_clear_results		(FuPlugin	*plugin,
 							 FuDevice	*device,
 							 GError		**error);
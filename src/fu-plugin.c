@@ -31,22 +31,86 @@
 #include <valgrind.h>
 #endif /* HAVE_VALGRIND */
 
+#include "fu-debug.h"
 #include "fu-plugin-private.h"
 #include "fu-pending.h"
+#include "fu-trace.h"
 
 #define	FU_PLUGIN_COLDPLUG_DELAY_MAXIMUM	3000u	/* ms */
 
 static void fu_plugin_finalize			 (GObject *object);
 
+typedef const gchar	*(*FuPluginGetNameFunc)		(void);
+typedef void		 (*FuPluginInitFunc)		(FuPlugin	*plugin);
+typedef gboolean	 (*FuPluginStartupFunc)		(FuPlugin	*plugin,
+							 GError		**error);
+typedef gboolean	 (*FuPluginDeviceFunc)		(FuPlugin	*plugin,
+							 FuDevice	*device,
+							 GError		**error);
+typedef gboolean	 (*FuPluginVerifyFunc)		(FuPlugin	*plugin,
+							 FuDevice	*device,
+							 FuPluginVerifyFlags flags,
+							 GError		**error);
+typedef gboolean	 (*FuPluginUpdateFunc)		(FuPlugin	*plugin,
+							 FuDevice	*device,
+							 GBytes		*blob_fw,
+							 FwupdInstallFlags flags,
+							 GError		**error);
+
+/* the optional entry points a module exports, resolved once at load time so
+ * the runner functions do not have to ask the dynamic linker on every call */
+typedef struct {
+	FuPluginInitFunc	 init;
+	FuPluginInitFunc	 destroy;
+	FuPluginStartupFunc	 startup;
+	FuPluginStartupFunc	 coldplug;
+	FuPluginStartupFunc	 coldplug_prepare;
+	FuPluginStartupFunc	 coldplug_cleanup;
+	FuPluginDeviceFunc	 update_prepare;
+	FuPluginDeviceFunc	 update_cleanup;
+	FuPluginVerifyFunc	 verify;
+	FuPluginDeviceFunc	 unlock;
+	FuPluginUpdateFunc	 update_online;
+	FuPluginUpdateFunc	 update_offline;
+	FuPluginDeviceFunc	 clear_result;
+	FuPluginDeviceFunc	 get_results;
+} FuPluginVfuncs;
+
+/* a vfunc call that overruns its budget gets the plugin deprioritized,
+ * so one wedged device cannot hold every other plugin back on the next
+ * recoldplug; the update budget is generous as slow flashes are normal */
+#define FU_PLUGIN_BUDGET_COLDPLUG_MS	5000
+#define FU_PLUGIN_BUDGET_UPDATE_MS	(10 * 60 * 1000)
+
+typedef struct {
+	guint			 cnt;
+	guint			 over_budget_cnt;
+	guint64			 wall_us;
+	guint64			 wall_max_us;
+} FuPluginRuntimeStat;
+
 typedef struct {
 	GModule			*module;
 	GUsbContext		*usb_ctx;
+	FuUdevBackend		*udev_backend;
 	gboolean		 enabled;
 	gchar			*name;
 	GHashTable		*hwids;		/* hwid:1 */
+	FuSmbios		*smbios;
 	GHashTable		*devices;	/* platform_id:GObject */
 	GHashTable		*devices_delay;	/* FuDevice:FuPluginHelper */
+	GPtrArray		*coldplug_deps;	/* of plugin name */
+	GThread			*thread_init;
+	FuPending		*pending;
 	FuPluginData		*data;
+	FuPluginVfuncs		 vfuncs;
+	guint64			 transfer_bytes;
+	guint			 transfer_stall_ms;
+	guint			 transfer_retries;
+	guint			 update_duration_ms;
+	GHashTable		*runtime_stats;	/* of vfunc name : FuPluginRuntimeStat */
+	GMutex			 runtime_mutex;
+	gboolean		 deprioritized;
 } FuPluginPrivate;
 
 enum {
@@ -64,23 +128,6 @@ static guint signals[SIGNAL_LAST] = { 0 };
 G_DEFINE_TYPE_WITH_PRIVATE (FuPlugin, fu_plugin, G_TYPE_OBJECT)
 #define GET_PRIVATE(o) (fu_plugin_get_instance_private (o))
 
-typedef const gchar	*(*FuPluginGetNameFunc)		(void);
-typedef void		 (*FuPluginInitFunc)		(FuPlugin	*plugin);
-typedef gboolean	 (*FuPluginStartupFunc)		(FuPlugin	*plugin,
-							 GError		**error);
-typedef gboolean	 (*FuPluginDeviceFunc)		(FuPlugin	*plugin,
-							 FuDevice	*device,
-							 GError		**error);
-typedef gboolean	 (*FuPluginVerifyFunc)		(FuPlugin	*plugin,
-							 FuDevice	*device,
-							 FuPluginVerifyFlags flags,
-							 GError		**error);
-typedef gboolean	 (*FuPluginUpdateFunc)		(FuPlugin	*plugin,
-							 FuDevice	*device,
-							 GBytes		*blob_fw,
-							 FwupdInstallFlags flags,
-							 GError		**error);
-
 /**
  * fu_plugin_get_name:
  * @plugin: A #FuPlugin
@@ -156,6 +203,56 @@ fu_plugin_cache_remove (FuPlugin *plugin, const gchar *id)
 	g_hash_table_remove (priv->devices, id);
 }
 
+guint
+fu_plugin_get_cache_size (FuPlugin *plugin)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (plugin);
+	g_return_val_if_fail (FU_IS_PLUGIN (plugin), 0);
+	return g_hash_table_size (priv->devices);
+}
+
+guint64
+fu_plugin_get_transfer_bytes (FuPlugin *plugin)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (plugin);
+	g_return_val_if_fail (FU_IS_PLUGIN (plugin), 0);
+	return priv->transfer_bytes;
+}
+
+guint
+fu_plugin_get_transfer_stall_ms (FuPlugin *plugin)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (plugin);
+	g_return_val_if_fail (FU_IS_PLUGIN (plugin), 0);
+	return priv->transfer_stall_ms;
+}
+
+guint
+fu_plugin_get_transfer_retries (FuPlugin *plugin)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (plugin);
+	g_return_val_if_fail (FU_IS_PLUGIN (plugin), 0);
+	return priv->transfer_retries;
+}
+
+guint
+fu_plugin_get_update_duration_ms (FuPlugin *plugin)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (plugin);
+	g_return_val_if_fail (FU_IS_PLUGIN (plugin), 0);
+	return priv->update_duration_ms;
+}
+
+static void
+fu_plugin_transfer_stats_reset (FuPlugin *plugin)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (plugin);
+	priv->transfer_bytes = 0;
+	priv->transfer_stall_ms = 0;
+	priv->transfer_retries = 0;
+	priv->update_duration_ms = 0;
+}
+
 /**
  * fu_plugin_get_data:
  * @plugin: A #FuPlugin
@@ -223,6 +320,32 @@ fu_plugin_set_usb_context (FuPlugin *plugin, GUsbContext *usb_ctx)
 	g_set_object (&priv->usb_ctx, usb_ctx);
 }
 
+/**
+ * fu_plugin_get_udev_backend:
+ * @plugin: A #FuPlugin
+ *
+ * Gets the shared udev backend that all plugins can use, rather than each
+ * plugin walking sysfs with a private #GUdevClient.
+ *
+ * Returns: (transfer none): a #FuUdevBackend, or %NULL if not set.
+ *
+ * Since: 0.9.5
+ **/
+FuUdevBackend *
+fu_plugin_get_udev_backend (FuPlugin *plugin)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (plugin);
+	g_return_val_if_fail (FU_IS_PLUGIN (plugin), NULL);
+	return priv->udev_backend;
+}
+
+void
+fu_plugin_set_udev_backend (FuPlugin *plugin, FuUdevBackend *udev_backend)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (plugin);
+	g_set_object (&priv->udev_backend, udev_backend);
+}
+
 /**
  * fu_plugin_get_enabled:
  * @plugin: A #FuPlugin
@@ -262,8 +385,8 @@ gboolean
 fu_plugin_open (FuPlugin *plugin, const gchar *filename, GError **error)
 {
 	FuPluginPrivate *priv = GET_PRIVATE (plugin);
-	FuPluginInitFunc func = NULL;
 	gchar *str;
+	gint64 timing = fu_debug_timing_start ();
 
 	priv->module = g_module_open (filename, 0);
 	if (priv->module == NULL) {
@@ -282,13 +405,45 @@ fu_plugin_open (FuPlugin *plugin, const gchar *filename, GError **error)
 		g_strdelimit (priv->name, ".", '\0');
 	}
 
+	/* resolve all the optional entry points up front; every runner call
+	 * is then a plain indirect call, and unimplemented vfuncs can be
+	 * skipped without touching the dynamic linker */
+	g_module_symbol (priv->module, "fu_plugin_init",
+			 (gpointer *) &priv->vfuncs.init);
+	g_module_symbol (priv->module, "fu_plugin_destroy",
+			 (gpointer *) &priv->vfuncs.destroy);
+	g_module_symbol (priv->module, "fu_plugin_startup",
+			 (gpointer *) &priv->vfuncs.startup);
+	g_module_symbol (priv->module, "fu_plugin_coldplug",
+			 (gpointer *) &priv->vfuncs.coldplug);
+	g_module_symbol (priv->module, "fu_plugin_coldplug_prepare",
+			 (gpointer *) &priv->vfuncs.coldplug_prepare);
+	g_module_symbol (priv->module, "fu_plugin_coldplug_cleanup",
+			 (gpointer *) &priv->vfuncs.coldplug_cleanup);
+	g_module_symbol (priv->module, "fu_plugin_update_prepare",
+			 (gpointer *) &priv->vfuncs.update_prepare);
+	g_module_symbol (priv->module, "fu_plugin_update_cleanup",
+			 (gpointer *) &priv->vfuncs.update_cleanup);
+	g_module_symbol (priv->module, "fu_plugin_verify",
+			 (gpointer *) &priv->vfuncs.verify);
+	g_module_symbol (priv->module, "fu_plugin_unlock",
+			 (gpointer *) &priv->vfuncs.unlock);
+	g_module_symbol (priv->module, "fu_plugin_update_online",
+			 (gpointer *) &priv->vfuncs.update_online);
+	g_module_symbol (priv->module, "fu_plugin_update_offline",
+			 (gpointer *) &priv->vfuncs.update_offline);
+	g_module_symbol (priv->module, "fu_plugin_clear_result",
+			 (gpointer *) &priv->vfuncs.clear_result);
+	g_module_symbol (priv->module, "fu_plugin_get_results",
+			 (gpointer *) &priv->vfuncs.get_results);
+
 	/* optional */
-	g_module_symbol (priv->module, "fu_plugin_init", (gpointer *) &func);
-	if (func != NULL) {
+	if (priv->vfuncs.init != NULL) {
 		g_debug ("performing init() on %s", filename);
-		func (plugin);
+		priv->vfuncs.init (plugin);
 	}
 
+	fu_debug_timing_end (timing, "plugin-open{%s}", priv->name);
 	return TRUE;
 }
 
@@ -307,6 +462,42 @@ fu_plugin_open (FuPlugin *plugin, const gchar *filename, GError **error)
  *
  * Since: 0.8.0
  **/
+typedef struct {
+	FuPlugin	*plugin;
+	FuDevice	*device;
+	guint		 signal_id;
+} FuPluginEmitHelper;
+
+static gboolean
+fu_plugin_emit_idle_cb (gpointer user_data)
+{
+	FuPluginEmitHelper *helper = (FuPluginEmitHelper *) user_data;
+	g_signal_emit (helper->plugin, signals[helper->signal_id], 0, helper->device);
+	g_object_unref (helper->plugin);
+	g_object_unref (helper->device);
+	g_free (helper);
+	return FALSE;
+}
+
+/* the daemon runs coldplug on worker threads, but signal handlers in fu-main
+ * expect to run in the default main context */
+static void
+fu_plugin_emit_device_signal (FuPlugin *plugin, FuDevice *device, guint signal_id)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (plugin);
+	FuPluginEmitHelper *helper;
+
+	if (g_thread_self () == priv->thread_init) {
+		g_signal_emit (plugin, signals[signal_id], 0, device);
+		return;
+	}
+	helper = g_new0 (FuPluginEmitHelper, 1);
+	helper->plugin = g_object_ref (plugin);
+	helper->device = g_object_ref (device);
+	helper->signal_id = signal_id;
+	g_idle_add (fu_plugin_emit_idle_cb, helper);
+}
+
 void
 fu_plugin_device_add (FuPlugin *plugin, FuDevice *device)
 {
@@ -318,7 +509,7 @@ fu_plugin_device_add (FuPlugin *plugin, FuDevice *device)
 		 fu_device_get_id (device));
 	fu_device_set_created (device, (guint64) g_get_real_time () / G_USEC_PER_SEC);
 	fu_device_set_plugin (device, fu_plugin_get_name (plugin));
-	g_signal_emit (plugin, signals[SIGNAL_DEVICE_ADDED], 0, device);
+	fu_plugin_emit_device_signal (plugin, device, SIGNAL_DEVICE_ADDED);
 }
 
 typedef struct {
@@ -431,7 +622,7 @@ fu_plugin_device_remove (FuPlugin *plugin, FuDevice *device)
 	g_debug ("emit removed from %s: %s",
 		 fu_plugin_get_name (plugin),
 		 fu_device_get_id (device));
-	g_signal_emit (plugin, signals[SIGNAL_DEVICE_REMOVED], 0, device);
+	fu_plugin_emit_device_signal (plugin, device, SIGNAL_DEVICE_REMOVED);
 }
 
 /**
@@ -469,6 +660,61 @@ fu_plugin_set_percentage (FuPlugin *plugin, guint percentage)
 		       percentage);
 }
 
+/**
+ * fu_plugin_add_transfer_bytes:
+ * @plugin: A #FuPlugin
+ * @bytes: the number of bytes written to the device
+ *
+ * Accounts payload bytes actually transferred to the device, so slow
+ * fleet updates can be blamed on the bus rather than the daemon.
+ * Only meaningful when called from the update vfuncs.
+ *
+ * Since: 0.9.5
+ **/
+void
+fu_plugin_add_transfer_bytes (FuPlugin *plugin, guint64 bytes)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (plugin);
+	g_return_if_fail (FU_IS_PLUGIN (plugin));
+	priv->transfer_bytes += bytes;
+}
+
+/**
+ * fu_plugin_add_transfer_stall:
+ * @plugin: A #FuPlugin
+ * @duration_ms: the time in milliseconds spent waiting
+ *
+ * Accounts time spent waiting for the device to report ready, e.g.
+ * polling a busy flag or sleeping between blocks, so programming time
+ * can be separated from transfer time in the update statistics.
+ *
+ * Since: 0.9.5
+ **/
+void
+fu_plugin_add_transfer_stall (FuPlugin *plugin, guint duration_ms)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (plugin);
+	g_return_if_fail (FU_IS_PLUGIN (plugin));
+	priv->transfer_stall_ms += duration_ms;
+}
+
+/**
+ * fu_plugin_add_transfer_retry:
+ * @plugin: A #FuPlugin
+ *
+ * Accounts one retried transfer during the update, typically after a
+ * NAK or a failed block verify.
+ *
+ * Since: 0.9.5
+ **/
+void
+fu_plugin_add_transfer_retry (FuPlugin *plugin)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (plugin);
+	g_return_if_fail (FU_IS_PLUGIN (plugin));
+	priv->transfer_retries++;
+}
+
 /**
  * fu_plugin_recoldplug:
  * @plugin: A #FuPlugin
@@ -485,6 +731,51 @@ fu_plugin_recoldplug (FuPlugin *plugin)
 	g_signal_emit (plugin, signals[SIGNAL_RECOLDPLUG], 0);
 }
 
+/**
+ * fu_plugin_wait_for_condition:
+ * @plugin: A #FuPlugin
+ * @timeout_ms: The maximum time to wait, in milliseconds
+ * @condition_cb: Returns %TRUE when the wait can end
+ * @user_data: Data passed to @condition_cb
+ * @error: A #GError or %NULL
+ *
+ * Waits for a device condition to hold, e.g. a bootloader to settle after
+ * reset, polling with an escalating delay so the wait ends almost as soon
+ * as the condition holds rather than sleeping for the worst case.
+ *
+ * Since: 0.9.5
+ **/
+gboolean
+fu_plugin_wait_for_condition (FuPlugin *plugin,
+			      guint timeout_ms,
+			      FuPluginConditionFunc condition_cb,
+			      gpointer user_data,
+			      GError **error)
+{
+	guint delay_ms = 10;
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	g_return_val_if_fail (FU_IS_PLUGIN (plugin), FALSE);
+	g_return_val_if_fail (condition_cb != NULL, FALSE);
+
+	do {
+		if (condition_cb (user_data))
+			return TRUE;
+		g_usleep (delay_ms * 1000);
+		if (delay_ms < 500)
+			delay_ms *= 2;
+	} while (g_timer_elapsed (timer, NULL) * 1000 < timeout_ms);
+
+	/* one last try so a slow condition check cannot eat the budget */
+	if (condition_cb (user_data))
+		return TRUE;
+	g_set_error (error,
+		     FWUPD_ERROR,
+		     FWUPD_ERROR_INTERNAL,
+		     "condition not met after %ums", timeout_ms);
+	return FALSE;
+}
+
 /**
  * fu_plugin_check_hwid:
  * @plugin: A #FuPlugin
@@ -513,6 +804,32 @@ fu_plugin_set_hwids (FuPlugin *plugin, GHashTable *hwids)
 	priv->hwids = g_hash_table_ref (hwids);
 }
 
+/**
+ * fu_plugin_get_smbios:
+ * @plugin: A #FuPlugin
+ *
+ * Gets the shared SMBIOS parser, which is populated from the DMI table with
+ * one read at daemon startup so plugins do not have to parse it themselves.
+ *
+ * Returns: (transfer none): a #FuSmbios, or %NULL if not available.
+ *
+ * Since: 0.9.5
+ **/
+FuSmbios *
+fu_plugin_get_smbios (FuPlugin *plugin)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (plugin);
+	g_return_val_if_fail (FU_IS_PLUGIN (plugin), NULL);
+	return priv->smbios;
+}
+
+void
+fu_plugin_set_smbios (FuPlugin *plugin, FuSmbios *smbios)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (plugin);
+	g_set_object (&priv->smbios, smbios);
+}
+
 /**
  * fu_plugin_set_coldplug_delay:
  * @plugin: A #FuPlugin
@@ -550,22 +867,145 @@ fu_plugin_set_coldplug_delay (FuPlugin *plugin, guint duration)
 	g_signal_emit (plugin, signals[SIGNAL_SET_COLDPLUG_DELAY], 0, duration);
 }
 
+/**
+ * fu_plugin_add_coldplug_dependency:
+ * @plugin: A #FuPlugin
+ * @name: A plugin name, e.g. "dell"
+ *
+ * Declares that this plugin must not start fu_plugin_coldplug() until the
+ * named plugin has finished its own coldplug. The daemon runs coldplug for
+ * independent plugins concurrently, and this is the only way to serialize
+ * two plugins that probe the same hardware.
+ *
+ * It is not an error if the named plugin does not exist or is disabled, as
+ * the dependency is then simply ignored.
+ *
+ * This function should be called from fu_plugin_init().
+ *
+ * Since: 0.9.5
+ **/
+void
+fu_plugin_add_coldplug_dependency (FuPlugin *plugin, const gchar *name)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (plugin);
+	g_return_if_fail (FU_IS_PLUGIN (plugin));
+	g_return_if_fail (name != NULL);
+	g_ptr_array_add (priv->coldplug_deps, g_strdup (name));
+}
+
+/* (transfer none): only for use by the daemon */
+GPtrArray *
+fu_plugin_get_coldplug_dependencies (FuPlugin *plugin)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (plugin);
+	g_return_val_if_fail (FU_IS_PLUGIN (plugin), NULL);
+	return priv->coldplug_deps;
+}
+
+/* records the wall time of one vfunc call; goes over the runtime mutex
+ * as coldplug runs plugins on worker threads while GetStats reads from
+ * the main loop */
+static void
+fu_plugin_runner_account (FuPlugin *plugin,
+			  const gchar *vfunc,
+			  gint64 ts_start,
+			  guint budget_ms)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (plugin);
+	FuPluginRuntimeStat *stat;
+	guint64 wall_us = (guint64) (g_get_monotonic_time () - ts_start);
+
+	g_mutex_lock (&priv->runtime_mutex);
+	stat = g_hash_table_lookup (priv->runtime_stats, vfunc);
+	if (stat == NULL) {
+		stat = g_new0 (FuPluginRuntimeStat, 1);
+		g_hash_table_insert (priv->runtime_stats, g_strdup (vfunc), stat);
+	}
+	stat->cnt++;
+	stat->wall_us += wall_us;
+	if (wall_us > stat->wall_max_us)
+		stat->wall_max_us = wall_us;
+	if (budget_ms > 0 && wall_us > (guint64) budget_ms * 1000) {
+		stat->over_budget_cnt++;
+		if (!priv->deprioritized) {
+			priv->deprioritized = TRUE;
+			g_warning ("%s spent %" G_GUINT64_FORMAT "ms in %s(), "
+				   "over its %ums budget; deprioritizing",
+				   priv->name, wall_us / 1000, vfunc, budget_ms);
+		}
+	}
+	g_mutex_unlock (&priv->runtime_mutex);
+}
+
+/* only for use by the daemon */
+gboolean
+fu_plugin_get_deprioritized (FuPlugin *plugin)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (plugin);
+	g_return_val_if_fail (FU_IS_PLUGIN (plugin), FALSE);
+	return priv->deprioritized;
+}
+
+/* formats the per-vfunc runtime accounting for the GetStats surface,
+ * or returns %NULL when the plugin has not run anything yet; only for
+ * use by the daemon */
+gchar *
+fu_plugin_get_runtime_stats (FuPlugin *plugin)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (plugin);
+	GHashTableIter iter;
+	GString *str;
+	gpointer key, value;
+
+	g_return_val_if_fail (FU_IS_PLUGIN (plugin), NULL);
+	g_mutex_lock (&priv->runtime_mutex);
+	if (g_hash_table_size (priv->runtime_stats) == 0) {
+		g_mutex_unlock (&priv->runtime_mutex);
+		return NULL;
+	}
+	str = g_string_new (priv->deprioritized ? "[deprioritized] " : "");
+	g_hash_table_iter_init (&iter, priv->runtime_stats);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		FuPluginRuntimeStat *stat = (FuPluginRuntimeStat *) value;
+		g_string_append_printf (str,
+					"%s: n=%u wall=%" G_GUINT64_FORMAT "ms "
+					"max=%" G_GUINT64_FORMAT "ms over=%u; ",
+					(const gchar *) key,
+					stat->cnt,
+					stat->wall_us / 1000,
+					stat->wall_max_us / 1000,
+					stat->over_budget_cnt);
+	}
+	g_mutex_unlock (&priv->runtime_mutex);
+	if (g_str_has_suffix (str->str, "; "))
+		g_string_truncate (str, str->len - 2);
+	return g_string_free (str, FALSE);
+}
+
 gboolean
 fu_plugin_runner_startup (FuPlugin *plugin, GError **error)
 {
 	FuPluginPrivate *priv = GET_PRIVATE (plugin);
 	FuPluginStartupFunc func = NULL;
+	gboolean ret;
+	gint64 ts_start;
 
 	/* not enabled */
 	if (!priv->enabled)
 		return TRUE;
 
 	/* optional */
-	g_module_symbol (priv->module, "fu_plugin_startup", (gpointer *) &func);
+	func = priv->vfuncs.startup;
 	if (func == NULL)
 		return TRUE;
 	g_debug ("performing startup() on %s", priv->name);
-	if (!func (plugin, error)) {
+	fu_trace2 (plugin_run, priv->name, "startup");
+	ts_start = g_get_monotonic_time ();
+	ret = func (plugin, error);
+	fu_plugin_runner_account (plugin, "startup", ts_start,
+				  FU_PLUGIN_BUDGET_COLDPLUG_MS);
+	fu_trace2 (plugin_done, priv->name, "startup");
+	if (!ret) {
 		g_prefix_error (error, "failed to startup %s: ", priv->name);
 		return FALSE;
 	}
@@ -621,17 +1061,25 @@ fu_plugin_runner_coldplug (FuPlugin *plugin, GError **error)
 {
 	FuPluginPrivate *priv = GET_PRIVATE (plugin);
 	FuPluginStartupFunc func = NULL;
+	gboolean ret;
+	gint64 ts_start;
 
 	/* not enabled */
 	if (!priv->enabled)
 		return TRUE;
 
 	/* optional */
-	g_module_symbol (priv->module, "fu_plugin_coldplug", (gpointer *) &func);
+	func = priv->vfuncs.coldplug;
 	if (func == NULL)
 		return TRUE;
 	g_debug ("performing coldplug() on %s", priv->name);
-	if (!func (plugin, error)) {
+	fu_trace2 (plugin_run, priv->name, "coldplug");
+	ts_start = g_get_monotonic_time ();
+	ret = func (plugin, error);
+	fu_plugin_runner_account (plugin, "coldplug", ts_start,
+				  FU_PLUGIN_BUDGET_COLDPLUG_MS);
+	fu_trace2 (plugin_done, priv->name, "coldplug");
+	if (!ret) {
 		g_prefix_error (error, "failed to coldplug %s: ", priv->name);
 		return FALSE;
 	}
@@ -643,17 +1091,25 @@ fu_plugin_runner_coldplug_prepare (FuPlugin *plugin, GError **error)
 {
 	FuPluginPrivate *priv = GET_PRIVATE (plugin);
 	FuPluginStartupFunc func = NULL;
+	gboolean ret;
+	gint64 ts_start;
 
 	/* not enabled */
 	if (!priv->enabled)
 		return TRUE;
 
 	/* optional */
-	g_module_symbol (priv->module, "fu_plugin_coldplug_prepare", (gpointer *) &func);
+	func = priv->vfuncs.coldplug_prepare;
 	if (func == NULL)
 		return TRUE;
 	g_debug ("performing coldplug_prepare() on %s", priv->name);
-	if (!func (plugin, error)) {
+	fu_trace2 (plugin_run, priv->name, "coldplug_prepare");
+	ts_start = g_get_monotonic_time ();
+	ret = func (plugin, error);
+	fu_plugin_runner_account (plugin, "coldplug_prepare", ts_start,
+				  FU_PLUGIN_BUDGET_COLDPLUG_MS);
+	fu_trace2 (plugin_done, priv->name, "coldplug_prepare");
+	if (!ret) {
 		g_prefix_error (error, "failed to prepare for coldplug %s: ", priv->name);
 		return FALSE;
 	}
@@ -665,17 +1121,25 @@ fu_plugin_runner_coldplug_cleanup (FuPlugin *plugin, GError **error)
 {
 	FuPluginPrivate *priv = GET_PRIVATE (plugin);
 	FuPluginStartupFunc func = NULL;
+	gboolean ret;
+	gint64 ts_start;
 
 	/* not enabled */
 	if (!priv->enabled)
 		return TRUE;
 
 	/* optional */
-	g_module_symbol (priv->module, "fu_plugin_coldplug_cleanup", (gpointer *) &func);
+	func = priv->vfuncs.coldplug_cleanup;
 	if (func == NULL)
 		return TRUE;
 	g_debug ("performing coldplug_cleanup() on %s", priv->name);
-	if (!func (plugin, error)) {
+	fu_trace2 (plugin_run, priv->name, "coldplug_cleanup");
+	ts_start = g_get_monotonic_time ();
+	ret = func (plugin, error);
+	fu_plugin_runner_account (plugin, "coldplug_cleanup", ts_start,
+				  FU_PLUGIN_BUDGET_COLDPLUG_MS);
+	fu_trace2 (plugin_done, priv->name, "coldplug_cleanup");
+	if (!ret) {
 		g_prefix_error (error, "failed to cleanup coldplug %s: ", priv->name);
 		return FALSE;
 	}
@@ -687,17 +1151,24 @@ fu_plugin_runner_update_prepare (FuPlugin *plugin, FuDevice *device, GError **er
 {
 	FuPluginPrivate *priv = GET_PRIVATE (plugin);
 	FuPluginDeviceFunc func = NULL;
+	gboolean ret;
+	gint64 ts_start;
 
 	/* not enabled */
 	if (!priv->enabled)
 		return TRUE;
 
 	/* optional */
-	g_module_symbol (priv->module, "fu_plugin_update_prepare", (gpointer *) &func);
+	func = priv->vfuncs.update_prepare;
 	if (func == NULL)
 		return TRUE;
 	g_debug ("performing update_prepare() on %s", priv->name);
-	if (!func (plugin, device, error)) {
+	fu_trace2 (plugin_run, priv->name, "update_prepare");
+	ts_start = g_get_monotonic_time ();
+	ret = func (plugin, device, error);
+	fu_plugin_runner_account (plugin, "update_prepare", ts_start, 0);
+	fu_trace2 (plugin_done, priv->name, "update_prepare");
+	if (!ret) {
 		g_prefix_error (error, "failed to prepare for update %s: ", priv->name);
 		return FALSE;
 	}
@@ -709,38 +1180,67 @@ fu_plugin_runner_update_cleanup (FuPlugin *plugin, FuDevice *device, GError **er
 {
 	FuPluginPrivate *priv = GET_PRIVATE (plugin);
 	FuPluginDeviceFunc func = NULL;
+	gboolean ret;
+	gint64 ts_start;
 
 	/* not enabled */
 	if (!priv->enabled)
 		return TRUE;
 
 	/* optional */
-	g_module_symbol (priv->module, "fu_plugin_update_cleanup", (gpointer *) &func);
+	func = priv->vfuncs.update_cleanup;
 	if (func == NULL)
 		return TRUE;
 	g_debug ("performing update_cleanup() on %s", priv->name);
-	if (!func (plugin, device, error)) {
+	fu_trace2 (plugin_run, priv->name, "update_cleanup");
+	ts_start = g_get_monotonic_time ();
+	ret = func (plugin, device, error);
+	fu_plugin_runner_account (plugin, "update_cleanup", ts_start, 0);
+	fu_trace2 (plugin_done, priv->name, "update_cleanup");
+	if (!ret) {
 		g_prefix_error (error, "failed to cleanup update %s: ", priv->name);
 		return FALSE;
 	}
 	return TRUE;
 }
 
+static FuPending *
+fu_plugin_get_pending (FuPlugin *plugin)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (plugin);
+
+	/* share one database connection, so the compiled statements and
+	 * any open transaction survive between runner calls */
+	if (priv->pending == NULL)
+		priv->pending = fu_pending_new ();
+	return priv->pending;
+}
+
+gboolean
+fu_plugin_runner_pending_commit (FuPlugin *plugin, GError **error)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (plugin);
+
+	/* nothing to flush */
+	if (priv->pending == NULL)
+		return TRUE;
+	return fu_pending_transaction_commit (priv->pending, error);
+}
+
 static gboolean
 fu_plugin_runner_schedule_update (FuPlugin *plugin,
 			     FuDevice *device,
 			     GBytes *blob_cab,
 			     GError **error)
 {
+	FuPending *pending = fu_plugin_get_pending (plugin);
 	gchar tmpname[] = {"XXXXXX.cap"};
 	g_autofree gchar *dirname = NULL;
 	g_autofree gchar *filename = NULL;
 	g_autoptr(FwupdResult) res_tmp = NULL;
-	g_autoptr(FuPending) pending = NULL;
 	g_autoptr(GFile) file = NULL;
 
 	/* id already exists */
-	pending = fu_pending_new ();
 	res_tmp = fu_pending_get_device (pending, fu_device_get_id (device), NULL);
 	if (res_tmp != NULL) {
 		g_set_error (error,
@@ -777,7 +1277,9 @@ fu_plugin_runner_schedule_update (FuPlugin *plugin,
 		 filename, fu_device_get_id (device));
 	fu_device_set_update_filename (device, filename);
 
-	/* add to database */
+	/* add to database; writes are batched until the end of the session */
+	if (!fu_pending_transaction_begin (pending, error))
+		return FALSE;
 	if (!fu_pending_add_device (pending, FWUPD_RESULT (device), error))
 		return FALSE;
 
@@ -793,17 +1295,24 @@ fu_plugin_runner_verify (FuPlugin *plugin,
 {
 	FuPluginPrivate *priv = GET_PRIVATE (plugin);
 	FuPluginVerifyFunc func = NULL;
+	gboolean ret;
+	gint64 ts_start;
 
 	/* not enabled */
 	if (!priv->enabled)
 		return TRUE;
 
 	/* optional */
-	g_module_symbol (priv->module, "fu_plugin_verify", (gpointer *) &func);
+	func = priv->vfuncs.verify;
 	if (func == NULL)
 		return TRUE;
 	g_debug ("performing verify() on %s", priv->name);
-	if (!func (plugin, device, flags, error)) {
+	fu_trace2 (plugin_run, priv->name, "verify");
+	ts_start = g_get_monotonic_time ();
+	ret = func (plugin, device, flags, error);
+	fu_plugin_runner_account (plugin, "verify", ts_start, 0);
+	fu_trace2 (plugin_done, priv->name, "verify");
+	if (!ret) {
 		g_prefix_error (error, "failed to verify %s: ", priv->name);
 		return FALSE;
 	}
@@ -816,6 +1325,7 @@ fu_plugin_runner_unlock (FuPlugin *plugin, FuDevice *device, GError **error)
 	guint64 flags;
 	FuPluginPrivate *priv = GET_PRIVATE (plugin);
 	FuPluginDeviceFunc func = NULL;
+	gboolean ret;
 
 	/* not enabled */
 	if (!priv->enabled)
@@ -833,10 +1343,16 @@ fu_plugin_runner_unlock (FuPlugin *plugin, FuDevice *device, GError **error)
 	}
 
 	/* optional */
-	g_module_symbol (priv->module, "fu_plugin_unlock", (gpointer *) &func);
+	func = priv->vfuncs.unlock;
 	if (func != NULL) {
+		gint64 ts_start;
 		g_debug ("performing unlock() on %s", priv->name);
-		if (!func (plugin, device, error)) {
+		fu_trace2 (plugin_run, priv->name, "unlock");
+		ts_start = g_get_monotonic_time ();
+		ret = func (plugin, device, error);
+		fu_plugin_runner_account (plugin, "unlock", ts_start, 0);
+		fu_trace2 (plugin_done, priv->name, "unlock");
+		if (!ret) {
 			g_prefix_error (error, "failed to unlock %s: ", priv->name);
 			return FALSE;
 		}
@@ -858,9 +1374,11 @@ fu_plugin_runner_update (FuPlugin *plugin,
 		    GError **error)
 {
 	FuPluginPrivate *priv = GET_PRIVATE (plugin);
+	FuPending *pending;
 	FuPluginUpdateFunc func_online;
 	FuPluginUpdateFunc func_offline;
-	g_autoptr(FuPending) pending = NULL;
+	gboolean ret;
+	gint64 time_start;
 	g_autoptr(FwupdResult) res_pending = NULL;
 	GError *error_update = NULL;
 
@@ -869,8 +1387,8 @@ fu_plugin_runner_update (FuPlugin *plugin,
 		return TRUE;
 
 	/* optional */
-	g_module_symbol (priv->module, "fu_plugin_update_online", (gpointer *) &func_online);
-	g_module_symbol (priv->module, "fu_plugin_update_offline", (gpointer *) &func_offline);
+	func_online = priv->vfuncs.update_online;
+	func_offline = priv->vfuncs.update_offline;
 
 	/* schedule for next reboot, or handle in the plugin */
 	if (flags & FWUPD_INSTALL_FLAG_OFFLINE) {
@@ -880,7 +1398,16 @@ fu_plugin_runner_update (FuPlugin *plugin,
 								 blob_cab,
 								 error);
 		}
-		return func_offline (plugin, device, blob_fw, flags, error);
+		fu_plugin_transfer_stats_reset (plugin);
+		time_start = g_get_monotonic_time ();
+		fu_trace2 (plugin_run, priv->name, "update_offline");
+		ret = func_offline (plugin, device, blob_fw, flags, error);
+		fu_plugin_runner_account (plugin, "update_offline", time_start,
+					  FU_PLUGIN_BUDGET_UPDATE_MS);
+		fu_trace2 (plugin_done, priv->name, "update_offline");
+		priv->update_duration_ms = (guint)
+			((g_get_monotonic_time () - time_start) / 1000);
+		return ret;
 	}
 
 	/* cancel the pending action */
@@ -895,11 +1422,21 @@ fu_plugin_runner_update (FuPlugin *plugin,
 				     "No online update possible");
 		return FALSE;
 	}
-	pending = fu_pending_new ();
+	pending = fu_plugin_get_pending (plugin);
 	res_pending = fu_pending_get_device (pending, fu_device_get_id (device), NULL);
-	if (!func_online (plugin, device, blob_fw, flags, &error_update)) {
+	fu_plugin_transfer_stats_reset (plugin);
+	time_start = g_get_monotonic_time ();
+	fu_trace2 (plugin_run, priv->name, "update_online");
+	ret = func_online (plugin, device, blob_fw, flags, &error_update);
+	fu_plugin_runner_account (plugin, "update_online", time_start,
+				  FU_PLUGIN_BUDGET_UPDATE_MS);
+	fu_trace2 (plugin_done, priv->name, "update_online");
+	priv->update_duration_ms = (guint)
+		((g_get_monotonic_time () - time_start) / 1000);
+	if (!ret) {
 		/* save the error to the database */
 		if (res_pending != NULL) {
+			fu_pending_transaction_begin (pending, NULL);
 			fu_pending_set_error_msg (pending, FWUPD_RESULT (device),
 						  error_update->message, NULL);
 		}
@@ -913,8 +1450,15 @@ fu_plugin_runner_update (FuPlugin *plugin,
 		FwupdRelease *rel = fwupd_result_get_release (res_pending);
 
 		/* update pending database */
+		fu_pending_transaction_begin (pending, NULL);
 		fu_pending_set_state (pending, FWUPD_RESULT (device),
 				      FWUPD_UPDATE_STATE_SUCCESS, NULL);
+		fu_pending_set_transfer_stats (pending, FWUPD_RESULT (device),
+					       priv->transfer_bytes,
+					       priv->update_duration_ms,
+					       priv->transfer_stall_ms,
+					       priv->transfer_retries,
+					       NULL);
 
 		/* delete cab file */
 		tmp = fwupd_release_get_filename (rel);
@@ -940,19 +1484,26 @@ fu_plugin_runner_clear_results (FuPlugin *plugin, FuDevice *device, GError **err
 {
 	FuPluginPrivate *priv = GET_PRIVATE (plugin);
 	FuPluginDeviceFunc func = NULL;
+	gboolean ret;
+	FuPending *pending;
 	g_autoptr(GError) error_local = NULL;
 	g_autoptr(FwupdResult) res_pending = NULL;
-	g_autoptr(FuPending) pending = NULL;
 
 	/* not enabled */
 	if (!priv->enabled)
 		return TRUE;
 
 	/* use the plugin if the vfunc is provided */
-	g_module_symbol (priv->module, "fu_plugin_clear_result", (gpointer *) &func);
+	func = priv->vfuncs.clear_result;
 	if (func != NULL) {
+		gint64 ts_start;
 		g_debug ("performing clear_result() on %s", priv->name);
-		if (!func (plugin, device, error)) {
+		fu_trace2 (plugin_run, priv->name, "clear_result");
+		ts_start = g_get_monotonic_time ();
+		ret = func (plugin, device, error);
+		fu_plugin_runner_account (plugin, "clear_result", ts_start, 0);
+		fu_trace2 (plugin_done, priv->name, "clear_result");
+		if (!ret) {
 			g_prefix_error (error, "failed to clear_result %s: ", priv->name);
 			return FALSE;
 		}
@@ -960,7 +1511,7 @@ fu_plugin_runner_clear_results (FuPlugin *plugin, FuDevice *device, GError **err
 	}
 
 	/* handled using the database */
-	pending = fu_pending_new ();
+	pending = fu_plugin_get_pending (plugin);
 	res_pending = fu_pending_get_device (pending,
 					     fu_device_get_id (device),
 					     &error_local);
@@ -983,23 +1534,30 @@ fu_plugin_runner_get_results (FuPlugin *plugin, FuDevice *device, GError **error
 {
 	FuPluginPrivate *priv = GET_PRIVATE (plugin);
 	FuPluginDeviceFunc func = NULL;
+	gboolean ret;
 	FwupdUpdateState update_state;
 	FwupdRelease *rel;
 	FwupdDevice *dev;
 	const gchar *tmp;
+	FuPending *pending;
 	g_autoptr(GError) error_local = NULL;
 	g_autoptr(FwupdResult) res_pending = NULL;
-	g_autoptr(FuPending) pending = NULL;
 
 	/* not enabled */
 	if (!priv->enabled)
 		return TRUE;
 
 	/* use the plugin if the vfunc is provided */
-	g_module_symbol (priv->module, "fu_plugin_get_results", (gpointer *) &func);
+	func = priv->vfuncs.get_results;
 	if (func != NULL) {
+		gint64 ts_start;
 		g_debug ("performing get_results() on %s", priv->name);
-		if (!func (plugin, device, error)) {
+		fu_trace2 (plugin_run, priv->name, "get_results");
+		ts_start = g_get_monotonic_time ();
+		ret = func (plugin, device, error);
+		fu_plugin_runner_account (plugin, "get_results", ts_start, 0);
+		fu_trace2 (plugin_done, priv->name, "get_results");
+		if (!ret) {
 			g_prefix_error (error, "failed to get_results %s: ", priv->name);
 			return FALSE;
 		}
@@ -1007,7 +1565,7 @@ fu_plugin_runner_get_results (FuPlugin *plugin, FuDevice *device, GError **error
 	}
 
 	/* handled using the database */
-	pending = fu_pending_new ();
+	pending = fu_plugin_get_pending (plugin);
 	res_pending = fu_pending_get_device (pending,
 					     fu_device_get_id (device),
 					     &error_local);
@@ -1100,6 +1658,11 @@ fu_plugin_init (FuPlugin *plugin)
 	priv->devices = g_hash_table_new_full (g_str_hash, g_str_equal,
 					       g_free, (GDestroyNotify) g_object_unref);
 	priv->devices_delay = g_hash_table_new (g_str_hash, g_str_equal);
+	priv->coldplug_deps = g_ptr_array_new_with_free_func (g_free);
+	priv->runtime_stats = g_hash_table_new_full (g_str_hash, g_str_equal,
+						     g_free, g_free);
+	g_mutex_init (&priv->runtime_mutex);
+	priv->thread_init = g_thread_self ();
 }
 
 static void
@@ -1107,27 +1670,32 @@ fu_plugin_finalize (GObject *object)
 {
 	FuPlugin *plugin = FU_PLUGIN (object);
 	FuPluginPrivate *priv = GET_PRIVATE (plugin);
-	FuPluginInitFunc func = NULL;
 
 	/* optional */
-	if (priv->module != NULL) {
-		g_module_symbol (priv->module, "fu_plugin_destroy", (gpointer *) &func);
-		if (func != NULL) {
-			g_debug ("performing destroy() on %s", priv->name);
-			func (plugin);
-		}
+	if (priv->module != NULL && priv->vfuncs.destroy != NULL) {
+		g_debug ("performing destroy() on %s", priv->name);
+		priv->vfuncs.destroy (plugin);
 	}
 
 	if (priv->usb_ctx != NULL)
 		g_object_unref (priv->usb_ctx);
+	if (priv->udev_backend != NULL)
+		g_object_unref (priv->udev_backend);
+	if (priv->pending != NULL)
+		g_object_unref (priv->pending);
 	if (priv->hwids != NULL)
 		g_hash_table_unref (priv->hwids);
+	if (priv->smbios != NULL)
+		g_object_unref (priv->smbios);
 #ifndef RUNNING_ON_VALGRIND
 	if (priv->module != NULL)
 		g_module_close (priv->module);
 #endif
 	g_hash_table_unref (priv->devices);
 	g_hash_table_unref (priv->devices_delay);
+	g_hash_table_unref (priv->runtime_stats);
+	g_mutex_clear (&priv->runtime_mutex);
+	g_ptr_array_unref (priv->coldplug_deps);
 	g_free (priv->name);
 	g_free (priv->data);
 
@@ -28,6 +28,8 @@
 #include <gusb.h>
 
 #include "fu-device.h"
+#include "fu-smbios.h"
+#include "fu-udev-backend.h"
 
 G_BEGIN_DECLS
 
@@ -60,6 +62,8 @@ typedef enum {
 
 typedef struct	FuPluginData	FuPluginData;
 
+typedef gboolean (*FuPluginConditionFunc)		(gpointer	 user_data);
+
 /* for plugins to use */
 const gchar	*fu_plugin_get_name			(FuPlugin	*plugin);
 FuPluginData	*fu_plugin_get_data			(FuPlugin	*plugin);
@@ -69,6 +73,8 @@ gboolean	 fu_plugin_get_enabled			(FuPlugin	*plugin);
 void		 fu_plugin_set_enabled			(FuPlugin	*plugin,
 							 gboolean	 enabled);
 GUsbContext	*fu_plugin_get_usb_context		(FuPlugin	*plugin);
+FuUdevBackend	*fu_plugin_get_udev_backend		(FuPlugin	*plugin);
+FuSmbios	*fu_plugin_get_smbios			(FuPlugin	*plugin);
 void		 fu_plugin_device_add			(FuPlugin	*plugin,
 							 FuDevice	*device);
 void		 fu_plugin_device_add_delay		(FuPlugin	*plugin,
@@ -79,9 +85,16 @@ void		 fu_plugin_set_status			(FuPlugin	*plugin,
 							 FwupdStatus	 status);
 void		 fu_plugin_set_percentage		(FuPlugin	*plugin,
 							 guint		 percentage);
+void		 fu_plugin_add_transfer_bytes		(FuPlugin	*plugin,
+							 guint64	 bytes);
+void		 fu_plugin_add_transfer_stall		(FuPlugin	*plugin,
+							 guint		 duration_ms);
+void		 fu_plugin_add_transfer_retry		(FuPlugin	*plugin);
 void		 fu_plugin_recoldplug			(FuPlugin	*plugin);
 void		 fu_plugin_set_coldplug_delay		(FuPlugin	*plugin,
 							 guint		 duration);
+void		 fu_plugin_add_coldplug_dependency	(FuPlugin	*plugin,
+							 const gchar	*name);
 gboolean	 fu_plugin_has_device_delay		(FuPlugin	*plugin);
 gpointer	 fu_plugin_cache_lookup			(FuPlugin	*plugin,
 							 const gchar	*id);
@@ -92,6 +105,11 @@ void		 fu_plugin_cache_add			(FuPlugin	*plugin,
 							 gpointer	 dev);
 gboolean	 fu_plugin_check_hwid			(FuPlugin	*plugin,
 							 const gchar	*hwid);
+gboolean	 fu_plugin_wait_for_condition		(FuPlugin	*plugin,
+							 guint		 timeout_ms,
+							 FuPluginConditionFunc condition_cb,
+							 gpointer	 user_data,
+							 GError		**error);
 
 G_END_DECLS
 
@@ -0,0 +1,186 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2017 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <string.h>
+
+#include "fu-quirks.h"
+
+struct _FuQuirks {
+	GObject			 parent_instance;
+	GHashTable		*version_flags;	/* component-id:flags+1 */
+};
+
+G_DEFINE_TYPE (FuQuirks, fu_quirks, G_TYPE_OBJECT)
+
+static const gchar *
+fu_quirks_get_sysconfig_dir (void)
+{
+	if (g_file_test (SYSCONFDIR, G_FILE_TEST_EXISTS))
+		return SYSCONFDIR;
+	return "/etc";
+}
+
+/* store flags+1 so a present entry is never the NULL value */
+static void
+fu_quirks_add_version_flags (FuQuirks *self,
+			     const gchar *id,
+			     AsVersionParseFlag flags)
+{
+	g_hash_table_insert (self->version_flags,
+			     g_strdup (id),
+			     GUINT_TO_POINTER ((guint) flags + 1));
+}
+
+static gboolean
+fu_quirks_load_file (FuQuirks *self, const gchar *filename, GError **error)
+{
+	g_auto(GStrv) groups = NULL;
+	g_autoptr(GKeyFile) kf = g_key_file_new ();
+
+	if (!g_key_file_load_from_file (kf, filename,
+					G_KEY_FILE_NONE, error))
+		return FALSE;
+	groups = g_key_file_get_groups (kf, NULL);
+	for (guint i = 0; groups[i] != NULL; i++) {
+		g_autofree gchar *tmp = NULL;
+		tmp = g_key_file_get_string (kf, groups[i],
+					     "VersionFormat", NULL);
+		if (tmp == NULL)
+			continue;
+		if (g_strcmp0 (tmp, "quad") == 0) {
+			fu_quirks_add_version_flags (self, groups[i],
+						     AS_VERSION_PARSE_FLAG_NONE);
+		} else if (g_strcmp0 (tmp, "triplet") == 0) {
+			fu_quirks_add_version_flags (self, groups[i],
+						     AS_VERSION_PARSE_FLAG_USE_TRIPLET);
+		} else {
+			g_warning ("unknown VersionFormat '%s' in %s",
+				   tmp, filename);
+		}
+	}
+	return TRUE;
+}
+
+static void
+fu_quirks_load (FuQuirks *self)
+{
+	const gchar *fn;
+	g_autofree gchar *dirname = NULL;
+	g_autoptr(GDir) dir = NULL;
+
+	/* the compiled-in defaults; Dell & Alienware use AA.BB.CC.DD
+	 * rather than AA.BB.CCDD */
+	fu_quirks_add_version_flags (self, "com.dell.uefi",
+				     AS_VERSION_PARSE_FLAG_NONE);
+
+	/* admin drop-ins, which can extend or override the defaults */
+	dirname = g_build_filename (fu_quirks_get_sysconfig_dir (),
+				    "fwupd", "quirks.d", NULL);
+	dir = g_dir_open (dirname, 0, NULL);
+	if (dir == NULL)
+		return;
+	while ((fn = g_dir_read_name (dir)) != NULL) {
+		g_autofree gchar *filename = NULL;
+		g_autoptr(GError) error_local = NULL;
+		if (!g_str_has_suffix (fn, ".quirk"))
+			continue;
+		filename = g_build_filename (dirname, fn, NULL);
+		g_debug ("loading quirks from %s", filename);
+		if (!fu_quirks_load_file (self, filename, &error_local)) {
+			g_warning ("failed to load %s: %s",
+				   filename, error_local->message);
+		}
+	}
+}
+
+/**
+ * fu_quirks_get_version_parse_flags:
+ * @self: A #FuQuirks
+ * @app_id: a component ID, e.g. "com.dell.uefi.ABC1234.firmware"
+ *
+ * Looks up how the release versions of a component should be parsed.
+ * Entries match the longest dotted prefix of the component ID, so one
+ * quirk for "com.dell.uefi" covers every Dell system firmware.
+ *
+ * Returns: a #AsVersionParseFlag, which defaults to the triplet format
+ **/
+AsVersionParseFlag
+fu_quirks_get_version_parse_flags (FuQuirks *self, const gchar *app_id)
+{
+	g_autofree gchar *id = NULL;
+
+	g_return_val_if_fail (FU_IS_QUIRKS (self),
+			      AS_VERSION_PARSE_FLAG_USE_TRIPLET);
+	g_return_val_if_fail (app_id != NULL,
+			      AS_VERSION_PARSE_FLAG_USE_TRIPLET);
+
+	/* parse the files once, on first use */
+	if (g_hash_table_size (self->version_flags) == 0)
+		fu_quirks_load (self);
+
+	/* hash probes on each dotted prefix, longest first, so the cost is
+	 * the depth of the ID and not the number of quirk entries */
+	id = g_strdup (app_id);
+	do {
+		gpointer value;
+		gchar *str;
+		value = g_hash_table_lookup (self->version_flags, id);
+		if (value != NULL)
+			return (AsVersionParseFlag) (GPOINTER_TO_UINT (value) - 1);
+		str = g_strrstr (id, ".");
+		if (str == NULL)
+			break;
+		*str = '\0';
+	} while (id[0] != '\0');
+	return AS_VERSION_PARSE_FLAG_USE_TRIPLET;
+}
+
+static void
+fu_quirks_finalize (GObject *object)
+{
+	FuQuirks *self = FU_QUIRKS (object);
+	g_hash_table_unref (self->version_flags);
+	G_OBJECT_CLASS (fu_quirks_parent_class)->finalize (object);
+}
+
+static void
+fu_quirks_class_init (FuQuirksClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = fu_quirks_finalize;
+}
+
+static void
+fu_quirks_init (FuQuirks *self)
+{
+	self->version_flags = g_hash_table_new_full (g_str_hash, g_str_equal,
+						     g_free, NULL);
+}
+
+FuQuirks *
+fu_quirks_new (void)
+{
+	return FU_QUIRKS (g_object_new (FU_TYPE_QUIRKS, NULL));
+}
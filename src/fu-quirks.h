@@ -22,18 +22,20 @@
 #ifndef __FU_QUIRKS_H
 #define __FU_QUIRKS_H
 
-typedef struct {
-	const gchar             *sys_vendor;
-	const gchar		*identifier;
-	AsVersionParseFlag       flags;
-} FuVendorQuirks;
-
-static const FuVendorQuirks quirk_table[] = {
-	/* Dell & Alienware use AA.BB.CC.DD rather than AA.BB.CCDD */
-	{ "Dell Inc.",	"com.dell.uefi",	AS_VERSION_PARSE_FLAG_NONE },
-	{ "Alienware",	"com.dell.uefi",	AS_VERSION_PARSE_FLAG_NONE },
-	{ NULL,		NULL,			AS_VERSION_PARSE_FLAG_NONE }
-};
+#include <glib-object.h>
+#include <appstream-glib.h>
 
-#endif /* __FU_QUIRKS_H */
+G_BEGIN_DECLS
+
+#define FU_TYPE_QUIRKS (fu_quirks_get_type ())
+
+G_DECLARE_FINAL_TYPE (FuQuirks, fu_quirks, FU, QUIRKS, GObject)
+
+FuQuirks	*fu_quirks_new				(void);
 
+AsVersionParseFlag fu_quirks_get_version_parse_flags	(FuQuirks	*self,
+							 const gchar	*app_id);
+
+G_END_DECLS
+
+#endif /* __FU_QUIRKS_H */
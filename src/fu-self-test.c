@@ -322,6 +322,10 @@ fu_pending_func (void)
 	ret = fu_pending_set_error_msg (pending, res, "word", &error);
 	g_assert_no_error (error);
 	g_assert (ret);
+	ret = fu_pending_set_checkpoint (pending, res,
+					 FU_PENDING_PHASE_WRITING, 1024, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
 	g_object_unref (res);
 
 	/* get device */
@@ -340,6 +344,18 @@ fu_pending_func (void)
 	g_assert_cmpstr (fwupd_release_get_version (rel), ==, "3.0.2");
 	g_object_unref (res);
 
+	/* get the checkpoint back */
+	{
+		FuPendingPhase phase = FU_PENDING_PHASE_NONE;
+		guint64 offset = 0;
+		ret = fu_pending_get_checkpoint (pending, "self-test",
+						 &phase, &offset, &error);
+		g_assert_no_error (error);
+		g_assert (ret);
+		g_assert_cmpint (phase, ==, FU_PENDING_PHASE_WRITING);
+		g_assert_cmpint (offset, ==, 1024);
+	}
+
 	/* get device that does not exist */
 	res = fu_pending_get_device (pending, "XXXXXXXXXXXXX", &error);
 	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_NOT_FOUND);
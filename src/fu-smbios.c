@@ -0,0 +1,314 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2017 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <string.h>
+
+#include "fu-smbios.h"
+
+#define FU_SMBIOS_DMI_TABLE	"/sys/firmware/dmi/tables/DMI"
+
+struct _FuSmbios {
+	GObject			 parent_instance;
+	GPtrArray		*items;
+};
+
+typedef struct {
+	guint8			 type;
+	guint16			 handle;
+	GBytes			*data;
+	GPtrArray		*strings;
+} FuSmbiosItem;
+
+G_DEFINE_TYPE (FuSmbios, fu_smbios, G_TYPE_OBJECT)
+
+static void
+fu_smbios_item_free (FuSmbiosItem *item)
+{
+	g_bytes_unref (item->data);
+	g_ptr_array_unref (item->strings);
+	g_free (item);
+}
+
+static gboolean
+fu_smbios_setup_from_data (FuSmbios *self, const guint8 *buf, gsize sz, GError **error)
+{
+	gsize offset = 0;
+
+	/* go through each structure in the table */
+	while (offset + 4 <= sz) {
+		FuSmbiosItem *item;
+		guint8 length = buf[offset + 1];
+
+		/* sanity check */
+		if (length < 4 || offset + length > sz) {
+			g_set_error (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_INVALID_DATA,
+				     "structure larger than available data");
+			return FALSE;
+		}
+
+		/* the data includes the 4 byte header so the offsets in the
+		 * SMBIOS specification can be used unmodified */
+		item = g_new0 (FuSmbiosItem, 1);
+		item->type = buf[offset];
+		item->handle = (guint16) buf[offset + 2] |
+			       ((guint16) buf[offset + 3] << 8);
+		item->data = g_bytes_new (buf + offset, length);
+		item->strings = g_ptr_array_new_with_free_func (g_free);
+		g_ptr_array_add (self->items, item);
+
+		/* jump to the unformatted area and read the string-set until
+		 * the double NUL terminator */
+		offset += length;
+		if (offset + 2 <= sz && buf[offset] == 0 && buf[offset + 1] == 0) {
+			/* no strings */
+			offset += 2;
+			continue;
+		}
+		while (offset < sz) {
+			gsize start = offset;
+			while (offset < sz && buf[offset] != 0)
+				offset++;
+			if (offset >= sz) {
+				g_set_error (error,
+					     G_IO_ERROR,
+					     G_IO_ERROR_INVALID_DATA,
+					     "string-set not terminated");
+				return FALSE;
+			}
+			if (offset == start)
+				break;
+			g_ptr_array_add (item->strings,
+					 g_strdup ((const gchar *) buf + start));
+			offset++;
+		}
+		offset++;
+	}
+	return TRUE;
+}
+
+/**
+ * fu_smbios_setup_from_file:
+ * @self: A #FuSmbios
+ * @filename: A DMI table blob, e.g. "/sys/firmware/dmi/tables/DMI"
+ * @error: A #GError or %NULL
+ *
+ * Reads all the SMBIOS structures from a raw DMI table with a single read.
+ *
+ * Returns: %TRUE for success
+ **/
+gboolean
+fu_smbios_setup_from_file (FuSmbios *self, const gchar *filename, GError **error)
+{
+	gsize sz = 0;
+	g_autofree gchar *buf = NULL;
+
+	g_return_val_if_fail (FU_IS_SMBIOS (self), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+
+	if (!g_file_get_contents (filename, &buf, &sz, error))
+		return FALSE;
+	return fu_smbios_setup_from_data (self, (guint8 *) buf, sz, error);
+}
+
+/**
+ * fu_smbios_setup:
+ * @self: A #FuSmbios
+ * @error: A #GError or %NULL
+ *
+ * Reads all the SMBIOS structures from the hardware.
+ *
+ * Returns: %TRUE for success
+ **/
+gboolean
+fu_smbios_setup (FuSmbios *self, GError **error)
+{
+	g_return_val_if_fail (FU_IS_SMBIOS (self), FALSE);
+	return fu_smbios_setup_from_file (self, FU_SMBIOS_DMI_TABLE, error);
+}
+
+static FuSmbiosItem *
+fu_smbios_get_item_for_type (FuSmbios *self, guint8 type)
+{
+	for (guint i = 0; i < self->items->len; i++) {
+		FuSmbiosItem *item = g_ptr_array_index (self->items, i);
+		if (item->type == type)
+			return item;
+	}
+	return NULL;
+}
+
+/**
+ * fu_smbios_get_data:
+ * @self: A #FuSmbios
+ * @type: A structure type, e.g. 0x01 for System Information
+ * @error: A #GError or %NULL
+ *
+ * Gets the formatted area of the first structure with the given type,
+ * including the 4 byte header.
+ *
+ * Returns: (transfer none): a #GBytes, or %NULL if invalid
+ **/
+GBytes *
+fu_smbios_get_data (FuSmbios *self, guint8 type, GError **error)
+{
+	FuSmbiosItem *item;
+
+	g_return_val_if_fail (FU_IS_SMBIOS (self), NULL);
+
+	item = fu_smbios_get_item_for_type (self, type);
+	if (item == NULL) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_NOT_FOUND,
+			     "no structure with type %02x", type);
+		return NULL;
+	}
+	return item->data;
+}
+
+/**
+ * fu_smbios_get_string:
+ * @self: A #FuSmbios
+ * @type: A structure type, e.g. 0x01 for System Information
+ * @offset: A structure offset, e.g. 0x04 for the system manufacturer
+ * @error: A #GError or %NULL
+ *
+ * Gets a string from a specific structure, dereferencing the string-set
+ * index stored at the offset.
+ *
+ * Returns: a string, or %NULL if invalid or not found
+ **/
+const gchar *
+fu_smbios_get_string (FuSmbios *self, guint8 type, guint8 offset, GError **error)
+{
+	FuSmbiosItem *item;
+	const guint8 *data;
+	gsize sz = 0;
+
+	g_return_val_if_fail (FU_IS_SMBIOS (self), NULL);
+
+	item = fu_smbios_get_item_for_type (self, type);
+	if (item == NULL) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_NOT_FOUND,
+			     "no structure with type %02x", type);
+		return NULL;
+	}
+	data = g_bytes_get_data (item->data, &sz);
+	if (offset >= sz) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_INVALID_DATA,
+			     "offset bigger than structure length %" G_GSIZE_FORMAT,
+			     sz);
+		return NULL;
+	}
+	if (data[offset] == 0x00) {
+		g_set_error_literal (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_NOT_FOUND,
+				     "no data available");
+		return NULL;
+	}
+	if (data[offset] > item->strings->len) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_INVALID_DATA,
+			     "string index %u larger than string-set size %u",
+			     data[offset], item->strings->len);
+		return NULL;
+	}
+	return g_ptr_array_index (item->strings, data[offset] - 1);
+}
+
+/**
+ * fu_smbios_get_integer:
+ * @self: A #FuSmbios
+ * @type: A structure type, e.g. 0x03 for Chassis Information
+ * @offset: A structure offset, e.g. 0x05 for the chassis type
+ * @error: A #GError or %NULL
+ *
+ * Gets a byte value from a specific structure.
+ *
+ * Returns: an integer, or %G_MAXUINT if invalid or not found
+ **/
+guint
+fu_smbios_get_integer (FuSmbios *self, guint8 type, guint8 offset, GError **error)
+{
+	FuSmbiosItem *item;
+	const guint8 *data;
+	gsize sz = 0;
+
+	g_return_val_if_fail (FU_IS_SMBIOS (self), G_MAXUINT);
+
+	item = fu_smbios_get_item_for_type (self, type);
+	if (item == NULL) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_NOT_FOUND,
+			     "no structure with type %02x", type);
+		return G_MAXUINT;
+	}
+	data = g_bytes_get_data (item->data, &sz);
+	if (offset >= sz) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_INVALID_DATA,
+			     "offset bigger than structure length %" G_GSIZE_FORMAT,
+			     sz);
+		return G_MAXUINT;
+	}
+	return data[offset];
+}
+
+static void
+fu_smbios_finalize (GObject *object)
+{
+	FuSmbios *self = FU_SMBIOS (object);
+	g_ptr_array_unref (self->items);
+	G_OBJECT_CLASS (fu_smbios_parent_class)->finalize (object);
+}
+
+static void
+fu_smbios_class_init (FuSmbiosClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = fu_smbios_finalize;
+}
+
+static void
+fu_smbios_init (FuSmbios *self)
+{
+	self->items = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_smbios_item_free);
+}
+
+FuSmbios *
+fu_smbios_new (void)
+{
+	FuSmbios *self;
+	self = g_object_new (FU_TYPE_SMBIOS, NULL);
+	return FU_SMBIOS (self);
+}
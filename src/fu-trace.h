@@ -0,0 +1,41 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2017 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __FU_TRACE_H
+#define __FU_TRACE_H
+
+#include "config.h"
+
+/* static tracepoints for perf/bpftrace/systemtap, in the 'fwupd' provider;
+ * a disabled probe is a single nop so these are compiled in unconditionally
+ * when <sys/sdt.h> is available */
+#ifdef HAVE_SDT_H
+#include <sys/sdt.h>
+#define fu_trace(name)			DTRACE_PROBE(fwupd,name)
+#define fu_trace1(name,a1)		DTRACE_PROBE1(fwupd,name,a1)
+#define fu_trace2(name,a1,a2)		DTRACE_PROBE2(fwupd,name,a1,a2)
+#else
+#define fu_trace(name)
+#define fu_trace1(name,a1)
+#define fu_trace2(name,a1,a2)
+#endif
+
+#endif /* __FU_TRACE_H */
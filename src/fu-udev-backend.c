@@ -0,0 +1,268 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2017 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "fu-udev-backend.h"
+
+/* the daemon used to do a full udev enumeration per plugin; doing one pass
+ * here and serving plugin queries from the index collapses the redundant
+ * sysfs I/O that dominated coldplug */
+
+struct _FuUdevBackend {
+	GObject			 parent_instance;
+	GUdevClient		*gudev_client;
+	gchar			**subsystems;
+	GHashTable		*devices_by_subsystem;	/* subsystem : GPtrArray of GUdevDevice */
+	GHashTable		*devices_by_syspath;	/* syspath : GUdevDevice */
+	gboolean		 done_coldplug;
+};
+
+enum {
+	SIGNAL_DEVICE_ADDED,
+	SIGNAL_DEVICE_REMOVED,
+	SIGNAL_LAST
+};
+
+static guint signals[SIGNAL_LAST] = { 0 };
+
+G_DEFINE_TYPE (FuUdevBackend, fu_udev_backend, G_TYPE_OBJECT)
+
+static void
+fu_udev_backend_index_add (FuUdevBackend *self, GUdevDevice *udev_device)
+{
+	GPtrArray *devices;
+	const gchar *subsystem = g_udev_device_get_subsystem (udev_device);
+	const gchar *syspath = g_udev_device_get_sysfs_path (udev_device);
+
+	if (subsystem == NULL || syspath == NULL)
+		return;
+	devices = g_hash_table_lookup (self->devices_by_subsystem, subsystem);
+	if (devices == NULL) {
+		devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+		g_hash_table_insert (self->devices_by_subsystem,
+				     g_strdup (subsystem), devices);
+	}
+	g_ptr_array_add (devices, g_object_ref (udev_device));
+	g_hash_table_insert (self->devices_by_syspath,
+			     g_strdup (syspath),
+			     g_object_ref (udev_device));
+}
+
+static void
+fu_udev_backend_index_remove (FuUdevBackend *self, GUdevDevice *udev_device)
+{
+	GPtrArray *devices;
+	const gchar *subsystem = g_udev_device_get_subsystem (udev_device);
+	const gchar *syspath = g_udev_device_get_sysfs_path (udev_device);
+
+	if (syspath == NULL)
+		return;
+
+	/* the indexed object may be a different GUdevDevice instance for
+	 * the same syspath, so remove by path */
+	if (subsystem != NULL) {
+		devices = g_hash_table_lookup (self->devices_by_subsystem, subsystem);
+		if (devices != NULL) {
+			for (guint i = 0; i < devices->len; i++) {
+				GUdevDevice *device_tmp = g_ptr_array_index (devices, i);
+				if (g_strcmp0 (g_udev_device_get_sysfs_path (device_tmp),
+					       syspath) == 0) {
+					g_ptr_array_remove_index (devices, i);
+					break;
+				}
+			}
+		}
+	}
+	g_hash_table_remove (self->devices_by_syspath, syspath);
+}
+
+static void
+fu_udev_backend_uevent_cb (GUdevClient *gudev_client,
+			   const gchar *action,
+			   GUdevDevice *udev_device,
+			   FuUdevBackend *self)
+{
+	const gchar *subsystem = g_udev_device_get_subsystem (udev_device);
+	GQuark detail = 0;
+
+	if (subsystem != NULL)
+		detail = g_quark_from_string (subsystem);
+
+	/* keep the index current, then fan out to the subscribers */
+	if (g_strcmp0 (action, "add") == 0) {
+		fu_udev_backend_index_add (self, udev_device);
+		g_signal_emit (self, signals[SIGNAL_DEVICE_ADDED], detail,
+			       udev_device);
+		return;
+	}
+	if (g_strcmp0 (action, "remove") == 0) {
+		fu_udev_backend_index_remove (self, udev_device);
+		g_signal_emit (self, signals[SIGNAL_DEVICE_REMOVED], detail,
+			       udev_device);
+		return;
+	}
+}
+
+/**
+ * fu_udev_backend_coldplug:
+ * @self: A #FuUdevBackend
+ *
+ * Performs the one-time enumeration pass over all the subsystems that the
+ * backend was created with. Safe to call more than once.
+ **/
+void
+fu_udev_backend_coldplug (FuUdevBackend *self)
+{
+	g_return_if_fail (FU_IS_UDEV_BACKEND (self));
+
+	if (self->done_coldplug)
+		return;
+	for (guint i = 0; self->subsystems[i] != NULL; i++) {
+		g_autoptr(GList) devices = NULL;
+		devices = g_udev_client_query_by_subsystem (self->gudev_client,
+							    self->subsystems[i]);
+		for (GList *l = devices; l != NULL; l = l->next) {
+			GUdevDevice *udev_device = G_UDEV_DEVICE (l->data);
+			fu_udev_backend_index_add (self, udev_device);
+			g_object_unref (udev_device);
+		}
+	}
+	self->done_coldplug = TRUE;
+}
+
+/**
+ * fu_udev_backend_get_devices:
+ * @self: A #FuUdevBackend
+ * @subsystem: A subsystem name, e.g. "pci"
+ *
+ * Gets all the devices of a specific subsystem from the index, without
+ * walking sysfs again.
+ *
+ * Returns: (transfer container) (element-type GUdevDevice): devices
+ **/
+GPtrArray *
+fu_udev_backend_get_devices (FuUdevBackend *self, const gchar *subsystem)
+{
+	GPtrArray *devices;
+	GPtrArray *devices_tmp;
+
+	g_return_val_if_fail (FU_IS_UDEV_BACKEND (self), NULL);
+	g_return_val_if_fail (subsystem != NULL, NULL);
+
+	fu_udev_backend_coldplug (self);
+	devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	devices_tmp = g_hash_table_lookup (self->devices_by_subsystem, subsystem);
+	if (devices_tmp != NULL) {
+		for (guint i = 0; i < devices_tmp->len; i++) {
+			GUdevDevice *udev_device = g_ptr_array_index (devices_tmp, i);
+			g_ptr_array_add (devices, g_object_ref (udev_device));
+		}
+	}
+	return devices;
+}
+
+/**
+ * fu_udev_backend_get_device_by_syspath:
+ * @self: A #FuUdevBackend
+ * @syspath: A sysfs path, e.g. "/sys/devices/pci0000:00/0000:00:02.0"
+ *
+ * Finds an indexed device by sysfs path.
+ *
+ * Returns: (transfer none): a #GUdevDevice, or %NULL if not found
+ **/
+GUdevDevice *
+fu_udev_backend_get_device_by_syspath (FuUdevBackend *self, const gchar *syspath)
+{
+	g_return_val_if_fail (FU_IS_UDEV_BACKEND (self), NULL);
+	g_return_val_if_fail (syspath != NULL, NULL);
+	fu_udev_backend_coldplug (self);
+	return g_hash_table_lookup (self->devices_by_syspath, syspath);
+}
+
+static void
+fu_udev_backend_finalize (GObject *object)
+{
+	FuUdevBackend *self = FU_UDEV_BACKEND (object);
+	g_object_unref (self->gudev_client);
+	g_strfreev (self->subsystems);
+	g_hash_table_unref (self->devices_by_subsystem);
+	g_hash_table_unref (self->devices_by_syspath);
+	G_OBJECT_CLASS (fu_udev_backend_parent_class)->finalize (object);
+}
+
+static void
+fu_udev_backend_class_init (FuUdevBackendClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = fu_udev_backend_finalize;
+
+	/* detailed by subsystem, so plugins can subscribe with e.g.
+	 * "device-added::pci" rather than filtering every event */
+	signals[SIGNAL_DEVICE_ADDED] =
+		g_signal_new ("device-added",
+			      G_TYPE_FROM_CLASS (object_class),
+			      G_SIGNAL_RUN_LAST | G_SIGNAL_DETAILED,
+			      0, NULL, NULL, g_cclosure_marshal_VOID__OBJECT,
+			      G_TYPE_NONE, 1, G_UDEV_TYPE_DEVICE);
+	signals[SIGNAL_DEVICE_REMOVED] =
+		g_signal_new ("device-removed",
+			      G_TYPE_FROM_CLASS (object_class),
+			      G_SIGNAL_RUN_LAST | G_SIGNAL_DETAILED,
+			      0, NULL, NULL, g_cclosure_marshal_VOID__OBJECT,
+			      G_TYPE_NONE, 1, G_UDEV_TYPE_DEVICE);
+}
+
+static void
+fu_udev_backend_init (FuUdevBackend *self)
+{
+	self->devices_by_subsystem = g_hash_table_new_full (g_str_hash,
+							    g_str_equal,
+							    g_free,
+							    (GDestroyNotify) g_ptr_array_unref);
+	self->devices_by_syspath = g_hash_table_new_full (g_str_hash,
+							  g_str_equal,
+							  g_free,
+							  (GDestroyNotify) g_object_unref);
+}
+
+/**
+ * fu_udev_backend_new:
+ * @subsystems: the udev subsystems to index, e.g. { "pci", "hidraw", NULL }
+ *
+ * Creates a new backend that enumerates and monitors the given subsystems.
+ *
+ * Returns: a #FuUdevBackend
+ **/
+FuUdevBackend *
+fu_udev_backend_new (const gchar * const *subsystems)
+{
+	FuUdevBackend *self;
+	g_return_val_if_fail (subsystems != NULL, NULL);
+	self = g_object_new (FU_TYPE_UDEV_BACKEND, NULL);
+	self->subsystems = g_strdupv ((gchar **) subsystems);
+	self->gudev_client = g_udev_client_new (subsystems);
+	g_signal_connect (self->gudev_client, "uevent",
+			  G_CALLBACK (fu_udev_backend_uevent_cb), self);
+	return self;
+}
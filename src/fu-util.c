@@ -33,13 +33,16 @@
 #include <locale.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <libsoup/soup.h>
 #include <unistd.h>
 
+#include "fu-blob.h"
 #include "fu-hwids.h"
 #include "fu-pending.h"
 #include "fu-plugin-private.h"
 #include "fwupd-common-private.h"
+#include "fwupd-release-private.h"
 
 #ifndef GUdevClient_autoptr
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(GUdevClient, g_object_unref)
@@ -55,6 +58,7 @@ typedef struct {
 	GPtrArray		*cmd_array;
 	FwupdInstallFlags	 flags;
 	FwupdClient		*client;
+	gboolean		 monitor_ndjson;
 } FuUtilPrivate;
 
 typedef gboolean (*FuUtilPrivateCb)	(FuUtilPrivate	*util,
@@ -517,12 +521,29 @@ fu_util_offline_update_reboot (void)
 		g_print ("Failed to reboot: %s\n", error->message);
 }
 
+static gint
+fu_util_install_prepared_sort_cb (gconstpointer a, gconstpointer b)
+{
+	FwupdDevice *dev1 = fwupd_result_get_device (*((FwupdResult **) a));
+	FwupdDevice *dev2 = fwupd_result_get_device (*((FwupdResult **) b));
+	gboolean internal1 = fwupd_device_has_flag (dev1, FWUPD_DEVICE_FLAG_INTERNAL);
+	gboolean internal2 = fwupd_device_has_flag (dev2, FWUPD_DEVICE_FLAG_INTERNAL);
+
+	/* system firmware last, as the capsule only takes effect on the
+	 * reboot and a failure there should not strand peripheral updates */
+	if (internal1 != internal2)
+		return internal1 ? 1 : -1;
+	return g_strcmp0 (fwupd_device_get_id (dev1),
+			  fwupd_device_get_id (dev2));
+}
+
 static gboolean
 fu_util_install_prepared (FuUtilPrivate *priv, gchar **values, GError **error)
 {
 	gint vercmp;
 	guint cnt = 0;
 	g_autofree gchar *link = NULL;
+	g_autoptr(GError) error_first = NULL;
 	g_autoptr(GPtrArray) results = NULL;
 	g_autoptr(FuPending) pending = NULL;
 
@@ -563,11 +584,16 @@ fu_util_install_prepared (FuUtilPrivate *priv, gchar **values, GError **error)
 	if (results == NULL)
 		return FALSE;
 
+	/* peripheral updates first, system firmware last, so the whole batch
+	 * is applied before the single reboot at the end */
+	g_ptr_array_sort (results, fu_util_install_prepared_sort_cb);
+
 	/* apply each update */
 	for (guint i = 0; i < results->len; i++) {
 		FwupdResult *res = g_ptr_array_index (results, i);
 		FwupdDevice *dev = fwupd_result_get_device (res);
 		FwupdRelease *rel = fwupd_result_get_release (res);
+		g_autoptr(GError) error_local = NULL;
 
 		/* check not already done */
 		if (fwupd_result_get_update_state (res) != FWUPD_UPDATE_STATE_PENDING)
@@ -605,13 +631,23 @@ fu_util_install_prepared (FuUtilPrivate *priv, gchar **values, GError **error)
 					   fwupd_release_get_filename (rel),
 					   priv->flags,
 					   NULL,
-					   error))
-			return FALSE;
+					   &error_local)) {
+			/* carry on; one failed device should not strand the
+			 * rest of the batch or cost an extra reboot */
+			g_print ("%s\n", error_local->message);
+			if (error_first == NULL)
+				error_first = g_steal_pointer (&error_local);
+			continue;
+		}
 		cnt++;
 	}
 
-	/* nothing to do */
+	/* nothing was applied */
 	if (cnt == 0) {
+		if (error_first != NULL) {
+			g_propagate_error (error, g_steal_pointer (&error_first));
+			return FALSE;
+		}
 		g_set_error_literal (error,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_NOTHING_TO_DO,
@@ -689,19 +725,27 @@ fu_util_file_exists_with_checksum (const gchar *fn,
 				   const gchar *checksum_expected,
 				   GChecksumType checksum_type)
 {
-	gsize len = 0;
+	gint fd;
 	g_autofree gchar *checksum_actual = NULL;
-	g_autofree gchar *data = NULL;
+	g_autoptr(FuBlob) blob = NULL;
+	g_autoptr(GBytes) bytes = NULL;
 
-	if (!g_file_get_contents (fn, &data, &len, NULL))
+	/* checksum the mapped file rather than a heap copy of it */
+	fd = open (fn, O_RDONLY);
+	if (fd < 0)
+		return FALSE;
+	blob = fu_blob_new_from_fd (fd, NULL);
+	close (fd);
+	if (blob == NULL)
 		return FALSE;
-	checksum_actual = g_compute_checksum_for_data (checksum_type,
-						       (guchar *) data, len);
+	bytes = fu_blob_get_bytes (blob);
+	checksum_actual = g_compute_checksum_for_bytes (checksum_type, bytes);
 	return g_strcmp0 (checksum_expected, checksum_actual) == 0;
 }
 
 static gboolean
 fu_util_download_file (FuUtilPrivate *priv,
+		       FwupdRemote *remote,
 		       SoupURI *uri,
 		       const gchar *fn,
 		       const gchar *checksum_expected,
@@ -710,10 +754,14 @@ fu_util_download_file (FuUtilPrivate *priv,
 	GChecksumType checksum_type;
 	const gchar *http_proxy;
 	guint status_code;
+	gsize part_len = 0;
 	g_autoptr(GError) error_local = NULL;
 	g_autofree gchar *checksum_actual = NULL;
+	g_autofree gchar *fn_part = NULL;
+	g_autofree gchar *part_data = NULL;
 	g_autofree gchar *user_agent = NULL;
 	g_autofree gchar *uri_str = NULL;
+	g_autoptr(GByteArray) buf = NULL;
 	g_autoptr(SoupMessage) msg = NULL;
 	g_autoptr(SoupSession) session = NULL;
 
@@ -765,8 +813,65 @@ fu_util_download_file (FuUtilPrivate *priv,
 			     "Failed to parse URI %s", uri_str);
 		return FALSE;
 	}
+	/* resume an interrupted download from where it stopped */
+	fn_part = g_strdup_printf ("%s.part", fn);
+	if (g_file_get_contents (fn_part, &part_data, &part_len, NULL) &&
+	    part_len > 0) {
+		g_debug ("resuming download at offset %" G_GSIZE_FORMAT, part_len);
+		soup_message_headers_set_range (msg->request_headers,
+						(goffset) part_len, -1);
+	} else if (remote != NULL && g_file_test (fn, G_FILE_TEST_EXISTS)) {
+		/* ask the server if the copy we already have is still current */
+		if (fwupd_remote_get_etag (remote) != NULL) {
+			soup_message_headers_append (msg->request_headers,
+						     "If-None-Match",
+						     fwupd_remote_get_etag (remote));
+		}
+		if (fwupd_remote_get_last_modified (remote) != NULL) {
+			soup_message_headers_append (msg->request_headers,
+						     "If-Modified-Since",
+						     fwupd_remote_get_last_modified (remote));
+		}
+	}
 	status_code = soup_session_send_message (session, msg);
-	if (status_code != SOUP_STATUS_OK) {
+
+	/* the local copy is still current */
+	if (status_code == SOUP_STATUS_NOT_MODIFIED) {
+		g_debug ("server says %s is not modified", fn);
+		return TRUE;
+	}
+
+	/* the partial file went stale on the server; start from scratch */
+	if (status_code == SOUP_STATUS_REQUESTED_RANGE_NOT_SATISFIABLE) {
+		g_debug ("partial file is stale, restarting download");
+		g_unlink (fn_part);
+		part_len = 0;
+		soup_message_headers_remove (msg->request_headers, "Range");
+		status_code = soup_session_send_message (session, msg);
+	}
+
+	/* assemble the payload, joining on to any resumed partial file */
+	buf = g_byte_array_new ();
+	if (part_len > 0 &&
+	    (status_code == SOUP_STATUS_PARTIAL_CONTENT ||
+	     SOUP_STATUS_IS_TRANSPORT_ERROR (status_code))) {
+		g_byte_array_append (buf,
+				     (const guint8 *) part_data,
+				     (guint) part_len);
+	}
+	if (msg->response_body->data != NULL) {
+		g_byte_array_append (buf,
+				     (const guint8 *) msg->response_body->data,
+				     (guint) msg->response_body->length);
+	}
+	if (status_code != SOUP_STATUS_OK &&
+	    status_code != SOUP_STATUS_PARTIAL_CONTENT) {
+		/* keep anything that did arrive so the next attempt can resume */
+		if (SOUP_STATUS_IS_TRANSPORT_ERROR (status_code) && buf->len > 0) {
+			g_file_set_contents (fn_part,
+					     (const gchar *) buf->data,
+					     (gssize) buf->len, NULL);
+		}
 		g_set_error (error,
 			     FWUPD_ERROR,
 			     FWUPD_ERROR_INVALID_FILE,
@@ -778,9 +883,10 @@ fu_util_download_file (FuUtilPrivate *priv,
 	/* verify checksum */
 	if (checksum_expected != NULL) {
 		checksum_actual = g_compute_checksum_for_data (checksum_type,
-							       (guchar *) msg->response_body->data,
-							       (gsize) msg->response_body->length);
+							       buf->data,
+							       (gsize) buf->len);
 		if (g_strcmp0 (checksum_expected, checksum_actual) != 0) {
+			g_unlink (fn_part);
 			g_set_error (error,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_INVALID_FILE,
@@ -792,8 +898,8 @@ fu_util_download_file (FuUtilPrivate *priv,
 
 	/* save file */
 	if (!g_file_set_contents (fn,
-				  msg->response_body->data,
-				  msg->response_body->length,
+				  (const gchar *) buf->data,
+				  (gssize) buf->len,
 				  &error_local)) {
 		g_set_error (error,
 			     FWUPD_ERROR,
@@ -802,6 +908,17 @@ fu_util_download_file (FuUtilPrivate *priv,
 			     error_local->message);
 		return FALSE;
 	}
+	g_unlink (fn_part);
+
+	/* remember the validators so the next refresh can be conditional */
+	if (remote != NULL) {
+		g_autoptr(GError) error_validators = NULL;
+		if (!fwupd_remote_set_validators (remote,
+						  soup_message_headers_get_one (msg->response_headers, "ETag"),
+						  soup_message_headers_get_one (msg->response_headers, "Last-Modified"),
+						  &error_validators))
+			g_debug ("failed to save validators: %s", error_validators->message);
+	}
 	return TRUE;
 }
 
@@ -814,55 +931,285 @@ fu_util_mkdir_with_parents (const gchar *path, GError **error)
 	return g_file_make_directory_with_parents (file, NULL, error);
 }
 
+static GBytes *
+fu_util_apply_metadata_patch (GBytes *blob_old, GBytes *blob_patch, GError **error)
+{
+	const guint8 *data;
+	const guint8 *data_old;
+	gsize len = 0;
+	gsize len_old = 0;
+	gsize offset = 72;	/* magic + checksum of the result */
+	g_autofree gchar *checksum_expected = NULL;
+	g_autofree gchar *checksum_new = NULL;
+	g_autoptr(GByteArray) buf = g_byte_array_new ();
+
+	data_old = g_bytes_get_data (blob_old, &len_old);
+	data = g_bytes_get_data (blob_patch, &len);
+
+	/* check the header */
+	if (len < offset || memcmp (data, "FwupdMD1", 8) != 0) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "not a metadata patch file");
+		return NULL;
+	}
+	checksum_expected = g_strndup ((const gchar *) data + 8, 64);
+
+	/* each record either copies a span of the old file or inserts new data */
+	while (offset < len) {
+		guint8 op = data[offset++];
+		guint32 sz;
+		if (op == 'C') {
+			guint32 start;
+			if (offset + 8 > len) {
+				g_set_error_literal (error,
+						     FWUPD_ERROR,
+						     FWUPD_ERROR_INVALID_FILE,
+						     "patch file was truncated");
+				return NULL;
+			}
+			memcpy (&start, data + offset, 4);
+			memcpy (&sz, data + offset + 4, 4);
+			start = GUINT32_FROM_BE (start);
+			sz = GUINT32_FROM_BE (sz);
+			offset += 8;
+			if ((gsize) start + sz > len_old) {
+				g_set_error_literal (error,
+						     FWUPD_ERROR,
+						     FWUPD_ERROR_INVALID_FILE,
+						     "patch copies outside the old file");
+				return NULL;
+			}
+			g_byte_array_append (buf, data_old + start, sz);
+		} else if (op == 'I') {
+			if (offset + 4 > len) {
+				g_set_error_literal (error,
+						     FWUPD_ERROR,
+						     FWUPD_ERROR_INVALID_FILE,
+						     "patch file was truncated");
+				return NULL;
+			}
+			memcpy (&sz, data + offset, 4);
+			sz = GUINT32_FROM_BE (sz);
+			offset += 4;
+			if (offset + sz > len) {
+				g_set_error_literal (error,
+						     FWUPD_ERROR,
+						     FWUPD_ERROR_INVALID_FILE,
+						     "patch file was truncated");
+				return NULL;
+			}
+			g_byte_array_append (buf, data + offset, sz);
+			offset += sz;
+		} else {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "patch opcode 0x%02x not supported", op);
+			return NULL;
+		}
+	}
+
+	/* verify we rebuilt the file the server intended */
+	checksum_new = g_compute_checksum_for_data (G_CHECKSUM_SHA256,
+						    buf->data, buf->len);
+	if (g_strcmp0 (checksum_new, checksum_expected) != 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "patch result invalid, expected %s got %s",
+			     checksum_expected, checksum_new);
+		return NULL;
+	}
+	return g_byte_array_free_to_bytes (g_steal_pointer (&buf));
+}
+
 static gboolean
-fu_util_download_metadata_for_remote (FuUtilPrivate *priv,
-				      FwupdRemote *remote,
-				      GError **error)
+fu_util_download_metadata_patch (FuUtilPrivate *priv,
+				 FwupdRemote *remote,
+				 const gchar *fn,
+				 GError **error)
 {
+	gsize len_old = 0;
+	gsize len_patch = 0;
+	g_autofree gchar *checksum = NULL;
+	g_autofree gchar *data_old = NULL;
+	g_autofree gchar *data_patch = NULL;
+	g_autofree gchar *fn_patch = NULL;
+	g_autoptr(GBytes) blob_new = NULL;
+	g_autoptr(GBytes) blob_old = NULL;
+	g_autoptr(GBytes) blob_patch = NULL;
+	g_autoptr(SoupURI) uri = NULL;
+
+	/* advertise what we already have using its checksum */
+	if (!g_file_get_contents (fn, &data_old, &len_old, error))
+		return FALSE;
+	checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA256,
+						(guchar *) data_old, len_old);
+	uri = fwupd_remote_build_patch_uri (remote, checksum, error);
+	if (uri == NULL)
+		return FALSE;
+
+	/* the server may well not have generated one */
+	fn_patch = g_strdup_printf ("%s.diff", fn);
+	if (!fu_util_download_file (priv, NULL, uri, fn_patch, NULL, error))
+		return FALSE;
+	if (!g_file_get_contents (fn_patch, &data_patch, &len_patch, error))
+		return FALSE;
+
+	/* rebuild the current metadata from the patch */
+	blob_old = g_bytes_new_static (data_old, len_old);
+	blob_patch = g_bytes_new_static (data_patch, len_patch);
+	blob_new = fu_util_apply_metadata_patch (blob_old, blob_patch, error);
+	g_unlink (fn_patch);
+	if (blob_new == NULL)
+		return FALSE;
+	return g_file_set_contents (fn,
+				    g_bytes_get_data (blob_new, NULL),
+				    (gssize) g_bytes_get_size (blob_new),
+				    error);
+}
+
+static gboolean
+fu_util_download_metadata_files (FuUtilPrivate *priv,
+				 FwupdRemote *remote,
+				 gchar **filename_out,
+				 gchar **filename_asc_out,
+				 GError **error)
+{
+	gboolean patched = FALSE;
 	g_autofree gchar *cache_dir = NULL;
 	g_autofree gchar *filename = NULL;
 	g_autofree gchar *filename_asc = NULL;
 
-	/* ensure cache directory exists */
+	/* try a server-generated patch against the metadata we already have,
+	 * falling back to downloading the whole file */
 	cache_dir = g_build_filename (g_get_user_cache_dir (), "fwupdmgr", NULL);
-	if (!fu_util_mkdir_with_parents (cache_dir, error))
-		return FALSE;
-
-	/* download the metadata */
 	filename = g_build_filename (cache_dir, fwupd_remote_get_filename (remote), NULL);
-	if (!fu_util_download_file (priv, fwupd_remote_get_uri (remote),
+	if (g_file_test (filename, G_FILE_TEST_EXISTS)) {
+		g_autoptr(GError) error_patch = NULL;
+		if (fu_util_download_metadata_patch (priv, remote,
+						     filename, &error_patch)) {
+			patched = TRUE;
+		} else {
+			g_debug ("no metadata patch for %s: %s",
+				 fwupd_remote_get_id (remote),
+				 error_patch->message);
+		}
+	}
+
+	/* download the metadata, using the validators saved in the remote */
+	if (!patched &&
+	    !fu_util_download_file (priv, remote, fwupd_remote_get_uri (remote),
 				    filename, NULL, error))
 		return FALSE;
 
-	/* download the signature */
+	/* download the signature; the validators only apply to the metadata */
 	filename_asc = g_build_filename (cache_dir, fwupd_remote_get_filename_asc (remote), NULL);
-	if (!fu_util_download_file (priv, fwupd_remote_get_uri_asc (remote),
+	if (!fu_util_download_file (priv, NULL, fwupd_remote_get_uri_asc (remote),
 				    filename_asc, NULL, error))
 		return FALSE;
 
-	/* send all this to fwupd */
-	return fwupd_client_update_metadata_with_id (priv->client,
-						     fwupd_remote_get_id (remote),
-						     filename,
-						     filename_asc,
-						     NULL, error);
+	*filename_out = g_steal_pointer (&filename);
+	*filename_asc_out = g_steal_pointer (&filename_asc);
+	return TRUE;
+}
+
+typedef struct {
+	FuUtilPrivate	*priv;
+	FwupdRemote	*remote;
+	gchar		*filename;
+	gchar		*filename_asc;
+	gboolean	 ret;
+	GError		*error;
+} FuUtilRefreshHelper;
+
+static void
+fu_util_refresh_helper_free (FuUtilRefreshHelper *helper)
+{
+	if (helper->error != NULL)
+		g_error_free (helper->error);
+	g_object_unref (helper->remote);
+	g_free (helper->filename);
+	g_free (helper->filename_asc);
+	g_free (helper);
+}
+
+static gpointer
+fu_util_refresh_download_thread_cb (gpointer user_data)
+{
+	FuUtilRefreshHelper *helper = (FuUtilRefreshHelper *) user_data;
+	helper->ret = fu_util_download_metadata_files (helper->priv,
+						       helper->remote,
+						       &helper->filename,
+						       &helper->filename_asc,
+						       &helper->error);
+	return NULL;
 }
 
 static gboolean
 fu_util_download_metadata (FuUtilPrivate *priv, GError **error)
 {
+	gboolean ret = TRUE;
+	g_autofree gchar *cache_dir = NULL;
+	g_autoptr(GPtrArray) helpers = NULL;
 	g_autoptr(GPtrArray) remotes = NULL;
+	g_autoptr(GPtrArray) threads = NULL;
+
 	remotes = fwupd_client_get_remotes (priv->client, NULL, error);
 	if (remotes == NULL)
 		return FALSE;
+
+	/* ensure cache directory exists before the threads race to use it */
+	cache_dir = g_build_filename (g_get_user_cache_dir (), "fwupdmgr", NULL);
+	if (!fu_util_mkdir_with_parents (cache_dir, error))
+		return FALSE;
+
+	/* download all the enabled remotes concurrently */
+	helpers = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_util_refresh_helper_free);
+	threads = g_ptr_array_new ();
 	for (guint i = 0; i < remotes->len; i++) {
 		FwupdRemote *remote = g_ptr_array_index (remotes, i);
+		FuUtilRefreshHelper *helper;
 		if (!fwupd_remote_get_enabled (remote))
 			continue;
-		if (!fu_util_download_metadata_for_remote (priv, remote, error))
-			return FALSE;
+		helper = g_new0 (FuUtilRefreshHelper, 1);
+		helper->priv = priv;
+		helper->remote = g_object_ref (remote);
+		g_ptr_array_add (helpers, helper);
+		g_ptr_array_add (threads,
+				 g_thread_new ("refresh",
+					       fu_util_refresh_download_thread_cb,
+					       helper));
 	}
-	return TRUE;
+
+	/* apply in priority order as each download completes, so the daemon
+	 * verifies one remote while the others are still downloading */
+	for (guint i = 0; i < helpers->len; i++) {
+		FuUtilRefreshHelper *helper = g_ptr_array_index (helpers, i);
+		g_thread_join (g_ptr_array_index (threads, i));
+		if (!helper->ret) {
+			if (ret) {
+				g_propagate_prefixed_error (error,
+							    helper->error,
+							    "failed to refresh %s: ",
+							    fwupd_remote_get_id (helper->remote));
+				helper->error = NULL;
+				ret = FALSE;
+			}
+			continue;
+		}
+		if (!fwupd_client_update_metadata_with_id (priv->client,
+							   fwupd_remote_get_id (helper->remote),
+							   helper->filename,
+							   helper->filename_asc,
+							   NULL,
+							   ret ? error : NULL)) {
+			ret = FALSE;
+		}
+	}
+	return ret;
 }
 
 static gboolean
@@ -886,11 +1233,35 @@ fu_util_refresh (FuUtilPrivate *priv, gchar **values, GError **error)
 					     error);
 }
 
+static FwupdResult *
+fu_util_get_results_direct (const gchar *device_id, GError **error)
+{
+	g_autofree gchar *filename = NULL;
+	g_autoptr(FuPending) pending = NULL;
+
+	/* only possible with filesystem permission on the database */
+	filename = g_build_filename (LOCALSTATEDIR, "lib", "fwupd",
+				     "pending.db", NULL);
+	if (!g_file_test (filename, G_FILE_TEST_EXISTS) ||
+	    g_access (filename, R_OK) != 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_READ,
+			     "no read access to %s",
+			     filename);
+		return NULL;
+	}
+	pending = fu_pending_new ();
+	fu_pending_set_read_only (pending, TRUE);
+	return fu_pending_get_device (pending, device_id, error);
+}
+
 static gboolean
 fu_util_get_results (FuUtilPrivate *priv, gchar **values, GError **error)
 {
 	g_autofree gchar *tmp = NULL;
 	g_autoptr(FwupdResult) res = NULL;
+	g_autoptr(GError) error_local = NULL;
 
 	if (g_strv_length (values) != 1) {
 		g_set_error_literal (error,
@@ -899,14 +1270,60 @@ fu_util_get_results (FuUtilPrivate *priv, gchar **values, GError **error)
 				     "Invalid arguments: expected 'DeviceID'");
 		return FALSE;
 	}
-	res = fwupd_client_get_results (priv->client, values[0], NULL, error);
-	if (res == NULL)
-		return FALSE;
+
+	/* read the pending database directly when we have filesystem
+	 * permission; WAL mode makes this safe concurrent with the daemon
+	 * and avoids waking the daemon at all for fleet audit sweeps */
+	res = fu_util_get_results_direct (values[0], &error_local);
+	if (res == NULL) {
+		/* the plugin may still have results not in the database,
+		 * e.g. read back from the hardware itself */
+		g_debug ("direct read failed, using D-Bus: %s",
+			 error_local->message);
+		res = fwupd_client_get_results (priv->client, values[0],
+						NULL, error);
+		if (res == NULL)
+			return FALSE;
+	}
 	tmp = fwupd_result_to_string (res);
 	g_print ("%s", tmp);
 	return TRUE;
 }
 
+static gboolean
+fu_util_get_daemon_stats (FuUtilPrivate *priv, gchar **values, GError **error)
+{
+	GVariant *value;
+	const gchar *key;
+	g_autoptr(GDBusConnection) connection = NULL;
+	g_autoptr(GVariant) val = NULL;
+	g_autoptr(GVariantIter) iter = NULL;
+
+	/* not exported in libfwupd as the keys are not stable API */
+	connection = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, error);
+	if (connection == NULL)
+		return FALSE;
+	val = g_dbus_connection_call_sync (connection,
+					   FWUPD_DBUS_SERVICE,
+					   FWUPD_DBUS_PATH,
+					   FWUPD_DBUS_INTERFACE,
+					   "GetStats",
+					   NULL,
+					   NULL,
+					   G_DBUS_CALL_FLAGS_NONE,
+					   -1,
+					   NULL,
+					   error);
+	if (val == NULL)
+		return FALSE;
+	g_variant_get (val, "(a{sv})", &iter);
+	while (g_variant_iter_loop (iter, "{&sv}", &key, &value)) {
+		g_autofree gchar *tmp = g_variant_print (value, FALSE);
+		g_print ("%s: %s\n", key, tmp);
+	}
+	return TRUE;
+}
+
 static gboolean
 fu_util_get_releases (FuUtilPrivate *priv, gchar **values, GError **error)
 {
@@ -1133,12 +1550,74 @@ fu_util_cancelled_cb (GCancellable *cancellable, gpointer user_data)
 	g_main_loop_quit (priv->loop);
 }
 
+/* JSON string literal including the quotes, or a bare null */
+static gchar *
+fu_util_json_string (const gchar *str)
+{
+	GString *json;
+	if (str == NULL)
+		return g_strdup ("null");
+	json = g_string_new ("\"");
+	for (guint i = 0; str[i] != '\0'; i++) {
+		if (str[i] == '"' || str[i] == '\\')
+			g_string_append_c (json, '\\');
+		if ((guchar) str[i] < 0x20) {
+			g_string_append_printf (json, "\\u%04x", str[i]);
+			continue;
+		}
+		g_string_append_c (json, str[i]);
+	}
+	g_string_append_c (json, '"');
+	return g_string_free (json, FALSE);
+}
+
+static void
+fu_util_monitor_json_device (FuUtilPrivate *priv,
+			     const gchar *event,
+			     FwupdResult *device)
+{
+	FwupdDevice *dev = fwupd_result_get_device (device);
+	g_autofree gchar *id = NULL;
+	g_autofree gchar *name = NULL;
+	id = fu_util_json_string (fwupd_device_get_id (dev));
+	name = fu_util_json_string (fwupd_device_get_name (dev));
+	g_print ("{\"event\":\"%s\",\"device_id\":%s,\"name\":%s,\"state\":\"%s\"}\n",
+		 event, id, name,
+		 fwupd_update_state_to_string (fwupd_result_get_update_state (device)));
+}
+
+static void
+fu_util_monitor_status_cb (FwupdClient *client,
+			   FwupdStatus status,
+			   gpointer user_data)
+{
+	g_print ("{\"event\":\"status\",\"status\":\"%s\"}\n",
+		 fwupd_status_to_string (status));
+}
+
+static void
+fu_util_monitor_percentage_cb (GObject *object,
+			       GParamSpec *pspec,
+			       gpointer user_data)
+{
+	FwupdClient *client = FWUPD_CLIENT (object);
+	g_print ("{\"event\":\"progress\",\"percentage\":%u,\"status\":\"%s\"}\n",
+		 fwupd_client_get_percentage (client),
+		 fwupd_status_to_string (fwupd_client_get_status (client)));
+}
+
 static void
 fu_util_device_added_cb (FwupdClient *client,
 			 FwupdResult *device,
 			 gpointer user_data)
 {
-	g_autofree gchar *tmp = fwupd_result_to_string (device);
+	FuUtilPrivate *priv = (FuUtilPrivate *) user_data;
+	g_autofree gchar *tmp = NULL;
+	if (priv->monitor_ndjson) {
+		fu_util_monitor_json_device (priv, "device-added", device);
+		return;
+	}
+	tmp = fwupd_result_to_string (device);
 	/* TRANSLATORS: this is when a device is hotplugged */
 	g_print ("%s\n%s", _("Device added:"), tmp);
 }
@@ -1148,7 +1627,13 @@ fu_util_device_removed_cb (FwupdClient *client,
 			   FwupdResult *device,
 			   gpointer user_data)
 {
-	g_autofree gchar *tmp = fwupd_result_to_string (device);
+	FuUtilPrivate *priv = (FuUtilPrivate *) user_data;
+	g_autofree gchar *tmp = NULL;
+	if (priv->monitor_ndjson) {
+		fu_util_monitor_json_device (priv, "device-removed", device);
+		return;
+	}
+	tmp = fwupd_result_to_string (device);
 	/* TRANSLATORS: this is when a device is hotplugged */
 	g_print ("%s\n%s", _("Device removed:"), tmp);
 }
@@ -1158,7 +1643,13 @@ fu_util_device_changed_cb (FwupdClient *client,
 			   FwupdResult *device,
 			   gpointer user_data)
 {
-	g_autofree gchar *tmp = fwupd_result_to_string (device);
+	FuUtilPrivate *priv = (FuUtilPrivate *) user_data;
+	g_autofree gchar *tmp = NULL;
+	if (priv->monitor_ndjson) {
+		fu_util_monitor_json_device (priv, "device-changed", device);
+		return;
+	}
+	tmp = fwupd_result_to_string (device);
 	/* TRANSLATORS: this is when a device has been updated */
 	g_print ("%s\n%s", _("Device changed:"), tmp);
 }
@@ -1166,6 +1657,11 @@ fu_util_device_changed_cb (FwupdClient *client,
 static void
 fu_util_changed_cb (FwupdClient *client, gpointer user_data)
 {
+	FuUtilPrivate *priv = (FuUtilPrivate *) user_data;
+	if (priv->monitor_ndjson) {
+		g_print ("{\"event\":\"changed\"}\n");
+		return;
+	}
 	/* TRANSLATORS: this is when the daemon state changes */
 	g_print ("%s\n", _("Changed"));
 }
@@ -1189,6 +1685,15 @@ fu_util_monitor (FuUtilPrivate *priv, gchar **values, GError **error)
 			  G_CALLBACK (fu_util_device_removed_cb), priv);
 	g_signal_connect (client, "device-changed",
 			  G_CALLBACK (fu_util_device_changed_cb), priv);
+	if (priv->monitor_ndjson) {
+		/* line-buffer stdout so each event flushes as one record
+		 * even when piped to the agent */
+		setvbuf (stdout, NULL, _IOLBF, 0);
+		g_signal_connect (client, "status-changed",
+				  G_CALLBACK (fu_util_monitor_status_cb), priv);
+		g_signal_connect (client, "notify::percentage",
+				  G_CALLBACK (fu_util_monitor_percentage_cb), priv);
+	}
 	g_signal_connect (priv->cancellable, "cancelled",
 			  G_CALLBACK (fu_util_cancelled_cb), priv);
 	g_main_loop_run (priv->loop);
@@ -1221,14 +1726,16 @@ fu_util_update_device_with_release (FuUtilPrivate *priv,
 				    GError **error)
 {
 	GPtrArray *checksums;
+	const gchar *checksum;
 	const gchar *remote_id;
 	const gchar *uri_tmp;
 	g_autofree gchar *basename = NULL;
 	g_autofree gchar *cache_dir = NULL;
 	g_autofree gchar *fn = NULL;
-	g_autoptr(SoupURI) uri = NULL;
+	g_autoptr(GPtrArray) uris = NULL;
 
-	/* work out what remote-specific URI fields this should use */
+	/* work out what remote-specific URI fields this should use,
+	 * preferring any configured mirrors over the upstream URI */
 	uri_tmp = fwupd_release_get_uri (rel);
 	remote_id = fwupd_release_get_remote_id (rel);
 	if (remote_id != NULL) {
@@ -1239,11 +1746,12 @@ fu_util_update_device_with_release (FuUtilPrivate *priv,
 							error);
 		if (remote == NULL)
 			return FALSE;
-		uri = fwupd_remote_build_uri (remote, uri_tmp, error);
-		if (uri == NULL)
+		uris = fwupd_remote_build_firmware_uris (remote, uri_tmp, error);
+		if (uris == NULL)
 			return FALSE;
 	} else {
-		uri = soup_uri_new (uri_tmp);
+		uris = g_ptr_array_new_with_free_func ((GDestroyNotify) soup_uri_free);
+		g_ptr_array_add (uris, soup_uri_new (uri_tmp));
 	}
 
 	/* ensure cache directory exists */
@@ -1256,12 +1764,35 @@ fu_util_update_device_with_release (FuUtilPrivate *priv,
 		 fwupd_release_get_version (rel),
 		 fwupd_device_get_name (dev));
 	basename = g_path_get_basename (uri_tmp);
-	fn = g_build_filename (cache_dir, basename, NULL);
 	checksums = fwupd_release_get_checksums (rel);
-	if (!fu_util_download_file (priv, uri, fn,
-				    fu_util_get_best_checksum (checksums),
-				    error))
-		return FALSE;
+	checksum = fu_util_get_best_checksum (checksums);
+	if (checksum != NULL) {
+		/* key the cache by content so the same firmware referenced
+		 * from several releases or remotes shares one download */
+		g_autofree gchar *basename_cas = NULL;
+		basename_cas = g_strdup_printf ("%s-%s", checksum, basename);
+		fn = g_build_filename (cache_dir, basename_cas, NULL);
+	} else {
+		fn = g_build_filename (cache_dir, basename, NULL);
+	}
+	for (guint i = 0; i < uris->len; i++) {
+		SoupURI *uri = g_ptr_array_index (uris, i);
+		g_autoptr(GError) error_local = NULL;
+		if (fu_util_download_file (priv, NULL, uri, fn,
+					   checksum,
+					   &error_local))
+			break;
+		/* the stall timeout keeps any partial data, so the next
+		 * mirror resumes rather than starting over */
+		if (i + 1 == uris->len) {
+			g_propagate_error (error, error_local);
+			error_local = NULL;
+			return FALSE;
+		}
+		/* TRANSLATORS: a mirror failed, moving down the list */
+		g_print ("%s: %s\n", _("Failed, trying next mirror"),
+			 error_local->message);
+	}
 	g_print ("Updating %s on %s...\n",
 		 fwupd_release_get_version (rel),
 		 fwupd_device_get_name (dev));
@@ -1271,12 +1802,18 @@ fu_util_update_device_with_release (FuUtilPrivate *priv,
 static gboolean
 fu_util_update (FuUtilPrivate *priv, gchar **values, GError **error)
 {
-	GPtrArray *results = NULL;
+	guint cnt_failed = 0;
+	guint cnt_scheduled = 0;
+	guint cnt_updated = 0;
+	guint idx_online = 0;
+	g_autoptr(GPtrArray) results = NULL;
+	g_autoptr(GPtrArray) tasks = NULL;
 
-	/* apply any updates */
+	/* resolve all the updatable devices in one call */
 	results = fwupd_client_get_updates (priv->client, NULL, error);
 	if (results == NULL)
 		return FALSE;
+	tasks = g_ptr_array_new ();
 	for (guint i = 0; i < results->len; i++) {
 		FwupdResult *res = g_ptr_array_index (results, i);
 		FwupdDevice *dev = fwupd_result_get_device (res);
@@ -1286,13 +1823,82 @@ fu_util_update (FuUtilPrivate *priv, gchar **values, GError **error)
 			continue;
 		if (fwupd_release_get_uri (rel) == NULL)
 			continue;
-		if (!fu_util_update_device_with_release (priv, dev, rel, error))
-			return FALSE;
+		/* devices that can flash online go first; offline-only
+		 * devices just get scheduled for the next reboot so doing
+		 * them last keeps the machine usable for longest */
+		if (fwupd_device_has_flag (dev, FWUPD_DEVICE_FLAG_ALLOW_ONLINE))
+			g_ptr_array_insert (tasks, idx_online++, res);
+		else
+			g_ptr_array_add (tasks, res);
+	}
+	if (tasks->len == 0) {
+		/* TRANSLATORS: nothing had to be done */
+		g_print ("%s\n", _("No updatable devices"));
+		return TRUE;
 	}
 
+	/* one device failing should not abandon the rest of the batch */
+	for (guint i = 0; i < tasks->len; i++) {
+		FwupdResult *res = g_ptr_array_index (tasks, i);
+		FwupdDevice *dev = fwupd_result_get_device (res);
+		FwupdRelease *rel = fwupd_result_get_release (res);
+		FwupdInstallFlags flags_old = priv->flags;
+		g_autoptr(GError) error_local = NULL;
+
+		g_print ("[%u/%u] %s: %s -> %s\n",
+			 i + 1, tasks->len,
+			 fwupd_device_get_name (dev),
+			 fwupd_device_get_version (dev),
+			 fwupd_release_get_version (rel));
+		if (!fu_util_update_device_with_release (priv, dev, rel,
+							 &error_local)) {
+			g_print ("[%u/%u] %s: %s\n",
+				 i + 1, tasks->len,
+				 fwupd_device_get_name (dev),
+				 error_local->message);
+			cnt_failed++;
+		} else if ((priv->flags & FWUPD_INSTALL_FLAG_OFFLINE) > 0) {
+			cnt_scheduled++;
+		} else {
+			cnt_updated++;
+		}
+
+		/* the offline fallback is per-device, not for the batch */
+		priv->flags = flags_old;
+	}
+
+	/* consolidated summary */
+	g_print ("\n%s: ", _("Update summary"));
+	/* TRANSLATORS: how many devices were updated immediately */
+	g_print ("%u %s, ", cnt_updated, _("updated"));
+	/* TRANSLATORS: how many devices update on the next reboot */
+	g_print ("%u %s, ", cnt_scheduled, _("scheduled for next reboot"));
+	/* TRANSLATORS: how many devices could not be updated */
+	g_print ("%u %s\n", cnt_failed, _("failed"));
+	if (cnt_failed > 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INTERNAL,
+			     "%u of %u updates failed",
+			     cnt_failed, tasks->len);
+		return FALSE;
+	}
 	return TRUE;
 }
 
+/* compares the release version against @version, preferring the sort
+ * key precomputed when the version entered the release object */
+static gint
+fu_util_release_vercmp (FwupdRelease *release, const gchar *version)
+{
+	const guint8 *key = fwupd_release_get_version_key (release);
+	guint8 version_key[FWUPD_VERSION_KEY_SZ];
+	if (key != NULL &&
+	    fwupd_version_key_from_string (version, version_key))
+		return fwupd_version_key_compare (key, version_key);
+	return as_utils_vercmp (fwupd_release_get_version (release), version);
+}
+
 static gboolean
 fu_util_downgrade (FuUtilPrivate *priv, gchar **values, GError **error)
 {
@@ -1324,14 +1930,14 @@ fu_util_downgrade (FuUtilPrivate *priv, gchar **values, GError **error)
 		FwupdRelease *rel_tmp = g_ptr_array_index (rels, i);
 
 		/* only include older firmware */
-		if (as_utils_vercmp (fwupd_release_get_version (rel_tmp),
-				     fwupd_device_get_version (dev)) >= 0)
+		if (fu_util_release_vercmp (rel_tmp,
+					    fwupd_device_get_version (dev)) >= 0)
 			continue;
 
 		/* don't show releases we are not allowed to dowgrade to */
 		if (fwupd_device_get_version_lowest (dev) != NULL) {
-			if (as_utils_vercmp (fwupd_release_get_version (rel_tmp),
-					     fwupd_device_get_version_lowest (dev)) >= 0)
+			if (fu_util_release_vercmp (rel_tmp,
+						    fwupd_device_get_version_lowest (dev)) >= 0)
 				continue;
 		}
 
@@ -1449,6 +2055,7 @@ main (int argc, char *argv[])
 	g_autoptr(FuUtilPrivate) priv = NULL;
 	g_autoptr(GError) error = NULL;
 	g_autofree gchar *cmd_descriptions = NULL;
+	g_autofree gchar *format = NULL;
 	const GOptionEntry options[] = {
 		{ "verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose,
 			/* TRANSLATORS: command line option */
@@ -1465,6 +2072,11 @@ main (int argc, char *argv[])
 		{ "force", '\0', 0, G_OPTION_ARG_NONE, &force,
 			/* TRANSLATORS: command line option */
 			_("Override plugin warning"), NULL },
+		{ "format", '\0', 0, G_OPTION_ARG_STRING, &format,
+			/* TRANSLATORS: command line option */
+			_("Output format for monitor, e.g. 'ndjson'"),
+			/* TRANSLATORS: command line option value */
+			_("FORMAT") },
 		{ NULL}
 	};
 
@@ -1549,6 +2161,12 @@ main (int argc, char *argv[])
 		     /* TRANSLATORS: command description */
 		     _("Gets the results from the last update"),
 		     fu_util_get_results);
+	fu_util_add (priv->cmd_array,
+		     "get-daemon-stats",
+		     NULL,
+		     /* TRANSLATORS: command description */
+		     _("Gets memory-usage counters from the daemon"),
+		     fu_util_get_daemon_stats);
 	fu_util_add (priv->cmd_array,
 		     "get-releases",
 		     NULL,
@@ -1624,6 +2242,16 @@ main (int argc, char *argv[])
 	if (force)
 		priv->flags |= FWUPD_INSTALL_FLAG_FORCE;
 
+	/* machine-readable output? */
+	if (format != NULL) {
+		if (g_strcmp0 (format, "ndjson") != 0) {
+			/* TRANSLATORS: the user passed an unknown --format */
+			g_print ("%s: %s\n", _("Unknown format"), format);
+			return EXIT_FAILURE;
+		}
+		priv->monitor_ndjson = TRUE;
+	}
+
 	/* connect to the daemon */
 	priv->client = fwupd_client_new ();
 	g_signal_connect (priv->client, "notify::percentage",
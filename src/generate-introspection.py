@@ -0,0 +1,138 @@
+#!/usr/bin/python3
+#
+# Copyright (C) 2017 Richard Hughes <richard@hughsie.com>
+#
+# Licensed under the GNU General Public License Version 2
+#
+# Generates static GDBusInterfaceInfo tables from D-Bus introspection XML
+# so the daemon does not have to parse the XML at every startup.
+
+import sys
+import xml.etree.ElementTree as ET
+
+
+def localname(tag):
+    return tag.split('}')[-1]
+
+
+def sanitize(name):
+    return name.lower().replace('.', '_').replace('-', '_')
+
+
+def c_str(val):
+    if val is None:
+        return 'NULL'
+    return '(gchar *) "%s"' % val
+
+
+def emit_args(out, prefix, args):
+    for i, arg in enumerate(args):
+        out.append('static GDBusArgInfo %s_%i = { -1, %s, %s, NULL };' %
+                   (prefix, i, c_str(arg.get('name')), c_str(arg.get('type'))))
+    out.append('static GDBusArgInfo *%s[] = {' % prefix)
+    for i in range(len(args)):
+        out.append('\t&%s_%i,' % (prefix, i))
+    out.append('\tNULL,')
+    out.append('};')
+
+
+def emit_interface(out, iface):
+    iface_id = 'fu_dbus_%s' % sanitize(iface.get('name'))
+    methods = []
+    signals = []
+    props = []
+    for node in iface:
+        tag = localname(node.tag)
+        if tag == 'method':
+            method_id = '%s_method_%s' % (iface_id, sanitize(node.get('name')))
+            args_in = [a for a in node if localname(a.tag) == 'arg' and
+                       a.get('direction', 'in') == 'in']
+            args_out = [a for a in node if localname(a.tag) == 'arg' and
+                        a.get('direction', 'in') == 'out']
+            emit_args(out, method_id + '_in', args_in)
+            emit_args(out, method_id + '_out', args_out)
+            out.append('static GDBusMethodInfo %s = {' % method_id)
+            out.append('\t-1, %s,' % c_str(node.get('name')))
+            out.append('\t%s_in,' % method_id)
+            out.append('\t%s_out,' % method_id)
+            out.append('\tNULL,')
+            out.append('};')
+            methods.append(method_id)
+        elif tag == 'signal':
+            signal_id = '%s_signal_%s' % (iface_id, sanitize(node.get('name')))
+            args = [a for a in node if localname(a.tag) == 'arg']
+            emit_args(out, signal_id + '_args', args)
+            out.append('static GDBusSignalInfo %s = {' % signal_id)
+            out.append('\t-1, %s,' % c_str(node.get('name')))
+            out.append('\t%s_args,' % signal_id)
+            out.append('\tNULL,')
+            out.append('};')
+            signals.append(signal_id)
+        elif tag == 'property':
+            prop_id = '%s_prop_%s' % (iface_id, sanitize(node.get('name')))
+            flags = []
+            access = node.get('access', 'read')
+            if 'read' in access:
+                flags.append('G_DBUS_PROPERTY_INFO_FLAGS_READABLE')
+            if 'write' in access:
+                flags.append('G_DBUS_PROPERTY_INFO_FLAGS_WRITABLE')
+            if not flags:
+                flags.append('G_DBUS_PROPERTY_INFO_FLAGS_NONE')
+            out.append('static GDBusPropertyInfo %s = {' % prop_id)
+            out.append('\t-1, %s, %s,' % (c_str(node.get('name')),
+                                          c_str(node.get('type'))))
+            out.append('\t%s,' % ' | '.join(flags))
+            out.append('\tNULL,')
+            out.append('};')
+            props.append(prop_id)
+    for kind, ids in [('method', methods), ('signal', signals), ('prop', props)]:
+        out.append('static %s *%s_%ss[] = {' %
+                   ({'method': 'GDBusMethodInfo',
+                     'signal': 'GDBusSignalInfo',
+                     'prop': 'GDBusPropertyInfo'}[kind], iface_id, kind))
+        for tmp_id in ids:
+            out.append('\t&%s,' % tmp_id)
+        out.append('\tNULL,')
+        out.append('};')
+    out.append('static GDBusInterfaceInfo %s = {' % iface_id)
+    out.append('\t-1, %s,' % c_str(iface.get('name')))
+    out.append('\t%s_methods,' % iface_id)
+    out.append('\t%s_signals,' % iface_id)
+    out.append('\t%s_props,' % iface_id)
+    out.append('\tNULL,')
+    out.append('};')
+    return iface_id
+
+
+def main():
+    if len(sys.argv) != 3:
+        print('usage: %s SOURCE DEST' % sys.argv[0])
+        return 1
+    tree = ET.parse(sys.argv[1])
+    out = []
+    out.append('/* generated from %s -- do not edit */' %
+               sys.argv[1].split('/')[-1])
+    out.append('#ifndef __FU_INTROSPECTION_H')
+    out.append('#define __FU_INTROSPECTION_H')
+    out.append('')
+    out.append('#include <gio/gio.h>')
+    out.append('')
+    iface_ids = []
+    for iface in tree.getroot():
+        if localname(iface.tag) != 'interface':
+            continue
+        iface_ids.append(emit_interface(out, iface))
+    out.append('static GDBusInterfaceInfo * const fu_dbus_interfaces[] = {')
+    for iface_id in iface_ids:
+        out.append('\t&%s,' % iface_id)
+    out.append('\tNULL,')
+    out.append('};')
+    out.append('')
+    out.append('#endif /* __FU_INTROSPECTION_H */')
+    with open(sys.argv[2], 'w') as f:
+        f.write('\n'.join(out) + '\n')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())